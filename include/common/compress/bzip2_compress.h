@@ -35,14 +35,34 @@
 #include <common/types.h>
 
 namespace common {
+namespace threads {
+class ThreadPool;
+}
 namespace compress {
 
+// one full size bzip2 block (-9)
+enum : size_t { BZIP2_PARALLEL_BLOCK_SIZE = 900 * 1000 };
+
 Error EncodeBZip2(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeBZip2(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 
 Error EncodeBZip2(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeBZip2(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 
+// Compresses |block_size| pieces of |data| as separate bzip2 streams on |pool|
+// (in the calling thread when |pool| is null) and concatenates them, the
+// multistream layout bzip2 and pbzip2 read. DecodeBZip2 accepts it too.
+Error EncodeBZip2Parallel(const StringPiece& data,
+                          bool sized,
+                          threads::ThreadPool* pool,
+                          char_buffer_t* out,
+                          size_t block_size = BZIP2_PARALLEL_BLOCK_SIZE) WARN_UNUSED_RESULT;
+Error EncodeBZip2Parallel(const char_buffer_t& data,
+                          bool sized,
+                          threads::ThreadPool* pool,
+                          char_buffer_t* out,
+                          size_t block_size = BZIP2_PARALLEL_BLOCK_SIZE) WARN_UNUSED_RESULT;
+
 }  // namespace compress
 }  // namespace common
 #endif
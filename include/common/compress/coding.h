@@ -41,5 +41,13 @@ size_t PutDecompressedSizeInfo(char_buffer_t* output, uint32_t length);
 bool GetDecompressedSizeInfo(const char** input_data, size_t* input_length, uint32_t* output_len);
 bool GetDecompressedSizeInfo(const unsigned char** input_data, size_t* input_length, uint32_t* output_len);
 
+// Header of dictionary compressed data: the size followed by the
+// CompressDictionary id, both varint32.
+size_t PutDecompressedSizeInfo(char_buffer_t* output, uint32_t length, uint32_t dictionary_id);
+bool GetDecompressedSizeInfo(const char** input_data,
+                             size_t* input_length,
+                             uint32_t* output_len,
+                             uint32_t* dictionary_id);
+
 }  // namespace compress
 }  // namespace common
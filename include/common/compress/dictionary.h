@@ -0,0 +1,75 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <common/error.h>
+#include <common/string_piece.h>
+#include <common/types.h>
+
+namespace common {
+namespace compress {
+
+// Shared history for compressing many small, similar messages (JSON-RPC
+// commands, daemon responses). Encoder and decoder must use the same
+// dictionary, the sized header carries its id so a mismatch is detected.
+class CompressDictionary {
+ public:
+  // Only the last 32KB are usable by deflate, LZ4 takes up to 64KB. zlib
+  // hashes the whole dictionary for every message, so bigger ones trade
+  // speed for ratio: a few KB already capture repetitive protocol traffic.
+  enum : size_t { DEFAULT_DICTIONARY_SIZE = 4 * 1024, MAX_DICTIONARY_SIZE = 32 * 1024 };
+
+  // Loads a dictionary (trained earlier or hand written), content longer
+  // than MAX_DICTIONARY_SIZE keeps its tail.
+  explicit CompressDictionary(const StringPiece& content);
+  explicit CompressDictionary(const char_buffer_t& content);
+
+  uint32_t GetID() const;  // never 0
+  const char_buffer_t& GetContent() const;
+
+ private:
+  char_buffer_t content_;
+  uint32_t id_;
+};
+
+typedef std::shared_ptr<const CompressDictionary> CompressDictionarySPtr;
+
+// Builds a dictionary of at most |dictionary_size| bytes from the segments
+// shared by most |samples|, the most common ones placed last (closest to
+// the data, cheapest to reference).
+Error TrainDictionary(const std::vector<StringPiece>& samples,
+                      size_t dictionary_size,
+                      char_buffer_t* out) WARN_UNUSED_RESULT;
+
+}  // namespace compress
+}  // namespace common
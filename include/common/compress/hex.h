@@ -31,6 +31,7 @@
 
 #include <string>
 
+#include <common/containers/span.h>
 #include <common/error.h>
 #include <common/string_piece.h>
 #include <common/types.h>
@@ -38,6 +39,19 @@
 namespace common {
 namespace compress {
 
+constexpr size_t HexEncodedSize(size_t size) {
+  return size * 2;
+}
+
+constexpr size_t HexDecodedSize(size_t size) {
+  return size / 2;
+}
+
+// Write straight into out, which must hold at least HexEncodedSize(data.size())
+// or HexDecodedSize(data.size()) bytes.
+Error EncodeHex(const StringPiece& data, bool is_lower, span<char> out) WARN_UNUSED_RESULT;
+Error DecodeHex(const StringPiece& data, span<char> out) WARN_UNUSED_RESULT;
+
 Error EncodeHex(const StringPiece& data, bool is_lower, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeHex(const StringPiece& data, char_buffer_t* out) WARN_UNUSED_RESULT;
 
@@ -30,19 +30,85 @@
 #pragma once
 
 #if defined(HAVE_LZ4)
+#include <common/compress/dictionary.h>
 #include <common/error.h>
+#include <common/macros.h>
 #include <common/string_piece.h>
 #include <common/types.h>
 
+union LZ4_stream_u;
+
 namespace common {
+namespace threads {
+class ThreadPool;
+}
 namespace compress {
 
+enum : size_t { LZ4_PARALLEL_BLOCK_SIZE = 256 * 1024 };
+
+// LZ4 stream state kept between calls and fast-reset per message, output
+// is appended to |out|. Block decompression is stateless, DecodeLZ4 writes
+// directly into |out|. Not thread safe, EncodeLZ4 keeps one per thread.
+// With a |dictionary| the sized header carries its id.
+class LZ4Compressor {
+ public:
+  explicit LZ4Compressor(CompressDictionarySPtr dictionary = CompressDictionarySPtr());
+  ~LZ4Compressor();
+
+  CompressDictionarySPtr GetDictionary() const;
+
+  Error Encode(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
+  Error Encode(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LZ4Compressor);
+
+  LZ4_stream_u* stream_;
+  LZ4_stream_u* dictionary_stream_;  // hashed once, copied into stream_ per message
+  const CompressDictionarySPtr dictionary_;
+};
+
 Error EncodeLZ4(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeLZ4(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 
 Error EncodeLZ4(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeLZ4(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 
+// Blocks referencing a preset dictionary, see LZ4Compressor.
+Error EncodeLZ4(const StringPiece& data,
+                bool sized,
+                const CompressDictionarySPtr& dictionary,
+                char_buffer_t* out) WARN_UNUSED_RESULT;
+Error DecodeLZ4(const StringPiece& data,
+                bool sized,
+                const CompressDictionarySPtr& dictionary,
+                char_buffer_t* out) WARN_UNUSED_RESULT;
+
+Error EncodeLZ4(const char_buffer_t& data,
+                bool sized,
+                const CompressDictionarySPtr& dictionary,
+                char_buffer_t* out) WARN_UNUSED_RESULT;
+Error DecodeLZ4(const char_buffer_t& data,
+                bool sized,
+                const CompressDictionarySPtr& dictionary,
+                char_buffer_t* out) WARN_UNUSED_RESULT;
+
+// Produces a standard LZ4 frame of independent blocks, compressed on |pool|
+// (in the calling thread when |pool| is null). |block_size| is rounded up to
+// the nearest frame block size (64KB, 256KB, 1MB or 4MB).
+Error EncodeLZ4Parallel(const StringPiece& data,
+                        threads::ThreadPool* pool,
+                        char_buffer_t* out,
+                        size_t block_size = LZ4_PARALLEL_BLOCK_SIZE) WARN_UNUSED_RESULT;
+// Decodes one or more concatenated LZ4 frames.
+Error DecodeLZ4Frame(const StringPiece& data, char_buffer_t* out) WARN_UNUSED_RESULT;
+
+Error EncodeLZ4Parallel(const char_buffer_t& data,
+                        threads::ThreadPool* pool,
+                        char_buffer_t* out,
+                        size_t block_size = LZ4_PARALLEL_BLOCK_SIZE) WARN_UNUSED_RESULT;
+Error DecodeLZ4Frame(const char_buffer_t& data, char_buffer_t* out) WARN_UNUSED_RESULT;
+
 }  // namespace compress
 }  // namespace common
 
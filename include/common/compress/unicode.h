@@ -31,6 +31,7 @@
 
 #include <string>
 
+#include <common/containers/span.h>
 #include <common/error.h>
 #include <common/string_piece.h>
 #include <common/types.h>
@@ -38,6 +39,20 @@
 namespace common {
 namespace compress {
 
+// 4 big endian hex digits per UTF-16 unit
+constexpr size_t UnicodeEncodedSize(size_t size) {
+  return size * 4;
+}
+
+constexpr size_t UnicodeDecodedSize(size_t size) {
+  return size / 4;
+}
+
+// Write straight into out, which must hold at least UnicodeEncodedSize(data.size())
+// chars or UnicodeDecodedSize(data.size()) units.
+Error EncodeUnicode(const StringPiece16& data, bool is_lower, span<char> out) WARN_UNUSED_RESULT;
+Error DecodeUnicode(const StringPiece& data, span<char16> out) WARN_UNUSED_RESULT;
+
 Error EncodeUnicode(const StringPiece16& data, bool is_lower, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeUnicode(const StringPiece& data, string16* out) WARN_UNUSED_RESULT;
 
@@ -31,6 +31,7 @@
 
 #include <string>
 
+#include <common/containers/span.h>
 #include <common/error.h>
 #include <common/string_piece.h>
 #include <common/types.h>
@@ -38,6 +39,20 @@
 namespace common {
 namespace compress {
 
+// \xHH per byte
+constexpr size_t XHexEncodedSize(size_t size) {
+  return size * 4;
+}
+
+constexpr size_t XHexDecodedSize(size_t size) {
+  return size / 4;
+}
+
+// Write straight into out, which must hold at least XHexEncodedSize(data.size())
+// or XHexDecodedSize(data.size()) bytes.
+Error EncodeXHex(const StringPiece& data, bool is_lower, span<char> out) WARN_UNUSED_RESULT;
+Error DecodeXHex(const StringPiece& data, span<char> out) WARN_UNUSED_RESULT;
+
 Error EncodeXHex(const StringPiece& data, bool is_lower, char_buffer_t* out) WARN_UNUSED_RESULT;
 Error DecodeXHex(const StringPiece& data, char_buffer_t* out) WARN_UNUSED_RESULT;
 
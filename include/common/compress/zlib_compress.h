@@ -30,15 +30,70 @@
 #pragma once
 
 #if defined(HAVE_ZLIB)
+#include <common/compress/dictionary.h>
 #include <common/error.h>
+#include <common/macros.h>
 #include <common/string_piece.h>
 #include <common/types.h>
 
 #include <zlib.h>
 
 namespace common {
+namespace threads {
+class ThreadPool;
+}
 namespace compress {
 
+enum : size_t { ZLIB_PARALLEL_BLOCK_SIZE = 128 * 1024 };
+
+// Deflate state kept between calls: deflateReset instead of deflateInit2
+// per message, which dominates the cost of small payloads. Output is
+// appended to |out|. Not thread safe, EncodeZlib keeps one per thread.
+// With a |dictionary| (zlib format only) every message starts from its
+// content and the sized header carries the dictionary id.
+class ZlibCompressor {
+ public:
+  explicit ZlibCompressor(uint8_t def = 0,
+                          int compression_level = Z_BEST_COMPRESSION,
+                          CompressDictionarySPtr dictionary = CompressDictionarySPtr());
+  ~ZlibCompressor();
+
+  uint8_t GetDeflate() const;
+  int GetCompressionLevel() const;
+  CompressDictionarySPtr GetDictionary() const;
+
+  Error Encode(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
+  Error Encode(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZlibCompressor);
+
+  z_stream stream_;
+  bool inited_;
+  const uint8_t def_;
+  const int compression_level_;
+  const CompressDictionarySPtr dictionary_;
+};
+
+// Inflate counterpart of ZlibCompressor, accepts zlib and gzip input.
+class ZlibDecompressor {
+ public:
+  explicit ZlibDecompressor(CompressDictionarySPtr dictionary = CompressDictionarySPtr());
+  ~ZlibDecompressor();
+
+  CompressDictionarySPtr GetDictionary() const;
+
+  Error Decode(const StringPiece& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
+  Error Decode(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZlibDecompressor);
+
+  z_stream stream_;
+  bool inited_;
+  const CompressDictionarySPtr dictionary_;
+};
+
 Error EncodeZlib(const StringPiece& data,
                  bool sized,
                  uint8_t def,
@@ -53,6 +108,47 @@ Error EncodeZlib(const char_buffer_t& data,
                  int compression_level = Z_BEST_COMPRESSION) WARN_UNUSED_RESULT;
 Error DecodeZlib(const char_buffer_t& data, bool sized, char_buffer_t* out) WARN_UNUSED_RESULT;
 
+// zlib format with a preset dictionary, see ZlibCompressor.
+Error EncodeZlib(const StringPiece& data,
+                 bool sized,
+                 const CompressDictionarySPtr& dictionary,
+                 char_buffer_t* out,
+                 int compression_level = Z_BEST_COMPRESSION) WARN_UNUSED_RESULT;
+Error DecodeZlib(const StringPiece& data,
+                 bool sized,
+                 const CompressDictionarySPtr& dictionary,
+                 char_buffer_t* out) WARN_UNUSED_RESULT;
+
+Error EncodeZlib(const char_buffer_t& data,
+                 bool sized,
+                 const CompressDictionarySPtr& dictionary,
+                 char_buffer_t* out,
+                 int compression_level = Z_BEST_COMPRESSION) WARN_UNUSED_RESULT;
+Error DecodeZlib(const char_buffer_t& data,
+                 bool sized,
+                 const CompressDictionarySPtr& dictionary,
+                 char_buffer_t* out) WARN_UNUSED_RESULT;
+
+// Compresses |block_size| pieces of |data| independently on |pool| (in the
+// calling thread when |pool| is null) and joins them pigz style: each piece
+// is a raw deflate run ending on a byte boundary, wrapped in one gzip or zlib
+// (by |def|) header with the combined checksum. The result is a single
+// regular stream for any inflate, DecodeZlib included.
+Error EncodeZlibParallel(const StringPiece& data,
+                         bool sized,
+                         uint8_t def,
+                         threads::ThreadPool* pool,
+                         char_buffer_t* out,
+                         int compression_level = Z_DEFAULT_COMPRESSION,
+                         size_t block_size = ZLIB_PARALLEL_BLOCK_SIZE) WARN_UNUSED_RESULT;
+Error EncodeZlibParallel(const char_buffer_t& data,
+                         bool sized,
+                         uint8_t def,
+                         threads::ThreadPool* pool,
+                         char_buffer_t* out,
+                         int compression_level = Z_DEFAULT_COMPRESSION,
+                         size_t block_size = ZLIB_PARALLEL_BLOCK_SIZE) WARN_UNUSED_RESULT;
+
 }  // namespace compress
 }  // namespace common
 
@@ -267,23 +267,23 @@ class span : public internal::ExtentStorage<Extent> {
   }
 
   template <size_t N, typename = internal::EnableIfSpanCompatibleArray<T (&)[N], T, Extent>>
-  constexpr span(T (&array)[N]) noexcept : span(data(array), N) {}
+  constexpr span(T (&array)[N]) noexcept : span(common::data(array), N) {}
 
   template <typename U, size_t N, typename = internal::EnableIfSpanCompatibleArray<std::array<U, N>&, T, Extent>>
-  constexpr span(std::array<U, N>& array) noexcept : span(data(array), N) {}
+  constexpr span(std::array<U, N>& array) noexcept : span(common::data(array), N) {}
 
   template <typename U, size_t N, typename = internal::EnableIfSpanCompatibleArray<const std::array<U, N>&, T, Extent>>
-  constexpr span(const std::array<U, N>& array) noexcept : span(data(array), N) {}
+  constexpr span(const std::array<U, N>& array) noexcept : span(common::data(array), N) {}
 
   // Conversion from a container that has compatible common::data() and integral
   // common::size().
   template <typename Container,
             typename = internal::EnableIfSpanCompatibleContainerAndSpanIsDynamic<Container&, T, Extent>>
-  constexpr span(Container& container) noexcept : span(data(container), size(container)) {}
+  constexpr span(Container& container) noexcept : span(common::data(container), common::size(container)) {}
 
   template <typename Container,
             typename = internal::EnableIfSpanCompatibleContainerAndSpanIsDynamic<const Container&, T, Extent>>
-  constexpr span(const Container& container) noexcept : span(data(container), size(container)) {}
+  constexpr span(const Container& container) noexcept : span(common::data(container), common::size(container)) {}
 
   constexpr span(const span& other) noexcept = default;
 
@@ -14,28 +14,49 @@
 
 #pragma once
 
+#include <string>
+
 #include <common/uri/gurl.h>
 
 #include <common/serializer/json_serializer.h>
 
 namespace common {
+namespace serializer {
+
+template <>
+struct JsonFieldTraits<uri::GURL> {
+  static void Write(JsonWriter* writer, const uri::GURL& value) { writer->String(value.spec()); }
+  static bool Read(const JsonValue& value, uri::GURL* out) {
+    std::string path;
+    if (value.GetString(&path)) {
+      return false;
+    }
+
+    *out = uri::GURL(path);
+    return true;
+  }
+};
+
+}  // namespace serializer
+
 namespace daemon {
 namespace commands {
 
-class GetLogInfo : public common::serializer::JsonSerializer<GetLogInfo> {
+class GetLogInfo : public common::serializer::JsonFieldsSerializer<GetLogInfo> {
  public:
-  typedef common::serializer::JsonSerializer<GetLogInfo> base_class;
+  typedef common::serializer::JsonFieldsSerializer<GetLogInfo> base_class;
   typedef common::uri::GURL url_t;
   GetLogInfo();
   explicit GetLogInfo(const url_t& log_path);
 
   url_t GetLogPath() const;
 
- protected:
-  common::Error DoDeSerialize(json_object* serialized) override;
-  common::Error SerializeFields(json_object* out) const override;
-
  private:
+  friend class common::serializer::JsonFieldsSerializer<GetLogInfo>;
+  static constexpr auto json_fields() {
+    return std::make_tuple(common::serializer::MakeJsonField("path", &GetLogInfo::path_));
+  }
+
   url_t path_;
 };
 
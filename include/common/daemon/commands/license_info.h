@@ -36,12 +36,38 @@
 #include <common/serializer/json_serializer.h>
 
 namespace common {
+namespace serializer {
+
+template <size_t N>
+struct JsonFieldTraits<license::License<N>> {
+  static void Write(JsonWriter* writer, const license::License<N>& value) {
+    writer->String(StringPiece(value.data(), value.size()));
+  }
+
+  static bool Read(const JsonValue& value, license::License<N>* out) {
+    std::string data;
+    if (value.GetString(&data)) {
+      return false;
+    }
+
+    const auto lic = license::make_license<license::License<N>>(data);
+    if (!lic) {
+      return false;
+    }
+
+    *out = *lic;
+    return true;
+  }
+};
+
+}  // namespace serializer
+
 namespace daemon {
 namespace commands {
 
-class LicenseInfo : public common::serializer::JsonSerializer<LicenseInfo> {
+class LicenseInfo : public common::serializer::JsonFieldsSerializer<LicenseInfo> {
  public:
-  typedef JsonSerializer<LicenseInfo> base_class;
+  typedef common::serializer::JsonFieldsSerializer<LicenseInfo> base_class;
   typedef license::expire_key_t raw_license_t;
   typedef Optional<raw_license_t> license_t;
   LicenseInfo();
@@ -51,10 +77,16 @@ class LicenseInfo : public common::serializer::JsonSerializer<LicenseInfo> {
   license_t GetLicense() const;
 
  protected:
-  Error DoDeSerialize(json_object* serialized) override;
-  Error SerializeFields(json_object* out) const override;
+  Error ReadFields(const common::serializer::JsonValue& serialized) override;
+  Error WriteFields(common::serializer::JsonWriter* writer) const override;
 
  private:
+  friend class common::serializer::JsonFieldsSerializer<LicenseInfo>;
+  static constexpr auto json_fields() {
+    return std::make_tuple(common::serializer::MakeJsonField("license_key", &LicenseInfo::license_,
+                                                             common::serializer::JSON_FIELD_REQUIRED));
+  }
+
   license_t license_;
 };
 
@@ -37,7 +37,7 @@ namespace common {
 namespace daemon {
 namespace commands {
 
-class ServerPingInfo : public common::serializer::JsonSerializer<ServerPingInfo> {
+class ServerPingInfo : public common::serializer::JsonFieldsSerializer<ServerPingInfo> {
  public:
   ServerPingInfo();
 
@@ -46,11 +46,12 @@ class ServerPingInfo : public common::serializer::JsonSerializer<ServerPingInfo>
 
   bool Equals(const ServerPingInfo& ping) const;
 
- protected:
-  common::Error DoDeSerialize(json_object* serialized) override;
-  common::Error SerializeFields(json_object* deserialized) const override;
-
  private:
+  friend class common::serializer::JsonFieldsSerializer<ServerPingInfo>;
+  static constexpr auto json_fields() {
+    return std::make_tuple(common::serializer::MakeJsonField("timestamp", &ServerPingInfo::timestamp_));
+  }
+
   common::time64_t timestamp_;  // utc time
 };
 
@@ -62,7 +63,7 @@ inline bool operator!=(const ServerPingInfo& x, const ServerPingInfo& y) {
   return !(x == y);
 }
 
-class ClientPingInfo : public common::serializer::JsonSerializer<ClientPingInfo> {
+class ClientPingInfo : public common::serializer::JsonFieldsSerializer<ClientPingInfo> {
  public:
   ClientPingInfo();
 
@@ -70,11 +71,12 @@ class ClientPingInfo : public common::serializer::JsonSerializer<ClientPingInfo>
 
   bool Equals(const ClientPingInfo& ping) const;
 
- protected:
-  common::Error DoDeSerialize(json_object* serialized) override;
-  common::Error SerializeFields(json_object* deserialized) const override;
-
  private:
+  friend class common::serializer::JsonFieldsSerializer<ClientPingInfo>;
+  static constexpr auto json_fields() {
+    return std::make_tuple(common::serializer::MakeJsonField("timestamp", &ClientPingInfo::timestamp_));
+  }
+
   common::time64_t timestamp_;  // utc time
 };
 
@@ -38,19 +38,20 @@ namespace common {
 namespace daemon {
 namespace commands {
 
-class StopInfo : public common::serializer::JsonSerializer<StopInfo> {
+class StopInfo : public common::serializer::JsonFieldsSerializer<StopInfo> {
  public:
-  typedef common::serializer::JsonSerializer<StopInfo> base_class;
+  typedef common::serializer::JsonFieldsSerializer<StopInfo> base_class;
   StopInfo();
   explicit StopInfo(common::time64_t delay);
 
   common::time64_t GetDelay() const;
 
- protected:
-  common::Error DoDeSerialize(json_object* serialized) override;
-  common::Error SerializeFields(json_object* out) const override;
-
  private:
+  friend class common::serializer::JsonFieldsSerializer<StopInfo>;
+  static constexpr auto json_fields() {
+    return std::make_tuple(common::serializer::MakeJsonField("delay", &StopInfo::delay_));
+  }
+
   common::time64_t delay_;
 };
 
@@ -0,0 +1,53 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint64_t
+
+namespace common {
+namespace hash {
+
+// CRC-64/Jones (reflected poly 0xad93d23594c935a9) without pre/post inversion,
+// the same checksum as utils::hash::crc64; pass 0 to start a new checksum.
+uint64_t crc64(uint64_t crc, const void* data, size_t len);
+// Slicing-by-8 implementation without cpu specific instructions.
+uint64_t crc64_portable(uint64_t crc, const void* data, size_t len);
+// Returns crc64 of A+B, where crc1 is crc64 of A and crc2 = crc64(0, B, len2).
+uint64_t crc64_combine(uint64_t crc1, uint64_t crc2, size_t len2);
+
+// CRC-32C (Castagnoli, iSCSI), zlib-like interface: pass 0 to start.
+uint32_t crc32c(uint32_t crc, const void* data, size_t len);
+uint32_t crc32c_portable(uint32_t crc, const void* data, size_t len);
+// Returns crc32c of A+B, where crc1 is crc32c of A and crc2 is crc32c of B.
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+}  // namespace hash
+}  // namespace common
@@ -0,0 +1,86 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+namespace common {
+namespace hash {
+
+// Fast non-cryptographic hashing for in-process tables and checksums of
+// trusted data. The algorithm is XXH3 (xxHash 0.8): results are identical to
+// XXH3_64bits_withSeed / XXH3_128bits_withSeed, so they may be persisted or
+// compared with other implementations.
+
+struct Hash128 {
+  uint64_t low;
+  uint64_t high;
+};
+
+inline bool operator==(const Hash128& left, const Hash128& right) {
+  return left.low == right.low && left.high == right.high;
+}
+
+inline bool operator!=(const Hash128& left, const Hash128& right) {
+  return !(left == right);
+}
+
+uint64_t FastHash64(const void* data, size_t len, uint64_t seed = 0);
+Hash128 FastHash128(const void* data, size_t len, uint64_t seed = 0);
+
+// Streaming form, Digest*() after any sequence of Update() calls equals the
+// one shot hash of the concatenated input.
+class FastHasher {
+ public:
+  explicit FastHasher(uint64_t seed = 0);
+
+  void Reset(uint64_t seed = 0);
+  void Update(const void* data, size_t len);
+
+  uint64_t Digest64() const;
+  Hash128 Digest128() const;
+
+ private:
+  enum { STRIPE_SIZE = 64, SECRET_SIZE = 192, BUFFER_SIZE = 256 };
+
+  void DigestLong(uint64_t acc[8]) const;
+
+  uint64_t acc_[8];
+  unsigned char secret_[SECRET_SIZE];
+  unsigned char buffer_[BUFFER_SIZE];
+  size_t buffered_size_;
+  size_t stripes_so_far_;
+  uint64_t total_len_;
+  uint64_t seed_;
+};
+
+}  // namespace hash
+}  // namespace common
@@ -30,7 +30,7 @@
 #pragma once
 
 #include <stddef.h>  // for size_t
-#include <stdint.h>  // for uint8_t, uint32_t
+#include <stdint.h>  // for uint8_t, uint32_t, uint64_t
 
 #define SHA1_HASH_LENGTH 20
 #define BLOCK_LENGTH 64
@@ -41,7 +41,7 @@ namespace hash {
 typedef struct SHA1_CTX {
   uint32_t buffer[BLOCK_LENGTH / 4];
   uint32_t state[SHA1_HASH_LENGTH / 4];
-  uint32_t byte_count;
+  uint64_t byte_count;
   uint8_t buffer_offset;
   uint8_t key_buffer[BLOCK_LENGTH];
   uint8_t inner_hash[SHA1_HASH_LENGTH];
@@ -53,5 +53,9 @@ void SHA1_Update(SHA1_CTX* s, const unsigned char* data, size_t len);
 
 void SHA1_Final(SHA1_CTX* s, unsigned char* result);
 
+// Hashes count independent messages into hashes (count * SHA1_HASH_LENGTH
+// bytes), on cpus without sha extensions eight of them go through avx2 at once.
+void SHA1_Multi(const unsigned char* const* data, const size_t* lens, size_t count, unsigned char* hashes);
+
 }  // namespace hash
 }  // namespace common
@@ -47,5 +47,9 @@ void SHA256_Init(SHA256_CTX* ctx);
 void SHA256_Update(SHA256_CTX* ctx, const unsigned char* data, size_t len);
 void SHA256_Final(SHA256_CTX* ctx, unsigned char* hash);
 
+// Hashes count independent messages into hashes (count * SHA256_HASH_LENGHT
+// bytes), on cpus without sha extensions eight of them go through avx2 at once.
+void SHA256_Multi(const unsigned char* const* data, const size_t* lens, size_t count, unsigned char* hashes);
+
 }  // namespace hash
 }  // namespace common
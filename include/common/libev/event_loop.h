@@ -29,7 +29,7 @@
 
 #pragma once
 
-#include <vector>
+#include <map>
 
 #include <common/threads/platform_thread.h>
 
@@ -39,6 +39,7 @@ struct ev_loop;
 struct ev_io;
 struct ev_timer;
 struct ev_async;
+struct ev_prepare;
 
 namespace common {
 namespace libev {
@@ -60,6 +61,7 @@ class LibEvLoop {
   typedef void async_callback_t(struct ev_loop* loop, struct ev_async* watcher, int revents);
   typedef void timer_callback_t(struct ev_loop* loop, struct ev_timer* watcher, int revents);
   typedef void child_callback_t(struct ev_loop* loop, fasto_ev_child* watcher, int revents);
+  typedef std::function<void()> prepare_callback_t;
 
   LibEvLoop();
   virtual ~LibEvLoop();
@@ -91,6 +93,10 @@ class LibEvLoop {
 
   void ExecInLoopThread(custom_loop_exec_function_t func);
 
+  // Runs |callback| every loop iteration right before the loop waits for
+  // events, an empty one removes it. Loop thread only.
+  void SetPrepareCallback(prepare_callback_t callback);
+
   int Exec() WARN_UNUSED_RESULT;
   void Stop();
 
@@ -106,6 +112,7 @@ class LibEvLoop {
 
   static void stop_cb(LibEvLoop* loop, LibevAsync* async, flags_t revents);
   static void timer_cb(LibEvLoop* loop, LibevTimer* timer, flags_t revents);
+  static void prepare_cb(struct ev_loop* loop, struct ev_prepare* watcher, int revents);
 
   void HandleStart();
   void HandleStop();
@@ -118,7 +125,9 @@ class LibEvLoop {
 
   AsyncCustom* async_custom_;
 
-  std::vector<LibevTimer*> timers_;
+  std::map<timer_id_t, LibevTimer*> timers_;
+  struct ev_prepare* prepare_;
+  prepare_callback_t prepare_callback_;
   bool is_running_;
 };
 
@@ -33,16 +33,23 @@
 
 #include <common/error.h>
 #include <common/libev/io_base.h>
+#include <common/libev/timer_wheel.h>
 #include <common/libev/types.h>
+#include <common/types.h>
 
 namespace common {
 namespace libev {
 
 class IoLoop;
+namespace uring {
+class UringBackend;
+class UringConnection;
+}  // namespace uring
 
 class IoClient : public IoBase<IoClient> {
  public:
   friend class IoLoop;
+  friend class uring::UringBackend;
   typedef IoBase<IoClient> base_class;
 
   explicit IoClient(IoLoop* server, flags_t flags = EV_READ);
@@ -57,6 +64,8 @@ class IoClient : public IoBase<IoClient> {
   size_t GetWroteBytes() const;
   size_t GetReadBytes() const;
 
+  time64_t GetIdleTimeout() const;  // see IoLoop::SetIdleTimeout
+
   const char* ClassName() const override;
 
   ErrnoError Write(const void* data, size_t size, size_t* nwrite_out) WARN_UNUSED_RESULT;
@@ -78,6 +87,11 @@ class IoClient : public IoBase<IoClient> {
   flags_t flags_;
   size_t wrote_bytes_;
   size_t read_bytes_;
+  TimerWheelNode idle_timer_;
+  time64_t idle_timeout_msec_;
+  IoClient* prev_client_;  // IoLoop client list
+  IoClient* next_client_;
+  uring::UringConnection* uring_;  // set while an io_uring loop does the I/O
   DISALLOW_COPY_AND_ASSIGN(IoClient);
 };
 
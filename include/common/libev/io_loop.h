@@ -29,24 +29,63 @@
 
 #pragma once
 
+#include <sys/types.h>  // for off_t
+
+#include <map>
+#include <string>
+#include <vector>
+
 #include <common/libev/event_loop.h>
 
 #include <common/libev/io_base.h>
 
+#include <common/net/dns_resolver.h>
+#include <common/net/socket_info.h>
+
 namespace common {
 namespace libev {
 
 class IoLoopObserver;
 class IoClient;
 class IoChild;
+class TimerWheel;
+class TimerWheelNode;
+namespace uring {
+class UringBackend;
+}
+
+namespace tcp {
+class TcpConnector;
+class FileTransfer;
+struct FileTransferOptions;
+}  // namespace tcp
 
 class IoLoop : public EvLoopObserver, public IoBase<IoLoop> {
  public:
+  typedef std::function<void(ErrnoError err, const net::socket_info& info)> connect_callback_t;
+  typedef std::function<void(size_t sent, size_t total)> send_file_progress_callback_t;
+  typedef std::function<void(ErrnoError err, size_t sent)> send_file_callback_t;
+
+  // Resolution of the client idle timeouts.
+  static const time64_t kIdleTickMsec = 10;
+
   explicit IoLoop(LibEvLoop* loop, IoLoopObserver* observer = nullptr);
   virtual ~IoLoop() override;
 
   bool IsRunning() const;
   int Exec() WARN_UNUSED_RESULT;
+
+  // Selects what does the socket I/O of the clients, before Exec only. With
+  // IO_BACKEND_URING connections are accepted, received and sent through
+  // io_uring, submitted in one batch per loop iteration: DataReceived still
+  // fires, but SingleRead serves data already received (EAGAIN when there is
+  // none), Read waits for the whole record as on a blocking socket, and
+  // SingleWrite queues data for the next batch. Clients other than
+  // stream sockets watched for EV_READ alone stay on libev, so do timers and
+  // children. ENOTSUP where io_uring is not built in, the setup error when
+  // the kernel refuses the ring.
+  ErrnoError SetBackend(IoBackend backend) WARN_UNUSED_RESULT;
+  IoBackend GetBackend() const;
   virtual void Stop();
 
   virtual bool IsCanBeRegistered(IoClient* client) const WARN_UNUSED_RESULT = 0;
@@ -55,6 +94,25 @@ class IoLoop : public EvLoopObserver, public IoBase<IoLoop> {
   void UnRegisterClient(IoClient* client);
   virtual void CloseClient(IoClient* client);
 
+  // Hands a live |client| over to |target| running in another thread: it is
+  // unregistered here (IoLoopObserver::Moved), then registered in the target
+  // loop thread (IoLoopObserver::Accepted there) with its byte counters and
+  // idle timeout. Fails with EBUSY while a SendFile runs on the client. A
+  // client the target refuses is closed and deleted there. With io_uring the
+  // hand-over waits until the pending receive is cancelled, a client that
+  // gets data meanwhile stays here; EBUSY while it has queued output.
+  ErrnoError MoveClient(IoClient* client, IoLoop* target) WARN_UNUSED_RESULT;
+
+  // Logs client (un)registrations at most once per |msec|, with the number
+  // of lines skipped meanwhile; 0 logs every one.
+  void SetClientLogInterval(time64_t msec);
+
+  // Reports |client| to IoLoopObserver::IdleTimeout once it has seen no read
+  // or write event for |msec|, every event restarts the clock; 0 disables.
+  // The timeout survives UnRegisterClient and rearms on RegisterClient. All
+  // clients share one timer wheel driven by a single libev timer.
+  void SetIdleTimeout(IoClient* client, time64_t msec);
+
   timer_id_t CreateTimer(double sec, bool repeat);
   void RemoveTimer(timer_id_t id);
 
@@ -68,14 +126,62 @@ class IoLoop : public EvLoopObserver, public IoBase<IoLoop> {
 
   bool IsLoopThread() const;
 
+  // Resolves |host| without blocking the loop, |callback| runs in the loop
+  // thread; it is dropped if the loop has stopped by the time the answer comes.
+  void ResolveHost(const net::HostAndPort& host, net::DnsResolver::resolve_callback_t callback);
+
+  // Opens a TCP connection to |host| without blocking the loop, see
+  // tcp::TcpConnector. |callback| runs in the loop thread, possibly before
+  // ConnectTo returns; it gets ECANCELED if the loop stops first. The socket
+  // is not registered, wrap it into a client and call RegisterClient.
+  connect_id_t ConnectTo(const net::HostAndPort& host, double timeout_sec, connect_callback_t callback);
+  // Drops a pending connect without calling its callback.
+  void CancelConnect(connect_id_t id);
+
+  // Streams |size| bytes of |fd| from |offset| into |client| without blocking
+  // the loop, see tcp::FileTransfer. Callbacks run in the loop thread, never
+  // before SendFile returns. A client runs one transfer at a time, closing or
+  // unregistering it fails the transfer with ECANCELED. |fd| stays owned by
+  // the caller. EBUSY while io_uring still sends earlier output.
+  ErrnoError SendFile(IoClient* client,
+                      descriptor_t fd,
+                      off_t offset,
+                      size_t size,
+                      const tcp::FileTransferOptions& options,
+                      send_file_progress_callback_t progress,
+                      send_file_callback_t callback,
+                      transfer_id_t* id = nullptr) WARN_UNUSED_RESULT;
+  // Drops a running transfer without calling its callback.
+  void CancelSendFile(transfer_id_t id);
+
+  // Copy of the registered clients, safe to close them while iterating.
   std::vector<IoClient*> GetClients() const;
+  size_t GetClientsCount() const;
+  // Visits the registered clients in registration order without copying;
+  // |visitor| may close or unregister the client it gets, but no other one.
+  void ForEachClient(std::function<void(IoClient*)> visitor) const;
+
+  IoLoopStatistics GetStatistics() const;
+  // Reports GetStatistics() to IoLoopObserver::StatisticsUpdated every
+  // |msec|, 0 stops it. Applied in the loop thread, also before Exec.
+  void SetStatisticsInterval(time64_t msec);
   std::vector<IoChild*> GetChilds() const;
 
   static IoLoop* FindExistLoopByPredicate(std::function<bool(IoLoop*)> pred);
+  // Posts |func| to the running loop with |id| while it is still registered,
+  // so it can't be destroyed in between; false if there is no such loop.
+  static bool PostToExistLoop(id_t::type_t id, custom_loop_exec_function_t func);
 
  protected:
+  typedef std::function<void(ErrnoError err, descriptor_t fd)> accept_callback_t;
+
   virtual IoChild* CreateChild() = 0;
 
+  // Accepts connections on |listen_fd| through the backend, multishot with
+  // io_uring; ENOTSUP with libev, where the caller watches the socket.
+  ErrnoError StartAccept(descriptor_t listen_fd, bool nonblocking, accept_callback_t callback) WARN_UNUSED_RESULT;
+  void StopAccept();
+
   virtual void PreLooped(LibEvLoop* loop) override;
   virtual void Started(LibEvLoop* loop) override;
   virtual void Stopped(LibEvLoop* loop) override;
@@ -91,10 +197,53 @@ class IoLoop : public EvLoopObserver, public IoBase<IoLoop> {
   static void child_cb(LibEvLoop* loop, LibevChild* child, int status, int signal, flags_t revents);
   void ChildStatus(LibEvLoop* loop, IoChild* child, int status, int signal, flags_t revents);
 
+  bool ShouldLogClientChange(size_t* suppressed);
+
+  bool StartClientIO(IoClient* client);
+  void StopClientIO(IoClient* client);
+  void HandOver(IoClient* client, IoLoop* target);
+
+  void LinkClient(IoClient* client);
+  bool UnlinkClient(IoClient* client);
+  void UpdateStatistics();
+
+  void TouchClient(IoClient* client);
+  void IdleTimeoutExpired(TimerWheelNode* node);
+  uint64_t GetIdleTick(time64_t msec) const;
+
+  void FinishConnect(connect_id_t id);
+  void FinishSendFile(transfer_id_t id);
+  void FailClientTransfers(IoClient* client);
+  void ArmReapTimer();
+  void ReapFinished();
+
   IoLoopObserver* const observer_;
+  uring::UringBackend* uring_;
 
-  std::vector<IoClient*> clients_;
+  IoClient* first_client_;
+  IoClient* last_client_;
+  size_t clients_count_;
   std::vector<IoChild*> childs_;
+  std::map<connect_id_t, tcp::TcpConnector*> connectors_;
+  std::vector<tcp::TcpConnector*> finished_connectors_;
+  std::map<transfer_id_t, tcp::FileTransfer*> transfers_;
+  std::vector<tcp::FileTransfer*> finished_transfers_;
+  LibevTimer* reap_timer_;
+  TimerWheel* idle_wheel_;
+  LibevTimer* idle_timer_;
+  bool idle_timer_active_;
+  const time64_t idle_origin_msec_;
+  IoLoopStatistics stats_;
+  LibevTimer* stats_timer_;
+  time64_t stats_interval_msec_;
+  time64_t stats_last_msec_;
+  size_t stats_last_accepted_;
+  size_t stats_last_closed_;
+  connect_id_t last_connect_id_;
+  transfer_id_t last_transfer_id_;
+  time64_t client_log_interval_msec_;
+  time64_t next_client_log_msec_;
+  size_t suppressed_client_logs_;
   const patterns::id_counter<IoLoop> id_;
 
   std::string name_;
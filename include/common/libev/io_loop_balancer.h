@@ -0,0 +1,84 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <common/libev/types.h>
+
+namespace common {
+namespace libev {
+
+class IoLoop;
+class IoClient;
+
+struct IoLoopBalancerOptions {
+  IoLoopBalancerOptions();
+
+  // Clients move once the busiest loop carries this many times the average
+  // traffic.
+  double max_imbalance;
+  // Upper bound of moves per Rebalance.
+  size_t max_moves;
+};
+
+// Spreads traffic over a set of running loops: every Rebalance samples how
+// many bytes each client read and wrote since the previous call and moves the
+// clients which fit into the gap from the busiest loop to the idlest one, see
+// IoLoop::MoveClient. A single client hotter than the gap stays, moving it
+// would only move the hot spot. Call it periodically from a thread which runs
+// none of the loops, it waits for each of them.
+class IoLoopBalancer {
+ public:
+  explicit IoLoopBalancer(const std::vector<IoLoop*>& loops,
+                          const IoLoopBalancerOptions& options = IoLoopBalancerOptions());
+
+  // Returns how many clients were moved.
+  size_t Rebalance();
+
+ private:
+  struct ClientLoad {
+    IoClient* client;
+    size_t bytes;
+  };
+  typedef std::vector<ClientLoad> loads_t;
+
+  std::vector<loads_t> Sample();
+  bool Move(size_t from, IoClient* client, size_t to);
+
+  const std::vector<IoLoop*> loops_;
+  const IoLoopBalancerOptions options_;
+  std::map<IoClient*, size_t> last_bytes_;
+  DISALLOW_COPY_AND_ASSIGN(IoLoopBalancer);
+};
+
+}  // namespace libev
+}  // namespace common
@@ -52,6 +52,12 @@ class IoLoopObserver {
 
   virtual void DataReceived(IoClient* client) = 0;
   virtual void DataReadyToWrite(IoClient* client) = 0;
+  // |client| saw no events for its IoLoop::SetIdleTimeout period, call it
+  // again to keep waiting. Does nothing by default.
+  virtual void IdleTimeout(IoClient* client);
+  // Periodic counters, see IoLoop::SetStatisticsInterval. Does nothing by
+  // default.
+  virtual void StatisticsUpdated(IoLoop* server, const IoLoopStatistics& stats);
 
   virtual void PostLooped(IoLoop* server) = 0;
 
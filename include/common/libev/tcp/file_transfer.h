@@ -0,0 +1,132 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <unistd.h>  // for off_t
+
+#include <functional>
+
+#include <common/error.h>
+#include <common/libev/types.h>
+#include <common/net/file_sender.h>
+#include <common/types.h>
+
+namespace common {
+namespace libev {
+namespace tcp {
+
+struct FileTransferOptions {
+  enum : size_t { kDefaultChunkSize = 256 * 1024 };
+
+  FileTransferOptions();
+
+  size_t chunk_size;  // max bytes sent per write readiness event
+  size_t rate_limit;  // bytes per second, 0 means unlimited
+  size_t burst;       // bytes the rate limiter lets through at once, 0 means one chunk
+};
+
+// Token bucket: refills |rate| tokens per second up to |capacity|, starts
+// full. A zero rate never limits.
+class TokenBucket {
+ public:
+  TokenBucket(size_t rate, size_t capacity);
+
+  bool IsUnlimited() const;
+  size_t GetAvailable(time64_t now_msec);
+  void Consume(size_t count);
+  // Time until |count| tokens (clamped to the capacity) are available.
+  time64_t GetWaitMsec(size_t count, time64_t now_msec);
+
+ private:
+  void Refill(time64_t now_msec);
+
+  const size_t rate_;
+  const size_t capacity_;
+  double tokens_;
+  time64_t last_refill_msec_;
+};
+
+// Streams a file into a client socket without blocking the loop: one
+// chunk per EV_WRITE so clients sharing a loop take turns, pauses on a
+// timer when over the rate limit. The socket is non-blocking while the
+// transfer runs and blocking again when it ends. Used through
+// IoLoop::SendFile, must live in the loop thread.
+class FileTransfer {
+ public:
+  typedef std::function<void(size_t sent, size_t total)> progress_callback_t;
+  typedef std::function<void(ErrnoError err, size_t sent)> done_callback_t;
+
+  FileTransfer(LibEvLoop* loop,
+               descriptor_t sock,
+               descriptor_t fd,
+               off_t offset,
+               size_t size,
+               const FileTransferOptions& options,
+               progress_callback_t progress,
+               done_callback_t done);
+  // Stops the watchers without calling back.
+  ~FileTransfer();
+
+  ErrnoError Start() WARN_UNUSED_RESULT;
+  void Fail(ErrnoError err);
+  void Cancel();
+
+  bool IsFinished() const;
+  descriptor_t GetSocket() const;
+  size_t GetSent() const;
+  // Next byte of the file to send, resume an interrupted transfer from here.
+  off_t GetOffset() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FileTransfer);
+
+  void Step();
+  void WaitFor(descriptor_t fd, flags_t events);
+  void Pause(time64_t msec);
+  void Finish(ErrnoError err);
+  void StopAll();
+
+  LibEvLoop* const loop_;
+  const descriptor_t sock_;
+  const size_t chunk_size_;
+  net::FileSender sender_;
+  TokenBucket bucket_;
+  progress_callback_t progress_;
+  done_callback_t done_;
+  LibevIO* io_;
+  LibevTimer* pause_timer_;
+  descriptor_t wait_fd_;
+  bool was_blocking_;  // mode of the socket before Start, restored when the transfer ends
+  bool finished_;
+};
+
+}  // namespace tcp
+}  // namespace libev
+}  // namespace common
@@ -0,0 +1,113 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <common/libev/io_loop.h>
+#include <common/net/socket_info.h>
+#include <common/net/types.h>
+#include <common/types.h>
+
+namespace common {
+namespace libev {
+namespace tcp {
+
+struct TcpConnectionPoolOptions {
+  enum : size_t { kDefaultMaxPerHost = 8 };
+  enum : time64_t { kDefaultIdleTimeoutMsec = 30 * 1000 };
+
+  TcpConnectionPoolOptions();
+
+  size_t max_per_host;  // borrowed, connecting and idle connections together
+  time64_t idle_timeout_msec;
+  double connect_timeout_sec;
+};
+
+// Keep-alive connections per HostAndPort for one IoLoop, used from its thread
+// only. Borrowed sockets are plain socket_info: wrap them into a client (e.g.
+// http::HttpClient) for the exchange, then UnRegisterClient/delete the client
+// and hand the socket back with Release instead of closing it.
+class TcpConnectionPool {
+ public:
+  typedef IoLoop::connect_callback_t acquire_callback_t;
+
+  explicit TcpConnectionPool(IoLoop* loop, const TcpConnectionPoolOptions& options = TcpConnectionPoolOptions());
+  // Closes idle connections, pending Acquire callbacks are dropped.
+  ~TcpConnectionPool();
+
+  // Hands out an idle connection or opens a new one, |callback| may run before
+  // Acquire returns. When |host| is at max_per_host it waits for a Release.
+  void Acquire(const net::HostAndPort& host, acquire_callback_t callback);
+  // Gives back a borrowed connection; not |reusable| ones (no keep-alive,
+  // broken exchange) are closed.
+  void Release(const net::HostAndPort& host, const net::socket_info& info, bool reusable);
+
+  // Closes idle connections past the idle timeout or closed by the peer and
+  // returns how many; Acquire does this per host, call it from a timer to
+  // bound idle sockets of hosts no longer used.
+  size_t EvictIdle();
+
+  size_t GetIdleCount(const net::HostAndPort& host) const;
+  size_t GetBusyCount(const net::HostAndPort& host) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TcpConnectionPool);
+
+  struct IdleConnection {
+    net::socket_info info;
+    time64_t since_msec;
+  };
+
+  struct HostConnections {
+    HostConnections();
+
+    std::vector<IdleConnection> idle;  // most recently used last
+    size_t busy;
+    std::deque<acquire_callback_t> waiters;
+  };
+
+  size_t EvictIdle(HostConnections* connections, time64_t now);
+  void Connect(const net::HostAndPort& host, acquire_callback_t callback);
+  void Connected(const net::HostAndPort& host, acquire_callback_t callback, ErrnoError err, const net::socket_info& info);
+  void SlotFreed(const net::HostAndPort& host);
+
+  IoLoop* const loop_;
+  const TcpConnectionPoolOptions options_;
+  std::unordered_map<net::HostAndPort, HostConnections> hosts_;
+  std::shared_ptr<bool> alive_;
+};
+
+}  // namespace tcp
+}  // namespace libev
+}  // namespace common
@@ -0,0 +1,102 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <common/error.h>
+#include <common/libev/types.h>
+#include <common/types.h>
+#include <common/net/ip_address.h>
+#include <common/net/socket_info.h>
+#include <common/net/types.h>
+
+namespace common {
+namespace libev {
+namespace tcp {
+
+// One outbound connection made without blocking the loop: non-blocking
+// connects completed on EV_WRITE, racing the host addresses RFC 8305 style.
+// A new attempt starts every attempt delay or as soon as the previous one
+// fails, the first socket to connect wins and the others get closed. Used
+// through IoLoop::ConnectTo, must live in the loop thread.
+class TcpConnector {
+ public:
+  typedef std::function<void(ErrnoError err, const net::socket_info& info)> connect_callback_t;
+  enum : time64_t { kDefaultAttemptDelayMsec = 250 };  // RFC 8305, section 5
+
+  TcpConnector(LibEvLoop* loop,
+               const net::HostAndPort& host,
+               double timeout_sec,
+               connect_callback_t callback,
+               time64_t attempt_delay_msec = kDefaultAttemptDelayMsec);
+  // Pending sockets are closed without calling back.
+  ~TcpConnector();
+
+  // Races |addresses|, the callback gets the winning socket in blocking mode.
+  void Start(const net::IPAddressList& addresses);
+  void Fail(ErrnoError err);
+  void Cancel();
+
+  bool IsFinished() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TcpConnector);
+
+  struct Attempt {
+    net::socket_info info;
+    LibevIO* io;
+  };
+
+  void StartNextAttempt();
+  void AttemptReady(LibevIO* io);
+  void RetireAttempt(size_t index, bool close_socket);
+  void ArmDelayTimer();
+  void Finish(ErrnoError err, const net::socket_info& info);
+  void StopAll();
+
+  LibEvLoop* const loop_;
+  const net::HostAndPort host_;
+  const time64_t attempt_delay_msec_;
+  connect_callback_t callback_;
+  net::IPAddressList addresses_;
+  size_t next_address_;
+  std::vector<Attempt> attempts_;
+  std::vector<LibevIO*> retired_;
+  LibevTimer* delay_timer_;
+  LibevTimer* timeout_timer_;
+  ErrnoError last_error_;
+  bool finished_;
+};
+
+}  // namespace tcp
+}  // namespace libev
+}  // namespace common
@@ -31,12 +31,25 @@
 
 #include <common/libev/io_loop.h>         // for IoLoop
 #include <common/libev/tcp/tcp_client.h>  // for TcpClient
+#include <common/net/socket_options.h>
 #include <common/net/socket_tcp.h>
 
 namespace common {
 namespace libev {
 namespace tcp {
 
+struct TcpAcceptOptions {
+  enum : size_t { kDefaultBatchSize = 64 };
+  enum : time64_t { kDefaultLogIntervalMsec = 1000 };
+
+  TcpAcceptOptions();
+
+  size_t batch_size;  // connections accepted per readiness event
+  bool nonblocking;   // clients get non-blocking sockets
+  net::TcpSocketOptions socket_options;
+  time64_t log_interval_msec;  // see IoLoop::SetClientLogInterval
+};
+
 class TcpServer : public IoLoop {
  public:
   typedef IoLoop base_class;
@@ -46,6 +59,9 @@ class TcpServer : public IoLoop {
   ErrnoError Bind(bool reuseaddr) WARN_UNUSED_RESULT;
   ErrnoError Listen(int backlog) WARN_UNUSED_RESULT;
 
+  void SetAcceptOptions(const TcpAcceptOptions& options);
+  TcpAcceptOptions GetAcceptOptions() const;
+
   const char* ClassName() const override;
   net::HostAndPort GetHost() const;
 
@@ -66,10 +82,13 @@ class TcpServer : public IoLoop {
 
   static void accept_cb(LibEvLoop* loop, LibevIO* io, int revents);
 
-  ErrnoError Accept(net::socket_info* info) WARN_UNUSED_RESULT;
+  ErrnoError Accept(const net::socket_info& listen_info, net::socket_info* info) WARN_UNUSED_RESULT;
+  void Accepted(ErrnoError err, descriptor_t fd);
+  void ApplySocketOptions(const net::socket_info& info);
 
   net::ServerSocketTcp sock_;
   LibevIO* accept_io_;
+  TcpAcceptOptions accept_options_;
 };
 
 }  // namespace tcp
@@ -0,0 +1,127 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#include <common/macros.h>
+
+namespace common {
+namespace libev {
+
+class TimerWheel;
+
+// Intrusive timer, embed it into the object it times out. A node is
+// scheduled in at most one wheel and unlinks itself when destroyed.
+class TimerWheelNode {
+ public:
+  typedef void* user_data_t;
+
+  TimerWheelNode();
+  ~TimerWheelNode();
+
+  bool IsScheduled() const;
+  uint64_t GetExpires() const;
+
+  void SetUserData(user_data_t user_data);
+  user_data_t GetUserData() const;
+
+ private:
+  friend class TimerWheel;
+
+  TimerWheelNode* prev_;
+  TimerWheelNode* next_;
+  TimerWheel* wheel_;
+  uint64_t expires_;
+  user_data_t user_data_;
+  DISALLOW_COPY_AND_ASSIGN(TimerWheelNode);
+};
+
+// Hashed hierarchical timer wheel (Varghese & Lauck) counting abstract ticks:
+// 256 slots for the next ticks plus three levels of 64 slots which cascade
+// down as time passes. Schedule, reschedule and cancel are O(1), expiring a
+// tick costs the timers in its slot plus an occasional cascade. Deadlines
+// further than kMaxTicks away are clamped. Not thread safe.
+class TimerWheel {
+ public:
+  typedef std::function<void(TimerWheelNode* node)> expire_callback_t;
+
+  enum {
+    kRootBits = 8,
+    kLevelBits = 6,
+    kLevels = 3,
+    kRootSize = 1 << kRootBits,
+    kLevelSize = 1 << kLevelBits
+  };
+  static const uint64_t kMaxTicks = (UINT64_C(1) << (kRootBits + kLevels * kLevelBits)) - 1;
+
+  // |callback| runs for every expired node, the node is already unscheduled
+  // so the callback may reschedule or destroy it.
+  explicit TimerWheel(expire_callback_t callback, uint64_t current_tick = 0);
+  ~TimerWheel();
+
+  // Fires |node| on the first AdvanceTo() reaching |tick|; a deadline which
+  // already passed fires on the next one. Reschedules a scheduled node.
+  void ScheduleAt(TimerWheelNode* node, uint64_t tick);
+  // Same as ScheduleAt(node, GetCurrentTick() + ticks).
+  void Schedule(TimerWheelNode* node, uint64_t ticks);
+  void Cancel(TimerWheelNode* node);
+
+  // Processes every tick up to and including |tick|, returns how many nodes
+  // expired. An empty wheel jumps forward in O(1).
+  size_t AdvanceTo(uint64_t tick);
+
+  uint64_t GetCurrentTick() const;
+  size_t GetSize() const;
+  bool IsEmpty() const;
+
+ private:
+  void Place(TimerWheelNode* node);
+  bool Cascade(size_t level);
+  size_t RunTick();
+
+  static void InitHead(TimerWheelNode* head);
+  static void Link(TimerWheelNode* head, TimerWheelNode* node);
+  static void Unlink(TimerWheelNode* node);
+  static void Splice(TimerWheelNode* from, TimerWheelNode* to);
+
+  const expire_callback_t callback_;
+  uint64_t next_tick_;
+  size_t size_;
+  TimerWheelNode root_[kRootSize];
+  TimerWheelNode levels_[kLevels][kLevelSize];
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace libev
+}  // namespace common
@@ -29,6 +29,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include <functional>  // for function
 
 #include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
@@ -93,6 +95,8 @@ typedef int flags_t;
 
 typedef intmax_t timer_id_t;
 typedef uintmax_t io_id_t;
+typedef uintmax_t connect_id_t;
+typedef uintmax_t transfer_id_t;
 typedef uintmax_t async_id_t;
 typedef uintmax_t child_id_t;
 
@@ -122,6 +126,23 @@ class LibevBase : public patterns::id_counter<LibevBase<handle_t, id_t>, id_t> {
   DISALLOW_COPY_AND_ASSIGN(LibevBase);
 };
 
+// Where an IoLoop does the socket I/O of its clients, see IoLoop::SetBackend.
+enum IoBackend {
+  IO_BACKEND_LIBEV = 0,  // readiness callbacks, clients read and write themselves
+  IO_BACKEND_URING = 1   // io_uring completions, Linux only
+};
+
+// Counters of an IoLoop, rates cover the last statistics interval.
+struct IoLoopStatistics {
+  IoLoopStatistics();
+
+  size_t clients;   // registered right now
+  size_t accepted;  // registrations since the loop was created
+  size_t closed;    // closed clients since the loop was created
+  double accepts_per_sec;
+  double closes_per_sec;
+};
+
 typedef std::function<void()> custom_loop_exec_function_t;
 
 typedef std::function<void(LibEvLoop* loop, LibevAsync* async, flags_t revents)> async_loop_exec_function_t;
@@ -0,0 +1,123 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <vector>
+
+#include <common/error.h>
+#include <common/net/socket_info.h>
+
+namespace common {
+namespace net {
+
+// Preallocated datagrams for sendmmsg/recvmmsg: |capacity| slots of up to
+// |datagram_size| bytes each, with their peer addresses. Nothing is allocated
+// per packet. A slot may carry a GSO/GRO super-datagram split into
+// |segment_size| pieces by the kernel, size such batches for 64 KiB slots.
+class DatagramBatch {
+ public:
+  enum : size_t { kMaxDatagramSize = 65535 };
+
+  DatagramBatch(size_t capacity, size_t datagram_size);
+  ~DatagramBatch();
+
+  size_t GetCapacity() const;
+  size_t GetDatagramSize() const;
+  // Datagrams queued or received.
+  size_t GetCount() const;
+  // Queued datagrams sendmmsg already handed to the kernel.
+  size_t GetSent() const;
+  bool IsFull() const;
+  void Clear();
+
+  // Copies a datagram into the next free slot, |addr| may be null on a
+  // connected socket. A non-zero |segment_size| asks the kernel to send the
+  // payload as datagrams of that size (UDP GSO). False when full or too big.
+  bool Push(const void* data,
+            size_t size,
+            const struct sockaddr* addr = nullptr,
+            socklen_t addr_len = 0,
+            uint16_t segment_size = 0);
+
+  const char* GetData(size_t index) const;
+  size_t GetSize(size_t index) const;
+  const struct sockaddr* GetAddress(size_t index) const;
+  socklen_t GetAddressLength(size_t index) const;
+  // Size of the datagrams the kernel coalesced into this slot (UDP GRO), 0
+  // when it holds a single datagram.
+  uint16_t GetSegmentSize(size_t index) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DatagramBatch);
+
+  friend ErrnoError sendmmsg(socket_descr_t fd, DatagramBatch* batch, size_t* nsent_out);
+  friend ErrnoError recvmmsg(socket_descr_t fd, DatagramBatch* batch, size_t* nread_out);
+
+  struct Message {
+    struct msghdr hdr;
+    unsigned int len;  // same layout as struct mmsghdr
+  };
+
+  void ResetSlot(size_t index, size_t size);
+  void SetSegmentSize(size_t index, uint16_t segment_size);
+  void ParseReceived(size_t index);
+
+  const size_t capacity_;
+  const size_t datagram_size_;
+  std::vector<char> buffer_;
+  std::vector<char> control_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct sockaddr_storage> addresses_;
+  std::vector<Message> messages_;
+  std::vector<uint16_t> segment_sizes_;
+  size_t count_;
+  size_t sent_;
+};
+
+// Sends the queued datagrams not sent yet in as few syscalls as possible
+// (one sendmmsg on Linux). |*nsent_out| counts datagrams sent by this call;
+// EAGAIN only when none could be, call again on write readiness.
+ErrnoError sendmmsg(socket_descr_t fd, DatagramBatch* batch, size_t* nsent_out) WARN_UNUSED_RESULT;
+// Clears |batch| and receives up to its capacity: waits for the first
+// datagram on a blocking socket, never for the rest.
+ErrnoError recvmmsg(socket_descr_t fd, DatagramBatch* batch, size_t* nread_out) WARN_UNUSED_RESULT;
+
+// Lets the kernel coalesce incoming datagrams of a flow (UDP GRO), see
+// DatagramBatch::GetSegmentSize. ENOTSUP where unavailable.
+ErrnoError set_udp_gro(socket_descr_t fd, bool enable) WARN_UNUSED_RESULT;
+// Splits every send on |fd| into |segment_size| datagrams (UDP GSO), 0
+// turns it off. ENOTSUP where unavailable.
+ErrnoError set_udp_segment_size(socket_descr_t fd, uint16_t segment_size) WARN_UNUSED_RESULT;
+
+}  // namespace net
+}  // namespace common
@@ -0,0 +1,131 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/error.h>
+#include <common/net/ip_address.h>
+#include <common/net/types.h>
+#include <common/threads/thread_pool.h>
+#include <common/types.h>
+
+namespace common {
+namespace net {
+
+struct DnsResolverOptions {
+  enum : size_t { kDefaultWorkers = 2, kDefaultMaxEntries = 1024 };
+  enum : time64_t { kDefaultPositiveTtlMsec = 60 * 1000, kDefaultNegativeTtlMsec = 5 * 1000 };
+
+  DnsResolverOptions();
+
+  size_t workers;
+  // Used when the lookup function doesn't report a ttl, getaddrinfo never does.
+  time64_t positive_ttl_msec;
+  time64_t negative_ttl_msec;
+  size_t max_entries;
+};
+
+// Resolves host names on a small pool of worker threads so event loops never
+// block in getaddrinfo. Answers (and failures) are cached per host until their
+// ttl expires, and concurrent lookups of the same host share one query.
+class DnsResolver {
+ public:
+  typedef std::function<void(ErrnoError err, const IPAddressList& addresses)> resolve_callback_t;
+  typedef std::function<void()> task_t;
+  // Runs |task| in the context the caller wants its callback in, e.g.
+  // IoLoop::ExecInLoopThread. A null executor runs the callback in the
+  // resolving thread (the caller's own on a cache hit).
+  typedef std::function<void(task_t task)> executor_t;
+  // Blocking lookup of |host|, may set |ttl_msec| to override the default ttl.
+  typedef std::function<ErrnoError(const std::string& host, IPAddressList* out, time64_t* ttl_msec)>
+      lookup_function_t;
+
+  explicit DnsResolver(const DnsResolverOptions& options = DnsResolverOptions());
+  ~DnsResolver();
+
+  // |callback| gets called exactly once; IP literals and cache hits are
+  // answered without a lookup, possibly before Resolve returns.
+  void Resolve(const std::string& host, executor_t executor, resolve_callback_t callback);
+  void Resolve(const HostAndPort& host, executor_t executor, resolve_callback_t callback);
+
+  // Cached lookup in the caller's thread.
+  ErrnoError ResolveSync(const std::string& host, IPAddressList* out) WARN_UNUSED_RESULT;
+
+  // Replaces the system resolver, e.g. with a stub in tests; null restores it.
+  void SetLookupFunction(lookup_function_t lookup);
+  void ClearCache();
+  size_t GetCacheSize() const;
+
+  static DnsResolver* GetInstance();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DnsResolver);
+
+  struct Waiter {
+    executor_t executor;
+    resolve_callback_t callback;
+  };
+  typedef std::vector<Waiter> waiters_t;
+
+  struct Entry {
+    ErrnoError err;
+    IPAddressList addresses;
+    time64_t expires_msec;
+  };
+
+  bool FindCachedLocked(const std::string& key, time64_t now, ErrnoError* err, IPAddressList* out) const;
+  void StoreLocked(const std::string& key, ErrnoError err, const IPAddressList& addresses, time64_t ttl_msec);
+  ErrnoError DoLookup(const std::string& key, IPAddressList* out);
+  void RunLookup(const std::string& key);
+
+  static void Deliver(const Waiter& waiter, ErrnoError err, const IPAddressList& addresses);
+
+  const DnsResolverOptions options_;
+  lookup_function_t lookup_;
+  std::unordered_map<std::string, Entry> cache_;
+  std::unordered_map<std::string, waiters_t> pending_;
+  mutable std::mutex mutex_;
+  threads::ThreadPool workers_;
+};
+
+// Orders resolved addresses for connection racing (RFC 8305, section 4):
+// families alternate, starting with the family of the first address.
+IPAddressList InterleaveAddressFamilies(const IPAddressList& addresses);
+
+// getaddrinfo based lookup, the default lookup function.
+ErrnoError SystemLookup(const std::string& host, IPAddressList* out, time64_t* ttl_msec) WARN_UNUSED_RESULT;
+
+}  // namespace net
+}  // namespace common
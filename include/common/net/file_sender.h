@@ -0,0 +1,84 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <unistd.h>  // for off_t
+
+#include <common/error.h>
+#include <common/net/socket_info.h>
+
+namespace common {
+namespace net {
+
+// Resumable copy of a descriptor into a socket, one step per call so it can be
+// driven by write readiness. Regular files go through sendfile from the
+// tracked offset; other descriptors (pipes, sockets, devices) are spliced
+// through an intermediate kernel pipe on Linux, nothing is copied to user
+// space in either case. Elsewhere regular files are read and sent through a
+// small buffer and other sources give ENOTSUP.
+class FileSender {
+ public:
+  // |fd| stays owned by the caller, |offset| is ignored for non-seekable ones.
+  FileSender(descriptor_t fd, off_t offset, size_t size);
+  ~FileSender();
+
+  // Moves up to |max_size| bytes into |sock|. Doesn't block on a non-blocking
+  // socket: a full socket gives EAGAIN with nothing sent. |*nsent_out| is 0
+  // once the source hit EOF before |size| bytes.
+  ErrnoError SendTo(socket_descr_t sock, size_t max_size, size_t* nsent_out) WARN_UNUSED_RESULT;
+
+  descriptor_t GetSource() const;
+  bool IsDone() const;
+  // The last SendTo moved nothing because a non-regular source had no data,
+  // wait for it to become readable rather than for the socket.
+  bool IsWaitingForSource() const;
+  size_t GetSent() const;
+  size_t GetSize() const;
+  // Next byte of the source to send, resume a broken transfer from here.
+  off_t GetOffset() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FileSender);
+
+  ErrnoError SpliceTo(socket_descr_t sock, size_t max_size, size_t* nsent_out);
+
+  const descriptor_t fd_;
+  const size_t size_;
+  off_t offset_;
+  size_t sent_;
+  bool regular_;
+  bool eof_;
+  bool waiting_source_;
+  descriptor_t pipe_[2];
+  size_t piped_;  // bytes waiting in |pipe_|
+};
+
+}  // namespace net
+}  // namespace common
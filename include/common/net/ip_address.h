@@ -36,6 +36,7 @@
 #include <string>
 #include <vector>
 
+#include <common/hash/fast_hash.h>
 #include <common/string_piece.h>
 
 namespace common {
@@ -311,3 +312,15 @@ bool IPAddressStartsWith(const IPAddress& address, const uint8_t (&prefix)[N]) {
 
 }  // namespace net
 }  // namespace common
+
+namespace std {
+
+template <>
+struct hash<common::net::IPAddress> {
+  size_t operator()(const common::net::IPAddress& address) const {
+    const common::net::IPAddressBytes& bytes = address.bytes();
+    return static_cast<size_t>(common::hash::FastHash64(bytes.data(), bytes.size()));
+  }
+};
+
+}  // namespace std
@@ -34,6 +34,7 @@
 #include <string>
 
 #include <common/error.h>  // for ErrnoError
+#include <common/net/ip_address.h>
 #include <common/net/socket_info.h>
 #include <common/net/types.h>
 
@@ -46,18 +47,36 @@ ErrnoError getsockname(socket_descr_t fd, const addrinfo* ainf, socket_info* out
 ErrnoError get_in_port(const addrinfo* ainf, uint16_t* out);
 ErrnoError get_in_addr(const addrinfo* ainf, std::string* out);
 ErrnoError listen(const socket_info& info, int backlog) WARN_UNUSED_RESULT;
+// Close-on-exec accepted socket, blocking mode as the platform's accept gives it.
 ErrnoError accept(const socket_info& info, socket_info* out_info) WARN_UNUSED_RESULT;
+// Close-on-exec, optionally non-blocking accepted socket, with accept4 where
+// the platform has it.
+ErrnoError accept(const socket_info& info, bool nonblocking, socket_info* out_info) WARN_UNUSED_RESULT;
+// Same |out_info| as accept gives for |fd|, taken from |info| by other means
+// (e.g. io_uring); the peer address comes from getpeername.
+ErrnoError accepted(const socket_info& info, socket_descr_t fd, socket_info* out_info) WARN_UNUSED_RESULT;
 
 ErrnoError resolve(const HostAndPort& to, socket_t socktype, socket_info* out_info) WARN_UNUSED_RESULT;
 ErrnoError connect(const HostAndPort& to, socket_t socktype, struct timeval* timeout, socket_info* out_info)
     WARN_UNUSED_RESULT;
 ErrnoError connect(const socket_info& info, struct timeval* timeout, socket_info* out_info) WARN_UNUSED_RESULT;
 
+// Starts connecting a non-blocking socket to |address|:|port|. When
+// |*in_progress| is set, wait until the socket is writable and then check
+// get_connect_result. The socket stays in non-blocking mode.
+ErrnoError connect_nonblock(const IPAddress& address,
+                            uint16_t port,
+                            socket_t socktype,
+                            socket_info* out_info,
+                            bool* in_progress) WARN_UNUSED_RESULT;
+ErrnoError get_connect_result(socket_descr_t fd) WARN_UNUSED_RESULT;
+
 ErrnoError close(socket_descr_t fd) WARN_UNUSED_RESULT;
 
 ErrnoError set_blocking_socket(socket_descr_t sock, bool blocking) WARN_UNUSED_RESULT;
 
 #if defined(OS_POSIX)
+ErrnoError is_blocking_socket(socket_descr_t sock, bool* blocking) WARN_UNUSED_RESULT;
 ErrnoError write_ev_to_socket(socket_descr_t fd, const struct iovec* iovec, int count, size_t* nwritten_out);
 ErrnoError read_ev_to_socket(socket_descr_t fd, const struct iovec* iovec, int count, size_t* nread_out);
 ErrnoError write_to_socket(socket_descr_t fd, const void* data, size_t size, size_t* nwritten_out) WARN_UNUSED_RESULT;
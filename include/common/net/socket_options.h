@@ -0,0 +1,56 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <common/error.h>
+#include <common/net/socket_info.h>
+
+namespace common {
+namespace net {
+
+// Per-connection TCP tuning applied right after accept or connect. Zero
+// values keep the system defaults.
+struct TcpSocketOptions {
+  TcpSocketOptions();
+
+  bool no_delay;                // TCP_NODELAY
+  bool keep_alive;              // SO_KEEPALIVE
+  int keep_alive_idle_sec;      // idle time before the first probe
+  int keep_alive_interval_sec;  // between probes
+  int keep_alive_count;         // unanswered probes before the connection drops
+  int send_buffer_size;         // SO_SNDBUF
+  int receive_buffer_size;      // SO_RCVBUF
+};
+
+// Keepalive timing options the platform lacks are skipped.
+ErrnoError apply_tcp_socket_options(socket_descr_t fd, const TcpSocketOptions& options) WARN_UNUSED_RESULT;
+
+}  // namespace net
+}  // namespace common
@@ -60,6 +60,8 @@ class HostAndPort {
   port_t GetPort() const;
   void SetPort(port_t port);
 
+  size_t Hash() const;
+
  private:
   host_t host_;
   port_t port_;
@@ -109,3 +111,12 @@ std::string ConvertToString(const net::HostAndPortAndSlot& from);
 bool ConvertFromString(const std::string& from, net::HostAndPortAndSlot* out) WARN_UNUSED_RESULT;
 
 }  // namespace common
+
+namespace std {
+
+template <>
+struct hash<common::net::HostAndPort> {
+  size_t operator()(const common::net::HostAndPort& host) const { return host.Hash(); }
+};
+
+}  // namespace std
@@ -34,13 +34,20 @@ COMPILE_ASSERT(std::numeric_limits<protocoled_size_t>::max() >= MAX_COMMAND_LENG
                "Protocoled packet size should be greater MAX_COMMAND_LENGTH");
 
 namespace detail {
+// stream_coding: message bodies use the compressor stream format (e.g. Snappy framing) instead of its one-shot
+// blocks, incoming bodies are decoded chunk by chunk; both peers must agree on it
 ErrnoError WriteRequest(libev::IoClient* client,
                         IEDcoder* compressor,
-                        const JsonRPCRequest& request) WARN_UNUSED_RESULT;
+                        const JsonRPCRequest& request,
+                        bool stream_coding = false) WARN_UNUSED_RESULT;
 ErrnoError WriteResponse(libev::IoClient* client,
                          IEDcoder* compressor,
-                         const JsonRPCResponse& response) WARN_UNUSED_RESULT;
-ErrnoError ReadCommand(libev::IoClient* client, IEDcoder* compressor, std::string* out) WARN_UNUSED_RESULT;
+                         const JsonRPCResponse& response,
+                         bool stream_coding = false) WARN_UNUSED_RESULT;
+ErrnoError ReadCommand(libev::IoClient* client,
+                       IEDcoder* compressor,
+                       std::string* out,
+                       bool stream_coding = false) WARN_UNUSED_RESULT;
 }  // namespace detail
 
 template <typename Client>
@@ -55,10 +62,15 @@ class ProtocolClient : public Client {
 
   template <typename... Args>
   explicit ProtocolClient(compressor_t compressor, Args... args)
-      : base_class(args...), compressor_(compressor), id_(0) {}
+      : base_class(args...), compressor_(compressor), stream_coding_(false), id_(0) {}
+
+  // off by default, see detail::ReadCommand
+  void SetStreamCoding(bool stream_coding) { stream_coding_ = stream_coding; }
+
+  bool IsStreamCoding() const { return stream_coding_; }
 
   ErrnoError WriteRequest(const JsonRPCRequest& request, callback_t cb = callback_t()) WARN_UNUSED_RESULT {
-    ErrnoError err = detail::WriteRequest(this, compressor_.get(), request);
+    ErrnoError err = detail::WriteRequest(this, compressor_.get(), request, stream_coding_);
     if (!err && !request.IsNotification()) {
       requests_queue_[request.id] = std::make_pair(request, cb);
     }
@@ -66,11 +78,11 @@ class ProtocolClient : public Client {
   }
 
   ErrnoError WriteResponse(const JsonRPCResponse& response) WARN_UNUSED_RESULT {
-    return detail::WriteResponse(this, compressor_.get(), response);
+    return detail::WriteResponse(this, compressor_.get(), response, stream_coding_);
   }
 
   ErrnoError ReadCommand(std::string* out) WARN_UNUSED_RESULT {
-    return detail::ReadCommand(this, compressor_.get(), out);
+    return detail::ReadCommand(this, compressor_.get(), out, stream_coding_);
   }
 
   bool PopRequestByID(json_rpc_id sid, JsonRPCRequest* req, callback_t* cb = nullptr) {
@@ -102,6 +114,7 @@ class ProtocolClient : public Client {
 
  private:
   const compressor_t compressor_;
+  bool stream_coding_;
   std::map<json_rpc_id, request_save_entry_t> requests_queue_;
   seq_id_t id_;
   using Client::Read;
@@ -0,0 +1,188 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <string>
+
+#include <common/error.h>
+#include <common/serializer/iserializer.h>
+#include <common/value.h>
+
+// Compact binary encoding of Value trees (TLV).
+//
+// Every value is written as a one byte Value::Type tag followed by its payload:
+//   TYPE_NULL                  - no payload
+//   TYPE_BOOLEAN               - one byte, 0 or 1
+//   TYPE_INTEGER, TYPE_LONG_INTEGER, TYPE_LONG_LONG_INTEGER, TYPE_TIME
+//                              - zigzag encoded varint
+//   TYPE_UINTEGER, TYPE_ULONG_INTEGER, TYPE_ULONG_LONG_INTEGER
+//                              - varint
+//   TYPE_DOUBLE                - 8 bytes IEEE 754, big endian
+//   TYPE_STRING, TYPE_BYTE_ARRAY
+//                              - varint length, raw bytes
+//   TYPE_ARRAY, TYPE_SET       - varint count, count values
+//   TYPE_ZSET                  - varint count, count key/value pairs of values
+//   TYPE_HASH                  - varint count, count pairs of (varint length, raw key bytes, value)
+//   USER_TYPES and above       - varint length, opaque payload produced by ValueBinaryCodec::EncodeUserValue
+//
+// Varints are little endian base 128 (7 bits per byte, high bit set on all bytes but the last).
+
+namespace common {
+namespace serializer {
+
+class ValueBinaryWriter {
+ public:
+  explicit ValueBinaryWriter(buffer_t* out);
+
+  void WriteType(Value::Type type);
+  void WriteBool(bool value);
+  void WriteVarUInt(uint64_t value);
+  void WriteVarInt(int64_t value);
+  void WriteDouble(double value);
+  void WriteRaw(const void* data, size_t size);
+  void WriteLengthPrefixed(const void* data, size_t size);
+
+  buffer_t* GetBuffer() const { return out_; }
+
+ private:
+  buffer_t* const out_;
+};
+
+// Reads from external storage, returned views are valid while storage alive.
+class ValueBinaryReader {
+ public:
+  ValueBinaryReader(const byte_t* data, size_t size);
+
+  bool ReadType(Value::Type* type) WARN_UNUSED_RESULT;
+  bool ReadBool(bool* value) WARN_UNUSED_RESULT;
+  bool ReadVarUInt(uint64_t* value) WARN_UNUSED_RESULT;
+  bool ReadVarInt(int64_t* value) WARN_UNUSED_RESULT;
+  bool ReadDouble(double* value) WARN_UNUSED_RESULT;
+  bool ReadLengthPrefixed(span<const byte_t>* value) WARN_UNUSED_RESULT;
+  bool ReadLengthPrefixed(StringPiece* value) WARN_UNUSED_RESULT;
+
+  size_t GetRemaining() const { return size_ - pos_; }
+  bool IsEmpty() const { return pos_ == size_; }
+
+ private:
+  const byte_t* const data_;
+  const size_t size_;
+  size_t pos_;
+};
+
+class ValueBinaryCodec {
+ public:
+  enum { max_depth = 128 };
+
+  ValueBinaryCodec();
+  virtual ~ValueBinaryCodec();
+
+  Error Encode(const Value* value, buffer_t* out) const WARN_UNUSED_RESULT;
+  Error Encode(const Value* value, ValueBinaryWriter* writer) const WARN_UNUSED_RESULT;
+
+  // whole data should be consumed by one value; strings and byte arrays are
+  // copied into the tree, walk the data with ValueBinaryReader to get views
+  Error Decode(const byte_t* data, size_t size, Value** out) const WARN_UNUSED_RESULT;
+  Error Decode(const buffer_t& data, Value** out) const WARN_UNUSED_RESULT;
+  Error Decode(ValueBinaryReader* reader, Value** out) const WARN_UNUSED_RESULT;
+
+ protected:
+  // USER_TYPES support, default implementations return error
+  virtual Error EncodeUserValue(const Value* value, buffer_t* payload) const;
+  virtual Error DecodeUserValue(Value::Type type, span<const byte_t> payload, Value** out) const;
+
+ private:
+  Error EncodeImpl(const Value* value, ValueBinaryWriter* writer, size_t depth) const;
+  Error DecodeImpl(ValueBinaryReader* reader, Value** out, size_t depth) const;
+};
+
+// ISerializer over Value trees, SerializeToString produces binary encoded data.
+template <typename T>
+class BinarySerializer : public ISerializer<Value*> {
+ public:
+  typedef ISerializer<Value*> base_class;
+  typedef typename base_class::serialize_type serialize_type;
+
+  Error SerializeToString(std::string* out) const override final WARN_UNUSED_RESULT {
+    if (!out) {
+      return make_error_inval();
+    }
+
+    serialize_type des = nullptr;
+    Error err = base_class::Serialize(&des);
+    if (err) {
+      return err;
+    }
+
+    buffer_t buff;
+    err = ValueBinaryCodec().Encode(des, &buff);
+    delete des;
+    if (err) {
+      return err;
+    }
+
+    *out = buff.as_string();
+    return Error();
+  }
+
+  Error SerializeFromString(const std::string& data, serialize_type* out) const override final WARN_UNUSED_RESULT {
+    if (!out) {
+      return make_error_inval();
+    }
+
+    return ValueBinaryCodec().Decode(reinterpret_cast<const byte_t*>(data.data()), data.size(), out);
+  }
+
+  Error DeSerializeFromString(const std::string& data) WARN_UNUSED_RESULT {
+    serialize_type res = nullptr;
+    Error err = SerializeFromString(data, &res);
+    if (err) {
+      return err;
+    }
+
+    err = DeSerialize(res);
+    delete res;
+    return err;
+  }
+
+  Error DeSerialize(const serialize_type& serialized) WARN_UNUSED_RESULT {
+    if (!serialized) {
+      return make_error_inval();
+    }
+
+    return DoDeSerialize(serialized);
+  }
+
+ protected:
+  virtual Error DoDeSerialize(Value* serialized) = 0;
+};
+
+}  // namespace serializer
+}  // namespace common
@@ -0,0 +1,243 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <common/error.h>
+#include <common/optional.h>
+#include <common/serializer/json_reader.h>
+#include <common/serializer/json_writer.h>
+
+// Declarative json fields: a type lists its members once and gets both directions generated.
+//
+//   class StopInfo : public JsonFieldsSerializer<StopInfo> {
+//     ...
+//     static constexpr auto json_fields() { return std::make_tuple(MakeJsonField("delay", &StopInfo::delay_)); }
+//   };
+//
+// Reading walks the object once, matches keys by a precomputed hash, ignores unknown keys and
+// reports every invalid or missing required field in one error.
+// Member types are mapped by JsonFieldTraits<M>, specialize it for custom types.
+
+namespace common {
+namespace serializer {
+
+enum JsonFieldFlags { JSON_FIELD_OPTIONAL = 0, JSON_FIELD_REQUIRED = 1 };
+
+constexpr uint64_t JsonFieldHash(const char* name, size_t size) {
+  uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(name[i])) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+template <typename T, typename M>
+struct JsonField {
+  typedef T object_type;
+  typedef M member_type;
+
+  const char* name;
+  size_t name_size;
+  uint64_t hash;
+  M T::*member;
+  JsonFieldFlags flags;
+};
+
+template <typename T, typename M, size_t N>
+constexpr JsonField<T, M> MakeJsonField(const char (&name)[N],
+                                        M T::*member,
+                                        JsonFieldFlags flags = JSON_FIELD_OPTIONAL) {
+  return JsonField<T, M>{name, N - 1, JsonFieldHash(name, N - 1), member, flags};
+}
+
+template <typename M, typename Enable = void>
+struct JsonFieldTraits;
+
+template <>
+struct JsonFieldTraits<bool> {
+  static void Write(JsonWriter* writer, bool value) { writer->Bool(value); }
+  static bool Read(const JsonValue& value, bool* out) { return !value.GetBool(out); }
+};
+
+template <>
+struct JsonFieldTraits<int> {
+  static void Write(JsonWriter* writer, int value) { writer->Int(value); }
+  static bool Read(const JsonValue& value, int* out) { return !value.GetInt(out); }
+};
+
+template <>
+struct JsonFieldTraits<int64_t> {
+  static void Write(JsonWriter* writer, int64_t value) { writer->Int64(value); }
+  static bool Read(const JsonValue& value, int64_t* out) { return !value.GetInt64(out); }
+};
+
+template <>
+struct JsonFieldTraits<uint64_t> {
+  static void Write(JsonWriter* writer, uint64_t value) { writer->UInt64(value); }
+  static bool Read(const JsonValue& value, uint64_t* out) { return !value.GetUInt64(out); }
+};
+
+template <>
+struct JsonFieldTraits<double> {
+  static void Write(JsonWriter* writer, double value) { writer->Double(value); }
+  static bool Read(const JsonValue& value, double* out) { return !value.GetDouble(out); }
+};
+
+template <>
+struct JsonFieldTraits<std::string> {
+  static void Write(JsonWriter* writer, const std::string& value) { writer->String(value); }
+  static bool Read(const JsonValue& value, std::string* out) { return !value.GetString(out); }
+};
+
+// enums are stored as ints, like JsonSerializerBase::SetEnumField
+template <typename M>
+struct JsonFieldTraits<M, typename std::enable_if<std::is_enum<M>::value>::type> {
+  static void Write(JsonWriter* writer, M value) { writer->Int(static_cast<int>(value)); }
+  static bool Read(const JsonValue& value, M* out) {
+    int res;
+    if (value.GetInt(&res)) {
+      return false;
+    }
+
+    *out = static_cast<M>(res);
+    return true;
+  }
+};
+
+// empty optional is written and read as null
+template <typename M>
+struct JsonFieldTraits<Optional<M>> {
+  static void Write(JsonWriter* writer, const Optional<M>& value) {
+    if (!value) {
+      writer->Null();
+      return;
+    }
+    JsonFieldTraits<M>::Write(writer, *value);
+  }
+
+  static bool Read(const JsonValue& value, Optional<M>* out) {
+    if (value.IsNull()) {
+      *out = Optional<M>();
+      return true;
+    }
+
+    M res;
+    if (!JsonFieldTraits<M>::Read(value, &res)) {
+      return false;
+    }
+
+    *out = res;
+    return true;
+  }
+};
+
+namespace detail {
+
+template <typename Fields, typename F, size_t... I>
+void ForEachJsonField(const Fields& fields, F&& func, std::index_sequence<I...>) {
+  const int unused[] = {0, (func(std::get<I>(fields), I), 0)...};
+  UNUSED(unused);
+}
+
+template <typename Fields, typename F>
+void ForEachJsonField(const Fields& fields, F&& func) {
+  ForEachJsonField(fields, std::forward<F>(func), std::make_index_sequence<std::tuple_size<Fields>::value>());
+}
+
+inline void AppendJsonFieldError(std::string* errors, const char* description, const char* field) {
+  if (!errors->empty()) {
+    errors->append(", ");
+  }
+  errors->append(description);
+  errors->append(field);
+}
+
+}  // namespace detail
+
+template <typename T, typename Fields>
+void WriteJsonFields(JsonWriter* writer, const T& object, const Fields& fields) {
+  detail::ForEachJsonField(fields, [writer, &object](const auto& field, size_t index) {
+    UNUSED(index);
+    typedef typename std::decay<decltype(field)>::type field_t;
+    writer->Key(StringPiece(field.name, field.name_size));
+    JsonFieldTraits<typename field_t::member_type>::Write(writer, object.*field.member);
+  });
+}
+
+template <typename T, typename Fields>
+Error ReadJsonFields(const JsonValue& serialized, T* object, const Fields& fields) {
+  static_assert(std::tuple_size<Fields>::value <= 64, "Too many json fields");
+  if (!object || serialized.GetType() != JSON_TYPE_OBJECT) {
+    return make_error_inval();
+  }
+
+  uint64_t seen = 0;
+  std::string errors;
+  JsonObjectReader reader(serialized);
+  while (reader.Next()) {
+    const StringPiece& key = reader.GetKey();
+    const uint64_t hash = JsonFieldHash(key.data(), key.size());
+    detail::ForEachJsonField(fields, [&](const auto& field, size_t index) {
+      typedef typename std::decay<decltype(field)>::type field_t;
+      const uint64_t bit = uint64_t(1) << index;
+      if (field.hash != hash || (seen & bit) || field.name_size != key.size() ||
+          memcmp(field.name, key.data(), key.size()) != 0) {
+        return;
+      }
+
+      seen |= bit;
+      if (!JsonFieldTraits<typename field_t::member_type>::Read(reader.GetValue(), &(object->*field.member))) {
+        detail::AppendJsonFieldError(&errors, "Invalid type field: ", field.name);
+      }
+    });
+  }
+
+  detail::ForEachJsonField(fields, [&](const auto& field, size_t index) {
+    if (field.flags & JSON_FIELD_REQUIRED && !(seen & (uint64_t(1) << index))) {
+      detail::AppendJsonFieldError(&errors, "Not exists field: ", field.name);
+    }
+  });
+
+  if (!errors.empty()) {
+    return make_error(errors);
+  }
+  return Error();
+}
+
+}  // namespace serializer
+}  // namespace common
@@ -0,0 +1,132 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <common/error.h>
+#include <common/macros.h>
+#include <common/string_piece.h>
+
+namespace common {
+namespace serializer {
+
+enum JsonType {
+  JSON_TYPE_NULL = 0,
+  JSON_TYPE_BOOLEAN,
+  JSON_TYPE_INT,
+  JSON_TYPE_DOUBLE,
+  JSON_TYPE_STRING,
+  JSON_TYPE_ARRAY,
+  JSON_TYPE_OBJECT
+};
+
+// Non owning view of one value inside a json text validated by ParseJson.
+// Nothing is materialized up front: object fields are located by scanning the raw
+// text on request, strings are unescaped only when read,
+// so the source buffer must outlive every view taken from it.
+// Field lookups return the first occurrence of a duplicated key.
+class JsonValue {
+ public:
+  JsonValue();
+
+  JsonType GetType() const;
+  bool IsNull() const;
+  // exact source text of the value
+  StringPiece GetRaw() const;
+
+  Error GetString(std::string* out) const WARN_UNUSED_RESULT;
+  Error GetBool(bool* out) const WARN_UNUSED_RESULT;
+  Error GetInt(int* out) const WARN_UNUSED_RESULT;
+  Error GetInt64(int64_t* out) const WARN_UNUSED_RESULT;
+  Error GetUInt64(uint64_t* out) const WARN_UNUSED_RESULT;
+  Error GetDouble(double* out) const WARN_UNUSED_RESULT;  // int or double
+  Error GetArray(std::vector<JsonValue>* out) const WARN_UNUSED_RESULT;
+
+  bool HasField(const StringPiece& field) const;
+  Error GetField(const char* field, JsonValue* out) const WARN_UNUSED_RESULT;
+
+  Error GetStringField(const char* field, std::string* out) const WARN_UNUSED_RESULT;
+  Error GetBoolField(const char* field, bool* out) const WARN_UNUSED_RESULT;
+  Error GetIntField(const char* field, int* out) const WARN_UNUSED_RESULT;
+  Error GetInt64Field(const char* field, int64_t* out) const WARN_UNUSED_RESULT;
+  Error GetUInt64Field(const char* field, uint64_t* out) const WARN_UNUSED_RESULT;
+  Error GetDoubleField(const char* field, double* out) const WARN_UNUSED_RESULT;
+  Error GetArrayField(const char* field, std::vector<JsonValue>* out) const WARN_UNUSED_RESULT;
+  Error GetObjectField(const char* field, JsonValue* out) const WARN_UNUSED_RESULT;
+
+ private:
+  friend Error ParseJson(const StringPiece& data, JsonValue* out);
+  friend class JsonObjectReader;
+  JsonValue(const char* data, size_t size, JsonType type);
+  static JsonValue ViewAt(const char* data, const char* end, const char** next);
+
+  bool FindField(const StringPiece& field, JsonValue* out) const;
+
+  const char* data_;
+  size_t size_;
+  JsonType type_;
+};
+
+// Walks the members of an object value once, in document order:
+//
+//   JsonObjectReader reader(object);
+//   while (reader.Next()) {
+//     use(reader.GetKey(), reader.GetValue());
+//   }
+class JsonObjectReader {
+ public:
+  explicit JsonObjectReader(const JsonValue& object);
+
+  bool Next();
+
+  // unescaped key, valid until the next call of Next
+  const StringPiece& GetKey() const;
+  const JsonValue& GetValue() const;
+
+ private:
+  const char* ptr_;
+  const char* end_;
+  StringPiece key_;
+  JsonValue value_;
+  std::string key_buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(JsonObjectReader);
+};
+
+// Validates the whole text (RFC 8259, nesting up to max_json_depth) and returns a view of the root value.
+enum { max_json_depth = 512 };
+Error ParseJson(const StringPiece& data, JsonValue* out) WARN_UNUSED_RESULT;
+
+}  // namespace serializer
+}  // namespace common
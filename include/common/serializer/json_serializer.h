@@ -18,9 +18,13 @@
 #include <json-c/json_tokener.h>  // for json_tokener_parse
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <common/serializer/iserializer.h>  // for ISerializer
+#include <common/serializer/json_fields.h>
+#include <common/serializer/json_reader.h>
+#include <common/serializer/json_writer.h>
 
 namespace common {
 namespace serializer {
@@ -136,15 +140,11 @@ class JsonSerializerBase : public ISerializer<struct json_object*> {
   }
 
   Error SerializeToString(std::string* out) const override final WARN_UNUSED_RESULT {
-    serialize_type des = nullptr;
-    Error err = base_class::Serialize(&des);
-    if (err) {
-      return err;
+    if (!out) {
+      return make_error_inval();
     }
 
-    *out = json_object_get_string(des);
-    json_object_put(des);
-    return Error();
+    return DoSerializeToString(out);
   }
 
   Error SerializeFromString(const std::string& data, serialize_type* out) const override final WARN_UNUSED_RESULT {
@@ -158,17 +158,7 @@ class JsonSerializerBase : public ISerializer<struct json_object*> {
     return Error();
   }
 
-  Error DeSerializeFromString(const std::string& data) WARN_UNUSED_RESULT {
-    const char* data_ptr = data.c_str();
-    serialize_type res = json_tokener_parse(data_ptr);
-    if (!res) {
-      return make_error_inval();
-    }
-
-    Error err = DeSerialize(res);
-    json_object_put(res);
-    return err;
-  }
+  Error DeSerializeFromString(const std::string& data) WARN_UNUSED_RESULT { return DoDeSerializeFromString(data); }
 
   Error DeSerialize(const serialize_type& serialized) WARN_UNUSED_RESULT {
     if (!serialized) {
@@ -180,6 +170,31 @@ class JsonSerializerBase : public ISerializer<struct json_object*> {
 
  protected:
   virtual Error DoDeSerialize(json_object* serialized) = 0;
+
+  // string round trips through a json-c document
+  virtual Error DoSerializeToString(std::string* out) const {
+    serialize_type des = nullptr;
+    Error err = base_class::Serialize(&des);
+    if (err) {
+      return err;
+    }
+
+    *out = json_object_get_string(des);
+    json_object_put(des);
+    return Error();
+  }
+
+  virtual Error DoDeSerializeFromString(const std::string& data) {
+    const char* data_ptr = data.c_str();
+    serialize_type res = json_tokener_parse(data_ptr);
+    if (!res) {
+      return make_error_inval();
+    }
+
+    Error err = DeSerialize(res);
+    json_object_put(res);
+    return err;
+  }
 };
 
 template <typename T>
@@ -192,6 +207,36 @@ class JsonSerializer : public JsonSerializerBase<T> {
   virtual Error DoDeSerialize(json_object* serialized) override = 0;
   virtual Error SerializeFields(json_object* out) const = 0;
 
+  // Direct writer/reader hooks used by SerializeToString/DeSerializeFromString,
+  // by default they bridge through the json-c representation above.
+  virtual Error WriteFields(JsonWriter* writer) const {
+    json_object* obj = json_object_new_object();
+    Error err = SerializeFields(obj);
+    if (err) {
+      json_object_put(obj);
+      return err;
+    }
+
+    json_object_object_foreach(obj, key, val) {
+      writer->Key(key);
+      writer->RawValue(json_object_to_json_string_ext(val, JSON_C_TO_STRING_PLAIN));
+    }
+    json_object_put(obj);
+    return Error();
+  }
+
+  virtual Error ReadFields(const JsonValue& serialized) {
+    const std::string raw = serialized.GetRaw().as_string();
+    json_object* obj = json_tokener_parse(raw.c_str());
+    if (!obj) {
+      return make_error_inval();
+    }
+
+    Error err = DoDeSerialize(obj);
+    json_object_put(obj);
+    return err;
+  }
+
   Error DoSerialize(serialize_type* out) const override final {
     json_object* obj = json_object_new_object();
     Error err = SerializeFields(obj);
@@ -203,6 +248,90 @@ class JsonSerializer : public JsonSerializerBase<T> {
     *out = obj;
     return Error();
   }
+
+  Error DoSerializeToString(std::string* out) const override {
+    std::string result;
+    JsonWriter writer(&result);
+    writer.StartObject();
+    Error err = WriteFields(&writer);
+    if (err) {
+      return err;
+    }
+
+    writer.EndObject();
+    *out = std::move(result);
+    return Error();
+  }
+
+  Error DoDeSerializeFromString(const std::string& data) override {
+    JsonValue root;
+    Error err = ParseJson(data, &root);
+    if (err) {
+      return err;
+    }
+
+    return ReadFields(root);
+  }
+};
+
+// JsonSerializer generated from T::json_fields(), see json_fields.h,
+// the json-c overloads are bridged through the text form.
+template <typename T>
+class JsonFieldsSerializer : public JsonSerializer<T> {
+ public:
+  typedef JsonSerializer<T> base_class;
+
+ protected:
+  Error WriteFields(JsonWriter* writer) const override {
+    static constexpr auto fields = T::json_fields();
+    WriteJsonFields(writer, static_cast<const T&>(*this), fields);
+    return Error();
+  }
+
+  Error ReadFields(const JsonValue& serialized) override {
+    static constexpr auto fields = T::json_fields();
+    T result;
+    Error err = ReadJsonFields(serialized, &result, fields);
+    if (err) {
+      return err;
+    }
+
+    static_cast<T&>(*this) = std::move(result);
+    return Error();
+  }
+
+  Error SerializeFields(json_object* out) const override {
+    std::string data;
+    JsonWriter writer(&data);
+    writer.StartObject();
+    Error err = WriteFields(&writer);
+    if (err) {
+      return err;
+    }
+    writer.EndObject();
+
+    json_object* obj = json_tokener_parse(data.c_str());
+    if (!obj) {
+      return make_error_inval();
+    }
+
+    json_object_object_foreach(obj, key, val) {
+      json_object_object_add(out, key, json_object_get(val));
+    }
+    json_object_put(obj);
+    return Error();
+  }
+
+  Error DoDeSerialize(json_object* serialized) override {
+    const char* data = json_object_to_json_string_ext(serialized, JSON_C_TO_STRING_PLAIN);
+    JsonValue root;
+    Error err = ParseJson(data, &root);
+    if (err) {
+      return err;
+    }
+
+    return ReadFields(root);
+  }
 };
 
 template <typename T>
@@ -0,0 +1,90 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <common/macros.h>
+#include <common/string_piece.h>
+
+namespace common {
+namespace serializer {
+
+// Streaming json writer, appends compact json text straight into the caller's buffer
+// without building an intermediate document, commas and colons are placed automatically:
+//
+//   std::string out;
+//   out.reserve(64);
+//   JsonWriter writer(&out);
+//   writer.StartObject();
+//   writer.Key("timestamp");
+//   writer.Int64(ts);
+//   writer.EndObject();  // {"timestamp":1590000000000}
+class JsonWriter {
+ public:
+  explicit JsonWriter(std::string* out);
+
+  void StartObject();
+  void EndObject();
+  void StartArray();
+  void EndArray();
+
+  void Key(const StringPiece& key);
+
+  void String(const StringPiece& value);
+  void Int(int value);
+  void Int64(int64_t value);
+  void UInt64(uint64_t value);
+  void Double(double value);
+  void Bool(bool value);
+  void Null();
+  // already serialized json, written as is
+  void RawValue(const StringPiece& json);
+
+  // one top level value written and all scopes closed
+  bool IsComplete() const;
+
+ private:
+  void BeforeValue();
+  void WriteEscaped(const StringPiece& value);
+
+  std::string* const out_;
+  std::vector<char> scopes_;
+  bool need_comma_;
+  bool after_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(JsonWriter);
+};
+
+}  // namespace serializer
+}  // namespace common
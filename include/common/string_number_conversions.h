@@ -80,6 +80,35 @@ string16 NumberToString16(float value, int prec);
 std::string NumberToString(double value, int prec);
 string16 NumberToString16(double value, int prec);
 
+// Shortest representation which reads back to exactly |value| (Grisu2), e.g.
+// 0.1 -> "0.1", 1e21 -> "1e+21", 3.0 -> "3.0". Infinities are "+inf"/"-inf".
+std::string NumberToShortestString(float value);
+std::string NumberToShortestString(double value);
+
+// Number -> chars conversions -------------------------------------------------
+
+// Non-allocating variants of the functions above: write the text into |out|
+// without a terminating null and return the number of chars written, or 0 if
+// |out| is too small. A buffer of kMaxIntegerChars/kMaxShortestChars is always
+// enough for integers/shortest doubles; fixed precision output of huge values
+// may need up to kMaxFixedChars.
+const size_t kMaxIntegerChars = 20;
+const size_t kMaxShortestChars = 32;
+const size_t kMaxFixedChars = 330;
+
+size_t NumberToChars(int value, span<char> out);
+size_t NumberToChars(unsigned int value, span<char> out);
+size_t NumberToChars(long value, span<char> out);
+size_t NumberToChars(unsigned long value, span<char> out);
+size_t NumberToChars(long long value, span<char> out);
+size_t NumberToChars(unsigned long long value, span<char> out);
+// Same output as NumberToString(value, prec).
+size_t NumberToChars(float value, int prec, span<char> out);
+size_t NumberToChars(double value, int prec, span<char> out);
+// Same output as NumberToShortestString(value).
+size_t NumberToShortestChars(float value, span<char> out);
+size_t NumberToShortestChars(double value, span<char> out);
+
 // String -> number conversions ------------------------------------------------
 
 // Perform a best-effort conversion of the input string to a numeric type,
@@ -117,12 +146,14 @@ bool StringToSizeT(StringPiece16 input, size_t* output);
 // form are defined to work.  Behavior with strings representing floating-point
 // numbers in hexadecimal, and strings representing non-finite values (such as
 // NaN and inf) is undefined.  Otherwise, these behave the same as the integral
-// variants.  This expects the input string to NOT be specific to the locale.
-// If your input is locale specific, use ICU to read the number.
+// variants, finite input too large for the type is an overflow. The result is
+// correctly rounded. This expects the input string to NOT be specific to the
+// locale. If your input is locale specific, use ICU to read the number.
 // WARNING: Will write to |output| even when returning false.
 //          Read the comments here and above StringToInt() carefully.
-/*bool StringToDouble(StringPiece input, double* output);
-bool StringToDouble(StringPiece16 input, double* output);*/
+bool StringToDouble(StringPiece input, double* output);
+bool StringToDouble(StringPiece16 input, double* output);
+bool StringToFloat(StringPiece input, float* output);
 
 // Hex encoding ----------------------------------------------------------------
 
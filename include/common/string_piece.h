@@ -41,6 +41,7 @@
 
 #include <stddef.h>  // for size_t, NULL, ptrdiff_t
 
+#include <common/hash/fast_hash.h>
 #include <common/string16.h>
 
 namespace common {
@@ -347,3 +348,15 @@ inline bool operator>=(const StringPiece16& x, const StringPiece16& y) {
 std::ostream& operator<<(std::ostream& o, const StringPiece& piece);
 
 }  // namespace common
+
+namespace std {
+
+template <typename STRING_TYPE>
+struct hash<common::BasicStringPiece<STRING_TYPE>> {
+  size_t operator()(const common::BasicStringPiece<STRING_TYPE>& piece) const {
+    return static_cast<size_t>(
+        common::hash::FastHash64(piece.data(), piece.size() * sizeof(typename STRING_TYPE::value_type)));
+  }
+};
+
+}  // namespace std
@@ -42,6 +42,8 @@ class Base64EDcoder : public IEDcoder {
   Error DoDecode(const StringPiece& data, char_buffer_t* out) override;
   Error DoEncode(const char_buffer_t& data, char_buffer_t* out) override;
   Error DoDecode(const char_buffer_t& data, char_buffer_t* out) override;
+  Error DoCreateEncodeStream(IEDcoderStream** stream) override;
+  Error DoCreateDecodeStream(IEDcoderStream** stream) override;
 };
 
 }  // namespace common
@@ -0,0 +1,100 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <common/text_decoders/iedcoder.h>  // for IEDcoder
+
+namespace common {
+
+// Picks the codec per payload and prefixes the output with its EDType byte
+// (ED_NONE, ED_LZ4, ED_SNAPPY or ED_ZLIB), so any CompressAutoEDcoder
+// decodes it whatever budget the encoder had:
+// - payloads under MIN_COMPRESS_SIZE, or whose first SAMPLE_SIZE bytes
+//   look already compressed (order-0 entropy over ENTROPY_LIMIT bits per
+//   byte), are stored;
+// - CPU_BUDGET_LOW uses LZ4 (snappy, then zlib level 1 when not built);
+// - CPU_BUDGET_NORMAL uses zlib up to SMALL_PAYLOAD_SIZE, where LZ4 gains
+//   little and deflate costs microseconds, LZ4 above;
+// - CPU_BUDGET_HIGH always uses zlib at the best level.
+// Output that would not shrink is stored, so a payload grows by one byte
+// at most. Encode and decode are thread safe, stats are atomic counters.
+class CompressAutoEDcoder : public IEDcoder {
+ public:
+  enum CpuBudget { CPU_BUDGET_LOW, CPU_BUDGET_NORMAL, CPU_BUDGET_HIGH };
+  enum : size_t { MIN_COMPRESS_SIZE = 64, SAMPLE_SIZE = 4 * 1024, SMALL_PAYLOAD_SIZE = 16 * 1024 };
+  static const double ENTROPY_LIMIT;
+
+  struct CodecStats {
+    uint64_t calls;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t time_ns;
+  };
+
+  explicit CompressAutoEDcoder(CpuBudget budget = CPU_BUDGET_NORMAL);
+
+  CpuBudget GetCpuBudget() const;
+
+  // |codec| is one of the tag types, ED_NONE counts stored payloads.
+  CodecStats GetEncodeStats(EDType codec) const;
+  CodecStats GetDecodeStats(EDType codec) const;
+
+  // Bits per byte of the byte histogram of |data|, 0..8.
+  static double SampleEntropy(const StringPiece& data);
+
+ private:
+  enum { CODECS_COUNT = 4 };
+
+  struct AtomicCodecStats {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> bytes_in;
+    std::atomic<uint64_t> bytes_out;
+    std::atomic<uint64_t> time_ns;
+  };
+
+  Error DoEncode(const StringPiece& data, char_buffer_t* out) override;
+  Error DoDecode(const StringPiece& data, char_buffer_t* out) override;
+  Error DoEncode(const char_buffer_t& data, char_buffer_t* out) override;
+  Error DoDecode(const char_buffer_t& data, char_buffer_t* out) override;
+
+  EDType SelectCodec(const StringPiece& data) const;
+  static CodecStats LoadStats(const AtomicCodecStats& stats);
+  static void UpdateStats(AtomicCodecStats* stats, size_t bytes_in, size_t bytes_out, uint64_t time_ns);
+
+  const CpuBudget budget_;
+  AtomicCodecStats encode_stats_[CODECS_COUNT];
+  AtomicCodecStats decode_stats_[CODECS_COUNT];
+};
+
+}  // namespace common
@@ -29,21 +29,26 @@
 
 #pragma once
 
+#include <common/compress/dictionary.h>
 #include <common/text_decoders/iedcoder.h>  // for IEDcoder
 
 namespace common {
 
 class CompressLZ4EDcoder : public IEDcoder {
  public:
-  explicit CompressLZ4EDcoder(bool sized = false);
+  explicit CompressLZ4EDcoder(bool sized = false,
+                              compress::CompressDictionarySPtr dictionary = compress::CompressDictionarySPtr());
 
  private:
   Error DoEncode(const StringPiece& data, char_buffer_t* out) override;
   Error DoDecode(const StringPiece& data, char_buffer_t* out) override;
   Error DoEncode(const char_buffer_t& data, char_buffer_t* out) override;
   Error DoDecode(const char_buffer_t& data, char_buffer_t* out) override;
+  Error DoCreateEncodeStream(IEDcoderStream** stream) override;
+  Error DoCreateDecodeStream(IEDcoderStream** stream) override;
 
   const bool sized_;
+  const compress::CompressDictionarySPtr dictionary_;
 };
 
 }  // namespace common
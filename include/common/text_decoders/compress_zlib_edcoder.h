@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <common/compress/dictionary.h>
 #include <common/text_decoders/iedcoder.h>  // for IEDcoder
 
 namespace common {
@@ -37,15 +38,20 @@ class CompressZlibEDcoder : public IEDcoder {
  public:
   enum ZlibDeflates : uint8_t { ZLIB_DEFLATE = 0, GZIP_DEFLATE = 16 };
   explicit CompressZlibEDcoder(bool sized = false, ZlibDeflates def = ZLIB_DEFLATE);
+  // zlib format with a preset dictionary
+  CompressZlibEDcoder(bool sized, compress::CompressDictionarySPtr dictionary);
 
  private:
   Error DoEncode(const StringPiece& data, char_buffer_t* out) override;
   Error DoDecode(const StringPiece& data, char_buffer_t* out) override;
   Error DoEncode(const char_buffer_t& data, char_buffer_t* out) override;
   Error DoDecode(const char_buffer_t& data, char_buffer_t* out) override;
+  Error DoCreateEncodeStream(IEDcoderStream** stream) override;
+  Error DoCreateDecodeStream(IEDcoderStream** stream) override;
 
   const bool sized_;
   const ZlibDeflates deflate_;
+  const compress::CompressDictionarySPtr dictionary_;
 };
 
 }  // namespace common
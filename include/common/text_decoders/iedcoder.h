@@ -50,10 +50,13 @@ enum EDType : unsigned {
   ED_UNICODE,
   ED_UUNICODE,
   ED_HTML_ESC,
+  ED_AUTO,
   ENCODER_DECODER_NUM_TYPES
 };
 extern const std::array<const char*, ENCODER_DECODER_NUM_TYPES> edecoder_types;
 
+class IEDcoderStream;
+
 class IEDcoder {
  public:
   Error Encode(const StringPiece& data, char_buffer_t* out) WARN_UNUSED_RESULT;
@@ -61,6 +64,10 @@ class IEDcoder {
   Error Encode(const char_buffer_t& data, char_buffer_t* out) WARN_UNUSED_RESULT;
   Error Decode(const char_buffer_t& data, char_buffer_t* out) WARN_UNUSED_RESULT;
 
+  // incremental coders for data which doesn't fit in memory, see iedcoder_stream.h
+  Error CreateEncodeStream(IEDcoderStream** stream) WARN_UNUSED_RESULT;  // allocated memory
+  Error CreateDecodeStream(IEDcoderStream** stream) WARN_UNUSED_RESULT;  // allocated memory
+
   EDType GetType() const;
 
   virtual ~IEDcoder();
@@ -74,6 +81,10 @@ class IEDcoder {
   virtual Error DoEncode(const char_buffer_t& data, char_buffer_t* out) = 0;
   virtual Error DoDecode(const char_buffer_t& data, char_buffer_t* out) = 0;
 
+  // not supported by default
+  virtual Error DoCreateEncodeStream(IEDcoderStream** stream);
+  virtual Error DoCreateDecodeStream(IEDcoderStream** stream);
+
   const EDType type_;
 };
 
@@ -29,11 +29,15 @@
 
 #pragma once
 
+#include <common/compress/dictionary.h>
 #include <common/text_decoders/iedcoder.h>
 
 namespace common {
 
 IEDcoder* CreateEDCoder(EDType type);
 IEDcoder* CreateEDCoder(const std::string& name);
+// Sized ED_ZLIB or ED_LZ4 coder over a preset dictionary, the header then
+// carries the dictionary id. Other types have no dictionary support.
+IEDcoder* CreateEDCoder(EDType type, compress::CompressDictionarySPtr dictionary);
 
 }  // namespace common
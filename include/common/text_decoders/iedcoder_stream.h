@@ -0,0 +1,100 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <common/text_decoders/iedcoder.h>
+
+namespace common {
+
+// Incremental encoder/decoder, Update can be called any number of times with
+// chunks of any size, Finish flushes buffered state and validates the end of
+// input. Produced bytes are appended to out, so memory usage is bounded by the
+// chunk size and the coder window instead of the total data size.
+class IEDcoderStream {
+ public:
+  Error Update(const StringPiece& data, char_buffer_t* out) WARN_UNUSED_RESULT;
+  Error Finish(char_buffer_t* out) WARN_UNUSED_RESULT;
+
+  bool IsFinished() const;
+
+  virtual ~IEDcoderStream();
+
+ protected:
+  IEDcoderStream();
+
+ private:
+  virtual Error DoUpdate(const StringPiece& data, char_buffer_t* out) = 0;
+  virtual Error DoFinish(char_buffer_t* out) = 0;
+
+  bool finished_;
+  DISALLOW_COPY_AND_ASSIGN(IEDcoderStream);
+};
+
+// Streams one-shot coders which work on fixed size units (3 bytes for base64
+// encode, 2 chars for hex decode, ...), unaligned tail is kept until the next
+// Update and coded by Finish.
+class BlockEDcoderStream : public IEDcoderStream {
+ public:
+  typedef std::function<Error(const StringPiece& data, char_buffer_t* out)> block_coder_t;
+
+  BlockEDcoderStream(size_t unit_size, block_coder_t coder);
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override;
+  Error DoFinish(char_buffer_t* out) override;
+
+  Error CodeBlock(const StringPiece& data, char_buffer_t* out);
+
+  const size_t unit_size_;
+  const block_coder_t coder_;
+  char_buffer_t tail_;
+  char_buffer_t block_;
+};
+
+enum : size_t { DEFAULT_STREAM_CHUNK_SIZE = 64 * 1024 };
+
+// reader returns 0 bytes at the end of input
+typedef std::function<Error(char* buf, size_t size, size_t* nread)> stream_reader_t;
+typedef std::function<Error(const char_buffer_t& data)> stream_writer_t;
+
+// pumps reader through stream into writer by chunk_size pieces and finishes the stream
+Error TransformStream(IEDcoderStream* stream,
+                      const stream_reader_t& reader,
+                      const stream_writer_t& writer,
+                      size_t chunk_size = DEFAULT_STREAM_CHUNK_SIZE) WARN_UNUSED_RESULT;
+
+// path_to is overwritten
+Error EncodeFile(IEDcoder* coder, const std::string& path_from, const std::string& path_to) WARN_UNUSED_RESULT;
+Error DecodeFile(IEDcoder* coder, const std::string& path_from, const std::string& path_to) WARN_UNUSED_RESULT;
+
+}  // namespace common
@@ -0,0 +1,104 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+
+#include <common/macros.h>
+
+namespace common {
+namespace threads {
+
+struct mpsc_queue_node {
+  mpsc_queue_node() : next(nullptr) {}
+
+  std::atomic<mpsc_queue_node*> next;
+};
+
+// Intrusive multi producer single consumer queue (Vyukov): T derives from
+// mpsc_queue_node and stays owned by the caller. Push is wait free and may
+// run on any thread, Pop/IsEmpty belong to one consumer thread. A node
+// pushed while Pop runs may not be visible yet, IsEmpty() tells it apart
+// from a drained queue.
+template <typename T>
+class mpsc_queue {
+ public:
+  mpsc_queue() : head_(&stub_), tail_(&stub_), stub_() {}
+
+  void Push(T* node) { PushNode(node); }
+
+  T* Pop() {
+    mpsc_queue_node* tail = tail_;
+    mpsc_queue_node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+
+    if (tail != head_.load()) {
+      // a producer swapped the head but has not linked its node yet
+      return nullptr;
+    }
+
+    PushNode(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    return nullptr;
+  }
+
+  bool IsEmpty() const { return tail_ == &stub_ && head_.load() == &stub_; }
+
+ private:
+  void PushNode(mpsc_queue_node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    mpsc_queue_node* prev = head_.exchange(node);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  std::atomic<mpsc_queue_node*> head_;
+  mpsc_queue_node* tail_;
+  mpsc_queue_node stub_;
+  DISALLOW_COPY_AND_ASSIGN(mpsc_queue);
+};
+
+}  // namespace threads
+}  // namespace common
@@ -37,7 +37,8 @@
 namespace common {
 namespace time {
 
-time64_t current_utc_mstime();  // millisecond
+time64_t current_utc_mstime();        // millisecond
+time64_t current_monotonic_mstime();  // millisecond, for intervals, not affected by clock changes
 struct timespec current_timespec();
 struct timeval current_timeval();
 
@@ -35,8 +35,12 @@
 #include <array>
 #include <iosfwd>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>  // for vector
 
+#include <common/hash/fast_hash.h>
+
 namespace common {
 
 // C++14 implementation of C++17's std::size():
@@ -139,38 +143,29 @@ class ByteArray : public std::vector<T> {
   ByteArray(std::initializer_list<T> t) : base_class(t) {}
 
   ByteArray(const base_class& rhs) : base_class(rhs) {}
+  ByteArray(base_class&& rhs) : base_class(std::move(rhs)) {}
 
   ByteArray(const self_type&) = default;
   ByteArray& operator=(const self_type&) = default;
+  ByteArray(self_type&&) = default;
+  ByteArray& operator=(self_type&&) = default;
 
   inline void append(unsigned char t) { base_class::push_back(t); }
 
   inline void append(char t) { base_class::push_back(t); }
 
-  inline void append(const unsigned char* obj, size_t size) {
-    for (size_t i = 0; i < size; ++i) {
-      append(obj[i]);
-    }
-  }
+  inline void append(const unsigned char* obj, size_t size) { base_class::insert(base_class::end(), obj, obj + size); }
 
-  inline void append(const char* obj, size_t size) {
-    for (size_t i = 0; i < size; ++i) {
-      append(obj[i]);
-    }
-  }
+  inline void append(const char* obj, size_t size) { base_class::insert(base_class::end(), obj, obj + size); }
 
   template <typename ch>
   inline void append(const std::vector<ch>& obj) {
-    for (size_t i = 0; i < obj.size(); ++i) {
-      append(obj[i]);
-    }
+    base_class::insert(base_class::end(), obj.begin(), obj.end());
   }
 
   template <typename ch>
   inline void append(const std::basic_string<ch>& obj) {
-    for (size_t i = 0; i < obj.size(); ++i) {
-      append(obj[i]);
-    }
+    base_class::insert(base_class::end(), obj.begin(), obj.end());
   }
 
   template <typename ch>
@@ -226,12 +221,10 @@ namespace std {
 
 template <typename T>
 struct hash<common::ByteArray<T>> {
+  static_assert(std::is_integral<T>::value, "ByteArray is hashed as raw memory");
+
   size_t operator()(const common::ByteArray<T>& k) const {
-    size_t seed = 0;
-    for (const auto& elem : k) {
-      seed = common::hash_combine(seed, std::hash<T>()(elem));
-    }
-    return seed;
+    return static_cast<size_t>(common::hash::FastHash64(k.data(), k.size() * sizeof(T)));
   }
 };
 
@@ -34,6 +34,7 @@
 #include <iosfwd>
 #include <string>
 
+#include <common/hash/fast_hash.h>
 #include <common/uri/url_canon_stdstring.h>
 #include <common/uri/url_constants.h>
 
@@ -418,3 +419,15 @@ bool operator!=(const StringPiece& spec, const GURL& x);
 }  // namespace uri
 }  // namespace common
 // Stream operator so GURL can be used in assertion statements.
+
+namespace std {
+
+template <>
+struct hash<common::uri::GURL> {
+  size_t operator()(const common::uri::GURL& url) const {
+    const std::string& spec = url.possibly_invalid_spec();
+    return static_cast<size_t>(common::hash::FastHash64(spec.data(), spec.size()));
+  }
+};
+
+}  // namespace std
@@ -36,7 +36,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include <common/containers/span.h>
 #include <common/macros.h>
+#include <common/string_piece.h>
 #include <common/types.h>  // for byte_array_t
 
 namespace common {
@@ -92,9 +94,11 @@ class Value {
 
   static StringValue* CreateEmptyStringValue();
   static StringValue* CreateStringValue(const string_t& in_value);
+  static StringValue* CreateStringValue(string_t&& in_value);
   static StringValue* CreateStringValueFromBasicString(const std::string& in_value);
   static ArrayValue* CreateArrayValue();
   static ByteArrayValue* CreateByteArrayValue(const byte_array_t& array);
+  static ByteArrayValue* CreateByteArrayValue(byte_array_t&& array);
   static SetValue* CreateSetValue();
   static ZSetValue* CreateZSetValue();
   static HashValue* CreateHashValue();
@@ -119,10 +123,14 @@ class Value {
   virtual bool GetAsDouble(double* out_value) const WARN_UNUSED_RESULT;
   virtual bool GetAsTime(time_t* out_value) const WARN_UNUSED_RESULT;
   virtual bool GetAsString(string_t* out_value) const WARN_UNUSED_RESULT;
+  // zero-copy view, valid while value alive and not modified
+  virtual bool GetAsStringPiece(StringPiece* out_value) const WARN_UNUSED_RESULT;
   bool GetAsBasicString(std::string* out_value) const WARN_UNUSED_RESULT;
   virtual bool GetAsList(ArrayValue** out_value) WARN_UNUSED_RESULT;
   virtual bool GetAsList(const ArrayValue** out_value) const WARN_UNUSED_RESULT;
   virtual bool GetAsByteArray(byte_array_t* out_value) const WARN_UNUSED_RESULT;
+  // zero-copy view, valid while value alive and not modified
+  virtual bool GetAsByteSpan(span<const byte_t>* out_value) const WARN_UNUSED_RESULT;
   virtual bool GetAsSet(SetValue** out_value) WARN_UNUSED_RESULT;
   virtual bool GetAsSet(const SetValue** out_value) const WARN_UNUSED_RESULT;
   virtual bool GetAsZSet(ZSetValue** out_value) WARN_UNUSED_RESULT;
@@ -140,10 +148,10 @@ class Value {
   explicit Value(Type type);
   Value(const Value& that);
   Value& operator=(const Value& that);
-
- private:
   Value(Value&& other);
   Value& operator=(Value&& other);
+
+ private:
   Type type_;
 };
 
@@ -200,9 +208,13 @@ class TimeValue : public Value {
 class StringValue : public Value {
  public:
   explicit StringValue(const string_t& in_value);
+  explicit StringValue(string_t&& in_value);
   ~StringValue() override;
 
+  const string_t& GetValue() const { return value_; }
+
   bool GetAsString(string_t* out_value) const override WARN_UNUSED_RESULT;
+  bool GetAsStringPiece(StringPiece* out_value) const override WARN_UNUSED_RESULT;
   StringValue* DeepCopy() const override;
   bool Equals(const Value* other) const override;
 
@@ -252,16 +264,21 @@ class ArrayValue : public Value {
 
   // Appends a Value to the end of the list.
   void Append(Value* in_value);
+  void Append(std::unique_ptr<Value> in_value);
 
   // Convenience forms of Append.
   void AppendBoolean(bool in_value);
   void AppendInteger(int in_value);
   void AppendDouble(double in_value);
   void AppendString(const string_t& in_value);
+  void AppendString(string_t&& in_value);
   void AppendStrings(const std::vector<string_t>& in_values);
+  void AppendStrings(std::vector<string_t>&& in_values);
   void AppendBasicString(const std::string& in_value);
   void AppendBasicStrings(const std::vector<std::string>& in_values);
 
+  void Reserve(size_t size) { list_.reserve(size); }
+
   bool AppendIfNotPresent(Value* in_value);
 
   bool Insert(size_t index, Value* in_value);
@@ -295,12 +312,15 @@ class ByteArrayValue : public Value {
   typedef byte_array_t::value_type value_type;
 
   explicit ByteArrayValue(const byte_array_t& array);
+  explicit ByteArrayValue(byte_array_t&& array);
   ~ByteArrayValue() override;
 
   void Clear();
 
   size_t GetSize() const { return array_.size(); }
 
+  const byte_array_t& GetValue() const { return array_; }
+
   // Returns whether the list is empty.
   bool IsEmpty() const { return array_.empty(); }
 
@@ -321,6 +341,7 @@ class ByteArrayValue : public Value {
   const_iterator end() const { return array_.end(); }
 
   bool GetAsByteArray(byte_array_t* out_value) const override WARN_UNUSED_RESULT;
+  bool GetAsByteSpan(span<const byte_t>* out_value) const override WARN_UNUSED_RESULT;
   ByteArrayValue* DeepCopy() const override;
   bool Equals(const Value* other) const override;
 
@@ -349,6 +370,7 @@ class SetValue : public Value {
   // Insert a Value to the set.
   bool Insert(Value* in_value);
   void Insert(const string_t& in_value);
+  void Insert(string_t&& in_value);
 
   // Iteration.
   iterator begin() { return set_.begin(); }
@@ -388,6 +410,7 @@ class ZSetValue : public Value {
   // Insert a Value to the map.
   bool Insert(Value* key, Value* value);
   void Insert(const string_t& key, const string_t& value);
+  void Insert(string_t&& key, string_t&& value);
 
   // Iteration.
   iterator begin() { return map_.begin(); }
@@ -428,8 +451,11 @@ class HashValue : public Value {
 
   // Insert a Value to the map.
   bool Insert(const string_t& key, Value* value);
+  bool Insert(string_t&& key, Value* value);
   bool Insert(const std::string& key, Value* value);
 
+  void Reserve(size_t size) { hash_.reserve(size); }
+
   Value* Find(const string_t& key) const;
   Value* Find(const std::string& key) const;
 
@@ -32,14 +32,24 @@
 #if defined(HAVE_BZIP2)
 #include <string.h>
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
 #include <bzlib.h>
 
 #include <common/compress/coding.h>
 
+#include "parallel_blocks.h"
+
 namespace common {
 namespace {
+
+// documented worst case: 1% larger plus 600 bytes
+size_t BZip2CompressBound(size_t input_length) {
+  return input_length + input_length / 100 + 600;
+}
+
 template <typename CHAR, typename STR2>
 Error EncodeBZip2T(const CHAR* input, size_t input_length, bool sized, STR2* output) {
   if (!input || !output || input_length > std::numeric_limits<uint32_t>::max()) {
@@ -56,9 +66,7 @@ Error EncodeBZip2T(const CHAR* input, size_t input_length, bool sized, STR2* out
     output_header_len = 0;
   }
 
-  // Resize output to be the plain data length.
-  // This may not be big enough if the compression actually expands data.
-  output_len = output_header_len + input_length;
+  output_len = static_cast<uint32_t>(output_header_len + BZip2CompressBound(input_length));
   output->resize(output_len);
 
   bz_stream _stream;
@@ -77,7 +85,7 @@ Error EncodeBZip2T(const CHAR* input, size_t input_length, bool sized, STR2* out
   _stream.avail_in = static_cast<unsigned int>(input_length);
 
   // Initialize the output size.
-  _stream.avail_out = static_cast<unsigned int>(input_length);
+  _stream.avail_out = static_cast<unsigned int>(output_len - output_header_len);
   _stream.next_out = reinterpret_cast<char*>(&(*output)[output_header_len]);
 
   bool done = false;
@@ -104,7 +112,7 @@ Error EncodeBZip2T(const CHAR* input, size_t input_length, bool sized, STR2* out
       }
       default:
         BZ2_bzCompressEnd(&_stream);
-        return make_error("ZLIB compress internal error");
+        return make_error("BZip2 compress internal error");
     }
   }
   // The only return value we really care about is BZ_STREAM_END.
@@ -153,9 +161,28 @@ Error DecodeBZip2T(const CHAR* input, size_t input_length, bool sized, STR2* out
   while (!done) {
     st = BZ2_bzDecompress(&_stream);
     switch (st) {
-      case BZ_STREAM_END:
-        done = true;
+      case BZ_STREAM_END: {
+        // concatenated streams, restart on the next one
+        if (_stream.avail_in < 4 || memcmp(_stream.next_in, "BZh", 3) != 0) {
+          done = true;
+          break;
+        }
+        char* next_in = _stream.next_in;
+        unsigned int avail_in = _stream.avail_in;
+        char* next_out = _stream.next_out;
+        unsigned int avail_out = _stream.avail_out;
+        BZ2_bzDecompressEnd(&_stream);
+        memset(&_stream, 0, sizeof(bz_stream));
+        if (BZ2_bzDecompressInit(&_stream, 0, 0) != BZ_OK) {
+          delete[] output;
+          return make_error("BZip2 decompress internal error");
+        }
+        _stream.next_in = next_in;
+        _stream.avail_in = avail_in;
+        _stream.next_out = next_out;
+        _stream.avail_out = avail_out;
         break;
+      }
       case BZ_OK: {
         // No output space. Increase the output space by 20%.
         // We should never run out of output space if
@@ -189,6 +216,56 @@ Error DecodeBZip2T(const CHAR* input, size_t input_length, bool sized, STR2* out
   BZ2_bzDecompressEnd(&_stream);
   return Error();
 }
+Error EncodeBZip2ParallelImpl(const char* input,
+                              size_t input_length,
+                              bool sized,
+                              threads::ThreadPool* pool,
+                              char_buffer_t* output,
+                              size_t block_size) {
+  if (!input || !output || block_size == 0 || block_size > std::numeric_limits<uint32_t>::max() / 2) {
+    return make_error_inval();
+  }
+  if (sized && input_length > std::numeric_limits<uint32_t>::max()) {
+    return make_error_inval();
+  }
+
+  const size_t blocks_count = compress::detail::BlocksCount(input_length, block_size);
+  std::vector<char_buffer_t> blocks(blocks_count);
+  Error err = compress::detail::RunBlocks(pool, blocks_count, [&](size_t index) {
+    const size_t offset = index * block_size;
+    const size_t length = std::min(block_size, input_length - offset);
+    // smallest bzip2 block size (in 100k units) which holds the piece
+    const int block_size_100k = static_cast<int>(std::min<size_t>(9, std::max<size_t>(1, (length + 99999) / 100000)));
+    char_buffer_t* block = &blocks[index];
+    block->resize(BZip2CompressBound(length));
+    unsigned int dest_len = static_cast<unsigned int>(block->size());
+    int st = BZ2_bzBuffToBuffCompress(block->data(), &dest_len, const_cast<char*>(input + offset),
+                                      static_cast<unsigned int>(length), block_size_100k, 0, 30);
+    if (st != BZ_OK) {
+      return make_error("BZip2 compress internal error");
+    }
+    block->resize(dest_len);
+    return Error();
+  });
+  if (err) {
+    return err;
+  }
+
+  size_t total = 0;
+  for (const char_buffer_t& block : blocks) {
+    total += block.size();
+  }
+
+  output->clear();
+  size_t pos = sized ? compress::PutDecompressedSizeInfo(output, static_cast<uint32_t>(input_length)) : 0;
+  output->resize(pos + total);
+  for (const char_buffer_t& block : blocks) {
+    memcpy(output->data() + pos, block.data(), block.size());
+    pos += block.size();
+  }
+  return Error();
+}
+
 }  // namespace
 
 namespace compress {
@@ -209,6 +286,22 @@ Error DecodeBZip2(const char_buffer_t& data, bool sized, char_buffer_t* out) {
   return DecodeBZip2T(data.data(), data.size(), sized, out);
 }
 
+Error EncodeBZip2Parallel(const StringPiece& data,
+                          bool sized,
+                          threads::ThreadPool* pool,
+                          char_buffer_t* out,
+                          size_t block_size) {
+  return EncodeBZip2ParallelImpl(data.data(), data.size(), sized, pool, out, block_size);
+}
+
+Error EncodeBZip2Parallel(const char_buffer_t& data,
+                          bool sized,
+                          threads::ThreadPool* pool,
+                          char_buffer_t* out,
+                          size_t block_size) {
+  return EncodeBZip2ParallelImpl(data.data(), data.size(), sized, pool, out, block_size);
+}
+
 }  // namespace compress
 }  // namespace common
 #endif
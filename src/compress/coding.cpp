@@ -120,5 +120,24 @@ bool GetDecompressedSizeInfo(const unsigned char** input_data, size_t* input_len
   return true;
 }
 
+size_t PutDecompressedSizeInfo(char_buffer_t* output, uint32_t length, uint32_t dictionary_id) {
+  PutDecompressedSizeInfo(output, length);
+  return PutDecompressedSizeInfo(output, dictionary_id);
+}
+
+bool GetDecompressedSizeInfo(const char** input_data,
+                             size_t* input_length,
+                             uint32_t* output_len,
+                             uint32_t* dictionary_id) {
+  const char* data = *input_data;
+  size_t length = *input_length;
+  if (!GetDecompressedSizeInfo(&data, &length, output_len) || !GetDecompressedSizeInfo(&data, &length, dictionary_id)) {
+    return false;
+  }
+  *input_length = length;
+  *input_data = data;
+  return true;
+}
+
 }  // namespace compress
 }  // namespace common
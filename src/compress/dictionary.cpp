@@ -0,0 +1,176 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/compress/dictionary.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+#include <common/hash/fast_hash.h>
+
+namespace common {
+namespace compress {
+namespace {
+
+// Segments are scored by the 8 byte k-mers they contain, weighted by how
+// many samples share each k-mer. Greedy selection zeroes the weights of
+// picked k-mers so the dictionary does not repeat itself.
+const size_t kKmerSize = 8;
+const size_t kSegmentSize = 64;
+const size_t kSegmentStep = 8;
+
+uint64_t LoadKmer(const char* data) {
+  uint64_t result;
+  memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+struct KmerStat {
+  uint32_t samples_count;
+  uint32_t last_sample;
+};
+
+typedef std::unordered_map<uint64_t, KmerStat> kmer_stats_t;
+
+struct Segment {
+  uint64_t score;
+  size_t sample;
+  size_t offset;
+  size_t size;
+
+  bool operator<(const Segment& other) const { return score < other.score; }
+};
+
+uint64_t ScoreSegment(const StringPiece& sample, size_t offset, size_t size, const kmer_stats_t& stats) {
+  uint64_t score = 0;
+  for (size_t pos = offset; pos + kKmerSize <= offset + size; ++pos) {
+    const auto it = stats.find(LoadKmer(sample.data() + pos));
+    if (it != stats.end() && it->second.samples_count > 1) {
+      score += it->second.samples_count;
+    }
+  }
+  return score;
+}
+
+}  // namespace
+
+CompressDictionary::CompressDictionary(const StringPiece& content) : content_(), id_(0) {
+  const size_t size = std::min<size_t>(content.size(), MAX_DICTIONARY_SIZE);
+  content_.assign(content.data() + content.size() - size, content.data() + content.size());
+  id_ = static_cast<uint32_t>(hash::FastHash64(content_.data(), content_.size()));
+  if (id_ == 0) {
+    id_ = 1;
+  }
+}
+
+CompressDictionary::CompressDictionary(const char_buffer_t& content)
+    : CompressDictionary(StringPiece(content.data(), content.size())) {}
+
+uint32_t CompressDictionary::GetID() const {
+  return id_;
+}
+
+const char_buffer_t& CompressDictionary::GetContent() const {
+  return content_;
+}
+
+Error TrainDictionary(const std::vector<StringPiece>& samples, size_t dictionary_size, char_buffer_t* out) {
+  if (!out || dictionary_size == 0 || dictionary_size > CompressDictionary::MAX_DICTIONARY_SIZE) {
+    return make_error_inval();
+  }
+
+  kmer_stats_t stats;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const StringPiece& sample = samples[i];
+    for (size_t pos = 0; pos + kKmerSize <= sample.size(); ++pos) {
+      KmerStat& stat = stats[LoadKmer(sample.data() + pos)];
+      if (stat.samples_count == 0 || stat.last_sample != i) {
+        stat.samples_count++;
+        stat.last_sample = static_cast<uint32_t>(i);
+      }
+    }
+  }
+
+  std::priority_queue<Segment> candidates;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const StringPiece& sample = samples[i];
+    if (sample.size() < kKmerSize) {
+      continue;
+    }
+    for (size_t offset = 0; offset < sample.size(); offset += kSegmentStep) {
+      const size_t size = std::min(kSegmentSize, sample.size() - offset);
+      if (size < kKmerSize) {
+        break;
+      }
+      const uint64_t score = ScoreSegment(sample, offset, size, stats);
+      if (score) {
+        candidates.push({score, i, offset, size});
+      }
+    }
+  }
+
+  // Lazy greedy: scores only drop as k-mers get used, so a popped segment
+  // whose rescored value still beats the next candidate is the best one.
+  std::vector<Segment> picked;
+  size_t picked_size = 0;
+  while (!candidates.empty() && picked_size < dictionary_size) {
+    Segment best = candidates.top();
+    candidates.pop();
+    const StringPiece& sample = samples[best.sample];
+    best.score = ScoreSegment(sample, best.offset, best.size, stats);
+    if (best.score == 0) {
+      continue;
+    }
+    if (!candidates.empty() && best.score < candidates.top().score) {
+      candidates.push(best);
+      continue;
+    }
+
+    for (size_t pos = best.offset; pos + kKmerSize <= best.offset + best.size; ++pos) {
+      stats[LoadKmer(sample.data() + pos)].samples_count = 0;
+    }
+    best.size = std::min(best.size, dictionary_size - picked_size);
+    picked_size += best.size;
+    picked.push_back(best);
+  }
+
+  out->clear();
+  out->reserve(picked_size);
+  for (auto it = picked.rbegin(); it != picked.rend(); ++it) {
+    const char* data = samples[it->sample].data() + it->offset;
+    out->insert(out->end(), data, data + it->size);
+  }
+  return Error();
+}
+
+}  // namespace compress
+}  // namespace common
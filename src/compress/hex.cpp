@@ -29,42 +29,138 @@
 
 #include <common/compress/hex.h>
 
-#include <common/convert2string.h>
+#include "hex_simd.h"
 
 namespace common {
 namespace compress {
 
-Error EncodeHex(const StringPiece& data, bool is_lower, char_buffer_t* out) {
-  if (!utils::hex::encode(data, is_lower, out)) {
+Error EncodeHex(const StringPiece& data, bool is_lower, span<char> out) {
+  const size_t size = data.size();
+  if (out.size() < HexEncodedSize(size)) {
     return make_error_inval();
   }
 
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(data.data());
+  char* dst = out.data();
+  size_t pos = 0;
+#if defined(__AVX2__)
+  const __m256i alpha256 = _mm256_set1_epi8(detail::HexAlphaOffset(is_lower));
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i lo, hi;
+    detail::EncodeHex32AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + pos)), alpha256, &lo, &hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos * 2), lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos * 2 + 32), hi);
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i alpha = _mm_set1_epi8(detail::HexAlphaOffset(is_lower));
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i lo, hi;
+    detail::EncodeHex16SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos)), alpha, &lo, &hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos * 2), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos * 2 + 16), hi);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t alpha = vdupq_n_u8(detail::HexAlphaOffset(is_lower));
+  for (; pos + 16 <= size; pos += 16) {
+    const uint8x16_t in = vld1q_u8(src + pos);
+    uint8x16x2_t chars;
+    chars.val[0] = detail::NibblesToHexNEON(vshrq_n_u8(in, 4), alpha);
+    chars.val[1] = detail::NibblesToHexNEON(vandq_u8(in, vdupq_n_u8(0x0F)), alpha);
+    vst2q_u8(reinterpret_cast<uint8_t*>(dst + pos * 2), chars);
+  }
+#endif
+
+  const char* digits = detail::HexDigits(is_lower);
+  for (; pos < size; ++pos) {
+    detail::EncodeHexPair(src[pos], digits, dst + pos * 2);
+  }
   return Error();
 }
 
-Error DecodeHex(const StringPiece& data, char_buffer_t* out) {
-  if (!utils::hex::decode(data, out)) {
+Error DecodeHex(const StringPiece& data, span<char> out) {
+  const size_t size = HexDecodedSize(data.size());
+  if (data.size() % 2 != 0 || out.size() < size) {
     return make_error_inval();
   }
 
+  const char* src = data.data();
+  uint8_t* dst = reinterpret_cast<uint8_t*>(out.data());
+  size_t pos = 0;
+  bool valid = true;
+#if defined(__AVX2__)
+  __m256i bad256 = _mm256_setzero_si256();
+  for (; pos + 32 <= size; pos += 32) {
+    const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + pos * 2));
+    const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + pos * 2 + 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos), detail::DecodeHex64AVX2(c0, c1, &bad256));
+  }
+  valid = _mm256_movemask_epi8(bad256) == 0;
+#endif
+#if defined(__SSE2__)
+  __m128i bad = _mm_setzero_si128();
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos * 2));
+    const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos * 2 + 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos), detail::DecodeHex32SSE2(c0, c1, &bad));
+  }
+  valid = valid && _mm_movemask_epi8(bad) == 0;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint8x16_t bad = vdupq_n_u8(0);
+  for (; pos + 16 <= size; pos += 16) {
+    const uint8x16x2_t chars = vld2q_u8(reinterpret_cast<const uint8_t*>(src + pos * 2));
+    const uint8x16_t hi = detail::HexToNibblesNEON(chars.val[0], &bad);
+    const uint8x16_t lo = detail::HexToNibblesNEON(chars.val[1], &bad);
+    vst1q_u8(dst + pos, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+  valid = vmaxvq_u8(bad) == 0;
+#endif
+
+  const uint8_t* values = detail::HexValues();
+  uint8_t bad_tail = 0;
+  for (; pos < size; ++pos) {
+    bad_tail |= detail::DecodeHexPair(src + pos * 2, values, dst + pos);
+  }
+
+  if (!valid || bad_tail) {
+    return make_error_inval();
+  }
   return Error();
 }
 
-Error EncodeHex(const char_buffer_t& data, bool is_lower, char_buffer_t* out) {
-  if (!utils::hex::encode(data, is_lower, out)) {
+Error EncodeHex(const StringPiece& data, bool is_lower, char_buffer_t* out) {
+  if (!out) {
     return make_error_inval();
   }
 
-  return Error();
+  out->resize(HexEncodedSize(data.size()));
+  return EncodeHex(data, is_lower, span<char>(out->data(), out->size()));
 }
 
-Error DecodeHex(const char_buffer_t& data, char_buffer_t* out) {
-  if (!utils::hex::decode(data, out)) {
+Error DecodeHex(const StringPiece& data, char_buffer_t* out) {
+  if (!out || data.empty()) {
     return make_error_inval();
   }
 
+  // out is left untouched on invalid input
+  char_buffer_t decoded;
+  decoded.resize(HexDecodedSize(data.size()));
+  Error err = DecodeHex(data, span<char>(decoded.data(), decoded.size()));
+  if (err) {
+    return err;
+  }
+
+  out->swap(decoded);
   return Error();
 }
 
+Error EncodeHex(const char_buffer_t& data, bool is_lower, char_buffer_t* out) {
+  return EncodeHex(StringPiece(data.data(), data.size()), is_lower, out);
+}
+
+Error DecodeHex(const char_buffer_t& data, char_buffer_t* out) {
+  return DecodeHex(StringPiece(data.data(), data.size()), out);
+}
+
 }  // namespace compress
 }  // namespace common
@@ -0,0 +1,193 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace common {
+namespace compress {
+namespace detail {
+
+// Building blocks shared by hex, \xHH and unicode codecs. Digits are computed
+// arithmetically ('0' + n, plus 7 or 39 when n > 9) and validity is
+// accumulated into a mask which is tested once per call, so loops have no
+// data dependent branches.
+
+struct HexDecodeTable {
+  constexpr HexDecodeTable() : values() {
+    for (int i = 0; i < 256; ++i) {
+      values[i] = 0xFF;
+    }
+    for (int i = 0; i < 10; ++i) {
+      values['0' + i] = i;
+    }
+    for (int i = 0; i < 6; ++i) {
+      values['a' + i] = 10 + i;
+      values['A' + i] = 10 + i;
+    }
+  }
+
+  uint8_t values[256];
+};
+
+inline const char* HexDigits(bool is_lower) {
+  return is_lower ? "0123456789abcdef" : "0123456789ABCDEF";
+}
+
+// 0..15 for hex digits, 0xFF otherwise
+inline const uint8_t* HexValues() {
+  static constexpr HexDecodeTable table;
+  return table.values;
+}
+
+// offset from '9' + 1 to 'a' or 'A'
+inline uint8_t HexAlphaOffset(bool is_lower) {
+  return is_lower ? 'a' - '0' - 10 : 'A' - '0' - 10;
+}
+
+inline void EncodeHexPair(uint8_t byte, const char* digits, char* dst) {
+  dst[0] = digits[byte >> 4];
+  dst[1] = digits[byte & 0xF];
+}
+
+// returns non zero high nibble if one of chars isn't a hex digit
+inline uint8_t DecodeHexPair(const char* src, const uint8_t* values, uint8_t* byte) {
+  const uint8_t hi = values[static_cast<uint8_t>(src[0])];
+  const uint8_t lo = values[static_cast<uint8_t>(src[1])];
+  *byte = static_cast<uint8_t>((hi << 4) | (lo & 0xF));
+  return (hi | lo) & 0xF0;
+}
+
+#if defined(__SSE2__)
+inline __m128i NibblesToHexSSE2(__m128i nibbles, __m128i alpha) {
+  const __m128i digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+  return _mm_add_epi8(digits, _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), alpha));
+}
+
+// 16 bytes -> 32 chars in lo (bytes 0..7) and hi (bytes 8..15)
+inline void EncodeHex16SSE2(__m128i in, __m128i alpha, __m128i* lo, __m128i* hi) {
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  const __m128i high = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+  const __m128i low = _mm_and_si128(in, mask);
+  *lo = NibblesToHexSSE2(_mm_unpacklo_epi8(high, low), alpha);
+  *hi = NibblesToHexSSE2(_mm_unpackhi_epi8(high, low), alpha);
+}
+
+// chars -> nibble values, invalid lanes are set in bad
+inline __m128i HexToNibblesSSE2(__m128i chars, __m128i* bad) {
+  const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  const __m128i alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  const __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+  *bad = _mm_or_si128(*bad, _mm_andnot_si128(_mm_or_si128(is_digit, is_alpha), _mm_set1_epi8(-1)));
+  return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                      _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+// 32 chars (c0, c1) -> 16 bytes
+inline __m128i DecodeHex32SSE2(__m128i c0, __m128i c1, __m128i* bad) {
+  const __m128i n0 = HexToNibblesSSE2(c0, bad);
+  const __m128i n1 = HexToNibblesSSE2(c1, bad);
+  const __m128i low_byte = _mm_set1_epi16(0x00FF);
+  // every 16 bit lane holds high nibble in its low byte and low nibble in its high byte
+  const __m128i b0 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n0, low_byte), 4), _mm_srli_epi16(n0, 8));
+  const __m128i b1 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n1, low_byte), 4), _mm_srli_epi16(n1, 8));
+  return _mm_packus_epi16(b0, b1);
+}
+#endif
+
+#if defined(__AVX2__)
+// 32 bytes -> 64 chars
+inline void EncodeHex32AVX2(__m256i in, __m256i alpha, __m256i* lo, __m256i* hi) {
+  const __m256i mask = _mm256_set1_epi8(0x0F);
+  const __m256i high = _mm256_and_si256(_mm256_srli_epi16(in, 4), mask);
+  const __m256i low = _mm256_and_si256(in, mask);
+  const __m256i nine = _mm256_set1_epi8(9);
+  const __m256i zero = _mm256_set1_epi8('0');
+  __m256i a = _mm256_unpacklo_epi8(high, low);
+  __m256i b = _mm256_unpackhi_epi8(high, low);
+  a = _mm256_add_epi8(_mm256_add_epi8(a, zero), _mm256_and_si256(_mm256_cmpgt_epi8(a, nine), alpha));
+  b = _mm256_add_epi8(_mm256_add_epi8(b, zero), _mm256_and_si256(_mm256_cmpgt_epi8(b, nine), alpha));
+  // unpack works inside 128 bit lanes
+  *lo = _mm256_permute2x128_si256(a, b, 0x20);
+  *hi = _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+inline __m256i HexToNibblesAVX2(__m256i chars, __m256i* bad) {
+  const __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+  const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+  const __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+  const __m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+  *bad = _mm256_or_si256(*bad, _mm256_andnot_si256(_mm256_or_si256(is_digit, is_alpha), _mm256_set1_epi8(-1)));
+  return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                         _mm256_and_si256(is_alpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+}
+
+// 64 chars -> 32 bytes
+inline __m256i DecodeHex64AVX2(__m256i c0, __m256i c1, __m256i* bad) {
+  const __m256i n0 = HexToNibblesAVX2(c0, bad);
+  const __m256i n1 = HexToNibblesAVX2(c1, bad);
+  const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+  const __m256i b0 = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n0, low_byte), 4), _mm256_srli_epi16(n0, 8));
+  const __m256i b1 = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n1, low_byte), 4), _mm256_srli_epi16(n1, 8));
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(b0, b1), 0xD8);
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+inline uint8x16_t NibblesToHexNEON(uint8x16_t nibbles, uint8x16_t alpha) {
+  const uint8x16_t digits = vaddq_u8(nibbles, vdupq_n_u8('0'));
+  return vaddq_u8(digits, vandq_u8(vcgtq_u8(nibbles, vdupq_n_u8(9)), alpha));
+}
+
+inline uint8x16_t HexToNibblesNEON(uint8x16_t chars, uint8x16_t* bad) {
+  const uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+  const uint8x16_t is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+  const uint8x16_t alpha = vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  const uint8x16_t is_alpha = vcleq_u8(alpha, vdupq_n_u8(5));
+  *bad = vorrq_u8(*bad, vmvnq_u8(vorrq_u8(is_digit, is_alpha)));
+  return vorrq_u8(vandq_u8(is_digit, digit), vandq_u8(is_alpha, vaddq_u8(alpha, vdupq_n_u8(10))));
+}
+#endif
+
+}  // namespace detail
+}  // namespace compress
+}  // namespace common
@@ -32,98 +32,374 @@
 #if defined(HAVE_LZ4)
 
 #include <lz4.h>
+#include <lz4frame.h>
+#include <string.h>
 
+#include <algorithm>
 #include <limits>
+#include <memory>
+#include <vector>
 
 #include <common/compress/coding.h>
 
+#include "parallel_blocks.h"
+
 namespace common {
 namespace {
-template <typename CHAR, typename STR2>
-Error EncodeLZ4T(const CHAR* input, size_t input_length, bool sized, STR2* output) {
-  if (!input || !output || input_length > std::numeric_limits<uint32_t>::max()) {
-    // Can't compress more than 4GB
+const uint32_t kLZ4UncompressedBlockFlag = 0x80000000U;
+const size_t kLZ4BlockHeaderSize = 4;
+const size_t kLZ4EndMarkSize = 4;
+
+void PutLittleEndian32(uint32_t value, char* out) {
+  out[0] = static_cast<char>(value);
+  out[1] = static_cast<char>(value >> 8);
+  out[2] = static_cast<char>(value >> 16);
+  out[3] = static_cast<char>(value >> 24);
+}
+
+LZ4F_blockSizeID_t LZ4FrameBlockSize(size_t block_size, size_t* frame_block_size) {
+  const struct {
+    LZ4F_blockSizeID_t id;
+    size_t size;
+  } sizes[] = {{LZ4F_max64KB, 64 * 1024}, {LZ4F_max256KB, 256 * 1024}, {LZ4F_max1MB, 1024 * 1024}};
+  for (const auto& candidate : sizes) {
+    if (block_size <= candidate.size) {
+      *frame_block_size = candidate.size;
+      return candidate.id;
+    }
+  }
+  *frame_block_size = 4 * 1024 * 1024;
+  return LZ4F_max4MB;
+}
+
+// Block is stored as is when compression does not pay off, like LZ4F does.
+Error CompressLZ4FrameBlock(const char* input, size_t input_length, char_buffer_t* block) {
+  const int bound = LZ4_compressBound(static_cast<int>(input_length));
+  block->resize(kLZ4BlockHeaderSize + static_cast<size_t>(bound));
+  char* payload = block->data() + kLZ4BlockHeaderSize;
+  const int outlen = LZ4_compress_default(input, payload, static_cast<int>(input_length), bound);
+  if (outlen > 0 && static_cast<size_t>(outlen) < input_length) {
+    PutLittleEndian32(static_cast<uint32_t>(outlen), block->data());
+    block->resize(kLZ4BlockHeaderSize + static_cast<size_t>(outlen));
+    return Error();
+  }
+
+  PutLittleEndian32(static_cast<uint32_t>(input_length) | kLZ4UncompressedBlockFlag, block->data());
+  memcpy(payload, input, input_length);
+  block->resize(kLZ4BlockHeaderSize + input_length);
+  return Error();
+}
+
+Error EncodeLZ4ParallelImpl(const char* input,
+                            size_t input_length,
+                            threads::ThreadPool* pool,
+                            char_buffer_t* output,
+                            size_t block_size) {
+  if (!input || !output || block_size == 0) {
     return make_error_inval();
   }
 
+  LZ4F_preferences_t prefs;
+  memset(&prefs, 0, sizeof(LZ4F_preferences_t));
+  prefs.frameInfo.blockSizeID = LZ4FrameBlockSize(block_size, &block_size);
+  prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+  prefs.frameInfo.contentSize = input_length;
+
+  // LZ4F writes the frame header with its checksum, blocks are ours
+  char header[LZ4F_HEADER_SIZE_MAX];
+  LZ4F_cctx* ctx = nullptr;
+  LZ4F_errorCode_t st = LZ4F_createCompressionContext(&ctx, LZ4F_VERSION);
+  if (LZ4F_isError(st)) {
+    return make_error(std::string("LZ4 compress internal error: ") + LZ4F_getErrorName(st));
+  }
+  const size_t header_size = LZ4F_compressBegin(ctx, header, sizeof(header), &prefs);
+  LZ4F_freeCompressionContext(ctx);
+  if (LZ4F_isError(header_size)) {
+    return make_error(std::string("LZ4 compress internal error: ") + LZ4F_getErrorName(header_size));
+  }
+
+  const size_t blocks_count = input_length == 0 ? 0 : compress::detail::BlocksCount(input_length, block_size);
+  std::vector<char_buffer_t> blocks(blocks_count);
+  Error err = compress::detail::RunBlocks(pool, blocks_count, [&](size_t index) {
+    const size_t offset = index * block_size;
+    return CompressLZ4FrameBlock(input + offset, std::min(block_size, input_length - offset), &blocks[index]);
+  });
+  if (err) {
+    return err;
+  }
+
+  size_t total = header_size + kLZ4EndMarkSize;
+  for (const char_buffer_t& block : blocks) {
+    total += block.size();
+  }
+
   output->clear();
-  int stabled_input_size = static_cast<int>(input_length);
-  size_t output_header_len;
-  if (sized) {
-    output_header_len = compress::PutDecompressedSizeInfo(output, static_cast<uint32_t>(input_length));
-  } else {
-    output_header_len = 0;
+  output->resize(total);
+  char* out = output->data();
+  memcpy(out, header, header_size);
+  size_t pos = header_size;
+  for (const char_buffer_t& block : blocks) {
+    memcpy(out + pos, block.data(), block.size());
+    pos += block.size();
   }
+  PutLittleEndian32(0, out + pos);
+  return Error();
+}
 
-  int compress_bound = LZ4_compressBound(stabled_input_size);
-  output->resize(static_cast<size_t>(output_header_len + compress_bound));
+Error DecodeLZ4FrameImpl(const char* input, size_t input_length, char_buffer_t* out) {
+  if (!input || !out) {
+    return make_error_inval();
+  }
 
-  const char* stabled_input = reinterpret_cast<const char*>(input);
-  char* stabled_output = reinterpret_cast<char*>(&(*output)[output_header_len]);
-#if LZ4_VERSION_NUMBER >= 10700  // r129+
-  int outlen = LZ4_compress_default(stabled_input, stabled_output, stabled_input_size, compress_bound);
-#else
-  int outlen = LZ4_compress(stabled_input, stabled_output, stabled_input_size);
-#endif
+  LZ4F_dctx* ctx = nullptr;
+  LZ4F_errorCode_t st = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
+  if (LZ4F_isError(st)) {
+    return make_error(std::string("LZ4 decompress internal error: ") + LZ4F_getErrorName(st));
+  }
 
-  if (outlen == 0) {
-    return make_error("LZ4 compress internal error");
+  LZ4F_frameInfo_t info;
+  memset(&info, 0, sizeof(LZ4F_frameInfo_t));
+  size_t consumed = input_length;
+  st = LZ4F_getFrameInfo(ctx, &info, input, &consumed);
+  if (LZ4F_isError(st)) {
+    LZ4F_freeDecompressionContext(ctx);
+    return make_error(std::string("LZ4 decompress internal error: ") + LZ4F_getErrorName(st));
   }
-  output->resize(static_cast<size_t>(output_header_len + outlen));
+
+  char_buffer_t result;
+  result.resize(info.contentSize ? static_cast<size_t>(info.contentSize) : input_length * 4 + 64);
+  size_t in_pos = consumed;
+  size_t out_pos = 0;
+  size_t hint = 1;
+  while (in_pos < input_length || hint != 0) {
+    if (out_pos == result.size()) {
+      result.resize(result.size() * 2);
+    }
+    size_t dst_size = result.size() - out_pos;
+    size_t src_size = input_length - in_pos;
+    hint = LZ4F_decompress(ctx, result.data() + out_pos, &dst_size, input + in_pos, &src_size, nullptr);
+    if (LZ4F_isError(hint)) {
+      LZ4F_freeDecompressionContext(ctx);
+      return make_error(std::string("LZ4 decompress internal error: ") + LZ4F_getErrorName(hint));
+    }
+    in_pos += src_size;
+    out_pos += dst_size;
+    if (src_size == 0 && dst_size == 0) {
+      break;
+    }
+  }
+  LZ4F_freeDecompressionContext(ctx);
+  if (hint != 0) {
+    return make_error("LZ4 decompress truncated frame");
+  }
+
+  result.resize(out_pos);
+  *out = std::move(result);
   return Error();
 }
 
-template <typename CHAR, typename STR2>
-Error DecodeLZ4T(const CHAR* input, size_t input_length, bool sized, STR2* out) {
+compress::LZ4Compressor* ThreadCompressor() {
+  static thread_local std::unique_ptr<compress::LZ4Compressor> compressor(new compress::LZ4Compressor);
+  return compressor.get();
+}
+
+compress::LZ4Compressor* ThreadCompressor(const compress::CompressDictionarySPtr& dictionary) {
+  static thread_local std::unique_ptr<compress::LZ4Compressor> compressor;
+  if (!compressor || compressor->GetDictionary() != dictionary) {
+    compressor.reset(new compress::LZ4Compressor(dictionary));
+  }
+  return compressor.get();
+}
+
+Error DecodeLZ4Impl(const StringPiece& data,
+                    bool sized,
+                    const compress::CompressDictionary* dictionary,
+                    char_buffer_t* out) {
+  const char* input = data.data();
+  size_t input_length = data.size();
   if (!input || !out) {
     return make_error_inval();
   }
 
   uint32_t output_len = 0;
-  if (sized) {
+  if (sized && dictionary) {
+    uint32_t dictionary_id = 0;
+    if (!compress::GetDecompressedSizeInfo(&input, &input_length, &output_len, &dictionary_id)) {
+      return make_error_inval();
+    }
+    if (dictionary_id != dictionary->GetID()) {
+      return make_error("LZ4 dictionary mismatch");
+    }
+  } else if (sized) {
     // new encoding, using varint32 to store size information
     if (!compress::GetDecompressedSizeInfo(&input, &input_length, &output_len)) {
       return make_error_inval();
     }
   } else {
-    output_len = input_length * 8;  // may be help
+    output_len = static_cast<uint32_t>(std::min<size_t>(input_length * 8, LZ4_MAX_INPUT_SIZE));  // may be help
   }
 
-  CHAR* output = new CHAR[output_len];
-  const char* stabled_input = reinterpret_cast<const char*>(input);
-  char* stabled_output = reinterpret_cast<char*>(output);
-  int decompress_size =
-      LZ4_decompress_safe(stabled_input, stabled_output, static_cast<int>(input_length), static_cast<int>(output_len));
+  // Decompress straight into the caller buffer, no temporary copy.
+  out->resize(output_len);
+  int decompress_size;
+  if (dictionary) {
+    const char_buffer_t& content = dictionary->GetContent();
+    decompress_size =
+        LZ4_decompress_safe_usingDict(input, out->data(), static_cast<int>(input_length), static_cast<int>(output_len),
+                                      content.data(), static_cast<int>(content.size()));
+  } else {
+    decompress_size =
+        LZ4_decompress_safe(input, out->data(), static_cast<int>(input_length), static_cast<int>(output_len));
+  }
   if (decompress_size < 0) {
-    delete[] output;
+    out->clear();
     return make_error("LZ4 decompress_size internal error");
   }
 
   if (sized) {
     DCHECK(decompress_size == static_cast<int>(output_len));
   }
-  *out = STR2(output, output + decompress_size);
-  delete[] output;
+  out->resize(static_cast<size_t>(decompress_size));
   return Error();
 }
+
 }  // namespace
 
 namespace compress {
 
+LZ4Compressor::LZ4Compressor(CompressDictionarySPtr dictionary)
+    : stream_(LZ4_createStream()), dictionary_stream_(nullptr), dictionary_(dictionary) {
+  if (dictionary_) {
+    const char_buffer_t& content = dictionary_->GetContent();
+    dictionary_stream_ = LZ4_createStream();
+    if (dictionary_stream_) {
+      LZ4_loadDict(dictionary_stream_, content.data(), static_cast<int>(content.size()));
+    }
+  }
+}
+
+LZ4Compressor::~LZ4Compressor() {
+  LZ4_freeStream(dictionary_stream_);
+  LZ4_freeStream(stream_);
+}
+
+CompressDictionarySPtr LZ4Compressor::GetDictionary() const {
+  return dictionary_;
+}
+
+Error LZ4Compressor::Encode(const StringPiece& data, bool sized, char_buffer_t* out) {
+  if (!data.data() || !out || data.size() > LZ4_MAX_INPUT_SIZE) {
+    return make_error_inval();
+  }
+
+  if (!stream_ || (dictionary_ && !dictionary_stream_)) {
+    return make_error("LZ4 compress internal error");
+  }
+
+  const size_t start = out->size();
+  if (sized && dictionary_) {
+    PutDecompressedSizeInfo(out, static_cast<uint32_t>(data.size()), dictionary_->GetID());
+  } else if (sized) {
+    PutDecompressedSizeInfo(out, static_cast<uint32_t>(data.size()));
+  }
+
+  const size_t header_end = out->size();
+  const int input_size = static_cast<int>(data.size());
+  const int compress_bound = LZ4_compressBound(input_size);
+  out->resize(header_end + static_cast<size_t>(compress_bound));
+  if (dictionary_) {
+    // Copying the loaded state is far cheaper than hashing the dictionary
+    // again (LZ4_attach_dictionary is not exported by shared liblz4).
+#if LZ4_VERSION_NUMBER >= 10900
+    memcpy(stream_, dictionary_stream_, sizeof(LZ4_stream_t));
+#else
+    const char_buffer_t& content = dictionary_->GetContent();
+    LZ4_loadDict(stream_, content.data(), static_cast<int>(content.size()));
+#endif
+  } else {
+    // A fast reset only clears what the previous message touched, instead of
+    // zeroing the whole 16KB hash table like LZ4_compress_default does.
+#if LZ4_VERSION_NUMBER >= 10900
+    LZ4_resetStream_fast(stream_);
+#else
+    LZ4_resetStream(stream_);
+#endif
+  }
+  const int outlen =
+      LZ4_compress_fast_continue(stream_, data.data(), out->data() + header_end, input_size, compress_bound, 1);
+  if (outlen <= 0) {
+    out->resize(start);
+    return make_error("LZ4 compress internal error");
+  }
+
+  out->resize(header_end + static_cast<size_t>(outlen));
+  return Error();
+}
+
+Error LZ4Compressor::Encode(const char_buffer_t& data, bool sized, char_buffer_t* out) {
+  return Encode(StringPiece(data.data(), data.size()), sized, out);
+}
+
 Error EncodeLZ4(const StringPiece& data, bool sized, char_buffer_t* out) {
-  return EncodeLZ4T(data.data(), data.size(), sized, out);
+  if (!out) {
+    return make_error_inval();
+  }
+
+  out->clear();
+  return ThreadCompressor()->Encode(data, sized, out);
 }
 
 Error DecodeLZ4(const StringPiece& data, bool sized, char_buffer_t* out) {
-  return DecodeLZ4T(data.data(), data.size(), sized, out);
+  return DecodeLZ4Impl(data, sized, nullptr, out);
 }
 
 Error EncodeLZ4(const char_buffer_t& data, bool sized, char_buffer_t* out) {
-  return EncodeLZ4T(data.data(), data.size(), sized, out);
+  return EncodeLZ4(StringPiece(data.data(), data.size()), sized, out);
 }
 
 Error DecodeLZ4(const char_buffer_t& data, bool sized, char_buffer_t* out) {
-  return DecodeLZ4T(data.data(), data.size(), sized, out);
+  return DecodeLZ4(StringPiece(data.data(), data.size()), sized, out);
+}
+
+Error EncodeLZ4(const StringPiece& data, bool sized, const CompressDictionarySPtr& dictionary, char_buffer_t* out) {
+  if (!out || !dictionary) {
+    return make_error_inval();
+  }
+
+  out->clear();
+  return ThreadCompressor(dictionary)->Encode(data, sized, out);
+}
+
+Error DecodeLZ4(const StringPiece& data, bool sized, const CompressDictionarySPtr& dictionary, char_buffer_t* out) {
+  if (!dictionary) {
+    return make_error_inval();
+  }
+
+  return DecodeLZ4Impl(data, sized, dictionary.get(), out);
+}
+
+Error EncodeLZ4(const char_buffer_t& data, bool sized, const CompressDictionarySPtr& dictionary, char_buffer_t* out) {
+  return EncodeLZ4(StringPiece(data.data(), data.size()), sized, dictionary, out);
+}
+
+Error DecodeLZ4(const char_buffer_t& data, bool sized, const CompressDictionarySPtr& dictionary, char_buffer_t* out) {
+  return DecodeLZ4(StringPiece(data.data(), data.size()), sized, dictionary, out);
+}
+
+Error EncodeLZ4Parallel(const StringPiece& data, threads::ThreadPool* pool, char_buffer_t* out, size_t block_size) {
+  return EncodeLZ4ParallelImpl(data.data(), data.size(), pool, out, block_size);
+}
+
+Error DecodeLZ4Frame(const StringPiece& data, char_buffer_t* out) {
+  return DecodeLZ4FrameImpl(data.data(), data.size(), out);
+}
+
+Error EncodeLZ4Parallel(const char_buffer_t& data, threads::ThreadPool* pool, char_buffer_t* out, size_t block_size) {
+  return EncodeLZ4ParallelImpl(data.data(), data.size(), pool, out, block_size);
+}
+
+Error DecodeLZ4Frame(const char_buffer_t& data, char_buffer_t* out) {
+  return DecodeLZ4FrameImpl(data.data(), data.size(), out);
 }
 
 }  // namespace compress
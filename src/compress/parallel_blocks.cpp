@@ -0,0 +1,121 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "parallel_blocks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <common/threads/thread_pool.h>
+
+namespace common {
+namespace compress {
+namespace detail {
+
+namespace {
+
+class BlocksJob {
+ public:
+  BlocksJob(size_t blocks_count, block_task_t task)
+      : task_(task), blocks_count_(blocks_count), next_(0), done_(0), errors_(blocks_count) {}
+
+  void Work() {
+    while (true) {
+      const size_t index = next_.fetch_add(1);
+      if (index >= blocks_count_) {
+        return;
+      }
+      errors_[index] = task_(index);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (++done_ == blocks_count_) {
+        finished_.notify_all();
+      }
+    }
+  }
+
+  Error Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (done_ != blocks_count_) {
+      finished_.wait(lock);
+    }
+    for (const Error& err : errors_) {
+      if (err) {
+        return err;
+      }
+    }
+    return Error();
+  }
+
+ private:
+  const block_task_t task_;
+  const size_t blocks_count_;
+  std::atomic<size_t> next_;
+  size_t done_;
+  std::vector<Error> errors_;
+  std::mutex mutex_;
+  std::condition_variable finished_;
+};
+
+}  // namespace
+
+Error RunBlocks(threads::ThreadPool* pool, size_t blocks_count, block_task_t task) {
+  if (!task) {
+    return make_error_inval();
+  }
+
+  if (!pool || blocks_count < 2) {
+    for (size_t i = 0; i < blocks_count; ++i) {
+      Error err = task(i);
+      if (err) {
+        return err;
+      }
+    }
+    return Error();
+  }
+
+  // helpers which start after all blocks are claimed return at once, the job
+  // is shared so it outlives them
+  std::shared_ptr<BlocksJob> job = std::make_shared<BlocksJob>(blocks_count, task);
+  const size_t helpers = std::min<size_t>(blocks_count - 1, std::max(1u, std::thread::hardware_concurrency()));
+  for (size_t i = 0; i < helpers; ++i) {
+    pool->Post([job]() { job->Work(); });
+  }
+  job->Work();
+  return job->Wait();
+}
+
+}  // namespace detail
+}  // namespace compress
+}  // namespace common
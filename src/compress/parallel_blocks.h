@@ -0,0 +1,60 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <functional>
+
+#include <common/error.h>
+
+namespace common {
+namespace threads {
+class ThreadPool;
+}
+namespace compress {
+namespace detail {
+
+typedef std::function<Error(size_t block_index)> block_task_t;
+
+inline size_t BlocksCount(size_t input_length, size_t block_size) {
+  // empty input still produces one (empty) block, containers need it
+  return input_length == 0 ? 1 : (input_length + block_size - 1) / block_size;
+}
+
+// Calls |task| once for every index in [0, blocks_count). Blocks are claimed
+// by the calling thread and by helpers posted to |pool| (when not null), so
+// progress never depends on free pool workers. Returns the error of the first
+// failed block.
+Error RunBlocks(threads::ThreadPool* pool, size_t blocks_count, block_task_t task) WARN_UNUSED_RESULT;
+
+}  // namespace detail
+}  // namespace compress
+}  // namespace common
@@ -59,20 +59,21 @@ Error DecodeSnappyT(const CHAR* input, size_t input_length, STR2* out) {
   }
 
   const char* stabled_input = reinterpret_cast<const char*>(input);
-  std::string lout;
-  bool is_ok = snappy::Uncompress(stabled_input, input_length, &lout);
-  if (!is_ok) {
-    size_t uncompressed_len;
-    bool get_un = snappy::GetUncompressedLength(stabled_input, input_length, &uncompressed_len);
-    if (get_un) {
-      size_t diff = input_length - uncompressed_len;
-      *out = STR2(stabled_input + diff, stabled_input + input_length);
-      return Error();
-    }
+  size_t uncompressed_len;
+  if (!snappy::GetUncompressedLength(stabled_input, input_length, &uncompressed_len)) {
     return make_error_inval();
   }
 
-  *out = STR2(lout.begin(), lout.end());
+  // Uncompress straight into the caller buffer instead of a temporary string.
+  out->resize(uncompressed_len);
+  if (uncompressed_len && !snappy::RawUncompress(stabled_input, input_length, reinterpret_cast<char*>(&(*out)[0]))) {
+    if (uncompressed_len > input_length) {
+      out->clear();
+      return make_error_inval();
+    }
+    size_t diff = input_length - uncompressed_len;
+    *out = STR2(stabled_input + diff, stabled_input + input_length);
+  }
   return Error();
 }
 }  // namespace
@@ -29,24 +29,120 @@
 
 #include <common/compress/unicode.h>
 
-#include <common/convert2string.h>
+#include "hex_simd.h"
 
 namespace common {
 namespace compress {
 
-Error EncodeUnicode(const StringPiece16& data, bool is_lower, char_buffer_t* out) {
-  if (!utils::unicode::encode(data, is_lower, out)) {
+Error EncodeUnicode(const StringPiece16& data, bool is_lower, span<char> out) {
+  const size_t size = data.size();
+  if (out.size() < UnicodeEncodedSize(size)) {
     return make_error_inval();
   }
 
+  const char16* src = data.data();
+  char* dst = out.data();
+  size_t pos = 0;
+#if defined(__SSE2__)
+  const __m128i alpha = _mm_set1_epi8(detail::HexAlphaOffset(is_lower));
+  for (; pos + 8 <= size; pos += 8) {
+    const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos));
+    // big endian units are plain hex of the swapped bytes
+    const __m128i swapped = _mm_or_si128(_mm_slli_epi16(in, 8), _mm_srli_epi16(in, 8));
+    __m128i lo, hi;
+    detail::EncodeHex16SSE2(swapped, alpha, &lo, &hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos * 4), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos * 4 + 16), hi);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t alpha = vdupq_n_u8(detail::HexAlphaOffset(is_lower));
+  for (; pos + 8 <= size; pos += 8) {
+    const uint8x16_t in = vrev16q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(src + pos)));
+    uint8x16x2_t chars;
+    chars.val[0] = detail::NibblesToHexNEON(vshrq_n_u8(in, 4), alpha);
+    chars.val[1] = detail::NibblesToHexNEON(vandq_u8(in, vdupq_n_u8(0x0F)), alpha);
+    vst2q_u8(reinterpret_cast<uint8_t*>(dst + pos * 4), chars);
+  }
+#endif
+
+  const char* digits = detail::HexDigits(is_lower);
+  for (; pos < size; ++pos) {
+    const uint16_t unit = src[pos];
+    detail::EncodeHexPair(unit >> 8, digits, dst + pos * 4);
+    detail::EncodeHexPair(unit & 0xFF, digits, dst + pos * 4 + 2);
+  }
+  return Error();
+}
+
+Error DecodeUnicode(const StringPiece& data, span<char16> out) {
+  const size_t size = UnicodeDecodedSize(data.size());
+  if (data.size() % 4 != 0 || out.size() < size) {
+    return make_error_inval();
+  }
+
+  const char* src = data.data();
+  char16* dst = out.data();
+  size_t pos = 0;
+  bool valid = true;
+#if defined(__SSE2__)
+  __m128i bad = _mm_setzero_si128();
+  for (; pos + 8 <= size; pos += 8) {
+    const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos * 4));
+    const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos * 4 + 16));
+    const __m128i bytes = detail::DecodeHex32SSE2(c0, c1, &bad);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos),
+                     _mm_or_si128(_mm_slli_epi16(bytes, 8), _mm_srli_epi16(bytes, 8)));
+  }
+  valid = _mm_movemask_epi8(bad) == 0;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint8x16_t bad = vdupq_n_u8(0);
+  for (; pos + 8 <= size; pos += 8) {
+    const uint8x16x2_t chars = vld2q_u8(reinterpret_cast<const uint8_t*>(src + pos * 4));
+    const uint8x16_t hi = detail::HexToNibblesNEON(chars.val[0], &bad);
+    const uint8x16_t lo = detail::HexToNibblesNEON(chars.val[1], &bad);
+    vst1q_u8(reinterpret_cast<uint8_t*>(dst + pos), vrev16q_u8(vorrq_u8(vshlq_n_u8(hi, 4), lo)));
+  }
+  valid = vmaxvq_u8(bad) == 0;
+#endif
+
+  const uint8_t* values = detail::HexValues();
+  uint8_t bad_tail = 0;
+  for (; pos < size; ++pos) {
+    uint8_t hi = 0;
+    uint8_t lo = 0;
+    bad_tail |= detail::DecodeHexPair(src + pos * 4, values, &hi);
+    bad_tail |= detail::DecodeHexPair(src + pos * 4 + 2, values, &lo);
+    dst[pos] = static_cast<char16>((hi << 8) | lo);
+  }
+
+  if (!valid || bad_tail) {
+    return make_error_inval();
+  }
   return Error();
 }
 
+Error EncodeUnicode(const StringPiece16& data, bool is_lower, char_buffer_t* out) {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  out->resize(UnicodeEncodedSize(data.size()));
+  return EncodeUnicode(data, is_lower, span<char>(out->data(), out->size()));
+}
+
 Error DecodeUnicode(const StringPiece& data, string16* out) {
-  if (!utils::unicode::decode(data, out)) {
+  if (!out || data.empty()) {
     return make_error_inval();
   }
 
+  // out is left untouched on invalid input
+  string16 decoded(UnicodeDecodedSize(data.size()), 0);
+  Error err = DecodeUnicode(data, span<char16>(&decoded[0], decoded.size()));
+  if (err) {
+    return err;
+  }
+
+  out->swap(decoded);
   return Error();
 }
 
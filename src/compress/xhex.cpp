@@ -29,42 +29,135 @@
 
 #include <common/compress/xhex.h>
 
-#include <common/convert2string.h>
+#include "hex_simd.h"
 
 namespace common {
 namespace compress {
 
-Error EncodeXHex(const StringPiece& data, bool is_lower, char_buffer_t* out) {
-  if (!utils::xhex::encode(data, is_lower, out)) {
+Error EncodeXHex(const StringPiece& data, bool is_lower, span<char> out) {
+  const size_t size = data.size();
+  if (out.size() < XHexEncodedSize(size)) {
     return make_error_inval();
   }
 
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(data.data());
+  char* dst = out.data();
+  const char x = is_lower ? 'x' : 'X';
+  size_t pos = 0;
+#if defined(__SSE2__)
+  const __m128i alpha = _mm_set1_epi8(detail::HexAlphaOffset(is_lower));
+  const __m128i prefix = _mm_set1_epi16(static_cast<int16_t>('\\' | (x << 8)));
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i lo, hi;
+    detail::EncodeHex16SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos)), alpha, &lo, &hi);
+    // interleave "\x" with every pair of digits
+    __m128i* wdst = reinterpret_cast<__m128i*>(dst + pos * 4);
+    _mm_storeu_si128(wdst, _mm_unpacklo_epi16(prefix, lo));
+    _mm_storeu_si128(wdst + 1, _mm_unpackhi_epi16(prefix, lo));
+    _mm_storeu_si128(wdst + 2, _mm_unpacklo_epi16(prefix, hi));
+    _mm_storeu_si128(wdst + 3, _mm_unpackhi_epi16(prefix, hi));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t alpha = vdupq_n_u8(detail::HexAlphaOffset(is_lower));
+  uint8x16x4_t chars;
+  chars.val[0] = vdupq_n_u8('\\');
+  chars.val[1] = vdupq_n_u8(x);
+  for (; pos + 16 <= size; pos += 16) {
+    const uint8x16_t in = vld1q_u8(src + pos);
+    chars.val[2] = detail::NibblesToHexNEON(vshrq_n_u8(in, 4), alpha);
+    chars.val[3] = detail::NibblesToHexNEON(vandq_u8(in, vdupq_n_u8(0x0F)), alpha);
+    vst4q_u8(reinterpret_cast<uint8_t*>(dst + pos * 4), chars);
+  }
+#endif
+
+  const char* digits = detail::HexDigits(is_lower);
+  for (; pos < size; ++pos) {
+    dst[pos * 4] = '\\';
+    dst[pos * 4 + 1] = x;
+    detail::EncodeHexPair(src[pos], digits, dst + pos * 4 + 2);
+  }
   return Error();
 }
 
-Error DecodeXHex(const StringPiece& data, char_buffer_t* out) {
-  if (!utils::xhex::decode(data, out)) {
+// as before only digits are validated, the 2 prefix chars of every byte are skipped
+Error DecodeXHex(const StringPiece& data, span<char> out) {
+  const size_t size = XHexDecodedSize(data.size());
+  if (data.size() % 4 != 0 || out.size() < size) {
     return make_error_inval();
   }
 
+  const char* src = data.data();
+  uint8_t* dst = reinterpret_cast<uint8_t*>(out.data());
+  size_t pos = 0;
+  bool valid = true;
+#if defined(__SSE2__)
+  __m128i bad = _mm_setzero_si128();
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i* wsrc = reinterpret_cast<const __m128i*>(src + pos * 4);
+    // keep the high 16 bits (digits) of every 32 bit "\xHH", non ascii digits saturate to invalid values
+    const __m128i p0 = _mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(wsrc), 16),
+                                       _mm_srli_epi32(_mm_loadu_si128(wsrc + 1), 16));
+    const __m128i p1 = _mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(wsrc + 2), 16),
+                                       _mm_srli_epi32(_mm_loadu_si128(wsrc + 3), 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos), detail::DecodeHex32SSE2(p0, p1, &bad));
+  }
+  valid = _mm_movemask_epi8(bad) == 0;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint8x16_t bad = vdupq_n_u8(0);
+  for (; pos + 16 <= size; pos += 16) {
+    const uint8x16x4_t chars = vld4q_u8(reinterpret_cast<const uint8_t*>(src + pos * 4));
+    const uint8x16_t hi = detail::HexToNibblesNEON(chars.val[2], &bad);
+    const uint8x16_t lo = detail::HexToNibblesNEON(chars.val[3], &bad);
+    vst1q_u8(dst + pos, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+  valid = vmaxvq_u8(bad) == 0;
+#endif
+
+  const uint8_t* values = detail::HexValues();
+  uint8_t bad_tail = 0;
+  for (; pos < size; ++pos) {
+    bad_tail |= detail::DecodeHexPair(src + pos * 4 + 2, values, dst + pos);
+  }
+
+  if (!valid || bad_tail) {
+    return make_error_inval();
+  }
   return Error();
 }
 
-Error EncodeXHex(const char_buffer_t& data, bool is_lower, char_buffer_t* out) {
-  if (!utils::xhex::encode(data, is_lower, out)) {
+Error EncodeXHex(const StringPiece& data, bool is_lower, char_buffer_t* out) {
+  if (!out) {
     return make_error_inval();
   }
 
-  return Error();
+  out->resize(XHexEncodedSize(data.size()));
+  return EncodeXHex(data, is_lower, span<char>(out->data(), out->size()));
 }
 
-Error DecodeXHex(const char_buffer_t& data, char_buffer_t* out) {
-  if (!utils::xhex::decode(data, out)) {
+Error DecodeXHex(const StringPiece& data, char_buffer_t* out) {
+  if (!out || data.empty()) {
     return make_error_inval();
   }
 
+  // out is left untouched on invalid input
+  char_buffer_t decoded;
+  decoded.resize(XHexDecodedSize(data.size()));
+  Error err = DecodeXHex(data, span<char>(decoded.data(), decoded.size()));
+  if (err) {
+    return err;
+  }
+
+  out->swap(decoded);
   return Error();
 }
 
+Error EncodeXHex(const char_buffer_t& data, bool is_lower, char_buffer_t* out) {
+  return EncodeXHex(StringPiece(data.data(), data.size()), is_lower, out);
+}
+
+Error DecodeXHex(const char_buffer_t& data, char_buffer_t* out) {
+  return DecodeXHex(StringPiece(data.data(), data.size()), out);
+}
+
 }  // namespace compress
 }  // namespace common
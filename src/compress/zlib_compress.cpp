@@ -33,9 +33,14 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
 #include <common/compress/coding.h>
 
-#include <limits>
+#include "parallel_blocks.h"
 
 #define WINDOW_BITS 15
 #define GZIP_ENCODING 16
@@ -45,184 +50,434 @@ namespace compress {
 
 namespace {
 
-template <typename CHAR, typename STR2>
-Error EncodeZlibT(const CHAR* input,
-                  size_t input_length,
-                  bool sized,
-                  uint8_t def,
-                  STR2* output,
-                  int compression_level) {
-  if (!input || !output || input_length > std::numeric_limits<uint32_t>::max()) {
-    // Can't compress more than 4GB
+const int kMemLevel = 8;
+const size_t kGzipHeaderSize = 10;
+const size_t kGzipTrailerSize = 8;
+const size_t kZlibHeaderSize = 2;
+const size_t kZlibTrailerSize = 4;
+// empty stored block emitted by Z_SYNC_FLUSH, not counted by deflateBound
+const size_t kSyncFlushMarkerSize = 5;
+
+struct DeflateBlock {
+  char_buffer_t data;
+  uLong check;
+};
+
+Error DeflateRawBlock(const char* input, size_t input_length, bool last, int compression_level, DeflateBlock* block) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(z_stream));
+  int st = deflateInit2(&stream, compression_level, Z_DEFLATED, -WINDOW_BITS, kMemLevel, Z_DEFAULT_STRATEGY);
+  if (st != Z_OK) {
+    return make_error("ZLIB compress internal error");
+  }
+
+  const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+  block->data.resize(deflateBound(&stream, static_cast<uLong>(input_length)) + kSyncFlushMarkerSize);
+  stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input));
+  stream.avail_in = static_cast<uInt>(input_length);
+  stream.next_out = reinterpret_cast<Bytef*>(block->data.data());
+  stream.avail_out = static_cast<uInt>(block->data.size());
+  st = deflate(&stream, flush);
+  const bool done = last ? st == Z_STREAM_END : st == Z_OK && stream.avail_out != 0;
+  if (!done) {
+    deflateEnd(&stream);
+    return make_error("ZLIB compress internal error");
+  }
+
+  block->data.resize(block->data.size() - stream.avail_out);
+  deflateEnd(&stream);
+  return Error();
+}
+
+int ZlibHeaderLevel(int compression_level) {
+  if (compression_level == Z_DEFAULT_COMPRESSION || compression_level == 6) {
+    return 2;
+  }
+  if (compression_level < 2) {
+    return 0;
+  }
+  return compression_level < 6 ? 1 : 3;
+}
+
+void PutBigEndian32(uint32_t value, char* out) {
+  out[0] = static_cast<char>(value >> 24);
+  out[1] = static_cast<char>(value >> 16);
+  out[2] = static_cast<char>(value >> 8);
+  out[3] = static_cast<char>(value);
+}
+
+void PutLittleEndian32(uint32_t value, char* out) {
+  out[0] = static_cast<char>(value);
+  out[1] = static_cast<char>(value >> 8);
+  out[2] = static_cast<char>(value >> 16);
+  out[3] = static_cast<char>(value >> 24);
+}
+
+Error EncodeZlibParallelImpl(const char* input,
+                             size_t input_length,
+                             bool sized,
+                             uint8_t def,
+                             threads::ThreadPool* pool,
+                             char_buffer_t* output,
+                             int compression_level,
+                             size_t block_size) {
+  if (!input || !output || block_size == 0 || block_size > std::numeric_limits<uInt>::max()) {
     return make_error_inval();
   }
+  if (sized && input_length > std::numeric_limits<uint32_t>::max()) {
+    return make_error_inval();
+  }
+
+  const bool gzip = (def & GZIP_ENCODING) != 0;
+  const size_t blocks_count = detail::BlocksCount(input_length, block_size);
+  std::vector<DeflateBlock> blocks(blocks_count);
+  Error err = detail::RunBlocks(pool, blocks_count, [&](size_t index) {
+    const size_t offset = index * block_size;
+    const size_t length = std::min(block_size, input_length - offset);
+    DeflateBlock* block = &blocks[index];
+    const Bytef* data = reinterpret_cast<const Bytef*>(input + offset);
+    block->check = gzip ? crc32(0, data, static_cast<uInt>(length)) : adler32(1, data, static_cast<uInt>(length));
+    return DeflateRawBlock(input + offset, length, index + 1 == blocks_count, compression_level, block);
+  });
+  if (err) {
+    return err;
+  }
+
+  uLong check = blocks[0].check;
+  size_t total = gzip ? kGzipHeaderSize + kGzipTrailerSize : kZlibHeaderSize + kZlibTrailerSize;
+  total += blocks[0].data.size();
+  for (size_t i = 1; i < blocks_count; ++i) {
+    const z_off_t length = static_cast<z_off_t>(std::min(block_size, input_length - i * block_size));
+    check = gzip ? crc32_combine(check, blocks[i].check, length) : adler32_combine(check, blocks[i].check, length);
+    total += blocks[i].data.size();
+  }
 
   output->clear();
-  size_t output_header_len;
-  uint32_t output_len = 0;
-  if (sized) {
-    output_header_len = compress::PutDecompressedSizeInfo(output, static_cast<uint32_t>(input_length));
+  size_t pos = sized ? compress::PutDecompressedSizeInfo(output, static_cast<uint32_t>(input_length)) : 0;
+  output->resize(pos + total);
+  char* out = output->data();
+  if (gzip) {
+    // no name, no mtime, unix
+    const char header[kGzipHeaderSize] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3};
+    memcpy(out + pos, header, kGzipHeaderSize);
+    pos += kGzipHeaderSize;
   } else {
-    output_header_len = 0;
+    const unsigned cmf = 0x78;  // deflate, 32K window
+    unsigned flg = ZlibHeaderLevel(compression_level) << 6;
+    flg += 31 - (cmf * 256 + flg) % 31;
+    out[pos++] = static_cast<char>(cmf);
+    out[pos++] = static_cast<char>(flg);
   }
 
-  // Resize output to be the plain data length.
-  // This may not be big enough if the compression actually expands data.
-  output_len = output_header_len + input_length;
-  output->resize(output_len);
+  for (const DeflateBlock& block : blocks) {
+    memcpy(out + pos, block.data.data(), block.data.size());
+    pos += block.data.size();
+  }
 
-  // The memLevel parameter specifies how much memory should be allocated for
-  // the internal compression state.
-  // memLevel=1 uses minimum memory but is slow and reduces compression ratio.
-  // memLevel=9 uses maximum memory for optimal speed.
-  // The default value is 8. See zconf.h for more details.
-  static const int mem_level = 8;
-  z_stream _stream;
-  memset(&_stream, 0, sizeof(z_stream));
+  if (gzip) {
+    PutLittleEndian32(static_cast<uint32_t>(check), out + pos);
+    PutLittleEndian32(static_cast<uint32_t>(input_length), out + pos + 4);
+  } else {
+    PutBigEndian32(static_cast<uint32_t>(check), out + pos);
+  }
+  return Error();
+}
 
-  int st = deflateInit2(&_stream, compression_level, Z_DEFLATED, WINDOW_BITS | def, mem_level, Z_DEFAULT_STRATEGY);
-  if (st != Z_OK) {
-    return make_error("ZLIB compress internal error");
+// One context per thread for the plain functions, rebuilt only when the
+// parameters change.
+// Dictionary contexts live in their own slot, so mixed traffic does not
+// rebuild the plain one.
+ZlibCompressor* ThreadCompressor(uint8_t def, int compression_level) {
+  static thread_local std::unique_ptr<ZlibCompressor> compressor;
+  if (!compressor || compressor->GetDeflate() != def || compressor->GetCompressionLevel() != compression_level) {
+    compressor.reset(new ZlibCompressor(def, compression_level));
+  }
+  return compressor.get();
+}
+
+ZlibCompressor* ThreadCompressor(const CompressDictionarySPtr& dictionary, int compression_level) {
+  static thread_local std::unique_ptr<ZlibCompressor> compressor;
+  if (!compressor || compressor->GetDictionary() != dictionary ||
+      compressor->GetCompressionLevel() != compression_level) {
+    compressor.reset(new ZlibCompressor(0, compression_level, dictionary));
+  }
+  return compressor.get();
+}
+
+ZlibDecompressor* ThreadDecompressor() {
+  static thread_local std::unique_ptr<ZlibDecompressor> decompressor(new ZlibDecompressor);
+  return decompressor.get();
+}
+
+ZlibDecompressor* ThreadDecompressor(const CompressDictionarySPtr& dictionary) {
+  static thread_local std::unique_ptr<ZlibDecompressor> decompressor;
+  if (!decompressor || decompressor->GetDictionary() != dictionary) {
+    decompressor.reset(new ZlibDecompressor(dictionary));
   }
+  return decompressor.get();
+}
 
-  // Compress the input, and put compressed data in output.
-  _stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input));
-  _stream.avail_in = static_cast<unsigned int>(input_length);
+}  // namespace
 
-  // Initialize the output size.
-  _stream.avail_out = static_cast<unsigned int>(output_len);
-  _stream.next_out = reinterpret_cast<Bytef*>(&(*output)[output_header_len]);
+ZlibCompressor::ZlibCompressor(uint8_t def, int compression_level, CompressDictionarySPtr dictionary)
+    : stream_(), inited_(false), def_(def), compression_level_(compression_level), dictionary_(dictionary) {
+  memset(&stream_, 0, sizeof(z_stream));
+}
 
-  bool done = false;
-  while (!done) {
-    st = deflate(&_stream, Z_FINISH);
-    switch (st) {
-      case Z_STREAM_END:
-        done = true;
-        break;
-      case Z_OK: {
-        // No output space. Increase the output space by 20%.
-        // We should never run out of output space if
+ZlibCompressor::~ZlibCompressor() {
+  if (inited_) {
+    deflateEnd(&stream_);
+  }
+}
 
-        size_t old_sz = output_len;
-        uint32_t output_len_delta = output_len / 5;
-        output_len += output_len_delta < 10 ? 10 : output_len_delta;
+uint8_t ZlibCompressor::GetDeflate() const {
+  return def_;
+}
 
-        output->resize(output_len);
+int ZlibCompressor::GetCompressionLevel() const {
+  return compression_level_;
+}
 
-        // Set more output.
-        _stream.next_out = reinterpret_cast<Bytef*>(&(*output)[old_sz]);
-        _stream.avail_out = static_cast<unsigned int>(output_len - old_sz);
-        break;
-      }
-      case Z_BUF_ERROR:
-      default:
-        delete[] output;
-        deflateEnd(&_stream);
-        return make_error("ZLIB compress internal error");
+CompressDictionarySPtr ZlibCompressor::GetDictionary() const {
+  return dictionary_;
+}
+
+Error ZlibCompressor::Encode(const StringPiece& data, bool sized, char_buffer_t* out) {
+  if (!data.data() || !out || data.size() > std::numeric_limits<uint32_t>::max()) {
+    // Can't compress more than 4GB
+    return make_error_inval();
+  }
+
+  if (dictionary_ && (def_ & GZIP_ENCODING)) {
+    // gzip header has no field for a preset dictionary
+    return make_error("ZLIB dictionary requires zlib format");
+  }
+
+  if (!inited_) {
+    int st = deflateInit2(&stream_, compression_level_, Z_DEFLATED, WINDOW_BITS | def_, kMemLevel, Z_DEFAULT_STRATEGY);
+    if (st != Z_OK) {
+      return make_error("ZLIB compress internal error");
+    }
+    inited_ = true;
+  } else if (deflateReset(&stream_) != Z_OK) {
+    return make_error("ZLIB compress internal error");
+  }
+
+  if (dictionary_) {
+    const char_buffer_t& content = dictionary_->GetContent();
+    if (deflateSetDictionary(&stream_, reinterpret_cast<const Bytef*>(content.data()),
+                             static_cast<uInt>(content.size())) != Z_OK) {
+      return make_error("ZLIB compress internal error");
     }
   }
 
-  size_t compressed_size = output_len - _stream.avail_out;
-  output->resize(compressed_size + output_header_len);
-  deflateEnd(&_stream);
+  const size_t start = out->size();
+  if (sized && dictionary_) {
+    compress::PutDecompressedSizeInfo(out, static_cast<uint32_t>(data.size()), dictionary_->GetID());
+  } else if (sized) {
+    compress::PutDecompressedSizeInfo(out, static_cast<uint32_t>(data.size()));
+  }
+
+  // deflateBound is exact worst case for a single Z_FINISH call, the output
+  // never has to grow.
+  const size_t header_end = out->size();
+  const size_t bound = deflateBound(&stream_, static_cast<uLong>(data.size()));
+  out->resize(header_end + bound);
+  stream_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.data()));
+  stream_.avail_in = static_cast<uInt>(data.size());
+  stream_.next_out = reinterpret_cast<Bytef*>(out->data() + header_end);
+  stream_.avail_out = static_cast<uInt>(bound);
+  if (deflate(&stream_, Z_FINISH) != Z_STREAM_END) {
+    out->resize(start);
+    return make_error("ZLIB compress internal error");
+  }
+
+  out->resize(header_end + bound - stream_.avail_out);
   return Error();
 }
 
-template <typename CHAR, typename STR2>
-Error DecodeZlibT(const CHAR* input, size_t input_length, bool sized, STR2* out) {
+Error ZlibCompressor::Encode(const char_buffer_t& data, bool sized, char_buffer_t* out) {
+  return Encode(StringPiece(data.data(), data.size()), sized, out);
+}
+
+ZlibDecompressor::ZlibDecompressor(CompressDictionarySPtr dictionary)
+    : stream_(), inited_(false), dictionary_(dictionary) {
+  memset(&stream_, 0, sizeof(z_stream));
+}
+
+ZlibDecompressor::~ZlibDecompressor() {
+  if (inited_) {
+    inflateEnd(&stream_);
+  }
+}
+
+Error ZlibDecompressor::Decode(const StringPiece& data, bool sized, char_buffer_t* out) {
+  const char* input = data.data();
+  size_t input_length = data.size();
   if (!input || !out) {
     return make_error_inval();
   }
 
   uint32_t output_len = 0;
-  if (sized) {
+  if (sized && dictionary_) {
+    uint32_t dictionary_id = 0;
+    if (!compress::GetDecompressedSizeInfo(&input, &input_length, &output_len, &dictionary_id)) {
+      return make_error_inval();
+    }
+    if (dictionary_id != dictionary_->GetID()) {
+      return make_error("ZLIB dictionary mismatch");
+    }
+  } else if (sized) {
     // new encoding, using varint32 to store size information
     if (!compress::GetDecompressedSizeInfo(&input, &input_length, &output_len)) {
       return make_error_inval();
     }
   } else {
-    output_len = input_length * 8;  // may be help
+    output_len = static_cast<uint32_t>(std::min<size_t>(input_length * 8, std::numeric_limits<uint32_t>::max()));
   }
 
-  z_stream _stream;
-  memset(&_stream, 0, sizeof(z_stream));
-
   // For raw inflate, the windowBits should be -8..-15.
   // If windowBits is bigger than zero, it will use either zlib
   // header or gzip header. Adding 32 to it will do automatic detection.
-  int st = inflateInit2(&_stream, WINDOW_BITS > 0 ? WINDOW_BITS + 32 : WINDOW_BITS);
-  if (st != Z_OK) {
+  if (!inited_) {
+    if (inflateInit2(&stream_, WINDOW_BITS + 32) != Z_OK) {
+      return make_error("ZLIB decompress internal error");
+    }
+    inited_ = true;
+  } else if (inflateReset(&stream_) != Z_OK) {
     return make_error("ZLIB decompress internal error");
   }
 
-  _stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input));
-  _stream.avail_in = static_cast<unsigned int>(input_length);
-
-  char* output = new char[output_len];
-
-  _stream.next_out = reinterpret_cast<Bytef*>(output);
-  _stream.avail_out = static_cast<unsigned int>(output_len);
-
-  bool done = false;
-  while (!done) {
-    st = inflate(&_stream, Z_SYNC_FLUSH);
-    switch (st) {
-      case Z_STREAM_END:
-        done = true;
-        break;
-      case Z_OK: {
-        // No output space. Increase the output space by 20%.
-        // We should never run out of output space if
-
-        size_t old_sz = output_len;
-        uint32_t output_len_delta = output_len / 5;
-        output_len += output_len_delta < 10 ? 10 : output_len_delta;
-        char* tmp = new char[output_len];
-        memcpy(tmp, output, old_sz);
-        delete[] output;
-        output = tmp;
-
-        // Set more output.
-        _stream.next_out = reinterpret_cast<Bytef*>(output + old_sz);
-        _stream.avail_out = static_cast<unsigned int>(output_len - old_sz);
-        break;
+  const size_t start = out->size();
+  out->resize(start + std::max<size_t>(output_len, 64));
+  stream_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input));
+  stream_.avail_in = static_cast<uInt>(input_length);
+  stream_.next_out = reinterpret_cast<Bytef*>(out->data() + start);
+  stream_.avail_out = static_cast<uInt>(out->size() - start);
+  while (true) {
+    const int st = inflate(&stream_, Z_NO_FLUSH);
+    if (st == Z_STREAM_END) {
+      break;
+    }
+
+    if (st == Z_NEED_DICT) {
+      // inflateSetDictionary checks the adler32 of the dictionary against the stream header
+      const char_buffer_t* content = dictionary_ ? &dictionary_->GetContent() : nullptr;
+      if (!content || inflateSetDictionary(&stream_, reinterpret_cast<const Bytef*>(content->data()),
+                                           static_cast<uInt>(content->size())) != Z_OK) {
+        out->resize(start);
+        return make_error("ZLIB dictionary mismatch");
       }
-      case Z_BUF_ERROR:
-      default:
-        delete[] output;
-        inflateEnd(&_stream);
-        return make_error("ZLIB decompress internal error");
+      continue;
     }
+
+    if ((st == Z_OK || st == Z_BUF_ERROR) && stream_.avail_out == 0) {
+      // No output space. Increase the output space by 50%.
+      const size_t written = out->size() - start;
+      out->resize(start + written + written / 2);
+      stream_.next_out = reinterpret_cast<Bytef*>(out->data() + start + written);
+      stream_.avail_out = static_cast<uInt>(out->size() - start - written);
+      continue;
+    }
+
+    out->resize(start);
+    return make_error("ZLIB decompress internal error");
   }
 
+  out->resize(out->size() - stream_.avail_out);
   if (sized) {
-    // If we encoded decompressed block size, we should have no bytes left
-    DCHECK_EQ(_stream.avail_out, 0);
+    // If we encoded decompressed block size, we should have exactly this size
+    DCHECK_EQ(out->size() - start, output_len);
   }
-
-  uint32_t decompress_size = output_len - _stream.avail_out;
-  *out = STR2(output, output + decompress_size);
-  delete[] output;
-  inflateEnd(&_stream);
   return Error();
 }
-}  // namespace
+
+Error ZlibDecompressor::Decode(const char_buffer_t& data, bool sized, char_buffer_t* out) {
+  return Decode(StringPiece(data.data(), data.size()), sized, out);
+}
+
+CompressDictionarySPtr ZlibDecompressor::GetDictionary() const {
+  return dictionary_;
+}
 
 Error EncodeZlib(const StringPiece& data, bool sized, uint8_t def, char_buffer_t* out, int compression_level) {
-  return EncodeZlibT(data.data(), data.size(), sized, def, out, compression_level);
+  if (!out) {
+    return make_error_inval();
+  }
+
+  out->clear();
+  return ThreadCompressor(def, compression_level)->Encode(data, sized, out);
 }
 
 Error DecodeZlib(const StringPiece& data, bool sized, char_buffer_t* out) {
-  return DecodeZlibT(data.data(), data.size(), sized, out);
+  if (!out) {
+    return make_error_inval();
+  }
+
+  out->clear();
+  return ThreadDecompressor()->Decode(data, sized, out);
 }
 
 Error EncodeZlib(const char_buffer_t& data, bool sized, uint8_t def, char_buffer_t* out, int compression_level) {
-  return EncodeZlibT(data.data(), data.size(), sized, def, out, compression_level);
+  return EncodeZlib(StringPiece(data.data(), data.size()), sized, def, out, compression_level);
 }
 
 Error DecodeZlib(const char_buffer_t& data, bool sized, char_buffer_t* out) {
-  return DecodeZlibT(data.data(), data.size(), sized, out);
+  return DecodeZlib(StringPiece(data.data(), data.size()), sized, out);
+}
+
+Error EncodeZlib(const StringPiece& data,
+                 bool sized,
+                 const CompressDictionarySPtr& dictionary,
+                 char_buffer_t* out,
+                 int compression_level) {
+  if (!out || !dictionary) {
+    return make_error_inval();
+  }
+
+  out->clear();
+  return ThreadCompressor(dictionary, compression_level)->Encode(data, sized, out);
+}
+
+Error DecodeZlib(const StringPiece& data, bool sized, const CompressDictionarySPtr& dictionary, char_buffer_t* out) {
+  if (!out || !dictionary) {
+    return make_error_inval();
+  }
+
+  out->clear();
+  return ThreadDecompressor(dictionary)->Decode(data, sized, out);
+}
+
+Error EncodeZlib(const char_buffer_t& data,
+                 bool sized,
+                 const CompressDictionarySPtr& dictionary,
+                 char_buffer_t* out,
+                 int compression_level) {
+  return EncodeZlib(StringPiece(data.data(), data.size()), sized, dictionary, out, compression_level);
+}
+
+Error DecodeZlib(const char_buffer_t& data, bool sized, const CompressDictionarySPtr& dictionary, char_buffer_t* out) {
+  return DecodeZlib(StringPiece(data.data(), data.size()), sized, dictionary, out);
+}
+
+Error EncodeZlibParallel(const StringPiece& data,
+                         bool sized,
+                         uint8_t def,
+                         threads::ThreadPool* pool,
+                         char_buffer_t* out,
+                         int compression_level,
+                         size_t block_size) {
+  return EncodeZlibParallelImpl(data.data(), data.size(), sized, def, pool, out, compression_level, block_size);
+}
+
+Error EncodeZlibParallel(const char_buffer_t& data,
+                         bool sized,
+                         uint8_t def,
+                         threads::ThreadPool* pool,
+                         char_buffer_t* out,
+                         int compression_level,
+                         size_t block_size) {
+  return EncodeZlibParallelImpl(data.data(), data.size(), sized, def, pool, out, compression_level, block_size);
 }
 
 }  // namespace compress
@@ -34,6 +34,9 @@
 #include <algorithm>
 #include <limits>
 
+#include <common/compress/hex.h>
+#include <common/compress/unicode.h>
+#include <common/compress/xhex.h>
 #include <common/portable_endian.h>
 #include <common/sprintf.h>
 #include <common/string_number_conversions.h>
@@ -255,12 +258,39 @@ typedef BaseHexIteratorRangeToInt64Traits<StringPiece::const_iterator> HexIterat
 
 typedef BaseHexIteratorRangeToUInt64Traits<StringPiece::const_iterator> HexIteratorRangeToUInt64Traits;
 
-template <typename VALUE, int BASE>
-class StringPieceToNumberTraits : public BaseIteratorRangeToNumberTraits<StringPiece::const_iterator, VALUE, BASE> {};
+bool StringToNumber(const StringPiece& input, float* output) {
+  return StringToFloat(input, output);
+}
+
+bool StringToNumber(const StringPiece& input, double* output) {
+  return StringToDouble(input, output);
+}
+
+bool StringToWideInt(const StringPiece& input, int64_t* output) {
+  return StringToInt64(input, output);
+}
+
+bool StringToWideInt(const StringPiece& input, uint64_t* output) {
+  return StringToUint64(input, output);
+}
 
+// Parses with the 64-bit SWAR parsers and narrows with the saturation
+// IteratorRangeToNumber applies.
 template <typename VALUE>
 bool DoStringToInt(const StringPiece& input, VALUE* output) {
-  return IteratorRangeToNumber<StringPieceToNumberTraits<VALUE, 10>>::Invoke(input.begin(), input.end(), output);
+  typedef typename std::conditional<std::numeric_limits<VALUE>::is_signed, int64_t, uint64_t>::type wide_type;
+  wide_type wide = 0;
+  const bool res = StringToWideInt(input, &wide);
+  if (wide > static_cast<wide_type>(std::numeric_limits<VALUE>::max())) {
+    *output = std::numeric_limits<VALUE>::max();
+    return false;
+  }
+  if (wide < static_cast<wide_type>(std::numeric_limits<VALUE>::min())) {
+    *output = std::numeric_limits<VALUE>::min();
+    return false;
+  }
+  *output = static_cast<VALUE>(wide);
+  return res;
 }
 
 template <typename VALUE, int BASE>
@@ -272,35 +302,25 @@ bool DoString16ToInt(const StringPiece16& input, VALUE* output) {
   return IteratorRangeToNumber<StringPiece16ToNumberTraits<VALUE, 10>>::Invoke(input.begin(), input.end(), output);
 }
 
-template <typename BUFFER, typename VALUE, int BASE>
-class BytesToNumberTraits : public BaseIteratorRangeToNumberTraits<typename BUFFER::const_iterator, VALUE, BASE> {};
+template <typename BUFFER>
+StringPiece BytesAsStringPiece(const BUFFER& input) {
+  return StringPiece(reinterpret_cast<const char*>(input.data()), input.size());
+}
 
 template <typename BUFFER, typename VALUE>
 bool DoBytesToInt(const BUFFER& input, VALUE* output) {
-  return IteratorRangeToNumber<BytesToNumberTraits<BUFFER, VALUE, 10>>::Invoke(input.begin(), input.end(), output);
+  return DoStringToInt(BytesAsStringPiece(input), output);
 }
 
-template <typename STR>
-bool UnicodeStringToBytesT(const STR& input, std::vector<uint16_t>* output) {
-  DCHECK_EQ(output->size(), 0u);
-  size_t count = input.size();
-  if (count == 0 || (count % 4) != 0) {
+// Only writes |out| on success. PLUS_INF, PPLUS_INF and MINUS_INF are read
+// by the strtod fallback of StringToNumber.
+template <typename VALUE>
+bool DoStringToFloat(const StringPiece& input, VALUE* out) {
+  VALUE loutput = 0;
+  if (!StringToNumber(input, &loutput)) {
     return false;
   }
-
-  for (size_t i = 0; i < count / 4; ++i) {
-    uint8_t c0 = 0;  // most significant 4 bits
-    uint8_t c1 = 0;  // least significant 4 bits
-    uint8_t c2 = 0;  // most significant 4 bits
-    uint8_t c3 = 0;  // least significant 4 bits
-    if (!CharToDigit<16>(input[i * 4], &c0) || !CharToDigit<16>(input[i * 4 + 1], &c1) ||
-        !CharToDigit<16>(input[i * 4 + 2], &c2) || !CharToDigit<16>(input[i * 4 + 3], &c3)) {
-      return false;
-    }
-
-    uint16_t val = (c0 << 12) | (c1 << 8) | (c2 << 4) | c3;
-    output->push_back(val);
-  }
+  *out = loutput;
   return true;
 }
 
@@ -328,22 +348,6 @@ bool UUnicodeStringToBytesT(const STR& input, std::vector<uint16_t>* output) {
   return true;
 }
 
-template <typename T, typename U>
-bool do_unicode_decode(const T& input, U* out) {
-  if (!out) {
-    return false;
-  }
-
-  std::vector<uint16_t> vec;
-  bool res = UnicodeStringToBytesT(input, &vec);
-  if (!res) {
-    return false;
-  }
-
-  *out = U(vec.begin(), vec.end());
-  return true;
-}
-
 template <typename T, typename U>
 bool do_uunicode_decode(const T& input, U* out) {
   if (!out) {
@@ -360,132 +364,63 @@ bool do_uunicode_decode(const T& input, U* out) {
   return true;
 }
 
+template <typename U>
+typename U::value_type* ResizedData(U* out, size_t size) {
+  out->resize(size);
+  return size ? &(*out)[0] : nullptr;
+}
+
 template <typename T, typename U>
 bool do_hex_encode(const T& input, bool is_lower, U* out) {
   if (!out) {
     return false;
   }
 
-  static const char uHexChars[] = "0123456789ABCDEF";
-  static const char lHexChars[] = "0123456789abcdef";
-
-  typedef typename T::value_type value_type;
-  const typename T::size_type size = input.size();
-  U decoded;
-  decoded.resize(size * 2);
-
-  for (size_t i = 0; i < size; ++i) {
-    value_type b = input[i];
-    if (is_lower) {
-      decoded[(i * 2)] = lHexChars[(b >> 4) & 0xf];
-      decoded[(i * 2) + 1] = lHexChars[b & 0xf];
-    } else {
-      decoded[(i * 2)] = uHexChars[(b >> 4) & 0xf];
-      decoded[(i * 2) + 1] = uHexChars[b & 0xf];
-    }
-  }
-
-  *out = decoded;
-  return true;
+  const size_t size = compress::HexEncodedSize(input.size());
+  return !compress::EncodeHex(StringPiece(input.data(), input.size()), is_lower,
+                              span<char>(ResizedData(out, size), size));
 }
 
 template <typename T, typename U>
-bool do_xhex_encode(const T& input, bool is_lower, U* out) {
-  if (!out) {
+bool do_hex_decode(const T& input, U* out) {
+  if (!out || input.empty()) {
     return false;
   }
 
-  static const char uHexChars[] = "0123456789ABCDEF";
-  static const char lHexChars[] = "0123456789abcdef";
-
-  typedef typename T::value_type value_type;
-  const typename T::size_type size = input.size();
   U decoded;
-  decoded.resize(size * 4);
-
-  for (size_t i = 0; i < size; ++i) {
-    value_type b = input[i];
-    decoded[(i * 4)] = '\\';
-    if (is_lower) {
-      decoded[(i * 4) + 1] = 'x';
-      decoded[(i * 4) + 2] = lHexChars[(b >> 4) & 0xf];
-      decoded[(i * 4) + 3] = lHexChars[b & 0xf];
-    } else {
-      decoded[(i * 4) + 1] = 'X';
-      decoded[(i * 4) + 2] = uHexChars[(b >> 4) & 0xf];
-      decoded[(i * 4) + 3] = uHexChars[b & 0xf];
-    }
-  }
-
-  *out = decoded;
-  return true;
-}
-
-template <typename STR>
-bool HexStringToBytesT(const STR& input, std::vector<uint8_t>* output) {
-  DCHECK_EQ(output->size(), 0u);
-  size_t count = input.size();
-  if (count == 0 || (count % 2) != 0) {
+  const size_t size = compress::HexDecodedSize(input.size());
+  if (compress::DecodeHex(StringPiece(input.data(), input.size()), span<char>(ResizedData(&decoded, size), size))) {
     return false;
   }
-  for (uintptr_t i = 0; i < count / 2; ++i) {
-    uint8_t msb = 0;  // most significant 4 bits
-    uint8_t lsb = 0;  // least significant 4 bits
-    if (!CharToDigit<16>(input[i * 2], &msb) || !CharToDigit<16>(input[i * 2 + 1], &lsb)) {
-      return false;
-    }
-    output->push_back((msb << 4) | lsb);
-  }
-  return true;
-}
 
-template <typename STR>
-bool XHexStringToBytesT(const STR& input, std::vector<uint8_t>* output) {
-  DCHECK_EQ(output->size(), 0u);
-  size_t count = input.size();
-  if (count == 0 || (count % 4) != 0) {
-    return false;
-  }
-  for (uintptr_t i = 0; i < count / 4; ++i) {
-    uint8_t msb = 0;  // most significant 4 bits
-    uint8_t lsb = 0;  // least significant 4 bits
-    if (!CharToDigit<16>(input[i * 4 + 2], &msb) || !CharToDigit<16>(input[i * 4 + 3], &lsb)) {
-      return false;
-    }
-    output->push_back((msb << 4) | lsb);
-  }
+  out->swap(decoded);
   return true;
 }
 
 template <typename T, typename U>
-bool do_hex_decode(const T& input, U* out) {
+bool do_xhex_encode(const T& input, bool is_lower, U* out) {
   if (!out) {
     return false;
   }
 
-  std::vector<uint8_t> vec;
-  bool res = HexStringToBytesT(input, &vec);
-  if (!res) {
-    return false;
-  }
-
-  *out = U(vec.begin(), vec.end());
-  return true;
+  const size_t size = compress::XHexEncodedSize(input.size());
+  return !compress::EncodeXHex(StringPiece(input.data(), input.size()), is_lower,
+                               span<char>(ResizedData(out, size), size));
 }
 
 template <typename T, typename U>
 bool do_xhex_decode(const T& input, U* out) {
-  if (!out) {
+  if (!out || input.empty()) {
     return false;
   }
 
-  std::vector<uint8_t> vec;
-  bool res = XHexStringToBytesT(input, &vec);
-  if (!res) {
+  U decoded;
+  const size_t size = compress::XHexDecodedSize(input.size());
+  if (compress::DecodeXHex(StringPiece(input.data(), input.size()), span<char>(ResizedData(&decoded, size), size))) {
     return false;
   }
 
-  *out = U(vec.begin(), vec.end());
+  out->swap(decoded);
   return true;
 }
 
@@ -495,32 +430,23 @@ bool do_unicode_encode(const T& input, bool is_lower, U* out) {
     return false;
   }
 
-  static const char uHexChars[] = "0123456789ABCDEF";
-  static const char lHexChars[] = "0123456789abcdef";
+  const size_t size = compress::UnicodeEncodedSize(input.size());
+  return !compress::EncodeUnicode(input, is_lower, span<char>(ResizedData(out, size), size));
+}
 
-  typedef typename T::value_type value_type;
-  const typename T::size_type size = input.size();
-  U decoded;
-  decoded.resize(size * 4);
+template <typename T, typename U>
+bool do_unicode_decode(const T& input, U* out) {
+  if (!out || input.empty()) {
+    return false;
+  }
 
-  for (size_t i = 0; i < size; ++i) {
-    value_type b = htobe16(input[i]);
-    uint8_t msb = b;       // most significant 4 bits
-    uint8_t lsb = b >> 8;  // least significant 4 bits
-    if (is_lower) {
-      decoded[(i * 4)] = lHexChars[(msb >> 4) & 0xf];
-      decoded[(i * 4) + 1] = lHexChars[(msb & 0xf) & 0xf];
-      decoded[(i * 4) + 2] = lHexChars[(lsb >> 4) & 0xf];
-      decoded[(i * 4) + 3] = lHexChars[lsb & 0xf];
-    } else {
-      decoded[(i * 4)] = uHexChars[(msb >> 4) & 0xf];
-      decoded[(i * 4) + 1] = uHexChars[(msb & 0xf) & 0xf];
-      decoded[(i * 4) + 2] = uHexChars[(lsb >> 4) & 0xf];
-      decoded[(i * 4) + 3] = uHexChars[lsb & 0xf];
-    }
+  U decoded;
+  const size_t size = compress::UnicodeDecodedSize(input.size());
+  if (compress::DecodeUnicode(input, span<char16>(ResizedData(&decoded, size), size))) {
+    return false;
   }
 
-  *out = decoded;
+  out->swap(decoded);
   return true;
 }
 
@@ -572,74 +498,86 @@ Buffer ConvertToBytesT(bool value) {
 
 template <typename Buffer>
 Buffer ConvertToBytesT(char value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(unsigned char value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(short value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(unsigned short value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(int value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(unsigned int value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(long value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(unsigned long value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(long long value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(unsigned long long value) {
-  const std::string str = ConvertToString(value);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxIntegerChars];
+  const size_t size = NumberToChars(value, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(float value, int prec) {
-  const std::string str = ConvertToString(value, prec);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxFixedChars];
+  const size_t size = NumberToChars(value, prec, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 template <typename Buffer>
 Buffer ConvertToBytesT(double value, int prec) {
-  const std::string str = ConvertToString(value, prec);  // more readable
-  return Buffer(str.begin(), str.end());
+  char buffer[kMaxFixedChars];
+  const size_t size = NumberToChars(value, prec, buffer);
+  return Buffer(buffer, buffer + size);
 }
 
 }  // namespace
@@ -1257,23 +1195,7 @@ bool ConvertFromString(const std::string& from, float* out) {
     return false;
   }
 
-  if (from == PLUS_INF || from == PPLUS_INF) {
-    *out = std::numeric_limits<float>::infinity();
-    return true;
-  }
-
-  if (from == MINUS_INF) {
-    *out = -std::numeric_limits<float>::infinity();
-    return true;
-  }
-
-  size_t end_number_pos;
-  float d = std::stof(from.c_str(), &end_number_pos);
-  if (end_number_pos != from.size()) {
-    return false;
-  }
-  *out = d;
-  return true;
+  return DoStringToFloat(from, out);
 }
 
 bool ConvertFromString(const std::string& from, double* out) {
@@ -1281,23 +1203,7 @@ bool ConvertFromString(const std::string& from, double* out) {
     return false;
   }
 
-  if (from == PLUS_INF || from == PPLUS_INF) {
-    *out = std::numeric_limits<double>::infinity();
-    return true;
-  }
-
-  if (from == MINUS_INF) {
-    *out = -std::numeric_limits<double>::infinity();
-    return true;
-  }
-
-  size_t end_number_pos;
-  double d = std::stod(from.c_str(), &end_number_pos);
-  if (end_number_pos != from.size()) {
-    return false;
-  }
-  *out = d;
-  return true;
+  return DoStringToFloat(from, out);
 }
 
 bool ConvertFromString(const std::string& from, StringPiece* out) {
@@ -1663,12 +1569,20 @@ bool ConvertFromBytes(const ByteArray<ch>& from, unsigned long long* out) {
 
 template <typename ch>
 bool ConvertFromBytes(const ByteArray<ch>& from, float* out) {
-  return ConvertFromString(ConvertToString(from), out);  // more readable
+  if (!out) {
+    return false;
+  }
+
+  return DoStringToFloat(BytesAsStringPiece(from), out);
 }
 
 template <typename ch>
 bool ConvertFromBytes(const ByteArray<ch>& from, double* out) {
-  return ConvertFromString(ConvertToString(from), out);  // more readable
+  if (!out) {
+    return false;
+  }
+
+  return DoStringToFloat(BytesAsStringPiece(from), out);
 }
 
 //
@@ -16,8 +16,6 @@
 
 #include <string>
 
-#define GET_LOG_INFO_PATH_FIELD "path"
-
 namespace common {
 namespace daemon {
 namespace commands {
@@ -26,24 +24,6 @@ GetLogInfo::GetLogInfo() : base_class(), path_() {}
 
 GetLogInfo::GetLogInfo(const url_t& path) : path_(path) {}
 
-common::Error GetLogInfo::SerializeFields(json_object* out) const {
-  const std::string path_str = path_.spec();
-  json_object_object_add(out, GET_LOG_INFO_PATH_FIELD, json_object_new_string(path_str.c_str()));
-  return common::Error();
-}
-
-common::Error GetLogInfo::DoDeSerialize(json_object* serialized) {
-  GetLogInfo inf;
-  json_object* jpath = nullptr;
-  json_bool jpath_exists = json_object_object_get_ex(serialized, GET_LOG_INFO_PATH_FIELD, &jpath);
-  if (jpath_exists) {
-    inf.path_ = url_t(json_object_get_string(jpath));
-  }
-
-  *this = inf;
-  return common::Error();
-}
-
 GetLogInfo::url_t GetLogInfo::GetLogPath() const {
   return path_;
 }
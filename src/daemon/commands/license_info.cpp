@@ -29,8 +29,6 @@
 
 #include <common/daemon/commands/license_info.h>
 
-#define LICENSE_INFO_KEY_FIELD "license_key"
-
 namespace common {
 namespace daemon {
 namespace commands {
@@ -39,17 +37,6 @@ LicenseInfo::LicenseInfo() : base_class(), license_() {}
 
 LicenseInfo::LicenseInfo(license_t license) : base_class(), license_(license) {}
 
-common::Error LicenseInfo::SerializeFields(json_object* out) const {
-  if (!IsValid()) {
-    return make_error_inval();
-  }
-
-  const auto license_str = *license_;
-  json_object_object_add(out, LICENSE_INFO_KEY_FIELD,
-                         json_object_new_string_len(license_str.data(), license_str.size()));
-  return Error();
-}
-
 bool LicenseInfo::IsValid() const {
   if (license_) {
     return true;
@@ -57,25 +44,30 @@ bool LicenseInfo::IsValid() const {
   return false;
 }
 
-common::Error LicenseInfo::DoDeSerialize(json_object* serialized) {
+common::Error LicenseInfo::ReadFields(const common::serializer::JsonValue& serialized) {
+  static constexpr auto fields = json_fields();
   LicenseInfo inf;
-  json_object* jlicense = nullptr;
-  json_bool jlicense_exists = json_object_object_get_ex(serialized, LICENSE_INFO_KEY_FIELD, &jlicense);
-  if (!jlicense_exists) {
-    return make_error_inval();
+  common::Error err = common::serializer::ReadJsonFields(serialized, &inf, fields);
+  if (err) {
+    return err;
   }
 
-  const std::string license = json_object_get_string(jlicense);
-  const auto lic = common::license::make_license<raw_license_t>(license);
-  if (!lic) {
+  if (!inf.IsValid()) {
     return make_error_inval();
   }
 
-  inf.license_ = lic;
   *this = inf;
   return common::Error();
 }
 
+common::Error LicenseInfo::WriteFields(common::serializer::JsonWriter* writer) const {
+  if (!IsValid()) {
+    return make_error_inval();
+  }
+
+  return base_class::WriteFields(writer);
+}
+
 LicenseInfo::license_t LicenseInfo::GetLicense() const {
   return license_;
 }
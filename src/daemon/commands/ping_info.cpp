@@ -31,32 +31,12 @@
 
 #include <common/time.h>
 
-#define SERVER_INFO_TIMESTAMP_FIELD "timestamp"
-#define CLIENT_INFO_TIMESTAMP_FIELD "timestamp"
-
 namespace common {
 namespace daemon {
 namespace commands {
 
 ServerPingInfo::ServerPingInfo() : timestamp_(common::time::current_utc_mstime()) {}
 
-common::Error ServerPingInfo::SerializeFields(json_object* deserialized) const {
-  json_object_object_add(deserialized, SERVER_INFO_TIMESTAMP_FIELD, json_object_new_int64(timestamp_));
-  return common::Error();
-}
-
-common::Error ServerPingInfo::DoDeSerialize(json_object* serialized) {
-  json_object* jtimestamp = nullptr;
-  json_bool jtimestamp_exists = json_object_object_get_ex(serialized, SERVER_INFO_TIMESTAMP_FIELD, &jtimestamp);
-  ServerPingInfo inf;
-  if (jtimestamp_exists) {
-    inf.timestamp_ = json_object_get_int64(jtimestamp);
-  }
-
-  *this = inf;
-  return common::Error();
-}
-
 common::time64_t ServerPingInfo::GetTimeStamp() const {
   return timestamp_;
 }
@@ -71,23 +51,6 @@ bool ServerPingInfo::Equals(const ServerPingInfo& ping) const {
 
 ClientPingInfo::ClientPingInfo() : timestamp_(common::time::current_utc_mstime()) {}
 
-common::Error ClientPingInfo::SerializeFields(json_object* deserialized) const {
-  json_object_object_add(deserialized, CLIENT_INFO_TIMESTAMP_FIELD, json_object_new_int64(timestamp_));
-  return common::Error();
-}
-
-common::Error ClientPingInfo::DoDeSerialize(json_object* serialized) {
-  json_object* jtimestamp = nullptr;
-  json_bool jtimestamp_exists = json_object_object_get_ex(serialized, CLIENT_INFO_TIMESTAMP_FIELD, &jtimestamp);
-  ClientPingInfo inf;
-  if (jtimestamp_exists) {
-    inf.timestamp_ = json_object_get_int64(jtimestamp);
-  }
-
-  *this = inf;
-  return common::Error();
-}
-
 time64_t ClientPingInfo::GetTimeStamp() const {
   return timestamp_;
 }
@@ -29,8 +29,6 @@
 
 #include <common/daemon/commands/stop_info.h>
 
-#define STOP_SERVICE_INFO_DELAY_FIELD "delay"
-
 namespace common {
 namespace daemon {
 namespace commands {
@@ -39,23 +37,6 @@ StopInfo::StopInfo() : StopInfo(0) {}
 
 StopInfo::StopInfo(common::time64_t delay) : base_class(), delay_(delay) {}
 
-common::Error StopInfo::DoDeSerialize(json_object* serialized) {
-  StopInfo inf;
-  json_object* jdelay = nullptr;
-  json_bool jdelay_exists = json_object_object_get_ex(serialized, STOP_SERVICE_INFO_DELAY_FIELD, &jdelay);
-  if (jdelay_exists) {
-    inf.delay_ = json_object_get_int64(jdelay);
-  }
-
-  *this = inf;
-  return common::Error();
-}
-
-common::Error StopInfo::SerializeFields(json_object* out) const {
-  json_object_object_add(out, STOP_SERVICE_INFO_DELAY_FIELD, json_object_new_int64(delay_));
-  return common::Error();
-}
-
 common::time64_t StopInfo::GetDelay() const {
   return delay_;
 }
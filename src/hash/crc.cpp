@@ -0,0 +1,318 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/hash/crc.h>
+
+#include <string.h>
+
+#include <common/portable_endian.h>
+#include <common/system_info/cpu_features.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>  // for _mm_crc32_u64
+#include <wmmintrin.h>  // for _mm_clmulepi64_si128
+#define HAVE_X86_CRC_INSTRUCTIONS
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#else
+#define TARGET_SSE42
+#define TARGET_PCLMUL
+#endif
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#ifndef UINT64_C
+#define UINT64_C(val) val##ULL
+#endif
+
+namespace common {
+namespace hash {
+namespace {
+
+const uint64_t kCrc64Poly = UINT64_C(0x95ac9329ac4bc9b5);  // reflected 0xad93d23594c935a9
+const uint32_t kCrc32cPoly = 0x82f63b78;                    // reflected 0x1edc6f41
+
+// Polynomials are kept bit reflected: the most significant bit is x^0.
+template <typename T>
+T MultModP(T a, T b, T poly) {
+  T m = static_cast<T>(1) << (sizeof(T) * 8 - 1);
+  T p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) {
+        break;
+      }
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+  }
+  return p;
+}
+
+template <typename T>
+struct CrcTables {
+  enum { X2N_COUNT = 72 };  // enough for x^(len * 2^3) with 64 bit len
+
+  explicit CrcTables(T poly) : poly_(poly) {
+    for (unsigned i = 0; i < 256; ++i) {
+      T crc = i;
+      for (int j = 0; j < 8; ++j) {
+        crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+      }
+      slice_[0][i] = crc;
+    }
+    for (unsigned i = 0; i < 256; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        const T prev = slice_[k - 1][i];
+        slice_[k][i] = (prev >> 8) ^ slice_[0][prev & 0xff];
+      }
+    }
+
+    T p = static_cast<T>(1) << (sizeof(T) * 8 - 2);  // x^1
+    x2n_[0] = p;
+    for (int n = 1; n < X2N_COUNT; ++n) {
+      p = MultModP(p, p, poly);
+      x2n_[n] = p;
+    }
+  }
+
+  // x^(n * 2^k) mod p
+  T X2nModP(uint64_t n, unsigned k) const {
+    T p = static_cast<T>(1) << (sizeof(T) * 8 - 1);  // x^0
+    while (n) {
+      if (n & 1) {
+        p = MultModP(x2n_[k], p, poly_);
+      }
+      n >>= 1;
+      k++;
+    }
+    return p;
+  }
+
+  T Combine(T crc1, T crc2, size_t len2) const { return MultModP(X2nModP(len2, 3), crc1, poly_) ^ crc2; }
+
+  // Slicing-by-8: one 64 bit load and eight independent lookups per step.
+  T Update(T crc, const unsigned char* buf, size_t len) const {
+    while (len && (reinterpret_cast<uintptr_t>(buf) & 7)) {
+      crc = slice_[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+      len--;
+    }
+    while (len >= 8) {
+      uint64_t word;
+      memcpy(&word, buf, sizeof(word));
+      word = le64toh(word) ^ crc;
+      crc = slice_[7][word & 0xff] ^ slice_[6][(word >> 8) & 0xff] ^ slice_[5][(word >> 16) & 0xff] ^
+            slice_[4][(word >> 24) & 0xff] ^ slice_[3][(word >> 32) & 0xff] ^ slice_[2][(word >> 40) & 0xff] ^
+            slice_[1][(word >> 48) & 0xff] ^ slice_[0][word >> 56];
+      buf += 8;
+      len -= 8;
+    }
+    while (len--) {
+      crc = slice_[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+  }
+
+  const T poly_;
+  T slice_[8][256];
+  T x2n_[X2N_COUNT];
+};
+
+const CrcTables<uint64_t>& Crc64Tables() {
+  static const CrcTables<uint64_t> tables(kCrc64Poly);
+  return tables;
+}
+
+const CrcTables<uint32_t>& Crc32cTables() {
+  static const CrcTables<uint32_t> tables(kCrc32cPoly);
+  return tables;
+}
+
+#if defined(HAVE_X86_CRC_INSTRUCTIONS)
+// Below this size table lookups are cheaper than setting up the folding.
+const size_t kCrc64FoldMinSize = 256;
+
+struct Crc64FoldConstants {
+  Crc64FoldConstants() {
+    // Folding a 128 bit block A:B (A low qword) forward by D bits:
+    // A * x^(D + 64) + B * x^D == clmul(A, x^(D + 63)) + clmul(B, x^(D - 1)),
+    // clmul of reflected operands adds one extra x factor.
+    const CrcTables<uint64_t>& tables = Crc64Tables();
+    fold_128[0] = tables.X2nModP(128 + 63, 0);
+    fold_128[1] = tables.X2nModP(128 - 1, 0);
+    fold_1024[0] = tables.X2nModP(1024 + 63, 0);
+    fold_1024[1] = tables.X2nModP(1024 - 1, 0);
+  }
+
+  uint64_t fold_128[2];
+  uint64_t fold_1024[2];
+};
+
+const Crc64FoldConstants& Crc64Constants() {
+  static const Crc64FoldConstants constants;
+  return constants;
+}
+
+TARGET_PCLMUL inline __m128i Fold(__m128i acc, __m128i k, __m128i data) {
+  const __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+  const __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(lo, hi), data);
+}
+
+TARGET_PCLMUL uint64_t Crc64Pclmul(uint64_t crc, const unsigned char* buf, size_t len) {
+  const Crc64FoldConstants& constants = Crc64Constants();
+  const __m128i k1024 = _mm_set_epi64x(static_cast<long long>(constants.fold_1024[1]),
+                                       static_cast<long long>(constants.fold_1024[0]));
+  const __m128i k128 = _mm_set_epi64x(static_cast<long long>(constants.fold_128[1]),
+                                      static_cast<long long>(constants.fold_128[0]));
+  const __m128i* blocks = reinterpret_cast<const __m128i*>(buf);
+
+  __m128i acc[8];
+  for (int i = 0; i < 8; ++i) {
+    acc[i] = _mm_loadu_si128(blocks + i);
+  }
+  acc[0] = _mm_xor_si128(acc[0], _mm_set_epi64x(0, static_cast<long long>(crc)));
+  blocks += 8;
+  len -= 128;
+
+  while (len >= 128) {
+    for (int i = 0; i < 8; ++i) {
+      acc[i] = Fold(acc[i], k1024, _mm_loadu_si128(blocks + i));
+    }
+    blocks += 8;
+    len -= 128;
+  }
+
+  __m128i folded = acc[0];
+  for (int i = 1; i < 8; ++i) {
+    folded = Fold(folded, k128, acc[i]);
+  }
+  while (len >= 16) {
+    folded = Fold(folded, k128, _mm_loadu_si128(blocks++));
+    len -= 16;
+  }
+
+  // the remaining 128 bit polynomial is reduced as a regular 16 byte message
+  unsigned char rest[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(rest), folded);
+  const CrcTables<uint64_t>& tables = Crc64Tables();
+  crc = tables.Update(0, rest, sizeof(rest));
+  return tables.Update(crc, reinterpret_cast<const unsigned char*>(blocks), len);
+}
+
+TARGET_SSE42 uint32_t Crc32cSse42(uint32_t crc, const unsigned char* buf, size_t len) {
+  while (len && (reinterpret_cast<uintptr_t>(buf) & 7)) {
+    crc = _mm_crc32_u8(crc, *buf++);
+    len--;
+  }
+  uint64_t crc64 = crc;
+  while (len >= 8) {
+    uint64_t word;
+    memcpy(&word, buf, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    buf += 8;
+    len -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (len--) {
+    crc = _mm_crc32_u8(crc, *buf++);
+  }
+  return crc;
+}
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+uint32_t Crc32cArm(uint32_t crc, const unsigned char* buf, size_t len) {
+  while (len && (reinterpret_cast<uintptr_t>(buf) & 7)) {
+    crc = __crc32cb(crc, *buf++);
+    len--;
+  }
+  while (len >= 8) {
+    uint64_t word;
+    memcpy(&word, buf, sizeof(word));
+    crc = __crc32cd(crc, word);
+    buf += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = __crc32cb(crc, *buf++);
+  }
+  return crc;
+}
+#endif
+
+}  // namespace
+
+uint64_t crc64(uint64_t crc, const void* data, size_t len) {
+  const unsigned char* buf = static_cast<const unsigned char*>(data);
+#if defined(HAVE_X86_CRC_INSTRUCTIONS)
+  if (len >= kCrc64FoldMinSize && system_info::CurrentCpuFeatures().pclmul) {
+    return Crc64Pclmul(crc, buf, len);
+  }
+#endif
+  return Crc64Tables().Update(crc, buf, len);
+}
+
+uint64_t crc64_portable(uint64_t crc, const void* data, size_t len) {
+  return Crc64Tables().Update(crc, static_cast<const unsigned char*>(data), len);
+}
+
+uint64_t crc64_combine(uint64_t crc1, uint64_t crc2, size_t len2) {
+  return Crc64Tables().Combine(crc1, crc2, len2);
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t len) {
+  const unsigned char* buf = static_cast<const unsigned char*>(data);
+#if defined(__ARM_FEATURE_CRC32)
+  return ~Crc32cArm(~crc, buf, len);
+#else
+#if defined(HAVE_X86_CRC_INSTRUCTIONS)
+  if (system_info::CurrentCpuFeatures().sse42) {
+    return ~Crc32cSse42(~crc, buf, len);
+  }
+#endif
+  return ~Crc32cTables().Update(~crc, buf, len);
+#endif
+}
+
+uint32_t crc32c_portable(uint32_t crc, const void* data, size_t len) {
+  return ~Crc32cTables().Update(~crc, static_cast<const unsigned char*>(data), len);
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2) {
+  return Crc32cTables().Combine(crc1, crc2, len2);
+}
+
+}  // namespace hash
+}  // namespace common
@@ -0,0 +1,674 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/hash/fast_hash.h>
+
+#include <string.h>
+
+#include <common/system_info/cpu_features.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>  // for SSE2
+#include <immintrin.h>  // for AVX2
+#define HAVE_X86_SIMD_INSTRUCTIONS
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
+#ifndef UINT64_C
+#define UINT64_C(val) val##ULL
+#endif
+
+namespace common {
+namespace hash {
+namespace {
+
+const size_t kStripeSize = 64;
+const size_t kSecretSize = 192;
+const size_t kSecretSizeMin = 136;
+const size_t kSecretConsumeRate = 8;
+const size_t kStripesPerBlock = (kSecretSize - kStripeSize) / kSecretConsumeRate;
+const size_t kBlockSize = kStripeSize * kStripesPerBlock;
+const size_t kMidSizeMax = 240;
+const size_t kMidSizeStartOffset = 3;
+const size_t kMidSizeLastOffset = 17;
+const size_t kLastAccStart = 7;
+const size_t kMergeAccsStart = 11;
+
+const uint32_t kPrime32_1 = 0x9E3779B1U;
+const uint32_t kPrime32_2 = 0x85EBCA77U;
+const uint32_t kPrime32_3 = 0xC2B2AE3DU;
+const uint64_t kPrime64_1 = UINT64_C(0x9E3779B185EBCA87);
+const uint64_t kPrime64_2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+const uint64_t kPrime64_3 = UINT64_C(0x165667B19E3779F9);
+const uint64_t kPrime64_4 = UINT64_C(0x85EBCA77C2B2AE63);
+const uint64_t kPrime64_5 = UINT64_C(0x27D4EB2F165667C5);
+const uint64_t kPrimeMx1 = UINT64_C(0x165667919E3779F9);
+const uint64_t kPrimeMx2 = UINT64_C(0x9FB21C651E98DF25);
+
+const unsigned char kSecret[kSecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d,
+    0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0,
+    0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21, 0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0,
+    0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b,
+    0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac,
+    0xd8, 0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51,
+    0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83, 0x34,
+    0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb, 0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49,
+    0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8,
+    0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b,
+    0x40, 0x7e};
+
+const uint64_t kInitAcc[8] = {kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3,
+                              kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1};
+
+inline uint32_t ReadLE32(const unsigned char* ptr) {
+  return static_cast<uint32_t>(ptr[0]) | static_cast<uint32_t>(ptr[1]) << 8 | static_cast<uint32_t>(ptr[2]) << 16 |
+         static_cast<uint32_t>(ptr[3]) << 24;
+}
+
+inline uint64_t ReadLE64(const unsigned char* ptr) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t val;
+  memcpy(&val, ptr, sizeof(val));
+  return val;
+#else
+  return static_cast<uint64_t>(ReadLE32(ptr)) | static_cast<uint64_t>(ReadLE32(ptr + 4)) << 32;
+#endif
+}
+
+inline void WriteLE64(unsigned char* ptr, uint64_t val) {
+  for (size_t i = 0; i < 8; ++i) {
+    ptr[i] = static_cast<unsigned char>(val >> (i * 8));
+  }
+}
+
+inline uint32_t Swap32(uint32_t x) {
+  return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+inline uint64_t Swap64(uint64_t x) {
+  return static_cast<uint64_t>(Swap32(static_cast<uint32_t>(x))) << 32 | Swap32(static_cast<uint32_t>(x >> 32));
+}
+
+inline uint32_t Rotl32(uint32_t x, unsigned r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+inline uint64_t Rotl64(uint64_t x, unsigned r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t XorShift64(uint64_t v, unsigned shift) {
+  return v ^ (v >> shift);
+}
+
+inline Hash128 Mult64to128(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  Hash128 r = {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+  return r;
+#else
+  const uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  const uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  const uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  const uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  Hash128 r = {(cross << 32) | (lo_lo & 0xFFFFFFFF), (hi_lo >> 32) + (cross >> 32) + hi_hi};
+  return r;
+#endif
+}
+
+inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+  const Hash128 product = Mult64to128(lhs, rhs);
+  return product.low ^ product.high;
+}
+
+inline uint64_t XXH64Avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime64_2;
+  h ^= h >> 29;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t Avalanche(uint64_t h) {
+  h = XorShift64(h, 37);
+  h *= kPrimeMx1;
+  h = XorShift64(h, 32);
+  return h;
+}
+
+inline uint64_t Rrmxmx(uint64_t h, uint64_t len) {
+  h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+  h *= kPrimeMx2;
+  h ^= (h >> 35) + len;
+  h *= kPrimeMx2;
+  return XorShift64(h, 28);
+}
+
+inline uint64_t Mix16B(const unsigned char* input, const unsigned char* secret, uint64_t seed) {
+  return Mul128Fold64(ReadLE64(input) ^ (ReadLE64(secret) + seed), ReadLE64(input + 8) ^ (ReadLE64(secret + 8) - seed));
+}
+
+inline void Mix32B(Hash128* acc,
+                   const unsigned char* input1,
+                   const unsigned char* input2,
+                   const unsigned char* secret,
+                   uint64_t seed) {
+  acc->low += Mix16B(input1, secret, seed);
+  acc->low ^= ReadLE64(input2) + ReadLE64(input2 + 8);
+  acc->high += Mix16B(input2, secret + 16, seed);
+  acc->high ^= ReadLE64(input1) + ReadLE64(input1 + 8);
+}
+
+// 64 bit, short inputs
+
+uint64_t Hash64Len0To16(const unsigned char* input, size_t len, const unsigned char* secret, uint64_t seed) {
+  if (len > 8) {
+    const uint64_t bitflip1 = (ReadLE64(secret + 24) ^ ReadLE64(secret + 32)) + seed;
+    const uint64_t bitflip2 = (ReadLE64(secret + 40) ^ ReadLE64(secret + 48)) - seed;
+    const uint64_t input_lo = ReadLE64(input) ^ bitflip1;
+    const uint64_t input_hi = ReadLE64(input + len - 8) ^ bitflip2;
+    const uint64_t acc = len + Swap64(input_lo) + input_hi + Mul128Fold64(input_lo, input_hi);
+    return Avalanche(acc);
+  }
+  if (len >= 4) {
+    seed ^= static_cast<uint64_t>(Swap32(static_cast<uint32_t>(seed))) << 32;
+    const uint32_t input1 = ReadLE32(input);
+    const uint32_t input2 = ReadLE32(input + len - 4);
+    const uint64_t bitflip = (ReadLE64(secret + 8) ^ ReadLE64(secret + 16)) - seed;
+    const uint64_t input64 = input2 + (static_cast<uint64_t>(input1) << 32);
+    return Rrmxmx(input64 ^ bitflip, len);
+  }
+  if (len) {
+    const uint32_t c1 = input[0];
+    const uint32_t c2 = input[len >> 1];
+    const uint32_t c3 = input[len - 1];
+    const uint32_t combined = (c1 << 16) | (c2 << 24) | c3 | (static_cast<uint32_t>(len) << 8);
+    const uint64_t bitflip = (ReadLE32(secret) ^ ReadLE32(secret + 4)) + seed;
+    return XXH64Avalanche(combined ^ bitflip);
+  }
+  return XXH64Avalanche(seed ^ (ReadLE64(secret + 56) ^ ReadLE64(secret + 64)));
+}
+
+uint64_t Hash64Len17To128(const unsigned char* input, size_t len, const unsigned char* secret, uint64_t seed) {
+  uint64_t acc = len * kPrime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += Mix16B(input + 48, secret + 96, seed);
+        acc += Mix16B(input + len - 64, secret + 112, seed);
+      }
+      acc += Mix16B(input + 32, secret + 64, seed);
+      acc += Mix16B(input + len - 48, secret + 80, seed);
+    }
+    acc += Mix16B(input + 16, secret + 32, seed);
+    acc += Mix16B(input + len - 32, secret + 48, seed);
+  }
+  acc += Mix16B(input, secret, seed);
+  acc += Mix16B(input + len - 16, secret + 16, seed);
+  return Avalanche(acc);
+}
+
+uint64_t Hash64Len129To240(const unsigned char* input, size_t len, const unsigned char* secret, uint64_t seed) {
+  uint64_t acc = len * kPrime64_1;
+  const size_t rounds = len / 16;
+  for (size_t i = 0; i < 8; ++i) {
+    acc += Mix16B(input + 16 * i, secret + 16 * i, seed);
+  }
+  uint64_t acc_end = Mix16B(input + len - 16, secret + kSecretSizeMin - kMidSizeLastOffset, seed);
+  acc = Avalanche(acc);
+  for (size_t i = 8; i < rounds; ++i) {
+    acc_end += Mix16B(input + 16 * i, secret + 16 * (i - 8) + kMidSizeStartOffset, seed);
+  }
+  return Avalanche(acc + acc_end);
+}
+
+// 128 bit, short inputs
+
+Hash128 Hash128Len0To16(const unsigned char* input, size_t len, const unsigned char* secret, uint64_t seed) {
+  Hash128 h128;
+  if (len > 8) {
+    const uint64_t bitflipl = (ReadLE64(secret + 32) ^ ReadLE64(secret + 40)) - seed;
+    const uint64_t bitfliph = (ReadLE64(secret + 48) ^ ReadLE64(secret + 56)) + seed;
+    const uint64_t input_lo = ReadLE64(input);
+    uint64_t input_hi = ReadLE64(input + len - 8);
+    Hash128 m128 = Mult64to128(input_lo ^ input_hi ^ bitflipl, kPrime64_1);
+    m128.low += static_cast<uint64_t>(len - 1) << 54;
+    input_hi ^= bitfliph;
+    m128.high += input_hi + (input_hi & 0xFFFFFFFF) * (kPrime32_2 - 1);
+    m128.low ^= Swap64(m128.high);
+    h128 = Mult64to128(m128.low, kPrime64_2);
+    h128.high += m128.high * kPrime64_2;
+    h128.low = Avalanche(h128.low);
+    h128.high = Avalanche(h128.high);
+    return h128;
+  }
+  if (len >= 4) {
+    seed ^= static_cast<uint64_t>(Swap32(static_cast<uint32_t>(seed))) << 32;
+    const uint32_t input_lo = ReadLE32(input);
+    const uint32_t input_hi = ReadLE32(input + len - 4);
+    const uint64_t input64 = input_lo + (static_cast<uint64_t>(input_hi) << 32);
+    const uint64_t bitflip = (ReadLE64(secret + 16) ^ ReadLE64(secret + 24)) + seed;
+    h128 = Mult64to128(input64 ^ bitflip, kPrime64_1 + (len << 2));
+    h128.high += h128.low << 1;
+    h128.low ^= h128.high >> 3;
+    h128.low = XorShift64(h128.low, 35);
+    h128.low *= kPrimeMx2;
+    h128.low = XorShift64(h128.low, 28);
+    h128.high = Avalanche(h128.high);
+    return h128;
+  }
+  if (len) {
+    const uint32_t c1 = input[0];
+    const uint32_t c2 = input[len >> 1];
+    const uint32_t c3 = input[len - 1];
+    const uint32_t combinedl = (c1 << 16) | (c2 << 24) | c3 | (static_cast<uint32_t>(len) << 8);
+    const uint32_t combinedh = Rotl32(Swap32(combinedl), 13);
+    const uint64_t bitflipl = (ReadLE32(secret) ^ ReadLE32(secret + 4)) + seed;
+    const uint64_t bitfliph = (ReadLE32(secret + 8) ^ ReadLE32(secret + 12)) - seed;
+    h128.low = XXH64Avalanche(combinedl ^ bitflipl);
+    h128.high = XXH64Avalanche(combinedh ^ bitfliph);
+    return h128;
+  }
+  h128.low = XXH64Avalanche(seed ^ ReadLE64(secret + 64) ^ ReadLE64(secret + 72));
+  h128.high = XXH64Avalanche(seed ^ ReadLE64(secret + 80) ^ ReadLE64(secret + 88));
+  return h128;
+}
+
+Hash128 FinalizeMidSize128(const Hash128& acc, size_t len, uint64_t seed) {
+  Hash128 h128;
+  h128.low = Avalanche(acc.low + acc.high);
+  h128.high = 0 - Avalanche(acc.low * kPrime64_1 + acc.high * kPrime64_4 + (len - seed) * kPrime64_2);
+  return h128;
+}
+
+Hash128 Hash128Len17To128(const unsigned char* input, size_t len, const unsigned char* secret, uint64_t seed) {
+  Hash128 acc = {len * kPrime64_1, 0};
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        Mix32B(&acc, input + 48, input + len - 64, secret + 96, seed);
+      }
+      Mix32B(&acc, input + 32, input + len - 48, secret + 64, seed);
+    }
+    Mix32B(&acc, input + 16, input + len - 32, secret + 32, seed);
+  }
+  Mix32B(&acc, input, input + len - 16, secret, seed);
+  return FinalizeMidSize128(acc, len, seed);
+}
+
+Hash128 Hash128Len129To240(const unsigned char* input, size_t len, const unsigned char* secret, uint64_t seed) {
+  Hash128 acc = {len * kPrime64_1, 0};
+  for (size_t i = 32; i < 160; i += 32) {
+    Mix32B(&acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+  }
+  acc.low = Avalanche(acc.low);
+  acc.high = Avalanche(acc.high);
+  for (size_t i = 160; i <= len; i += 32) {
+    Mix32B(&acc, input + i - 32, input + i - 16, secret + kMidSizeStartOffset + i - 160, seed);
+  }
+  Mix32B(&acc, input + len - 16, input + len - 32, secret + kSecretSizeMin - kMidSizeLastOffset - 16, 0 - seed);
+  return FinalizeMidSize128(acc, len, seed);
+}
+
+// Long inputs: 8 lanes of 64 bit accumulators fed one 64 byte stripe at a time,
+// scrambled after every block of kStripesPerBlock stripes.
+
+typedef void (*accumulate_t)(uint64_t* acc, const unsigned char* input, const unsigned char* secret, size_t stripes);
+typedef void (*scramble_t)(uint64_t* acc, const unsigned char* secret);
+
+inline void Accumulate512Scalar(uint64_t* acc, const unsigned char* input, const unsigned char* secret) {
+  for (size_t i = 0; i < 8; ++i) {
+    const uint64_t data_val = ReadLE64(input + 8 * i);
+    const uint64_t data_key = data_val ^ ReadLE64(secret + 8 * i);
+    acc[i ^ 1] += data_val;
+    acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+  }
+}
+
+void AccumulateScalar(uint64_t* acc, const unsigned char* input, const unsigned char* secret, size_t stripes) {
+  for (size_t n = 0; n < stripes; ++n) {
+    Accumulate512Scalar(acc, input + n * kStripeSize, secret + n * kSecretConsumeRate);
+  }
+}
+
+void ScrambleScalar(uint64_t* acc, const unsigned char* secret) {
+  for (size_t i = 0; i < 8; ++i) {
+    uint64_t acc64 = XorShift64(acc[i], 47);
+    acc64 ^= ReadLE64(secret + 8 * i);
+    acc64 *= kPrime32_1;
+    acc[i] = acc64;
+  }
+}
+
+#if defined(HAVE_X86_SIMD_INSTRUCTIONS)
+// Accumulators are kept in registers for the whole run of stripes.
+void AccumulateSse2(uint64_t* acc, const unsigned char* input, const unsigned char* secret, size_t stripes) {
+  __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+  __m128i a[4];
+  for (size_t i = 0; i < 4; ++i) {
+    a[i] = _mm_loadu_si128(xacc + i);
+  }
+  for (size_t n = 0; n < stripes; ++n) {
+    const __m128i* xinput = reinterpret_cast<const __m128i*>(input + n * kStripeSize);
+    const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret + n * kSecretConsumeRate);
+    for (size_t i = 0; i < 4; ++i) {
+      const __m128i data_vec = _mm_loadu_si128(xinput + i);
+      const __m128i data_key = _mm_xor_si128(data_vec, _mm_loadu_si128(xsecret + i));
+      const __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+      const __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+      const __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+      a[i] = _mm_add_epi64(product, _mm_add_epi64(a[i], data_swap));
+    }
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    _mm_storeu_si128(xacc + i, a[i]);
+  }
+}
+
+void ScrambleSse2(uint64_t* acc, const unsigned char* secret) {
+  __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+  const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+  const __m128i prime32 = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < 4; ++i) {
+    const __m128i acc_vec = _mm_loadu_si128(xacc + i);
+    const __m128i data_vec = _mm_xor_si128(acc_vec, _mm_srli_epi64(acc_vec, 47));
+    const __m128i data_key = _mm_xor_si128(data_vec, _mm_loadu_si128(xsecret + i));
+    const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+    const __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+    _mm_storeu_si128(xacc + i, _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+  }
+}
+
+TARGET_AVX2 void AccumulateAvx2(uint64_t* acc, const unsigned char* input, const unsigned char* secret, size_t stripes) {
+  __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+  __m256i a0 = _mm256_loadu_si256(xacc);
+  __m256i a1 = _mm256_loadu_si256(xacc + 1);
+  for (size_t n = 0; n < stripes; ++n) {
+    const __m256i* xinput = reinterpret_cast<const __m256i*>(input + n * kStripeSize);
+    const __m256i* xsecret = reinterpret_cast<const __m256i*>(secret + n * kSecretConsumeRate);
+    const __m256i data0 = _mm256_loadu_si256(xinput);
+    const __m256i data1 = _mm256_loadu_si256(xinput + 1);
+    const __m256i key0 = _mm256_xor_si256(data0, _mm256_loadu_si256(xsecret));
+    const __m256i key1 = _mm256_xor_si256(data1, _mm256_loadu_si256(xsecret + 1));
+    const __m256i prod0 = _mm256_mul_epu32(key0, _mm256_shuffle_epi32(key0, _MM_SHUFFLE(0, 3, 0, 1)));
+    const __m256i prod1 = _mm256_mul_epu32(key1, _mm256_shuffle_epi32(key1, _MM_SHUFFLE(0, 3, 0, 1)));
+    a0 = _mm256_add_epi64(prod0, _mm256_add_epi64(a0, _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2))));
+    a1 = _mm256_add_epi64(prod1, _mm256_add_epi64(a1, _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2))));
+  }
+  _mm256_storeu_si256(xacc, a0);
+  _mm256_storeu_si256(xacc + 1, a1);
+}
+
+TARGET_AVX2 void ScrambleAvx2(uint64_t* acc, const unsigned char* secret) {
+  __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+  const __m256i* xsecret = reinterpret_cast<const __m256i*>(secret);
+  const __m256i prime32 = _mm256_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < 2; ++i) {
+    const __m256i acc_vec = _mm256_loadu_si256(xacc + i);
+    const __m256i data_vec = _mm256_xor_si256(acc_vec, _mm256_srli_epi64(acc_vec, 47));
+    const __m256i data_key = _mm256_xor_si256(data_vec, _mm256_loadu_si256(xsecret + i));
+    const __m256i data_key_hi = _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+    const __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+    _mm256_storeu_si256(xacc + i, _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+  }
+}
+#endif
+
+struct LongKernels {
+  LongKernels() : accumulate(AccumulateScalar), scramble(ScrambleScalar) {
+#if defined(HAVE_X86_SIMD_INSTRUCTIONS)
+    if (system_info::CurrentCpuFeatures().avx2) {
+      accumulate = AccumulateAvx2;
+      scramble = ScrambleAvx2;
+    } else {
+      accumulate = AccumulateSse2;
+      scramble = ScrambleSse2;
+    }
+#endif
+  }
+
+  accumulate_t accumulate;
+  scramble_t scramble;
+};
+
+const LongKernels& BestKernels() {
+  static const LongKernels kernels;
+  return kernels;
+}
+
+void InitCustomSecret(unsigned char* secret, uint64_t seed) {
+  for (size_t i = 0; i < kSecretSize / 16; ++i) {
+    WriteLE64(secret + 16 * i, ReadLE64(kSecret + 16 * i) + seed);
+    WriteLE64(secret + 16 * i + 8, ReadLE64(kSecret + 16 * i + 8) - seed);
+  }
+}
+
+void HashLongAccumulate(uint64_t* acc, const unsigned char* input, size_t len, const unsigned char* secret) {
+  const LongKernels& kernels = BestKernels();
+  memcpy(acc, kInitAcc, sizeof(kInitAcc));
+  const size_t blocks = (len - 1) / kBlockSize;
+  for (size_t n = 0; n < blocks; ++n) {
+    kernels.accumulate(acc, input + n * kBlockSize, secret, kStripesPerBlock);
+    kernels.scramble(acc, secret + kSecretSize - kStripeSize);
+  }
+
+  const size_t stripes = ((len - 1) - kBlockSize * blocks) / kStripeSize;
+  kernels.accumulate(acc, input + blocks * kBlockSize, secret, stripes);
+  kernels.accumulate(acc, input + len - kStripeSize, secret + kSecretSize - kStripeSize - kLastAccStart, 1);
+}
+
+uint64_t MergeAccs(const uint64_t* acc, const unsigned char* secret, uint64_t start) {
+  uint64_t result = start;
+  for (size_t i = 0; i < 4; ++i) {
+    result += Mul128Fold64(acc[2 * i] ^ ReadLE64(secret + 16 * i), acc[2 * i + 1] ^ ReadLE64(secret + 16 * i + 8));
+  }
+  return Avalanche(result);
+}
+
+uint64_t Digest64Long(const uint64_t* acc, const unsigned char* secret, uint64_t len) {
+  return MergeAccs(acc, secret + kMergeAccsStart, len * kPrime64_1);
+}
+
+Hash128 Digest128Long(const uint64_t* acc, const unsigned char* secret, uint64_t len) {
+  Hash128 h128;
+  h128.low = MergeAccs(acc, secret + kMergeAccsStart, len * kPrime64_1);
+  h128.high = MergeAccs(acc, secret + kSecretSize - sizeof(kInitAcc) - kMergeAccsStart, ~(len * kPrime64_2));
+  return h128;
+}
+
+const unsigned char* SecretForSeed(uint64_t seed, unsigned char* custom) {
+  if (seed == 0) {
+    return kSecret;
+  }
+  InitCustomSecret(custom, seed);
+  return custom;
+}
+
+const unsigned char* ConsumeStripes(uint64_t* acc,
+                                    size_t* stripes_so_far,
+                                    const unsigned char* input,
+                                    size_t stripes,
+                                    const unsigned char* secret) {
+  const LongKernels& kernels = BestKernels();
+  const unsigned char* initial_secret = secret + *stripes_so_far * kSecretConsumeRate;
+  if (stripes >= kStripesPerBlock - *stripes_so_far) {
+    size_t stripes_this_iter = kStripesPerBlock - *stripes_so_far;
+    do {
+      kernels.accumulate(acc, input, initial_secret, stripes_this_iter);
+      kernels.scramble(acc, secret + kSecretSize - kStripeSize);
+      input += stripes_this_iter * kStripeSize;
+      stripes -= stripes_this_iter;
+      stripes_this_iter = kStripesPerBlock;
+      initial_secret = secret;
+    } while (stripes >= kStripesPerBlock);
+    *stripes_so_far = 0;
+  }
+  if (stripes > 0) {
+    kernels.accumulate(acc, input, initial_secret, stripes);
+    input += stripes * kStripeSize;
+    *stripes_so_far += stripes;
+  }
+  return input;
+}
+
+}  // namespace
+
+uint64_t FastHash64(const void* data, size_t len, uint64_t seed) {
+  const unsigned char* input = static_cast<const unsigned char*>(data);
+  if (len <= 16) {
+    return Hash64Len0To16(input, len, kSecret, seed);
+  }
+  if (len <= 128) {
+    return Hash64Len17To128(input, len, kSecret, seed);
+  }
+  if (len <= kMidSizeMax) {
+    return Hash64Len129To240(input, len, kSecret, seed);
+  }
+
+  unsigned char custom[kSecretSize];
+  const unsigned char* secret = SecretForSeed(seed, custom);
+  uint64_t acc[8];
+  HashLongAccumulate(acc, input, len, secret);
+  return Digest64Long(acc, secret, len);
+}
+
+Hash128 FastHash128(const void* data, size_t len, uint64_t seed) {
+  const unsigned char* input = static_cast<const unsigned char*>(data);
+  if (len <= 16) {
+    return Hash128Len0To16(input, len, kSecret, seed);
+  }
+  if (len <= 128) {
+    return Hash128Len17To128(input, len, kSecret, seed);
+  }
+  if (len <= kMidSizeMax) {
+    return Hash128Len129To240(input, len, kSecret, seed);
+  }
+
+  unsigned char custom[kSecretSize];
+  const unsigned char* secret = SecretForSeed(seed, custom);
+  uint64_t acc[8];
+  HashLongAccumulate(acc, input, len, secret);
+  return Digest128Long(acc, secret, len);
+}
+
+FastHasher::FastHasher(uint64_t seed) {
+  Reset(seed);
+}
+
+void FastHasher::Reset(uint64_t seed) {
+  memcpy(acc_, kInitAcc, sizeof(acc_));
+  InitCustomSecret(secret_, seed);
+  buffered_size_ = 0;
+  stripes_so_far_ = 0;
+  total_len_ = 0;
+  seed_ = seed;
+}
+
+void FastHasher::Update(const void* data, size_t len) {
+  if (!data || len == 0) {
+    return;
+  }
+
+  const unsigned char* input = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = input + len;
+  total_len_ += len;
+  if (buffered_size_ + len <= BUFFER_SIZE) {
+    memcpy(buffer_ + buffered_size_, input, len);
+    buffered_size_ += len;
+    return;
+  }
+
+  if (buffered_size_) {
+    const size_t load_size = BUFFER_SIZE - buffered_size_;
+    memcpy(buffer_ + buffered_size_, input, load_size);
+    input += load_size;
+    ConsumeStripes(acc_, &stripes_so_far_, buffer_, BUFFER_SIZE / STRIPE_SIZE, secret_);
+    buffered_size_ = 0;
+  }
+
+  // the last stripe is always kept buffered, digest needs it
+  if (static_cast<size_t>(end - input) > BUFFER_SIZE) {
+    const size_t stripes = static_cast<size_t>(end - 1 - input) / STRIPE_SIZE;
+    input = ConsumeStripes(acc_, &stripes_so_far_, input, stripes, secret_);
+    memcpy(buffer_ + BUFFER_SIZE - STRIPE_SIZE, input - STRIPE_SIZE, STRIPE_SIZE);
+  }
+
+  buffered_size_ = static_cast<size_t>(end - input);
+  memcpy(buffer_, input, buffered_size_);
+}
+
+void FastHasher::DigestLong(uint64_t acc[8]) const {
+  memcpy(acc, acc_, sizeof(acc_));
+  const unsigned char* last_stripe;
+  unsigned char last_stripe_buf[STRIPE_SIZE];
+  if (buffered_size_ >= STRIPE_SIZE) {
+    const size_t stripes = (buffered_size_ - 1) / STRIPE_SIZE;
+    size_t stripes_so_far = stripes_so_far_;
+    ConsumeStripes(acc, &stripes_so_far, buffer_, stripes, secret_);
+    last_stripe = buffer_ + buffered_size_ - STRIPE_SIZE;
+  } else {
+    const size_t catchup_size = STRIPE_SIZE - buffered_size_;
+    memcpy(last_stripe_buf, buffer_ + BUFFER_SIZE - catchup_size, catchup_size);
+    memcpy(last_stripe_buf + catchup_size, buffer_, buffered_size_);
+    last_stripe = last_stripe_buf;
+  }
+  BestKernels().accumulate(acc, last_stripe, secret_ + kSecretSize - kStripeSize - kLastAccStart, 1);
+}
+
+uint64_t FastHasher::Digest64() const {
+  if (total_len_ <= kMidSizeMax) {
+    return FastHash64(buffer_, static_cast<size_t>(total_len_), seed_);
+  }
+
+  uint64_t acc[8];
+  DigestLong(acc);
+  return Digest64Long(acc, secret_, total_len_);
+}
+
+Hash128 FastHasher::Digest128() const {
+  if (total_len_ <= kMidSizeMax) {
+    return FastHash128(buffer_, static_cast<size_t>(total_len_), seed_);
+  }
+
+  uint64_t acc[8];
+  DigestLong(acc);
+  return Digest128Long(acc, secret_, total_len_);
+}
+
+}  // namespace hash
+}  // namespace common
@@ -32,7 +32,9 @@
 #include <stdint.h>
 #include <string.h>
 
-#include <common/portable_endian.h>
+#include <common/system_info/cpu_features.h>
+
+#include "sha_common.h"
 
 /* code */
 #define SHA1_K0 0x5a827999
@@ -43,119 +45,312 @@
 namespace common {
 namespace hash {
 namespace {
+const uint32_t sha1_iv[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
 uint32_t sha1_rol32(uint32_t number, uint8_t bits) {
   return ((number << bits) | (number >> (32 - bits)));
 }
 
-void sha1_hashBlock(SHA1_CTX* s) {
+void sha1_hashBlocks(uint32_t state[5], const unsigned char* data, size_t blocks) {
   uint8_t i;
-  uint32_t a, b, c, d, e, t;
-
-  a = s->state[0];
-  b = s->state[1];
-  c = s->state[2];
-  d = s->state[3];
-  e = s->state[4];
-  for (i = 0; i < 80; i++) {
-    if (i >= 16) {
-      t = s->buffer[(i + 13) & 15] ^ s->buffer[(i + 8) & 15] ^ s->buffer[(i + 2) & 15] ^ s->buffer[i & 15];
-      s->buffer[i & 15] = sha1_rol32(t, 1);
+  uint32_t a, b, c, d, e, t, buffer[16];
+
+  for (; blocks--; data += detail::SHA_BLOCK_SIZE) {
+    for (i = 0; i < 16; i++) {
+      buffer[i] = detail::LoadBE32(data + i * 4);
     }
-    if (i < 20) {
-      t = (d ^ (b & (c ^ d))) + SHA1_K0;
-    } else if (i < 40) {
-      t = (b ^ c ^ d) + SHA1_K20;
-    } else if (i < 60) {
-      t = ((b & c) | (d & (b | c))) + SHA1_K40;
-    } else {
-      t = (b ^ c ^ d) + SHA1_K60;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    for (i = 0; i < 80; i++) {
+      if (i >= 16) {
+        t = buffer[(i + 13) & 15] ^ buffer[(i + 8) & 15] ^ buffer[(i + 2) & 15] ^ buffer[i & 15];
+        buffer[i & 15] = sha1_rol32(t, 1);
+      }
+      if (i < 20) {
+        t = (d ^ (b & (c ^ d))) + SHA1_K0;
+      } else if (i < 40) {
+        t = (b ^ c ^ d) + SHA1_K20;
+      } else if (i < 60) {
+        t = ((b & c) | (d & (b | c))) + SHA1_K40;
+      } else {
+        t = (b ^ c ^ d) + SHA1_K60;
+      }
+      t += sha1_rol32(a, 5) + e + buffer[i & 15];
+      e = d;
+      d = c;
+      c = sha1_rol32(b, 30);
+      b = a;
+      a = t;
     }
-    t += sha1_rol32(a, 5) + e + s->buffer[i & 15];
-    e = d;
-    d = c;
-    c = sha1_rol32(b, 30);
-    b = a;
-    a = t;
-  }
-  s->state[0] += a;
-  s->state[1] += b;
-  s->state[2] += c;
-  s->state[3] += d;
-  s->state[4] += e;
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
 }
 
-void sha1_addUncounted(SHA1_CTX* s, uint8_t data) {
-  uint8_t* const b = reinterpret_cast<uint8_t*>(s->buffer);
-#if defined(ARCH_CPU_BIG_ENDIAN)
-  b[s->buffer_offset] = data;
-#else
-  b[s->buffer_offset ^ 3] = data;
-#endif
-  s->buffer_offset++;
-  if (s->buffer_offset == BLOCK_LENGTH) {
-    sha1_hashBlock(s);
-    s->buffer_offset = 0;
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+// Four rounds of the SHA extensions, msg[G % 4] holds words 4G..4G+3 while
+// the schedule for the following groups is built in the other registers.
+template <int G>
+TARGET_SHA inline void sha1_rounds_shani(__m128i* abcd, __m128i* e0, __m128i* e1, __m128i msg[4]) {
+  __m128i* e_in = G % 2 == 0 ? e0 : e1;
+  __m128i* e_out = G % 2 == 0 ? e1 : e0;
+  if (G == 0) {
+    *e_in = _mm_add_epi32(*e_in, msg[0]);
+  } else {
+    *e_in = _mm_sha1nexte_epu32(*e_in, msg[G % 4]);
+  }
+  *e_out = *abcd;
+  if (G >= 3 && G <= 18) {
+    msg[(G + 1) % 4] = _mm_sha1msg2_epu32(msg[(G + 1) % 4], msg[G % 4]);
+  }
+  *abcd = _mm_sha1rnds4_epu32(*abcd, *e_in, G / 5);
+  if (G >= 1 && G <= 16) {
+    msg[(G + 3) % 4] = _mm_sha1msg1_epu32(msg[(G + 3) % 4], msg[G % 4]);
+  }
+  if (G >= 2 && G <= 17) {
+    msg[(G + 2) % 4] = _mm_xor_si128(msg[(G + 2) % 4], msg[G % 4]);
   }
 }
 
-void sha1_updatebyte(SHA1_CTX* s, uint8_t data) {
-  ++s->byte_count;
-  sha1_addUncounted(s, data);
+template <int G>
+struct Sha1RoundsShani {
+  TARGET_SHA static inline void Run(__m128i* abcd, __m128i* e0, __m128i* e1, __m128i msg[4]) {
+    sha1_rounds_shani<G>(abcd, e0, e1, msg);
+    Sha1RoundsShani<G + 1>::Run(abcd, e0, e1, msg);
+  }
+};
+
+template <>
+struct Sha1RoundsShani<20> {
+  TARGET_SHA static inline void Run(__m128i*, __m128i*, __m128i*, __m128i*) {}
+};
+
+TARGET_SHA void sha1_hashBlocks_shani(uint32_t state[5], const unsigned char* data, size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+  __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+  __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+  __m128i e1;
+
+  for (; blocks--; data += detail::SHA_BLOCK_SIZE) {
+    const __m128i abcd_save = abcd;
+    const __m128i e0_save = e0;
+
+    __m128i msg[4];
+    for (int i = 0; i < 4; ++i) {
+      msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), mask);
+    }
+    Sha1RoundsShani<0>::Run(&abcd, &e0, &e1, msg);
+
+    e0 = _mm_sha1nexte_epu32(e0, e0_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+  }
+
+  abcd = _mm_shuffle_epi32(abcd, 0x1B);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+  state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
 }
 
-void sha1_pad(SHA1_CTX* s) {
-  // Implement SHA-1 padding (fips180-2 Â§5.1.1)
+// Eight independent messages per call, one per 32 bit lane.
+TARGET_AVX2 void sha1_hashBlocks_avx2_lanes(uint32_t state[5][detail::SHA_MULTI_BUFFER_LANES],
+                                            const detail::PaddedMessage* const lanes[detail::SHA_MULTI_BUFFER_LANES],
+                                            size_t blocks) {
+  using detail::Rotr256;
+  __m256i s[5];
+  for (int i = 0; i < 5; ++i) {
+    s[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[i]));
+  }
 
-  // Pad with 0x80 followed by 0x00 until the end of the block
-  sha1_addUncounted(s, 0x80);
-  while (s->buffer_offset != 56) {
-    sha1_addUncounted(s, 0x00);
+  for (size_t block = 0; block < blocks; ++block) {
+    const unsigned char* data[detail::SHA_MULTI_BUFFER_LANES];
+    for (size_t lane = 0; lane < detail::SHA_MULTI_BUFFER_LANES; ++lane) {
+      data[lane] = lanes[lane]->Block(block);
+    }
+
+    __m256i buffer[16];
+    for (int i = 0; i < 16; ++i) {
+      buffer[i] = detail::LoadLanesWord(data, i);
+    }
+
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+    for (int i = 0; i < 80; i++) {
+      if (i >= 16) {
+        const __m256i t = _mm256_xor_si256(_mm256_xor_si256(buffer[(i + 13) & 15], buffer[(i + 8) & 15]),
+                                           _mm256_xor_si256(buffer[(i + 2) & 15], buffer[i & 15]));
+        buffer[i & 15] = Rotr256(t, 31);
+      }
+      __m256i f;
+      uint32_t k;
+      if (i < 20) {
+        f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+        k = SHA1_K0;
+      } else if (i < 40) {
+        f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+        k = SHA1_K20;
+      } else if (i < 60) {
+        f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+        k = SHA1_K40;
+      } else {
+        f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+        k = SHA1_K60;
+      }
+      const __m256i t = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(Rotr256(a, 27), f), _mm256_add_epi32(e, buffer[i & 15])),
+                                         _mm256_set1_epi32(static_cast<int>(k)));
+      e = d;
+      d = c;
+      c = Rotr256(b, 2);
+      b = a;
+      a = t;
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
   }
 
-  // Append length in the last 8 bytes
-  sha1_addUncounted(s, 0);                    // We're only using 32 bit lengths
-  sha1_addUncounted(s, 0);                    // But SHA-1 supports 64 bit lengths
-  sha1_addUncounted(s, 0);                    // So zero pad the top bits
-  sha1_addUncounted(s, s->byte_count >> 29);  // Shifting to multiply by 8
-  sha1_addUncounted(s, s->byte_count >> 21);  // as SHA-1 supports bitstreams as well as
-  sha1_addUncounted(s, s->byte_count >> 13);  // byte.
-  sha1_addUncounted(s, s->byte_count >> 5);
-  sha1_addUncounted(s, s->byte_count << 3);
+  for (int i = 0; i < 5; ++i) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[i]), s[i]);
+  }
+}
+#endif
+
+#if defined(HAVE_ARM_SHA_INSTRUCTIONS)
+void sha1_hashBlocks_arm(uint32_t state[5], const unsigned char* data, size_t blocks) {
+  uint32x4_t abcd = vld1q_u32(state);
+  uint32_t e = state[4];
+
+  for (; blocks--; data += detail::SHA_BLOCK_SIZE) {
+    const uint32x4_t abcd_save = abcd;
+    const uint32_t e_save = e;
+
+    uint32x4_t msg[4];
+    for (int i = 0; i < 4; ++i) {
+      msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+    }
+    for (int group = 0; group < 20; ++group) {
+      const uint32_t k = group < 5 ? SHA1_K0 : group < 10 ? SHA1_K20 : group < 15 ? SHA1_K40 : SHA1_K60;
+      const uint32x4_t words = vaddq_u32(msg[group % 4], vdupq_n_u32(k));
+      if (group < 16) {
+        msg[group % 4] =
+            vsha1su1q_u32(vsha1su0q_u32(msg[group % 4], msg[(group + 1) % 4], msg[(group + 2) % 4]), msg[(group + 3) % 4]);
+      }
+      const uint32_t e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      if (group < 5) {
+        abcd = vsha1cq_u32(abcd, e, words);
+      } else if (group < 10 || group >= 15) {
+        abcd = vsha1pq_u32(abcd, e, words);
+      } else {
+        abcd = vsha1mq_u32(abcd, e, words);
+      }
+      e = e_next;
+    }
+
+    abcd = vaddq_u32(abcd, abcd_save);
+    e += e_save;
+  }
+
+  vst1q_u32(state, abcd);
+  state[4] = e;
+}
+#endif
+
+typedef void (*sha1_hash_blocks_t)(uint32_t state[5], const unsigned char* data, size_t blocks);
+
+sha1_hash_blocks_t sha1_select_hash_blocks() {
+#if defined(HAVE_ARM_SHA_INSTRUCTIONS)
+  return sha1_hashBlocks_arm;
+#else
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+  if (system_info::CurrentCpuFeatures().sha) {
+    return sha1_hashBlocks_shani;
+  }
+#endif
+  return sha1_hashBlocks;
+#endif
+}
+
+sha1_hash_blocks_t sha1_best_hash_blocks() {
+  static const sha1_hash_blocks_t hash_blocks = sha1_select_hash_blocks();
+  return hash_blocks;
 }
 
 }  // namespace
 
 void SHA1_Init(SHA1_CTX* s) {
-  s->state[0] = 0x67452301;
-  s->state[1] = 0xefcdab89;
-  s->state[2] = 0x98badcfe;
-  s->state[3] = 0x10325476;
-  s->state[4] = 0xc3d2e1f0;
+  memcpy(s->state, sha1_iv, sizeof(sha1_iv));
   s->byte_count = 0;
   s->buffer_offset = 0;
 }
 
 void SHA1_Update(SHA1_CTX* s, const unsigned char* data, size_t len) {
-  for (; len--;) {
-    sha1_updatebyte(s, *data++);
+  const sha1_hash_blocks_t hash_blocks = sha1_best_hash_blocks();
+  uint8_t* const buffer = reinterpret_cast<uint8_t*>(s->buffer);
+  s->byte_count += len;
+  if (s->buffer_offset) {
+    const size_t space = BLOCK_LENGTH - s->buffer_offset;
+    const size_t fill = space < len ? space : len;
+    memcpy(buffer + s->buffer_offset, data, fill);
+    s->buffer_offset = static_cast<uint8_t>(s->buffer_offset + fill);
+    data += fill;
+    len -= fill;
+    if (s->buffer_offset < BLOCK_LENGTH) {
+      return;
+    }
+    hash_blocks(s->state, buffer, 1);
+    s->buffer_offset = 0;
+  }
+
+  const size_t blocks = len / BLOCK_LENGTH;
+  if (blocks) {
+    hash_blocks(s->state, data, blocks);
+    data += blocks * BLOCK_LENGTH;
+    len -= blocks * BLOCK_LENGTH;
   }
+
+  memcpy(buffer, data, len);
+  s->buffer_offset = static_cast<uint8_t>(len);
 }
 
 void SHA1_Final(SHA1_CTX* s, uint8_t* result) {
-  // Pad to complete the last block
-  sha1_pad(s);
+  // Implement SHA-1 padding (fips180-2 5.1.1): 0x80, zeros, 64 bit length
+  const sha1_hash_blocks_t hash_blocks = sha1_best_hash_blocks();
+  uint8_t* const buffer = reinterpret_cast<uint8_t*>(s->buffer);
+  size_t offset = s->buffer_offset;
+  buffer[offset++] = 0x80;
+  if (offset > BLOCK_LENGTH - 8) {
+    memset(buffer + offset, 0, BLOCK_LENGTH - offset);
+    hash_blocks(s->state, buffer, 1);
+    offset = 0;
+  }
+  memset(buffer + offset, 0, BLOCK_LENGTH - 8 - offset);
+  const uint64_t bits = s->byte_count * 8;
+  detail::StoreBE32(static_cast<uint32_t>(bits >> 32), buffer + BLOCK_LENGTH - 8);
+  detail::StoreBE32(static_cast<uint32_t>(bits), buffer + BLOCK_LENGTH - 4);
+  hash_blocks(s->state, buffer, 1);
 
-#ifndef ARCH_CPU_BIG_ENDIAN
-  // Swap byte order back
-  int i;
-  for (i = 0; i < 5; i++) {
-    s->state[i] = (((s->state[i]) << 24) & 0xff000000) | (((s->state[i]) << 8) & 0x00ff0000) |
-                  (((s->state[i]) >> 8) & 0x0000ff00) | (((s->state[i]) >> 24) & 0x000000ff);
+  for (int i = 0; i < 5; i++) {
+    detail::StoreBE32(s->state[i], result + i * 4);
   }
-#endif
+}
 
-  // Return pointer to hash (20 characters)
-  memcpy(result, reinterpret_cast<uint8_t*>(s->state), SHA1_HASH_LENGTH);
+void SHA1_Multi(const unsigned char* const* data, const size_t* lens, size_t count, unsigned char* hashes) {
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+  // one sha extensions stream is faster than eight avx2 lanes
+  if (!system_info::CurrentCpuFeatures().sha && system_info::CurrentCpuFeatures().avx2) {
+    detail::MultiBufferHash<5>(sha1_iv, sha1_hashBlocks_avx2_lanes, sha1_hashBlocks, data, lens, count, hashes);
+    return;
+  }
+#endif
+  detail::SequentialHash<5>(sha1_iv, sha1_best_hash_blocks(), data, lens, count, hashes);
 }
 
 }  // namespace hash
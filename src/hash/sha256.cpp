@@ -32,6 +32,10 @@
 #include <memory.h>
 #include <stdlib.h>
 
+#include <common/system_info/cpu_features.h>
+
+#include "sha_common.h"
+
 #define ROTLEFT(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
 #define ROTRIGHT(a, b) (((a) >> (b)) | ((a) << (32 - (b))))
 
@@ -56,46 +60,229 @@ const unsigned int k[64] = {
     0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
     0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
-void sha256_transform(SHA256_CTX* ctx, const unsigned char data[]) {
-  unsigned int a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
+const uint32_t sha256_iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                               0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+void sha256_transform(uint32_t state[8], const unsigned char* data, size_t blocks) {
+  uint32_t a, b, c, d, e, f, g, h, t1, t2, m[64];
+
+  for (; blocks--; data += detail::SHA_BLOCK_SIZE) {
+    unsigned int i;
+    for (i = 0; i < 16; ++i) {
+      m[i] = detail::LoadBE32(data + i * 4);
+    }
+    for (; i < 64; ++i) {
+      m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+    }
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
 
-  for (i = 0, j = 0; i < 16; ++i, j += 4) {
-    m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
+    for (i = 0; i < 64; ++i) {
+      t1 = h + EP1(e) + CH(e, f, g) + k[i] + m[i];
+      t2 = EP0(a) + MAJ(a, b, c);
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
   }
-  for (; i < 64; ++i) {
-    m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+}
+
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+// Four rounds of the SHA extensions; msg[G % 4] holds words 4G..4G+3 and is
+// replaced by the schedule for the group G + 4 is it needs.
+template <int G>
+TARGET_SHA inline void sha256_rounds_shani(__m128i* state0, __m128i* state1, __m128i msg[4]) {
+  if (G >= 4) {
+    __m128i next = _mm_sha256msg1_epu32(msg[G % 4], msg[(G + 1) % 4]);
+    next = _mm_add_epi32(next, _mm_alignr_epi8(msg[(G + 3) % 4], msg[(G + 2) % 4], 4));
+    msg[G % 4] = _mm_sha256msg2_epu32(next, msg[(G + 3) % 4]);
+  }
+  __m128i words = _mm_add_epi32(msg[G % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(k + G * 4)));
+  *state1 = _mm_sha256rnds2_epu32(*state1, *state0, words);
+  words = _mm_shuffle_epi32(words, 0x0E);
+  *state0 = _mm_sha256rnds2_epu32(*state0, *state1, words);
+}
+
+template <int G>
+struct Sha256RoundsShani {
+  TARGET_SHA static inline void Run(__m128i* state0, __m128i* state1, __m128i msg[4]) {
+    sha256_rounds_shani<G>(state0, state1, msg);
+    Sha256RoundsShani<G + 1>::Run(state0, state1, msg);
   }
+};
 
-  a = ctx->state[0];
-  b = ctx->state[1];
-  c = ctx->state[2];
-  d = ctx->state[3];
-  e = ctx->state[4];
-  f = ctx->state[5];
-  g = ctx->state[6];
-  h = ctx->state[7];
-
-  for (i = 0; i < 64; ++i) {
-    t1 = h + EP1(e) + CH(e, f, g) + k[i] + m[i];
-    t2 = EP0(a) + MAJ(a, b, c);
-    h = g;
-    g = f;
-    f = e;
-    e = d + t1;
-    d = c;
-    c = b;
-    b = a;
-    a = t1 + t2;
+template <>
+struct Sha256RoundsShani<16> {
+  TARGET_SHA static inline void Run(__m128i*, __m128i*, __m128i*) {}
+};
+
+TARGET_SHA void sha256_transform_shani(uint32_t state[8], const unsigned char* data, size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+  __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);                // CDAB
+  state1 = _mm_shuffle_epi32(state1, 0x1B);          // EFGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+  for (; blocks--; data += detail::SHA_BLOCK_SIZE) {
+    const __m128i abef_save = state0;
+    const __m128i cdgh_save = state1;
+
+    __m128i msg[4];
+    for (int i = 0; i < 4; ++i) {
+      msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), mask);
+    }
+    Sha256RoundsShani<0>::Run(&state0, &state1, msg);
+
+    state0 = _mm_add_epi32(state0, abef_save);
+    state1 = _mm_add_epi32(state1, cdgh_save);
   }
 
-  ctx->state[0] += a;
-  ctx->state[1] += b;
-  ctx->state[2] += c;
-  ctx->state[3] += d;
-  ctx->state[4] += e;
-  ctx->state[5] += f;
-  ctx->state[6] += g;
-  ctx->state[7] += h;
+  tmp = _mm_shuffle_epi32(state0, 0x1B);        // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xB1);     // DCHG
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);  // DCBA
+  state1 = _mm_alignr_epi8(state1, tmp, 8);     // ABEF
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+// Eight independent messages per call, one per 32 bit lane.
+TARGET_AVX2 void sha256_transform_avx2_lanes(uint32_t state[8][detail::SHA_MULTI_BUFFER_LANES],
+                                             const detail::PaddedMessage* const lanes[detail::SHA_MULTI_BUFFER_LANES],
+                                             size_t blocks) {
+  using detail::Rotr256;
+  __m256i s[8];
+  for (int i = 0; i < 8; ++i) {
+    s[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[i]));
+  }
+
+  for (size_t block = 0; block < blocks; ++block) {
+    const unsigned char* data[detail::SHA_MULTI_BUFFER_LANES];
+    for (size_t lane = 0; lane < detail::SHA_MULTI_BUFFER_LANES; ++lane) {
+      data[lane] = lanes[lane]->Block(block);
+    }
+
+    __m256i m[16];
+    for (int i = 0; i < 16; ++i) {
+      m[i] = detail::LoadLanesWord(data, i);
+    }
+
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+      if (i >= 16) {
+        const __m256i w2 = m[(i - 2) & 15];
+        const __m256i w15 = m[(i - 15) & 15];
+        const __m256i sig1 = _mm256_xor_si256(_mm256_xor_si256(Rotr256(w2, 17), Rotr256(w2, 19)), _mm256_srli_epi32(w2, 10));
+        const __m256i sig0 = _mm256_xor_si256(_mm256_xor_si256(Rotr256(w15, 7), Rotr256(w15, 18)), _mm256_srli_epi32(w15, 3));
+        m[i & 15] = _mm256_add_epi32(_mm256_add_epi32(sig1, m[(i - 7) & 15]), _mm256_add_epi32(sig0, m[i & 15]));
+      }
+      const __m256i ep1 = _mm256_xor_si256(_mm256_xor_si256(Rotr256(e, 6), Rotr256(e, 11)), Rotr256(e, 25));
+      const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+      const __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(h, ep1), _mm256_add_epi32(ch, m[i & 15])),
+                                          _mm256_set1_epi32(static_cast<int>(k[i])));
+      const __m256i ep0 = _mm256_xor_si256(_mm256_xor_si256(Rotr256(a, 2), Rotr256(a, 13)), Rotr256(a, 22));
+      const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+      const __m256i t2 = _mm256_add_epi32(ep0, maj);
+      h = g;
+      g = f;
+      f = e;
+      e = _mm256_add_epi32(d, t1);
+      d = c;
+      c = b;
+      b = a;
+      a = _mm256_add_epi32(t1, t2);
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+    s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g);
+    s[7] = _mm256_add_epi32(s[7], h);
+  }
+
+  for (int i = 0; i < 8; ++i) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[i]), s[i]);
+  }
+}
+#endif
+
+#if defined(HAVE_ARM_SHA_INSTRUCTIONS)
+void sha256_transform_arm(uint32_t state[8], const unsigned char* data, size_t blocks) {
+  uint32x4_t state0 = vld1q_u32(&state[0]);
+  uint32x4_t state1 = vld1q_u32(&state[4]);
+
+  for (; blocks--; data += detail::SHA_BLOCK_SIZE) {
+    const uint32x4_t abef_save = state0;
+    const uint32x4_t cdgh_save = state1;
+
+    uint32x4_t msg[4];
+    for (int i = 0; i < 4; ++i) {
+      msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+    }
+    for (int group = 0; group < 16; ++group) {
+      const uint32x4_t words = vaddq_u32(msg[group % 4], vld1q_u32(k + group * 4));
+      if (group < 12) {
+        msg[group % 4] = vsha256su1q_u32(vsha256su0q_u32(msg[group % 4], msg[(group + 1) % 4]), msg[(group + 2) % 4],
+                                         msg[(group + 3) % 4]);
+      }
+      const uint32x4_t abef = state0;
+      state0 = vsha256hq_u32(state0, state1, words);
+      state1 = vsha256h2q_u32(state1, abef, words);
+    }
+
+    state0 = vaddq_u32(state0, abef_save);
+    state1 = vaddq_u32(state1, cdgh_save);
+  }
+
+  vst1q_u32(&state[0], state0);
+  vst1q_u32(&state[4], state1);
+}
+#endif
+
+typedef void (*sha256_transform_t)(uint32_t state[8], const unsigned char* data, size_t blocks);
+
+sha256_transform_t sha256_select_transform() {
+#if defined(HAVE_ARM_SHA_INSTRUCTIONS)
+  return sha256_transform_arm;
+#else
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+  if (system_info::CurrentCpuFeatures().sha) {
+    return sha256_transform_shani;
+  }
+#endif
+  return sha256_transform;
+#endif
+}
+
+sha256_transform_t sha256_best_transform() {
+  static const sha256_transform_t transform = sha256_select_transform();
+  return transform;
 }
 
 }  // namespace
@@ -103,29 +290,39 @@ void sha256_transform(SHA256_CTX* ctx, const unsigned char data[]) {
 void SHA256_Init(SHA256_CTX* ctx) {
   ctx->datalen = 0;
   ctx->bitlen = 0;
-  ctx->state[0] = 0x6a09e667;
-  ctx->state[1] = 0xbb67ae85;
-  ctx->state[2] = 0x3c6ef372;
-  ctx->state[3] = 0xa54ff53a;
-  ctx->state[4] = 0x510e527f;
-  ctx->state[5] = 0x9b05688c;
-  ctx->state[6] = 0x1f83d9ab;
-  ctx->state[7] = 0x5be0cd19;
+  memcpy(ctx->state, sha256_iv, sizeof(sha256_iv));
 }
 
 void SHA256_Update(SHA256_CTX* ctx, const unsigned char* data, size_t len) {
-  for (unsigned int i = 0; i < len; ++i) {
-    ctx->data[ctx->datalen] = data[i];
-    ctx->datalen++;
-    if (ctx->datalen == 64) {
-      sha256_transform(ctx, ctx->data);
-      ctx->bitlen += 512;
-      ctx->datalen = 0;
+  const sha256_transform_t transform = sha256_best_transform();
+  if (ctx->datalen) {
+    const size_t fill = detail::SHA_BLOCK_SIZE - ctx->datalen < len ? detail::SHA_BLOCK_SIZE - ctx->datalen : len;
+    memcpy(ctx->data + ctx->datalen, data, fill);
+    ctx->datalen += fill;
+    data += fill;
+    len -= fill;
+    if (ctx->datalen < detail::SHA_BLOCK_SIZE) {
+      return;
     }
+    transform(ctx->state, ctx->data, 1);
+    ctx->bitlen += 512;
+    ctx->datalen = 0;
   }
+
+  const size_t blocks = len / detail::SHA_BLOCK_SIZE;
+  if (blocks) {
+    transform(ctx->state, data, blocks);
+    ctx->bitlen += blocks * 512;
+    data += blocks * detail::SHA_BLOCK_SIZE;
+    len -= blocks * detail::SHA_BLOCK_SIZE;
+  }
+
+  memcpy(ctx->data, data, len);
+  ctx->datalen = len;
 }
 
 void SHA256_Final(SHA256_CTX* ctx, unsigned char* hash) {
+  const sha256_transform_t transform = sha256_best_transform();
   unsigned int i = ctx->datalen;
 
   if (ctx->datalen < 56) {
@@ -138,7 +335,7 @@ void SHA256_Final(SHA256_CTX* ctx, unsigned char* hash) {
     while (i < 64) {
       ctx->data[i++] = 0x00;
     }
-    sha256_transform(ctx, ctx->data);
+    transform(ctx->state, ctx->data, 1);
     memset(ctx->data, 0, 56);
   }
 
@@ -151,18 +348,22 @@ void SHA256_Final(SHA256_CTX* ctx, unsigned char* hash) {
   ctx->data[58] = ctx->bitlen >> 40;
   ctx->data[57] = ctx->bitlen >> 48;
   ctx->data[56] = ctx->bitlen >> 56;
-  sha256_transform(ctx, ctx->data);
-
-  for (i = 0; i < 4; ++i) {
-    hash[i] = (ctx->state[0] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 4] = (ctx->state[1] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 8] = (ctx->state[2] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 12] = (ctx->state[3] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 16] = (ctx->state[4] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 20] = (ctx->state[5] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 24] = (ctx->state[6] >> (24 - i * 8)) & 0x000000ff;
-    hash[i + 28] = (ctx->state[7] >> (24 - i * 8)) & 0x000000ff;
+  transform(ctx->state, ctx->data, 1);
+
+  for (i = 0; i < 8; ++i) {
+    detail::StoreBE32(ctx->state[i], hash + i * 4);
+  }
+}
+
+void SHA256_Multi(const unsigned char* const* data, const size_t* lens, size_t count, unsigned char* hashes) {
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+  // one sha extensions stream is faster than eight avx2 lanes
+  if (!system_info::CurrentCpuFeatures().sha && system_info::CurrentCpuFeatures().avx2) {
+    detail::MultiBufferHash<8>(sha256_iv, sha256_transform_avx2_lanes, sha256_transform, data, lens, count, hashes);
+    return;
   }
+#endif
+  detail::SequentialHash<8>(sha256_iv, sha256_best_transform(), data, lens, count, hashes);
 }
 
 }  // namespace hash
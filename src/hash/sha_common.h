@@ -0,0 +1,217 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <common/portable_endian.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define HAVE_X86_SHA_INSTRUCTIONS
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SHA __attribute__((target("sha,sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SHA
+#define TARGET_AVX2
+#endif
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#include <arm_neon.h>
+#define HAVE_ARM_SHA_INSTRUCTIONS
+#endif
+
+namespace common {
+namespace hash {
+namespace detail {
+
+const size_t SHA_BLOCK_SIZE = 64;
+const size_t SHA_MULTI_BUFFER_LANES = 8;
+
+inline uint32_t LoadBE32(const unsigned char* data) {
+  uint32_t word;
+  memcpy(&word, data, sizeof(word));
+  return be32toh(word);
+}
+
+inline void StoreBE32(uint32_t word, unsigned char* out) {
+  word = htobe32(word);
+  memcpy(out, &word, sizeof(word));
+}
+
+// Message view split into SHA blocks: whole blocks point into the caller
+// data, the last one or two blocks are built with padding and bit length.
+class PaddedMessage {
+ public:
+  PaddedMessage() : data_(nullptr), full_blocks_(0), blocks_(0), tail_() {}
+
+  void Reset(const unsigned char* data, size_t len) {
+    data_ = data;
+    full_blocks_ = len / SHA_BLOCK_SIZE;
+    const size_t rest = len % SHA_BLOCK_SIZE;
+    const size_t tail_blocks = rest + 9 > SHA_BLOCK_SIZE ? 2 : 1;
+    blocks_ = full_blocks_ + tail_blocks;
+
+    memset(tail_, 0, sizeof(tail_));
+    if (rest) {
+      memcpy(tail_, data + full_blocks_ * SHA_BLOCK_SIZE, rest);
+    }
+    tail_[rest] = 0x80;
+    const uint64_t bits = static_cast<uint64_t>(len) * 8;
+    unsigned char* length = tail_ + tail_blocks * SHA_BLOCK_SIZE - 8;
+    StoreBE32(static_cast<uint32_t>(bits >> 32), length);
+    StoreBE32(static_cast<uint32_t>(bits), length + 4);
+  }
+
+  size_t BlocksCount() const { return blocks_; }
+
+  size_t FullBlocksCount() const { return full_blocks_; }
+
+  const unsigned char* Block(size_t index) const {
+    if (index < full_blocks_) {
+      return data_ + index * SHA_BLOCK_SIZE;
+    }
+    return tail_ + (index - full_blocks_) * SHA_BLOCK_SIZE;
+  }
+
+ private:
+  const unsigned char* data_;
+  size_t full_blocks_;
+  size_t blocks_;
+  unsigned char tail_[SHA_BLOCK_SIZE * 2];
+};
+
+// state: word-major, one column per lane
+template <size_t StateWords>
+using lanes_compress_t = void (*)(uint32_t state[StateWords][SHA_MULTI_BUFFER_LANES],
+                                  const PaddedMessage* const lanes[SHA_MULTI_BUFFER_LANES],
+                                  size_t blocks);
+
+template <size_t StateWords>
+using blocks_compress_t = void (*)(uint32_t state[StateWords], const unsigned char* data, size_t blocks);
+
+// Hashes messages eight at a time with the lanes kernel for as many blocks as
+// all of them have, the longer ones are finished with the single stream one.
+template <size_t StateWords>
+void MultiBufferHash(const uint32_t (&iv)[StateWords],
+                     lanes_compress_t<StateWords> lanes_compress,
+                     blocks_compress_t<StateWords> compress,
+                     const unsigned char* const* data,
+                     const size_t* lens,
+                     size_t count,
+                     unsigned char* hashes) {
+  PaddedMessage messages[SHA_MULTI_BUFFER_LANES];
+  const PaddedMessage* lanes[SHA_MULTI_BUFFER_LANES];
+  uint32_t state[StateWords][SHA_MULTI_BUFFER_LANES];
+
+  for (size_t first = 0; first < count; first += SHA_MULTI_BUFFER_LANES) {
+    const size_t active = count - first < SHA_MULTI_BUFFER_LANES ? count - first : SHA_MULTI_BUFFER_LANES;
+    size_t common_blocks = SIZE_MAX;
+    for (size_t lane = 0; lane < SHA_MULTI_BUFFER_LANES; ++lane) {
+      if (lane < active) {
+        messages[lane].Reset(data[first + lane], lens[first + lane]);
+        if (messages[lane].BlocksCount() < common_blocks) {
+          common_blocks = messages[lane].BlocksCount();
+        }
+      }
+      // idle lanes repeat the first message, their result is dropped
+      lanes[lane] = &messages[lane < active ? lane : 0];
+      for (size_t i = 0; i < StateWords; ++i) {
+        state[i][lane] = iv[i];
+      }
+    }
+
+    lanes_compress(state, lanes, common_blocks);
+
+    for (size_t lane = 0; lane < active; ++lane) {
+      uint32_t lane_state[StateWords];
+      for (size_t i = 0; i < StateWords; ++i) {
+        lane_state[i] = state[i][lane];
+      }
+      for (size_t block = common_blocks; block < messages[lane].BlocksCount(); ++block) {
+        compress(lane_state, messages[lane].Block(block), 1);
+      }
+      unsigned char* out = hashes + (first + lane) * StateWords * sizeof(uint32_t);
+      for (size_t i = 0; i < StateWords; ++i) {
+        StoreBE32(lane_state[i], out + i * sizeof(uint32_t));
+      }
+    }
+  }
+}
+
+// Same result as MultiBufferHash, one message after another.
+template <size_t StateWords>
+void SequentialHash(const uint32_t (&iv)[StateWords],
+                    blocks_compress_t<StateWords> compress,
+                    const unsigned char* const* data,
+                    const size_t* lens,
+                    size_t count,
+                    unsigned char* hashes) {
+  PaddedMessage message;
+  for (size_t n = 0; n < count; ++n) {
+    message.Reset(data[n], lens[n]);
+    uint32_t state[StateWords];
+    memcpy(state, iv, sizeof(state));
+    const size_t full_blocks = message.FullBlocksCount();
+    if (full_blocks) {
+      compress(state, message.Block(0), full_blocks);
+    }
+    compress(state, message.Block(full_blocks), message.BlocksCount() - full_blocks);
+    unsigned char* out = hashes + n * StateWords * sizeof(uint32_t);
+    for (size_t i = 0; i < StateWords; ++i) {
+      StoreBE32(state[i], out + i * sizeof(uint32_t));
+    }
+  }
+}
+
+#if defined(HAVE_X86_SHA_INSTRUCTIONS)
+TARGET_AVX2 inline __m256i Rotr256(__m256i x, int n) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// Big endian word |word| of the current block of every lane.
+TARGET_AVX2 inline __m256i LoadLanesWord(const unsigned char* const blocks[SHA_MULTI_BUFFER_LANES], size_t word) {
+  uint32_t words[SHA_MULTI_BUFFER_LANES];
+  for (size_t lane = 0; lane < SHA_MULTI_BUFFER_LANES; ++lane) {
+    memcpy(&words[lane], blocks[lane] + word * sizeof(uint32_t), sizeof(uint32_t));
+  }
+  const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+                                         11, 10, 9, 8, 15, 14, 13, 12);
+  return _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words)), bswap);
+}
+#endif
+
+}  // namespace detail
+}  // namespace hash
+}  // namespace common
@@ -33,13 +33,16 @@
 
 #include <ev.h>
 
-#include <mutex>
+#include <atomic>
+#include <utility>
 
 #include <common/libev/event_async.h>
 #include <common/libev/event_child.h>
 #include <common/libev/event_io.h>
 #include <common/libev/event_timer.h>
 
+#include <common/threads/mpsc_queue.h>
+
 #if !EV_CHILD_ENABLE
 #if defined(OS_WIN)
 #include <windows.h>
@@ -71,15 +74,23 @@ namespace libev {
 
 class LibEvLoop::AsyncCustom : public LibevAsync {
  public:
-  typedef std::unique_lock<std::mutex> mutex_lock_t;
-  AsyncCustom() : queue_mutex_(), custom_callbacks_() {}
-  ~AsyncCustom() { custom_callbacks_.clear(); }
+  // Tasks run per wakeup, the rest waits for the next loop iteration so that
+  // a flood of posts can not starve the I/O watchers.
+  enum { kMaxTasksPerWakeup = 256 };
+
+  AsyncCustom() : queue_(), notified_(false) {}
+  ~AsyncCustom() {
+    while (Task* task = queue_.Pop()) {
+      delete task;
+    }
+  }
+
   void Push(custom_loop_exec_function_t func) {
-    {
-      mutex_lock_t lock(queue_mutex_);
-      custom_callbacks_.push_back(func);
+    queue_.Push(new Task(std::move(func)));
+    // one wakeup per batch, the loop thread rearms it before draining
+    if (!notified_.exchange(true)) {
+      Notify();
     }
-    Notify();
   }
 
   static void custom_cb(LibEvLoop* loop, LibevAsync* async, flags_t revents) {
@@ -91,20 +102,31 @@ class LibEvLoop::AsyncCustom : public LibevAsync {
   }
 
  private:
+  struct Task : public threads::mpsc_queue_node {
+    explicit Task(custom_loop_exec_function_t function) : func(std::move(function)) {}
+
+    custom_loop_exec_function_t func;
+  };
+
   void Pop() {
-    std::vector<custom_loop_exec_function_t> copy;
-    {
-      mutex_lock_t lock(queue_mutex_);
-      custom_callbacks_.swap(copy);
+    notified_.store(false);
+    for (size_t i = 0; i < kMaxTasksPerWakeup; ++i) {
+      Task* task = queue_.Pop();
+      if (!task) {
+        break;
+      }
+      task->func();
+      delete task;
     }
 
-    for (size_t i = 0; i < copy.size(); ++i) {
-      custom_loop_exec_function_t func = copy[i];
-      func();
+    // leftovers, or a push which was not linked in yet when we looked
+    if (!queue_.IsEmpty() && !notified_.exchange(true)) {
+      Notify();
     }
   }
-  std::mutex queue_mutex_;
-  std::vector<custom_loop_exec_function_t> custom_callbacks_;
+
+  threads::mpsc_queue<Task> queue_;
+  std::atomic<bool> notified_;
 };
 
 EvLoopObserver::~EvLoopObserver() {}
@@ -118,12 +140,18 @@ LibEvLoop::LibEvLoop(struct ev_loop* loop)
       async_stop_(new LibevAsync),
       async_custom_(new AsyncCustom),
       timers_(),
+      prepare_(static_cast<struct ev_prepare*>(calloc(1, sizeof(struct ev_prepare)))),
+      prepare_callback_(),
       is_running_(false) {
   CHECK(loop_) << "Must be evloop!";
   ev_set_userdata(loop_, this);
+  ev_prepare_init(prepare_, prepare_cb);
+  prepare_->data = this;
 }  // namespace libev
 
 LibEvLoop::~LibEvLoop() {
+  ev_prepare_stop(loop_, prepare_);
+  free(prepare_);
   destroy(&async_custom_);
   destroy(&async_stop_);
   ev_loop_destroy(loop_);
@@ -139,21 +167,22 @@ timer_id_t LibEvLoop::CreateTimer(double sec, bool repeat) {
   LibevTimer* timer = new LibevTimer;
   timer->Init(this, timer_cb, sec, repeat);
   timer->Start();
-  timers_.push_back(timer);
-  return timer->get_id();
+  const timer_id_t id = timer->get_id();
+  timers_[id] = timer;
+  return id;
 }
 
 void LibEvLoop::RemoveTimer(timer_id_t id) {
   CHECK(IsLoopThread()) << "Must be called in loop thread!";
 
-  for (std::vector<LibevTimer*>::iterator it = timers_.begin(); it != timers_.end(); ++it) {
-    LibevTimer* timer = *it;
-    if (timer->get_id() == id) {
-      timers_.erase(it);
-      delete timer;
-      return;
-    }
+  auto it = timers_.find(id);
+  if (it == timers_.end()) {
+    return;
   }
+
+  LibevTimer* timer = it->second;
+  timers_.erase(it);
+  delete timer;
 }
 
 void LibEvLoop::InitAsync(LibevAsync* as, async_callback_t cb) {
@@ -271,7 +300,17 @@ void LibEvLoop::ExecInLoopThread(custom_loop_exec_function_t func) {
     return;
   }
 
-  async_custom_->Push(func);
+  async_custom_->Push(std::move(func));
+}
+
+void LibEvLoop::SetPrepareCallback(prepare_callback_t callback) {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  prepare_callback_ = std::move(callback);
+  if (prepare_callback_) {
+    ev_prepare_start(loop_, prepare_);
+  } else {
+    ev_prepare_stop(loop_, prepare_);
+  }
 }
 
 int LibEvLoop::Exec() {
@@ -279,6 +318,8 @@ int LibEvLoop::Exec() {
 
   async_custom_->Init(this, AsyncCustom::custom_cb);
   async_custom_->Start();
+  // run whatever was posted before the loop started
+  async_custom_->Notify();
   async_stop_->Init(this, stop_cb);
   async_stop_->Start();
   if (observer_) {
@@ -328,6 +369,16 @@ void LibEvLoop::timer_cb(LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
   loop->HandleTimer(timer->get_id());
 }
 
+void LibEvLoop::prepare_cb(struct ev_loop* loop, struct ev_prepare* watcher, int revents) {
+  UNUSED(loop);
+  UNUSED(revents);
+
+  LibEvLoop* evloop = static_cast<LibEvLoop*>(watcher->data);
+  if (evloop->prepare_callback_) {
+    evloop->prepare_callback_();
+  }
+}
+
 void LibEvLoop::HandleTimer(timer_id_t id) {
   if (observer_) {
     observer_->TimerEmited(this, id);
@@ -342,11 +393,10 @@ void LibEvLoop::HandleStart() {
 
 void LibEvLoop::HandleStop() {
   async_stop_->Stop();
-  const std::vector<LibevTimer*> timers = timers_;
-  for (size_t i = 0; i < timers.size(); ++i) {
-    LibevTimer* timer = timers[i];
-    RemoveTimer(timer->get_id());
+  for (auto it = timers_.begin(); it != timers_.end(); ++it) {
+    delete it->second;
   }
+  timers_.clear();
 
   if (observer_) {
     observer_->Stopped(this);
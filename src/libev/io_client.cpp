@@ -32,12 +32,27 @@
 #include <common/libev/event_io.h>
 #include <common/libev/io_loop.h>
 
+#if defined(HAVE_IO_URING)
+#include "uring/uring_backend.h"
+#endif
+
 namespace common {
 namespace libev {
 
 IoClient::IoClient(IoLoop* server, flags_t flags)
-    : base_class(), server_(server), read_write_io_(new LibevIO), flags_(flags), wrote_bytes_(), read_bytes_() {
+    : base_class(),
+      server_(server),
+      read_write_io_(new LibevIO),
+      flags_(flags),
+      wrote_bytes_(),
+      read_bytes_(),
+      idle_timer_(),
+      idle_timeout_msec_(0),
+      prev_client_(nullptr),
+      next_client_(nullptr),
+      uring_(nullptr) {
   read_write_io_->SetUserData(this);
+  idle_timer_.SetUserData(this);
 }
 
 IoClient::~IoClient() {
@@ -67,6 +82,10 @@ size_t IoClient::GetReadBytes() const {
   return read_bytes_;
 }
 
+time64_t IoClient::GetIdleTimeout() const {
+  return idle_timeout_msec_;
+}
+
 const char* IoClient::ClassName() const {
   return "IoClient";
 }
@@ -80,6 +99,16 @@ ErrnoError IoClient::Write(const void* data, size_t size, size_t* nwrite_out) {
   size_t bytes_left = size;  // how many we have left to send
 
   while (total < size) {
+#if defined(HAVE_IO_URING)
+    if (uring_) {
+      // sends are queued up to a limit, wait for room as a blocking socket would
+      ErrnoError err = uring_->WaitForOutput();
+      if (err) {
+        *nwrite_out = 0;
+        return err;
+      }
+    }
+#endif
     size_t n;
     ErrnoError err = SingleWrite(data, size, &n);
     if (err || n == 0) {
@@ -99,6 +128,17 @@ ErrnoError IoClient::Read(void* out_data, size_t max_size, size_t* nread_out) {
     return make_errno_error_inval();
   }
 
+#if defined(HAVE_IO_URING)
+  if (uring_) {
+    // input comes in buffer sized completions, wait for all of it as a blocking socket would
+    ErrnoError err = uring_->WaitForInput(max_size);
+    if (err) {
+      *nread_out = 0;
+      return err;
+    }
+  }
+#endif
+
   size_t total = 0;              // how many bytes we've readed
   size_t bytes_left = max_size;  // how many we have left to read
 
@@ -123,7 +163,11 @@ ErrnoError IoClient::SingleWrite(const void* data, size_t size, size_t* nwrite_o
     return make_errno_error_inval();
   }
 
+#if defined(HAVE_IO_URING)
+  ErrnoError err = uring_ ? uring_->Write(data, size, nwrite_out) : DoSingleWrite(data, size, nwrite_out);
+#else
   ErrnoError err = DoSingleWrite(data, size, nwrite_out);
+#endif
   if (!err) {
     wrote_bytes_ += *nwrite_out;
   }
@@ -135,7 +179,11 @@ ErrnoError IoClient::SingleRead(void* out_data, size_t max_size, size_t* nread_o
     return make_errno_error_inval();
   }
 
+#if defined(HAVE_IO_URING)
+  ErrnoError err = uring_ ? uring_->Read(out_data, max_size, nread_out) : DoSingleRead(out_data, max_size, nread_out);
+#else
   ErrnoError err = DoSingleRead(out_data, max_size, nread_out);
+#endif
   if (!err) {
     read_bytes_ += *nread_out;
   }
@@ -33,6 +33,7 @@
 #include <mutex>
 
 #include <common/sprintf.h>
+#include <common/time.h>
 
 #include <common/libev/event_io.h>
 #include <common/libev/io_client.h>
@@ -41,22 +42,84 @@
 #include <common/libev/event_child.h>
 #include <common/libev/io_child.h>
 
+#include <common/libev/event_timer.h>
+#include <common/libev/tcp/file_transfer.h>
+#include <common/libev/timer_wheel.h>
+#include <common/libev/tcp/tcp_connector.h>
+
+#if defined(HAVE_IO_URING)
+#include "uring/uring_backend.h"
+#endif
+
 namespace {
 
 typedef std::unique_lock<std::mutex> lock_t;
 std::mutex g_exists_loops_mutex;
 std::vector<common::libev::IoLoop*> g_exists_loops;
 
+std::string SuppressedSuffix(size_t suppressed) {
+  if (!suppressed) {
+    return std::string();
+  }
+  return common::MemSPrintf(" (%zu similar message(s) suppressed)", suppressed);
+}
+
 }  // namespace
 
 namespace common {
 namespace libev {
 
-IoLoop::IoLoop(LibEvLoop* loop, IoLoopObserver* observer) : loop_(loop), observer_(observer), clients_(), id_() {
+const time64_t IoLoop::kIdleTickMsec;
+
+IoLoop::IoLoop(LibEvLoop* loop, IoLoopObserver* observer)
+    : loop_(loop),
+      observer_(observer),
+      uring_(nullptr),
+      first_client_(nullptr),
+      last_client_(nullptr),
+      clients_count_(0),
+      childs_(),
+      connectors_(),
+      finished_connectors_(),
+      transfers_(),
+      finished_transfers_(),
+      reap_timer_(new LibevTimer),
+      idle_wheel_(new TimerWheel([this](TimerWheelNode* node) { IdleTimeoutExpired(node); })),
+      idle_timer_(new LibevTimer),
+      idle_timer_active_(false),
+      idle_origin_msec_(time::current_monotonic_mstime()),
+      stats_(),
+      stats_timer_(new LibevTimer),
+      stats_interval_msec_(0),
+      stats_last_msec_(0),
+      stats_last_accepted_(0),
+      stats_last_closed_(0),
+      last_connect_id_(0),
+      last_transfer_id_(0),
+      client_log_interval_msec_(0),
+      next_client_log_msec_(0),
+      suppressed_client_logs_(0),
+      id_() {
   loop_->SetObserver(this);
 }
 
 IoLoop::~IoLoop() {
+  for (auto it = connectors_.begin(); it != connectors_.end(); ++it) {
+    delete it->second;
+  }
+  connectors_.clear();
+  for (auto it = transfers_.begin(); it != transfers_.end(); ++it) {
+    delete it->second;
+  }
+  transfers_.clear();
+  ReapFinished();
+  destroy(&reap_timer_);
+  destroy(&idle_timer_);
+  destroy(&idle_wheel_);
+  destroy(&stats_timer_);
+#if defined(HAVE_IO_URING)
+  destroy(&uring_);
+#endif
   delete loop_;
 }
 
@@ -73,6 +136,56 @@ void IoLoop::Stop() {
   loop_->Stop();
 }
 
+ErrnoError IoLoop::SetBackend(IoBackend backend) {
+  if (backend == GetBackend()) {
+    return ErrnoError();
+  }
+
+#if defined(HAVE_IO_URING)
+  if (backend == IO_BACKEND_LIBEV) {
+    destroy(&uring_);
+    return ErrnoError();
+  }
+
+  uring::UringBackend* uring =
+      new uring::UringBackend([this](IoClient* client) { ReadWrite(loop_, client, EV_READ); });
+  ErrnoError err = uring->Init();
+  if (err) {
+    delete uring;
+    return err;
+  }
+  uring_ = uring;
+  return ErrnoError();
+#else
+  return make_error_perror("IoLoop::SetBackend", ENOTSUP);
+#endif
+}
+
+IoBackend IoLoop::GetBackend() const {
+  return uring_ ? IO_BACKEND_URING : IO_BACKEND_LIBEV;
+}
+
+ErrnoError IoLoop::StartAccept(descriptor_t listen_fd, bool nonblocking, accept_callback_t callback) {
+#if defined(HAVE_IO_URING)
+  if (uring_) {
+    return uring_->StartAccept(listen_fd, nonblocking, callback);
+  }
+#else
+  UNUSED(listen_fd);
+  UNUSED(nonblocking);
+  UNUSED(callback);
+#endif
+  return make_error_perror("IoLoop::StartAccept", ENOTSUP);
+}
+
+void IoLoop::StopAccept() {
+#if defined(HAVE_IO_URING)
+  if (uring_) {
+    uring_->StopAccept();
+  }
+#endif
+}
+
 void IoLoop::UnRegisterClient(IoClient* client) {
   if (!client) {
     DNOTREACHED();
@@ -81,19 +194,24 @@ void IoLoop::UnRegisterClient(IoClient* client) {
 
   CHECK(IsLoopThread()) << "Must be called in loop thread!";
   CHECK(client->GetServer() == this) << "Must have same server!";
-  const std::string formated_name = client->GetFormatedName();
+  size_t suppressed = 0;
+  const bool log = ShouldLogClientChange(&suppressed);
+  const std::string formated_name = log ? client->GetFormatedName() : std::string();
 
-  LibevIO* client_ev = client->read_write_io_;
-  client_ev->Stop();
+  FailClientTransfers(client);
+  idle_wheel_->Cancel(&client->idle_timer_);
+  StopClientIO(client);
   client->server_ = nullptr;
 
   if (observer_) {
     observer_->Moved(this, client);
   }
 
-  clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
-  INFO_LOG() << "Successfully unregister client[" << formated_name << "], from server[" << GetFormatedName() << "], "
-             << clients_.size() << " client(s) connected.";
+  UnlinkClient(client);
+  if (log) {
+    INFO_LOG() << "Successfully unregister client[" << formated_name << "], from server[" << GetFormatedName() << "], "
+               << clients_count_ << " client(s) connected." << SuppressedSuffix(suppressed);
+  }
 }
 
 bool IoLoop::RegisterClient(IoClient* client) {
@@ -106,7 +224,6 @@ bool IoLoop::RegisterClient(IoClient* client) {
   if (!IsCanBeRegistered(client)) {
     return false;
   }
-  const std::string formated_name = client->GetFormatedName();
 
   if (client->GetServer()) {
     CHECK(client->GetServer() == this) << "Must have same server!";
@@ -114,6 +231,61 @@ bool IoLoop::RegisterClient(IoClient* client) {
     client->server_ = this;
   }
 
+  if (!StartClientIO(client)) {
+    return false;
+  }
+  TouchClient(client);
+
+  if (observer_) {
+    observer_->Accepted(client);
+  }
+
+  LinkClient(client);
+  stats_.accepted++;
+  size_t suppressed = 0;
+  if (ShouldLogClientChange(&suppressed)) {
+    INFO_LOG() << "Successfully connected with client[" << client->GetFormatedName() << "], from server["
+               << GetFormatedName() << "], " << clients_count_ << " client(s) connected."
+               << SuppressedSuffix(suppressed);
+  }
+  return true;
+}
+
+void IoLoop::CloseClient(IoClient* client) {
+  if (!client) {
+    DNOTREACHED();
+    return;
+  }
+
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  CHECK(client->GetServer() == this) << "Must have same server!";
+  size_t suppressed = 0;
+  const bool log = ShouldLogClientChange(&suppressed);
+  const std::string formated_name = log ? client->GetFormatedName() : std::string();
+
+  FailClientTransfers(client);
+  idle_wheel_->Cancel(&client->idle_timer_);
+  StopClientIO(client);
+
+  if (observer_) {
+    observer_->Closed(client);
+  }
+  if (UnlinkClient(client)) {
+    stats_.closed++;
+  }
+  if (log) {
+    INFO_LOG() << "Successfully disconnected client[" << formated_name << "], from server[" << GetFormatedName()
+               << "], " << clients_count_ << " client(s) connected." << SuppressedSuffix(suppressed);
+  }
+}
+
+bool IoLoop::StartClientIO(IoClient* client) {
+#if defined(HAVE_IO_URING)
+  if (uring_ && uring_->Attach(client)) {
+    return true;
+  }
+#endif
+
   // Initialize and start watcher to read client requests
   LibevIO* client_ev = client->read_write_io_;
   bool is_inited = client_ev->Init(loop_, read_write_cb, client->GetFd(), client->GetFlags());
@@ -122,18 +294,122 @@ bool IoLoop::RegisterClient(IoClient* client) {
     return false;
   }
   client_ev->Start();
+  return true;
+}
 
-  if (observer_) {
-    observer_->Accepted(client);
+void IoLoop::StopClientIO(IoClient* client) {
+#if defined(HAVE_IO_URING)
+  if (client->uring_) {
+    uring_->Detach(client);
+    return;
   }
+#endif
 
-  clients_.push_back(client);
-  INFO_LOG() << "Successfully connected with client[" << formated_name << "], from server[" << GetFormatedName()
-             << "], " << clients_.size() << " client(s) connected.";
+  LibevIO* client_ev = client->read_write_io_;
+  client_ev->Stop();
+}
+
+void IoLoop::LinkClient(IoClient* client) {
+  if (client->prev_client_ || first_client_ == client) {
+    return;
+  }
+
+  client->prev_client_ = last_client_;
+  client->next_client_ = nullptr;
+  if (last_client_) {
+    last_client_->next_client_ = client;
+  } else {
+    first_client_ = client;
+  }
+  last_client_ = client;
+  clients_count_++;
+}
+
+bool IoLoop::UnlinkClient(IoClient* client) {
+  if (!client->prev_client_ && first_client_ != client) {
+    return false;
+  }
+
+  if (client->prev_client_) {
+    client->prev_client_->next_client_ = client->next_client_;
+  } else {
+    first_client_ = client->next_client_;
+  }
+  if (client->next_client_) {
+    client->next_client_->prev_client_ = client->prev_client_;
+  } else {
+    last_client_ = client->prev_client_;
+  }
+  client->prev_client_ = nullptr;
+  client->next_client_ = nullptr;
+  clients_count_--;
   return true;
 }
 
-void IoLoop::CloseClient(IoClient* client) {
+ErrnoError IoLoop::MoveClient(IoClient* client, IoLoop* target) {
+  if (!client || !target || target == this) {
+    return make_error_perror("IoLoop::MoveClient", EINVAL);
+  }
+
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  CHECK(client->GetServer() == this) << "Must have same server!";
+  const descriptor_t sock = client->GetFd();
+  for (auto it = transfers_.begin(); it != transfers_.end(); ++it) {
+    if (it->second->GetSocket() == sock) {
+      return make_error_perror("IoLoop::MoveClient", EBUSY);
+    }
+  }
+
+#if defined(HAVE_IO_URING)
+  if (client->uring_) {
+    // receives in flight would be lost, wait until the kernel dropped them
+    return uring_->Release(client, [this, client, target](bool released) {
+      if (released) {
+        HandOver(client, target);
+      }
+    });
+  }
+#endif
+
+  HandOver(client, target);
+  return ErrnoError();
+}
+
+void IoLoop::HandOver(IoClient* client, IoLoop* target) {
+  UnRegisterClient(client);
+  target->ExecInLoopThread([target, client]() {
+    if (!target->RegisterClient(client)) {
+      WARNING_LOG() << "Server[" << target->GetFormatedName() << "] refused moved client[" << client->GetFormatedName()
+                    << "]";
+      ignore_result(client->Close());
+      delete client;
+    }
+  });
+}
+
+void IoLoop::SetClientLogInterval(time64_t msec) {
+  client_log_interval_msec_ = msec;
+}
+
+bool IoLoop::ShouldLogClientChange(size_t* suppressed) {
+  *suppressed = 0;
+  if (client_log_interval_msec_ <= 0) {
+    return true;
+  }
+
+  const time64_t now = time::current_monotonic_mstime();
+  if (now < next_client_log_msec_) {
+    suppressed_client_logs_++;
+    return false;
+  }
+
+  next_client_log_msec_ = now + client_log_interval_msec_;
+  *suppressed = suppressed_client_logs_;
+  suppressed_client_logs_ = 0;
+  return true;
+}
+
+void IoLoop::SetIdleTimeout(IoClient* client, time64_t msec) {
   if (!client) {
     DNOTREACHED();
     return;
@@ -141,17 +417,57 @@ void IoLoop::CloseClient(IoClient* client) {
 
   CHECK(IsLoopThread()) << "Must be called in loop thread!";
   CHECK(client->GetServer() == this) << "Must have same server!";
-  const std::string formated_name = client->GetFormatedName();
+  client->idle_timeout_msec_ = msec > 0 ? msec : 0;
+  if (!client->idle_timeout_msec_) {
+    idle_wheel_->Cancel(&client->idle_timer_);
+    return;
+  }
+  TouchClient(client);
+}
 
-  LibevIO* client_ev = client->read_write_io_;
-  client_ev->Stop();
+void IoLoop::TouchClient(IoClient* client) {
+  if (!client->idle_timeout_msec_) {
+    return;
+  }
+
+  const time64_t now = time::current_monotonic_mstime();
+  if (idle_wheel_->IsEmpty()) {
+    // nothing ticked while the wheel was empty, catch up in one step
+    idle_wheel_->AdvanceTo(GetIdleTick(now));
+  }
+  // round the deadline up so that a client never expires early
+  const uint64_t deadline = GetIdleTick(now + client->idle_timeout_msec_ + kIdleTickMsec - 1);
+  idle_wheel_->ScheduleAt(&client->idle_timer_, deadline);
+  if (idle_timer_active_) {
+    return;
+  }
+
+  const double tick_sec = static_cast<double>(kIdleTickMsec) / 1000;
+  idle_timer_->Init(
+      loop_, [this](LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
+        UNUSED(loop);
+        UNUSED(timer);
+        UNUSED(revents);
+        idle_wheel_->AdvanceTo(GetIdleTick(time::current_monotonic_mstime()));
+        if (idle_wheel_->IsEmpty() && idle_timer_active_) {
+          idle_timer_->Stop();
+          idle_timer_active_ = false;
+        }
+      },
+      tick_sec, true);
+  idle_timer_->Start();
+  idle_timer_active_ = true;
+}
 
+void IoLoop::IdleTimeoutExpired(TimerWheelNode* node) {
+  IoClient* client = static_cast<IoClient*>(node->GetUserData());
   if (observer_) {
-    observer_->Closed(client);
+    observer_->IdleTimeout(client);
   }
-  clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
-  INFO_LOG() << "Successfully disconnected client[" << formated_name << "], from server[" << GetFormatedName() << "], "
-             << clients_.size() << " client(s) connected.";
+}
+
+uint64_t IoLoop::GetIdleTick(time64_t msec) const {
+  return static_cast<uint64_t>(msec - idle_origin_msec_) / kIdleTickMsec;
 }
 
 timer_id_t IoLoop::CreateTimer(double sec, bool repeat) {
@@ -226,6 +542,170 @@ bool IoLoop::IsLoopThread() const {
   return loop_->IsLoopThread();
 }
 
+void IoLoop::ResolveHost(const net::HostAndPort& host, net::DnsResolver::resolve_callback_t callback) {
+  const auto loop_id = GetId();
+  auto executor = [loop_id](net::DnsResolver::task_t task) { ignore_result(PostToExistLoop(loop_id, task)); };
+  net::DnsResolver::GetInstance()->Resolve(host, executor, callback);
+}
+
+connect_id_t IoLoop::ConnectTo(const net::HostAndPort& host, double timeout_sec, connect_callback_t callback) {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  const connect_id_t id = ++last_connect_id_;
+  tcp::TcpConnector* connector = new tcp::TcpConnector(
+      loop_, host, timeout_sec, [this, id, callback](ErrnoError err, const net::socket_info& info) {
+        FinishConnect(id);
+        if (callback) {
+          callback(err, info);
+        }
+      });
+  connectors_[id] = connector;
+
+  ResolveHost(host, [this, id](ErrnoError err, const net::IPAddressList& addresses) {
+    auto it = connectors_.find(id);
+    if (it == connectors_.end()) {
+      return;
+    }
+
+    if (err) {
+      it->second->Fail(err);
+      return;
+    }
+    it->second->Start(addresses);
+  });
+  return id;
+}
+
+void IoLoop::CancelConnect(connect_id_t id) {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  auto it = connectors_.find(id);
+  if (it == connectors_.end()) {
+    return;
+  }
+
+  it->second->Cancel();
+  FinishConnect(id);
+}
+
+void IoLoop::FinishConnect(connect_id_t id) {
+  auto it = connectors_.find(id);
+  if (it == connectors_.end()) {
+    return;
+  }
+
+  finished_connectors_.push_back(it->second);
+  connectors_.erase(it);
+  ArmReapTimer();
+}
+
+ErrnoError IoLoop::SendFile(IoClient* client,
+                            descriptor_t fd,
+                            off_t offset,
+                            size_t size,
+                            const tcp::FileTransferOptions& options,
+                            send_file_progress_callback_t progress,
+                            send_file_callback_t callback,
+                            transfer_id_t* id) {
+  if (!client || fd == INVALID_DESCRIPTOR) {
+    return make_error_perror("IoLoop::SendFile", EINVAL);
+  }
+
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  CHECK(client->GetServer() == this) << "Must have same server!";
+  const descriptor_t sock = client->GetFd();
+  for (auto it = transfers_.begin(); it != transfers_.end(); ++it) {
+    if (it->second->GetSocket() == sock) {
+      return make_error_perror("IoLoop::SendFile", EBUSY);
+    }
+  }
+#if defined(HAVE_IO_URING)
+  // the transfer writes to the socket itself, it must not overtake the ring
+  if (client->uring_ && client->uring_->HasPendingOutput()) {
+    return make_error_perror("IoLoop::SendFile", EBUSY);
+  }
+#endif
+
+  const transfer_id_t tid = ++last_transfer_id_;
+  tcp::FileTransfer* transfer =
+      new tcp::FileTransfer(loop_, sock, fd, offset, size, options, progress, [this, tid, callback](ErrnoError err, size_t sent) {
+        FinishSendFile(tid);
+        if (callback) {
+          callback(err, sent);
+        }
+      });
+  ErrnoError err = transfer->Start();
+  if (err) {
+    delete transfer;
+    return err;
+  }
+
+  transfers_[tid] = transfer;
+  if (id) {
+    *id = tid;
+  }
+  return ErrnoError();
+}
+
+void IoLoop::CancelSendFile(transfer_id_t id) {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+  auto it = transfers_.find(id);
+  if (it == transfers_.end()) {
+    return;
+  }
+
+  it->second->Cancel();
+  FinishSendFile(id);
+}
+
+void IoLoop::FinishSendFile(transfer_id_t id) {
+  auto it = transfers_.find(id);
+  if (it == transfers_.end()) {
+    return;
+  }
+
+  finished_transfers_.push_back(it->second);
+  transfers_.erase(it);
+  ArmReapTimer();
+}
+
+void IoLoop::FailClientTransfers(IoClient* client) {
+  const descriptor_t sock = client->GetFd();
+  std::vector<tcp::FileTransfer*> transfers;
+  for (auto it = transfers_.begin(); it != transfers_.end(); ++it) {
+    if (it->second->GetSocket() == sock) {
+      transfers.push_back(it->second);
+    }
+  }
+  for (size_t i = 0; i < transfers.size(); ++i) {
+    transfers[i]->Fail(make_error_perror("IoLoop::SendFile", ECANCELED));
+  }
+}
+
+void IoLoop::ArmReapTimer() {
+  // connectors and transfers may be inside one of their own watcher
+  // callbacks, delete them from a fresh loop iteration
+  reap_timer_->Stop();
+  reap_timer_->Init(
+      loop_, [this](LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
+        UNUSED(loop);
+        UNUSED(timer);
+        UNUSED(revents);
+        ReapFinished();
+      },
+      0, false);
+  reap_timer_->Start();
+}
+
+void IoLoop::ReapFinished() {
+  for (size_t i = 0; i < finished_connectors_.size(); ++i) {
+    delete finished_connectors_[i];
+  }
+  finished_connectors_.clear();
+  for (size_t i = 0; i < finished_transfers_.size(); ++i) {
+    delete finished_transfers_[i];
+  }
+  finished_transfers_.clear();
+}
+
 IoLoop* IoLoop::FindExistLoopByPredicate(std::function<bool(IoLoop*)> pred) {
   if (!pred) {
     return nullptr;
@@ -242,10 +722,100 @@ IoLoop* IoLoop::FindExistLoopByPredicate(std::function<bool(IoLoop*)> pred) {
   return nullptr;
 }
 
+bool IoLoop::PostToExistLoop(id_t::type_t id, custom_loop_exec_function_t func) {
+  {
+    lock_t loc(g_exists_loops_mutex);
+    auto it = std::find_if(g_exists_loops.begin(), g_exists_loops.end(),
+                           [id](IoLoop* loop) { return loop && loop->GetId() == id; });
+    if (it == g_exists_loops.end()) {
+      return false;
+    }
+
+    IoLoop* loop = *it;
+    if (!loop->IsLoopThread()) {
+      loop->ExecInLoopThread(func);
+      return true;
+    }
+  }
+
+  // in own thread ExecInLoopThread runs |func| at once, it must not hold the lock
+  func();
+  return true;
+}
+
 std::vector<IoClient*> IoLoop::GetClients() const {
   CHECK(IsLoopThread()) << "Must be called in loop thread!";
 
-  return clients_;
+  std::vector<IoClient*> clients;
+  clients.reserve(clients_count_);
+  for (IoClient* client = first_client_; client; client = client->next_client_) {
+    clients.push_back(client);
+  }
+  return clients;
+}
+
+size_t IoLoop::GetClientsCount() const {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+
+  return clients_count_;
+}
+
+void IoLoop::ForEachClient(std::function<void(IoClient*)> visitor) const {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+
+  IoClient* client = first_client_;
+  while (client) {
+    IoClient* next = client->next_client_;
+    visitor(client);
+    client = next;
+  }
+}
+
+IoLoopStatistics IoLoop::GetStatistics() const {
+  CHECK(IsLoopThread()) << "Must be called in loop thread!";
+
+  IoLoopStatistics stats = stats_;
+  stats.clients = clients_count_;
+  return stats;
+}
+
+void IoLoop::SetStatisticsInterval(time64_t msec) {
+  ExecInLoopThread([this, msec]() {
+    stats_interval_msec_ = msec > 0 ? msec : 0;
+    stats_timer_->Stop();
+    if (!stats_interval_msec_) {
+      return;
+    }
+
+    stats_last_msec_ = time::current_monotonic_mstime();
+    stats_last_accepted_ = stats_.accepted;
+    stats_last_closed_ = stats_.closed;
+    const double interval_sec = static_cast<double>(stats_interval_msec_) / 1000;
+    stats_timer_->Init(
+        loop_, [this](LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
+          UNUSED(loop);
+          UNUSED(timer);
+          UNUSED(revents);
+          UpdateStatistics();
+        },
+        interval_sec, true);
+    stats_timer_->Start();
+  });
+}
+
+void IoLoop::UpdateStatistics() {
+  const time64_t now = time::current_monotonic_mstime();
+  const time64_t elapsed = now - stats_last_msec_;
+  if (elapsed > 0) {
+    stats_.accepts_per_sec = static_cast<double>(stats_.accepted - stats_last_accepted_) * 1000 / elapsed;
+    stats_.closes_per_sec = static_cast<double>(stats_.closed - stats_last_closed_) * 1000 / elapsed;
+  }
+  stats_last_msec_ = now;
+  stats_last_accepted_ = stats_.accepted;
+  stats_last_closed_ = stats_.closed;
+  if (observer_) {
+    observer_->StatisticsUpdated(this, GetStatistics());
+  }
 }
 
 std::vector<IoChild*> IoLoop::GetChilds() const {
@@ -270,6 +840,7 @@ void IoLoop::ReadWrite(LibEvLoop* loop, IoClient* client, flags_t revents) {
     return;
   }
 
+  TouchClient(client);
   if (revents & EV_READ) {
     if (observer_) {
       observer_->DataReceived(client);
@@ -307,7 +878,13 @@ void IoLoop::ChildStatus(LibEvLoop* loop, IoChild* child, int status, int signal
 }
 
 void IoLoop::PreLooped(LibEvLoop* loop) {
+#if defined(HAVE_IO_URING)
+  if (uring_) {
+    uring_->Start(loop);
+  }
+#else
   UNUSED(loop);
+#endif
   {
     lock_t loc(g_exists_loops_mutex);
     g_exists_loops.push_back(this);
@@ -326,6 +903,28 @@ void IoLoop::Stopped(LibEvLoop* loop) {
   UNUSED(loop);
   CHECK(IsLoopThread()) << "Must be called in loop thread!";
 
+  std::vector<tcp::TcpConnector*> connectors;
+  for (auto it = connectors_.begin(); it != connectors_.end(); ++it) {
+    connectors.push_back(it->second);
+  }
+  for (size_t i = 0; i < connectors.size(); ++i) {
+    connectors[i]->Fail(make_error_perror("IoLoop::ConnectTo", ECANCELED));
+  }
+  std::vector<tcp::FileTransfer*> transfers;
+  for (auto it = transfers_.begin(); it != transfers_.end(); ++it) {
+    transfers.push_back(it->second);
+  }
+  for (size_t i = 0; i < transfers.size(); ++i) {
+    transfers[i]->Fail(make_error_perror("IoLoop::SendFile", ECANCELED));
+  }
+  reap_timer_->Stop();
+  ReapFinished();
+  if (idle_timer_active_) {
+    idle_timer_->Stop();
+    idle_timer_active_ = false;
+  }
+  stats_timer_->Stop();
+
   const std::vector<IoClient*> cl = GetClients();
 
   for (size_t i = 0; i < cl.size(); ++i) {
@@ -340,6 +939,12 @@ void IoLoop::Stopped(LibEvLoop* loop) {
     IoChild* child = childs[i];
     delete child;
   }
+
+#if defined(HAVE_IO_URING)
+  if (uring_) {
+    uring_->Stop();
+  }
+#endif
 }
 
 void IoLoop::PostLooped(LibEvLoop* loop) {
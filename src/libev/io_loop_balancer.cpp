@@ -0,0 +1,148 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/libev/io_loop_balancer.h>
+
+#include <algorithm>
+#include <future>
+#include <memory>
+
+#include <common/libev/io_client.h>
+#include <common/libev/io_loop.h>
+
+namespace common {
+namespace libev {
+
+IoLoopBalancerOptions::IoLoopBalancerOptions() : max_imbalance(1.25), max_moves(8) {}
+
+IoLoopBalancer::IoLoopBalancer(const std::vector<IoLoop*>& loops, const IoLoopBalancerOptions& options)
+    : loops_(loops), options_(options), last_bytes_() {}
+
+size_t IoLoopBalancer::Rebalance() {
+  for (size_t i = 0; i < loops_.size(); ++i) {
+    CHECK(!loops_[i]->IsLoopThread()) << "Must not be called in a balanced loop thread!";
+  }
+
+  std::vector<loads_t> loads = Sample();
+  std::vector<size_t> totals(loads.size(), 0);
+  size_t sum = 0;
+  for (size_t i = 0; i < loads.size(); ++i) {
+    for (size_t j = 0; j < loads[i].size(); ++j) {
+      totals[i] += loads[i][j].bytes;
+    }
+    sum += totals[i];
+    // hottest first
+    std::sort(loads[i].begin(), loads[i].end(),
+              [](const ClientLoad& lhs, const ClientLoad& rhs) { return lhs.bytes > rhs.bytes; });
+  }
+  if (loads.size() < 2 || sum == 0) {
+    return 0;
+  }
+
+  const double average = static_cast<double>(sum) / loads.size();
+  size_t moved = 0;
+  while (moved < options_.max_moves) {
+    const size_t from = std::max_element(totals.begin(), totals.end()) - totals.begin();
+    const size_t to = std::min_element(totals.begin(), totals.end()) - totals.begin();
+    if (totals[from] <= average * options_.max_imbalance) {
+      break;
+    }
+
+    const size_t gap = std::min(totals[from] - static_cast<size_t>(average), static_cast<size_t>(average) - totals[to]);
+    loads_t& candidates = loads[from];
+    auto it = std::find_if(candidates.begin(), candidates.end(),
+                           [gap](const ClientLoad& load) { return load.bytes && load.bytes <= gap; });
+    if (it == candidates.end()) {
+      break;
+    }
+
+    const ClientLoad load = *it;
+    candidates.erase(it);
+    if (!Move(from, load.client, to)) {
+      continue;
+    }
+    totals[from] -= load.bytes;
+    totals[to] += load.bytes;
+    moved++;
+  }
+  return moved;
+}
+
+std::vector<IoLoopBalancer::loads_t> IoLoopBalancer::Sample() {
+  // every loop reports its clients' lifetime totals at once, deltas against
+  // the previous round are taken here so that moved clients keep their history
+  typedef std::vector<std::pair<IoClient*, size_t>> totals_t;
+  std::vector<std::shared_ptr<std::promise<totals_t>>> promises;
+  for (size_t i = 0; i < loops_.size(); ++i) {
+    IoLoop* loop = loops_[i];
+    auto promise = std::make_shared<std::promise<totals_t>>();
+    promises.push_back(promise);
+    loop->ExecInLoopThread([loop, promise]() {
+      totals_t totals;
+      totals.reserve(loop->GetClientsCount());
+      loop->ForEachClient([&totals](IoClient* client) {
+        totals.push_back(std::make_pair(client, client->GetReadBytes() + client->GetWroteBytes()));
+      });
+      promise->set_value(totals);
+    });
+  }
+
+  std::vector<loads_t> loads(loops_.size());
+  std::map<IoClient*, size_t> last_bytes;
+  for (size_t i = 0; i < promises.size(); ++i) {
+    const totals_t totals = promises[i]->get_future().get();
+    for (size_t j = 0; j < totals.size(); ++j) {
+      IoClient* client = totals[j].first;
+      const size_t bytes = totals[j].second;
+      auto prev = last_bytes_.find(client);
+      // an unknown client, or a new one at a recycled address, counts in full
+      const size_t before = prev != last_bytes_.end() && prev->second <= bytes ? prev->second : 0;
+      loads[i].push_back({client, bytes - before});
+      last_bytes[client] = bytes;
+    }
+  }
+  last_bytes_.swap(last_bytes);
+  return loads;
+}
+
+bool IoLoopBalancer::Move(size_t from, IoClient* client, size_t to) {
+  IoLoop* source = loops_[from];
+  IoLoop* target = loops_[to];
+  auto promise = std::make_shared<std::promise<bool>>();
+  source->ExecInLoopThread([source, target, client, promise]() {
+    // the client may have gone since sampling, only touch it if still here
+    bool present = false;
+    source->ForEachClient([client, &present](IoClient* candidate) { present = present || candidate == client; });
+    promise->set_value(present && !source->MoveClient(client, target));
+  });
+  return promise->get_future().get();
+}
+
+}  // namespace libev
+}  // namespace common
@@ -32,6 +32,15 @@
 namespace common {
 namespace libev {
 
+void IoLoopObserver::IdleTimeout(IoClient* client) {
+  UNUSED(client);
+}
+
+void IoLoopObserver::StatisticsUpdated(IoLoop* server, const IoLoopStatistics& stats) {
+  UNUSED(server);
+  UNUSED(stats);
+}
+
 IoLoopObserver::~IoLoopObserver() {}
 
 }  // namespace libev
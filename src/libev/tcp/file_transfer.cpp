@@ -0,0 +1,290 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/libev/tcp/file_transfer.h>
+
+#include <errno.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <common/libev/event_io.h>
+#include <common/libev/event_timer.h>
+#include <common/net/net.h>
+#include <common/time.h>
+
+namespace common {
+namespace libev {
+namespace tcp {
+
+FileTransferOptions::FileTransferOptions() : chunk_size(kDefaultChunkSize), rate_limit(0), burst(0) {}
+
+TokenBucket::TokenBucket(size_t rate, size_t capacity)
+    : rate_(rate),
+      capacity_(capacity ? capacity : rate),
+      tokens_(static_cast<double>(capacity_)),
+      last_refill_msec_(time::current_monotonic_mstime()) {}
+
+bool TokenBucket::IsUnlimited() const {
+  return rate_ == 0;
+}
+
+size_t TokenBucket::GetAvailable(time64_t now_msec) {
+  if (IsUnlimited()) {
+    return std::numeric_limits<size_t>::max();
+  }
+
+  Refill(now_msec);
+  return static_cast<size_t>(tokens_);
+}
+
+void TokenBucket::Consume(size_t count) {
+  if (IsUnlimited()) {
+    return;
+  }
+
+  tokens_ = std::max(0.0, tokens_ - static_cast<double>(count));
+}
+
+time64_t TokenBucket::GetWaitMsec(size_t count, time64_t now_msec) {
+  if (IsUnlimited()) {
+    return 0;
+  }
+
+  Refill(now_msec);
+  const double need = static_cast<double>(std::min(count, capacity_)) - tokens_;
+  if (need <= 0) {
+    return 0;
+  }
+  return static_cast<time64_t>(std::ceil(need * 1000 / rate_));
+}
+
+void TokenBucket::Refill(time64_t now_msec) {
+  if (now_msec <= last_refill_msec_) {
+    return;
+  }
+
+  const double added = static_cast<double>(now_msec - last_refill_msec_) * rate_ / 1000;
+  tokens_ = std::min(static_cast<double>(capacity_), tokens_ + added);
+  last_refill_msec_ = now_msec;
+}
+
+FileTransfer::FileTransfer(LibEvLoop* loop,
+                           descriptor_t sock,
+                           descriptor_t fd,
+                           off_t offset,
+                           size_t size,
+                           const FileTransferOptions& options,
+                           progress_callback_t progress,
+                           done_callback_t done)
+    : loop_(loop),
+      sock_(sock),
+      chunk_size_(options.chunk_size ? options.chunk_size : FileTransferOptions::kDefaultChunkSize),
+      sender_(fd, offset, size),
+      bucket_(options.rate_limit, options.burst ? options.burst : chunk_size_),
+      progress_(progress),
+      done_(done),
+      io_(new LibevIO),
+      pause_timer_(new LibevTimer),
+      wait_fd_(INVALID_DESCRIPTOR),
+      was_blocking_(true),
+      finished_(false) {}
+
+FileTransfer::~FileTransfer() {
+  StopAll();
+  destroy(&io_);
+  destroy(&pause_timer_);
+}
+
+ErrnoError FileTransfer::Start() {
+  if (finished_) {
+    return make_error_perror("FileTransfer::Start", EINVAL);
+  }
+
+#if defined(OS_POSIX)
+  ErrnoError err = net::is_blocking_socket(sock_, &was_blocking_);
+  if (err) {
+    return err;
+  }
+#else
+  ErrnoError err;
+#endif
+
+  err = net::set_blocking_socket(sock_, false);
+  if (err) {
+    return err;
+  }
+
+  WaitFor(sock_, EV_WRITE);
+  return ErrnoError();
+}
+
+void FileTransfer::Fail(ErrnoError err) {
+  Finish(err);
+}
+
+void FileTransfer::Cancel() {
+  if (finished_) {
+    return;
+  }
+
+  finished_ = true;
+  StopAll();
+  ignore_result(net::set_blocking_socket(sock_, was_blocking_));
+}
+
+bool FileTransfer::IsFinished() const {
+  return finished_;
+}
+
+descriptor_t FileTransfer::GetSocket() const {
+  return sock_;
+}
+
+size_t FileTransfer::GetSent() const {
+  return sender_.GetSent();
+}
+
+off_t FileTransfer::GetOffset() const {
+  return sender_.GetOffset();
+}
+
+void FileTransfer::Step() {
+  if (finished_) {
+    return;
+  }
+
+  size_t count = chunk_size_;
+  if (!bucket_.IsUnlimited()) {
+    const time64_t now = time::current_monotonic_mstime();
+    const size_t available = bucket_.GetAvailable(now);
+    if (available == 0) {
+      // wait for a whole chunk rather than waking up for every token
+      Pause(bucket_.GetWaitMsec(chunk_size_, now));
+      return;
+    }
+    count = std::min(count, available);
+  }
+
+  size_t sent = 0;
+  ErrnoError err = sender_.SendTo(sock_, count, &sent);
+  if (err && err->GetErrorCode() == EAGAIN) {
+    if (sender_.IsWaitingForSource()) {
+      WaitFor(sender_.GetSource(), EV_READ);
+    } else {
+      WaitFor(sock_, EV_WRITE);
+    }
+    return;
+  }
+
+  if (err) {
+    Finish(err);
+    return;
+  }
+
+  bucket_.Consume(sent);
+  if (sent && progress_) {
+    progress_(sender_.GetSent(), sender_.GetSize());
+    if (finished_) {  // cancelled from the progress callback
+      return;
+    }
+  }
+
+  if (sender_.IsDone()) {
+    Finish(ErrnoError());
+    return;
+  }
+
+  WaitFor(sock_, EV_WRITE);
+}
+
+void FileTransfer::WaitFor(descriptor_t fd, flags_t events) {
+  pause_timer_->Stop();
+  if (wait_fd_ == fd) {
+    return;
+  }
+
+  io_->Stop();
+  bool is_inited = io_->Init(
+      loop_, [this](LibEvLoop* loop, LibevIO* io, flags_t revents) {
+        UNUSED(loop);
+        UNUSED(io);
+        UNUSED(revents);
+        Step();
+      },
+      fd, events);
+  if (!is_inited) {
+    wait_fd_ = INVALID_DESCRIPTOR;
+    Finish(make_error_perror("FileTransfer", EINVAL));
+    return;
+  }
+
+  io_->Start();
+  wait_fd_ = fd;
+}
+
+void FileTransfer::Pause(time64_t msec) {
+  io_->Stop();
+  wait_fd_ = INVALID_DESCRIPTOR;
+  // a fired timer keeps no interval, so it is initialized again every time
+  pause_timer_->Stop();
+  pause_timer_->Init(
+      loop_, [this](LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
+        UNUSED(loop);
+        UNUSED(timer);
+        UNUSED(revents);
+        WaitFor(sock_, EV_WRITE);
+      },
+      static_cast<double>(msec) / 1000, false);
+  pause_timer_->Start();
+}
+
+void FileTransfer::Finish(ErrnoError err) {
+  if (finished_) {
+    return;
+  }
+
+  finished_ = true;
+  StopAll();
+  ignore_result(net::set_blocking_socket(sock_, was_blocking_));
+  if (done_) {
+    done_(err, sender_.GetSent());
+  }
+}
+
+void FileTransfer::StopAll() {
+  io_->Stop();
+  pause_timer_->Stop();
+  wait_fd_ = INVALID_DESCRIPTOR;
+}
+
+}  // namespace tcp
+}  // namespace libev
+}  // namespace common
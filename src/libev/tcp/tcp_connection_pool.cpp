@@ -0,0 +1,219 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/libev/tcp/tcp_connection_pool.h>
+
+#include <errno.h>
+
+#if defined(OS_POSIX)
+#include <sys/socket.h>
+#endif
+
+#include <common/net/net.h>
+#include <common/time.h>
+
+namespace common {
+namespace libev {
+namespace tcp {
+
+namespace {
+
+// An idle keep-alive socket must have nothing to read: EOF means the peer
+// closed it, stray bytes would corrupt the next exchange.
+bool IsIdleSocketUsable(net::socket_descr_t fd) {
+#if defined(OS_POSIX)
+  char byte;
+  ssize_t res = ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return res == ERROR_RESULT_VALUE && (errno == EAGAIN || errno == EWOULDBLOCK);
+#else
+  UNUSED(fd);
+  return true;
+#endif
+}
+
+}  // namespace
+
+TcpConnectionPoolOptions::TcpConnectionPoolOptions()
+    : max_per_host(kDefaultMaxPerHost), idle_timeout_msec(kDefaultIdleTimeoutMsec), connect_timeout_sec(10) {}
+
+TcpConnectionPool::HostConnections::HostConnections() : idle(), busy(0), waiters() {}
+
+TcpConnectionPool::TcpConnectionPool(IoLoop* loop, const TcpConnectionPoolOptions& options)
+    : loop_(loop), options_(options), hosts_(), alive_(std::make_shared<bool>(true)) {
+  CHECK(loop_);
+}
+
+TcpConnectionPool::~TcpConnectionPool() {
+  *alive_ = false;
+  for (auto it = hosts_.begin(); it != hosts_.end(); ++it) {
+    for (const IdleConnection& connection : it->second.idle) {
+      ignore_result(net::close(connection.info.fd()));
+    }
+  }
+}
+
+void TcpConnectionPool::Acquire(const net::HostAndPort& host, acquire_callback_t callback) {
+  CHECK(loop_->IsLoopThread()) << "Must be called in loop thread!";
+  HostConnections& connections = hosts_[host];
+  EvictIdle(&connections, time::current_monotonic_mstime());
+  if (!connections.idle.empty()) {
+    const net::socket_info info = connections.idle.back().info;
+    connections.idle.pop_back();
+    connections.busy++;
+    if (callback) {
+      callback(ErrnoError(), info);
+    }
+    return;
+  }
+
+  if (connections.busy >= options_.max_per_host) {
+    connections.waiters.push_back(callback);
+    return;
+  }
+
+  connections.busy++;
+  Connect(host, callback);
+}
+
+void TcpConnectionPool::Release(const net::HostAndPort& host, const net::socket_info& info, bool reusable) {
+  CHECK(loop_->IsLoopThread()) << "Must be called in loop thread!";
+  auto it = hosts_.find(host);
+  if (it == hosts_.end() || it->second.busy == 0) {
+    DNOTREACHED() << "Released a connection that was not borrowed";
+    ignore_result(net::close(info.fd()));
+    return;
+  }
+
+  HostConnections& connections = it->second;
+  if (!reusable || !IsIdleSocketUsable(info.fd())) {
+    ignore_result(net::close(info.fd()));
+    connections.busy--;
+    SlotFreed(host);
+    return;
+  }
+
+  if (!connections.waiters.empty()) {
+    acquire_callback_t waiter = connections.waiters.front();
+    connections.waiters.pop_front();
+    if (waiter) {
+      waiter(ErrnoError(), info);
+    }
+    return;
+  }
+
+  connections.busy--;
+  connections.idle.push_back({info, time::current_monotonic_mstime()});
+}
+
+size_t TcpConnectionPool::EvictIdle() {
+  const time64_t now = time::current_monotonic_mstime();
+  size_t evicted = 0;
+  for (auto it = hosts_.begin(); it != hosts_.end();) {
+    evicted += EvictIdle(&it->second, now);
+    if (it->second.idle.empty() && it->second.busy == 0 && it->second.waiters.empty()) {
+      it = hosts_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return evicted;
+}
+
+size_t TcpConnectionPool::EvictIdle(HostConnections* connections, time64_t now) {
+  std::vector<IdleConnection>& idle = connections->idle;
+  size_t kept = 0;
+  for (size_t i = 0; i < idle.size(); ++i) {
+    if (now - idle[i].since_msec < options_.idle_timeout_msec && IsIdleSocketUsable(idle[i].info.fd())) {
+      if (kept != i) {
+        idle[kept] = idle[i];
+      }
+      kept++;
+      continue;
+    }
+    ignore_result(net::close(idle[i].info.fd()));
+  }
+
+  const size_t evicted = idle.size() - kept;
+  idle.resize(kept);
+  return evicted;
+}
+
+size_t TcpConnectionPool::GetIdleCount(const net::HostAndPort& host) const {
+  auto it = hosts_.find(host);
+  return it == hosts_.end() ? 0 : it->second.idle.size();
+}
+
+size_t TcpConnectionPool::GetBusyCount(const net::HostAndPort& host) const {
+  auto it = hosts_.find(host);
+  return it == hosts_.end() ? 0 : it->second.busy;
+}
+
+void TcpConnectionPool::Connect(const net::HostAndPort& host, acquire_callback_t callback) {
+  std::shared_ptr<bool> alive = alive_;
+  ignore_result(loop_->ConnectTo(host, options_.connect_timeout_sec,
+                                 [this, alive, host, callback](ErrnoError err, const net::socket_info& info) {
+                                   if (!*alive) {
+                                     if (!err) {
+                                       ignore_result(net::close(info.fd()));
+                                     }
+                                     return;
+                                   }
+                                   Connected(host, callback, err, info);
+                                 }));
+}
+
+void TcpConnectionPool::Connected(const net::HostAndPort& host,
+                                  acquire_callback_t callback,
+                                  ErrnoError err,
+                                  const net::socket_info& info) {
+  if (err) {
+    hosts_[host].busy--;
+    SlotFreed(host);
+  }
+
+  if (callback) {
+    callback(err, info);
+  }
+}
+
+void TcpConnectionPool::SlotFreed(const net::HostAndPort& host) {
+  HostConnections& connections = hosts_[host];
+  if (connections.waiters.empty() || connections.busy >= options_.max_per_host) {
+    return;
+  }
+
+  acquire_callback_t waiter = connections.waiters.front();
+  connections.waiters.pop_front();
+  connections.busy++;
+  Connect(host, waiter);
+}
+
+}  // namespace tcp
+}  // namespace libev
+}  // namespace common
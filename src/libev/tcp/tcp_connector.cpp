@@ -0,0 +1,235 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/libev/tcp/tcp_connector.h>
+
+#include <errno.h>
+
+#include <common/libev/event_io.h>
+#include <common/libev/event_timer.h>
+#include <common/net/dns_resolver.h>
+#include <common/net/net.h>
+
+namespace common {
+namespace libev {
+namespace tcp {
+
+TcpConnector::TcpConnector(LibEvLoop* loop,
+                           const net::HostAndPort& host,
+                           double timeout_sec,
+                           connect_callback_t callback,
+                           time64_t attempt_delay_msec)
+    : loop_(loop),
+      host_(host),
+      attempt_delay_msec_(attempt_delay_msec),
+      callback_(callback),
+      addresses_(),
+      next_address_(0),
+      attempts_(),
+      retired_(),
+      delay_timer_(new LibevTimer),
+      timeout_timer_(new LibevTimer),
+      last_error_(),
+      finished_(false) {
+  if (timeout_sec > 0) {
+    timeout_timer_->Init(
+        loop_, [this](LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
+          UNUSED(loop);
+          UNUSED(timer);
+          UNUSED(revents);
+          Fail(make_error_perror("connect", ETIMEDOUT));
+        },
+        timeout_sec, false);
+    timeout_timer_->Start();
+  }
+}
+
+TcpConnector::~TcpConnector() {
+  Cancel();
+  for (LibevIO* io : retired_) {
+    delete io;
+  }
+  destroy(&delay_timer_);
+  destroy(&timeout_timer_);
+}
+
+bool TcpConnector::IsFinished() const {
+  return finished_;
+}
+
+void TcpConnector::Start(const net::IPAddressList& addresses) {
+  if (finished_) {
+    return;
+  }
+
+  addresses_ = net::InterleaveAddressFamilies(addresses);
+  next_address_ = 0;
+  StartNextAttempt();
+}
+
+void TcpConnector::Fail(ErrnoError err) {
+  Finish(err, net::socket_info());
+}
+
+void TcpConnector::Cancel() {
+  if (finished_) {
+    return;
+  }
+
+  finished_ = true;
+  StopAll();
+}
+
+void TcpConnector::StartNextAttempt() {
+  delay_timer_->Stop();
+  while (!finished_ && next_address_ < addresses_.size()) {
+    const net::IPAddress& address = addresses_[next_address_++];
+    net::socket_info info;
+    bool in_progress = false;
+    ErrnoError err = net::connect_nonblock(address, host_.GetPort(), net::ST_SOCK_STREAM, &info, &in_progress);
+    if (err) {
+      last_error_ = err;
+      continue;
+    }
+
+    if (!in_progress) {
+      Finish(ErrnoError(), info);
+      return;
+    }
+
+    LibevIO* io = new LibevIO;
+    bool is_inited = io->Init(
+        loop_, [this](LibEvLoop* loop, LibevIO* io, flags_t revents) {
+          UNUSED(loop);
+          UNUSED(revents);
+          AttemptReady(io);
+        },
+        info.fd(), EV_WRITE);
+    if (!is_inited) {
+      DNOTREACHED();
+      delete io;
+      ignore_result(net::close(info.fd()));
+      continue;
+    }
+
+    io->Start();
+    attempts_.push_back({info, io});
+    if (next_address_ < addresses_.size()) {
+      ArmDelayTimer();
+    }
+    return;
+  }
+
+  if (!finished_ && attempts_.empty()) {
+    Fail(last_error_ ? last_error_ : make_error_perror("connect", EADDRNOTAVAIL));
+  }
+}
+
+void TcpConnector::AttemptReady(LibevIO* io) {
+  for (size_t i = 0; i < attempts_.size(); ++i) {
+    if (attempts_[i].io != io) {
+      continue;
+    }
+
+    const net::socket_info info = attempts_[i].info;
+    ErrnoError err = net::get_connect_result(info.fd());
+    if (!err) {
+      RetireAttempt(i, false);
+      Finish(ErrnoError(), info);
+      return;
+    }
+
+    last_error_ = err;
+    RetireAttempt(i, true);
+    // a failed attempt doesn't wait for the delay
+    StartNextAttempt();
+    return;
+  }
+}
+
+void TcpConnector::RetireAttempt(size_t index, bool close_socket) {
+  Attempt attempt = attempts_[index];
+  attempts_.erase(attempts_.begin() + index);
+  // may be running its own callback, deleted with the connector
+  attempt.io->Stop();
+  retired_.push_back(attempt.io);
+  if (close_socket) {
+    ignore_result(net::close(attempt.info.fd()));
+  }
+}
+
+void TcpConnector::ArmDelayTimer() {
+  // a fired timer keeps no interval, so it is initialized again every time
+  delay_timer_->Stop();
+  delay_timer_->Init(
+      loop_, [this](LibEvLoop* loop, LibevTimer* timer, flags_t revents) {
+        UNUSED(loop);
+        UNUSED(timer);
+        UNUSED(revents);
+        StartNextAttempt();
+      },
+      static_cast<double>(attempt_delay_msec_) / 1000, false);
+  delay_timer_->Start();
+}
+
+void TcpConnector::Finish(ErrnoError err, const net::socket_info& info) {
+  if (finished_) {
+    return;
+  }
+
+  finished_ = true;
+  StopAll();
+
+  net::socket_info result = info;
+  if (!err) {
+    err = net::set_blocking_socket(info.fd(), true);
+    if (err) {
+      ignore_result(net::close(info.fd()));
+      result = net::socket_info();
+    } else {
+      result.set_host(host_.GetHostNoBrackets().c_str());
+    }
+  }
+
+  if (callback_) {
+    callback_(err, result);
+  }
+}
+
+void TcpConnector::StopAll() {
+  delay_timer_->Stop();
+  timeout_timer_->Stop();
+  while (!attempts_.empty()) {
+    RetireAttempt(attempts_.size() - 1, true);
+  }
+}
+
+}  // namespace tcp
+}  // namespace libev
+}  // namespace common
@@ -33,10 +33,13 @@
 #include <signal.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include <common/libev/default_event_loop.h>
 #include <common/libev/event_io.h>
 #include <common/libev/io_child.h>
 #include <common/libev/io_loop.h>
+#include <common/net/net.h>
 
 namespace {
 
@@ -73,10 +76,17 @@ namespace common {
 namespace libev {
 namespace tcp {
 
+TcpAcceptOptions::TcpAcceptOptions()
+    : batch_size(kDefaultBatchSize), nonblocking(false), socket_options(), log_interval_msec(kDefaultLogIntervalMsec) {}
+
 // server
 TcpServer::TcpServer(const net::HostAndPort& host, bool is_default, IoLoopObserver* observer)
-    : IoLoop(is_default ? new LibEvDefaultLoop : new LibEvLoop, observer), sock_(host), accept_io_(new LibevIO) {
+    : IoLoop(is_default ? new LibEvDefaultLoop : new LibEvLoop, observer),
+      sock_(host),
+      accept_io_(new LibevIO),
+      accept_options_() {
   accept_io_->SetUserData(this);
+  SetClientLogInterval(accept_options_.log_interval_msec);
 }
 
 TcpServer::~TcpServer() {
@@ -121,6 +131,19 @@ IoChild* TcpServer::CreateChild() {
 
 void TcpServer::PreLooped(LibEvLoop* loop) {
   net::socket_descr_t fd = sock_.GetFd();
+  // accept_cb takes connections until EAGAIN
+  ErrnoError err = net::set_blocking_socket(fd, false);
+  DCHECK(!err) << err->GetDescription();
+  if (GetBackend() == IO_BACKEND_URING) {
+    err = StartAccept(fd, accept_options_.nonblocking,
+                      [this](ErrnoError accept_err, descriptor_t client_fd) { Accepted(accept_err, client_fd); });
+    if (!err) {
+      IoLoop::PreLooped(loop);
+      return;
+    }
+    WARNING_LOG() << "Can't accept through io_uring: " << err->GetDescription();
+  }
+
   bool is_inited = accept_io_->Init(loop, accept_cb, fd, EV_READ);
   if (!is_inited) {
     DNOTREACHED();
@@ -137,6 +160,7 @@ void TcpServer::PostLooped(LibEvLoop* loop) {
 }
 
 void TcpServer::Stopped(LibEvLoop* loop) {
+  StopAccept();
   loop->StopIO(accept_io_);
   IoLoop::Stopped(loop);
 
@@ -152,6 +176,15 @@ ErrnoError TcpServer::Listen(int backlog) {
   return sock_.Listen(backlog);
 }
 
+void TcpServer::SetAcceptOptions(const TcpAcceptOptions& options) {
+  accept_options_ = options;
+  SetClientLogInterval(options.log_interval_msec);
+}
+
+TcpAcceptOptions TcpServer::GetAcceptOptions() const {
+  return accept_options_;
+}
+
 const char* TcpServer::ClassName() const {
   return "TcpServer";
 }
@@ -167,8 +200,43 @@ bool TcpServer::IsCanBeRegistered(IoClient* client) const {
   return true;
 }
 
-ErrnoError TcpServer::Accept(net::socket_info* info) {
-  return sock_.Accept(info);
+ErrnoError TcpServer::Accept(const net::socket_info& listen_info, net::socket_info* info) {
+  ErrnoError err = net::accept(listen_info, accept_options_.nonblocking, info);
+  if (err) {
+    return err;
+  }
+
+  ApplySocketOptions(*info);
+  return ErrnoError();
+}
+
+void TcpServer::Accepted(ErrnoError err, descriptor_t fd) {
+  if (err) {
+    if (err->GetErrorCode() != ECONNABORTED) {
+      WARNING_LOG() << "Accept failed: " << err->GetDescription();
+    }
+    return;
+  }
+
+  net::socket_info sinfo;
+  err = net::accepted(sock_.GetInfo(), fd, &sinfo);
+  if (err) {
+    // reset before we got to it
+    DEBUG_LOG() << "Accepted connection is gone: " << err->GetDescription();
+    ignore_result(net::close(fd));
+    return;
+  }
+
+  ApplySocketOptions(sinfo);
+  ignore_result(RegisterClient(sinfo));
+}
+
+void TcpServer::ApplySocketOptions(const net::socket_info& info) {
+  ErrnoError err = net::apply_tcp_socket_options(info.fd(), accept_options_.socket_options);
+  if (err) {
+    // the connection is still usable
+    DEBUG_LOG() << "Can't apply socket options: " << err->GetDescription();
+  }
 }
 
 void TcpServer::accept_cb(LibEvLoop* loop, LibevIO* io, int revents) {
@@ -184,14 +252,25 @@ void TcpServer::accept_cb(LibEvLoop* loop, LibevIO* io, int revents) {
     return;
   }
 
-  net::socket_info sinfo;
-  ErrnoError err = pserver->Accept(&sinfo);
-  if (err) {
-    DNOTREACHED() << err->GetDescription();
-    return;
-  }
+  const net::socket_info listen_info = pserver->sock_.GetInfo();
+  const size_t batch_size = std::max<size_t>(pserver->accept_options_.batch_size, 1);
+  for (size_t i = 0; i < batch_size; ++i) {
+    net::socket_info sinfo;
+    ErrnoError err = pserver->Accept(listen_info, &sinfo);
+    if (err) {
+      const int code = err->GetErrorCode();
+      if (code == EAGAIN || code == EWOULDBLOCK) {
+        return;
+      }
+      if (code == ECONNABORTED) {  // reset while in the backlog
+        continue;
+      }
+      WARNING_LOG() << "Accept failed: " << err->GetDescription();
+      return;
+    }
 
-  ignore_result(pserver->RegisterClient(sinfo));
+    ignore_result(pserver->RegisterClient(sinfo));
+  }
 }
 
 }  // namespace tcp
@@ -0,0 +1,253 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/libev/timer_wheel.h>
+
+namespace common {
+namespace libev {
+
+TimerWheelNode::TimerWheelNode()
+    : prev_(nullptr), next_(nullptr), wheel_(nullptr), expires_(0), user_data_(nullptr) {}
+
+TimerWheelNode::~TimerWheelNode() {
+  if (wheel_) {
+    wheel_->Cancel(this);
+  }
+}
+
+bool TimerWheelNode::IsScheduled() const {
+  return wheel_ != nullptr;
+}
+
+uint64_t TimerWheelNode::GetExpires() const {
+  return expires_;
+}
+
+void TimerWheelNode::SetUserData(user_data_t user_data) {
+  user_data_ = user_data;
+}
+
+TimerWheelNode::user_data_t TimerWheelNode::GetUserData() const {
+  return user_data_;
+}
+
+const uint64_t TimerWheel::kMaxTicks;
+
+TimerWheel::TimerWheel(expire_callback_t callback, uint64_t current_tick)
+    : callback_(callback), next_tick_(current_tick + 1), size_(0), root_(), levels_() {
+  for (size_t i = 0; i < kRootSize; ++i) {
+    InitHead(&root_[i]);
+  }
+  for (size_t level = 0; level < kLevels; ++level) {
+    for (size_t i = 0; i < kLevelSize; ++i) {
+      InitHead(&levels_[level][i]);
+    }
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  // orphan whatever is still scheduled, its owner may outlive the wheel
+  TimerWheelNode orphans;
+  InitHead(&orphans);
+  for (size_t i = 0; i < kRootSize; ++i) {
+    Splice(&root_[i], &orphans);
+    while (orphans.next_ != &orphans) {
+      TimerWheelNode* node = orphans.next_;
+      Unlink(node);
+      node->wheel_ = nullptr;
+    }
+  }
+  for (size_t level = 0; level < kLevels; ++level) {
+    for (size_t i = 0; i < kLevelSize; ++i) {
+      Splice(&levels_[level][i], &orphans);
+      while (orphans.next_ != &orphans) {
+        TimerWheelNode* node = orphans.next_;
+        Unlink(node);
+        node->wheel_ = nullptr;
+      }
+    }
+  }
+}
+
+void TimerWheel::ScheduleAt(TimerWheelNode* node, uint64_t tick) {
+  if (!node) {
+    DNOTREACHED();
+    return;
+  }
+
+  if (node->wheel_ == this) {
+    Unlink(node);
+  } else {
+    if (node->wheel_) {
+      node->wheel_->Cancel(node);
+    }
+    node->wheel_ = this;
+    size_++;
+  }
+  node->expires_ = tick;
+  Place(node);
+}
+
+void TimerWheel::Schedule(TimerWheelNode* node, uint64_t ticks) {
+  ScheduleAt(node, GetCurrentTick() + (ticks < kMaxTicks ? ticks : kMaxTicks));
+}
+
+void TimerWheel::Cancel(TimerWheelNode* node) {
+  if (!node || node->wheel_ != this) {
+    return;
+  }
+
+  Unlink(node);
+  node->wheel_ = nullptr;
+  size_--;
+}
+
+size_t TimerWheel::AdvanceTo(uint64_t tick) {
+  size_t fired = 0;
+  while (next_tick_ <= tick) {
+    if (!size_) {
+      next_tick_ = tick + 1;
+      break;
+    }
+    fired += RunTick();
+  }
+  return fired;
+}
+
+uint64_t TimerWheel::GetCurrentTick() const {
+  return next_tick_ - 1;
+}
+
+size_t TimerWheel::GetSize() const {
+  return size_;
+}
+
+bool TimerWheel::IsEmpty() const {
+  return size_ == 0;
+}
+
+void TimerWheel::Place(TimerWheelNode* node) {
+  if (node->expires_ < next_tick_) {
+    Link(&root_[next_tick_ & (kRootSize - 1)], node);
+    return;
+  }
+
+  uint64_t delta = node->expires_ - next_tick_;
+  if (delta < kRootSize) {
+    Link(&root_[node->expires_ & (kRootSize - 1)], node);
+    return;
+  }
+
+  if (delta > kMaxTicks) {
+    node->expires_ = next_tick_ + kMaxTicks;
+    delta = kMaxTicks;
+  }
+  for (size_t level = 0; level < kLevels; ++level) {
+    const size_t shift = kRootBits + level * kLevelBits;
+    if (level + 1 == kLevels || delta < (UINT64_C(1) << (shift + kLevelBits))) {
+      Link(&levels_[level][(node->expires_ >> shift) & (kLevelSize - 1)], node);
+      return;
+    }
+  }
+}
+
+bool TimerWheel::Cascade(size_t level) {
+  const size_t shift = kRootBits + level * kLevelBits;
+  const size_t index = (next_tick_ >> shift) & (kLevelSize - 1);
+  TimerWheelNode pending;
+  Splice(&levels_[level][index], &pending);
+  while (pending.next_ != &pending) {
+    TimerWheelNode* node = pending.next_;
+    Unlink(node);
+    Place(node);
+  }
+  // the next level only moves down when this one wrapped around
+  return index == 0;
+}
+
+size_t TimerWheel::RunTick() {
+  const size_t index = next_tick_ & (kRootSize - 1);
+  if (index == 0) {
+    for (size_t level = 0; level < kLevels && Cascade(level); ++level) {
+    }
+  }
+  next_tick_++;
+
+  TimerWheelNode expired;
+  Splice(&root_[index], &expired);
+  size_t fired = 0;
+  while (expired.next_ != &expired) {
+    TimerWheelNode* node = expired.next_;
+    Unlink(node);
+    node->wheel_ = nullptr;
+    size_--;
+    fired++;
+    if (callback_) {
+      callback_(node);
+    }
+  }
+  return fired;
+}
+
+void TimerWheel::InitHead(TimerWheelNode* head) {
+  head->prev_ = head;
+  head->next_ = head;
+}
+
+void TimerWheel::Link(TimerWheelNode* head, TimerWheelNode* node) {
+  node->prev_ = head->prev_;
+  node->next_ = head;
+  head->prev_->next_ = node;
+  head->prev_ = node;
+}
+
+void TimerWheel::Unlink(TimerWheelNode* node) {
+  node->prev_->next_ = node->next_;
+  node->next_->prev_ = node->prev_;
+  node->prev_ = nullptr;
+  node->next_ = nullptr;
+}
+
+void TimerWheel::Splice(TimerWheelNode* from, TimerWheelNode* to) {
+  if (from->next_ == from) {
+    to->prev_ = to;
+    to->next_ = to;
+    return;
+  }
+
+  to->next_ = from->next_;
+  to->prev_ = from->prev_;
+  to->next_->prev_ = to;
+  to->prev_->next_ = to;
+  from->prev_ = from;
+  from->next_ = from;
+}
+
+}  // namespace libev
+}  // namespace common
@@ -30,5 +30,9 @@
 #include <common/libev/types.h>
 
 namespace common {
-namespace libev {}  // namespace libev
+namespace libev {
+
+IoLoopStatistics::IoLoopStatistics() : clients(0), accepted(0), closed(0), accepts_per_sec(0), closes_per_sec(0) {}
+
+}  // namespace libev
 }  // namespace common
@@ -0,0 +1,116 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/libev/udp/udp_client.h>
+
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <common/eintr_wrapper.h>
+#include <common/net/net.h>
+
+namespace common {
+namespace libev {
+namespace udp {
+
+UdpClient::UdpClient(IoLoop* server,
+                     const net::socket_info& info,
+                     size_t batch_size,
+                     size_t datagram_size,
+                     flags_t flags)
+    : IoClient(server, flags), info_(info), batch_(batch_size, datagram_size) {}
+
+UdpClient::~UdpClient() {}
+
+const char* UdpClient::ClassName() const {
+  return "UdpClient";
+}
+
+net::socket_info UdpClient::GetInfo() const {
+  return info_;
+}
+
+descriptor_t UdpClient::GetFd() const {
+  return info_.fd();
+}
+
+ErrnoError UdpClient::ReadDatagrams(size_t* count_out) {
+  return net::recvmmsg(info_.fd(), &batch_, count_out);
+}
+
+const net::DatagramBatch& UdpClient::GetDatagrams() const {
+  return batch_;
+}
+
+ErrnoError UdpClient::WriteDatagrams(net::DatagramBatch* batch, size_t* count_out) {
+  return net::sendmmsg(info_.fd(), batch, count_out);
+}
+
+ErrnoError UdpClient::DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) {
+  if (!data || !size || !nwrite_out) {
+    return make_errno_error_inval();
+  }
+
+  ssize_t res = HANDLE_EINTR(::send(info_.fd(), data, size, 0));
+  if (res == ERROR_RESULT_VALUE) {
+    return make_error_perror("send", errno);
+  }
+
+  *nwrite_out = res;
+  return ErrnoError();
+}
+
+ErrnoError UdpClient::DoSingleRead(void* out_data, size_t max_size, size_t* nread_out) {
+  if (!out_data || !max_size || !nread_out) {
+    return make_errno_error_inval();
+  }
+
+  // an empty datagram reads as 0 bytes, it is not the end of a stream
+  ssize_t res = HANDLE_EINTR(::recv(info_.fd(), out_data, max_size, 0));
+  if (res == ERROR_RESULT_VALUE) {
+    return make_error_perror("recv", errno);
+  }
+
+  *nread_out = res;
+  return ErrnoError();
+}
+
+ErrnoError UdpClient::DoClose() {
+  const net::socket_descr_t fd = info_.fd();
+  if (fd == INVALID_SOCKET_VALUE) {
+    return ErrnoError();
+  }
+
+  info_ = net::socket_info();
+  return net::close(fd);
+}
+
+}  // namespace udp
+}  // namespace libev
+}  // namespace common
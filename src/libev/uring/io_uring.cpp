@@ -0,0 +1,270 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "io_uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+unsigned* ring_field(void* ring, uint32_t offset) {
+  return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+namespace common {
+namespace libev {
+namespace uring {
+
+IoUring::IoUring()
+    : fd_(-1),
+      sq_ring_(nullptr),
+      sq_ring_size_(0),
+      cq_ring_(nullptr),
+      cq_ring_size_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_flags_(nullptr),
+      sq_array_(nullptr),
+      sq_mask_(0),
+      sq_entries_(0),
+      sqe_tail_(0),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(0),
+      cqes_(nullptr) {}
+
+IoUring::~IoUring() {
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+ErrnoError IoUring::Init(unsigned entries, unsigned cq_entries) {
+  if (IsInited()) {
+    return make_error_perror("io_uring_setup", EEXIST);
+  }
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+  params.cq_entries = cq_entries;
+  int fd = io_uring_setup(entries, &params);
+  if (fd < 0) {
+    return make_error_perror("io_uring_setup", errno);
+  }
+  fd_ = fd;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  void* sq_ring = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return make_error_perror("mmap", errno);
+  }
+  sq_ring_ = sq_ring;
+
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    void* cq_ring =
+        mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return make_error_perror("mmap", errno);
+    }
+    cq_ring_ = cq_ring;
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return make_error_perror("mmap", errno);
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  sq_head_ = ring_field(sq_ring_, params.sq_off.head);
+  sq_tail_ = ring_field(sq_ring_, params.sq_off.tail);
+  sq_flags_ = ring_field(sq_ring_, params.sq_off.flags);
+  sq_array_ = ring_field(sq_ring_, params.sq_off.array);
+  sq_mask_ = *ring_field(sq_ring_, params.sq_off.ring_mask);
+  sq_entries_ = *ring_field(sq_ring_, params.sq_off.ring_entries);
+  sqe_tail_ = *sq_tail_;
+
+  cq_head_ = ring_field(cq_ring_, params.cq_off.head);
+  cq_tail_ = ring_field(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *ring_field(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(static_cast<char*>(cq_ring_) + params.cq_off.cqes);
+  return ErrnoError();
+}
+
+bool IoUring::IsInited() const {
+  return fd_ != -1;
+}
+
+int IoUring::GetFd() const {
+  return fd_;
+}
+
+struct io_uring_sqe* IoUring::GetSqe() {
+  unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sqe_tail_ - head >= sq_entries_) {
+    ErrnoError err = Submit();
+    if (err) {
+      return nullptr;
+    }
+    head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+      return nullptr;
+    }
+  }
+
+  const unsigned index = sqe_tail_ & sq_mask_;
+  sq_array_[index] = index;
+  sqe_tail_++;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+ErrnoError IoUring::Submit() {
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  const size_t queued = GetQueuedCount();
+  if (!queued) {
+    return ErrnoError();
+  }
+
+  int submitted = 0;
+  return Enter(static_cast<unsigned>(queued), 0, 0, &submitted);
+}
+
+ErrnoError IoUring::SubmitAndWait(unsigned wait_nr) {
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  int submitted = 0;
+  return Enter(static_cast<unsigned>(GetQueuedCount()), wait_nr, IORING_ENTER_GETEVENTS, &submitted);
+}
+
+size_t IoUring::GetQueuedCount() const {
+  return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+}
+
+size_t IoUring::GetFreeCount() const {
+  return sq_entries_ - (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE));
+}
+
+struct io_uring_cqe* IoUring::PeekCqe() {
+  const unsigned head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    return nullptr;
+  }
+  return &cqes_[head & cq_mask_];
+}
+
+void IoUring::SeenCqe() {
+  __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+bool IoUring::FlushOverflow() {
+  if (!(__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) {
+    return false;
+  }
+
+  int result = 0;
+  ErrnoError err = Enter(0, 0, IORING_ENTER_GETEVENTS, &result);
+  return !err;
+}
+
+ErrnoError IoUring::RegisterBufferRing(void* ring, unsigned entries, uint16_t group) {
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uintptr_t>(ring);
+  reg.ring_entries = entries;
+  reg.bgid = group;
+  if (io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    return make_error_perror("io_uring_register", errno);
+  }
+  return ErrnoError();
+}
+
+void IoUring::UnregisterBufferRing(uint16_t group) {
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = group;
+  ignore_result(io_uring_register(fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1));
+}
+
+ErrnoError IoUring::Enter(unsigned to_submit, unsigned min_complete, unsigned flags, int* result) {
+  while (true) {
+    int res = io_uring_enter(fd_, to_submit, min_complete, flags);
+    if (res >= 0) {
+      *result = res;
+      return ErrnoError();
+    }
+    if (errno != EINTR) {
+      return make_error_perror("io_uring_enter", errno);
+    }
+  }
+}
+
+}  // namespace uring
+}  // namespace libev
+}  // namespace common
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <common/error.h>
+#include <common/macros.h>
+
+namespace common {
+namespace libev {
+namespace uring {
+
+// Thin io_uring(7) wrapper over the raw syscalls: one submission and one
+// completion queue mapped into the process, used from a single thread.
+class IoUring {
+ public:
+  IoUring();
+  ~IoUring();
+
+  ErrnoError Init(unsigned entries, unsigned cq_entries) WARN_UNUSED_RESULT;
+  bool IsInited() const;
+  int GetFd() const;
+
+  // Free submission slot, zeroed; submits the queued ones to make room when
+  // the queue is full. nullptr only if the kernel refuses them.
+  struct io_uring_sqe* GetSqe();
+  // Hands queued entries to the kernel, one syscall however many there are.
+  ErrnoError Submit() WARN_UNUSED_RESULT;
+  // Same, then blocks until at least |wait_nr| completions are queued.
+  ErrnoError SubmitAndWait(unsigned wait_nr) WARN_UNUSED_RESULT;
+  size_t GetQueuedCount() const;
+  size_t GetFreeCount() const;
+
+  // Oldest completion, nullptr when none; SeenCqe releases it.
+  struct io_uring_cqe* PeekCqe();
+  void SeenCqe();
+  // Moves completions the kernel parked in its overflow list into the queue.
+  bool FlushOverflow();
+
+  ErrnoError RegisterBufferRing(void* ring, unsigned entries, uint16_t group) WARN_UNUSED_RESULT;
+  void UnregisterBufferRing(uint16_t group);
+
+ private:
+  ErrnoError Enter(unsigned to_submit, unsigned min_complete, unsigned flags, int* result) WARN_UNUSED_RESULT;
+
+  int fd_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_flags_;
+  unsigned* sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned sqe_tail_;  // local, published by Submit
+
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+}  // namespace uring
+}  // namespace libev
+}  // namespace common
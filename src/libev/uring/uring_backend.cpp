@@ -0,0 +1,855 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "uring_backend.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <common/logger.h>
+
+#include <common/libev/event_io.h>
+#include <common/libev/event_loop.h>
+#include <common/libev/io_client.h>
+
+namespace {
+const uint16_t kBufferGroup = 0;
+}
+
+namespace common {
+namespace libev {
+namespace uring {
+
+UringConnection::UringConnection(UringBackend* backend, IoClient* client, descriptor_t fd)
+    : backend_(backend),
+      client_(client),
+      fd_(fd),
+      own_fd_(false),
+      ops_(0),
+      dirty_(false),
+      recv_armed_(false),
+      need_recv_(false),
+      eof_(false),
+      read_error_(0),
+      view_(nullptr),
+      view_size_(0),
+      input_(),
+      input_offset_(0),
+      consumed_(0),
+      pending_(),
+      sending_(),
+      sent_(0),
+      sends_left_(0),
+      write_error_(0),
+      releasing_(false),
+      release_aborted_(false),
+      release_callback_(),
+      linger_armed_(false),
+      linger_ts_(),
+      deferred_(false),
+      read_deferred_(false) {}
+
+ErrnoError UringConnection::Read(void* out_data, size_t max_size, size_t* nread_out) {
+  if (input_offset_ < input_.size()) {
+    const size_t size = std::min(max_size, input_.size() - input_offset_);
+    memcpy(out_data, input_.data() + input_offset_, size);
+    input_offset_ += size;
+    if (input_offset_ == input_.size()) {
+      input_.clear();
+      input_offset_ = 0;
+    }
+    consumed_ += size;
+    *nread_out = size;
+    return ErrnoError();
+  }
+
+  if (view_size_) {
+    const size_t size = std::min(max_size, view_size_);
+    memcpy(out_data, view_, size);
+    view_ += size;
+    view_size_ -= size;
+    consumed_ += size;
+    *nread_out = size;
+    return ErrnoError();
+  }
+
+  if (read_error_) {
+    return make_error_perror("recv", read_error_);
+  }
+  if (eof_) {
+    *nread_out = 0;
+    return ErrnoError();
+  }
+  return make_error_perror("recv", EAGAIN);
+}
+
+ErrnoError UringConnection::WaitForInput(size_t size) {
+  return backend_->WaitForInput(this, size);
+}
+
+ErrnoError UringConnection::WaitForOutput() {
+  return backend_->WaitForOutput(this);
+}
+
+ErrnoError UringConnection::Write(const void* data, size_t size, size_t* nwrite_out) {
+  if (write_error_) {
+    return make_error_perror("send", write_error_);
+  }
+  if (pending_.size() + sending_.size() >= UringBackend::kMaxPendingBytes) {
+    return make_error_perror("send", EAGAIN);
+  }
+
+  pending_.append(static_cast<const char*>(data), size);
+  backend_->MarkDirty(this);
+  *nwrite_out = size;
+  return ErrnoError();
+}
+
+bool UringConnection::HasPendingOutput() const {
+  return !pending_.empty() || sends_left_;
+}
+
+bool UringConnection::HasBufferedInput() const {
+  return input_offset_ < input_.size() || view_size_;
+}
+
+UringBackend::UringBackend(read_callback_t on_read)
+    : on_read_(on_read),
+      ring_(),
+      loop_(nullptr),
+      ring_io_(new LibevIO),
+      buffer_ring_(nullptr),
+      buffer_ring_size_(0),
+      buffers_(nullptr),
+      buffer_tail_(0),
+      buffer_ring_registered_(false),
+      connections_(),
+      dirty_(),
+      acceptor_(nullptr),
+      stopped_acceptors_(),
+      waiting_(nullptr),
+      waiting_output_(false),
+      deferred_(),
+      deferred_accepts_() {}
+
+UringBackend::~UringBackend() {
+  destroy(&ring_io_);
+  for (UringConnection* conn : connections_) {
+    if (conn->client_) {
+      conn->client_->uring_ = nullptr;
+    }
+    if (conn->own_fd_) {
+      close(conn->fd_);
+    }
+    delete conn;
+  }
+  connections_.clear();
+  delete acceptor_;
+  for (Acceptor* acceptor : stopped_acceptors_) {
+    delete acceptor;
+  }
+
+  if (buffer_ring_registered_) {
+    ring_.UnregisterBufferRing(kBufferGroup);
+  }
+  if (buffers_) {
+    munmap(buffers_, kBufferCount * kBufferSize);
+  }
+  if (buffer_ring_) {
+    munmap(buffer_ring_, buffer_ring_size_);
+  }
+}
+
+ErrnoError UringBackend::Init() {
+  ErrnoError err = ring_.Init(kQueueEntries, kCompletionEntries);
+  if (err) {
+    return err;
+  }
+
+  buffer_ring_size_ = kBufferCount * sizeof(struct io_uring_buf);
+  void* buffer_ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer_ring == MAP_FAILED) {
+    return make_error_perror("mmap", errno);
+  }
+  buffer_ring_ = static_cast<struct io_uring_buf_ring*>(buffer_ring);
+
+  void* buffers = mmap(nullptr, kBufferCount * kBufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffers == MAP_FAILED) {
+    return make_error_perror("mmap", errno);
+  }
+  buffers_ = static_cast<char*>(buffers);
+
+  err = ring_.RegisterBufferRing(buffer_ring_, kBufferCount, kBufferGroup);
+  if (err) {
+    return err;
+  }
+  buffer_ring_registered_ = true;
+
+  for (unsigned i = 0; i < kBufferCount; ++i) {
+    RecycleBuffer(static_cast<uint16_t>(i));
+  }
+  return ErrnoError();
+}
+
+void UringBackend::Start(LibEvLoop* loop) {
+  loop_ = loop;
+  bool is_inited = ring_io_->Init(
+      loop, [this](LibEvLoop* loop, LibevIO* io, flags_t revents) {
+        UNUSED(loop);
+        UNUSED(io);
+        UNUSED(revents);
+        ReapCompletions();
+      },
+      ring_.GetFd(), EV_READ);
+  if (!is_inited) {
+    DNOTREACHED();
+    return;
+  }
+
+  ring_io_->Start();
+  loop_->SetPrepareCallback([this]() { Flush(); });
+}
+
+void UringBackend::Stop() {
+  if (!loop_) {
+    return;
+  }
+
+  Flush();
+  ring_io_->Stop();
+  loop_->SetPrepareCallback(LibEvLoop::prepare_callback_t());
+  loop_ = nullptr;
+}
+
+bool UringBackend::Attach(IoClient* client) {
+  if (client->GetFlags() != EV_READ) {
+    return false;
+  }
+
+  const descriptor_t fd = client->GetFd();
+  int type = 0;
+  socklen_t type_len = sizeof(type);
+  if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_len) != 0 || type != SOCK_STREAM) {
+    return false;
+  }
+
+  UringConnection* conn = new UringConnection(this, client, fd);
+  connections_.insert(conn);
+  client->uring_ = conn;
+  conn->need_recv_ = true;
+  MarkDirty(conn);
+  return true;
+}
+
+void UringBackend::Detach(IoClient* client) {
+  UringConnection* conn = client->uring_;
+  if (!conn) {
+    return;
+  }
+
+  client->uring_ = nullptr;
+  conn->client_ = nullptr;
+  conn->view_ = nullptr;
+  conn->view_size_ = 0;
+  conn->input_.clear();
+  conn->input_offset_ = 0;
+  conn->need_recv_ = false;
+  conn->releasing_ = false;
+  conn->release_callback_ = release_callback_t();
+  if (conn->recv_armed_) {
+    QueueCancel(conn, TAG_RECV);
+  }
+
+  if (conn->write_error_) {
+    conn->pending_.clear();
+  } else if (conn->HasPendingOutput()) {
+    // the owner closes the socket next, keep our own reference to flush
+    const int fd = fcntl(conn->fd_, F_DUPFD_CLOEXEC, 0);
+    if (fd == -1) {
+      DEBUG_MSG_PERROR("fcntl", errno, logging::LOG_LEVEL_WARNING);
+      conn->pending_.clear();
+    } else {
+      conn->fd_ = fd;
+      conn->own_fd_ = true;
+      QueueLinger(conn);
+    }
+  }
+  MarkDirty(conn);
+
+  // queued entries still name the old descriptor, hand them over while open
+  ErrnoError err = ring_.Submit();
+  if (err) {
+    WARNING_LOG() << "Can't submit io_uring entries: " << err->GetDescription();
+  }
+}
+
+ErrnoError UringBackend::Release(IoClient* client, release_callback_t callback) {
+  UringConnection* conn = client->uring_;
+  if (!conn) {
+    return make_error_perror("UringBackend::Release", EINVAL);
+  }
+  if (conn->releasing_ || conn->HasPendingOutput() || conn->HasBufferedInput()) {
+    return make_error_perror("UringBackend::Release", EBUSY);
+  }
+
+  if (!conn->recv_armed_) {
+    Detach(client);
+    callback(true);
+    return ErrnoError();
+  }
+
+  conn->releasing_ = true;
+  conn->release_aborted_ = false;
+  conn->release_callback_ = callback;
+  conn->need_recv_ = false;
+  QueueCancel(conn, TAG_RECV);
+  return ErrnoError();
+}
+
+ErrnoError UringBackend::StartAccept(descriptor_t listen_fd, bool nonblocking, accept_callback_t callback) {
+  if (acceptor_) {
+    return make_error_perror("UringBackend::StartAccept", EEXIST);
+  }
+
+  acceptor_ = new Acceptor;
+  acceptor_->fd = listen_fd;
+  acceptor_->flags = SOCK_CLOEXEC | (nonblocking ? SOCK_NONBLOCK : 0);
+  acceptor_->callback = callback;
+  acceptor_->armed = false;
+  acceptor_->stopped = false;
+  QueueAccept(acceptor_);
+  return ErrnoError();
+}
+
+void UringBackend::StopAccept() {
+  if (!acceptor_) {
+    return;
+  }
+
+  Acceptor* acceptor = acceptor_;
+  acceptor_ = nullptr;
+  acceptor->stopped = true;
+  if (!acceptor->armed) {
+    delete acceptor;
+    return;
+  }
+
+  stopped_acceptors_.push_back(acceptor);
+  QueueCancel(acceptor, TAG_ACCEPT);
+  ErrnoError err = ring_.Submit();
+  if (err) {
+    WARNING_LOG() << "Can't submit io_uring entries: " << err->GetDescription();
+  }
+}
+
+void UringBackend::ReapCompletions() {
+  if (!waiting_) {
+    DispatchDeferred();
+  }
+
+  do {
+    while (struct io_uring_cqe* cqe = ring_.PeekCqe()) {
+      const uint64_t user_data = cqe->user_data;
+      const int32_t res = cqe->res;
+      const uint32_t flags = cqe->flags;
+      ring_.SeenCqe();
+
+      void* object = reinterpret_cast<void*>(static_cast<uintptr_t>(user_data & ~static_cast<uint64_t>(TAG_MASK)));
+      switch (user_data & TAG_MASK) {
+        case TAG_RECV:
+          HandleRecv(static_cast<UringConnection*>(object), res, flags);
+          break;
+        case TAG_SEND:
+          HandleSend(static_cast<UringConnection*>(object), res);
+          break;
+        case TAG_LINGER:
+          HandleLinger(static_cast<UringConnection*>(object), res);
+          break;
+        case TAG_ACCEPT:
+          HandleAccept(static_cast<Acceptor*>(object), res, flags);
+          break;
+        default:  // cancellations
+          break;
+      }
+    }
+  } while (ring_.FlushOverflow());
+}
+
+void UringBackend::HandleRecv(UringConnection* conn, int32_t res, uint32_t flags) {
+  const bool more = flags & IORING_CQE_F_MORE;
+  if (!more) {
+    conn->recv_armed_ = false;
+    conn->ops_--;
+  }
+
+  if (res > 0) {
+    const uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+    if (conn->client_ && conn->releasing_) {
+      conn->release_aborted_ = true;
+    }
+    if (conn->client_ && waiting_) {
+      conn->input_.append(buffers_ + bid * kBufferSize, static_cast<size_t>(res));
+      NotifyRead(conn);
+    } else if (conn->client_) {
+      conn->view_ = buffers_ + bid * kBufferSize;
+      conn->view_size_ = static_cast<size_t>(res);
+      DeliverRead(conn);
+      // the buffer goes back to the kernel, keep what was not read
+      if (conn->view_size_) {
+        conn->input_.append(conn->view_, conn->view_size_);
+      }
+      conn->view_ = nullptr;
+      conn->view_size_ = 0;
+    }
+    RecycleBuffer(bid);
+  } else if (res == 0) {
+    conn->eof_ = true;
+    if (conn->client_) {
+      NotifyRead(conn);
+    }
+  } else if (res != -ENOBUFS && res != -ECANCELED) {
+    conn->read_error_ = -res;
+    if (conn->client_) {
+      NotifyRead(conn);
+    }
+  }
+
+  if (more) {
+    return;
+  }
+
+  if (conn->releasing_) {
+    if (waiting_) {
+      Defer(conn, false);
+    } else {
+      FinishRelease(conn);
+    }
+  } else if (conn->client_ && !conn->eof_ && !conn->read_error_) {
+    conn->need_recv_ = true;
+  }
+  MarkDirty(conn);
+}
+
+void UringBackend::HandleSend(UringConnection* conn, int32_t res) {
+  conn->ops_--;
+  conn->sends_left_--;
+  if (res > 0) {
+    conn->sent_ += static_cast<size_t>(res);
+  } else if (res < 0 && res != -ECANCELED && !conn->write_error_) {
+    // links after a failed send complete with ECANCELED
+    conn->write_error_ = -res;
+  }
+
+  if (conn->sends_left_) {
+    return;
+  }
+
+  if (conn->write_error_) {
+    conn->pending_.clear();
+  } else if (conn->sent_ < conn->sending_.size()) {
+    // a short send broke the chain, the rest goes first next time
+    conn->pending_.insert(0, conn->sending_, conn->sent_, std::string::npos);
+  }
+  conn->sending_.clear();
+  conn->sent_ = 0;
+  MarkDirty(conn);
+}
+
+void UringBackend::HandleLinger(UringConnection* conn, int32_t res) {
+  conn->ops_--;
+  if (res == -ETIME && conn->linger_armed_) {
+    conn->linger_armed_ = false;
+    if (conn->HasPendingOutput()) {
+      WARNING_LOG() << "Dropped " << conn->pending_.size() + conn->sending_.size() - conn->sent_
+                    << " unsent byte(s) of a closed client";
+      conn->write_error_ = ETIMEDOUT;
+      conn->pending_.clear();
+      if (conn->sends_left_) {
+        QueueCancel(conn, TAG_SEND);
+      }
+    }
+  }
+  MarkDirty(conn);
+}
+
+void UringBackend::HandleAccept(Acceptor* acceptor, int32_t res, uint32_t flags) {
+  if (!(flags & IORING_CQE_F_MORE)) {
+    acceptor->armed = false;
+  }
+
+  if (acceptor->stopped) {
+    if (res >= 0) {
+      close(res);
+    }
+    if (!acceptor->armed) {
+      stopped_acceptors_.erase(std::remove(stopped_acceptors_.begin(), stopped_acceptors_.end(), acceptor),
+                               stopped_acceptors_.end());
+      delete acceptor;
+    }
+    return;
+  }
+
+  // rearmed by the next Flush when the kernel ended the multishot
+  if (waiting_) {
+    deferred_accepts_.push_back(res);
+    return;
+  }
+  DeliverAccept(acceptor, res);
+}
+
+void UringBackend::DeliverAccept(Acceptor* acceptor, int32_t res) {
+  if (res >= 0) {
+    acceptor->callback(ErrnoError(), res);
+  } else if (res != -ECANCELED) {
+    acceptor->callback(make_error_perror("accept", -res), INVALID_DESCRIPTOR);
+  }
+}
+
+void UringBackend::NotifyRead(UringConnection* conn) {
+  if (!waiting_) {
+    DeliverRead(conn);
+  } else if (conn != waiting_ || waiting_output_) {
+    Defer(conn, true);
+  }
+}
+
+void UringBackend::DeliverRead(UringConnection* conn) {
+  // the kernel reports every piece of input once, so what a callback left
+  // over is offered again for as long as the callback keeps taking some
+  size_t consumed = conn->consumed_;
+  on_read_(conn->client_);
+  while (conn->client_ && conn->HasBufferedInput() && conn->consumed_ != consumed) {
+    consumed = conn->consumed_;
+    on_read_(conn->client_);
+  }
+}
+
+ErrnoError UringBackend::WaitForInput(UringConnection* conn, size_t size) {
+  if (waiting_) {
+    // nothing of a client runs while waiting, so this can't be reached
+    DNOTREACHED();
+    return make_error_perror("UringBackend::WaitForInput", EDEADLK);
+  }
+
+  KeepView(conn);
+  ErrnoError err;
+  waiting_ = conn;
+  while (conn->input_.size() - conn->input_offset_ < size && !conn->eof_ && !conn->read_error_) {
+    if (!conn->recv_armed_) {
+      if (conn->releasing_) {
+        conn->release_aborted_ = true;
+      }
+      QueueRecv(conn);
+      if (!conn->recv_armed_) {
+        err = make_error_perror("UringBackend::WaitForInput", EBUSY);
+        break;
+      }
+    }
+    // the peer may wait for a reply queued before this read
+    QueueSends(conn);
+
+    err = ring_.SubmitAndWait(1);
+    if (err) {
+      break;
+    }
+    ReapCompletions();
+  }
+  waiting_ = nullptr;
+  return err;
+}
+
+ErrnoError UringBackend::WaitForOutput(UringConnection* conn) {
+  if (waiting_) {
+    DNOTREACHED();
+    return make_error_perror("UringBackend::WaitForOutput", EDEADLK);
+  }
+
+  KeepView(conn);
+  ErrnoError err;
+  waiting_ = conn;
+  waiting_output_ = true;
+  while (conn->pending_.size() + conn->sending_.size() >= kMaxPendingBytes && !conn->write_error_) {
+    QueueSends(conn);
+    if (!conn->sends_left_) {
+      err = make_error_perror("UringBackend::WaitForOutput", EBUSY);
+      break;
+    }
+    err = ring_.SubmitAndWait(1);
+    if (err) {
+      break;
+    }
+    ReapCompletions();
+  }
+  waiting_output_ = false;
+  waiting_ = nullptr;
+  if (!err && conn->write_error_) {
+    err = make_error_perror("send", conn->write_error_);
+  }
+  return err;
+}
+
+void UringBackend::KeepView(UringConnection* conn) {
+  // the rest of the buffer being delivered comes before what arrives next
+  if (conn->view_size_) {
+    conn->input_.append(conn->view_, conn->view_size_);
+    conn->view_ = nullptr;
+    conn->view_size_ = 0;
+  }
+}
+
+void UringBackend::Defer(UringConnection* conn, bool read) {
+  if (read) {
+    conn->read_deferred_ = true;
+  }
+  if (!conn->deferred_) {
+    conn->deferred_ = true;
+    deferred_.push_back(conn);
+  }
+}
+
+void UringBackend::DispatchDeferred() {
+  while (!deferred_.empty()) {
+    std::vector<UringConnection*> deferred;
+    deferred.swap(deferred_);
+    for (UringConnection* conn : deferred) {
+      conn->deferred_ = false;
+      const bool read = conn->read_deferred_;
+      conn->read_deferred_ = false;
+      // a later callback may have taken the input already
+      if (read && conn->client_ && (conn->HasBufferedInput() || conn->eof_ || conn->read_error_)) {
+        DeliverRead(conn);
+      }
+      if (conn->releasing_ && !conn->recv_armed_) {
+        FinishRelease(conn);
+      }
+    }
+  }
+
+  std::vector<int32_t> accepts;
+  accepts.swap(deferred_accepts_);
+  for (int32_t res : accepts) {
+    if (acceptor_) {
+      DeliverAccept(acceptor_, res);
+    } else if (res >= 0) {
+      close(res);
+    }
+  }
+}
+
+void UringBackend::Flush() {
+  DispatchDeferred();
+
+  std::vector<UringConnection*> dirty;
+  dirty.swap(dirty_);
+  for (UringConnection* conn : dirty) {
+    conn->dirty_ = false;
+    if (!conn->client_) {
+      if (conn->linger_armed_ && !conn->HasPendingOutput()) {
+        conn->linger_armed_ = false;
+        QueueCancel(conn, TAG_LINGER);
+      }
+      if (!conn->ops_ && !conn->HasPendingOutput()) {
+        FreeConnection(conn);
+        continue;
+      }
+    } else if (conn->need_recv_ && !conn->recv_armed_ && !conn->releasing_) {
+      QueueRecv(conn);
+    }
+    QueueSends(conn);
+  }
+
+  if (acceptor_ && !acceptor_->armed) {
+    QueueAccept(acceptor_);
+  }
+
+  ErrnoError err = ring_.Submit();
+  if (err) {
+    WARNING_LOG() << "Can't submit io_uring entries: " << err->GetDescription();
+  }
+}
+
+void UringBackend::MarkDirty(UringConnection* conn) {
+  if (conn->dirty_) {
+    return;
+  }
+
+  conn->dirty_ = true;
+  dirty_.push_back(conn);
+}
+
+void UringBackend::QueueRecv(UringConnection* conn) {
+  struct io_uring_sqe* sqe = ring_.GetSqe();
+  if (!sqe) {
+    MarkDirty(conn);
+    return;
+  }
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = conn->fd_;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = MakeUserData(conn, TAG_RECV);
+  conn->recv_armed_ = true;
+  conn->need_recv_ = false;
+  conn->ops_++;
+}
+
+void UringBackend::QueueSends(UringConnection* conn) {
+  if (conn->sends_left_ || conn->pending_.empty() || conn->write_error_) {
+    return;
+  }
+
+  const size_t chunks = std::min<size_t>((conn->pending_.size() + kMaxSendChunk - 1) / kMaxSendChunk, kMaxChainLength);
+  if (ring_.GetFreeCount() < chunks) {
+    // a chain split between two submissions would lose its ordering
+    ErrnoError err = ring_.Submit();
+    if (err || ring_.GetFreeCount() < chunks) {
+      MarkDirty(conn);
+      return;
+    }
+  }
+
+  const size_t size = std::min(conn->pending_.size(), chunks * kMaxSendChunk);
+  conn->sending_.assign(conn->pending_, 0, size);
+  conn->pending_.erase(0, size);
+  conn->sent_ = 0;
+  for (size_t offset = 0; offset < size; offset += kMaxSendChunk) {
+    struct io_uring_sqe* sqe = ring_.GetSqe();
+    const size_t len = std::min<size_t>(size - offset, kMaxSendChunk);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd_;
+    sqe->addr = reinterpret_cast<uintptr_t>(conn->sending_.data() + offset);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    if (offset + len < size) {
+      sqe->flags = IOSQE_IO_LINK;
+    }
+    sqe->user_data = MakeUserData(conn, TAG_SEND);
+    conn->sends_left_++;
+    conn->ops_++;
+  }
+}
+
+void UringBackend::QueueAccept(Acceptor* acceptor) {
+  struct io_uring_sqe* sqe = ring_.GetSqe();
+  if (!sqe) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = acceptor->fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = static_cast<uint32_t>(acceptor->flags);
+  sqe->user_data = MakeUserData(acceptor, TAG_ACCEPT);
+  acceptor->armed = true;
+}
+
+void UringBackend::QueueCancel(void* object, Tag tag) {
+  struct io_uring_sqe* sqe = ring_.GetSqe();
+  if (!sqe) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = MakeUserData(object, tag);
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+  sqe->user_data = MakeUserData(nullptr, TAG_NONE);
+}
+
+void UringBackend::QueueLinger(UringConnection* conn) {
+  struct io_uring_sqe* sqe = ring_.GetSqe();
+  if (!sqe) {
+    return;
+  }
+
+  conn->linger_ts_.tv_sec = kLingerMsec / 1000;
+  conn->linger_ts_.tv_nsec = (kLingerMsec % 1000) * 1000000;
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->fd = -1;
+  sqe->addr = reinterpret_cast<uintptr_t>(&conn->linger_ts_);
+  sqe->len = 1;
+  sqe->user_data = MakeUserData(conn, TAG_LINGER);
+  conn->linger_armed_ = true;
+  conn->ops_++;
+}
+
+void UringBackend::FinishRelease(UringConnection* conn) {
+  conn->releasing_ = false;
+  release_callback_t callback = conn->release_callback_;
+  conn->release_callback_ = release_callback_t();
+  IoClient* client = conn->client_;
+  if (!client || !callback) {
+    return;
+  }
+
+  if (conn->release_aborted_ || conn->HasPendingOutput() || conn->HasBufferedInput() || conn->eof_ ||
+      conn->read_error_) {
+    conn->need_recv_ = !conn->eof_ && !conn->read_error_;
+    MarkDirty(conn);
+    callback(false);
+    return;
+  }
+
+  Detach(client);
+  callback(true);
+}
+
+void UringBackend::FreeConnection(UringConnection* conn) {
+  connections_.erase(conn);
+  if (conn->own_fd_) {
+    close(conn->fd_);
+  }
+  delete conn;
+}
+
+void UringBackend::RecycleBuffer(uint16_t bid) {
+  struct io_uring_buf* bufs = reinterpret_cast<struct io_uring_buf*>(buffer_ring_);
+  struct io_uring_buf* buf = &bufs[buffer_tail_ & (kBufferCount - 1)];
+  buf->addr = reinterpret_cast<uintptr_t>(buffers_ + bid * kBufferSize);
+  buf->len = kBufferSize;
+  buf->bid = bid;
+  buffer_tail_++;
+  __atomic_store_n(&buffer_ring_->tail, buffer_tail_, __ATOMIC_RELEASE);
+}
+
+uint64_t UringBackend::MakeUserData(void* object, Tag tag) {
+  return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object)) | tag;
+}
+
+}  // namespace uring
+}  // namespace libev
+}  // namespace common
@@ -0,0 +1,219 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <linux/time_types.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <common/libev/types.h>
+
+#include "io_uring.h"
+
+namespace common {
+namespace libev {
+
+class IoClient;
+
+namespace uring {
+
+class UringBackend;
+
+// io_uring state of one client socket. Owned by the backend, it outlives its
+// client until the last operation of the socket has completed.
+class UringConnection {
+ public:
+  // Input not taken by DataReceived is kept and served first, EAGAIN when
+  // nothing is buffered, 0 bytes once the peer has shut down. As with a
+  // level triggered watcher, DataReceived runs again while input is left
+  // and the previous call took some of it.
+  ErrnoError Read(void* out_data, size_t max_size, size_t* nread_out) WARN_UNUSED_RESULT;
+  // Blocks until |size| bytes are buffered or the stream has ended, as a
+  // blocking socket would, for readers that need a whole record at once.
+  ErrnoError WaitForInput(size_t size) WARN_UNUSED_RESULT;
+  // Queues |data| for a send submitted with the next batch; fails with the
+  // error of an earlier send, or EAGAIN while kMaxPendingBytes are queued.
+  ErrnoError Write(const void* data, size_t size, size_t* nwrite_out) WARN_UNUSED_RESULT;
+  // Blocks while kMaxPendingBytes are queued, as a blocking socket would
+  // when its send buffer is full; fails with the error of a send.
+  ErrnoError WaitForOutput() WARN_UNUSED_RESULT;
+
+  bool HasPendingOutput() const;
+  bool HasBufferedInput() const;
+
+ private:
+  friend class UringBackend;
+
+  UringConnection(UringBackend* backend, IoClient* client, descriptor_t fd);
+
+  UringBackend* const backend_;
+  IoClient* client_;  // nullptr once detached
+  descriptor_t fd_;
+  bool own_fd_;  // dup kept after detach to finish sending
+  size_t ops_;   // submitted operations without their last completion
+  bool dirty_;
+
+  bool recv_armed_;
+  bool need_recv_;
+  bool eof_;
+  int read_error_;
+  const char* view_;  // provided buffer being delivered
+  size_t view_size_;
+  std::string input_;
+  size_t input_offset_;
+  size_t consumed_;  // bytes taken by Read, tells whether a callback made progress
+
+  std::string pending_;  // queued by Write, not submitted yet
+  std::string sending_;  // one linked chain in flight
+  size_t sent_;
+  size_t sends_left_;
+  int write_error_;
+
+  bool releasing_;
+  bool release_aborted_;
+  std::function<void(bool released)> release_callback_;
+
+  bool linger_armed_;
+  struct __kernel_timespec linger_ts_;
+
+  bool deferred_;       // in the backend's deferred list
+  bool read_deferred_;  // owes a read callback from a wait
+
+  DISALLOW_COPY_AND_ASSIGN(UringConnection);
+};
+
+// Runs the socket I/O of an IoLoop on io_uring: multishot accept, multishot
+// receives into a ring of provided buffers registered with the kernel, and
+// linked sends. Operations queued while handling events are submitted in one
+// batch right before the loop waits; the ring fd itself is an ordinary libev
+// watcher, so timers, async wakeups and children stay on libev.
+class UringBackend {
+ public:
+  typedef std::function<void(IoClient* client)> read_callback_t;
+  typedef std::function<void(ErrnoError err, descriptor_t fd)> accept_callback_t;
+  typedef std::function<void(bool released)> release_callback_t;
+
+  enum : unsigned { kQueueEntries = 256, kCompletionEntries = 4096, kBufferCount = 256 };
+  enum : size_t { kBufferSize = 16 * 1024, kMaxSendChunk = 256 * 1024, kMaxChainLength = 16 };
+  enum : size_t { kMaxPendingBytes = kMaxSendChunk * kMaxChainLength };
+  // How long a closed client may take to flush its queued output.
+  enum : time64_t { kLingerMsec = 10000 };
+
+  explicit UringBackend(read_callback_t on_read);
+  ~UringBackend();
+
+  // Sets up the ring and the receive buffers, any thread.
+  ErrnoError Init() WARN_UNUSED_RESULT;
+  void Start(LibEvLoop* loop);
+  void Stop();
+
+  // Takes over the I/O of |client|, false leaves it to libev: only stream
+  // sockets watched for EV_READ alone qualify.
+  bool Attach(IoClient* client);
+  // Stops receiving for |client|; output it queued is still sent, also if
+  // the socket gets closed right after.
+  void Detach(IoClient* client);
+  // Detaches |client| without losing input: the receive is cancelled first
+  // and |callback| gets true once it is, or false when data came meanwhile
+  // and the client stays attached. EBUSY while output or input is buffered.
+  ErrnoError Release(IoClient* client, release_callback_t callback) WARN_UNUSED_RESULT;
+
+  ErrnoError StartAccept(descriptor_t listen_fd, bool nonblocking, accept_callback_t callback) WARN_UNUSED_RESULT;
+  void StopAccept();
+
+ private:
+  friend class UringConnection;
+
+  enum Tag : uint64_t { TAG_NONE = 0, TAG_RECV = 1, TAG_SEND = 2, TAG_ACCEPT = 3, TAG_LINGER = 4, TAG_MASK = 7 };
+
+  struct Acceptor {
+    descriptor_t fd;
+    int flags;
+    accept_callback_t callback;
+    bool armed;
+    bool stopped;
+  };
+
+  void ReapCompletions();
+  void HandleRecv(UringConnection* conn, int32_t res, uint32_t flags);
+  void HandleSend(UringConnection* conn, int32_t res);
+  void HandleLinger(UringConnection* conn, int32_t res);
+  void HandleAccept(Acceptor* acceptor, int32_t res, uint32_t flags);
+  void DeliverAccept(Acceptor* acceptor, int32_t res);
+  void NotifyRead(UringConnection* conn);
+  void DeliverRead(UringConnection* conn);
+
+  // Completions reaped while a client waits for input or output room don't
+  // run callbacks, those are deferred until the next Flush.
+  ErrnoError WaitForInput(UringConnection* conn, size_t size);
+  ErrnoError WaitForOutput(UringConnection* conn);
+  void KeepView(UringConnection* conn);
+  void Defer(UringConnection* conn, bool read);
+  void DispatchDeferred();
+
+  void Flush();
+  void MarkDirty(UringConnection* conn);
+  void QueueRecv(UringConnection* conn);
+  void QueueSends(UringConnection* conn);
+  void QueueAccept(Acceptor* acceptor);
+  void QueueCancel(void* object, Tag tag);
+  void QueueLinger(UringConnection* conn);
+  void FinishRelease(UringConnection* conn);
+  void FreeConnection(UringConnection* conn);
+  void RecycleBuffer(uint16_t bid);
+
+  static uint64_t MakeUserData(void* object, Tag tag);
+
+  const read_callback_t on_read_;
+  IoUring ring_;
+  LibEvLoop* loop_;
+  LibevIO* ring_io_;
+  struct io_uring_buf_ring* buffer_ring_;
+  size_t buffer_ring_size_;
+  char* buffers_;
+  uint16_t buffer_tail_;
+  bool buffer_ring_registered_;
+  std::set<UringConnection*> connections_;
+  std::vector<UringConnection*> dirty_;
+  Acceptor* acceptor_;
+  std::vector<Acceptor*> stopped_acceptors_;
+  UringConnection* waiting_;
+  bool waiting_output_;
+  std::vector<UringConnection*> deferred_;
+  std::vector<int32_t> deferred_accepts_;
+
+  DISALLOW_COPY_AND_ASSIGN(UringBackend);
+};
+
+}  // namespace uring
+}  // namespace libev
+}  // namespace common
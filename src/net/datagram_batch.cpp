@@ -0,0 +1,315 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/net/datagram_batch.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <common/eintr_wrapper.h>
+
+#if defined(OS_LINUX)
+#include <netinet/udp.h>
+#if !defined(SOL_UDP)
+#define SOL_UDP 17
+#endif
+#if !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+#if !defined(UDP_GRO)
+#define UDP_GRO 104
+#endif
+#endif
+
+namespace common {
+namespace net {
+
+namespace {
+
+// room for a single UDP_SEGMENT/UDP_GRO control message per slot
+const size_t kControlSize = CMSG_SPACE(sizeof(int));
+
+}  // namespace
+
+DatagramBatch::DatagramBatch(size_t capacity, size_t datagram_size)
+    : capacity_(capacity),
+      datagram_size_(std::min<size_t>(datagram_size, kMaxDatagramSize)),
+      buffer_(capacity_ * datagram_size_),
+      control_(capacity_ * kControlSize),
+      iovecs_(capacity_),
+      addresses_(capacity_),
+      messages_(capacity_),
+      segment_sizes_(capacity_),
+      count_(0),
+      sent_(0) {
+  for (size_t i = 0; i < capacity_; ++i) {
+    ResetSlot(i, datagram_size_);
+  }
+}
+
+DatagramBatch::~DatagramBatch() {}
+
+size_t DatagramBatch::GetCapacity() const {
+  return capacity_;
+}
+
+size_t DatagramBatch::GetDatagramSize() const {
+  return datagram_size_;
+}
+
+size_t DatagramBatch::GetCount() const {
+  return count_;
+}
+
+size_t DatagramBatch::GetSent() const {
+  return sent_;
+}
+
+bool DatagramBatch::IsFull() const {
+  return count_ == capacity_;
+}
+
+void DatagramBatch::Clear() {
+  count_ = 0;
+  sent_ = 0;
+}
+
+bool DatagramBatch::Push(const void* data,
+                         size_t size,
+                         const struct sockaddr* addr,
+                         socklen_t addr_len,
+                         uint16_t segment_size) {
+  if (IsFull() || size > datagram_size_ || (size && !data) || addr_len > sizeof(struct sockaddr_storage)) {
+    return false;
+  }
+
+  const size_t index = count_;
+  ResetSlot(index, size);
+  if (size) {
+    memcpy(&buffer_[index * datagram_size_], data, size);
+  }
+  Message* message = &messages_[index];
+  if (addr && addr_len) {
+    memcpy(&addresses_[index], addr, addr_len);
+    message->hdr.msg_namelen = addr_len;
+  } else {
+    message->hdr.msg_name = nullptr;
+    message->hdr.msg_namelen = 0;
+  }
+  SetSegmentSize(index, segment_size);
+  count_++;
+  return true;
+}
+
+const char* DatagramBatch::GetData(size_t index) const {
+  DCHECK(index < count_);
+  return &buffer_[index * datagram_size_];
+}
+
+size_t DatagramBatch::GetSize(size_t index) const {
+  DCHECK(index < count_);
+  return messages_[index].len;
+}
+
+const struct sockaddr* DatagramBatch::GetAddress(size_t index) const {
+  DCHECK(index < count_);
+  return reinterpret_cast<const struct sockaddr*>(&addresses_[index]);
+}
+
+socklen_t DatagramBatch::GetAddressLength(size_t index) const {
+  DCHECK(index < count_);
+  return messages_[index].hdr.msg_namelen;
+}
+
+uint16_t DatagramBatch::GetSegmentSize(size_t index) const {
+  DCHECK(index < count_);
+  return segment_sizes_[index];
+}
+
+void DatagramBatch::ResetSlot(size_t index, size_t size) {
+  struct iovec* iov = &iovecs_[index];
+  iov->iov_base = &buffer_[index * datagram_size_];
+  iov->iov_len = size;
+
+  Message* message = &messages_[index];
+  memset(message, 0, sizeof(Message));
+  message->hdr.msg_name = &addresses_[index];
+  message->hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  message->hdr.msg_iov = iov;
+  message->hdr.msg_iovlen = 1;
+  message->hdr.msg_control = &control_[index * kControlSize];
+  message->hdr.msg_controllen = kControlSize;
+  message->len = size;
+  segment_sizes_[index] = 0;
+}
+
+void DatagramBatch::SetSegmentSize(size_t index, uint16_t segment_size) {
+  Message* message = &messages_[index];
+  segment_sizes_[index] = segment_size;
+#if defined(OS_LINUX)
+  if (segment_size) {
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message->hdr);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    message->hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+    return;
+  }
+#endif
+  message->hdr.msg_control = nullptr;
+  message->hdr.msg_controllen = 0;
+}
+
+void DatagramBatch::ParseReceived(size_t index) {
+  segment_sizes_[index] = 0;
+#if defined(OS_LINUX)
+  struct msghdr* hdr = &messages_[index].hdr;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int segment_size = 0;
+      memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+      segment_sizes_[index] = static_cast<uint16_t>(segment_size);
+    }
+  }
+#else
+  UNUSED(index);
+#endif
+}
+
+ErrnoError sendmmsg(socket_descr_t fd, DatagramBatch* batch, size_t* nsent_out) {
+  if (fd == INVALID_SOCKET_VALUE || !batch || !nsent_out) {
+    return make_error_perror("sendmmsg", EINVAL);
+  }
+
+  *nsent_out = 0;
+  size_t sent = 0;
+  while (batch->sent_ < batch->count_) {
+    DatagramBatch::Message* first = &batch->messages_[batch->sent_];
+    const size_t pending = batch->count_ - batch->sent_;
+#if defined(OS_LINUX)
+    int res = HANDLE_EINTR(::sendmmsg(fd, reinterpret_cast<struct mmsghdr*>(first), pending, 0));
+#else
+    // one datagram per call where sendmmsg is missing
+    UNUSED(pending);
+    ssize_t res = HANDLE_EINTR(::sendmsg(fd, &first->hdr, 0));
+    if (res != ERROR_RESULT_VALUE) {
+      first->len = res;
+      res = 1;
+    }
+#endif
+    if (res == ERROR_RESULT_VALUE) {
+      if (sent && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      return make_error_perror("sendmmsg", errno);
+    }
+
+    batch->sent_ += res;
+    sent += res;
+  }
+
+  *nsent_out = sent;
+  return ErrnoError();
+}
+
+ErrnoError recvmmsg(socket_descr_t fd, DatagramBatch* batch, size_t* nread_out) {
+  if (fd == INVALID_SOCKET_VALUE || !batch || !nread_out || !batch->capacity_) {
+    return make_error_perror("recvmmsg", EINVAL);
+  }
+
+  batch->Clear();
+  *nread_out = 0;
+  for (size_t i = 0; i < batch->capacity_; ++i) {
+    batch->ResetSlot(i, batch->datagram_size_);
+  }
+
+#if defined(OS_LINUX)
+  static_assert(sizeof(DatagramBatch::Message) == sizeof(struct mmsghdr), "Message must match mmsghdr");
+  int res = HANDLE_EINTR(::recvmmsg(fd, reinterpret_cast<struct mmsghdr*>(batch->messages_.data()), batch->capacity_,
+                                    MSG_WAITFORONE, nullptr));
+  if (res == ERROR_RESULT_VALUE) {
+    return make_error_perror("recvmmsg", errno);
+  }
+#else
+  int res = 0;
+  while (static_cast<size_t>(res) < batch->capacity_) {
+    DatagramBatch::Message* message = &batch->messages_[res];
+    ssize_t nread = HANDLE_EINTR(::recvmsg(fd, &message->hdr, res ? MSG_DONTWAIT : 0));
+    if (nread == ERROR_RESULT_VALUE) {
+      if (res && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      return make_error_perror("recvmmsg", errno);
+    }
+    message->len = nread;
+    res++;
+  }
+#endif
+
+  for (int i = 0; i < res; ++i) {
+    batch->ParseReceived(i);
+  }
+  batch->count_ = res;
+  *nread_out = res;
+  return ErrnoError();
+}
+
+ErrnoError set_udp_gro(socket_descr_t fd, bool enable) {
+#if defined(OS_LINUX)
+  const int on = enable ? 1 : 0;
+  if (setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == ERROR_RESULT_VALUE) {
+    return make_error_perror("setsockopt", errno);
+  }
+  return ErrnoError();
+#else
+  UNUSED(fd);
+  UNUSED(enable);
+  return make_error_perror("set_udp_gro", ENOTSUP);
+#endif
+}
+
+ErrnoError set_udp_segment_size(socket_descr_t fd, uint16_t segment_size) {
+#if defined(OS_LINUX)
+  const int size = segment_size;
+  if (setsockopt(fd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) == ERROR_RESULT_VALUE) {
+    return make_error_perror("setsockopt", errno);
+  }
+  return ErrnoError();
+#else
+  UNUSED(fd);
+  UNUSED(segment_size);
+  return make_error_perror("set_udp_segment_size", ENOTSUP);
+#endif
+}
+
+}  // namespace net
+}  // namespace common
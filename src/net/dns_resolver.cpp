@@ -0,0 +1,345 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/net/dns_resolver.h>
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(OS_POSIX)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+
+#include <algorithm>
+
+#include <common/patterns/singleton_pattern.h>
+#include <common/string_util.h>
+#include <common/time.h>
+
+namespace common {
+namespace net {
+
+namespace {
+
+void AppendUnique(const IPAddress& address, IPAddressList* out) {
+  if (std::find(out->begin(), out->end(), address) == out->end()) {
+    out->push_back(address);
+  }
+}
+
+}  // namespace
+
+DnsResolverOptions::DnsResolverOptions()
+    : workers(kDefaultWorkers),
+      positive_ttl_msec(kDefaultPositiveTtlMsec),
+      negative_ttl_msec(kDefaultNegativeTtlMsec),
+      max_entries(kDefaultMaxEntries) {}
+
+IPAddressList InterleaveAddressFamilies(const IPAddressList& addresses) {
+  if (addresses.empty()) {
+    return addresses;
+  }
+
+  IPAddressList first, second;
+  const bool first_is_ipv6 = addresses[0].IsIPv6();
+  for (const IPAddress& address : addresses) {
+    if (address.IsIPv6() == first_is_ipv6) {
+      first.push_back(address);
+    } else {
+      second.push_back(address);
+    }
+  }
+
+  IPAddressList result;
+  result.reserve(addresses.size());
+  for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+    if (i < first.size()) {
+      result.push_back(first[i]);
+    }
+    if (i < second.size()) {
+      result.push_back(second[i]);
+    }
+  }
+  return result;
+}
+
+ErrnoError SystemLookup(const std::string& host, IPAddressList* out, time64_t* ttl_msec) {
+  UNUSED(ttl_msec);
+  if (host.empty() || !out) {
+    return make_error_perror("getaddrinfo", EINVAL);
+  }
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM; /* One entry per address */
+  struct addrinfo* result = nullptr;
+  int rv = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+  if (rv != 0) {
+    return make_error_perror("getaddrinfo", rv);
+  }
+
+  IPAddressList addresses;
+  for (struct addrinfo* rp = result; rp != nullptr; rp = rp->ai_next) {
+    if (rp->ai_family == AF_INET) {
+      const struct sockaddr_in* sin = reinterpret_cast<const struct sockaddr_in*>(rp->ai_addr);
+      AppendUnique(IPAddress(reinterpret_cast<const uint8_t*>(&sin->sin_addr), IPAddress::kIPv4AddressSize),
+                   &addresses);
+    } else if (rp->ai_family == AF_INET6) {
+      const struct sockaddr_in6* sin6 = reinterpret_cast<const struct sockaddr_in6*>(rp->ai_addr);
+      AppendUnique(IPAddress(reinterpret_cast<const uint8_t*>(&sin6->sin6_addr), IPAddress::kIPv6AddressSize),
+                   &addresses);
+    }
+  }
+  freeaddrinfo(result);
+
+  if (addresses.empty()) {
+    return make_error_perror("getaddrinfo", EADDRNOTAVAIL);
+  }
+
+  *out = addresses;
+  return ErrnoError();
+}
+
+DnsResolver::DnsResolver(const DnsResolverOptions& options)
+    : options_(options), lookup_(), cache_(), pending_(), mutex_(), workers_() {
+  workers_.Start(std::max<size_t>(options_.workers, 1));
+}
+
+DnsResolver::~DnsResolver() {
+  workers_.Stop();
+
+  // Lookups still queued were dropped with the pool.
+  std::unordered_map<std::string, waiters_t> pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending.swap(pending_);
+  }
+  const ErrnoError err = make_error_perror("DnsResolver", ECANCELED);
+  for (const auto& it : pending) {
+    for (const Waiter& waiter : it.second) {
+      Deliver(waiter, err, IPAddressList());
+    }
+  }
+}
+
+void DnsResolver::Resolve(const HostAndPort& host, executor_t executor, resolve_callback_t callback) {
+  Resolve(host.GetHostNoBrackets(), executor, callback);
+}
+
+void DnsResolver::Resolve(const std::string& host, executor_t executor, resolve_callback_t callback) {
+  if (!callback) {
+    return;
+  }
+
+  const Waiter waiter = {executor, callback};
+  IPAddress literal;
+  if (literal.AssignFromIPLiteral(host)) {
+    Deliver(waiter, ErrnoError(), {literal});
+    return;
+  }
+
+  if (host.empty()) {
+    Deliver(waiter, make_error_perror("DnsResolver", EINVAL), IPAddressList());
+    return;
+  }
+
+  const std::string key = ToLowerASCII(host);
+  ErrnoError err;
+  IPAddressList addresses;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!FindCachedLocked(key, time::current_monotonic_mstime(), &err, &addresses)) {
+      auto it = pending_.find(key);
+      if (it != pending_.end()) {
+        it->second.push_back(waiter);
+        return;
+      }
+
+      pending_[key].push_back(waiter);
+      lock.unlock();
+      workers_.Post([this, key]() { RunLookup(key); });
+      return;
+    }
+  }
+  Deliver(waiter, err, addresses);
+}
+
+ErrnoError DnsResolver::ResolveSync(const std::string& host, IPAddressList* out) {
+  if (!out) {
+    return make_error_perror("DnsResolver", EINVAL);
+  }
+
+  IPAddress literal;
+  if (literal.AssignFromIPLiteral(host)) {
+    *out = {literal};
+    return ErrnoError();
+  }
+
+  if (host.empty()) {
+    return make_error_perror("DnsResolver", EINVAL);
+  }
+
+  const std::string key = ToLowerASCII(host);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ErrnoError err;
+    if (FindCachedLocked(key, time::current_monotonic_mstime(), &err, out)) {
+      return err;
+    }
+  }
+  return DoLookup(key, out);
+}
+
+void DnsResolver::SetLookupFunction(lookup_function_t lookup) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lookup_ = lookup;
+}
+
+void DnsResolver::ClearCache() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+}
+
+size_t DnsResolver::GetCacheSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cache_.size();
+}
+
+DnsResolver* DnsResolver::GetInstance() {
+  return &patterns::LazySingleton<DnsResolver>::GetInstance();
+}
+
+bool DnsResolver::FindCachedLocked(const std::string& key, time64_t now, ErrnoError* err, IPAddressList* out) const {
+  const auto it = cache_.find(key);
+  if (it == cache_.end() || it->second.expires_msec <= now) {
+    return false;
+  }
+
+  *err = it->second.err;
+  if (!it->second.err) {
+    *out = it->second.addresses;
+  }
+  return true;
+}
+
+void DnsResolver::StoreLocked(const std::string& key,
+                              ErrnoError err,
+                              const IPAddressList& addresses,
+                              time64_t ttl_msec) {
+  if (ttl_msec <= 0 || options_.max_entries == 0) {
+    cache_.erase(key);
+    return;
+  }
+
+  const time64_t now = time::current_monotonic_mstime();
+  if (cache_.size() >= options_.max_entries && cache_.find(key) == cache_.end()) {
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.expires_msec <= now) {
+        it = cache_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (cache_.size() >= options_.max_entries) {
+      auto oldest = std::min_element(cache_.begin(), cache_.end(), [](const std::pair<const std::string, Entry>& lhs,
+                                                                        const std::pair<const std::string, Entry>& rhs) {
+        return lhs.second.expires_msec < rhs.second.expires_msec;
+      });
+      cache_.erase(oldest);
+    }
+  }
+
+  Entry& entry = cache_[key];
+  entry.err = err;
+  entry.addresses = addresses;
+  entry.expires_msec = now + ttl_msec;
+}
+
+ErrnoError DnsResolver::DoLookup(const std::string& key, IPAddressList* out) {
+  lookup_function_t lookup;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lookup = lookup_;
+  }
+
+  time64_t ttl_msec = -1;
+  IPAddressList addresses;
+  ErrnoError err = lookup ? lookup(key, &addresses, &ttl_msec) : SystemLookup(key, &addresses, &ttl_msec);
+  if (ttl_msec < 0) {
+    ttl_msec = err ? options_.negative_ttl_msec : options_.positive_ttl_msec;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StoreLocked(key, err, addresses, ttl_msec);
+  }
+
+  if (!err) {
+    *out = addresses;
+  }
+  return err;
+}
+
+void DnsResolver::RunLookup(const std::string& key) {
+  IPAddressList addresses;
+  ErrnoError err = DoLookup(key, &addresses);
+
+  waiters_t waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(key);
+    if (it != pending_.end()) {
+      waiters.swap(it->second);
+      pending_.erase(it);
+    }
+  }
+
+  for (const Waiter& waiter : waiters) {
+    Deliver(waiter, err, addresses);
+  }
+}
+
+void DnsResolver::Deliver(const Waiter& waiter, ErrnoError err, const IPAddressList& addresses) {
+  if (!waiter.executor) {
+    waiter.callback(err, addresses);
+    return;
+  }
+
+  resolve_callback_t callback = waiter.callback;
+  waiter.executor([callback, err, addresses]() { callback(err, addresses); });
+}
+
+}  // namespace net
+}  // namespace common
@@ -0,0 +1,201 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/net/file_sender.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(OS_LINUX)
+#include <sys/sendfile.h>
+#elif defined(OS_WIN)
+#include <io.h>  // for _lseeki64
+#endif
+
+#include <algorithm>
+
+#include <common/eintr_wrapper.h>
+#include <common/net/net.h>
+
+namespace common {
+namespace net {
+
+FileSender::FileSender(descriptor_t fd, off_t offset, size_t size)
+    : fd_(fd),
+      size_(size),
+      offset_(offset),
+      sent_(0),
+      regular_(false),
+      eof_(false),
+      waiting_source_(false),
+      pipe_{INVALID_DESCRIPTOR, INVALID_DESCRIPTOR},
+      piped_(0) {
+  struct stat st;
+  regular_ = fd_ != INVALID_DESCRIPTOR && fstat(fd_, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+FileSender::~FileSender() {
+#if defined(OS_LINUX)
+  for (descriptor_t fd : pipe_) {
+    if (fd != INVALID_DESCRIPTOR) {
+      ::close(fd);
+    }
+  }
+#endif
+}
+
+descriptor_t FileSender::GetSource() const {
+  return fd_;
+}
+
+bool FileSender::IsDone() const {
+  return sent_ >= size_ || (eof_ && piped_ == 0);
+}
+
+bool FileSender::IsWaitingForSource() const {
+  return waiting_source_;
+}
+
+size_t FileSender::GetSent() const {
+  return sent_;
+}
+
+size_t FileSender::GetSize() const {
+  return size_;
+}
+
+off_t FileSender::GetOffset() const {
+  return offset_;
+}
+
+ErrnoError FileSender::SendTo(socket_descr_t sock, size_t max_size, size_t* nsent_out) {
+  if (sock == INVALID_SOCKET_VALUE || fd_ == INVALID_DESCRIPTOR || !nsent_out) {
+    return make_error_perror("FileSender::SendTo", EINVAL);
+  }
+
+  *nsent_out = 0;
+  waiting_source_ = false;
+  const size_t count = std::min(max_size, size_ - sent_);
+  if (count == 0 || IsDone()) {
+    return ErrnoError();
+  }
+
+  if (!regular_) {
+    return SpliceTo(sock, count, nsent_out);
+  }
+
+#if defined(OS_LINUX)
+  ssize_t sent = HANDLE_EINTR(sendfile(sock, fd_, &offset_, count));
+  if (sent == ERROR_RESULT_VALUE) {
+    return make_error_perror("sendfile", errno);
+  }
+#else
+  // read from the tracked offset, a short write just gets read again
+  char buffer[16 * 1024];
+#if defined(OS_WIN)
+  if (_lseeki64(fd_, offset_, SEEK_SET) == ERROR_RESULT_VALUE) {
+    return make_error_perror("_lseeki64", errno);
+  }
+  ssize_t nread = read(fd_, buffer, std::min(count, sizeof(buffer)));
+#else
+  ssize_t nread = HANDLE_EINTR(pread(fd_, buffer, std::min(count, sizeof(buffer)), offset_));
+#endif
+  if (nread == ERROR_RESULT_VALUE) {
+    return make_error_perror("read", errno);
+  }
+
+  size_t sent = 0;
+  if (nread > 0) {
+    ErrnoError err = write_to_tcp_socket(sock, buffer, nread, &sent);
+    if (err) {
+      return err;
+    }
+    offset_ += sent;
+  }
+#endif
+
+  if (sent == 0) {
+    eof_ = true;
+    return ErrnoError();
+  }
+
+  sent_ += sent;
+  *nsent_out = sent;
+  return ErrnoError();
+}
+
+ErrnoError FileSender::SpliceTo(socket_descr_t sock, size_t max_size, size_t* nsent_out) {
+#if defined(OS_LINUX)
+  if (pipe_[0] == INVALID_DESCRIPTOR && pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) == ERROR_RESULT_VALUE) {
+    return make_error_perror("pipe2", errno);
+  }
+
+  const size_t left = size_ - sent_;
+  if (!eof_ && piped_ < max_size && piped_ < left) {
+    const size_t count = std::min(max_size, left) - piped_;
+    ssize_t moved = HANDLE_EINTR(splice(fd_, nullptr, pipe_[1], nullptr, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+    if (moved > 0) {
+      piped_ += moved;
+    } else if (moved == 0) {
+      eof_ = true;
+    } else if (errno != EAGAIN) {
+      return make_error_perror("splice", errno);
+    }
+  }
+
+  if (piped_ == 0) {
+    if (eof_) {
+      return ErrnoError();
+    }
+    waiting_source_ = true;
+    return make_error_perror("splice", EAGAIN);
+  }
+
+  ssize_t sent = HANDLE_EINTR(
+      splice(pipe_[0], nullptr, sock, nullptr, std::min(piped_, max_size), SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+  if (sent == ERROR_RESULT_VALUE) {
+    return make_error_perror("splice", errno);
+  }
+
+  piped_ -= sent;
+  sent_ += sent;
+  offset_ += sent;
+  *nsent_out = sent;
+  return ErrnoError();
+#else
+  UNUSED(sock);
+  UNUSED(max_size);
+  UNUSED(nsent_out);
+  return make_error_perror("FileSender::SendTo", ENOTSUP);
+#endif
+}
+
+}  // namespace net
+}  // namespace common
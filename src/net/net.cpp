@@ -46,91 +46,90 @@
 #include <ws2tcpip.h>
 #endif
 
-#if defined(OS_MACOSX) || defined(OS_FREEBSD)
-#include <sys/types.h>
-#include <sys/uio.h>
-#elif defined(OS_LINUX)
-#include <sys/sendfile.h>
-#endif
-
 #if defined(COMPILER_MSVC)
 #include <io.h>
 #endif
 
 #include <common/eintr_wrapper.h>
+#include <common/net/dns_resolver.h>
+#include <common/net/file_sender.h>
 #include <common/sprintf.h>
 
-#if defined(OS_WIN) || defined(OS_ANDROID) || defined(OS_MACOSX) || defined(OS_FREEBSD) || defined(OS_IOS)
-
-#define BUF_SIZE 8192
+namespace common {
+namespace net {
 
 namespace {
 
-ssize_t sendfile(common::net::socket_descr_t out_fd, descriptor_t in_fd, off_t* offset, size_t count) {
-  off_t orig = 0;
-  char buf[BUF_SIZE] = {0};
-
-  if (offset) {
-    /* Save current file offset and set offset to value in '*offset' */
-
-    orig = lseek(in_fd, 0, SEEK_CUR);
-    if (orig == -1) {
-      return ERROR_RESULT_VALUE;
-    }
-    if (lseek(in_fd, *offset, SEEK_SET) == -1) {
-      return ERROR_RESULT_VALUE;
-    }
+void set_peer_info(socket_info* out_info) {
+  const struct addrinfo* ainf = out_info->addr_info();
+  uint16_t port = 0;
+  ErrnoError errn = get_in_port(ainf, &port);
+  if (!errn) {
+    out_info->set_port(port);
   }
+  std::string host;
+  errn = get_in_addr(ainf, &host);
+  if (!errn) {
+    out_info->set_host(host.c_str());
+  }
+}
 
-  ssize_t totSent = 0;
-
-  while (count > 0) {
-    ssize_t num_read = read(in_fd, buf, BUF_SIZE);
-    if (num_read == ERROR_RESULT_VALUE) {
-      return ERROR_RESULT_VALUE;
-    }
-    if (num_read == 0) {
-      break; /* EOF */
-    }
-
-    size_t numSent = 0;
-    common::ErrnoError err = common::net::write_to_tcp_socket(out_fd, buf, static_cast<size_t>(num_read), &numSent);
-    if (err) {
-      return ERROR_RESULT_VALUE;
-    }
-
-    if (numSent == 0) {
-      return ERROR_RESULT_VALUE;
-    }
+enum accept_mode_t { ACCEPT_INHERIT, ACCEPT_BLOCKING, ACCEPT_NONBLOCKING };
 
-    count -= numSent;
-    totSent += numSent;
+// accepted sockets are always close-on-exec, |mode| picks O_NONBLOCK
+ErrnoError do_accept(const socket_info& info, accept_mode_t mode, socket_info* out_info) {
+  socket_descr_t fd = info.fd();
+  if (fd == INVALID_SOCKET_VALUE || !out_info) {
+    return make_error_perror("accept", EINVAL);
   }
 
-  if (offset) {
-    /* Return updated file offset in '*offset', and reset the file offset
-       to the value it had when we were called. */
+  *out_info = info;
+  struct addrinfo* ainf = out_info->addr_info();
+#if defined(OS_POSIX)
+  socklen_t* addr_len = &ainf->ai_addrlen;
+#else
+  int* addr_len = reinterpret_cast<int*>(&ainf->ai_addrlen);
+#endif
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // accept never inherits O_NONBLOCK here, so ACCEPT_INHERIT is blocking too
+  const bool with_flags = true;
+#elif defined(OS_FREEBSD)
+  // accept4 doesn't inherit O_NONBLOCK, unlike accept
+  const bool with_flags = mode != ACCEPT_INHERIT;
+#else
+  const bool with_flags = false;
+#endif
+  int res = ERROR_RESULT_VALUE;
+  if (with_flags) {
+#if defined(OS_LINUX) || defined(OS_ANDROID) || defined(OS_FREEBSD)
+    // the flags come with the socket, no extra fcntl calls
+    res = ::accept4(fd, ainf->ai_addr, addr_len, SOCK_CLOEXEC | (mode == ACCEPT_NONBLOCKING ? SOCK_NONBLOCK : 0));
+#endif
+  } else {
+    res = ::accept(fd, ainf->ai_addr, addr_len);
+  }
+  if (res == ERROR_RESULT_VALUE) {
+    return make_error_perror("accept", errno);
+  }
 
-    *offset = lseek(in_fd, 0, SEEK_CUR);
-    if (*offset == -1) {
-      return ERROR_RESULT_VALUE;
-    }
-    if (lseek(in_fd, orig, SEEK_SET) == -1) {
-      return ERROR_RESULT_VALUE;
+  if (!with_flags) {
+#if defined(OS_POSIX)
+    fcntl(res, F_SETFD, FD_CLOEXEC);
+#endif
+    if (mode != ACCEPT_INHERIT) {
+      ErrnoError err = set_blocking_socket(res, mode == ACCEPT_BLOCKING);
+      if (err) {
+        ignore_result(close(res));
+        return err;
+      }
     }
   }
 
-  return totSent;
+  out_info->set_fd(res);
+  set_peer_info(out_info);
+  return ErrnoError();
 }
 
-}  // namespace
-#endif
-
-namespace common {
-namespace net {
-
-namespace {
-
 template <typename CHAR>
 ErrnoError do_sendto(socket_descr_t fd,
                      const CHAR* data,
@@ -159,7 +158,7 @@ ErrnoError do_sendto(socket_descr_t fd,
   if (res == ERROR_RESULT_VALUE) {
     return make_error_perror("sendto", errno);
   }
-  if (*nwritten_out) {
+  if (nwritten_out) {
     *nwritten_out = res;
   }
   return ErrnoError();
@@ -193,7 +192,7 @@ ErrnoError do_recvfrom(socket_descr_t fd,
   if (res == ERROR_RESULT_VALUE) {
     return make_error_perror("recvfrom", errno);
   }
-  if (*nread_out) {
+  if (nread_out) {
     *nread_out = res;
   }
   return ErrnoError();
@@ -277,58 +276,92 @@ ErrnoError do_connect(socket_descr_t sock, const struct sockaddr* addr, socklen_
   return ErrnoError();
 }
 
-ErrnoError resolve_raw(const char* host, uint16_t port, socket_t socktype, socket_info* out_info) {
+struct addrinfo* make_addrinfo(const IPAddress& address, uint16_t port, int socktype) {
+  struct addrinfo* ainf = alloc_addrinfo();
+  if (!ainf) {
+    return nullptr;
+  }
+
+  if (address.IsIPv4()) {
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    memcpy(&sin.sin_addr, address.bytes().data(), IPAddress::kIPv4AddressSize);
+    ainf->ai_addr = copy_sockaddr(reinterpret_cast<const struct sockaddr*>(&sin), sizeof(sin));
+    ainf->ai_addrlen = sizeof(sin);
+    ainf->ai_family = AF_INET;
+  } else {
+    struct sockaddr_in6 sin6;
+    memset(&sin6, 0, sizeof(sin6));
+    sin6.sin6_family = AF_INET6;
+    sin6.sin6_port = htons(port);
+    memcpy(&sin6.sin6_addr, address.bytes().data(), IPAddress::kIPv6AddressSize);
+    ainf->ai_addr = copy_sockaddr(reinterpret_cast<const struct sockaddr*>(&sin6), sizeof(sin6));
+    ainf->ai_addrlen = sizeof(sin6);
+    ainf->ai_family = AF_INET6;
+  }
+  ainf->ai_socktype = socktype;
+  return ainf;
+}
+
+// Creates a socket for the first usable address of |host|, connecting it for
+// stream sockets when |timeout| is given. Names go through the caching
+// DnsResolver, so repeated connects don't hit the system resolver.
+ErrnoError open_raw(const char* host,
+                    uint16_t port,
+                    socket_t socktype,
+                    bool connect_stream,
+                    struct timeval* timeout,
+                    socket_info* out_info) {
   if (!host || !out_info) {
     return make_error_perror("connect", EINVAL);
   }
 
-  socket_descr_t sfd = INVALID_SOCKET_VALUE;
-
-  struct addrinfo hints, *rp = nullptr;
-  struct addrinfo* result = nullptr;
-  char _port[6];
-  snprintf(_port, sizeof(_port), "%u", port);
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = socket_type_to_native(socktype);
-  hints.ai_flags = AI_PASSIVE; /* For wildcard IP address */
-  hints.ai_protocol = 0;       /* Any protocol */
-  hints.ai_canonname = nullptr;
-  hints.ai_addr = nullptr;
-  hints.ai_next = nullptr;
-
-  int rv = getaddrinfo(host, _port, &hints, &result);
-  if (rv != 0) {
-    return make_error_perror("getaddrinfo", rv);
+  IPAddressList addresses;
+  ErrnoError err = DnsResolver::GetInstance()->ResolveSync(host, &addresses);
+  if (err) {
+    return err;
   }
 
-  for (rp = result; rp != nullptr; rp = rp->ai_next) {
-    if (rp->ai_socktype != socktype) {
+  const int native_type = socket_type_to_native(socktype);
+  err = make_error_perror("getaddrinfo", EADDRNOTAVAIL);
+  for (const IPAddress& address : addresses) {
+    struct addrinfo* ainf = make_addrinfo(address, port, native_type);
+    if (!ainf) {
+      err = make_error_perror("connect", ENOMEM);
       continue;
     }
 
-    sfd = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    socket_descr_t sfd = ::socket(ainf->ai_family, native_type, 0);
     if (sfd == INVALID_SOCKET_VALUE) {
+      err = make_error_perror("socket", errno);
+      freeaddrinfo_ex(&ainf);
       continue;
     }
 
-    break;
-  }
+    if (connect_stream && socktype != ST_SOCK_DGRAM) {
+      err = do_connect(sfd, ainf->ai_addr, ainf->ai_addrlen, timeout);
+      if (err) {
+        ::close(sfd);
+        freeaddrinfo_ex(&ainf);
+        continue;
+      }
+    }
 
-  if (!rp) { /* No address succeeded */
-    int err = errno;
-    DCHECK(err) << "Errno(" << err << ") should be not zero!";
-    freeaddrinfo(result); /* No longer needed */
-    return make_error_perror("getaddrinfo", err);
+    out_info->set_addrinfo(ainf);
+    out_info->set_fd(sfd);
+    out_info->set_host(host);
+    out_info->set_port(port);
+    freeaddrinfo_ex(&ainf);
+    return ErrnoError();
   }
 
-  out_info->set_addrinfo(rp);
-  out_info->set_fd(sfd);
-  out_info->set_host(host);
-  out_info->set_port(port);
+  return err;
+}
 
-  freeaddrinfo(result); /* No longer needed */
-  return ErrnoError();
+ErrnoError resolve_raw(const char* host, uint16_t port, socket_t socktype, socket_info* out_info) {
+  return open_raw(host, port, socktype, false, nullptr, out_info);
 }
 
 ErrnoError connect_raw(const char* host,
@@ -336,65 +369,7 @@ ErrnoError connect_raw(const char* host,
                        socket_t socktype,
                        struct timeval* timeout,
                        socket_info* out_info) {
-  if (!host || !out_info) {
-    return make_error_perror("connect", EINVAL);
-  }
-
-  socket_descr_t sfd = INVALID_SOCKET_VALUE;
-
-  struct addrinfo hints, *rp = nullptr;
-  struct addrinfo* result = nullptr;
-  char _port[6];
-  snprintf(_port, sizeof(_port), "%u", port);
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = socket_type_to_native(socktype);
-  hints.ai_flags = AI_PASSIVE; /* For wildcard IP address */
-  hints.ai_protocol = 0;       /* Any protocol */
-  hints.ai_canonname = nullptr;
-  hints.ai_addr = nullptr;
-  hints.ai_next = nullptr;
-  int rv = getaddrinfo(host, _port, &hints, &result);
-  if (rv != 0) {
-    return make_error_perror("getaddrinfo", rv);
-  }
-
-  for (rp = result; rp != nullptr; rp = rp->ai_next) {
-    if (rp->ai_socktype != socktype) {
-      continue;
-    }
-
-    sfd = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-    if (sfd == INVALID_SOCKET_VALUE) {
-      continue;
-    }
-
-    if (socktype == ST_SOCK_DGRAM) {
-      break; /* Success */
-    }
-
-    ErrnoError err = do_connect(sfd, rp->ai_addr, rp->ai_addrlen, timeout);
-    if (!err) {
-      break;
-    }
-
-    ::close(sfd);
-  }
-
-  if (!rp) { /* No address succeeded */
-    int err = errno;
-    CHECK(err) << "Errno(" << err << ") should be not zero!";
-    freeaddrinfo(result); /* No longer needed */
-    return make_error_perror("getaddrinfo", err);
-  }
-
-  out_info->set_addrinfo(rp);
-  out_info->set_fd(sfd);
-  out_info->set_host(host);
-  out_info->set_port(port);
-
-  freeaddrinfo(result); /* No longer needed */
-  return ErrnoError();
+  return open_raw(host, port, socktype, true, timeout, out_info);
 }
 
 }  // namespace
@@ -533,9 +508,16 @@ ErrnoError listen(const socket_info& info, int backlog) {
 }
 
 ErrnoError accept(const socket_info& info, socket_info* out_info) {
-  socket_descr_t fd = info.fd();
+  return do_accept(info, ACCEPT_INHERIT, out_info);
+}
+
+ErrnoError accept(const socket_info& info, bool nonblocking, socket_info* out_info) {
+  return do_accept(info, nonblocking ? ACCEPT_NONBLOCKING : ACCEPT_BLOCKING, out_info);
+}
+
+ErrnoError accepted(const socket_info& info, socket_descr_t fd, socket_info* out_info) {
   if (fd == INVALID_SOCKET_VALUE || !out_info) {
-    return make_error_perror("accept", EINVAL);
+    return make_error_perror("getpeername", EINVAL);
   }
 
   *out_info = info;
@@ -545,22 +527,12 @@ ErrnoError accept(const socket_info& info, socket_info* out_info) {
 #else
   int* addr_len = reinterpret_cast<int*>(&ainf->ai_addrlen);
 #endif
-  int res = ::accept(fd, ainf->ai_addr, addr_len);
-  if (res == ERROR_RESULT_VALUE) {
-    return make_error_perror("accept", errno);
+  out_info->set_fd(fd);
+  if (::getpeername(fd, ainf->ai_addr, addr_len) == ERROR_RESULT_VALUE) {
+    return make_error_perror("getpeername", errno);
   }
 
-  out_info->set_fd(res);
-  uint16_t port = 0;
-  ErrnoError errn = get_in_port(ainf, &port);
-  if (!errn) {
-    out_info->set_port(port);
-  }
-  std::string host;
-  errn = get_in_addr(ainf, &host);
-  if (!errn) {
-    out_info->set_host(host.c_str());
-  }
+  set_peer_info(out_info);
   return ErrnoError();
 }
 
@@ -607,6 +579,67 @@ ErrnoError connect(const socket_info& info, struct timeval* timeout, socket_info
   return ErrnoError();
 }
 
+ErrnoError connect_nonblock(const IPAddress& address,
+                            uint16_t port,
+                            socket_t socktype,
+                            socket_info* out_info,
+                            bool* in_progress) {
+  if (!address.IsValid() || !out_info || !in_progress) {
+    return make_error_perror("connect_nonblock", EINVAL);
+  }
+
+  const int native_type = socket_type_to_native(socktype);
+  struct addrinfo* ainf = make_addrinfo(address, port, native_type);
+  if (!ainf) {
+    return make_error_perror("connect_nonblock", ENOMEM);
+  }
+
+  socket_descr_t sfd = ::socket(ainf->ai_family, native_type, 0);
+  if (sfd == INVALID_SOCKET_VALUE) {
+    freeaddrinfo_ex(&ainf);
+    return make_error_perror("socket", errno);
+  }
+
+  ErrnoError err = set_blocking_socket(sfd, false);
+  if (err) {
+    ::close(sfd);
+    freeaddrinfo_ex(&ainf);
+    return err;
+  }
+
+  bool pending = false;
+  if (::connect(sfd, ainf->ai_addr, ainf->ai_addrlen) == ERROR_RESULT_VALUE) {
+    if (errno != EINPROGRESS) {
+      err = make_error_perror("connect", errno);
+      ::close(sfd);
+      freeaddrinfo_ex(&ainf);
+      return err;
+    }
+    pending = true;
+  }
+
+  out_info->set_addrinfo(ainf);
+  out_info->set_fd(sfd);
+  out_info->set_host(address.ToString().c_str());
+  out_info->set_port(port);
+  freeaddrinfo_ex(&ainf);
+  *in_progress = pending;
+  return ErrnoError();
+}
+
+ErrnoError get_connect_result(socket_descr_t fd) {
+  int so_error = 0;
+  socklen_t errlen = sizeof(so_error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&so_error), &errlen) == ERROR_RESULT_VALUE) {
+    return make_error_perror("getsockopt", errno);
+  }
+
+  if (so_error) {
+    return make_error_perror("connect", so_error);
+  }
+  return ErrnoError();
+}
+
 ErrnoError close(socket_descr_t fd) {
   if (fd == INVALID_SOCKET_VALUE) {
     return ErrnoError();
@@ -654,6 +687,20 @@ ErrnoError set_blocking_socket(socket_descr_t sock, bool blocking) {
 }
 
 #if defined(OS_POSIX)
+ErrnoError is_blocking_socket(socket_descr_t sock, bool* blocking) {
+  if (!blocking) {
+    return make_error_perror("is_blocking_socket", EINVAL);
+  }
+
+  int opts = fcntl(sock, F_GETFL);
+  if (opts < 0) {
+    return make_error_perror("fcntl(F_GETFL)", errno);
+  }
+
+  *blocking = !(opts & O_NONBLOCK);
+  return ErrnoError();
+}
+
 ErrnoError write_ev_to_socket(socket_descr_t fd, const struct iovec* iovec, int count, size_t* nwritten_out) {
   if (fd == INVALID_SOCKET_VALUE || !iovec || count <= 0 || !nwritten_out) {
     return make_error_perror("write_ev_to_socket", EINVAL);
@@ -804,17 +851,35 @@ ErrnoError send_file_to_fd(socket_descr_t sock, descriptor_t fd, off_t offset, s
     return make_error_perror("send_file_to_fd", EINVAL);
   }
 
-  for (size_t size_to_send = size; size_to_send > 0;) {
-    off_t off = offset;
-    ssize_t sent = sendfile(sock, fd, &off, size_to_send);
-    if (sent == ERROR_RESULT_VALUE) {
-      return make_error_perror("sendfile", errno);
-    } else if (sent == 0) {
-      return ErrnoError();
+  FileSender sender(fd, offset, size);
+  while (!sender.IsDone()) {
+    size_t sent = 0;
+    ErrnoError err = sender.SendTo(sock, size, &sent);
+    if (err && err->GetErrorCode() == EAGAIN) {
+#if defined(OS_POSIX)
+      // non-blocking socket or source: wait instead of spinning
+      struct pollfd pfd;
+      pfd.fd = sender.IsWaitingForSource() ? fd : sock;
+      pfd.events = sender.IsWaitingForSource() ? POLLIN : POLLOUT;
+      pfd.revents = 0;
+      if (HANDLE_EINTR(poll(&pfd, 1, -1)) == ERROR_RESULT_VALUE) {
+        return make_error_perror("poll", errno);
+      }
+#else
+      // only regular files are sent here, so it is always the socket that is full
+      fd_set wfds;
+      FD_ZERO(&wfds);
+      FD_SET(sock, &wfds);
+      if (select(sock + 1, nullptr, &wfds, nullptr, nullptr) == ERROR_RESULT_VALUE) {
+        return make_error_perror("select", errno);
+      }
+#endif
+      continue;
     }
 
-    offset += sent;
-    size_to_send -= sent;
+    if (err) {
+      return err;
+    }
   }
 
   return ErrnoError();
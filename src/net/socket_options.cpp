@@ -0,0 +1,135 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/net/socket_options.h>
+
+#include <errno.h>
+
+#if defined(OS_POSIX)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+
+namespace common {
+namespace net {
+
+namespace {
+
+ErrnoError set_int_option(socket_descr_t fd, int level, int name, int value) {
+  if (setsockopt(fd, level, name, reinterpret_cast<const char*>(&value), sizeof(value)) == ERROR_RESULT_VALUE) {
+    return make_error_perror("setsockopt", errno);
+  }
+  return ErrnoError();
+}
+
+}  // namespace
+
+TcpSocketOptions::TcpSocketOptions()
+    : no_delay(false),
+      keep_alive(false),
+      keep_alive_idle_sec(0),
+      keep_alive_interval_sec(0),
+      keep_alive_count(0),
+      send_buffer_size(0),
+      receive_buffer_size(0) {}
+
+ErrnoError apply_tcp_socket_options(socket_descr_t fd, const TcpSocketOptions& options) {
+  if (fd == INVALID_SOCKET_VALUE) {
+    return make_error_perror("apply_tcp_socket_options", EINVAL);
+  }
+
+  ErrnoError err;
+  if (options.no_delay) {
+    err = set_int_option(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    if (err) {
+      return err;
+    }
+  }
+
+  if (options.keep_alive) {
+    err = set_int_option(fd, SOL_SOCKET, SO_KEEPALIVE, 1);
+    if (err) {
+      return err;
+    }
+#if defined(TCP_KEEPIDLE)
+    if (options.keep_alive_idle_sec > 0) {
+      err = set_int_option(fd, IPPROTO_TCP, TCP_KEEPIDLE, options.keep_alive_idle_sec);
+      if (err) {
+        return err;
+      }
+    }
+#elif defined(TCP_KEEPALIVE)
+    if (options.keep_alive_idle_sec > 0) {
+      err = set_int_option(fd, IPPROTO_TCP, TCP_KEEPALIVE, options.keep_alive_idle_sec);
+      if (err) {
+        return err;
+      }
+    }
+#endif
+#if defined(TCP_KEEPINTVL)
+    if (options.keep_alive_interval_sec > 0) {
+      err = set_int_option(fd, IPPROTO_TCP, TCP_KEEPINTVL, options.keep_alive_interval_sec);
+      if (err) {
+        return err;
+      }
+    }
+#endif
+#if defined(TCP_KEEPCNT)
+    if (options.keep_alive_count > 0) {
+      err = set_int_option(fd, IPPROTO_TCP, TCP_KEEPCNT, options.keep_alive_count);
+      if (err) {
+        return err;
+      }
+    }
+#endif
+  }
+
+  if (options.send_buffer_size > 0) {
+    err = set_int_option(fd, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size);
+    if (err) {
+      return err;
+    }
+  }
+
+  if (options.receive_buffer_size > 0) {
+    err = set_int_option(fd, SOL_SOCKET, SO_RCVBUF, options.receive_buffer_size);
+    if (err) {
+      return err;
+    }
+  }
+
+  return ErrnoError();
+}
+
+}  // namespace net
+}  // namespace common
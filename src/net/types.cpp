@@ -32,6 +32,7 @@
 #include <algorithm>
 
 #include <common/convert2string.h>  // for ConvertFromString
+#include <common/hash/fast_hash.h>
 
 namespace {
 const char kLocalhostText[] = "localhost";
@@ -141,6 +142,11 @@ void HostAndPort::SetPort(port_t port) {
   port_ = port;
 }
 
+size_t HostAndPort::Hash() const {
+  // the port seeds the hash so equal hosts on different ports spread apart
+  return static_cast<size_t>(hash::FastHash64(host_.data(), host_.size(), port_));
+}
+
 HostAndPortAndSlot::HostAndPortAndSlot() : HostAndPort(), slot_(0) {}
 
 HostAndPortAndSlot::HostAndPortAndSlot(const std::string& host, uint16_t port, uint16_t slot)
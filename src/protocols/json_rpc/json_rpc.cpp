@@ -33,6 +33,8 @@
 #include <json-c/json_tokener.h>
 
 #include <common/convert2string.h>
+#include <common/serializer/json_reader.h>
+#include <common/serializer/json_writer.h>
 #include <common/sprintf.h>
 #include <common/system_info/system_info.h>  // for SystemInfo, etc
 
@@ -51,6 +53,35 @@ namespace protocols {
 namespace json_rpc {
 
 namespace {
+// strings come back unescaped; objects, arrays and numbers as their exact source text, not
+// re-serialized the way json_object_get_string does it ({"a":1} stays {"a":1}, not { "a": 1 })
+std::string GetValueString(const serializer::JsonValue& value) {
+  std::string result;
+  if (value.GetType() == serializer::JSON_TYPE_STRING) {
+    ignore_result(value.GetString(&result));
+    return result;
+  }
+
+  return value.GetRaw().as_string();
+}
+
+// embeds data as is when it is json (except null), otherwise as a string
+void WriteJsonOrString(serializer::JsonWriter* writer, const std::string& data) {
+  if (data.empty()) {
+    writer->Null();
+    return;
+  }
+
+  serializer::JsonValue parsed;
+  Error err = serializer::ParseJson(data, &parsed);
+  if (!err && !parsed.IsNull()) {
+    writer->RawValue(data);
+    return;
+  }
+
+  writer->String(data);
+}
+
 Error GetJsonRPCRequest(json_object* rpc, JsonRPCRequest* result) {
   if (!rpc || !result) {
     DNOTREACHED();
@@ -156,6 +187,121 @@ Error GetJsonRPCResponse(json_object* rpc, JsonRPCResponse* result) {
   return Error();
 }
 
+Error GetJsonRPCRequest(const serializer::JsonValue& rpc, JsonRPCRequest* result) {
+  if (!result) {
+    DNOTREACHED();
+    return make_error_inval();
+  }
+
+  if (!rpc.HasField(JSONRPC_FIELD)) {
+    return make_error_inval();
+  }
+
+  JsonRPCRequest res;
+  serializer::JsonValue jid;
+  Error err = rpc.GetField(JSONRPC_ID_FIELD, &jid);
+  if (!err) {
+    if (jid.IsNull()) {
+      res.id = null_json_rpc_id;
+    } else {
+      res.id = GetValueString(jid);
+    }
+  }
+
+  serializer::JsonValue jmethod;
+  err = rpc.GetField(JSONRPC_METHOD_FIELD, &jmethod);
+  if (err) {
+    return make_error_inval();
+  }
+
+  serializer::JsonValue jparams;
+  err = rpc.GetField(JSONRPC_PARAMS_FIELD, &jparams);
+  if (!err) {
+    if (jparams.IsNull()) {
+      res.params = std::string();
+    } else {
+      res.params = GetValueString(jparams);
+    }
+  }
+
+  res.method = GetValueString(jmethod);
+  *result = res;
+  return Error();
+}
+
+Error GetJsonRPCResponse(const serializer::JsonValue& rpc, JsonRPCResponse* result) {
+  if (!result) {
+    DNOTREACHED();
+    return make_error_inval();
+  }
+
+  if (!rpc.HasField(JSONRPC_FIELD)) {
+    return make_error_inval();
+  }
+
+  serializer::JsonValue jid;
+  Error err = rpc.GetField(JSONRPC_ID_FIELD, &jid);
+  if (err) {
+    return make_error_inval();
+  }
+
+  JsonRPCResponse res;
+  if (jid.IsNull()) {
+    res.id = null_json_rpc_id;
+  } else {
+    res.id = GetValueString(jid);
+  }
+
+  serializer::JsonValue jerror;
+  err = rpc.GetField(JSONRPC_ERROR_FIELD, &jerror);
+  if (!err && !jerror.IsNull()) {
+    serializer::JsonValue jerror_code;
+    serializer::JsonValue jerror_message;
+    if (jerror.HasField(JSONRPC_ERROR_CODE_FIELD) && jerror.HasField(JSONRPC_ERROR_MESSAGE_FIELD)) {
+      ignore_result(jerror.GetField(JSONRPC_ERROR_CODE_FIELD, &jerror_code));
+      ignore_result(jerror.GetField(JSONRPC_ERROR_MESSAGE_FIELD, &jerror_message));
+      int code = 0;
+      ignore_result(jerror_code.GetInt(&code));
+      JsonRPCError jerr = {GetValueString(jerror_message), static_cast<JsonRPCErrorCode>(code)};
+      res.error = jerr;
+      *result = res;
+      return Error();
+    }
+
+    JsonRPCError jerr = {GetValueString(jerror), JSON_RPC_NOT_RFC_ERROR};
+    res.error = jerr;
+    *result = res;
+    return Error();
+  }
+
+  serializer::JsonValue jresult;
+  err = rpc.GetField(JSONRPC_RESULT_FIELD, &jresult);
+  if (err) {
+    return make_error_inval();
+  }
+
+  JsonRPCMessage msg;
+  msg.result = jresult.IsNull() ? std::string() : GetValueString(jresult);
+  res.message = msg;
+  *result = res;
+  return Error();
+}
+
+Error ParseRoot(const std::string& data, serializer::JsonValue* root) {
+  if (data.empty()) {
+    return make_error_inval();
+  }
+
+  Error err = serializer::ParseJson(data, root);
+  if (err) {
+    return err;
+  }
+
+  if (root->GetType() != serializer::JSON_TYPE_OBJECT) {
+    return make_error_inval();
+  }
+  return Error();
+}
 }  // namespace
 
 Error MakeJsonRPCRequest(const JsonRPCRequest& request, struct json_object** out_json) {
@@ -187,18 +333,28 @@ Error MakeJsonRPCRequest(const JsonRPCRequest& request, struct json_object** out
 }
 
 Error MakeJsonRPCRequest(const JsonRPCRequest& request, std::string* out_json) {
-  if (!out_json) {
+  if (!request.IsValid() || !out_json) {
     return make_error_inval();
   }
 
-  struct json_object* jres = nullptr;
-  Error err = MakeJsonRPCRequest(request, &jres);
-  if (err) {
-    return err;
+  std::string result;
+  serializer::JsonWriter writer(&result);
+  writer.StartObject();
+  writer.Key(JSONRPC_FIELD);
+  writer.String(JSONRPC_VERSION);
+  writer.Key(JSONRPC_METHOD_FIELD);
+  writer.String(request.method);
+  if (request.id) {
+    writer.Key(JSONRPC_ID_FIELD);
+    writer.String(*request.id);
   }
+  if (request.params) {
+    writer.Key(JSONRPC_PARAMS_FIELD);
+    WriteJsonOrString(&writer, *request.params);
+  }
+  writer.EndObject();
 
-  *out_json = json_object_get_string(jres);
-  json_object_put(jres);
+  *out_json = std::move(result);
   return Error();
 }
 
@@ -211,19 +367,17 @@ Error ParseJsonRPCResponse(struct json_object* data, JsonRPCResponse* result) {
 }
 
 Error ParseJsonRPCResponse(const std::string& data, JsonRPCResponse* result) {
-  if (data.empty() || !result) {
+  if (!result) {
     return make_error_inval();
   }
 
-  const char* data_ptr = data.c_str();
-  json_object* jdata = json_tokener_parse(data_ptr);
-  if (!jdata) {
-    return make_error_inval();
+  serializer::JsonValue root;
+  Error err = ParseRoot(data, &root);
+  if (err) {
+    return err;
   }
 
-  Error err = ParseJsonRPCResponse(jdata, result);
-  json_object_put(jdata);
-  return err;
+  return GetJsonRPCResponse(root, result);
 }
 
 Error MakeJsonRPCResponse(const JsonRPCResponse& response, struct json_object** out_json) {
@@ -262,18 +416,34 @@ Error MakeJsonRPCResponse(const JsonRPCResponse& response, struct json_object**
 }
 
 Error MakeJsonRPCResponse(const JsonRPCResponse& response, std::string* out_json) {
-  if (!out_json) {
+  if (!response.IsValid() || !out_json) {
     return make_error_inval();
   }
 
-  struct json_object* jres = nullptr;
-  Error err = MakeJsonRPCResponse(response, &jres);
-  if (err) {
-    return err;
+  std::string result;
+  serializer::JsonWriter writer(&result);
+  writer.StartObject();
+  writer.Key(JSONRPC_FIELD);
+  writer.String(JSONRPC_VERSION);
+  writer.Key(JSONRPC_ID_FIELD);
+  writer.String(*response.id);
+  if (response.IsError()) {
+    writer.Key(JSONRPC_ERROR_FIELD);
+    writer.StartObject();
+    writer.Key(JSONRPC_ERROR_MESSAGE_FIELD);
+    writer.String(response.error->message);
+    writer.Key(JSONRPC_ERROR_CODE_FIELD);
+    writer.Int(response.error->code);
+    writer.EndObject();
+  } else if (response.IsMessage()) {
+    writer.Key(JSONRPC_RESULT_FIELD);
+    WriteJsonOrString(&writer, response.message->result);
+  } else {
+    NOTREACHED();
   }
+  writer.EndObject();
 
-  *out_json = json_object_get_string(jres);
-  json_object_put(jres);
+  *out_json = std::move(result);
   return Error();
 }
 
@@ -286,49 +456,44 @@ Error ParseJsonRPCRequest(struct json_object* data, JsonRPCRequest* result) {
 }
 
 Error ParseJsonRPCRequest(const std::string& data, JsonRPCRequest* result) {
-  if (data.empty() || !result) {
+  if (!result) {
     return make_error_inval();
   }
 
-  const char* data_ptr = data.c_str();
-  json_object* jdata = json_tokener_parse(data_ptr);
-  if (!jdata) {
-    return make_error_inval();
+  serializer::JsonValue root;
+  Error err = ParseRoot(data, &root);
+  if (err) {
+    return err;
   }
 
-  Error err = ParseJsonRPCRequest(jdata, result);
-  json_object_put(jdata);
-  return err;
+  return GetJsonRPCRequest(root, result);
 }
 
 Error ParseJsonRPC(const std::string& data, JsonRPCRequest** result_req, JsonRPCResponse** result_resp) {
-  if (data.empty() || !result_req || !result_resp) {
+  if (!result_req || !result_resp) {
     return make_error_inval();
   }
 
-  const char* data_ptr = data.c_str();
-  json_object* jdata = json_tokener_parse(data_ptr);
-  if (!jdata) {
-    return make_error_inval();
+  serializer::JsonValue root;
+  Error err = ParseRoot(data, &root);
+  if (err) {
+    return err;
   }
 
   JsonRPCRequest lresult_req;
-  Error err = GetJsonRPCRequest(jdata, &lresult_req);
+  err = GetJsonRPCRequest(root, &lresult_req);
   if (!err) {
     *result_req = new JsonRPCRequest(lresult_req);
-    json_object_put(jdata);
     return Error();
   }
 
   JsonRPCResponse lresult_resp;
-  err = GetJsonRPCResponse(jdata, &lresult_resp);
+  err = GetJsonRPCResponse(root, &lresult_resp);
   if (!err) {
     *result_resp = new JsonRPCResponse(lresult_resp);
-    json_object_put(jdata);
     return Error();
   }
 
-  json_object_put(jdata);
   return err;
 }
 
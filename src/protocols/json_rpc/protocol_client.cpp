@@ -14,10 +14,13 @@
 
 #include <common/protocols/json_rpc/protocol_client.h>
 
+#include <algorithm>
+#include <memory>
 #include <string>
 
 #include <common/sprintf.h>
 #include <common/sys_byteorder.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 namespace protocols {
@@ -105,9 +108,63 @@ ErrnoError ReadMessage(libev::IoClient* client, char* out, protocoled_size_t siz
 
   return ErrnoError();
 }
+
+ErrnoError ReadStreamMessage(libev::IoClient* client, IEDcoder* compressor, protocoled_size_t size, std::string* out) {
+  IEDcoderStream* stream = nullptr;
+  Error dec_err = compressor->CreateDecodeStream(&stream);
+  if (dec_err) {
+    return make_errno_error(dec_err->GetDescription(), EINVAL);
+  }
+
+  const std::unique_ptr<IEDcoderStream> stream_holder(stream);
+  char_buffer_t chunk;
+  chunk.resize(std::min<protocoled_size_t>(size, DEFAULT_STREAM_CHUNK_SIZE));
+  char_buffer_t un_compressed;
+  while (size) {
+    const protocoled_size_t chunk_size = std::min<protocoled_size_t>(size, DEFAULT_STREAM_CHUNK_SIZE);
+    ErrnoError err = ReadMessage(client, chunk.data(), chunk_size);
+    if (err) {
+      return err;
+    }
+
+    size -= chunk_size;
+    if (!dec_err) {  // on error keep reading, the next command starts after this body
+      dec_err = stream->Update(StringPiece(chunk.data(), chunk_size), &un_compressed);
+    }
+  }
+
+  if (!dec_err) {
+    dec_err = stream->Finish(&un_compressed);
+  }
+  if (dec_err) {
+    return make_errno_error(dec_err->GetDescription(), EINVAL);
+  }
+
+  *out = un_compressed.as_string();
+  return ErrnoError();
+}
+
+Error EncodeMessage(IEDcoder* compressor, const std::string& message, bool stream_coding, char_buffer_t* out) {
+  if (!stream_coding) {
+    return compressor->Encode(message, out);
+  }
+
+  IEDcoderStream* stream = nullptr;
+  Error err = compressor->CreateEncodeStream(&stream);
+  if (err) {
+    return err;
+  }
+
+  err = stream->Update(message, out);
+  if (!err) {
+    err = stream->Finish(out);
+  }
+  delete stream;
+  return err;
+}
 }  // namespace
 
-ErrnoError ReadCommand(libev::IoClient* client, IEDcoder* compressor, std::string* out) {
+ErrnoError ReadCommand(libev::IoClient* client, IEDcoder* compressor, std::string* out, bool stream_coding) {
   if (!client || !compressor || !out) {
     return make_errno_error_inval();
   }
@@ -123,6 +180,10 @@ ErrnoError ReadCommand(libev::IoClient* client, IEDcoder* compressor, std::strin
     return make_errno_error(MemSPrintf("Reached limit of command size: %u", message_size), EAGAIN);
   }
 
+  if (stream_coding) {
+    return ReadStreamMessage(client, compressor, message_size, out);
+  }
+
   char* msg = static_cast<char*>(malloc(message_size));
   err = ReadMessage(client, msg, message_size);
   if (err) {
@@ -142,13 +203,16 @@ ErrnoError ReadCommand(libev::IoClient* client, IEDcoder* compressor, std::strin
   return ErrnoError();
 }
 
-ErrnoError WriteMessage(libev::IoClient* client, IEDcoder* compressor, const std::string& message) {
+ErrnoError WriteMessage(libev::IoClient* client,
+                        IEDcoder* compressor,
+                        const std::string& message,
+                        bool stream_coding) {
   if (!client || !compressor || message.empty()) {
     return make_errno_error_inval();
   }
 
   char_buffer_t compressed;
-  Error enc_err = compressor->Encode(message, &compressed);
+  Error enc_err = EncodeMessage(compressor, message, stream_coding, &compressed);
   if (enc_err) {
     return make_errno_error(enc_err->GetDescription(), EINVAL);
   }
@@ -171,22 +235,28 @@ ErrnoError WriteMessage(libev::IoClient* client, IEDcoder* compressor, const std
   return err;
 }
 
-ErrnoError WriteRequest(libev::IoClient* client, IEDcoder* compressor, const JsonRPCRequest& request) {
+ErrnoError WriteRequest(libev::IoClient* client,
+                        IEDcoder* compressor,
+                        const JsonRPCRequest& request,
+                        bool stream_coding) {
   std::string request_str;
   Error err = protocols::json_rpc::MakeJsonRPCRequest(request, &request_str);
   if (err) {
     return make_errno_error(err->GetDescription(), err->GetErrorCode());
   }
-  return WriteMessage(client, compressor, request_str);
+  return WriteMessage(client, compressor, request_str, stream_coding);
 }
 
-ErrnoError WriteResponse(libev::IoClient* client, IEDcoder* compressor, const JsonRPCResponse& response) {
+ErrnoError WriteResponse(libev::IoClient* client,
+                         IEDcoder* compressor,
+                         const JsonRPCResponse& response,
+                         bool stream_coding) {
   std::string resp;
   Error err = protocols::json_rpc::MakeJsonRPCResponse(response, &resp);
   if (err) {
     return make_errno_error(err->GetDescription(), err->GetErrorCode());
   }
-  return WriteMessage(client, compressor, resp);
+  return WriteMessage(client, compressor, resp, stream_coding);
 }
 
 }  // namespace detail
@@ -0,0 +1,610 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/serializer/binary_serializer.h>
+
+#include <string.h>
+
+#include <memory>
+#include <utility>
+
+#include <common/sprintf.h>
+#include <common/sys_byteorder.h>
+
+namespace common {
+namespace {
+Error make_unexpected_end() {
+  return make_error("Unexpected end of binary data");
+}
+Error make_unsupported_type(Value::Type type) {
+  return Error(MemSPrintf("Unsupported value type: %d", static_cast<int>(type)));
+}
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+}  // namespace
+namespace serializer {
+
+ValueBinaryWriter::ValueBinaryWriter(buffer_t* out) : out_(out) {
+  DCHECK(out_);
+}
+
+void ValueBinaryWriter::WriteType(Value::Type type) {
+  out_->push_back(static_cast<byte_t>(type));
+}
+
+void ValueBinaryWriter::WriteBool(bool value) {
+  out_->push_back(value ? 1 : 0);
+}
+
+void ValueBinaryWriter::WriteVarUInt(uint64_t value) {
+  byte_t buff[10];
+  size_t size = 0;
+  while (value >= 0x80) {
+    buff[size++] = static_cast<byte_t>(value | 0x80);
+    value >>= 7;
+  }
+  buff[size++] = static_cast<byte_t>(value);
+  WriteRaw(buff, size);
+}
+
+void ValueBinaryWriter::WriteVarInt(int64_t value) {
+  WriteVarUInt(ZigZagEncode(value));
+}
+
+void ValueBinaryWriter::WriteDouble(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits = HostToNet64(bits);
+  WriteRaw(&bits, sizeof(bits));
+}
+
+void ValueBinaryWriter::WriteRaw(const void* data, size_t size) {
+  out_->append(static_cast<const byte_t*>(data), size);
+}
+
+void ValueBinaryWriter::WriteLengthPrefixed(const void* data, size_t size) {
+  WriteVarUInt(size);
+  WriteRaw(data, size);
+}
+
+ValueBinaryReader::ValueBinaryReader(const byte_t* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+bool ValueBinaryReader::ReadType(Value::Type* type) {
+  if (IsEmpty()) {
+    return false;
+  }
+
+  *type = static_cast<Value::Type>(data_[pos_++]);
+  return true;
+}
+
+bool ValueBinaryReader::ReadBool(bool* value) {
+  if (IsEmpty() || data_[pos_] > 1) {
+    return false;
+  }
+
+  *value = data_[pos_++] == 1;
+  return true;
+}
+
+bool ValueBinaryReader::ReadVarUInt(uint64_t* value) {
+  uint64_t result = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (IsEmpty()) {
+      return false;
+    }
+
+    const byte_t cur = data_[pos_++];
+    if (shift == 63 && (cur & 0x7e)) {  // bits past 64
+      return false;
+    }
+    result |= static_cast<uint64_t>(cur & 0x7f) << shift;
+    if (!(cur & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool ValueBinaryReader::ReadVarInt(int64_t* value) {
+  uint64_t raw;
+  if (!ReadVarUInt(&raw)) {
+    return false;
+  }
+
+  *value = ZigZagDecode(raw);
+  return true;
+}
+
+bool ValueBinaryReader::ReadDouble(double* value) {
+  uint64_t bits;
+  if (GetRemaining() < sizeof(bits)) {
+    return false;
+  }
+
+  memcpy(&bits, data_ + pos_, sizeof(bits));
+  pos_ += sizeof(bits);
+  bits = NetToHost64(bits);
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+bool ValueBinaryReader::ReadLengthPrefixed(span<const byte_t>* value) {
+  uint64_t size;
+  if (!ReadVarUInt(&size) || size > GetRemaining()) {
+    return false;
+  }
+
+  *value = make_span(data_ + pos_, size);
+  pos_ += size;
+  return true;
+}
+
+bool ValueBinaryReader::ReadLengthPrefixed(StringPiece* value) {
+  span<const byte_t> raw;
+  if (!ReadLengthPrefixed(&raw)) {
+    return false;
+  }
+
+  *value = StringPiece(reinterpret_cast<const char*>(raw.data()), raw.size());
+  return true;
+}
+
+ValueBinaryCodec::ValueBinaryCodec() {}
+
+ValueBinaryCodec::~ValueBinaryCodec() {}
+
+Error ValueBinaryCodec::Encode(const Value* value, buffer_t* out) const {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  ValueBinaryWriter writer(out);
+  return Encode(value, &writer);
+}
+
+Error ValueBinaryCodec::Encode(const Value* value, ValueBinaryWriter* writer) const {
+  if (!value || !writer) {
+    return make_error_inval();
+  }
+
+  return EncodeImpl(value, writer, 0);
+}
+
+Error ValueBinaryCodec::Decode(const byte_t* data, size_t size, Value** out) const {
+  if (!data || !out) {
+    return make_error_inval();
+  }
+
+  ValueBinaryReader reader(data, size);
+  Value* result = nullptr;
+  Error err = Decode(&reader, &result);
+  if (err) {
+    return err;
+  }
+
+  if (!reader.IsEmpty()) {
+    delete result;
+    return make_error("Trailing bytes after binary value");
+  }
+
+  *out = result;
+  return Error();
+}
+
+Error ValueBinaryCodec::Decode(const buffer_t& data, Value** out) const {
+  return Decode(data.data(), data.size(), out);
+}
+
+Error ValueBinaryCodec::Decode(ValueBinaryReader* reader, Value** out) const {
+  if (!reader || !out) {
+    return make_error_inval();
+  }
+
+  return DecodeImpl(reader, out, 0);
+}
+
+Error ValueBinaryCodec::EncodeUserValue(const Value* value, buffer_t* payload) const {
+  UNUSED(payload);
+  return make_unsupported_type(value->GetType());
+}
+
+Error ValueBinaryCodec::DecodeUserValue(Value::Type type, span<const byte_t> payload, Value** out) const {
+  UNUSED(payload);
+  UNUSED(out);
+  return make_unsupported_type(type);
+}
+
+Error ValueBinaryCodec::EncodeImpl(const Value* value, ValueBinaryWriter* writer, size_t depth) const {
+  if (depth > max_depth) {
+    return make_error("Binary value nesting too deep");
+  }
+
+  const Value::Type type = value->GetType();
+  if (type >= Value::USER_TYPES) {
+    buffer_t payload;
+    Error err = EncodeUserValue(value, &payload);
+    if (err) {
+      return err;
+    }
+
+    writer->WriteType(type);
+    writer->WriteLengthPrefixed(payload.data(), payload.size());
+    return Error();
+  }
+
+  writer->WriteType(type);
+  switch (type) {
+    case Value::TYPE_NULL:
+      return Error();
+    case Value::TYPE_BOOLEAN: {
+      bool res;
+      if (!value->GetAsBoolean(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteBool(res);
+      return Error();
+    }
+    case Value::TYPE_INTEGER: {
+      int res;
+      if (!value->GetAsInteger(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarInt(res);
+      return Error();
+    }
+    case Value::TYPE_UINTEGER: {
+      unsigned int res;
+      if (!value->GetAsUInteger(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(res);
+      return Error();
+    }
+    case Value::TYPE_LONG_INTEGER: {
+      long res;
+      if (!value->GetAsLongInteger(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarInt(res);
+      return Error();
+    }
+    case Value::TYPE_ULONG_INTEGER: {
+      unsigned long res;
+      if (!value->GetAsULongInteger(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(res);
+      return Error();
+    }
+    case Value::TYPE_LONG_LONG_INTEGER: {
+      long long res;
+      if (!value->GetAsLongLongInteger(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarInt(res);
+      return Error();
+    }
+    case Value::TYPE_ULONG_LONG_INTEGER: {
+      unsigned long long res;
+      if (!value->GetAsULongLongInteger(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(res);
+      return Error();
+    }
+    case Value::TYPE_DOUBLE: {
+      double res;
+      if (!value->GetAsDouble(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteDouble(res);
+      return Error();
+    }
+    case Value::TYPE_TIME: {
+      time_t res;
+      if (!value->GetAsTime(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarInt(res);
+      return Error();
+    }
+    case Value::TYPE_STRING: {
+      StringPiece res;
+      if (!value->GetAsStringPiece(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteLengthPrefixed(res.data(), res.size());
+      return Error();
+    }
+    case Value::TYPE_BYTE_ARRAY: {
+      span<const byte_t> res;
+      if (!value->GetAsByteSpan(&res)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteLengthPrefixed(res.data(), res.size());
+      return Error();
+    }
+    case Value::TYPE_ARRAY: {
+      const ArrayValue* array = nullptr;
+      if (!value->GetAsList(&array)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(array->GetSize());
+      for (auto it = array->begin(); it != array->end(); ++it) {
+        Error err = EncodeImpl(*it, writer, depth + 1);
+        if (err) {
+          return err;
+        }
+      }
+      return Error();
+    }
+    case Value::TYPE_SET: {
+      const SetValue* set = nullptr;
+      if (!value->GetAsSet(&set)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(set->GetSize());
+      for (auto it = set->begin(); it != set->end(); ++it) {
+        Error err = EncodeImpl(*it, writer, depth + 1);
+        if (err) {
+          return err;
+        }
+      }
+      return Error();
+    }
+    case Value::TYPE_ZSET: {
+      const ZSetValue* zset = nullptr;
+      if (!value->GetAsZSet(&zset)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(zset->GetSize());
+      for (auto it = zset->begin(); it != zset->end(); ++it) {
+        Error err = EncodeImpl(it->first, writer, depth + 1);
+        if (err) {
+          return err;
+        }
+        err = EncodeImpl(it->second, writer, depth + 1);
+        if (err) {
+          return err;
+        }
+      }
+      return Error();
+    }
+    case Value::TYPE_HASH: {
+      const HashValue* hash = nullptr;
+      if (!value->GetAsHash(&hash)) {
+        return make_unsupported_type(type);
+      }
+      writer->WriteVarUInt(hash->GetSize());
+      for (auto it = hash->begin(); it != hash->end(); ++it) {
+        writer->WriteLengthPrefixed(it->first.data(), it->first.size());
+        Error err = EncodeImpl(it->second, writer, depth + 1);
+        if (err) {
+          return err;
+        }
+      }
+      return Error();
+    }
+    default:
+      break;
+  }
+
+  return make_unsupported_type(type);
+}
+
+Error ValueBinaryCodec::DecodeImpl(ValueBinaryReader* reader, Value** out, size_t depth) const {
+  if (depth > max_depth) {
+    return make_error("Binary value nesting too deep");
+  }
+
+  Value::Type type;
+  if (!reader->ReadType(&type)) {
+    return make_unexpected_end();
+  }
+
+  if (type >= Value::USER_TYPES) {
+    span<const byte_t> payload;
+    if (!reader->ReadLengthPrefixed(&payload)) {
+      return make_unexpected_end();
+    }
+    return DecodeUserValue(type, payload, out);
+  }
+
+  switch (type) {
+    case Value::TYPE_NULL:
+      *out = Value::CreateNullValue();
+      return Error();
+    case Value::TYPE_BOOLEAN: {
+      bool res;
+      if (!reader->ReadBool(&res)) {
+        return make_unexpected_end();
+      }
+      *out = Value::CreateBooleanValue(res);
+      return Error();
+    }
+    case Value::TYPE_INTEGER:
+    case Value::TYPE_LONG_INTEGER:
+    case Value::TYPE_LONG_LONG_INTEGER:
+    case Value::TYPE_TIME: {
+      int64_t res;
+      if (!reader->ReadVarInt(&res)) {
+        return make_unexpected_end();
+      }
+      if (type == Value::TYPE_INTEGER) {
+        *out = Value::CreateIntegerValue(static_cast<int>(res));
+      } else if (type == Value::TYPE_LONG_INTEGER) {
+        *out = Value::CreateLongIntegerValue(static_cast<long>(res));
+      } else if (type == Value::TYPE_LONG_LONG_INTEGER) {
+        *out = Value::CreateLongLongIntegerValue(static_cast<long long>(res));
+      } else {
+        *out = Value::CreateTimeValue(static_cast<time_t>(res));
+      }
+      return Error();
+    }
+    case Value::TYPE_UINTEGER:
+    case Value::TYPE_ULONG_INTEGER:
+    case Value::TYPE_ULONG_LONG_INTEGER: {
+      uint64_t res;
+      if (!reader->ReadVarUInt(&res)) {
+        return make_unexpected_end();
+      }
+      if (type == Value::TYPE_UINTEGER) {
+        *out = Value::CreateUIntegerValue(static_cast<unsigned int>(res));
+      } else if (type == Value::TYPE_ULONG_INTEGER) {
+        *out = Value::CreateULongIntegerValue(static_cast<unsigned long>(res));
+      } else {
+        *out = Value::CreateULongLongIntegerValue(static_cast<unsigned long long>(res));
+      }
+      return Error();
+    }
+    case Value::TYPE_DOUBLE: {
+      double res;
+      if (!reader->ReadDouble(&res)) {
+        return make_unexpected_end();
+      }
+      *out = Value::CreateDoubleValue(res);
+      return Error();
+    }
+    case Value::TYPE_STRING: {
+      StringPiece res;
+      if (!reader->ReadLengthPrefixed(&res)) {
+        return make_unexpected_end();
+      }
+      *out = Value::CreateStringValue(Value::string_t(res.begin(), res.end()));
+      return Error();
+    }
+    case Value::TYPE_BYTE_ARRAY: {
+      span<const byte_t> res;
+      if (!reader->ReadLengthPrefixed(&res)) {
+        return make_unexpected_end();
+      }
+      *out = Value::CreateByteArrayValue(byte_array_t(res.begin(), res.end()));
+      return Error();
+    }
+    case Value::TYPE_ARRAY:
+    case Value::TYPE_SET: {
+      uint64_t count;
+      // every item takes at least one byte
+      if (!reader->ReadVarUInt(&count) || count > reader->GetRemaining()) {
+        return make_unexpected_end();
+      }
+      std::unique_ptr<ArrayValue> array;
+      std::unique_ptr<SetValue> set;
+      if (type == Value::TYPE_ARRAY) {
+        array.reset(Value::CreateArrayValue());
+        array->Reserve(count);
+      } else {
+        set.reset(Value::CreateSetValue());
+      }
+      for (uint64_t i = 0; i < count; ++i) {
+        Value* item = nullptr;
+        Error err = DecodeImpl(reader, &item, depth + 1);
+        if (err) {
+          return err;
+        }
+        if (array) {
+          array->Append(item);
+        } else {
+          set->Insert(item);
+        }
+      }
+      if (array) {
+        *out = array.release();
+      } else {
+        *out = set.release();
+      }
+      return Error();
+    }
+    case Value::TYPE_ZSET: {
+      uint64_t count;
+      if (!reader->ReadVarUInt(&count) || count > reader->GetRemaining()) {
+        return make_unexpected_end();
+      }
+      std::unique_ptr<ZSetValue> zset(Value::CreateZSetValue());
+      for (uint64_t i = 0; i < count; ++i) {
+        Value* key = nullptr;
+        Error err = DecodeImpl(reader, &key, depth + 1);
+        if (err) {
+          return err;
+        }
+        Value* val = nullptr;
+        err = DecodeImpl(reader, &val, depth + 1);
+        if (err) {
+          delete key;
+          return err;
+        }
+        zset->Insert(key, val);
+      }
+      *out = zset.release();
+      return Error();
+    }
+    case Value::TYPE_HASH: {
+      uint64_t count;
+      if (!reader->ReadVarUInt(&count) || count > reader->GetRemaining()) {
+        return make_unexpected_end();
+      }
+      std::unique_ptr<HashValue> hash(Value::CreateHashValue());
+      hash->Reserve(count);
+      for (uint64_t i = 0; i < count; ++i) {
+        StringPiece key;
+        if (!reader->ReadLengthPrefixed(&key)) {
+          return make_unexpected_end();
+        }
+        Value* val = nullptr;
+        Error err = DecodeImpl(reader, &val, depth + 1);
+        if (err) {
+          return err;
+        }
+        Value::string_t hkey(key.begin(), key.end());
+        if (hash->Find(hkey) || !hash->Insert(std::move(hkey), val)) {
+          delete val;
+          return make_error("Invalid hash key in binary value");
+        }
+      }
+      *out = hash.release();
+      return Error();
+    }
+    default:
+      break;
+  }
+
+  return make_unsupported_type(type);
+}
+
+}  // namespace serializer
+}  // namespace common
@@ -0,0 +1,725 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/serializer/json_reader.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <limits>
+
+#include <common/sprintf.h>
+#include <common/utf_string_conversion_utils.h>
+
+#include "json_scan.h"
+
+namespace common {
+namespace {
+Error make_invalid_type(const char* field) {
+  return Error(MemSPrintf("Invalid type field: %s", field));
+}
+Error make_not_exists_field(const char* field) {
+  return Error(MemSPrintf("Not exists field: %s", field));
+}
+
+inline bool IsJsonSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+const char* SkipSpaces(const char* ptr, const char* end) {
+  while (ptr != end && IsJsonSpace(*ptr)) {
+    ptr++;
+  }
+  return ptr;
+}
+
+// Validation, every function returns the position after the parsed token or nullptr.
+
+const char* ValidateString(const char* ptr, const char* end) {
+  ptr++;  // "
+  while (true) {
+    ptr += serializer::detail::FindJsonStringSpecial(ptr, end - ptr);
+    if (ptr == end) {
+      return nullptr;
+    }
+
+    if (*ptr == '"') {
+      return ptr + 1;
+    }
+
+    if (*ptr != '\\' || ++ptr == end) {
+      return nullptr;
+    }
+
+    switch (*ptr) {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        ptr++;
+        break;
+      case 'u':
+        if (end - ptr < 5) {
+          return nullptr;
+        }
+        for (int i = 1; i < 5; ++i) {
+          if (HexValue(ptr[i]) < 0) {
+            return nullptr;
+          }
+        }
+        ptr += 5;
+        break;
+      default:
+        return nullptr;
+    }
+  }
+}
+
+const char* ValidateDigits(const char* ptr, const char* end) {
+  if (ptr == end || !IsDigit(*ptr)) {
+    return nullptr;
+  }
+  while (ptr != end && IsDigit(*ptr)) {
+    ptr++;
+  }
+  return ptr;
+}
+
+const char* ValidateNumber(const char* ptr, const char* end) {
+  if (*ptr == '-') {
+    ptr++;
+  }
+  if (ptr != end && *ptr == '0') {
+    ptr++;
+  } else {
+    ptr = ValidateDigits(ptr, end);
+    if (!ptr) {
+      return nullptr;
+    }
+  }
+
+  if (ptr != end && *ptr == '.') {
+    ptr = ValidateDigits(ptr + 1, end);
+    if (!ptr) {
+      return nullptr;
+    }
+  }
+
+  if (ptr != end && (*ptr == 'e' || *ptr == 'E')) {
+    ptr++;
+    if (ptr != end && (*ptr == '+' || *ptr == '-')) {
+      ptr++;
+    }
+    ptr = ValidateDigits(ptr, end);
+  }
+  return ptr;
+}
+
+const char* ValidateLiteral(const char* ptr, const char* end, const char* literal, size_t len) {
+  if (static_cast<size_t>(end - ptr) < len || memcmp(ptr, literal, len) != 0) {
+    return nullptr;
+  }
+  return ptr + len;
+}
+
+const char* ValidateValue(const char* ptr, const char* end, size_t depth) {
+  if (ptr == end) {
+    return nullptr;
+  }
+
+  switch (*ptr) {
+    case '{': {
+      if (depth == serializer::max_json_depth) {
+        return nullptr;
+      }
+      ptr = SkipSpaces(ptr + 1, end);
+      if (ptr != end && *ptr == '}') {
+        return ptr + 1;
+      }
+      while (true) {
+        if (ptr == end || *ptr != '"') {
+          return nullptr;
+        }
+        ptr = ValidateString(ptr, end);
+        if (!ptr) {
+          return nullptr;
+        }
+        ptr = SkipSpaces(ptr, end);
+        if (ptr == end || *ptr != ':') {
+          return nullptr;
+        }
+        ptr = ValidateValue(SkipSpaces(ptr + 1, end), end, depth + 1);
+        if (!ptr) {
+          return nullptr;
+        }
+        ptr = SkipSpaces(ptr, end);
+        if (ptr == end) {
+          return nullptr;
+        }
+        if (*ptr == '}') {
+          return ptr + 1;
+        }
+        if (*ptr != ',') {
+          return nullptr;
+        }
+        ptr = SkipSpaces(ptr + 1, end);
+      }
+    }
+    case '[': {
+      if (depth == serializer::max_json_depth) {
+        return nullptr;
+      }
+      ptr = SkipSpaces(ptr + 1, end);
+      if (ptr != end && *ptr == ']') {
+        return ptr + 1;
+      }
+      while (true) {
+        ptr = ValidateValue(ptr, end, depth + 1);
+        if (!ptr) {
+          return nullptr;
+        }
+        ptr = SkipSpaces(ptr, end);
+        if (ptr == end) {
+          return nullptr;
+        }
+        if (*ptr == ']') {
+          return ptr + 1;
+        }
+        if (*ptr != ',') {
+          return nullptr;
+        }
+        ptr = SkipSpaces(ptr + 1, end);
+      }
+    }
+    case '"':
+      return ValidateString(ptr, end);
+    case 't':
+      return ValidateLiteral(ptr, end, "true", 4);
+    case 'f':
+      return ValidateLiteral(ptr, end, "false", 5);
+    case 'n':
+      return ValidateLiteral(ptr, end, "null", 4);
+    default:
+      if (*ptr == '-' || IsDigit(*ptr)) {
+        return ValidateNumber(ptr, end);
+      }
+      return nullptr;
+  }
+}
+
+// Skipping, the text is already validated so only the structure is tracked.
+
+const char* SkipString(const char* ptr, const char* end) {
+  ptr++;  // "
+  while (true) {
+    ptr += serializer::detail::FindJsonStringSpecial(ptr, end - ptr);
+    if (*ptr == '"') {
+      return ptr + 1;
+    }
+    ptr += 2;  // escape, \uXXXX tail has no specials
+  }
+}
+
+const char* SkipValue(const char* ptr, const char* end) {
+  if (*ptr == '"') {
+    return SkipString(ptr, end);
+  }
+
+  if (*ptr == '{' || *ptr == '[') {
+    size_t depth = 0;
+    while (true) {
+      const char c = *ptr;
+      if (c == '"') {
+        ptr = SkipString(ptr, end);
+        continue;
+      }
+      if (c == '{' || c == '[') {
+        depth++;
+      } else if ((c == '}' || c == ']') && --depth == 0) {
+        return ptr + 1;
+      }
+      ptr++;
+    }
+  }
+
+  while (ptr != end && *ptr != ',' && *ptr != '}' && *ptr != ']' && !IsJsonSpace(*ptr)) {
+    ptr++;
+  }
+  return ptr;
+}
+
+serializer::JsonType DetectType(const char* ptr, size_t size) {
+  switch (*ptr) {
+    case '{':
+      return serializer::JSON_TYPE_OBJECT;
+    case '[':
+      return serializer::JSON_TYPE_ARRAY;
+    case '"':
+      return serializer::JSON_TYPE_STRING;
+    case 't':
+    case 'f':
+      return serializer::JSON_TYPE_BOOLEAN;
+    case 'n':
+      return serializer::JSON_TYPE_NULL;
+    default:
+      for (size_t i = 0; i < size; ++i) {
+        if (ptr[i] == '.' || ptr[i] == 'e' || ptr[i] == 'E') {
+          return serializer::JSON_TYPE_DOUBLE;
+        }
+      }
+      return serializer::JSON_TYPE_INT;
+  }
+}
+
+uint32_t ReadHex4(const char* ptr) {
+  return (HexValue(ptr[0]) << 12) | (HexValue(ptr[1]) << 8) | (HexValue(ptr[2]) << 4) | HexValue(ptr[3]);
+}
+
+// Unescapes validated string content (without quotes).
+void UnescapeString(const char* ptr, const char* end, std::string* out) {
+  out->clear();
+  out->reserve(end - ptr);
+  while (ptr != end) {
+    const size_t plain = serializer::detail::FindJsonStringSpecial(ptr, end - ptr);
+    out->append(ptr, plain);
+    ptr += plain;
+    if (ptr == end) {
+      break;
+    }
+
+    ptr++;  // backslash
+    const char c = *ptr++;
+    switch (c) {
+      case 'b':
+        out->push_back('\b');
+        break;
+      case 'f':
+        out->push_back('\f');
+        break;
+      case 'n':
+        out->push_back('\n');
+        break;
+      case 'r':
+        out->push_back('\r');
+        break;
+      case 't':
+        out->push_back('\t');
+        break;
+      case 'u': {
+        uint32_t code_point = ReadHex4(ptr);
+        ptr += 4;
+        if (code_point >= 0xD800 && code_point <= 0xDBFF && end - ptr >= 6 && ptr[0] == '\\' && ptr[1] == 'u') {
+          const uint32_t trail = ReadHex4(ptr + 2);
+          if (trail >= 0xDC00 && trail <= 0xDFFF) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (trail - 0xDC00);
+            ptr += 6;
+          }
+        }
+        if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+          code_point = 0xFFFD;  // unpaired surrogate
+        }
+        WriteUnicodeCharacter(code_point, out);
+        break;
+      }
+      default:  // " \ /
+        out->push_back(c);
+    }
+  }
+}
+
+bool ParseUnsigned(const char* ptr, const char* end, uint64_t* out) {
+  uint64_t result = 0;
+  for (; ptr != end; ++ptr) {
+    const uint64_t digit = *ptr - '0';
+    if (result > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  *out = result;
+  return true;
+}
+}  // namespace
+
+namespace serializer {
+
+JsonValue::JsonValue() : data_(nullptr), size_(0), type_(JSON_TYPE_NULL) {}
+
+JsonValue::JsonValue(const char* data, size_t size, JsonType type) : data_(data), size_(size), type_(type) {}
+
+JsonValue JsonValue::ViewAt(const char* data, const char* end, const char** next) {
+  const char* value_end = SkipValue(data, end);
+  *next = value_end;
+  return JsonValue(data, value_end - data, DetectType(data, value_end - data));
+}
+
+JsonType JsonValue::GetType() const {
+  return type_;
+}
+
+bool JsonValue::IsNull() const {
+  return type_ == JSON_TYPE_NULL;
+}
+
+StringPiece JsonValue::GetRaw() const {
+  return StringPiece(data_, size_);
+}
+
+Error JsonValue::GetString(std::string* out) const {
+  if (!out || type_ != JSON_TYPE_STRING) {
+    return make_error_inval();
+  }
+
+  const char* begin = data_ + 1;
+  const char* end = data_ + size_ - 1;
+  if (detail::FindJsonStringSpecial(begin, end - begin) == static_cast<size_t>(end - begin)) {
+    out->assign(begin, end);
+    return Error();
+  }
+
+  UnescapeString(begin, end, out);
+  return Error();
+}
+
+Error JsonValue::GetBool(bool* out) const {
+  if (!out || type_ != JSON_TYPE_BOOLEAN) {
+    return make_error_inval();
+  }
+
+  *out = data_[0] == 't';
+  return Error();
+}
+
+Error JsonValue::GetInt(int* out) const {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  int64_t result;
+  Error err = GetInt64(&result);
+  if (err) {
+    return err;
+  }
+
+  if (result < std::numeric_limits<int>::min() || result > std::numeric_limits<int>::max()) {
+    return make_error_inval();
+  }
+
+  *out = static_cast<int>(result);
+  return Error();
+}
+
+Error JsonValue::GetInt64(int64_t* out) const {
+  if (!out || type_ != JSON_TYPE_INT) {
+    return make_error_inval();
+  }
+
+  const bool negative = data_[0] == '-';
+  uint64_t magnitude;
+  if (!ParseUnsigned(data_ + negative, data_ + size_, &magnitude)) {
+    return make_error_inval();
+  }
+
+  const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + negative;
+  if (magnitude > limit) {
+    return make_error_inval();
+  }
+
+  *out = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+  return Error();
+}
+
+Error JsonValue::GetUInt64(uint64_t* out) const {
+  if (!out || type_ != JSON_TYPE_INT || data_[0] == '-') {
+    return make_error_inval();
+  }
+
+  if (!ParseUnsigned(data_, data_ + size_, out)) {
+    return make_error_inval();
+  }
+  return Error();
+}
+
+Error JsonValue::GetDouble(double* out) const {
+  if (!out || (type_ != JSON_TYPE_DOUBLE && type_ != JSON_TYPE_INT)) {
+    return make_error_inval();
+  }
+
+  char buff[64];
+  if (size_ < sizeof(buff)) {
+    memcpy(buff, data_, size_);
+    buff[size_] = 0;
+    *out = strtod(buff, nullptr);
+    return Error();
+  }
+
+  const std::string copy(data_, size_);
+  *out = strtod(copy.c_str(), nullptr);
+  return Error();
+}
+
+Error JsonValue::GetArray(std::vector<JsonValue>* out) const {
+  if (!out || type_ != JSON_TYPE_ARRAY) {
+    return make_error_inval();
+  }
+
+  std::vector<JsonValue> result;
+  const char* end = data_ + size_;
+  const char* ptr = SkipSpaces(data_ + 1, end);
+  while (*ptr != ']') {
+    result.push_back(ViewAt(ptr, end, &ptr));
+    ptr = SkipSpaces(ptr, end);
+    if (*ptr == ',') {
+      ptr = SkipSpaces(ptr + 1, end);
+    }
+  }
+
+  *out = std::move(result);
+  return Error();
+}
+
+bool JsonValue::HasField(const StringPiece& field) const {
+  JsonValue unused;
+  return FindField(field, &unused);
+}
+
+Error JsonValue::GetField(const char* field, JsonValue* out) const {
+  if (!field || !out || type_ != JSON_TYPE_OBJECT) {
+    return make_error_inval();
+  }
+
+  if (!FindField(field, out)) {
+    return make_not_exists_field(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetStringField(const char* field, std::string* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetString(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetBoolField(const char* field, bool* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetBool(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetIntField(const char* field, int* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetInt(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetInt64Field(const char* field, int64_t* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetInt64(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetUInt64Field(const char* field, uint64_t* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetUInt64(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetDoubleField(const char* field, double* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetDouble(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetArrayField(const char* field, std::vector<JsonValue>* out) const {
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.GetArray(out)) {
+    return make_invalid_type(field);
+  }
+  return Error();
+}
+
+Error JsonValue::GetObjectField(const char* field, JsonValue* out) const {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  JsonValue value;
+  Error err = GetField(field, &value);
+  if (err) {
+    return err;
+  }
+
+  if (value.type_ != JSON_TYPE_OBJECT) {
+    return make_invalid_type(field);
+  }
+
+  *out = value;
+  return Error();
+}
+
+bool JsonValue::FindField(const StringPiece& field, JsonValue* out) const {
+  JsonObjectReader reader(*this);
+  while (reader.Next()) {
+    if (reader.GetKey() == field) {
+      *out = reader.GetValue();
+      return true;
+    }
+  }
+  return false;
+}
+
+JsonObjectReader::JsonObjectReader(const JsonValue& object)
+    : ptr_(nullptr), end_(nullptr), key_(), value_(), key_buffer_() {
+  if (object.type_ == JSON_TYPE_OBJECT) {
+    end_ = object.data_ + object.size_;
+    ptr_ = SkipSpaces(object.data_ + 1, end_);
+  }
+}
+
+bool JsonObjectReader::Next() {
+  if (!ptr_ || *ptr_ == '}') {
+    return false;
+  }
+
+  const char* key_end = SkipString(ptr_, end_);
+  const StringPiece raw_key(ptr_ + 1, key_end - ptr_ - 2);
+  if (raw_key.find('\\') == StringPiece::npos) {
+    key_ = raw_key;
+  } else {
+    UnescapeString(raw_key.data(), raw_key.data() + raw_key.size(), &key_buffer_);
+    key_ = key_buffer_;
+  }
+
+  const char* value_begin = SkipSpaces(SkipSpaces(key_end, end_) + 1, end_);  // :
+  value_ = JsonValue::ViewAt(value_begin, end_, &ptr_);
+  ptr_ = SkipSpaces(ptr_, end_);
+  if (*ptr_ == ',') {
+    ptr_ = SkipSpaces(ptr_ + 1, end_);
+  }
+  return true;
+}
+
+const StringPiece& JsonObjectReader::GetKey() const {
+  return key_;
+}
+
+const JsonValue& JsonObjectReader::GetValue() const {
+  return value_;
+}
+
+Error ParseJson(const StringPiece& data, JsonValue* out) {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  const char* end = data.data() + data.size();
+  const char* begin = SkipSpaces(data.data(), end);
+  const char* value_end = ValidateValue(begin, end, 0);
+  if (!value_end) {
+    return make_error("Invalid json");
+  }
+
+  if (SkipSpaces(value_end, end) != end) {
+    return make_error("Unexpected data after json value");
+  }
+
+  *out = JsonValue(begin, value_end - begin, DetectType(begin, value_end - begin));
+  return Error();
+}
+
+}  // namespace serializer
+}  // namespace common
@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace common {
+namespace serializer {
+namespace detail {
+
+inline bool IsJsonStringSpecial(unsigned char c) {
+  return c == '"' || c == '\\' || c < 0x20;
+}
+
+// Returns the offset of the first '"', '\\' or control character in data, or size if there is none.
+// Eight bytes are tested per step with the usual "has zero byte" bit tricks.
+inline size_t FindJsonStringSpecial(const char* data, size_t size) {
+  static const uint64_t kOnes = 0x0101010101010101ULL;
+  static const uint64_t kHighs = 0x8080808080808080ULL;
+  size_t pos = 0;
+  while (pos + sizeof(uint64_t) <= size) {
+    uint64_t chunk;
+    memcpy(&chunk, data + pos, sizeof(chunk));
+    const uint64_t quotes = chunk ^ (kOnes * '"');
+    const uint64_t slashes = chunk ^ (kOnes * '\\');
+    const uint64_t special =
+        ((quotes - kOnes) & ~quotes) | ((slashes - kOnes) & ~slashes) | ((chunk - kOnes * 0x20) & ~chunk);
+    if (!(special & kHighs)) {
+      pos += sizeof(uint64_t);
+      continue;
+    }
+
+    for (const size_t end = pos + sizeof(uint64_t); pos < end; ++pos) {
+      if (IsJsonStringSpecial(data[pos])) {
+        return pos;
+      }
+    }
+  }
+
+  for (; pos < size; ++pos) {
+    if (IsJsonStringSpecial(data[pos])) {
+      return pos;
+    }
+  }
+  return size;
+}
+
+}  // namespace detail
+}  // namespace serializer
+}  // namespace common
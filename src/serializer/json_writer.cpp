@@ -0,0 +1,216 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/serializer/json_writer.h>
+
+#include <math.h>
+
+#include <common/string_number_conversions.h>
+
+#include "json_scan.h"
+
+namespace common {
+namespace serializer {
+
+namespace {
+const char kHexDigits[] = "0123456789abcdef";
+
+template <typename T>
+char* FormatUnsigned(T value, char* end) {
+  char* ptr = end;
+  do {
+    *--ptr = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value);
+  return ptr;
+}
+}  // namespace
+
+JsonWriter::JsonWriter(std::string* out) : out_(out), scopes_(), need_comma_(false), after_key_(false) {
+  DCHECK(out_);
+}
+
+void JsonWriter::StartObject() {
+  BeforeValue();
+  out_->push_back('{');
+  scopes_.push_back('}');
+  need_comma_ = false;
+}
+
+void JsonWriter::EndObject() {
+  DCHECK(!scopes_.empty() && scopes_.back() == '}' && !after_key_);
+  out_->push_back('}');
+  scopes_.pop_back();
+  need_comma_ = true;
+}
+
+void JsonWriter::StartArray() {
+  BeforeValue();
+  out_->push_back('[');
+  scopes_.push_back(']');
+  need_comma_ = false;
+}
+
+void JsonWriter::EndArray() {
+  DCHECK(!scopes_.empty() && scopes_.back() == ']');
+  out_->push_back(']');
+  scopes_.pop_back();
+  need_comma_ = true;
+}
+
+void JsonWriter::Key(const StringPiece& key) {
+  DCHECK(!scopes_.empty() && scopes_.back() == '}' && !after_key_);
+  if (need_comma_) {
+    out_->push_back(',');
+  }
+  WriteEscaped(key);
+  out_->push_back(':');
+  after_key_ = true;
+}
+
+void JsonWriter::String(const StringPiece& value) {
+  BeforeValue();
+  WriteEscaped(value);
+}
+
+void JsonWriter::Int(int value) {
+  Int64(value);
+}
+
+void JsonWriter::Int64(int64_t value) {
+  BeforeValue();
+  char buff[24];
+  char* const end = buff + sizeof(buff);
+  char* ptr;
+  if (value < 0) {
+    ptr = FormatUnsigned(0 - static_cast<uint64_t>(value), end);
+    *--ptr = '-';
+  } else {
+    ptr = FormatUnsigned(static_cast<uint64_t>(value), end);
+  }
+  out_->append(ptr, end - ptr);
+}
+
+void JsonWriter::UInt64(uint64_t value) {
+  BeforeValue();
+  char buff[24];
+  char* const end = buff + sizeof(buff);
+  char* ptr = FormatUnsigned(value, end);
+  out_->append(ptr, end - ptr);
+}
+
+void JsonWriter::Double(double value) {
+  BeforeValue();
+  if (!isfinite(value)) {
+    out_->append("null");
+    return;
+  }
+
+  // shortest round-trip text, always with '.' or an exponent and never the
+  // locale's decimal separator
+  char buff[kMaxShortestChars];
+  out_->append(buff, NumberToShortestChars(value, buff));
+}
+
+void JsonWriter::Bool(bool value) {
+  BeforeValue();
+  out_->append(value ? "true" : "false");
+}
+
+void JsonWriter::Null() {
+  BeforeValue();
+  out_->append("null");
+}
+
+void JsonWriter::RawValue(const StringPiece& json) {
+  BeforeValue();
+  out_->append(json.data(), json.size());
+}
+
+bool JsonWriter::IsComplete() const {
+  return scopes_.empty() && need_comma_;
+}
+
+void JsonWriter::BeforeValue() {
+  DCHECK(scopes_.empty() || scopes_.back() == ']' || after_key_);
+  if (after_key_) {
+    after_key_ = false;
+  } else if (need_comma_) {
+    out_->push_back(',');
+  }
+  need_comma_ = true;
+}
+
+void JsonWriter::WriteEscaped(const StringPiece& value) {
+  out_->push_back('"');
+  const char* data = value.data();
+  size_t size = value.size();
+  while (size) {
+    const size_t plain = detail::FindJsonStringSpecial(data, size);
+    out_->append(data, plain);
+    if (plain == size) {
+      break;
+    }
+
+    const unsigned char c = data[plain];
+    switch (c) {
+      case '"':
+        out_->append("\\\"");
+        break;
+      case '\\':
+        out_->append("\\\\");
+        break;
+      case '\b':
+        out_->append("\\b");
+        break;
+      case '\f':
+        out_->append("\\f");
+        break;
+      case '\n':
+        out_->append("\\n");
+        break;
+      case '\r':
+        out_->append("\\r");
+        break;
+      case '\t':
+        out_->append("\\t");
+        break;
+      default: {
+        const char escaped[] = {'\\', 'u', '0', '0', kHexDigits[c >> 4], kHexDigits[c & 0xF]};
+        out_->append(escaped, sizeof(escaped));
+      }
+    }
+    data += plain + 1;
+    size -= plain + 1;
+  }
+  out_->push_back('"');
+}
+
+}  // namespace serializer
+}  // namespace common
@@ -31,21 +31,72 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <float.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wctype.h>
 
+#include <cmath>
 #include <limits>
 #include <type_traits>
 
+#include <common/portable_endian.h>
 #include <common/sprintf.h>
 #include <common/utf_string_conversions.h>
 
+#include "power_of_five_table.h"
+
 namespace common {
 
 namespace {
 
+// "00", "01", ... "99": integers are emitted two digits per division.
+const char kDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes |value| back to front ending at |end|, returns the first written char.
+template <typename UINT>
+char* FormatUnsignedBackward(UINT value, char* end) {
+  while (value >= 100) {
+    const size_t pair = static_cast<size_t>(value % 100) * 2;
+    value /= 100;
+    end -= 2;
+    end[0] = kDigitPairs[pair];
+    end[1] = kDigitPairs[pair + 1];
+  }
+  if (value >= 10) {
+    const size_t pair = static_cast<size_t>(value) * 2;
+    end -= 2;
+    end[0] = kDigitPairs[pair];
+    end[1] = kDigitPairs[pair + 1];
+  } else {
+    *--end = static_cast<char>('0' + value);
+  }
+  return end;
+}
+
+size_t CopyToChars(const char* data, size_t size, span<char> out) {
+  if (size > out.size()) {
+    return 0;
+  }
+
+  memcpy(out.data(), data, size);
+  return size;
+}
+
 template <typename STR, typename INT, typename UINT, bool NEG>
 struct IntToStringT {
+  static_assert(sizeof(INT) <= 8, "kMaxIntegerChars fits 64 bit integers only");
+
   // This is to avoid a compiler warning about unary minus on unsigned type.
   // For example, say you had the following code:
   //   template <typename INT>
@@ -63,7 +114,10 @@ struct IntToStringT {
 
   template <typename INT2, typename UINT2>
   struct ToUnsignedT<INT2, UINT2, true> {
-    static UINT2 ToUnsigned(INT2 value) { return static_cast<UINT2>(value < 0 ? -value : value); }
+    // Negate in the unsigned type, -value overflows for the minimum value.
+    static UINT2 ToUnsigned(INT2 value) {
+      return value < 0 ? 0 - static_cast<UINT2>(value) : static_cast<UINT2>(value);
+    }
   };
 
   // This set of templates is very similar to the above templates, but
@@ -84,36 +138,556 @@ struct IntToStringT {
     static bool TestNeg(INT2 value) { return value < 0; }
   };
 
-  static STR IntToString(INT value) {
-    // log10(2) ~= 0.3 bytes needed per bit or per byte log10(2**8) ~= 2.4.
-    // So round up to allocate 3 output characters per byte, plus 1 for '-'.
-    const int kOutputBufSize = 3 * sizeof(INT) + 1;
-
-    // Allocate the whole string right away, we will right back to front, and
-    // then return the substr of what we ended up using.
-    STR outbuf(kOutputBufSize, 0);
-
+  // Writes |value| back to front ending at |end|, at most kMaxIntegerChars.
+  static char* IntToCharsBackward(INT value, char* end) {
     bool is_neg = TestNegT<INT, NEG>::TestNeg(value);
     // Even though is_neg will never be true when INT is parameterized as
     // unsigned, even the presence of the unary operation causes a warning.
     UINT res = ToUnsignedT<INT, UINT, NEG>::ToUnsigned(value);
 
-    typename STR::iterator it(outbuf.end());
-    do {
-      --it;
-      DCHECK(it != outbuf.begin());
-      *it = static_cast<typename STR::value_type>((res % 10) + '0');
-      res /= 10;
-    } while (res != 0);
+    char* it = FormatUnsignedBackward(res, end);
     if (is_neg) {
-      --it;
-      DCHECK(it != outbuf.begin());
-      *it = static_cast<typename STR::value_type>('-');
+      *--it = '-';
+    }
+    return it;
+  }
+
+  static STR IntToString(INT value) {
+    char buffer[kMaxIntegerChars];
+    char* end = buffer + sizeof(buffer);
+    return STR(IntToCharsBackward(value, end), end);
+  }
+
+  static size_t IntToChars(INT value, span<char> out) {
+    char buffer[kMaxIntegerChars];
+    char* end = buffer + sizeof(buffer);
+    const char* begin = IntToCharsBackward(value, end);
+    return CopyToChars(begin, end - begin, out);
+  }
+};
+
+// printf("%f") compatible precision: 0-4 digits are honoured, anything else
+// falls back to the "%f" default of 6.
+int FixedPrecision(int prec) {
+  return prec >= 0 && prec <= 4 ? prec : 6;
+}
+
+const uint64_t kPowersOf10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+// Sign, 20 integral digits, point and 6 fractional digits.
+const size_t kMaxFixedFastChars = 32;
+
+struct UInt128 {
+  uint64_t hi;
+  uint64_t lo;
+};
+
+UInt128 Mul64x64(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  UInt128 r = {static_cast<uint64_t>(product >> 64), static_cast<uint64_t>(product)};
+  return r;
+#else
+  const uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  const uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  const uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  const uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  UInt128 r = {(hi_lo >> 32) + (cross >> 32) + hi_hi, (cross << 32) | (lo_lo & 0xFFFFFFFF)};
+  return r;
+#endif
+}
+
+// Low 64 bits of |value| >> |shift|, shift < 128.
+uint64_t ShiftRight128(const UInt128& value, int shift) {
+  if (shift == 0) {
+    return value.lo;
+  }
+  if (shift >= 64) {
+    return value.hi >> (shift - 64);
+  }
+  return (value.lo >> shift) | (value.hi << (64 - shift));
+}
+
+// Whether any of the bits [0, count) of |value| is set, count < 128.
+bool AnyLowBits128(const UInt128& value, int count) {
+  if (count >= 64) {
+    return value.lo != 0 || (count > 64 && (value.hi & ((uint64_t(1) << (count - 64)) - 1)) != 0);
+  }
+  return count > 0 && (value.lo & ((uint64_t(1) << count) - 1)) != 0;
+}
+
+// Formats |value| exactly like printf("%.*f", prec, value) in the default
+// rounding mode. The fraction of a double is k / 2^shift, so it is scaled by
+// 10^prec in 128-bit integer arithmetic and rounded half to even without the
+// double rounding of value * 10^prec. Returns 0 for NaN and |value| >= 2^63,
+// which are left to snprintf.
+size_t FormatFixed(double value, int prec, char* buffer) {
+  DCHECK(prec >= 0 && prec < static_cast<int>(arraysize(kPowersOf10)));
+  if (std::isnan(value)) {
+    return 0;
+  }
+
+  double integral = 0;
+  const double fraction = std::modf(std::fabs(value), &integral);
+  if (!(integral < 9223372036854775808.0)) {
+    return 0;
+  }
+
+  uint64_t int_part = static_cast<uint64_t>(integral);
+  uint64_t frac_part = 0;
+  if (fraction != 0) {
+    int exponent = 0;
+    uint64_t k = static_cast<uint64_t>(std::ldexp(std::frexp(fraction, &exponent), 53));
+    int shift = 53 - exponent;
+    while ((k & 1) == 0) {
+      k >>= 1;
+      --shift;
+    }
+
+    // k * 10^prec < 2^73, with a larger shift the scaled fraction is below 1/2.
+    if (shift <= 74) {
+      const UInt128 scaled = Mul64x64(k, kPowersOf10[prec]);
+      frac_part = ShiftRight128(scaled, shift);
+      const bool half = (ShiftRight128(scaled, shift - 1) & 1) != 0;
+      const bool above_half = AnyLowBits128(scaled, shift - 1);
+      const bool odd = ((prec == 0 ? int_part : frac_part) & 1) != 0;
+      if (half && (above_half || odd)) {
+        if (++frac_part == kPowersOf10[prec]) {
+          frac_part = 0;
+          ++int_part;
+        }
+      }
     }
-    return STR(it, outbuf.end());
   }
+
+  char* it = buffer;
+  if (std::signbit(value)) {
+    *it++ = '-';
+  }
+  char digits[kMaxIntegerChars];
+  char* digits_end = digits + sizeof(digits);
+  const char* digits_begin = FormatUnsignedBackward(int_part, digits_end);
+  memcpy(it, digits_begin, digits_end - digits_begin);
+  it += digits_end - digits_begin;
+  if (prec > 0) {
+    *it++ = '.';
+    char* frac_end = it + prec;
+    char* frac_begin = FormatUnsignedBackward(frac_part, frac_end);
+    while (frac_begin != it) {
+      *--frac_begin = '0';
+    }
+    it = frac_end;
+  }
+  return it - buffer;
+}
+
+size_t FixedToChars(double value, int prec, span<char> out) {
+  if (value == std::numeric_limits<double>::infinity()) {
+    return CopyToChars(PPLUS_INF, sizeof(PPLUS_INF) - 1, out);
+  }
+  if (value == -std::numeric_limits<double>::infinity()) {
+    return CopyToChars(MINUS_INF, sizeof(MINUS_INF) - 1, out);
+  }
+
+  prec = FixedPrecision(prec);
+  char buffer[kMaxFixedChars];
+  size_t size = FormatFixed(value, prec, buffer);
+  if (size == 0) {
+    const int res = SNPrintf(buffer, sizeof(buffer), "%.*f", prec, value);
+    if (res <= 0 || static_cast<size_t>(res) >= sizeof(buffer)) {
+      return 0;
+    }
+    size = res;
+  }
+  return CopyToChars(buffer, size, out);
+}
+
+// Grisu2, see Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers". Produces the shortest digits which read back to
+// the same value in the vast majority of cases and digits which still read
+// back correctly in the remaining ones; no bignum fallback is needed.
+
+// Floating point number f * 2^e with a 64-bit significand.
+struct DiyFp {
+  uint64_t f;
+  int e;
 };
 
+DiyFp DiyFpSub(const DiyFp& x, const DiyFp& y) {
+  DCHECK_EQ(x.e, y.e);
+  DCHECK_GE(x.f, y.f);
+  DiyFp r = {x.f - y.f, x.e};
+  return r;
+}
+
+// Upper 64 bits of the product, rounded.
+DiyFp DiyFpMul(const DiyFp& x, const DiyFp& y) {
+  const UInt128 product = Mul64x64(x.f, y.f);
+  DiyFp r = {product.hi + (product.lo >> 63), x.e + y.e + 64};
+  return r;
+}
+
+DiyFp DiyFpNormalize(DiyFp x) {
+  DCHECK_NE(x.f, 0u);
+  while ((x.f >> 63) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+DiyFp DiyFpNormalizeTo(const DiyFp& x, int target_exponent) {
+  const int delta = x.e - target_exponent;
+  DCHECK_GE(delta, 0);
+  DiyFp r = {x.f << delta, target_exponent};
+  return r;
+}
+
+// Normalized |w| with the normalized midpoints to its neighbours |minus| and
+// |plus|, any decimal in (minus, plus) reads back to |w|.
+struct DiyFpBoundaries {
+  DiyFp w;
+  DiyFp minus;
+  DiyFp plus;
+};
+
+template <typename FloatType>
+DiyFpBoundaries ComputeBoundaries(FloatType value) {
+  static_assert(std::numeric_limits<FloatType>::is_iec559, "IEEE-754 floating point expected");
+  typedef typename std::conditional<sizeof(FloatType) == sizeof(uint32_t), uint32_t, uint64_t>::type bits_type;
+  static_assert(sizeof(bits_type) == sizeof(FloatType), "unsupported floating point size");
+  DCHECK(std::isfinite(value) && value > 0);
+
+  // The significand includes the hidden bit.
+  const int kPrecision = std::numeric_limits<FloatType>::digits;
+  const int kBias = std::numeric_limits<FloatType>::max_exponent - 1 + (kPrecision - 1);
+  const int kMinExp = 1 - kBias;
+  const uint64_t kHiddenBit = uint64_t(1) << (kPrecision - 1);
+
+  bits_type bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint64_t biased_exponent = bits >> (kPrecision - 1);
+  const uint64_t fraction = bits & (kHiddenBit - 1);
+
+  const bool is_denormal = biased_exponent == 0;
+  const DiyFp v = is_denormal ? DiyFp{fraction, kMinExp}
+                              : DiyFp{fraction + kHiddenBit, static_cast<int>(biased_exponent) - kBias};
+  // The lower neighbour is closer for powers of two, except the smallest normal.
+  const bool lower_boundary_is_closer = fraction == 0 && biased_exponent > 1;
+  const DiyFp m_plus = {2 * v.f + 1, v.e - 1};
+  const DiyFp m_minus = lower_boundary_is_closer ? DiyFp{4 * v.f - 1, v.e - 2} : DiyFp{2 * v.f - 1, v.e - 1};
+
+  DiyFpBoundaries r;
+  r.plus = DiyFpNormalize(m_plus);
+  r.minus = DiyFpNormalizeTo(m_minus, r.plus.e);
+  r.w = DiyFpNormalize(v);
+  return r;
+}
+
+// The product with a cached power has its binary exponent in [kAlpha, kGamma],
+// so the integral part fits 32 bits and the digits can be generated cheaply.
+const int kAlpha = -60;
+const int kGamma = -32;
+
+struct CachedPower {
+  uint64_t f;
+  int e;
+  int k;
+};
+
+// 10^k as normalized DiyFp for k = -300, -292, ..., 324.
+const int kCachedPowersMinDecExp = -300;
+const int kCachedPowersDecStep = 8;
+const CachedPower kCachedPowers[] = {
+    {0xAB70FE17C79AC6CA, -1060, -300},
+    {0xFF77B1FCBEBCDC4F, -1034, -292},
+    {0xBE5691EF416BD60C, -1007, -284},
+    {0x8DD01FAD907FFC3C, -980, -276},
+    {0xD3515C2831559A83, -954, -268},
+    {0x9D71AC8FADA6C9B5, -927, -260},
+    {0xEA9C227723EE8BCB, -901, -252},
+    {0xAECC49914078536D, -874, -244},
+    {0x823C12795DB6CE57, -847, -236},
+    {0xC21094364DFB5637, -821, -228},
+    {0x9096EA6F3848984F, -794, -220},
+    {0xD77485CB25823AC7, -768, -212},
+    {0xA086CFCD97BF97F4, -741, -204},
+    {0xEF340A98172AACE5, -715, -196},
+    {0xB23867FB2A35B28E, -688, -188},
+    {0x84C8D4DFD2C63F3B, -661, -180},
+    {0xC5DD44271AD3CDBA, -635, -172},
+    {0x936B9FCEBB25C996, -608, -164},
+    {0xDBAC6C247D62A584, -582, -156},
+    {0xA3AB66580D5FDAF6, -555, -148},
+    {0xF3E2F893DEC3F126, -529, -140},
+    {0xB5B5ADA8AAFF80B8, -502, -132},
+    {0x87625F056C7C4A8B, -475, -124},
+    {0xC9BCFF6034C13053, -449, -116},
+    {0x964E858C91BA2655, -422, -108},
+    {0xDFF9772470297EBD, -396, -100},
+    {0xA6DFBD9FB8E5B88F, -369, -92},
+    {0xF8A95FCF88747D94, -343, -84},
+    {0xB94470938FA89BCF, -316, -76},
+    {0x8A08F0F8BF0F156B, -289, -68},
+    {0xCDB02555653131B6, -263, -60},
+    {0x993FE2C6D07B7FAC, -236, -52},
+    {0xE45C10C42A2B3B06, -210, -44},
+    {0xAA242499697392D3, -183, -36},
+    {0xFD87B5F28300CA0E, -157, -28},
+    {0xBCE5086492111AEB, -130, -20},
+    {0x8CBCCC096F5088CC, -103, -12},
+    {0xD1B71758E219652C, -77, -4},
+    {0x9C40000000000000, -50, 4},
+    {0xE8D4A51000000000, -24, 12},
+    {0xAD78EBC5AC620000, 3, 20},
+    {0x813F3978F8940984, 30, 28},
+    {0xC097CE7BC90715B3, 56, 36},
+    {0x8F7E32CE7BEA5C70, 83, 44},
+    {0xD5D238A4ABE98068, 109, 52},
+    {0x9F4F2726179A2245, 136, 60},
+    {0xED63A231D4C4FB27, 162, 68},
+    {0xB0DE65388CC8ADA8, 189, 76},
+    {0x83C7088E1AAB65DB, 216, 84},
+    {0xC45D1DF942711D9A, 242, 92},
+    {0x924D692CA61BE758, 269, 100},
+    {0xDA01EE641A708DEA, 295, 108},
+    {0xA26DA3999AEF774A, 322, 116},
+    {0xF209787BB47D6B85, 348, 124},
+    {0xB454E4A179DD1877, 375, 132},
+    {0x865B86925B9BC5C2, 402, 140},
+    {0xC83553C5C8965D3D, 428, 148},
+    {0x952AB45CFA97A0B3, 455, 156},
+    {0xDE469FBD99A05FE3, 481, 164},
+    {0xA59BC234DB398C25, 508, 172},
+    {0xF6C69A72A3989F5C, 534, 180},
+    {0xB7DCBF5354E9BECE, 561, 188},
+    {0x88FCF317F22241E2, 588, 196},
+    {0xCC20CE9BD35C78A5, 614, 204},
+    {0x98165AF37B2153DF, 641, 212},
+    {0xE2A0B5DC971F303A, 667, 220},
+    {0xA8D9D1535CE3B396, 694, 228},
+    {0xFB9B7CD9A4A7443C, 720, 236},
+    {0xBB764C4CA7A44410, 747, 244},
+    {0x8BAB8EEFB6409C1A, 774, 252},
+    {0xD01FEF10A657842C, 800, 260},
+    {0x9B10A4E5E9913129, 827, 268},
+    {0xE7109BFBA19C0C9D, 853, 276},
+    {0xAC2820D9623BF429, 880, 284},
+    {0x80444B5E7AA7CF85, 907, 292},
+    {0xBF21E44003ACDD2D, 933, 300},
+    {0x8E679C2F5E44FF8F, 960, 308},
+    {0xD433179D9C8CB841, 986, 316},
+    {0x9E19DB92B4E31BA9, 1013, 324},
+};
+
+CachedPower GetCachedPowerForBinaryExponent(int e) {
+  DCHECK(e >= -1500 && e <= 1500);
+  // k = ceil(log10(2^(kAlpha - e - 1))), 78913 / 2^18 approximates log10(2).
+  const int f = kAlpha - e - 1;
+  const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+  const int index = (-kCachedPowersMinDecExp + k + (kCachedPowersDecStep - 1)) / kCachedPowersDecStep;
+  DCHECK(index >= 0 && static_cast<size_t>(index) < arraysize(kCachedPowers));
+
+  const CachedPower cached = kCachedPowers[index];
+  DCHECK(kAlpha <= cached.e + e + 64 && cached.e + e + 64 <= kGamma);
+  return cached;
+}
+
+// Number of decimal digits of |n| (at least 1), |*pow10| is 10^(digits - 1).
+int FindLargestPow10(uint32_t n, uint32_t* pow10) {
+  uint32_t p = 1;
+  int digits = 1;
+  while (digits < 10 && n / p >= 10) {
+    p *= 10;
+    ++digits;
+  }
+  *pow10 = p;
+  return digits;
+}
+
+// Moves the last digit towards w while the result stays inside the boundaries.
+void Grisu2Round(char* buffer, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k) {
+  DCHECK_GE(length, 1);
+  DCHECK_LE(dist, delta);
+  DCHECK_LE(rest, delta);
+  DCHECK_GT(ten_k, 0u);
+
+  while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+    DCHECK_NE(buffer[length - 1], '0');
+    buffer[length - 1]--;
+    rest += ten_k;
+  }
+}
+
+// Generates the digits of |w| which are enough to stay inside (M-, M+).
+void Grisu2DigitGen(char* buffer,
+                    int* length,
+                    int* decimal_exponent,
+                    const DiyFp& m_minus,
+                    const DiyFp& w,
+                    const DiyFp& m_plus) {
+  DCHECK(kAlpha <= m_plus.e && m_plus.e <= kGamma);
+
+  uint64_t delta = DiyFpSub(m_plus, m_minus).f;
+  uint64_t dist = DiyFpSub(m_plus, w).f;
+
+  // M+ = p1 + p2 * 2^e, p1 is the integral and p2 the fractional part.
+  const int one_e = -m_plus.e;
+  const uint64_t one_f = uint64_t(1) << one_e;
+  uint32_t p1 = static_cast<uint32_t>(m_plus.f >> one_e);
+  uint64_t p2 = m_plus.f & (one_f - 1);
+
+  uint32_t pow10 = 0;
+  int n = FindLargestPow10(p1, &pow10);
+  while (n > 0) {
+    const uint32_t d = p1 / pow10;
+    p1 %= pow10;
+    buffer[(*length)++] = static_cast<char>('0' + d);
+    n--;
+
+    const uint64_t rest = (uint64_t(p1) << one_e) + p2;
+    if (rest <= delta) {
+      *decimal_exponent += n;
+      Grisu2Round(buffer, *length, dist, delta, rest, uint64_t(pow10) << one_e);
+      return;
+    }
+    pow10 /= 10;
+  }
+
+  int m = 0;
+  for (;;) {
+    p2 *= 10;
+    const uint64_t d = p2 >> one_e;
+    p2 &= one_f - 1;
+    buffer[(*length)++] = static_cast<char>('0' + d);
+    m++;
+
+    delta *= 10;
+    dist *= 10;
+    if (p2 <= delta) {
+      break;
+    }
+  }
+  *decimal_exponent -= m;
+  Grisu2Round(buffer, *length, dist, delta, p2, one_f);
+}
+
+// Digits of a positive finite |value|: value = buffer * 10^decimal_exponent.
+template <typename FloatType>
+void Grisu2(char* buffer, int* length, int* decimal_exponent, FloatType value) {
+  const DiyFpBoundaries w = ComputeBoundaries(value);
+  DCHECK_EQ(w.plus.e, w.minus.e);
+  DCHECK_EQ(w.plus.e, w.w.e);
+
+  const CachedPower cached = GetCachedPowerForBinaryExponent(w.plus.e);
+  const DiyFp c_minus_k = {cached.f, cached.e};
+  const DiyFp scaled_w = DiyFpMul(w.w, c_minus_k);
+  const DiyFp scaled_minus = DiyFpMul(w.minus, c_minus_k);
+  const DiyFp scaled_plus = DiyFpMul(w.plus, c_minus_k);
+
+  // Shrink the interval by one ulp of the multiplication error on each side.
+  const DiyFp m_minus = {scaled_minus.f + 1, scaled_minus.e};
+  const DiyFp m_plus = {scaled_plus.f - 1, scaled_plus.e};
+
+  *length = 0;
+  *decimal_exponent = -cached.k;
+  Grisu2DigitGen(buffer, length, decimal_exponent, m_minus, scaled_w, m_plus);
+}
+
+char* AppendExponent(char* buffer, int e) {
+  DCHECK(e > -1000 && e < 1000);
+  if (e < 0) {
+    e = -e;
+    *buffer++ = '-';
+  } else {
+    *buffer++ = '+';
+  }
+
+  if (e >= 100) {
+    *buffer++ = static_cast<char>('0' + e / 100);
+    e %= 100;
+  }
+  *buffer++ = kDigitPairs[e * 2];
+  *buffer++ = kDigitPairs[e * 2 + 1];
+  return buffer;
+}
+
+// Lays out |length| digits scaled by 10^decimal_exponent as %g would: decimal
+// notation for exponents in (min_exp, max_exp], scientific otherwise. Integral
+// values keep a ".0" so the text still reads as a floating point number.
+char* FormatShortestDigits(char* buffer, int length, int decimal_exponent, int min_exp, int max_exp) {
+  const int k = length;
+  const int n = length + decimal_exponent;
+
+  if (k <= n && n <= max_exp) {
+    // digits[000].0
+    memset(buffer + k, '0', n - k);
+    buffer[n] = '.';
+    buffer[n + 1] = '0';
+    return buffer + n + 2;
+  }
+
+  if (0 < n && n <= max_exp) {
+    // dig.its
+    memmove(buffer + n + 1, buffer + n, k - n);
+    buffer[n] = '.';
+    return buffer + k + 1;
+  }
+
+  if (min_exp < n && n <= 0) {
+    // 0.[000]digits
+    memmove(buffer + 2 - n, buffer, k);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    memset(buffer + 2, '0', -n);
+    return buffer + 2 - n + k;
+  }
+
+  if (k == 1) {
+    // de+123
+    buffer += 1;
+  } else {
+    // d.igitse+123
+    memmove(buffer + 2, buffer + 1, k - 1);
+    buffer[1] = '.';
+    buffer += k + 1;
+  }
+  *buffer++ = 'e';
+  return AppendExponent(buffer, n - 1);
+}
+
+template <typename FloatType>
+size_t ShortestToChars(FloatType value, span<char> out) {
+  if (std::isnan(value)) {
+    return CopyToChars("nan", 3, out);
+  }
+  if (std::isinf(value)) {
+    return value > 0 ? CopyToChars(PPLUS_INF, sizeof(PPLUS_INF) - 1, out)
+                     : CopyToChars(MINUS_INF, sizeof(MINUS_INF) - 1, out);
+  }
+
+  char buffer[kMaxShortestChars];
+  char* it = buffer;
+  if (std::signbit(value)) {
+    *it++ = '-';
+    value = -value;
+  }
+
+  if (value == 0) {
+    *it++ = '0';
+    *it++ = '.';
+    *it++ = '0';
+    return CopyToChars(buffer, it - buffer, out);
+  }
+
+  int length = 0;
+  int decimal_exponent = 0;
+  Grisu2(it, &length, &decimal_exponent, value);
+  DCHECK_LE(length, std::numeric_limits<FloatType>::max_digits10);
+  it = FormatShortestDigits(it, length, decimal_exponent, -4, std::numeric_limits<FloatType>::digits10);
+  return CopyToChars(buffer, it - buffer, out);
+}
+
 // Utility to convert a character to a digit in a given base
 template <typename CHAR, int BASE, bool BASE_LTE_10>
 class BaseCharToDigit {};
@@ -178,6 +752,426 @@ bool LocalIsWhitespace(CHAR c) {
   return WhitespaceHelper<CHAR>::Invoke(c);
 }
 
+// SWAR digit parsing: eight chars are checked and converted with a handful of
+// 64-bit operations instead of a multiply per char.
+uint64_t LoadEightChars(const char* chars) {
+  uint64_t value;
+  memcpy(&value, chars, sizeof(value));
+  return le64toh(value);
+}
+
+bool IsEightDigits(uint64_t chars) {
+  return ((chars & 0xF0F0F0F0F0F0F0F0) | (((chars + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+uint32_t ParseEightDigits(uint64_t chars) {
+  const uint64_t mask = 0x000000FF000000FF;
+  const uint64_t mul1 = 0x000F424000000064;  // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001;  // 1 + (10000 << 32)
+  chars -= 0x3030303030303030;
+  chars = (chars * 10) + (chars >> 8);
+  return static_cast<uint32_t>((((chars & mask) * mul1) + (((chars >> 16) & mask) * mul2)) >> 32);
+}
+
+bool IsDecimalDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Appends the digits in [p, end) to |*value| until the first non digit and
+// returns its position. Wraps around on overflow, callers bound the count.
+const char* ParseDigits(const char* p, const char* end, uint64_t* value) {
+  uint64_t result = *value;
+  while (end - p >= 8) {
+    const uint64_t chars = LoadEightChars(p);
+    if (!IsEightDigits(chars)) {
+      break;
+    }
+    result = result * 100000000 + ParseEightDigits(chars);
+    p += 8;
+  }
+  while (p != end && IsDecimalDigit(*p)) {
+    result = result * 10 + static_cast<uint64_t>(*p - '0');
+    ++p;
+  }
+  *value = result;
+  return p;
+}
+
+// Base 10 IteratorRangeToNumber for chars with the same results: the digits
+// are accumulated 8 at a time in 64 bits and range checked once at the end.
+template <typename VALUE>
+bool DecimalToInt(StringPiece input, VALUE* output) {
+  static_assert(sizeof(VALUE) <= sizeof(uint64_t), "64 bit integers at most");
+  const char* p = input.data();
+  const char* end = p + input.size();
+
+  bool valid = true;
+  while (p != end && LocalIsWhitespace(*p)) {
+    valid = false;
+    ++p;
+  }
+
+  bool negative = false;
+  if (p != end && *p == '-') {
+    if (!std::numeric_limits<VALUE>::is_signed) {
+      *output = 0;
+      return false;
+    }
+    negative = true;
+    ++p;
+  } else if (p != end && *p == '+') {
+    ++p;
+  }
+
+  const char* digits = p;
+  while (p != end && *p == '0') {
+    ++p;
+  }
+
+  // Any 19 digits fit 64 bits, the 20th one needs a check.
+  uint64_t magnitude = 0;
+  const char* limit = end - p > 19 ? p + 19 : end;
+  p = ParseDigits(p, limit, &magnitude);
+  bool overflow = false;
+  if (p == limit && p != end && IsDecimalDigit(*p)) {
+    const uint64_t digit = static_cast<uint64_t>(*p - '0');
+    if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+      overflow = true;
+    } else {
+      magnitude = magnitude * 10 + digit;
+      ++p;
+      overflow = p != end && IsDecimalDigit(*p);
+    }
+  }
+
+  const uint64_t max_magnitude =
+      negative ? uint64_t(0) - static_cast<uint64_t>(static_cast<int64_t>(std::numeric_limits<VALUE>::min()))
+               : static_cast<uint64_t>(std::numeric_limits<VALUE>::max());
+  if (overflow || magnitude > max_magnitude) {
+    *output = negative ? std::numeric_limits<VALUE>::min() : std::numeric_limits<VALUE>::max();
+    return false;
+  }
+
+  *output = static_cast<VALUE>(negative ? uint64_t(0) - magnitude : magnitude);
+  return valid && p == end && p != digits;
+}
+
+// value = w * 10^q, |truncated| when digits after the 19th were dropped from w.
+struct DecimalNumber {
+  uint64_t w;
+  int64_t q;
+  bool negative;
+  bool truncated;
+};
+
+// Parses [+-]digits[.digits][(e|E)[+-]digits] spanning the whole |input| with
+// at least one digit in the significand. Everything else (whitespace, hex,
+// inf, nan, trailing chars) is left to strtod.
+bool ParseDecimalNumber(StringPiece input, DecimalNumber* number) {
+  const char* p = input.data();
+  const char* end = p + input.size();
+
+  number->negative = p != end && *p == '-';
+  if (p != end && (*p == '-' || *p == '+')) {
+    ++p;
+  }
+
+  uint64_t w = 0;
+  const char* int_begin = p;
+  p = ParseDigits(p, end, &w);
+  const char* int_end = p;
+  int64_t digit_count = int_end - int_begin;
+  int64_t exponent = 0;
+
+  const char* frac_begin = p;
+  const char* frac_end = p;
+  if (p != end && *p == '.') {
+    frac_begin = ++p;
+    p = ParseDigits(p, end, &w);
+    frac_end = p;
+    exponent = frac_begin - frac_end;
+    digit_count += frac_end - frac_begin;
+  }
+  if (digit_count == 0) {
+    return false;
+  }
+
+  int64_t explicit_exponent = 0;
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+      negative_exponent = *p == '-';
+      ++p;
+    }
+    if (p == end || !IsDecimalDigit(*p)) {
+      return false;
+    }
+    while (p != end && IsDecimalDigit(*p)) {
+      // Saturate, anything this large is zero or infinity anyway.
+      if (explicit_exponent < 0x10000) {
+        explicit_exponent = explicit_exponent * 10 + (*p - '0');
+      }
+      ++p;
+    }
+    if (negative_exponent) {
+      explicit_exponent = -explicit_exponent;
+    }
+    exponent += explicit_exponent;
+  }
+  if (p != end) {
+    return false;
+  }
+
+  number->truncated = false;
+  if (digit_count > 19) {
+    // Leading zeros are not significant.
+    for (const char* it = int_begin; it != frac_end && (*it == '0' || *it == '.'); ++it) {
+      if (*it == '0') {
+        digit_count--;
+      }
+    }
+    if (digit_count > 19) {
+      // w wrapped around, keep the first 19 significant digits only.
+      const uint64_t kMinNineteenDigits = 1000000000000000000ULL;
+      number->truncated = true;
+      w = 0;
+      p = int_begin;
+      while (w < kMinNineteenDigits && p != int_end) {
+        w = w * 10 + static_cast<uint64_t>(*p++ - '0');
+      }
+      if (w >= kMinNineteenDigits) {
+        exponent = (int_end - p) + explicit_exponent;
+      } else {
+        p = frac_begin;
+        while (w < kMinNineteenDigits && p != frac_end) {
+          w = w * 10 + static_cast<uint64_t>(*p++ - '0');
+        }
+        exponent = (frac_begin - p) + explicit_exponent;
+      }
+    }
+  }
+
+  number->w = w;
+  number->q = exponent;
+  return true;
+}
+
+template <typename FloatType>
+struct BinaryFormat;
+
+template <>
+struct BinaryFormat<double> {
+  typedef uint64_t bits_type;
+  static const int kMantissaExplicitBits = 52;
+  static const int kMinimumExponent = -1023;
+  static const int kInfinitePower = 0x7FF;
+  static const int kMinExponentRoundToEven = -4;
+  static const int kMaxExponentRoundToEven = 23;
+  static const int kSmallestPowerOfTen = -342;
+  static const int kLargestPowerOfTen = 308;
+  static const int kMaxExponentFastPath = 22;
+
+  static double ExactPowerOfTen(int64_t e) {
+    static const double kPowers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return kPowers[e];
+  }
+  static double StrTo(const char* str, char** end) { return strtod(str, end); }
+};
+
+template <>
+struct BinaryFormat<float> {
+  typedef uint32_t bits_type;
+  static const int kMantissaExplicitBits = 23;
+  static const int kMinimumExponent = -127;
+  static const int kInfinitePower = 0xFF;
+  static const int kMinExponentRoundToEven = -17;
+  static const int kMaxExponentRoundToEven = 10;
+  static const int kSmallestPowerOfTen = -65;
+  static const int kLargestPowerOfTen = 38;
+  static const int kMaxExponentFastPath = 10;
+
+  static float ExactPowerOfTen(int64_t e) {
+    static const float kPowers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    return kPowers[e];
+  }
+  static float StrTo(const char* str, char** end) { return strtof(str, end); }
+};
+
+// Extended precision arithmetic would round twice in Clinger's fast path.
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+const bool kExactFloatArithmetic = true;
+#else
+const bool kExactFloatArithmetic = false;
+#endif
+
+int CountLeadingZeros64(uint64_t value) {
+  DCHECK_NE(value, 0u);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(value);
+#else
+  int count = 0;
+  while ((value >> 63) == 0) {
+    value <<= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+
+// Biased binary exponent and explicit mantissa bits of a float.
+struct AdjustedMantissa {
+  uint64_t mantissa;
+  int power2;
+};
+
+// Eisel-Lemire: w * 10^q rounded to nearest even as FloatType. The 128-bit
+// truncated 5^q is always enough for 19 digit significands (Mushtak, Lemire,
+// "Fast Number Parsing Without Fallback"); truncated ones are checked by the
+// caller.
+template <typename FloatType>
+AdjustedMantissa ComputeFloat(int64_t q, uint64_t w) {
+  typedef BinaryFormat<FloatType> format;
+  AdjustedMantissa answer = {0, 0};
+  if (w == 0 || q < format::kSmallestPowerOfTen) {
+    return answer;
+  }
+  if (q > format::kLargestPowerOfTen) {
+    answer.power2 = format::kInfinitePower;
+    return answer;
+  }
+
+  const int lz = CountLeadingZeros64(w);
+  w <<= lz;
+
+  // The leading 64 bits of w * 5^q, refined by the low half of 5^q only when
+  // the bits below the mantissa might carry.
+  const int index = static_cast<int>(q) - internal::kPowerOfFiveMin;
+  UInt128 product = Mul64x64(w, internal::kPowersOfFive128[index][0]);
+  const uint64_t precision_mask = std::numeric_limits<uint64_t>::max() >> (format::kMantissaExplicitBits + 3);
+  if ((product.hi & precision_mask) == precision_mask) {
+    const UInt128 second = Mul64x64(w, internal::kPowersOfFive128[index][1]);
+    product.lo += second.hi;
+    if (second.hi > product.lo) {
+      product.hi++;
+    }
+  }
+
+  const int upperbit = static_cast<int>(product.hi >> 63);
+  const int shift = upperbit + 64 - format::kMantissaExplicitBits - 3;
+  answer.mantissa = product.hi >> shift;
+  // floor(log2(10^q)) + 63, exact for |q| < 1700.
+  const int power = (((152170 + 65536) * static_cast<int>(q)) >> 16) + 63;
+  answer.power2 = power + upperbit - lz - format::kMinimumExponent;
+
+  if (answer.power2 <= 0) {
+    // Subnormal.
+    if (-answer.power2 + 1 >= 64) {
+      answer.mantissa = 0;
+      answer.power2 = 0;
+      return answer;
+    }
+    answer.mantissa >>= -answer.power2 + 1;
+    answer.mantissa += (answer.mantissa & 1);
+    answer.mantissa >>= 1;
+    answer.power2 = answer.mantissa < (uint64_t(1) << format::kMantissaExplicitBits) ? 0 : 1;
+    return answer;
+  }
+
+  // Exactly halfway between two floats: round to even instead of up.
+  if (product.lo <= 1 && q >= format::kMinExponentRoundToEven && q <= format::kMaxExponentRoundToEven &&
+      (answer.mantissa & 3) == 1) {
+    if ((answer.mantissa << shift) == product.hi) {
+      answer.mantissa &= ~uint64_t(1);
+    }
+  }
+
+  answer.mantissa += (answer.mantissa & 1);
+  answer.mantissa >>= 1;
+  if (answer.mantissa >= (uint64_t(2) << format::kMantissaExplicitBits)) {
+    answer.mantissa = uint64_t(1) << format::kMantissaExplicitBits;
+    answer.power2++;
+  }
+  answer.mantissa &= ~(uint64_t(1) << format::kMantissaExplicitBits);
+  if (answer.power2 >= format::kInfinitePower) {
+    answer.power2 = format::kInfinitePower;
+    answer.mantissa = 0;
+  }
+  return answer;
+}
+
+template <typename FloatType>
+FloatType MakeFloat(bool negative, const AdjustedMantissa& am) {
+  typedef typename BinaryFormat<FloatType>::bits_type bits_type;
+  const bits_type bits = static_cast<bits_type>(am.mantissa) |
+                         (static_cast<bits_type>(am.power2) << BinaryFormat<FloatType>::kMantissaExplicitBits) |
+                         (static_cast<bits_type>(negative) << (sizeof(bits_type) * 8 - 1));
+  FloatType value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Correctly rounded conversion of plain decimal numbers. Returns false when
+// |input| needs strtod: not a plain decimal number or a truncated significand
+// right at a rounding boundary.
+template <typename FloatType>
+bool DecimalToFloat(StringPiece input, FloatType* output) {
+  typedef BinaryFormat<FloatType> format;
+  DecimalNumber number;
+  if (!ParseDecimalNumber(input, &number)) {
+    return false;
+  }
+
+  // Clinger: w and 10^|q| are exact, so a single IEEE operation rounds right.
+  if (kExactFloatArithmetic && !number.truncated && number.q >= -format::kMaxExponentFastPath &&
+      number.q <= format::kMaxExponentFastPath &&
+      number.w <= (uint64_t(2) << format::kMantissaExplicitBits)) {
+    FloatType value = static_cast<FloatType>(number.w);
+    if (number.q < 0) {
+      value /= format::ExactPowerOfTen(-number.q);
+    } else {
+      value *= format::ExactPowerOfTen(number.q);
+    }
+    *output = number.negative ? -value : value;
+    return true;
+  }
+
+  const AdjustedMantissa am = ComputeFloat<FloatType>(number.q, number.w);
+  if (number.truncated) {
+    // The exact significand lies in [w, w + 1), both ends must round alike.
+    const AdjustedMantissa upper = ComputeFloat<FloatType>(number.q, number.w + 1);
+    if (am.mantissa != upper.mantissa || am.power2 != upper.power2) {
+      return false;
+    }
+  }
+  *output = MakeFloat<FloatType>(number.negative, am);
+  return true;
+}
+
+// Shared by StringToDouble/StringToFloat: same contract as StringToInt, plus
+// false for finite input overflowing to infinity. inf and nan spelled out are
+// accepted through strtod.
+template <typename FloatType>
+bool StringToFloatImpl(StringPiece input, FloatType* output) {
+  if (DecimalToFloat(input, output)) {
+    return std::isfinite(*output);
+  }
+
+  // strtod needs a null terminated string.
+  const std::string str = input.as_string();
+  char* end = nullptr;
+  errno = 0;
+  *output = BinaryFormat<FloatType>::StrTo(str.c_str(), &end);
+  if (end == str.c_str()) {
+    *output = 0;
+    return false;
+  }
+  const bool overflow = errno == ERANGE && std::isinf(*output);
+  return !overflow && end == str.c_str() + str.size() && !LocalIsWhitespace(str[0]);
+}
+
 // IteratorRangeToNumberTraits should provide:
 //  - a typedef for iterator_type, the iterator type used as input.
 //  - a typedef for value_type, the target numeric type.
@@ -325,7 +1319,7 @@ class StringPieceToNumberTraits : public BaseIteratorRangeToNumberTraits<StringP
 
 template <typename VALUE>
 bool StringToIntImpl(StringPiece input, VALUE* output) {
-  return IteratorRangeToNumber<StringPieceToNumberTraits<VALUE, 10>>::Invoke(input.begin(), input.end(), output);
+  return DecimalToInt(input, output);
 }
 
 template <typename VALUE, int BASE>
@@ -388,55 +1382,12 @@ string16 NumberToString16(unsigned long long value) {
 }
 
 std::string NumberToString(float value, int prec) {
-  if (value == std::numeric_limits<float>::infinity()) {
-    return PPLUS_INF;
-  }
-  if (value == std::numeric_limits<float>::infinity()) {
-    return MINUS_INF;
-  }
-
-  char buffer[16];
-  if (prec == 0) {
-    SNPrintf(buffer, sizeof(buffer), "%.0f", value);
-  } else if (prec == 1) {
-    SNPrintf(buffer, sizeof(buffer), "%.1f", value);
-  } else if (prec == 2) {
-    SNPrintf(buffer, sizeof(buffer), "%.2f", value);
-  } else if (prec == 3) {
-    SNPrintf(buffer, sizeof(buffer), "%.3f", value);
-  } else if (prec == 4) {
-    SNPrintf(buffer, sizeof(buffer), "%.4f", value);
-  } else {
-    SNPrintf(buffer, sizeof(buffer), "%f", value);
-  }
-
-  return buffer;
+  return NumberToString(static_cast<double>(value), prec);
 }
 
 std::string NumberToString(double value, int prec) {
-  if (value == std::numeric_limits<double>::infinity()) {
-    return PPLUS_INF;
-  }
-  if (value == std::numeric_limits<double>::infinity()) {
-    return MINUS_INF;
-  }
-
-  char buffer[32];
-  if (prec == 0) {
-    SNPrintf(buffer, sizeof(buffer), "%.0lf", value);
-  } else if (prec == 1) {
-    SNPrintf(buffer, sizeof(buffer), "%.1lf", value);
-  } else if (prec == 2) {
-    SNPrintf(buffer, sizeof(buffer), "%.2lf", value);
-  } else if (prec == 3) {
-    SNPrintf(buffer, sizeof(buffer), "%.3lf", value);
-  } else if (prec == 4) {
-    SNPrintf(buffer, sizeof(buffer), "%.4lf", value);
-  } else {
-    SNPrintf(buffer, sizeof(buffer), "%lf", value);
-  }
-
-  return buffer;
+  char buffer[kMaxFixedChars];
+  return std::string(buffer, FixedToChars(value, prec, buffer));
 }
 
 string16 NumberToString16(float value, int prec) {
@@ -457,6 +1408,56 @@ string16 NumberToString16(double value, int prec) {
 #endif
 }
 
+std::string NumberToShortestString(float value) {
+  char buffer[kMaxShortestChars];
+  return std::string(buffer, ShortestToChars(value, buffer));
+}
+
+std::string NumberToShortestString(double value) {
+  char buffer[kMaxShortestChars];
+  return std::string(buffer, ShortestToChars(value, buffer));
+}
+
+size_t NumberToChars(int value, span<char> out) {
+  return IntToStringT<std::string, int, unsigned int, true>::IntToChars(value, out);
+}
+
+size_t NumberToChars(unsigned int value, span<char> out) {
+  return IntToStringT<std::string, unsigned int, unsigned int, false>::IntToChars(value, out);
+}
+
+size_t NumberToChars(long value, span<char> out) {
+  return IntToStringT<std::string, long, unsigned long, true>::IntToChars(value, out);
+}
+
+size_t NumberToChars(unsigned long value, span<char> out) {
+  return IntToStringT<std::string, unsigned long, unsigned long, false>::IntToChars(value, out);
+}
+
+size_t NumberToChars(long long value, span<char> out) {
+  return IntToStringT<std::string, long long, unsigned long long, true>::IntToChars(value, out);
+}
+
+size_t NumberToChars(unsigned long long value, span<char> out) {
+  return IntToStringT<std::string, unsigned long long, unsigned long long, false>::IntToChars(value, out);
+}
+
+size_t NumberToChars(float value, int prec, span<char> out) {
+  return FixedToChars(value, prec, out);
+}
+
+size_t NumberToChars(double value, int prec, span<char> out) {
+  return FixedToChars(value, prec, out);
+}
+
+size_t NumberToShortestChars(float value, span<char> out) {
+  return ShortestToChars(value, out);
+}
+
+size_t NumberToShortestChars(double value, span<char> out) {
+  return ShortestToChars(value, out);
+}
+
 bool StringToInt(StringPiece input, int* output) {
   return StringToIntImpl(input, output);
 }
@@ -497,13 +1498,17 @@ bool StringToSizeT(StringPiece16 input, size_t* output) {
   return String16ToIntImpl(input, output);
 }
 
-/*bool StringToDouble(StringPiece input, double* output) {
-  return StringToDoubleImpl(input, input.data(), output);
+bool StringToDouble(StringPiece input, double* output) {
+  return StringToFloatImpl(input, output);
 }
 
 bool StringToDouble(StringPiece16 input, double* output) {
-  return StringToDoubleImpl(input, reinterpret_cast<const uint16_t*>(input.data()), output);
-}*/
+  return StringToFloatImpl(StringPiece(UTF16ToUTF8(input.as_string())), output);
+}
+
+bool StringToFloat(StringPiece input, float* output) {
+  return StringToFloatImpl(input, output);
+}
 
 std::string HexEncode(const void* bytes, size_t size) {
   static const char kHexChars[] = "0123456789ABCDEF";
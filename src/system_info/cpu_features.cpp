@@ -0,0 +1,103 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/system_info/cpu_features.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define COMMON_CPUID_X86
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define COMMON_CPUID_X86
+#endif
+
+namespace common {
+namespace system_info {
+namespace {
+
+#if defined(COMMON_CPUID_X86)
+void Cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = static_cast<unsigned>(info[i]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+unsigned long long XGetBV() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+}  // namespace
+
+CpuFeatures::CpuFeatures()
+    : sse42(false), pclmul(false), avx2(false), sha(false) {
+#if defined(COMMON_CPUID_X86)
+  unsigned regs[4] = {0, 0, 0, 0};
+  Cpuid(0, 0, regs);
+  const unsigned max_leaf = regs[0];
+  if (max_leaf < 1) {
+    return;
+  }
+
+  Cpuid(1, 0, regs);
+  const unsigned ecx1 = regs[2];
+  sse42 = (ecx1 & (1u << 20)) != 0;
+  pclmul = (ecx1 & (1u << 1)) != 0;
+  const bool osxsave = (ecx1 & (1u << 27)) != 0;
+  const bool avx = (ecx1 & (1u << 28)) != 0;
+  // ymm state must be enabled by the os
+  const bool ymm_enabled = osxsave && (XGetBV() & 0x6) == 0x6;
+
+  if (max_leaf >= 7) {
+    Cpuid(7, 0, regs);
+    avx2 = avx && ymm_enabled && (regs[1] & (1u << 5)) != 0;
+    sha = (regs[1] & (1u << 29)) != 0;
+  }
+#endif
+}
+
+const CpuFeatures& CurrentCpuFeatures() {
+  static const CpuFeatures features;
+  return features;
+}
+
+}  // namespace system_info
+}  // namespace common
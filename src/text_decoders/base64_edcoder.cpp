@@ -30,6 +30,7 @@
 #include <common/text_decoders/base64_edcoder.h>
 
 #include <common/compress/base64.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
@@ -51,4 +52,19 @@ Error Base64EDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out) {
   return compress::DecodeBase64(data, out);
 }
 
+Error Base64EDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+  // 3 bytes -> 4 chars, so aligned pieces are encoded without padding
+  *stream = new BlockEDcoderStream(3, [](const StringPiece& data, char_buffer_t* out) {
+    return compress::EncodeBase64(data, out);
+  });
+  return Error();
+}
+
+Error Base64EDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+  *stream = new BlockEDcoderStream(4, [](const StringPiece& data, char_buffer_t* out) {
+    return compress::DecodeBase64(data, out);
+  });
+  return Error();
+}
+
 }  // namespace common
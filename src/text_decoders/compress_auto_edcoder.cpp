@@ -0,0 +1,288 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/text_decoders/compress_auto_edcoder.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include <common/compress/lz4_compress.h>
+#include <common/compress/snappy_compress.h>
+#include <common/compress/zlib_compress.h>
+
+namespace common {
+namespace {
+
+int CodecIndex(EDType codec) {
+  switch (codec) {
+    case ED_NONE:
+      return 0;
+    case ED_LZ4:
+      return 1;
+    case ED_SNAPPY:
+      return 2;
+    case ED_ZLIB:
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+EDType FastCodec() {
+#if defined(HAVE_LZ4)
+  return ED_LZ4;
+#elif defined(HAVE_SNAPPY)
+  return ED_SNAPPY;
+#elif defined(HAVE_ZLIB)
+  return ED_ZLIB;
+#else
+  return ED_NONE;
+#endif
+}
+
+#if defined(HAVE_ZLIB)
+// Contexts are per thread, the coder itself stays shareable.
+compress::ZlibCompressor* ThreadZlibCompressor(int compression_level) {
+  static thread_local std::unique_ptr<compress::ZlibCompressor> compressor;
+  if (!compressor || compressor->GetCompressionLevel() != compression_level) {
+    compressor.reset(new compress::ZlibCompressor(0, compression_level));
+  }
+  return compressor.get();
+}
+
+int ZlibLevel(CompressAutoEDcoder::CpuBudget budget) {
+  if (budget == CompressAutoEDcoder::CPU_BUDGET_LOW) {
+    return Z_BEST_SPEED;
+  } else if (budget == CompressAutoEDcoder::CPU_BUDGET_HIGH) {
+    return Z_BEST_COMPRESSION;
+  }
+  return Z_DEFAULT_COMPRESSION;
+}
+#endif
+
+#if defined(HAVE_LZ4)
+compress::LZ4Compressor* ThreadLZ4Compressor() {
+  static thread_local std::unique_ptr<compress::LZ4Compressor> compressor(new compress::LZ4Compressor);
+  return compressor.get();
+}
+#endif
+
+// Appends the compressed payload after the tag byte already in |out|.
+Error EncodePayload(EDType codec, CompressAutoEDcoder::CpuBudget budget, const StringPiece& data, char_buffer_t* out) {
+  UNUSED(budget);
+  UNUSED(data);
+  UNUSED(out);
+  switch (codec) {
+#if defined(HAVE_LZ4)
+    case ED_LZ4:
+      return ThreadLZ4Compressor()->Encode(data, true, out);
+#endif
+#if defined(HAVE_ZLIB)
+    case ED_ZLIB:
+      return ThreadZlibCompressor(ZlibLevel(budget))->Encode(data, true, out);
+#endif
+#if defined(HAVE_SNAPPY)
+    case ED_SNAPPY: {
+      char_buffer_t payload;
+      Error err = compress::EncodeSnappy(data, &payload);
+      if (err) {
+        return err;
+      }
+      out->insert(out->end(), payload.begin(), payload.end());
+      return Error();
+    }
+#endif
+    default:
+      return make_error("ED_AUTO codec not supported: " + ConvertToString(codec));
+  }
+}
+
+Error DecodePayload(EDType codec, const StringPiece& payload, char_buffer_t* out) {
+  switch (codec) {
+    case ED_NONE:
+      out->assign(payload.begin(), payload.end());
+      return Error();
+#if defined(HAVE_LZ4)
+    case ED_LZ4:
+      return compress::DecodeLZ4(payload, true, out);
+#endif
+#if defined(HAVE_ZLIB)
+    case ED_ZLIB:
+      return compress::DecodeZlib(payload, true, out);
+#endif
+#if defined(HAVE_SNAPPY)
+    case ED_SNAPPY:
+      return compress::DecodeSnappy(payload, out);
+#endif
+    default:
+      return make_error("ED_AUTO codec not supported: " + ConvertToString(codec));
+  }
+}
+
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+}  // namespace
+
+const double CompressAutoEDcoder::ENTROPY_LIMIT = 7.5;
+
+CompressAutoEDcoder::CompressAutoEDcoder(CpuBudget budget)
+    : IEDcoder(ED_AUTO), budget_(budget), encode_stats_(), decode_stats_() {}
+
+CompressAutoEDcoder::CpuBudget CompressAutoEDcoder::GetCpuBudget() const {
+  return budget_;
+}
+
+CompressAutoEDcoder::CodecStats CompressAutoEDcoder::GetEncodeStats(EDType codec) const {
+  const int index = CodecIndex(codec);
+  if (index < 0) {
+    return CodecStats();
+  }
+  return LoadStats(encode_stats_[index]);
+}
+
+CompressAutoEDcoder::CodecStats CompressAutoEDcoder::GetDecodeStats(EDType codec) const {
+  const int index = CodecIndex(codec);
+  if (index < 0) {
+    return CodecStats();
+  }
+  return LoadStats(decode_stats_[index]);
+}
+
+double CompressAutoEDcoder::SampleEntropy(const StringPiece& data) {
+  if (data.empty()) {
+    return 0;
+  }
+
+  uint32_t histogram[256] = {0};
+  for (size_t i = 0; i < data.size(); ++i) {
+    histogram[static_cast<unsigned char>(data[i])]++;
+  }
+
+  double entropy = 0;
+  const double total = static_cast<double>(data.size());
+  for (uint32_t count : histogram) {
+    if (count) {
+      const double p = count / total;
+      entropy -= p * log2(p);
+    }
+  }
+  return entropy;
+}
+
+EDType CompressAutoEDcoder::SelectCodec(const StringPiece& data) const {
+  if (data.size() < MIN_COMPRESS_SIZE) {
+    return ED_NONE;
+  }
+
+  const StringPiece sample(data.data(), std::min<size_t>(data.size(), SAMPLE_SIZE));
+  if (SampleEntropy(sample) > ENTROPY_LIMIT) {
+    return ED_NONE;
+  }
+
+#if defined(HAVE_ZLIB)
+  if (budget_ == CPU_BUDGET_HIGH || (budget_ == CPU_BUDGET_NORMAL && data.size() <= SMALL_PAYLOAD_SIZE)) {
+    return ED_ZLIB;
+  }
+#endif
+  return FastCodec();
+}
+
+CompressAutoEDcoder::CodecStats CompressAutoEDcoder::LoadStats(const AtomicCodecStats& stats) {
+  CodecStats result;
+  result.calls = stats.calls.load(std::memory_order_relaxed);
+  result.bytes_in = stats.bytes_in.load(std::memory_order_relaxed);
+  result.bytes_out = stats.bytes_out.load(std::memory_order_relaxed);
+  result.time_ns = stats.time_ns.load(std::memory_order_relaxed);
+  return result;
+}
+
+void CompressAutoEDcoder::UpdateStats(AtomicCodecStats* stats, size_t bytes_in, size_t bytes_out, uint64_t time_ns) {
+  stats->calls.fetch_add(1, std::memory_order_relaxed);
+  stats->bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+  stats->bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+  stats->time_ns.fetch_add(time_ns, std::memory_order_relaxed);
+}
+
+Error CompressAutoEDcoder::DoEncode(const StringPiece& data, char_buffer_t* out) {
+  const auto start = std::chrono::steady_clock::now();
+  EDType codec = SelectCodec(data);
+  out->clear();
+  if (codec != ED_NONE) {
+    out->reserve(data.size() + 1);
+    out->push_back(static_cast<char>(codec));
+    Error err = EncodePayload(codec, budget_, data, out);
+    if (err) {
+      return err;
+    }
+    if (out->size() > data.size()) {  // did not pay off
+      codec = ED_NONE;
+    }
+  }
+
+  if (codec == ED_NONE) {
+    out->assign(1, static_cast<char>(ED_NONE));
+    out->insert(out->end(), data.begin(), data.end());
+  }
+
+  UpdateStats(&encode_stats_[CodecIndex(codec)], data.size(), out->size(), ElapsedNs(start));
+  return Error();
+}
+
+Error CompressAutoEDcoder::DoDecode(const StringPiece& data, char_buffer_t* out) {
+  const auto start = std::chrono::steady_clock::now();
+  const EDType codec = static_cast<EDType>(static_cast<unsigned char>(data[0]));
+  const int index = CodecIndex(codec);
+  if (index < 0) {
+    return make_error_inval();
+  }
+
+  Error err = DecodePayload(codec, StringPiece(data.data() + 1, data.size() - 1), out);
+  if (err) {
+    return err;
+  }
+
+  UpdateStats(&decode_stats_[index], data.size(), out->size(), ElapsedNs(start));
+  return Error();
+}
+
+Error CompressAutoEDcoder::DoEncode(const char_buffer_t& data, char_buffer_t* out) {
+  return DoEncode(StringPiece(data.data(), data.size()), out);
+}
+
+Error CompressAutoEDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out) {
+  return DoDecode(StringPiece(data.data(), data.size()), out);
+}
+
+}  // namespace common
@@ -29,11 +29,153 @@
 
 #include <common/text_decoders/compress_bzip2_edcoder.h>
 
+#if defined(HAVE_BZIP2)
+#include <string.h>
+
+#include <bzlib.h>
+#endif
+
 #include <common/compress/bzip2_compress.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
-CompressBZip2EDcoder::CompressBZip2EDcoder(bool sized) : IEDcoder(ED_ZLIB), sized_(sized) {}
+#if defined(HAVE_BZIP2)
+namespace {
+
+// (de)compressor output is drained by pieces of this size
+const size_t kBZip2StreamOutStep = 64 * 1024;
+
+class BZip2EncodeStream : public IEDcoderStream {
+ public:
+  BZip2EncodeStream() : IEDcoderStream(), stream_(), inited_(false) { memset(&stream_, 0, sizeof(bz_stream)); }
+
+  ~BZip2EncodeStream() override {
+    if (inited_) {
+      BZ2_bzCompressEnd(&stream_);
+    }
+  }
+
+  Error Init() WARN_UNUSED_RESULT {
+    // same block size and work factor as compress::EncodeBZip2
+    int st = BZ2_bzCompressInit(&stream_, 1, 0, 30);
+    if (st != BZ_OK) {
+      return make_error("BZip2 compress internal error");
+    }
+
+    inited_ = true;
+    return Error();
+  }
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    stream_.next_in = const_cast<char*>(data.data());
+    stream_.avail_in = static_cast<unsigned int>(data.size());
+    while (stream_.avail_in != 0) {
+      int st = Compress(BZ_RUN, out);
+      if (st != BZ_RUN_OK) {
+        return make_error("BZip2 compress internal error");
+      }
+    }
+    return Error();
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    stream_.next_in = nullptr;
+    stream_.avail_in = 0;
+    while (true) {
+      int st = Compress(BZ_FINISH, out);
+      if (st == BZ_STREAM_END) {
+        return Error();
+      }
+
+      if (st != BZ_FINISH_OK) {
+        return make_error("BZip2 compress internal error");
+      }
+    }
+  }
+
+  int Compress(int action, char_buffer_t* out) {
+    stream_.next_out = buffer_;
+    stream_.avail_out = static_cast<unsigned int>(sizeof(buffer_));
+    int st = BZ2_bzCompress(&stream_, action);
+    out->insert(out->end(), buffer_, buffer_ + sizeof(buffer_) - stream_.avail_out);
+    return st;
+  }
+
+  bz_stream stream_;
+  bool inited_;
+  char buffer_[kBZip2StreamOutStep];
+};
+
+class BZip2DecodeStream : public IEDcoderStream {
+ public:
+  BZip2DecodeStream() : IEDcoderStream(), stream_(), inited_(false), ended_(false) {
+    memset(&stream_, 0, sizeof(bz_stream));
+  }
+
+  ~BZip2DecodeStream() override {
+    if (inited_) {
+      BZ2_bzDecompressEnd(&stream_);
+    }
+  }
+
+  Error Init() WARN_UNUSED_RESULT {
+    int st = BZ2_bzDecompressInit(&stream_, 0, 0);
+    if (st != BZ_OK) {
+      return make_error("BZip2 decompress internal error");
+    }
+
+    inited_ = true;
+    return Error();
+  }
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    if (ended_) {
+      return Error();
+    }
+
+    stream_.next_in = const_cast<char*>(data.data());
+    stream_.avail_in = static_cast<unsigned int>(data.size());
+    while (true) {
+      stream_.next_out = buffer_;
+      stream_.avail_out = static_cast<unsigned int>(sizeof(buffer_));
+      int st = BZ2_bzDecompress(&stream_);
+      out->insert(out->end(), buffer_, buffer_ + sizeof(buffer_) - stream_.avail_out);
+      if (st == BZ_STREAM_END) {
+        ended_ = true;
+        return Error();
+      }
+
+      if (st != BZ_OK) {
+        return make_error("BZip2 decompress internal error");
+      }
+
+      if (stream_.avail_out != 0) {
+        return Error();
+      }
+    }
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    UNUSED(out);
+    if (!ended_) {
+      return make_error("BZip2 decompress unexpected end of stream");
+    }
+    return Error();
+  }
+
+  bz_stream stream_;
+  bool inited_;
+  bool ended_;
+  char buffer_[kBZip2StreamOutStep];
+};
+
+}  // namespace
+#endif
+
+CompressBZip2EDcoder::CompressBZip2EDcoder(bool sized) : IEDcoder(ED_BZIP2), sized_(sized) {}
 
 Error CompressBZip2EDcoder::DoEncode(const StringPiece& data, char_buffer_t* out) {
 #if defined(HAVE_BZIP2)
@@ -75,4 +217,46 @@ Error CompressBZip2EDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* o
 #endif
 }
 
+Error CompressBZip2EDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_BZIP2)
+  if (sized_) {  // size header needs whole input
+    return make_error("ED_BZIP2 sized stream encode not supported");
+  }
+
+  BZip2EncodeStream* bstream = new BZip2EncodeStream;
+  Error err = bstream->Init();
+  if (err) {
+    delete bstream;
+    return err;
+  }
+
+  *stream = bstream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_BZIP2 stream encode not supported");
+#endif
+}
+
+Error CompressBZip2EDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_BZIP2)
+  if (sized_) {
+    return make_error("ED_BZIP2 sized stream decode not supported");
+  }
+
+  BZip2DecodeStream* bstream = new BZip2DecodeStream;
+  Error err = bstream->Init();
+  if (err) {
+    delete bstream;
+    return err;
+  }
+
+  *stream = bstream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_BZIP2 stream decode not supported");
+#endif
+}
+
 }  // namespace common
@@ -29,14 +29,174 @@
 
 #include <common/text_decoders/compress_lz4_edcoder.h>
 
+#if defined(HAVE_LZ4)
+#include <string.h>
+
+#include <algorithm>
+
+#include <lz4frame.h>
+#endif
+
 #include <common/compress/lz4_compress.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
-CompressLZ4EDcoder::CompressLZ4EDcoder(bool sized) : IEDcoder(ED_LZ4), sized_(sized) {}
+#if defined(HAVE_LZ4)
+namespace {
+
+// input is compressed and output decompressed by pieces of this size
+const size_t kLZ4StreamStep = 64 * 1024;
+
+// LZ4 frame format (lz4 utility compatible), not the raw blocks of compress::EncodeLZ4
+class LZ4EncodeStream : public IEDcoderStream {
+ public:
+  LZ4EncodeStream() : IEDcoderStream(), ctx_(nullptr), prefs_(), started_(false), buffer_() {
+    memset(&prefs_, 0, sizeof(LZ4F_preferences_t));
+  }
+
+  ~LZ4EncodeStream() override {
+    if (ctx_) {
+      LZ4F_freeCompressionContext(ctx_);
+    }
+  }
+
+  Error Init() WARN_UNUSED_RESULT {
+    LZ4F_errorCode_t st = LZ4F_createCompressionContext(&ctx_, LZ4F_VERSION);
+    if (LZ4F_isError(st)) {
+      return make_error(std::string("LZ4 compress internal error: ") + LZ4F_getErrorName(st));
+    }
+
+    // worst case output of one piece, enough for the frame header and end as well
+    buffer_.resize(LZ4F_compressBound(kLZ4StreamStep, &prefs_));
+    return Error();
+  }
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    Error err = Begin(out);
+    if (err) {
+      return err;
+    }
+
+    for (size_t pos = 0; pos < data.size(); pos += kLZ4StreamStep) {
+      const size_t size = std::min(kLZ4StreamStep, data.size() - pos);
+      size_t st = LZ4F_compressUpdate(ctx_, buffer_.data(), buffer_.size(), data.data() + pos, size, nullptr);
+      if (LZ4F_isError(st)) {
+        return make_error(std::string("LZ4 compress internal error: ") + LZ4F_getErrorName(st));
+      }
+      out->insert(out->end(), buffer_.begin(), buffer_.begin() + st);
+    }
+    return Error();
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    Error err = Begin(out);
+    if (err) {
+      return err;
+    }
+
+    size_t st = LZ4F_compressEnd(ctx_, buffer_.data(), buffer_.size(), nullptr);
+    if (LZ4F_isError(st)) {
+      return make_error(std::string("LZ4 compress internal error: ") + LZ4F_getErrorName(st));
+    }
+    out->insert(out->end(), buffer_.begin(), buffer_.begin() + st);
+    return Error();
+  }
+
+  Error Begin(char_buffer_t* out) {
+    if (started_) {
+      return Error();
+    }
+
+    size_t st = LZ4F_compressBegin(ctx_, buffer_.data(), buffer_.size(), &prefs_);
+    if (LZ4F_isError(st)) {
+      return make_error(std::string("LZ4 compress internal error: ") + LZ4F_getErrorName(st));
+    }
+    out->insert(out->end(), buffer_.begin(), buffer_.begin() + st);
+    started_ = true;
+    return Error();
+  }
+
+  LZ4F_cctx* ctx_;
+  LZ4F_preferences_t prefs_;
+  bool started_;
+  char_buffer_t buffer_;
+};
+
+class LZ4DecodeStream : public IEDcoderStream {
+ public:
+  LZ4DecodeStream() : IEDcoderStream(), ctx_(nullptr), ended_(false) {}
+
+  ~LZ4DecodeStream() override {
+    if (ctx_) {
+      LZ4F_freeDecompressionContext(ctx_);
+    }
+  }
+
+  Error Init() WARN_UNUSED_RESULT {
+    LZ4F_errorCode_t st = LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION);
+    if (LZ4F_isError(st)) {
+      return make_error(std::string("LZ4 decompress internal error: ") + LZ4F_getErrorName(st));
+    }
+    return Error();
+  }
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    if (ended_) {
+      return Error();
+    }
+
+    const char* src = data.data();
+    size_t left = data.size();
+    while (true) {
+      size_t dst_size = sizeof(buffer_);
+      size_t src_size = left;
+      size_t st = LZ4F_decompress(ctx_, buffer_, &dst_size, src, &src_size, nullptr);
+      out->insert(out->end(), buffer_, buffer_ + dst_size);
+      if (LZ4F_isError(st)) {
+        return make_error(std::string("LZ4 decompress internal error: ") + LZ4F_getErrorName(st));
+      }
+
+      src += src_size;
+      left -= src_size;
+      if (st == 0) {  // end of frame
+        ended_ = true;
+        return Error();
+      }
+
+      // input consumed and nothing buffered
+      if (left == 0 && dst_size < sizeof(buffer_)) {
+        return Error();
+      }
+    }
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    UNUSED(out);
+    if (!ended_) {
+      return make_error("LZ4 decompress unexpected end of stream");
+    }
+    return Error();
+  }
+
+  LZ4F_dctx* ctx_;
+  bool ended_;
+  char buffer_[kLZ4StreamStep];
+};
+
+}  // namespace
+#endif
+
+CompressLZ4EDcoder::CompressLZ4EDcoder(bool sized, compress::CompressDictionarySPtr dictionary)
+    : IEDcoder(ED_LZ4), sized_(sized), dictionary_(dictionary) {}
 
 Error CompressLZ4EDcoder::DoEncode(const StringPiece& data, char_buffer_t* out) {
 #if defined(HAVE_LZ4)
+  if (dictionary_) {
+    return compress::EncodeLZ4(data, sized_, dictionary_, out);
+  }
   return compress::EncodeLZ4(data, sized_, out);
 #else
   UNUSED(data);
@@ -47,6 +207,9 @@ Error CompressLZ4EDcoder::DoEncode(const StringPiece& data, char_buffer_t* out)
 
 Error CompressLZ4EDcoder::DoDecode(const StringPiece& data, char_buffer_t* out) {
 #if defined(HAVE_LZ4)
+  if (dictionary_) {
+    return compress::DecodeLZ4(data, sized_, dictionary_, out);
+  }
   return compress::DecodeLZ4(data, sized_, out);
 #else
   UNUSED(data);
@@ -57,6 +220,9 @@ Error CompressLZ4EDcoder::DoDecode(const StringPiece& data, char_buffer_t* out)
 
 Error CompressLZ4EDcoder::DoEncode(const char_buffer_t& data, char_buffer_t* out) {
 #if defined(HAVE_LZ4)
+  if (dictionary_) {
+    return compress::EncodeLZ4(data, sized_, dictionary_, out);
+  }
   return compress::EncodeLZ4(data, sized_, out);
 #else
   UNUSED(data);
@@ -67,6 +233,9 @@ Error CompressLZ4EDcoder::DoEncode(const char_buffer_t& data, char_buffer_t* out
 
 Error CompressLZ4EDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out) {
 #if defined(HAVE_LZ4)
+  if (dictionary_) {
+    return compress::DecodeLZ4(data, sized_, dictionary_, out);
+  }
   return compress::DecodeLZ4(data, sized_, out);
 #else
   UNUSED(data);
@@ -75,4 +244,54 @@ Error CompressLZ4EDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out
 #endif
 }
 
+Error CompressLZ4EDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_LZ4)
+  if (sized_) {  // size header needs whole input
+    return make_error("ED_LZ4 sized stream encode not supported");
+  }
+
+  if (dictionary_) {  // frame dictionaries need the static-only LZ4F API
+    return make_error("ED_LZ4 dictionary stream encode not supported");
+  }
+
+  LZ4EncodeStream* lstream = new LZ4EncodeStream;
+  Error err = lstream->Init();
+  if (err) {
+    delete lstream;
+    return err;
+  }
+
+  *stream = lstream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_LZ4 stream encode not supported");
+#endif
+}
+
+Error CompressLZ4EDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_LZ4)
+  if (sized_) {
+    return make_error("ED_LZ4 sized stream decode not supported");
+  }
+
+  if (dictionary_) {  // frame dictionaries need the static-only LZ4F API
+    return make_error("ED_LZ4 dictionary stream decode not supported");
+  }
+
+  LZ4DecodeStream* lstream = new LZ4DecodeStream;
+  Error err = lstream->Init();
+  if (err) {
+    delete lstream;
+    return err;
+  }
+
+  *stream = lstream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_LZ4 stream decode not supported");
+#endif
+}
+
 }  // namespace common
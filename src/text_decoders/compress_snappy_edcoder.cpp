@@ -29,10 +29,228 @@
 
 #include <common/text_decoders/compress_snappy_edcoder.h>
 
+#if defined(HAVE_SNAPPY)
+#include <string.h>
+
+#include <algorithm>
+
+#include <snappy.h>
+
+#include <common/hash/crc.h>
+#endif
+
 #include <common/compress/snappy_compress.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
+#if defined(HAVE_SNAPPY)
+namespace {
+
+// Snappy framing format (framing_format.txt of the snappy project): a stream
+// identifier chunk, then chunks of at most 64 KiB of input, each with the
+// masked CRC-32C of its uncompressed data.
+const size_t kSnappyStreamBlock = 64 * 1024;
+const size_t kSnappyChunkHeaderSize = 4;  // type + 24 bit little endian length
+const size_t kSnappyChecksumSize = 4;
+const char kSnappyStreamIdentifier[] = "\xff\x06\x00\x00sNaPpY";
+const size_t kSnappyStreamIdentifierSize = sizeof(kSnappyStreamIdentifier) - 1;
+
+enum SnappyChunkType : unsigned char {
+  SNAPPY_CHUNK_COMPRESSED = 0x00,
+  SNAPPY_CHUNK_UNCOMPRESSED = 0x01,
+  SNAPPY_CHUNK_LAST_UNSKIPPABLE = 0x7f,
+  SNAPPY_CHUNK_STREAM_IDENTIFIER = 0xff
+};
+
+uint32_t MaskedCrc32c(const char* data, size_t size) {
+  const uint32_t crc = hash::crc32c(0, data, size);
+  return ((crc >> 15) | (crc << 17)) + 0xa282ead8;
+}
+
+void PutLittleEndian(char* dst, uint32_t value, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint32_t GetLittleEndian(const char* src, size_t size) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(src[i])) << (8 * i);
+  }
+  return value;
+}
+
+void EncodeSnappyChunk(const char* data, size_t size, char_buffer_t* out) {
+  const size_t header_pos = out->size();
+  out->resize(header_pos + kSnappyChunkHeaderSize + kSnappyChecksumSize + snappy::MaxCompressedLength(size));
+  char* header = out->data() + header_pos;
+  char* body = header + kSnappyChunkHeaderSize + kSnappyChecksumSize;
+  size_t body_len = 0;
+  snappy::RawCompress(data, size, body, &body_len);
+  SnappyChunkType type = SNAPPY_CHUNK_COMPRESSED;
+  if (body_len >= size - size / 8) {  // as the reference encoder, keep data which hardly compresses as is
+    memcpy(body, data, size);
+    body_len = size;
+    type = SNAPPY_CHUNK_UNCOMPRESSED;
+  }
+
+  header[0] = static_cast<char>(type);
+  PutLittleEndian(header + 1, static_cast<uint32_t>(kSnappyChecksumSize + body_len), 3);
+  PutLittleEndian(header + kSnappyChunkHeaderSize, MaskedCrc32c(data, size), kSnappyChecksumSize);
+  out->resize(header_pos + kSnappyChunkHeaderSize + kSnappyChecksumSize + body_len);
+}
+
+class SnappyEncodeStream : public IEDcoderStream {
+ public:
+  SnappyEncodeStream() : IEDcoderStream(), started_(false), pending_() {}
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    Start(out);
+    const char* ptr = data.data();
+    size_t left = data.size();
+    if (!pending_.empty()) {
+      const size_t size = std::min(left, kSnappyStreamBlock - pending_.size());
+      pending_.insert(pending_.end(), ptr, ptr + size);
+      ptr += size;
+      left -= size;
+      if (pending_.size() < kSnappyStreamBlock) {
+        return Error();
+      }
+      EncodeSnappyChunk(pending_.data(), pending_.size(), out);
+      pending_.clear();
+    }
+
+    for (; left >= kSnappyStreamBlock; ptr += kSnappyStreamBlock, left -= kSnappyStreamBlock) {
+      EncodeSnappyChunk(ptr, kSnappyStreamBlock, out);
+    }
+    pending_.insert(pending_.end(), ptr, ptr + left);
+    return Error();
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    Start(out);
+    if (!pending_.empty()) {
+      EncodeSnappyChunk(pending_.data(), pending_.size(), out);
+      pending_.clear();
+    }
+    return Error();
+  }
+
+  void Start(char_buffer_t* out) {
+    if (!started_) {
+      out->insert(out->end(), kSnappyStreamIdentifier, kSnappyStreamIdentifier + kSnappyStreamIdentifierSize);
+      started_ = true;
+    }
+  }
+
+  bool started_;
+  char_buffer_t pending_;
+};
+
+class SnappyDecodeStream : public IEDcoderStream {
+ public:
+  SnappyDecodeStream() : IEDcoderStream(), identified_(false), pending_() {}
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    pending_.insert(pending_.end(), data.begin(), data.end());
+    const char* ptr = pending_.data();
+    size_t left = pending_.size();
+    Error err;
+    while (left >= kSnappyChunkHeaderSize) {
+      const unsigned char type = static_cast<unsigned char>(ptr[0]);
+      const size_t chunk_len = GetLittleEndian(ptr + 1, 3);
+      if (!identified_ && type != SNAPPY_CHUNK_STREAM_IDENTIFIER) {
+        err = make_error("Snappy stream doesn't start with a stream identifier");
+        break;
+      }
+      if ((type == SNAPPY_CHUNK_COMPRESSED || type == SNAPPY_CHUNK_UNCOMPRESSED) &&
+          (chunk_len < kSnappyChecksumSize ||
+           chunk_len > kSnappyChecksumSize + snappy::MaxCompressedLength(kSnappyStreamBlock))) {
+        err = make_error_inval();
+        break;
+      }
+      if (left - kSnappyChunkHeaderSize < chunk_len) {
+        break;
+      }
+
+      err = DecodeChunk(type, ptr + kSnappyChunkHeaderSize, chunk_len, out);
+      if (err) {
+        break;
+      }
+      ptr += kSnappyChunkHeaderSize + chunk_len;
+      left -= kSnappyChunkHeaderSize + chunk_len;
+    }
+
+    pending_.erase(pending_.begin(), pending_.begin() + (ptr - pending_.data()));
+    return err;
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    UNUSED(out);
+    if (!pending_.empty()) {
+      return make_error("Snappy decompress unexpected end of stream");
+    }
+    return Error();
+  }
+
+  Error DecodeChunk(unsigned char type, const char* chunk, size_t chunk_len, char_buffer_t* out) {
+    if (type == SNAPPY_CHUNK_STREAM_IDENTIFIER) {
+      // also repeated where streams were concatenated
+      if (chunk_len != kSnappyStreamIdentifierSize - kSnappyChunkHeaderSize ||
+          memcmp(chunk, kSnappyStreamIdentifier + kSnappyChunkHeaderSize, chunk_len) != 0) {
+        return make_error("Invalid snappy stream identifier");
+      }
+      identified_ = true;
+      return Error();
+    }
+
+    if (type != SNAPPY_CHUNK_COMPRESSED && type != SNAPPY_CHUNK_UNCOMPRESSED) {
+      if (type <= SNAPPY_CHUNK_LAST_UNSKIPPABLE) {
+        return make_error("Unsupported snappy chunk type");
+      }
+      return Error();  // padding and reserved skippable chunks
+    }
+
+    const uint32_t crc = GetLittleEndian(chunk, kSnappyChecksumSize);
+    const char* body = chunk + kSnappyChecksumSize;
+    const size_t body_len = chunk_len - kSnappyChecksumSize;
+    const size_t old_sz = out->size();
+    if (type == SNAPPY_CHUNK_COMPRESSED) {
+      size_t uncompressed_len = 0;
+      if (!snappy::GetUncompressedLength(body, body_len, &uncompressed_len) || uncompressed_len > kSnappyStreamBlock) {
+        return make_error_inval();
+      }
+
+      out->resize(old_sz + uncompressed_len);
+      if (!snappy::RawUncompress(body, body_len, out->data() + old_sz)) {
+        out->resize(old_sz);
+        return make_error_inval();
+      }
+    } else {
+      if (body_len > kSnappyStreamBlock) {
+        return make_error_inval();
+      }
+      out->insert(out->end(), body, body + body_len);
+    }
+
+    if (MaskedCrc32c(out->data() + old_sz, out->size() - old_sz) != crc) {
+      out->resize(old_sz);
+      return make_error("Snappy chunk checksum mismatch");
+    }
+    return Error();
+  }
+
+  bool identified_;
+  char_buffer_t pending_;
+};
+
+}  // namespace
+#endif
+
 CompressSnappyEDcoder::CompressSnappyEDcoder() : IEDcoder(ED_SNAPPY) {}
 
 Error CompressSnappyEDcoder::DoEncode(const StringPiece& data, char_buffer_t* out) {
@@ -75,4 +293,24 @@ Error CompressSnappyEDcoder::DoDecode(const char_buffer_t& data, char_buffer_t*
 #endif
 }
 
+Error CompressSnappyEDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_SNAPPY)
+  *stream = new SnappyEncodeStream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_SNAPPY stream encode not supported");
+#endif
+}
+
+Error CompressSnappyEDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_SNAPPY)
+  *stream = new SnappyDecodeStream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_SNAPPY stream decode not supported");
+#endif
+}
+
 }  // namespace common
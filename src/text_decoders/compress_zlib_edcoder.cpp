@@ -29,15 +29,180 @@
 
 #include <common/text_decoders/compress_zlib_edcoder.h>
 
+#include <string.h>
+
 #include <common/compress/zlib_compress.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
+#if defined(HAVE_ZLIB)
+namespace {
+
+// (de)compressor output is drained by pieces of this size
+const size_t kZlibStreamOutStep = 64 * 1024;
+
+class ZlibEncodeStream : public IEDcoderStream {
+ public:
+  ZlibEncodeStream() : IEDcoderStream(), stream_(), inited_(false) { memset(&stream_, 0, sizeof(z_stream)); }
+
+  ~ZlibEncodeStream() override {
+    if (inited_) {
+      deflateEnd(&stream_);
+    }
+  }
+
+  Error Init(uint8_t def, const compress::CompressDictionary* dictionary) WARN_UNUSED_RESULT {
+    // same window and memory level as compress::EncodeZlib, so output is compatible with one-shot decode
+    int st = deflateInit2(&stream_, Z_BEST_COMPRESSION, Z_DEFLATED, 15 | def, 8, Z_DEFAULT_STRATEGY);
+    if (st != Z_OK) {
+      return make_error("ZLIB compress internal error");
+    }
+
+    inited_ = true;
+    if (dictionary) {
+      const char_buffer_t& content = dictionary->GetContent();
+      st = deflateSetDictionary(&stream_, reinterpret_cast<const Bytef*>(content.data()),
+                                static_cast<uInt>(content.size()));
+      if (st != Z_OK) {
+        return make_error("ZLIB compress internal error");
+      }
+    }
+    return Error();
+  }
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    stream_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.data()));
+    stream_.avail_in = static_cast<uInt>(data.size());
+    return Deflate(Z_NO_FLUSH, out);
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    stream_.next_in = nullptr;
+    stream_.avail_in = 0;
+    return Deflate(Z_FINISH, out);
+  }
+
+  Error Deflate(int flush, char_buffer_t* out) {
+    while (true) {
+      stream_.next_out = reinterpret_cast<Bytef*>(buffer_);
+      stream_.avail_out = static_cast<uInt>(sizeof(buffer_));
+      int st = deflate(&stream_, flush);
+      out->insert(out->end(), buffer_, buffer_ + sizeof(buffer_) - stream_.avail_out);
+      if (st == Z_STREAM_END) {
+        return Error();
+      }
+
+      if (st != Z_OK && st != Z_BUF_ERROR) {
+        return make_error("ZLIB compress internal error");
+      }
+
+      // output space left, so all input is consumed
+      if (stream_.avail_out != 0) {
+        if (flush == Z_FINISH) {
+          return make_error("ZLIB compress internal error");
+        }
+        return Error();
+      }
+    }
+  }
+
+  z_stream stream_;
+  bool inited_;
+  char buffer_[kZlibStreamOutStep];
+};
+
+class ZlibDecodeStream : public IEDcoderStream {
+ public:
+  explicit ZlibDecodeStream(compress::CompressDictionarySPtr dictionary)
+      : IEDcoderStream(), stream_(), inited_(false), ended_(false), dictionary_(dictionary) {
+    memset(&stream_, 0, sizeof(z_stream));
+  }
+
+  ~ZlibDecodeStream() override {
+    if (inited_) {
+      inflateEnd(&stream_);
+    }
+  }
+
+  Error Init() WARN_UNUSED_RESULT {
+    // zlib or gzip header auto detection
+    int st = inflateInit2(&stream_, 15 + 32);
+    if (st != Z_OK) {
+      return make_error("ZLIB decompress internal error");
+    }
+
+    inited_ = true;
+    return Error();
+  }
+
+ private:
+  Error DoUpdate(const StringPiece& data, char_buffer_t* out) override {
+    if (ended_) {  // trailing garbage ignored like in one-shot decode
+      return Error();
+    }
+
+    stream_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.data()));
+    stream_.avail_in = static_cast<uInt>(data.size());
+    while (true) {
+      stream_.next_out = reinterpret_cast<Bytef*>(buffer_);
+      stream_.avail_out = static_cast<uInt>(sizeof(buffer_));
+      int st = inflate(&stream_, Z_NO_FLUSH);
+      out->insert(out->end(), buffer_, buffer_ + sizeof(buffer_) - stream_.avail_out);
+      if (st == Z_STREAM_END) {
+        ended_ = true;
+        return Error();
+      }
+
+      if (st == Z_NEED_DICT) {
+        const char_buffer_t* content = dictionary_ ? &dictionary_->GetContent() : nullptr;
+        if (!content || inflateSetDictionary(&stream_, reinterpret_cast<const Bytef*>(content->data()),
+                                             static_cast<uInt>(content->size())) != Z_OK) {
+          return make_error("ZLIB dictionary mismatch");
+        }
+        continue;
+      }
+
+      if (st != Z_OK && st != Z_BUF_ERROR) {
+        return make_error("ZLIB decompress internal error");
+      }
+
+      if (stream_.avail_out != 0) {
+        return Error();
+      }
+    }
+  }
+
+  Error DoFinish(char_buffer_t* out) override {
+    UNUSED(out);
+    if (!ended_) {
+      return make_error("ZLIB decompress unexpected end of stream");
+    }
+    return Error();
+  }
+
+  z_stream stream_;
+  bool inited_;
+  bool ended_;
+  const compress::CompressDictionarySPtr dictionary_;
+  char buffer_[kZlibStreamOutStep];
+};
+
+}  // namespace
+#endif
+
 CompressZlibEDcoder::CompressZlibEDcoder(bool sized, ZlibDeflates def)
-    : IEDcoder(ED_ZLIB), sized_(sized), deflate_(def) {}
+    : IEDcoder(ED_ZLIB), sized_(sized), deflate_(def), dictionary_() {}
+
+CompressZlibEDcoder::CompressZlibEDcoder(bool sized, compress::CompressDictionarySPtr dictionary)
+    : IEDcoder(ED_ZLIB), sized_(sized), deflate_(ZLIB_DEFLATE), dictionary_(dictionary) {}
 
 Error CompressZlibEDcoder::DoEncode(const StringPiece& data, char_buffer_t* out) {
 #if defined(HAVE_ZLIB)
+  if (dictionary_) {
+    return compress::EncodeZlib(data, sized_, dictionary_, out);
+  }
   return compress::EncodeZlib(data, sized_, deflate_, out);
 #else
   UNUSED(data);
@@ -48,6 +213,9 @@ Error CompressZlibEDcoder::DoEncode(const StringPiece& data, char_buffer_t* out)
 
 Error CompressZlibEDcoder::DoDecode(const StringPiece& data, char_buffer_t* out) {
 #if defined(HAVE_ZLIB)
+  if (dictionary_) {
+    return compress::DecodeZlib(data, sized_, dictionary_, out);
+  }
   return compress::DecodeZlib(data, sized_, out);
 #else
   UNUSED(data);
@@ -58,6 +226,9 @@ Error CompressZlibEDcoder::DoDecode(const StringPiece& data, char_buffer_t* out)
 
 Error CompressZlibEDcoder::DoEncode(const char_buffer_t& data, char_buffer_t* out) {
 #if defined(HAVE_ZLIB)
+  if (dictionary_) {
+    return compress::EncodeZlib(data, sized_, dictionary_, out);
+  }
   return compress::EncodeZlib(data, sized_, deflate_, out);
 #else
   UNUSED(data);
@@ -68,6 +239,9 @@ Error CompressZlibEDcoder::DoEncode(const char_buffer_t& data, char_buffer_t* ou
 
 Error CompressZlibEDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out) {
 #if defined(HAVE_ZLIB)
+  if (dictionary_) {
+    return compress::DecodeZlib(data, sized_, dictionary_, out);
+  }
   return compress::DecodeZlib(data, sized_, out);
 #else
   UNUSED(data);
@@ -76,4 +250,46 @@ Error CompressZlibEDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* ou
 #endif
 }
 
+Error CompressZlibEDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_ZLIB)
+  if (sized_) {  // size header needs whole input
+    return make_error("ED_ZLIB sized stream encode not supported");
+  }
+
+  ZlibEncodeStream* zstream = new ZlibEncodeStream;
+  Error err = zstream->Init(deflate_, dictionary_.get());
+  if (err) {
+    delete zstream;
+    return err;
+  }
+
+  *stream = zstream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_ZLIB stream encode not supported");
+#endif
+}
+
+Error CompressZlibEDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+#if defined(HAVE_ZLIB)
+  if (sized_) {
+    return make_error("ED_ZLIB sized stream decode not supported");
+  }
+
+  ZlibDecodeStream* zstream = new ZlibDecodeStream(dictionary_);
+  Error err = zstream->Init();
+  if (err) {
+    delete zstream;
+    return err;
+  }
+
+  *stream = zstream;
+  return Error();
+#else
+  UNUSED(stream);
+  return make_error("ED_ZLIB stream decode not supported");
+#endif
+}
+
 }  // namespace common
@@ -30,6 +30,7 @@
 #include <common/text_decoders/hex_edcoder.h>
 
 #include <common/compress/hex.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
@@ -51,4 +52,20 @@ Error HexEDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out) {
   return compress::DecodeHex(data, out);
 }
 
+Error HexEDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+  const bool is_lower = is_lower_;
+  *stream = new BlockEDcoderStream(1, [is_lower](const StringPiece& data, char_buffer_t* out) {
+    return compress::EncodeHex(data, is_lower, out);
+  });
+  return Error();
+}
+
+Error HexEDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+  // 2 chars per byte
+  *stream = new BlockEDcoderStream(2, [](const StringPiece& data, char_buffer_t* out) {
+    return compress::DecodeHex(data, out);
+  });
+  return Error();
+}
+
 }  // namespace common
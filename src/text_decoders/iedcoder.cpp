@@ -32,7 +32,8 @@
 namespace common {
 
 const std::array<const char*, ENCODER_DECODER_NUM_TYPES> edecoder_types = {
-    {"NoComression", "Base64", "Zlib", "BZip2", "LZ4", "Snappy", "Hex", "XHex", "Unicode", "UUnicode", "HtmlEscape"}};
+    {"NoComression", "Base64", "Zlib", "BZip2", "LZ4", "Snappy", "Hex", "XHex", "Unicode", "UUnicode", "HtmlEscape",
+     "Auto"}};
 
 std::string ConvertToString(EDType type) {
   if (type >= 0 && type < edecoder_types.size()) {
@@ -93,6 +94,32 @@ Error IEDcoder::Decode(const char_buffer_t& data, char_buffer_t* out) {
   return DoDecode(data, out);
 }
 
+Error IEDcoder::CreateEncodeStream(IEDcoderStream** stream) {
+  if (!stream) {
+    return make_error_inval();
+  }
+
+  return DoCreateEncodeStream(stream);
+}
+
+Error IEDcoder::CreateDecodeStream(IEDcoderStream** stream) {
+  if (!stream) {
+    return make_error_inval();
+  }
+
+  return DoCreateDecodeStream(stream);
+}
+
+Error IEDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+  UNUSED(stream);
+  return make_error(ConvertToString(type_) + " stream encode not supported");
+}
+
+Error IEDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+  UNUSED(stream);
+  return make_error(ConvertToString(type_) + " stream decode not supported");
+}
+
 EDType IEDcoder::GetType() const {
   return type_;
 }
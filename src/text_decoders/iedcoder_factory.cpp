@@ -30,6 +30,7 @@
 #include <common/text_decoders/iedcoder_factory.h>
 
 #include <common/text_decoders/base64_edcoder.h>
+#include <common/text_decoders/compress_auto_edcoder.h>
 #include <common/text_decoders/compress_bzip2_edcoder.h>
 #include <common/text_decoders/compress_lz4_edcoder.h>
 #include <common/text_decoders/compress_snappy_edcoder.h>
@@ -66,12 +67,29 @@ IEDcoder* CreateEDCoder(EDType type) {
     return new UUnicodeEDcoder;
   } else if (type == ED_HTML_ESC) {
     return new HtmlEscEDcoder;
+  } else if (type == ED_AUTO) {
+    return new CompressAutoEDcoder;
   }
 
   DNOTREACHED() << "Unknown EDCoder type:" << type;
   return nullptr;
 }
 
+IEDcoder* CreateEDCoder(EDType type, compress::CompressDictionarySPtr dictionary) {
+  if (!dictionary) {
+    return CreateEDCoder(type);
+  }
+
+  if (type == ED_ZLIB) {
+    return new CompressZlibEDcoder(true, dictionary);
+  } else if (type == ED_LZ4) {
+    return new CompressLZ4EDcoder(true, dictionary);
+  }
+
+  DNOTREACHED() << "EDCoder type without dictionary support:" << type;
+  return nullptr;
+}
+
 IEDcoder* CreateEDCoder(const std::string& name) {
   EDType t;
   if (!ConvertFromString(name, &t)) {
@@ -0,0 +1,263 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <common/text_decoders/iedcoder_stream.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <common/file_system/file.h>
+#include <common/file_system/file_system.h>
+#include <common/sprintf.h>
+
+namespace common {
+
+namespace {
+
+Error TransformFile(IEDcoderStream* stream, const std::string& path_from, const std::string& path_to) {
+  file_system::File from;
+  ErrnoError errn = from.Open(path_from, file_system::File::FLAG_OPEN | file_system::File::FLAG_READ);
+  if (errn) {
+    return make_error_from_errno(errn);
+  }
+
+  errn = file_system::remove_file(path_to);
+  if (errn) {
+    ignore_result(from.Close());
+    return make_error_from_errno(errn);
+  }
+
+  file_system::File to;
+  errn = to.Open(path_to, file_system::File::FLAG_CREATE | file_system::File::FLAG_WRITE);
+  if (errn) {
+    ignore_result(from.Close());
+    return make_error_from_errno(errn);
+  }
+
+  auto reader = [&from](char* buf, size_t size, size_t* nread) -> Error {
+    ErrnoError err = from.Read(buf, size, nread);
+    if (err) {
+      return make_error_from_errno(err);
+    }
+    return Error();
+  };
+  auto writer = [&to](const char_buffer_t& data) -> Error {
+    size_t nwrite = 0;
+    ErrnoError err = to.WriteBuffer(data, &nwrite);
+    if (err) {
+      return make_error_from_errno(err);
+    }
+    if (nwrite != data.size()) {
+      return make_error(MemSPrintf("Error when writing needed to write: %lu, but writed: %lu", data.size(), nwrite));
+    }
+    return Error();
+  };
+
+  Error err = TransformStream(stream, reader, writer);
+  ignore_result(from.Close());
+  ignore_result(to.Close());
+  return err;
+}
+
+}  // namespace
+
+IEDcoderStream::IEDcoderStream() : finished_(false) {}
+
+IEDcoderStream::~IEDcoderStream() {}
+
+Error IEDcoderStream::Update(const StringPiece& data, char_buffer_t* out) {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  if (finished_) {
+    return make_error("Stream already finished");
+  }
+
+  if (data.empty()) {
+    return Error();
+  }
+
+  return DoUpdate(data, out);
+}
+
+Error IEDcoderStream::Finish(char_buffer_t* out) {
+  if (!out) {
+    return make_error_inval();
+  }
+
+  if (finished_) {
+    return make_error("Stream already finished");
+  }
+
+  finished_ = true;
+  return DoFinish(out);
+}
+
+bool IEDcoderStream::IsFinished() const {
+  return finished_;
+}
+
+BlockEDcoderStream::BlockEDcoderStream(size_t unit_size, block_coder_t coder)
+    : IEDcoderStream(), unit_size_(unit_size), coder_(coder), tail_(), block_() {
+  DCHECK(unit_size_ > 0);
+}
+
+Error BlockEDcoderStream::DoUpdate(const StringPiece& data, char_buffer_t* out) {
+  const char* ptr = data.data();
+  size_t size = data.size();
+  if (!tail_.empty()) {
+    const size_t take = std::min(unit_size_ - tail_.size(), size);
+    tail_.insert(tail_.end(), ptr, ptr + take);
+    ptr += take;
+    size -= take;
+    if (tail_.size() < unit_size_) {
+      return Error();
+    }
+
+    Error err = CodeBlock(StringPiece(tail_.data(), tail_.size()), out);
+    tail_.clear();
+    if (err) {
+      return err;
+    }
+  }
+
+  const size_t aligned = size - size % unit_size_;
+  if (aligned) {
+    Error err = CodeBlock(StringPiece(ptr, aligned), out);
+    if (err) {
+      return err;
+    }
+  }
+
+  tail_.assign(ptr + aligned, ptr + size);
+  return Error();
+}
+
+Error BlockEDcoderStream::DoFinish(char_buffer_t* out) {
+  if (tail_.empty()) {
+    return Error();
+  }
+
+  Error err = CodeBlock(StringPiece(tail_.data(), tail_.size()), out);
+  tail_.clear();
+  return err;
+}
+
+Error BlockEDcoderStream::CodeBlock(const StringPiece& data, char_buffer_t* out) {
+  block_.clear();
+  Error err = coder_(data, &block_);
+  if (err) {
+    return err;
+  }
+
+  out->insert(out->end(), block_.begin(), block_.end());
+  return Error();
+}
+
+Error TransformStream(IEDcoderStream* stream,
+                      const stream_reader_t& reader,
+                      const stream_writer_t& writer,
+                      size_t chunk_size) {
+  if (!stream || !reader || !writer || chunk_size == 0) {
+    return make_error_inval();
+  }
+
+  std::unique_ptr<char[]> chunk(new char[chunk_size]);
+  char_buffer_t out;
+  while (true) {
+    size_t nread = 0;
+    Error err = reader(chunk.get(), chunk_size, &nread);
+    if (err) {
+      return err;
+    }
+
+    if (nread == 0) {
+      break;
+    }
+
+    out.clear();
+    err = stream->Update(StringPiece(chunk.get(), nread), &out);
+    if (err) {
+      return err;
+    }
+
+    if (!out.empty()) {
+      err = writer(out);
+      if (err) {
+        return err;
+      }
+    }
+  }
+
+  out.clear();
+  Error err = stream->Finish(&out);
+  if (err) {
+    return err;
+  }
+
+  if (!out.empty()) {
+    return writer(out);
+  }
+  return Error();
+}
+
+Error EncodeFile(IEDcoder* coder, const std::string& path_from, const std::string& path_to) {
+  if (!coder || path_from.empty() || path_to.empty()) {
+    return make_error_inval();
+  }
+
+  IEDcoderStream* stream = nullptr;
+  Error err = coder->CreateEncodeStream(&stream);
+  if (err) {
+    return err;
+  }
+
+  err = TransformFile(stream, path_from, path_to);
+  delete stream;
+  return err;
+}
+
+Error DecodeFile(IEDcoder* coder, const std::string& path_from, const std::string& path_to) {
+  if (!coder || path_from.empty() || path_to.empty()) {
+    return make_error_inval();
+  }
+
+  IEDcoderStream* stream = nullptr;
+  Error err = coder->CreateDecodeStream(&stream);
+  if (err) {
+    return err;
+  }
+
+  err = TransformFile(stream, path_from, path_to);
+  delete stream;
+  return err;
+}
+
+}  // namespace common
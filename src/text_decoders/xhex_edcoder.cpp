@@ -30,6 +30,7 @@
 #include <common/text_decoders/xhex_edcoder.h>
 
 #include <common/compress/xhex.h>
+#include <common/text_decoders/iedcoder_stream.h>
 
 namespace common {
 
@@ -51,4 +52,20 @@ Error XHexEDcoder::DoDecode(const char_buffer_t& data, char_buffer_t* out) {
   return compress::DecodeXHex(data, out);
 }
 
+Error XHexEDcoder::DoCreateEncodeStream(IEDcoderStream** stream) {
+  const bool is_lower = is_lower_;
+  *stream = new BlockEDcoderStream(1, [is_lower](const StringPiece& data, char_buffer_t* out) {
+    return compress::EncodeXHex(data, is_lower, out);
+  });
+  return Error();
+}
+
+Error XHexEDcoder::DoCreateDecodeStream(IEDcoderStream** stream) {
+  // \xHH per byte
+  *stream = new BlockEDcoderStream(4, [](const StringPiece& data, char_buffer_t* out) {
+    return compress::DecodeXHex(data, out);
+  });
+  return Error();
+}
+
 }  // namespace common
@@ -29,6 +29,8 @@
 
 #include <common/time.h>
 
+#include <time.h>
+
 #ifndef COMPILER_MSVC
 
 namespace common {
@@ -49,6 +51,12 @@ time64_t current_utc_mstime() {
   return now * 1000 + cur_time.tv_usec / 1000;
 }
 
+time64_t current_monotonic_mstime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<time64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
 struct timeval current_timeval() {
   struct timeval tv;
   gettimeofday(&tv, nullptr);
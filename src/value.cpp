@@ -32,6 +32,7 @@
 #include <string.h>
 
 #include <algorithm>
+#include <utility>
 
 namespace common {
 namespace {
@@ -103,6 +104,11 @@ StringValue* Value::CreateStringValue(const string_t& in_value) {
   return new StringValue(in_value);
 }
 
+// static
+StringValue* Value::CreateStringValue(string_t&& in_value) {
+  return new StringValue(std::move(in_value));
+}
+
 StringValue* Value::CreateStringValueFromBasicString(const std::string& in_value) {
   return new StringValue(string_t(in_value.begin(), in_value.end()));
 }
@@ -117,6 +123,11 @@ ByteArrayValue* Value::CreateByteArrayValue(const byte_array_t& array) {
   return new ByteArrayValue(array);
 }
 
+// static
+ByteArrayValue* Value::CreateByteArrayValue(byte_array_t&& array) {
+  return new ByteArrayValue(std::move(array));
+}
+
 // static
 SetValue* Value::CreateSetValue() {
   return new SetValue;
@@ -190,15 +201,30 @@ bool Value::GetAsString(string_t* out_value) const {
   return false;
 }
 
+bool Value::GetAsStringPiece(StringPiece* out_value) const {
+  UNUSED(out_value);
+
+  return false;
+}
+
 bool Value::GetAsBasicString(std::string* out_value) const {
-  if (out_value) {
-    string_t str;
-    if (!GetAsString(&str)) {
-      return false;
+  StringPiece piece;
+  if (GetAsStringPiece(&piece)) {
+    if (out_value) {
+      piece.CopyToString(out_value);
     }
-    *out_value = str.as_string();
+    return true;
   }
 
+  // user types may provide only GetAsString
+  string_t str;
+  if (!GetAsString(&str)) {
+    return false;
+  }
+
+  if (out_value) {
+    *out_value = str.as_string();
+  }
   return true;
 }
 
@@ -220,6 +246,12 @@ bool Value::GetAsByteArray(byte_array_t* out_value) const {
   return false;
 }
 
+bool Value::GetAsByteSpan(span<const byte_t>* out_value) const {
+  UNUSED(out_value);
+
+  return false;
+}
+
 bool Value::GetAsSet(SetValue** out_value) {
   UNUSED(out_value);
 
@@ -290,6 +322,13 @@ Value& Value::operator=(const Value& that) {
   return *this;
 }
 
+Value::Value(Value&& other) : type_(other.type_) {}
+
+Value& Value::operator=(Value&& other) {
+  type_ = other.type_;
+  return *this;
+}
+
 ///////////////////// FundamentalValue ////////////////////
 
 FundamentalValue::FundamentalValue(bool in_value) : Value(TYPE_BOOLEAN), boolean_value_(in_value) {}
@@ -467,6 +506,8 @@ bool TimeValue::Equals(const Value* other) const {
 
 StringValue::StringValue(const string_t& in_value) : Value(TYPE_STRING), value_(in_value) {}
 
+StringValue::StringValue(string_t&& in_value) : Value(TYPE_STRING), value_(std::move(in_value)) {}
+
 StringValue::~StringValue() {}
 
 bool StringValue::GetAsString(string_t* out_value) const {
@@ -477,6 +518,14 @@ bool StringValue::GetAsString(string_t* out_value) const {
   return true;
 }
 
+bool StringValue::GetAsStringPiece(StringPiece* out_value) const {
+  if (out_value) {
+    *out_value = StringPiece(value_.data(), value_.size());
+  }
+
+  return true;
+}
+
 StringValue* StringValue::DeepCopy() const {
   return CreateStringValue(value_);
 }
@@ -486,8 +535,8 @@ bool StringValue::Equals(const Value* other) const {
     return false;
   }
 
-  string_t lhs, rhs;
-  return GetAsString(&lhs) && other->GetAsString(&rhs) && lhs == rhs;
+  StringPiece rhs;
+  return other->GetAsStringPiece(&rhs) && StringPiece(value_.data(), value_.size()) == rhs;
 }
 
 ArrayValue::ArrayValue() : Value(TYPE_ARRAY) {}
@@ -684,6 +733,10 @@ void ArrayValue::Append(Value* in_value) {
   list_.push_back(in_value);
 }
 
+void ArrayValue::Append(std::unique_ptr<Value> in_value) {
+  Append(in_value.release());
+}
+
 void ArrayValue::AppendBoolean(bool in_value) {
   Append(CreateBooleanValue(in_value));
 }
@@ -700,12 +753,25 @@ void ArrayValue::AppendString(const string_t& in_value) {
   Append(CreateStringValue(in_value));
 }
 
+void ArrayValue::AppendString(string_t&& in_value) {
+  Append(CreateStringValue(std::move(in_value)));
+}
+
 void ArrayValue::AppendStrings(const std::vector<string_t>& in_values) {
+  list_.reserve(list_.size() + in_values.size());
   for (std::vector<string_t>::const_iterator it = in_values.begin(); it != in_values.end(); ++it) {
     AppendString(*it);
   }
 }
 
+void ArrayValue::AppendStrings(std::vector<string_t>&& in_values) {
+  list_.reserve(list_.size() + in_values.size());
+  for (std::vector<string_t>::iterator it = in_values.begin(); it != in_values.end(); ++it) {
+    AppendString(std::move(*it));
+  }
+  in_values.clear();
+}
+
 void ArrayValue::AppendBasicString(const std::string& in_value) {
   Append(CreateStringValueFromBasicString(in_value));
 }
@@ -766,6 +832,7 @@ bool ArrayValue::GetAsList(const ArrayValue** out_value) const {
 
 ArrayValue* ArrayValue::DeepCopy() const {
   ArrayValue* result = new ArrayValue;
+  result->Reserve(list_.size());
 
   for (const_iterator i = list_.begin(); i != list_.end(); ++i) {
     Value* cur = *i;
@@ -799,6 +866,8 @@ bool ArrayValue::Equals(const Value* other) const {
 
 ByteArrayValue::ByteArrayValue(const byte_array_t& array) : Value(TYPE_BYTE_ARRAY), array_(array) {}
 
+ByteArrayValue::ByteArrayValue(byte_array_t&& array) : Value(TYPE_BYTE_ARRAY), array_(std::move(array)) {}
+
 ByteArrayValue::~ByteArrayValue() {
   Clear();
 }
@@ -811,34 +880,23 @@ void ByteArrayValue::Clear() {
 void ByteArrayValue::AppendBoolean(bool in_value) {
   byte_t arr[sizeof(bool)];
   memcpy(arr, &in_value, sizeof(bool));
-  for (size_t i = 0; i < sizeof(bool); ++i) {
-    byte_t b = arr[i];
-    array_.push_back(b);
-  }
+  array_.append(arr, sizeof(bool));
 }
 
 void ByteArrayValue::AppendInteger(int in_value) {
   byte_t arr[sizeof(int)];
   memcpy(arr, &in_value, sizeof(int));
-  for (size_t i = 0; i < sizeof(int); ++i) {
-    byte_t b = arr[i];
-    array_.push_back(b);
-  }
+  array_.append(arr, sizeof(int));
 }
 
 void ByteArrayValue::AppendDouble(double in_value) {
   byte_t arr[sizeof(double)];
   memcpy(arr, &in_value, sizeof(double));
-  for (size_t i = 0; i < sizeof(double); ++i) {
-    byte_t b = arr[i];
-    array_.push_back(b);
-  }
+  array_.append(arr, sizeof(double));
 }
 
 void ByteArrayValue::AppendString(const string_t& in_value) {
-  for (size_t i = 0; i < in_value.size(); ++i) {
-    array_.push_back(in_value[i]);
-  }
+  array_.append(in_value.data(), in_value.size());
 }
 
 void ByteArrayValue::AppendStrings(const std::vector<string_t>& in_values) {
@@ -848,9 +906,7 @@ void ByteArrayValue::AppendStrings(const std::vector<string_t>& in_values) {
 }
 
 void ByteArrayValue::AppendBasicString(const std::string& in_value) {
-  for (size_t i = 0; i < in_value.size(); ++i) {
-    array_.push_back(in_value[i]);
-  }
+  array_.append(in_value.data(), in_value.size());
 }
 
 void ByteArrayValue::AppendBasicStrings(const std::vector<std::string>& in_values) {
@@ -866,6 +922,13 @@ bool ByteArrayValue::GetAsByteArray(byte_array_t* out_value) const {
   return true;
 }
 
+bool ByteArrayValue::GetAsByteSpan(span<const byte_t>* out_value) const {
+  if (out_value) {
+    *out_value = make_span(array_.data(), array_.size());
+  }
+  return true;
+}
+
 ByteArrayValue* ByteArrayValue::DeepCopy() const {
   return CreateByteArrayValue(array_);
 }
@@ -875,8 +938,9 @@ bool ByteArrayValue::Equals(const Value* other) const {
     return false;
   }
 
-  byte_array_t lhs, rhs;
-  return GetAsByteArray(&lhs) && other->GetAsByteArray(&rhs) && lhs == rhs;
+  span<const byte_t> rhs;
+  return other->GetAsByteSpan(&rhs) && array_.size() == rhs.size() &&
+         std::equal(array_.begin(), array_.end(), rhs.begin());
 }
 
 SetValue::SetValue() : Value(TYPE_SET) {}
@@ -897,6 +961,10 @@ void SetValue::Insert(const string_t& in_value) {
   Insert(CreateStringValue(in_value));
 }
 
+void SetValue::Insert(string_t&& in_value) {
+  Insert(CreateStringValue(std::move(in_value)));
+}
+
 bool SetValue::Insert(Value* in_value) {
   DCHECK(in_value);
   if (!in_value) {
@@ -984,6 +1052,10 @@ void ZSetValue::Insert(const string_t& key, const string_t& value) {
   Insert(Value::CreateStringValue(key), Value::CreateStringValue(value));
 }
 
+void ZSetValue::Insert(string_t&& key, string_t&& value) {
+  Insert(Value::CreateStringValue(std::move(key)), Value::CreateStringValue(std::move(value)));
+}
+
 bool ZSetValue::GetAsZSet(ZSetValue** out_value) {
   if (out_value && IsType(TYPE_ZSET)) {
     *out_value = this;
@@ -1004,7 +1076,7 @@ ZSetValue* ZSetValue::DeepCopy() const {
   ZSetValue* result = new ZSetValue;
 
   for (const_iterator i = map_.begin(); i != map_.end(); ++i) {
-    auto key_value = *i;
+    const auto& key_value = *i;
     Value* key = key_value.first->DeepCopy();
     Value* val = key_value.second->DeepCopy();
     result->Insert(key, val);
@@ -1062,6 +1134,15 @@ bool HashValue::Insert(const string_t& key, Value* value) {
   return true;
 }
 
+bool HashValue::Insert(string_t&& key, Value* value) {
+  if (key.empty() || !value) {
+    return false;
+  }
+
+  hash_[std::move(key)] = value;
+  return true;
+}
+
 bool HashValue::Insert(const std::string& key, Value* value) {
   if (key.empty() || !value) {
     return false;
@@ -1108,9 +1189,10 @@ bool HashValue::GetAsHash(const HashValue** out_value) const {
 
 HashValue* HashValue::DeepCopy() const {
   HashValue* result = new HashValue;
+  result->Reserve(hash_.size());
 
   for (const_iterator i = hash_.begin(); i != hash_.end(); ++i) {
-    auto key_value = *i;
+    const auto& key_value = *i;
     Value* val = key_value.second->DeepCopy();
     result->Insert(key_value.first, val);
   }
@@ -1123,24 +1205,19 @@ bool HashValue::Equals(const Value* other) const {
     return false;
   }
 
-  const HashValue* other_zset = static_cast<const HashValue*>(other);
-  const_iterator lhs_it, rhs_it;
-  for (lhs_it = begin(), rhs_it = other_zset->begin(); lhs_it != end() && rhs_it != other_zset->end();
-       ++lhs_it, ++rhs_it) {
-    string_t rkey = (*rhs_it).first;
-    Value* rval = (*rhs_it).second;
-    string_t lkey = (*lhs_it).first;
-    Value* lval = (*lhs_it).second;
+  const HashValue* other_hash = static_cast<const HashValue*>(other);
+  if (GetSize() != other_hash->GetSize()) {
+    return false;
+  }
 
-    if (lkey != rkey || !lval->Equals(rval)) {
+  // iteration order of unordered containers depends on bucket count
+  for (const_iterator lhs_it = begin(); lhs_it != end(); ++lhs_it) {
+    const_iterator rhs_it = other_hash->hash_.find(lhs_it->first);
+    if (rhs_it == other_hash->end() || !lhs_it->second->Equals(rhs_it->second)) {
       return false;
     }
   }
 
-  if (lhs_it != end() || rhs_it != other_zset->end()) {
-    return false;
-  }
-
   return true;
 }
 
@@ -1192,9 +1269,9 @@ std::ostream& operator<<(std::ostream& out, const Value& value) {
       return out << res;
     }
   } else if (value_type == Value::TYPE_STRING) {
-    Value::string_t res;
-    if (value.GetAsString(&res)) {
-      return out << '"' << res.as_string() << '"';
+    StringPiece res;
+    if (value.GetAsStringPiece(&res)) {
+      return out << '"' << res << '"';
     }
   } else if (value_type == Value::TYPE_ARRAY) {
     const ArrayValue* array = nullptr;
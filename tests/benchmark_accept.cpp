@@ -0,0 +1,136 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <common/libev/io_loop_observer.h>
+#include <common/libev/tcp/tcp_server.h>
+#include <common/logger.h>
+#include <common/net/net.h>
+
+namespace {
+
+// Connections opened per iteration, they all sit in the backlog together.
+const size_t kBurst = 32;
+
+// Counts accepted clients and drops each one when its peer hangs up.
+class CountingObserver : public common::libev::IoLoopObserver {
+ public:
+  CountingObserver() : accepted(0) {}
+
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+  void Accepted(common::libev::IoClient* client) override {
+    UNUSED(client);
+    accepted++;
+  }
+  void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override {
+    UNUSED(server);
+    UNUSED(client);
+  }
+  void Closed(common::libev::IoClient* client) override { UNUSED(client); }
+  void TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) override {
+    UNUSED(server);
+    UNUSED(id);
+  }
+  void Accepted(common::libev::IoChild* child) override { UNUSED(child); }
+  void Moved(common::libev::IoLoop* server, common::libev::IoChild* child) override {
+    UNUSED(server);
+    UNUSED(child);
+  }
+  void ChildStatusChanged(common::libev::IoChild* child, int status, int signal) override {
+    UNUSED(child);
+    UNUSED(status);
+    UNUSED(signal);
+  }
+  void DataReceived(common::libev::IoClient* client) override {
+    char buf[64];
+    size_t nread = 0;
+    common::ErrnoError err = client->SingleRead(buf, sizeof(buf), &nread);
+    if (err || nread == 0) {
+      ignore_result(client->Close());
+      delete client;
+    }
+  }
+  void DataReadyToWrite(common::libev::IoClient* client) override { UNUSED(client); }
+  void PostLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+
+  std::atomic<size_t> accepted;
+};
+
+}  // namespace
+
+// range(0): accept batch size, range(1): client log interval in msec with
+// INFO logging into /dev/null.
+static void BM_TcpAccept(benchmark::State& state) {
+  common::logging::INIT_LOGGER("benchmark", "/dev/null", common::logging::LOG_LEVEL_INFO);
+
+  CountingObserver observer;
+  common::libev::tcp::TcpServer server(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &observer);
+  if (server.Bind(true) || server.Listen(1024)) {
+    state.SkipWithError("listen failed");
+    return;
+  }
+  common::libev::tcp::TcpAcceptOptions options;
+  options.batch_size = state.range(0);
+  options.log_interval_msec = state.range(1);
+  options.socket_options.no_delay = true;
+  server.SetAcceptOptions(options);
+  const common::net::HostAndPort host = server.GetHost();
+  std::thread loop_thread([&server]() { ignore_result(server.Exec()); });
+
+  size_t expected = 0;
+  std::vector<common::net::socket_info> clients(kBurst);
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBurst; ++i) {
+      if (common::net::connect(host, common::net::ST_SOCK_STREAM, nullptr, &clients[i])) {
+        state.SkipWithError("connect failed");
+        break;
+      }
+    }
+    expected += kBurst;
+    while (observer.accepted < expected) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < kBurst; ++i) {
+      ignore_result(common::net::close(clients[i].fd()));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBurst);
+
+  server.Stop();
+  loop_thread.join();
+  common::logging::SET_CURRENT_LOG_LEVEL(common::logging::LOG_LEVEL_NOTICE);
+  common::logging::SET_LOGER_STREAM(&std::cout);
+}
+BENCHMARK(BM_TcpAccept)->Args({1, 0})->Args({64, 0})->Args({64, 1000})->UseRealTime();
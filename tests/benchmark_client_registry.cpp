@@ -0,0 +1,147 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <deque>
+#include <future>
+#include <thread>
+
+#include <common/libev/io_client.h>
+#include <common/libev/io_loop_observer.h>
+#include <common/libev/tcp/tcp_server.h>
+
+namespace {
+
+// Watches its own duplicate of a descriptor which never becomes readable,
+// libev scans the watchers of a descriptor so they can not be shared.
+class DupClient : public common::libev::IoClient {
+ public:
+  DupClient(common::libev::IoLoop* server, descriptor_t fd) : IoClient(server), fd_(dup(fd)) {}
+  ~DupClient() override { close(fd_); }
+
+ protected:
+  descriptor_t GetFd() const override { return fd_; }
+
+ private:
+  common::ErrnoError DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) override {
+    UNUSED(data);
+    UNUSED(size);
+    UNUSED(nwrite_out);
+    return common::make_errno_error_inval();
+  }
+  common::ErrnoError DoSingleRead(void* out_data, size_t max_size, size_t* nread_out) override {
+    UNUSED(out_data);
+    UNUSED(max_size);
+    UNUSED(nread_out);
+    return common::make_errno_error_inval();
+  }
+  common::ErrnoError DoClose() override { return common::ErrnoError(); }
+
+  const descriptor_t fd_;
+};
+
+class NullObserver : public common::libev::IoLoopObserver {
+ public:
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+  void Accepted(common::libev::IoClient* client) override { UNUSED(client); }
+  void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override {
+    UNUSED(server);
+    UNUSED(client);
+  }
+  void Closed(common::libev::IoClient* client) override { UNUSED(client); }
+  void TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) override {
+    UNUSED(server);
+    UNUSED(id);
+  }
+  void Accepted(common::libev::IoChild* child) override { UNUSED(child); }
+  void Moved(common::libev::IoLoop* server, common::libev::IoChild* child) override {
+    UNUSED(server);
+    UNUSED(child);
+  }
+  void ChildStatusChanged(common::libev::IoChild* child, int status, int signal) override {
+    UNUSED(child);
+    UNUSED(status);
+    UNUSED(signal);
+  }
+  void DataReceived(common::libev::IoClient* client) override { UNUSED(client); }
+  void DataReadyToWrite(common::libev::IoClient* client) override { UNUSED(client); }
+  void PostLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+};
+
+}  // namespace
+
+// range(0) clients stay registered while every iteration registers a new
+// one and closes the oldest: connection churn on a busy loop.
+static void BM_ClientChurn(benchmark::State& state) {
+  NullObserver observer;
+  common::libev::tcp::TcpServer server(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &observer);
+  int sv[2];
+  if (server.Bind(true) || server.Listen(5) || socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    state.SkipWithError("setup failed");
+    return;
+  }
+  std::thread loop_thread([&server]() { ignore_result(server.Exec()); });
+
+  // the registry may only be touched from the loop thread
+  std::promise<void> done;
+  server.ExecInLoopThread([&]() {
+    std::deque<common::libev::IoClient*> clients;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      common::libev::IoClient* client = new DupClient(&server, sv[0]);
+      ignore_result(server.RegisterClient(client));
+      clients.push_back(client);
+    }
+    for (auto _ : state) {
+      common::libev::IoClient* client = new DupClient(&server, sv[0]);
+      ignore_result(server.RegisterClient(client));
+      clients.push_back(client);
+      common::libev::IoClient* oldest = clients.front();
+      clients.pop_front();
+      server.CloseClient(oldest);
+      delete oldest;
+    }
+    for (size_t i = 0; i < clients.size(); ++i) {
+      server.CloseClient(clients[i]);
+      delete clients[i];
+    }
+    done.set_value();
+  });
+  done.get_future().wait();
+  state.SetItemsProcessed(state.iterations());
+
+  server.Stop();
+  loop_thread.join();
+  close(sv[0]);
+  close(sv[1]);
+}
+BENCHMARK(BM_ClientChurn)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime();
@@ -0,0 +1,530 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <common/compress/bzip2_compress.h>
+#include <common/compress/dictionary.h>
+#include <common/compress/hex.h>
+#include <common/compress/lz4_compress.h>
+#include <common/compress/unicode.h>
+#include <common/compress/xhex.h>
+#include <common/compress/zlib_compress.h>
+#include <common/daemon/commands/ping_info.h>
+#include <common/daemon/commands/stop_info.h>
+#include <common/protocols/json_rpc/json_rpc.h>
+#include <common/text_decoders/compress_auto_edcoder.h>
+#include <common/text_decoders/compress_lz4_edcoder.h>
+#include <common/text_decoders/compress_zlib_edcoder.h>
+#include <common/text_decoders/iedcoder_stream.h>
+#include <common/threads/thread_pool.h>
+
+namespace {
+const size_t kDataSize = 1024 * 1024;
+
+common::char_buffer_t MakeData() {
+  common::char_buffer_t data;
+  data.reserve(kDataSize);
+  uint32_t seed = 1;
+  while (data.size() < kDataSize) {
+    seed = seed * 1103515245 + 12345;
+    const std::string word = "token" + std::to_string((seed >> 16) % 512) + " ";
+    data.insert(data.end(), word.begin(), word.end());
+  }
+  data.resize(kDataSize);
+  return data;
+}
+
+void OneShotRoundTrip(benchmark::State& state, common::IEDcoder* coder) {
+  const common::char_buffer_t data = MakeData();
+  for (auto _ : state) {
+    common::char_buffer_t enc;
+    common::char_buffer_t dec;
+    ignore_result(coder->Encode(data, &enc));
+    ignore_result(coder->Decode(enc, &dec));
+    benchmark::DoNotOptimize(dec.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+
+// encodes and decodes by DEFAULT_STREAM_CHUNK_SIZE pieces, working set stays at a few chunks
+void StreamRoundTrip(benchmark::State& state, common::IEDcoder* coder) {
+  const common::char_buffer_t data = MakeData();
+  common::char_buffer_t enc;
+  common::char_buffer_t dec;
+  size_t decoded = 0;
+  for (auto _ : state) {
+    common::IEDcoderStream* enc_stream = nullptr;
+    common::IEDcoderStream* dec_stream = nullptr;
+    ignore_result(coder->CreateEncodeStream(&enc_stream));
+    ignore_result(coder->CreateDecodeStream(&dec_stream));
+    std::unique_ptr<common::IEDcoderStream> enc_holder(enc_stream);
+    std::unique_ptr<common::IEDcoderStream> dec_holder(dec_stream);
+    for (size_t pos = 0; pos < data.size(); pos += common::DEFAULT_STREAM_CHUNK_SIZE) {
+      enc.clear();
+      dec.clear();
+      ignore_result(enc_stream->Update(common::StringPiece(data.data() + pos, common::DEFAULT_STREAM_CHUNK_SIZE), &enc));
+      ignore_result(dec_stream->Update(common::StringPiece(enc.data(), enc.size()), &dec));
+      decoded += dec.size();
+    }
+    enc.clear();
+    dec.clear();
+    ignore_result(enc_stream->Finish(&enc));
+    ignore_result(dec_stream->Update(common::StringPiece(enc.data(), enc.size()), &dec));
+    ignore_result(dec_stream->Finish(&dec));
+    benchmark::DoNotOptimize(decoded += dec.size());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+
+// Arg is the number of compressing threads: the caller plus Arg - 1 pool
+// workers. Input is large enough for every thread to get many blocks.
+template <typename Encode>
+void ParallelEncode(benchmark::State& state, Encode encode) {
+  const common::char_buffer_t chunk = MakeData();
+  common::char_buffer_t data;
+  for (size_t i = 0; i < 16; ++i) {
+    data.insert(data.end(), chunk.begin(), chunk.end());
+  }
+
+  const size_t threads_count = static_cast<size_t>(state.range(0));
+  common::threads::ThreadPool pool;
+  pool.Start(threads_count - 1);
+  common::threads::ThreadPool* workers = threads_count > 1 ? &pool : nullptr;
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    ignore_result(encode(data, workers, &enc));
+    benchmark::DoNotOptimize(enc.data());
+  }
+  pool.Stop();
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+}  // namespace
+
+#if defined(HAVE_ZLIB)
+static void BM_ZlibSingleStream(benchmark::State& state) {
+  ParallelEncode(state, [](const common::char_buffer_t& data, common::threads::ThreadPool*, common::char_buffer_t* out) {
+    return common::compress::EncodeZlib(data, false, 0, out, Z_DEFAULT_COMPRESSION);
+  });
+}
+BENCHMARK(BM_ZlibSingleStream)->Arg(1)->UseRealTime();
+
+static void BM_ZlibParallel(benchmark::State& state) {
+  ParallelEncode(state, [](const common::char_buffer_t& data, common::threads::ThreadPool* pool,
+                           common::char_buffer_t* out) {
+    return common::compress::EncodeZlibParallel(data, false, 0, pool, out);
+  });
+}
+BENCHMARK(BM_ZlibParallel)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+#endif
+
+#if defined(HAVE_LZ4)
+static void BM_LZ4Parallel(benchmark::State& state) {
+  ParallelEncode(state, [](const common::char_buffer_t& data, common::threads::ThreadPool* pool,
+                           common::char_buffer_t* out) { return common::compress::EncodeLZ4Parallel(data, pool, out); });
+}
+BENCHMARK(BM_LZ4Parallel)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+#endif
+
+#if defined(HAVE_BZIP2)
+static void BM_BZip2Parallel(benchmark::State& state) {
+  ParallelEncode(state, [](const common::char_buffer_t& data, common::threads::ThreadPool* pool,
+                           common::char_buffer_t* out) {
+    return common::compress::EncodeBZip2Parallel(data, false, pool, out);
+  });
+}
+BENCHMARK(BM_BZip2Parallel)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+#endif
+
+#if defined(HAVE_ZLIB)
+static void BM_ZlibOneShot(benchmark::State& state) {
+  common::CompressZlibEDcoder coder;
+  OneShotRoundTrip(state, &coder);
+}
+BENCHMARK(BM_ZlibOneShot);
+
+static void BM_ZlibStream(benchmark::State& state) {
+  common::CompressZlibEDcoder coder;
+  StreamRoundTrip(state, &coder);
+}
+BENCHMARK(BM_ZlibStream);
+#endif
+
+#if defined(HAVE_LZ4)
+static void BM_LZ4OneShot(benchmark::State& state) {
+  common::CompressLZ4EDcoder coder;
+  OneShotRoundTrip(state, &coder);
+}
+BENCHMARK(BM_LZ4OneShot);
+
+static void BM_LZ4Stream(benchmark::State& state) {
+  common::CompressLZ4EDcoder coder;
+  StreamRoundTrip(state, &coder);
+}
+BENCHMARK(BM_LZ4Stream);
+#endif
+
+namespace {
+// JSON-RPC sized messages, the regime where per-call context setup dominates
+common::char_buffer_t MakeSmallMessage(size_t size) {
+  const common::char_buffer_t data = MakeData();
+  return common::char_buffer_t(data.begin(), data.begin() + size);
+}
+}  // namespace
+
+#if defined(HAVE_ZLIB)
+static void BM_ZlibSmallFreshContext(benchmark::State& state) {
+  const common::char_buffer_t data = MakeSmallMessage(static_cast<size_t>(state.range(0)));
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    common::compress::ZlibCompressor compressor;
+    enc.clear();
+    ignore_result(compressor.Encode(data, false, &enc));
+    benchmark::DoNotOptimize(enc.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ZlibSmallFreshContext)->Arg(200)->Arg(2000);
+
+static void BM_ZlibSmallReusedContext(benchmark::State& state) {
+  const common::char_buffer_t data = MakeSmallMessage(static_cast<size_t>(state.range(0)));
+  common::compress::ZlibCompressor compressor;
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    enc.clear();
+    ignore_result(compressor.Encode(data, false, &enc));
+    benchmark::DoNotOptimize(enc.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ZlibSmallReusedContext)->Arg(200)->Arg(2000);
+
+static void BM_ZlibSmallDecode(benchmark::State& state) {
+  const common::char_buffer_t data = MakeSmallMessage(static_cast<size_t>(state.range(0)));
+  common::char_buffer_t enc;
+  ignore_result(common::compress::EncodeZlib(data, true, 0, &enc));
+  common::char_buffer_t dec;
+  for (auto _ : state) {
+    ignore_result(common::compress::DecodeZlib(enc, true, &dec));
+    benchmark::DoNotOptimize(dec.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ZlibSmallDecode)->Arg(200)->Arg(2000);
+#endif
+
+#if defined(HAVE_LZ4)
+static void BM_LZ4SmallFreshContext(benchmark::State& state) {
+  const common::char_buffer_t data = MakeSmallMessage(static_cast<size_t>(state.range(0)));
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    common::compress::LZ4Compressor compressor;
+    enc.clear();
+    ignore_result(compressor.Encode(data, false, &enc));
+    benchmark::DoNotOptimize(enc.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_LZ4SmallFreshContext)->Arg(200)->Arg(2000);
+
+static void BM_LZ4SmallReusedContext(benchmark::State& state) {
+  const common::char_buffer_t data = MakeSmallMessage(static_cast<size_t>(state.range(0)));
+  common::compress::LZ4Compressor compressor;
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    enc.clear();
+    ignore_result(compressor.Encode(data, false, &enc));
+    benchmark::DoNotOptimize(enc.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_LZ4SmallReusedContext)->Arg(200)->Arg(2000);
+#endif
+
+namespace {
+// Daemon protocol traffic: pings and stop commands, plus responses carrying
+// per stream status arrays, from about 100 bytes up to 2KB.
+std::vector<std::string> MakeProtocolMessages(size_t count) {
+  namespace json_rpc = common::protocols::json_rpc;
+  std::vector<std::string> messages;
+  uint32_t seed = 11;
+  for (size_t i = 0; i < count; ++i) {
+    seed = seed * 1103515245 + 12345;
+    std::string params;
+    std::string message;
+    if (i % 3 == 0) {
+      json_rpc::JsonRPCRequest request;
+      request.id = json_rpc::MakeRequestID(i);
+      request.method = "client_ping";
+      common::daemon::commands::ServerPingInfo ping;
+      ping.SetTimestamp(1600000000000 + seed % 100000);
+      ignore_result(ping.SerializeToString(&params));
+      request.params = params;
+      ignore_result(json_rpc::MakeJsonRPCRequest(request, &message));
+    } else if (i % 3 == 1) {
+      json_rpc::JsonRPCRequest request;
+      request.id = json_rpc::MakeRequestID(i);
+      request.method = "stop_service";
+      ignore_result(common::daemon::commands::StopInfo(seed % 10000).SerializeToString(&params));
+      request.params = params;
+      ignore_result(json_rpc::MakeJsonRPCRequest(request, &message));
+    } else {
+      std::string result = "[";
+      for (size_t j = 0; j < 1 + (seed >> 16) % 16; ++j) {
+        result += "{\"id\":\"stream_" + std::to_string((seed >> 8) % 97 + j) +
+                  "\",\"status\":\"active\",\"cpu\":" + std::to_string((seed >> 4) % 100) +
+                  ",\"rss\":" + std::to_string(seed % 100000) + ",\"timestamp\":" + std::to_string(1600000000000 + j) +
+                  "},";
+      }
+      result.back() = ']';
+      const json_rpc::JsonRPCResponse response = json_rpc::JsonRPCResponse::MakeMessage(
+          json_rpc::MakeRequestID(i), json_rpc::JsonRPCMessage::MakeSuccessMessage(result));
+      ignore_result(json_rpc::MakeJsonRPCResponse(response, &message));
+    }
+    messages.push_back(message);
+  }
+  return messages;
+}
+
+// One message per iteration, so the time column is per message. The
+// dictionary is trained on a separate slice of the traffic.
+template <typename Encode>
+void ProtocolMessagesEncode(benchmark::State& state, size_t dictionary_size, Encode encode) {
+  const std::vector<std::string> messages = MakeProtocolMessages(1000);
+  common::compress::CompressDictionarySPtr dictionary;
+  if (dictionary_size) {
+    const std::vector<common::StringPiece> samples(messages.begin(), messages.begin() + 500);
+    common::char_buffer_t content;
+    ignore_result(common::compress::TrainDictionary(samples, dictionary_size, &content));
+    dictionary = std::make_shared<common::compress::CompressDictionary>(content);
+  }
+  size_t raw_size = 0;
+  size_t encoded_size = 0;
+  size_t pos = 500;
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    const std::string& message = messages[pos];
+    ignore_result(encode(common::StringPiece(message), dictionary, &enc));
+    raw_size += message.size();
+    encoded_size += enc.size();
+    pos = pos + 1 == messages.size() ? 500 : pos + 1;
+  }
+  state.counters["ratio"] = encoded_size ? static_cast<double>(raw_size) / encoded_size : 0;
+  state.SetBytesProcessed(raw_size);
+}
+}  // namespace
+
+#if defined(HAVE_ZLIB)
+static void BM_ZlibProtocolMessages(benchmark::State& state) {
+  ProtocolMessagesEncode(state, 0,
+                         [](const common::StringPiece& data, const common::compress::CompressDictionarySPtr&,
+                            common::char_buffer_t* out) { return common::compress::EncodeZlib(data, true, 0, out); });
+}
+BENCHMARK(BM_ZlibProtocolMessages);
+
+// Arg is the dictionary size
+static void BM_ZlibDictionaryProtocolMessages(benchmark::State& state) {
+  ProtocolMessagesEncode(state, static_cast<size_t>(state.range(0)),
+                         [](const common::StringPiece& data, const common::compress::CompressDictionarySPtr& dictionary,
+                            common::char_buffer_t* out) {
+                           return common::compress::EncodeZlib(data, true, dictionary, out);
+                         });
+}
+BENCHMARK(BM_ZlibDictionaryProtocolMessages)->Arg(1024)->Arg(4096)->Arg(16384);
+#endif
+
+#if defined(HAVE_LZ4)
+static void BM_LZ4ProtocolMessages(benchmark::State& state) {
+  ProtocolMessagesEncode(state, 0,
+                         [](const common::StringPiece& data, const common::compress::CompressDictionarySPtr&,
+                            common::char_buffer_t* out) { return common::compress::EncodeLZ4(data, true, out); });
+}
+BENCHMARK(BM_LZ4ProtocolMessages);
+
+static void BM_LZ4DictionaryProtocolMessages(benchmark::State& state) {
+  ProtocolMessagesEncode(state, static_cast<size_t>(state.range(0)),
+                         [](const common::StringPiece& data, const common::compress::CompressDictionarySPtr& dictionary,
+                            common::char_buffer_t* out) {
+                           return common::compress::EncodeLZ4(data, true, dictionary, out);
+                         });
+}
+BENCHMARK(BM_LZ4DictionaryProtocolMessages)->Arg(1024)->Arg(4096)->Arg(16384);
+#endif
+
+namespace {
+// Mixed connection traffic: small JSON, a larger text body and an already
+// compressed (random) media chunk, round robin.
+std::vector<common::char_buffer_t> MakeMixedPayloads() {
+  const std::vector<std::string> messages = MakeProtocolMessages(3);
+  const common::char_buffer_t text = MakeData();
+  common::char_buffer_t media;
+  media.resize(256 * 1024);
+  uint32_t seed = 5;
+  for (char& c : media) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 16);
+  }
+  return {common::char_buffer_t(messages[2].begin(), messages[2].end()),
+          common::char_buffer_t(text.begin(), text.begin() + 256 * 1024), media};
+}
+
+void MixedPayloadsEncode(benchmark::State& state, common::IEDcoder* coder) {
+  const std::vector<common::char_buffer_t> payloads = MakeMixedPayloads();
+  size_t raw_size = 0;
+  size_t encoded_size = 0;
+  size_t pos = 0;
+  common::char_buffer_t enc;
+  for (auto _ : state) {
+    const common::char_buffer_t& payload = payloads[pos];
+    ignore_result(coder->Encode(payload, &enc));
+    raw_size += payload.size();
+    encoded_size += enc.size();
+    pos = (pos + 1) % payloads.size();
+  }
+  state.counters["ratio"] = encoded_size ? static_cast<double>(raw_size) / encoded_size : 0;
+  state.SetBytesProcessed(raw_size);
+}
+}  // namespace
+
+#if defined(HAVE_ZLIB)
+static void BM_MixedPayloadsZlib(benchmark::State& state) {
+  common::CompressZlibEDcoder coder;
+  MixedPayloadsEncode(state, &coder);
+}
+BENCHMARK(BM_MixedPayloadsZlib);
+#endif
+
+#if defined(HAVE_LZ4)
+static void BM_MixedPayloadsLZ4(benchmark::State& state) {
+  common::CompressLZ4EDcoder coder;
+  MixedPayloadsEncode(state, &coder);
+}
+BENCHMARK(BM_MixedPayloadsLZ4);
+#endif
+
+// Arg is the CompressAutoEDcoder::CpuBudget
+static void BM_MixedPayloadsAuto(benchmark::State& state) {
+  common::CompressAutoEDcoder coder(static_cast<common::CompressAutoEDcoder::CpuBudget>(state.range(0)));
+  MixedPayloadsEncode(state, &coder);
+}
+BENCHMARK(BM_MixedPayloadsAuto)->DenseRange(0, 2);
+
+static void BM_HexEncodeScalarTemp(benchmark::State& state) {
+  // previous implementation: per byte case branch and a temporary copy
+  const common::char_buffer_t data = MakeData();
+  common::char_buffer_t out;
+  for (auto _ : state) {
+    static const char lHexChars[] = "0123456789abcdef";
+    common::char_buffer_t encoded;
+    encoded.resize(data.size() * 2);
+    for (size_t i = 0; i < data.size(); ++i) {
+      const unsigned char b = data[i];
+      encoded[i * 2] = lHexChars[(b >> 4) & 0xf];
+      encoded[i * 2 + 1] = lHexChars[b & 0xf];
+    }
+    out = encoded;
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_HexEncodeScalarTemp);
+
+static void BM_HexEncode(benchmark::State& state) {
+  const common::char_buffer_t data = MakeData();
+  common::char_buffer_t out;
+  out.resize(common::compress::HexEncodedSize(data.size()));
+  const common::StringPiece input(data.data(), data.size());
+  for (auto _ : state) {
+    ignore_result(common::compress::EncodeHex(input, true, common::span<char>(out.data(), out.size())));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_HexEncode);
+
+static void BM_HexDecode(benchmark::State& state) {
+  common::char_buffer_t hex;
+  ignore_result(common::compress::EncodeHex(MakeData(), false, &hex));
+  common::char_buffer_t out;
+  out.resize(common::compress::HexDecodedSize(hex.size()));
+  const common::StringPiece input(hex.data(), hex.size());
+  for (auto _ : state) {
+    ignore_result(common::compress::DecodeHex(input, common::span<char>(out.data(), out.size())));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_HexDecode);
+
+static void BM_XHexEncode(benchmark::State& state) {
+  const common::char_buffer_t data = MakeData();
+  common::char_buffer_t out;
+  out.resize(common::compress::XHexEncodedSize(data.size()));
+  const common::StringPiece input(data.data(), data.size());
+  for (auto _ : state) {
+    ignore_result(common::compress::EncodeXHex(input, true, common::span<char>(out.data(), out.size())));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_XHexEncode);
+
+static void BM_XHexDecode(benchmark::State& state) {
+  common::char_buffer_t xhex;
+  ignore_result(common::compress::EncodeXHex(MakeData(), true, &xhex));
+  common::char_buffer_t out;
+  out.resize(common::compress::XHexDecodedSize(xhex.size()));
+  const common::StringPiece input(xhex.data(), xhex.size());
+  for (auto _ : state) {
+    ignore_result(common::compress::DecodeXHex(input, common::span<char>(out.data(), out.size())));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_XHexDecode);
+
+static void BM_UnicodeRoundTrip(benchmark::State& state) {
+  const common::char_buffer_t data = MakeData();
+  const common::string16 units(data.begin(), data.end());
+  common::char_buffer_t enc;
+  enc.resize(common::compress::UnicodeEncodedSize(units.size()));
+  common::string16 dec(units.size(), 0);
+  for (auto _ : state) {
+    ignore_result(common::compress::EncodeUnicode(units, false, common::span<char>(enc.data(), enc.size())));
+    ignore_result(common::compress::DecodeUnicode(common::StringPiece(enc.data(), enc.size()),
+                                                  common::span<common::char16>(&dec[0], dec.size())));
+    benchmark::DoNotOptimize(&dec[0]);
+  }
+  state.SetBytesProcessed(state.iterations() * units.size() * sizeof(common::char16));
+}
+BENCHMARK(BM_UnicodeRoundTrip);
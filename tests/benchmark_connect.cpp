@@ -0,0 +1,222 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/libev/http/http_client.h>
+#include <common/libev/io_loop.h>
+#include <common/libev/tcp/tcp_connection_pool.h>
+#include <common/uri/gurl.h>
+
+namespace {
+
+const char kResponse[] = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\nok";
+
+// Single threaded keep-alive HTTP responder on 127.0.0.1, so both variants
+// pay the same server cost per request.
+class LocalHttpServer {
+ public:
+  LocalHttpServer() : listen_fd_(socket(AF_INET, SOCK_STREAM, 0)), port_(0), stop_(false), thread_() {
+    const int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    listen(listen_fd_, 128);
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::thread(&LocalHttpServer::Run, this);
+  }
+
+  ~LocalHttpServer() {
+    stop_ = true;
+    thread_.join();
+    close(listen_fd_);
+  }
+
+  uint16_t port() const { return port_; }
+
+ private:
+  void Run() {
+    std::map<int, std::string> clients;
+    while (!stop_) {
+      std::vector<struct pollfd> fds = {{listen_fd_, POLLIN, 0}};
+      for (const auto& client : clients) {
+        fds.push_back({client.first, POLLIN, 0});
+      }
+      if (poll(fds.data(), fds.size(), 20) <= 0) {
+        continue;
+      }
+
+      if (fds[0].revents & POLLIN) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd >= 0) {
+          clients[fd];
+        }
+      }
+      for (size_t i = 1; i < fds.size(); ++i) {
+        if (!fds[i].revents) {
+          continue;
+        }
+
+        char buf[4096];
+        ssize_t nread = read(fds[i].fd, buf, sizeof(buf));
+        if (nread <= 0) {
+          close(fds[i].fd);
+          clients.erase(fds[i].fd);
+          continue;
+        }
+
+        std::string& pending = clients[fds[i].fd];
+        pending.append(buf, nread);
+        size_t end;
+        while ((end = pending.find("\r\n\r\n")) != std::string::npos) {
+          pending.erase(0, end + 4);
+          ssize_t nwrite = write(fds[i].fd, kResponse, sizeof(kResponse) - 1);
+          (void)nwrite;
+        }
+      }
+    }
+
+    for (const auto& client : clients) {
+      close(client.first);
+    }
+  }
+
+  const int listen_fd_;
+  uint16_t port_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+};
+
+class ClientLoop : public common::libev::IoLoop {
+ public:
+  ClientLoop() : IoLoop(new common::libev::LibEvLoop) {}
+
+  bool IsCanBeRegistered(common::libev::IoClient* client) const override {
+    UNUSED(client);
+    return true;
+  }
+
+  const char* ClassName() const override { return "ClientLoop"; }
+
+ protected:
+  common::libev::IoChild* CreateChild() override { return nullptr; }
+};
+
+// One GET over a borrowed connection, as an http::HttpClient user would do it.
+bool Exchange(const common::uri::GURL& url, const common::net::socket_info& info) {
+  common::libev::http::HttpClient client(nullptr, info);
+  common::ErrnoError err = client.Get(url, true);
+  if (err) {
+    return false;
+  }
+
+  std::string response;
+  while (response.size() < sizeof(kResponse) - 1) {
+    char buf[256];
+    size_t nread = 0;
+    err = client.SingleRead(buf, sizeof(buf), &nread);
+    if (err || nread == 0) {
+      return false;
+    }
+    response.append(buf, nread);
+  }
+  return true;
+}
+
+void RunRequests(benchmark::State& state, bool reuse) {
+  LocalHttpServer server;
+  const common::net::HostAndPort host("127.0.0.1", server.port());
+  const common::uri::GURL url("http://127.0.0.1:" + std::to_string(server.port()) + "/");
+
+  ClientLoop loop;
+  std::thread loop_thread([&loop]() { ignore_result(loop.Exec()); });
+  while (!common::libev::IoLoop::FindExistLoopByPredicate([&loop](common::libev::IoLoop* candidate) {
+    return candidate == &loop;
+  })) {
+    std::this_thread::yield();
+  }
+
+  common::libev::tcp::TcpConnectionPool* pool = nullptr;
+  loop.ExecInLoopThread([&loop, &pool]() { pool = new common::libev::tcp::TcpConnectionPool(&loop); });
+  for (auto _ : state) {
+    std::promise<bool> done;
+    loop.ExecInLoopThread([&]() {
+      pool->Acquire(host, [&](common::ErrnoError err, const common::net::socket_info& info) {
+        const bool ok = !err && Exchange(url, info);
+        if (!err) {
+          pool->Release(host, info, ok && reuse);
+        }
+        done.set_value(ok);
+      });
+    });
+    if (!done.get_future().get()) {
+      state.SkipWithError("request failed");
+      break;
+    }
+  }
+
+  std::promise<void> destroyed;
+  loop.ExecInLoopThread([&pool, &destroyed]() {
+    delete pool;
+    destroyed.set_value();
+  });
+  destroyed.get_future().wait();
+  loop.Stop();
+  loop_thread.join();
+}
+
+}  // namespace
+
+static void BM_HttpRequestNewConnection(benchmark::State& state) {
+  RunRequests(state, false);
+}
+BENCHMARK(BM_HttpRequestNewConnection)->UseRealTime();
+
+static void BM_HttpRequestPooled(benchmark::State& state) {
+  RunRequests(state, true);
+}
+BENCHMARK(BM_HttpRequestPooled)->UseRealTime();
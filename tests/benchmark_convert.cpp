@@ -0,0 +1,280 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <common/convert2string.h>
+#include <common/string_number_conversions.h>
+
+namespace {
+const size_t kValuesCount = 1024;
+
+std::vector<int64_t> MakeIntegers() {
+  std::mt19937_64 gen(39);
+  std::vector<int64_t> result;
+  for (size_t i = 0; i < kValuesCount; ++i) {
+    // Mix of magnitudes, from single digits to full 64-bit values.
+    const int shift = static_cast<int>(gen() % 64);
+    result.push_back(static_cast<int64_t>(gen() >> shift) * ((i % 2) ? -1 : 1));
+  }
+  return result;
+}
+
+std::vector<double> MakeDoubles() {
+  std::mt19937_64 gen(39);
+  std::uniform_real_distribution<double> mantissa(-1000.0, 1000.0);
+  std::vector<double> result;
+  for (size_t i = 0; i < kValuesCount; ++i) {
+    result.push_back(mantissa(gen) * ((i % 4) ? 1.0 : 1e-3));
+  }
+  return result;
+}
+
+// Numeric fields as they show up in protocol messages: ids, ports, sizes,
+// millisecond timestamps, coordinates and rates.
+std::vector<std::string> MakeIntegerFields() {
+  std::mt19937_64 gen(40);
+  std::vector<std::string> result;
+  for (size_t i = 0; i < kValuesCount; ++i) {
+    switch (i % 4) {
+      case 0:
+        result.push_back(std::to_string(gen() % 1000));
+        break;
+      case 1:
+        result.push_back(std::to_string(gen() % 65536));
+        break;
+      case 2:
+        result.push_back(std::to_string(gen() % (1ULL << 32)));
+        break;
+      default:
+        result.push_back(std::to_string(1600000000000ULL + gen() % 100000000000ULL));
+        break;
+    }
+  }
+  return result;
+}
+
+std::vector<std::string> MakeDoubleFields() {
+  std::mt19937_64 gen(40);
+  std::uniform_real_distribution<double> coordinate(-180.0, 180.0);
+  std::vector<std::string> result;
+  char buffer[64];
+  for (size_t i = 0; i < kValuesCount; ++i) {
+    switch (i % 3) {
+      case 0:
+        snprintf(buffer, sizeof(buffer), "%.2f", coordinate(gen));
+        break;
+      case 1:
+        snprintf(buffer, sizeof(buffer), "%.6f", coordinate(gen));
+        break;
+      default:
+        snprintf(buffer, sizeof(buffer), "%.17g", coordinate(gen));
+        break;
+    }
+    result.push_back(buffer);
+  }
+  return result;
+}
+
+// Per digit formatting through a temporary string, as NumberToString did.
+std::string DigitByDigitToString(int64_t value) {
+  std::string outbuf(3 * sizeof(int64_t) + 1, 0);
+  const bool is_neg = value < 0;
+  uint64_t res = is_neg ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  std::string::iterator it(outbuf.end());
+  do {
+    --it;
+    *it = static_cast<char>((res % 10) + '0');
+    res /= 10;
+  } while (res != 0);
+  if (is_neg) {
+    --it;
+    *it = '-';
+  }
+  return std::string(it, outbuf.end());
+}
+}  // namespace
+
+static void BM_IntToStringDigitByDigit(benchmark::State& state) {
+  const std::vector<int64_t> values = MakeIntegers();
+  for (auto _ : state) {
+    for (int64_t value : values) {
+      benchmark::DoNotOptimize(DigitByDigitToString(value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_IntToStringDigitByDigit);
+
+static void BM_IntToString(benchmark::State& state) {
+  const std::vector<int64_t> values = MakeIntegers();
+  for (auto _ : state) {
+    for (int64_t value : values) {
+      benchmark::DoNotOptimize(common::ConvertToString(value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_IntToString);
+
+static void BM_IntToChars(benchmark::State& state) {
+  const std::vector<int64_t> values = MakeIntegers();
+  char buffer[common::kMaxIntegerChars];
+  for (auto _ : state) {
+    for (int64_t value : values) {
+      benchmark::DoNotOptimize(common::NumberToChars(value, buffer));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_IntToChars);
+
+static void BM_DoubleFixedSnprintf(benchmark::State& state) {
+  const std::vector<double> values = MakeDoubles();
+  const int prec = static_cast<int>(state.range(0));
+  char buffer[common::kMaxFixedChars];
+  for (auto _ : state) {
+    for (double value : values) {
+      benchmark::DoNotOptimize(snprintf(buffer, sizeof(buffer), "%.*f", prec, value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DoubleFixedSnprintf)->Arg(2)->Arg(6);
+
+static void BM_DoubleFixedToChars(benchmark::State& state) {
+  const std::vector<double> values = MakeDoubles();
+  const int prec = static_cast<int>(state.range(0));
+  char buffer[common::kMaxFixedChars];
+  for (auto _ : state) {
+    for (double value : values) {
+      benchmark::DoNotOptimize(common::NumberToChars(value, prec, buffer));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DoubleFixedToChars)->Arg(2)->Arg(6);
+
+static void BM_DoubleRoundTripSnprintf(benchmark::State& state) {
+  const std::vector<double> values = MakeDoubles();
+  char buffer[common::kMaxShortestChars];
+  for (auto _ : state) {
+    for (double value : values) {
+      benchmark::DoNotOptimize(snprintf(buffer, sizeof(buffer), "%.17g", value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DoubleRoundTripSnprintf);
+
+static void BM_DoubleShortestToChars(benchmark::State& state) {
+  const std::vector<double> values = MakeDoubles();
+  char buffer[common::kMaxShortestChars];
+  for (auto _ : state) {
+    for (double value : values) {
+      benchmark::DoNotOptimize(common::NumberToShortestChars(value, buffer));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DoubleShortestToChars);
+
+static void BM_ParseInt64Strtoll(benchmark::State& state) {
+  const std::vector<std::string> fields = MakeIntegerFields();
+  for (auto _ : state) {
+    for (const std::string& field : fields) {
+      benchmark::DoNotOptimize(strtoll(field.c_str(), nullptr, 10));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fields.size());
+}
+BENCHMARK(BM_ParseInt64Strtoll);
+
+static void BM_ParseInt64(benchmark::State& state) {
+  const std::vector<std::string> fields = MakeIntegerFields();
+  for (auto _ : state) {
+    for (const std::string& field : fields) {
+      int64_t value;
+      benchmark::DoNotOptimize(common::StringToInt64(field, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fields.size());
+}
+BENCHMARK(BM_ParseInt64);
+
+static void BM_ParseDoubleStrtod(benchmark::State& state) {
+  const std::vector<std::string> fields = MakeDoubleFields();
+  for (auto _ : state) {
+    for (const std::string& field : fields) {
+      benchmark::DoNotOptimize(strtod(field.c_str(), nullptr));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fields.size());
+}
+BENCHMARK(BM_ParseDoubleStrtod);
+
+static void BM_ParseDouble(benchmark::State& state) {
+  const std::vector<std::string> fields = MakeDoubleFields();
+  for (auto _ : state) {
+    for (const std::string& field : fields) {
+      double value;
+      benchmark::DoNotOptimize(common::StringToDouble(field, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fields.size());
+}
+BENCHMARK(BM_ParseDouble);
+
+static void BM_ParseDoubleFromBytes(benchmark::State& state) {
+  std::vector<common::char_buffer_t> fields;
+  for (const std::string& field : MakeDoubleFields()) {
+    fields.push_back(common::ConvertToCharBytes(field));
+  }
+  for (auto _ : state) {
+    for (const common::char_buffer_t& field : fields) {
+      double value;
+      benchmark::DoNotOptimize(common::ConvertFromBytes(field, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fields.size());
+}
+BENCHMARK(BM_ParseDoubleFromBytes);
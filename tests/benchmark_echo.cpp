@@ -0,0 +1,160 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <thread>
+#include <vector>
+
+#include <common/libev/io_loop_observer.h>
+#include <common/libev/tcp/tcp_server.h>
+#include <common/logger.h>
+#include <common/net/net.h>
+
+namespace {
+
+const size_t kMessageSize = 64;
+
+// Writes back whatever a client sends, drops it when the peer hangs up.
+class EchoObserver : public common::libev::IoLoopObserver {
+ public:
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+  void Accepted(common::libev::IoClient* client) override { UNUSED(client); }
+  void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override {
+    UNUSED(server);
+    UNUSED(client);
+  }
+  void Closed(common::libev::IoClient* client) override { UNUSED(client); }
+  void TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) override {
+    UNUSED(server);
+    UNUSED(id);
+  }
+  void Accepted(common::libev::IoChild* child) override { UNUSED(child); }
+  void Moved(common::libev::IoLoop* server, common::libev::IoChild* child) override {
+    UNUSED(server);
+    UNUSED(child);
+  }
+  void ChildStatusChanged(common::libev::IoChild* child, int status, int signal) override {
+    UNUSED(child);
+    UNUSED(status);
+    UNUSED(signal);
+  }
+  void DataReceived(common::libev::IoClient* client) override {
+    char buf[4096];
+    while (true) {
+      size_t nread = 0;
+      common::ErrnoError err = client->SingleRead(buf, sizeof(buf), &nread);
+      if (err && err->GetErrorCode() == EAGAIN) {
+        return;
+      }
+      size_t nwrite = 0;
+      if (err || nread == 0 || client->Write(buf, nread, &nwrite)) {
+        ignore_result(client->Close());
+        delete client;
+        return;
+      }
+    }
+  }
+  void DataReadyToWrite(common::libev::IoClient* client) override { UNUSED(client); }
+  void PostLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+};
+
+}  // namespace
+
+// range(0): IoBackend, range(1): connections pinged at once. Every iteration
+// sends one message per connection, then waits for all the echoes.
+static void BM_Echo(benchmark::State& state) {
+  const common::libev::IoBackend backend = static_cast<common::libev::IoBackend>(state.range(0));
+  const size_t connections = state.range(1);
+
+  EchoObserver observer;
+  common::libev::tcp::TcpServer server(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &observer);
+  if (server.Bind(true) || server.Listen(1024)) {
+    state.SkipWithError("listen failed");
+    return;
+  }
+  if (server.SetBackend(backend)) {
+    state.SkipWithError("backend is not available");
+    return;
+  }
+  common::libev::tcp::TcpAcceptOptions options;
+  options.nonblocking = true;
+  options.socket_options.no_delay = true;
+  options.log_interval_msec = 60000;
+  server.SetAcceptOptions(options);
+  std::thread loop_thread([&server]() { ignore_result(server.Exec()); });
+
+  std::vector<common::net::socket_info> clients(connections);
+  for (size_t i = 0; i < connections; ++i) {
+    if (common::net::connect(server.GetHost(), common::net::ST_SOCK_STREAM, nullptr, &clients[i])) {
+      state.SkipWithError("connect failed");
+      break;
+    }
+    int no_delay = 1;
+    setsockopt(clients[i].fd(), IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  }
+
+  const std::string message(kMessageSize, 'e');
+  char echo[kMessageSize];
+  for (auto _ : state) {
+    for (size_t i = 0; i < connections; ++i) {
+      size_t nwrite = 0;
+      ignore_result(common::net::write_to_socket(clients[i].fd(), message.data(), message.size(), &nwrite));
+    }
+    for (size_t i = 0; i < connections; ++i) {
+      size_t total = 0;
+      while (total < kMessageSize) {
+        ssize_t res = ::recv(clients[i].fd(), echo + total, kMessageSize - total, 0);
+        if (res <= 0) {
+          state.SkipWithError("echo failed");
+          break;
+        }
+        total += res;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * connections);
+  state.SetBytesProcessed(state.iterations() * connections * kMessageSize);
+
+  for (size_t i = 0; i < connections; ++i) {
+    ignore_result(common::net::close(clients[i].fd()));
+  }
+  server.Stop();
+  loop_thread.join();
+}
+BENCHMARK(BM_Echo)
+    ->Args({common::libev::IO_BACKEND_LIBEV, 1})
+    ->Args({common::libev::IO_BACKEND_URING, 1})
+    ->Args({common::libev::IO_BACKEND_LIBEV, 64})
+    ->Args({common::libev::IO_BACKEND_URING, 64})
+    ->UseRealTime();
@@ -0,0 +1,114 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <common/libev/event_loop.h>
+
+namespace {
+
+// Tasks posted per producer and iteration.
+const size_t kPosts = 10000;
+
+// A LibEvLoop running in its own thread for the lifetime of a benchmark.
+class RunningLoop {
+ public:
+  RunningLoop() : loop_(new common::libev::LibEvLoop), thread_([this]() { ignore_result(loop_->Exec()); }) {
+    // wait for Exec to take the loop thread
+    std::atomic<bool> started(false);
+    loop_->ExecInLoopThread([&started]() { started = true; });
+    while (!started) {
+      std::this_thread::yield();
+    }
+  }
+
+  ~RunningLoop() {
+    loop_->Stop();
+    thread_.join();
+    delete loop_;
+  }
+
+  common::libev::LibEvLoop* loop() const { return loop_; }
+
+ private:
+  common::libev::LibEvLoop* const loop_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+// range(0) producer threads post kPosts small tasks each, the iteration ends
+// once the loop ran all of them: cross-thread tasks/sec.
+static void BM_ExecInLoopThroughput(benchmark::State& state) {
+  RunningLoop running;
+  common::libev::LibEvLoop* loop = running.loop();
+  const size_t producers = state.range(0);
+  std::atomic<size_t> executed(0);
+
+  size_t expected = 0;
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+      threads.push_back(std::thread([loop, &executed]() {
+        for (size_t i = 0; i < kPosts; ++i) {
+          loop->ExecInLoopThread([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+        }
+      }));
+    }
+    for (size_t p = 0; p < producers; ++p) {
+      threads[p].join();
+    }
+    expected += producers * kPosts;
+    while (executed.load() < expected) {
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * producers * kPosts);
+}
+BENCHMARK(BM_ExecInLoopThroughput)->Arg(1)->Arg(4)->UseRealTime();
+
+// One task in flight: time from posting until it ran in the loop thread,
+// i.e. the wakeup latency.
+static void BM_ExecInLoopLatency(benchmark::State& state) {
+  RunningLoop running;
+  common::libev::LibEvLoop* loop = running.loop();
+  std::atomic<bool> ran(false);
+
+  for (auto _ : state) {
+    ran = false;
+    loop->ExecInLoopThread([&ran]() { ran = true; });
+    while (!ran) {
+    }
+  }
+}
+BENCHMARK(BM_ExecInLoopLatency)->UseRealTime();
@@ -0,0 +1,254 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <common/hash/crc.h>
+#include <common/hash/fast_hash.h>
+#include <common/hash/sha1.h>
+#include <common/hash/sha256.h>
+
+namespace {
+const size_t kDataSize = 16 * 1024 * 1024;
+
+std::vector<unsigned char> MakeData() {
+  std::vector<unsigned char> data(kDataSize);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < data.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<unsigned char>(seed >> 16);
+  }
+  return data;
+}
+
+uint64_t Crc64Bytewise(uint64_t crc, const unsigned char* data, size_t len) {
+  static uint64_t table[256];
+  if (!table[1]) {
+    for (unsigned i = 0; i < 256; ++i) {
+      uint64_t c = i;
+      for (int j = 0; j < 8; ++j) {
+        c = (c & 1) ? (c >> 1) ^ 0x95ac9329ac4bc9b5ULL : c >> 1;
+      }
+      table[i] = c;
+    }
+  }
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[static_cast<unsigned char>(crc) ^ data[i]] ^ (crc >> 8);
+  }
+  return crc;
+}
+}  // namespace
+
+static void BM_Crc64Bytewise(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Crc64Bytewise(0, data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Crc64Bytewise);
+
+static void BM_Crc64Portable(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::hash::crc64_portable(0, data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Crc64Portable);
+
+static void BM_Crc64(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::hash::crc64(0, data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Crc64);
+
+static void BM_Crc32cPortable(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::hash::crc32c_portable(0, data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Crc32cPortable);
+
+static void BM_Crc32c(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::hash::crc32c(0, data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Crc32c);
+
+static void BM_Sha1(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  unsigned char result[SHA1_HASH_LENGTH];
+  for (auto _ : state) {
+    common::hash::SHA1_CTX ctx;
+    common::hash::SHA1_Init(&ctx);
+    common::hash::SHA1_Update(&ctx, data.data(), data.size());
+    common::hash::SHA1_Final(&ctx, result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Sha1);
+
+static void BM_Sha256(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  unsigned char result[SHA256_HASH_LENGHT];
+  for (auto _ : state) {
+    common::hash::SHA256_CTX ctx;
+    common::hash::SHA256_Init(&ctx);
+    common::hash::SHA256_Update(&ctx, data.data(), data.size());
+    common::hash::SHA256_Final(&ctx, result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_Sha256);
+
+// websocket handshake sized messages: key + guid
+const size_t kKeysCount = 1024;
+const size_t kKeySize = 60;
+
+static void BM_Sha1Keys(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  unsigned char result[SHA1_HASH_LENGTH];
+  for (auto _ : state) {
+    for (size_t i = 0; i < kKeysCount; ++i) {
+      common::hash::SHA1_CTX ctx;
+      common::hash::SHA1_Init(&ctx);
+      common::hash::SHA1_Update(&ctx, data.data() + i * kKeySize, kKeySize);
+      common::hash::SHA1_Final(&ctx, result);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysCount);
+}
+BENCHMARK(BM_Sha1Keys);
+
+static void BM_Sha1KeysMulti(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  std::vector<const unsigned char*> keys(kKeysCount);
+  std::vector<size_t> lens(kKeysCount, kKeySize);
+  for (size_t i = 0; i < kKeysCount; ++i) {
+    keys[i] = data.data() + i * kKeySize;
+  }
+  std::vector<unsigned char> results(kKeysCount * SHA1_HASH_LENGTH);
+  for (auto _ : state) {
+    common::hash::SHA1_Multi(keys.data(), lens.data(), kKeysCount, results.data());
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysCount);
+}
+BENCHMARK(BM_Sha1KeysMulti);
+
+static void BM_Sha256KeysMulti(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  std::vector<const unsigned char*> keys(kKeysCount);
+  std::vector<size_t> lens(kKeysCount, kKeySize);
+  for (size_t i = 0; i < kKeysCount; ++i) {
+    keys[i] = data.data() + i * kKeySize;
+  }
+  std::vector<unsigned char> results(kKeysCount * SHA256_HASH_LENGHT);
+  for (auto _ : state) {
+    common::hash::SHA256_Multi(keys.data(), lens.data(), kKeysCount, results.data());
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysCount);
+}
+BENCHMARK(BM_Sha256KeysMulti);
+
+static void BM_FastHash64(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::hash::FastHash64(data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_FastHash64);
+
+static void BM_FastHash128(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::hash::FastHash128(data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * kDataSize);
+}
+BENCHMARK(BM_FastHash128);
+
+// hash table sized keys
+static void BM_Crc64ShortKeys(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  const size_t key_size = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    for (size_t i = 0; i < kKeysCount; ++i) {
+      benchmark::DoNotOptimize(common::hash::crc64(0, data.data() + i * key_size, key_size));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysCount);
+}
+BENCHMARK(BM_Crc64ShortKeys)->Arg(8)->Arg(32)->Arg(100);
+
+static void BM_StdHashShortKeys(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  const size_t key_size = static_cast<size_t>(state.range(0));
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < kKeysCount; ++i) {
+    keys.emplace_back(reinterpret_cast<const char*>(data.data()) + i * key_size, key_size);
+  }
+  for (auto _ : state) {
+    for (const std::string& key : keys) {
+      benchmark::DoNotOptimize(std::hash<std::string>()(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysCount);
+}
+BENCHMARK(BM_StdHashShortKeys)->Arg(8)->Arg(32)->Arg(100);
+
+static void BM_FastHashShortKeys(benchmark::State& state) {
+  const std::vector<unsigned char> data = MakeData();
+  const size_t key_size = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    for (size_t i = 0; i < kKeysCount; ++i) {
+      benchmark::DoNotOptimize(common::hash::FastHash64(data.data() + i * key_size, key_size));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysCount);
+}
+BENCHMARK(BM_FastHashShortKeys)->Arg(8)->Arg(32)->Arg(100);
@@ -0,0 +1,211 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <future>
+#include <string>
+#include <thread>
+
+#include <common/libev/io_loop.h>
+#include <common/libev/tcp/file_transfer.h>
+#include <common/libev/tcp/tcp_client.h>
+#include <common/net/net.h>
+
+namespace {
+
+const char kFilePath[] = "/tmp/benchmark_sendfile.bin";
+
+// Sparse file of |size_mb|, reads come from the page cache without disk I/O.
+int MakeSparseFile(size_t size_mb) {
+  int fd = open(kFilePath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd != INVALID_DESCRIPTOR && ftruncate(fd, static_cast<off_t>(size_mb) << 20) != 0) {
+    close(fd);
+    return INVALID_DESCRIPTOR;
+  }
+  return fd;
+}
+
+// Connected 127.0.0.1 pair with a thread discarding everything on the far end.
+class LoopbackSink {
+ public:
+  LoopbackSink() : send_fd_(INVALID_DESCRIPTOR), recv_fd_(INVALID_DESCRIPTOR), thread_() {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    listen(listen_fd, 1);
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    recv_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    connect(recv_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    send_fd_ = accept(listen_fd, nullptr, nullptr);
+    close(listen_fd);
+    thread_ = std::thread(&LoopbackSink::Drain, this);
+  }
+
+  ~LoopbackSink() {
+    if (send_fd_ != INVALID_DESCRIPTOR) {
+      close(send_fd_);
+    }
+    thread_.join();
+    close(recv_fd_);
+  }
+
+  int send_fd() const { return send_fd_; }
+
+  // The socket now belongs to an IoClient which closes it.
+  void release_send_fd() { send_fd_ = INVALID_DESCRIPTOR; }
+
+ private:
+  void Drain() {
+    static char buffer[1 << 20];
+    while (read(recv_fd_, buffer, sizeof(buffer)) > 0) {
+    }
+  }
+
+  int send_fd_;
+  int recv_fd_;
+  std::thread thread_;
+};
+
+class SendLoop : public common::libev::IoLoop {
+ public:
+  SendLoop() : IoLoop(new common::libev::LibEvLoop) {}
+
+  bool IsCanBeRegistered(common::libev::IoClient* client) const override {
+    UNUSED(client);
+    return true;
+  }
+
+  const char* ClassName() const override { return "SendLoop"; }
+
+ protected:
+  common::libev::IoChild* CreateChild() override { return nullptr; }
+};
+
+}  // namespace
+
+static void BM_SendFileLoop(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0)) << 20;
+  int fd = MakeSparseFile(state.range(0));
+  LoopbackSink sink;
+
+  SendLoop loop;
+  std::thread loop_thread([&loop]() { ignore_result(loop.Exec()); });
+  while (!common::libev::IoLoop::FindExistLoopByPredicate(
+      [&loop](common::libev::IoLoop* candidate) { return candidate == &loop; })) {
+    std::this_thread::yield();
+  }
+
+  const int sock = sink.send_fd();
+  sink.release_send_fd();
+  common::libev::IoClient* client = nullptr;
+  loop.ExecInLoopThread([&loop, &client, sock]() {
+    client = new common::libev::tcp::TcpClient(&loop, common::net::socket_info(sock));
+    ignore_result(loop.RegisterClient(client));
+  });
+
+  const common::libev::tcp::FileTransferOptions options;
+  for (auto _ : state) {
+    std::promise<bool> done;
+    loop.ExecInLoopThread([&]() {
+      common::ErrnoError err = loop.SendFile(client, fd, 0, size, options, nullptr,
+                                             [&done, size](common::ErrnoError lerr, size_t sent) {
+                                               done.set_value(!lerr && sent == size);
+                                             });
+      if (err) {
+        done.set_value(false);
+      }
+    });
+    if (!done.get_future().get()) {
+      state.SkipWithError("transfer failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+
+  loop.Stop();
+  loop_thread.join();
+  close(fd);
+  unlink(kFilePath);
+}
+BENCHMARK(BM_SendFileLoop)->Arg(64)->Arg(1024)->Arg(4096)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// The blocking helper, for the cost of driving the transfer from the loop.
+static void BM_SendFileBlocking(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0)) << 20;
+  int fd = MakeSparseFile(state.range(0));
+  LoopbackSink sink;
+  for (auto _ : state) {
+    common::ErrnoError err = common::net::send_file_to_fd(sink.send_fd(), fd, 0, size);
+    if (err) {
+      state.SkipWithError("transfer failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+  close(fd);
+  unlink(kFilePath);
+}
+BENCHMARK(BM_SendFileBlocking)->Arg(64)->Arg(1024)->Arg(4096)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// pread + write through a user space buffer, what sendfile saves.
+static void BM_SendFileReadWrite(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0)) << 20;
+  int fd = MakeSparseFile(state.range(0));
+  LoopbackSink sink;
+  static char buffer[256 * 1024];
+  for (auto _ : state) {
+    size_t offset = 0;
+    while (offset < size) {
+      ssize_t nread = pread(fd, buffer, sizeof(buffer), offset);
+      if (nread <= 0 || write(sink.send_fd(), buffer, nread) != nread) {
+        break;
+      }
+      offset += nread;
+    }
+    if (offset != size) {
+      state.SkipWithError("transfer failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+  close(fd);
+  unlink(kFilePath);
+}
+BENCHMARK(BM_SendFileReadWrite)->Arg(64)->Arg(1024)->UseRealTime()->Unit(benchmark::kMillisecond);
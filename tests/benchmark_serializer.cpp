@@ -0,0 +1,363 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <memory>
+#include <string>
+
+#include <common/compress/base64.h>
+#include <common/convert2string.h>
+#include <common/daemon/commands/ping_info.h>
+#include <common/protocols/json_rpc/json_rpc.h>
+#include <common/serializer/binary_serializer.h>
+#include <common/serializer/json_serializer.h>
+#include <common/value.h>
+
+namespace {
+const size_t kRecordsCount = 256;
+const size_t kPayloadSize = 256;
+
+common::ArrayValue* MakeRecords() {
+  common::ArrayValue* records = common::Value::CreateArrayValue();
+  for (size_t i = 0; i < kRecordsCount; ++i) {
+    common::HashValue* record = common::Value::CreateHashValue();
+    ignore_result(record->Insert(std::string("id"), common::Value::CreateULongLongIntegerValue(i)));
+    ignore_result(record->Insert(std::string("score"), common::Value::CreateDoubleValue(i * 0.5)));
+    ignore_result(record->Insert(std::string("name"), common::Value::CreateStringValue(common::ConvertToCharBytes(
+                                                             "record_" + common::ConvertToString(i)))));
+    common::byte_array_t payload;
+    for (size_t j = 0; j < kPayloadSize; ++j) {
+      payload.push_back(static_cast<common::byte_t>(i + j));
+    }
+    ignore_result(record->Insert(std::string("payload"), common::Value::CreateByteArrayValue(std::move(payload))));
+    records->Append(record);
+  }
+  return records;
+}
+
+json_object* RecordsToJson(const common::ArrayValue* records) {
+  json_object* jrecords = json_object_new_array();
+  for (const common::Value* val : *records) {
+    const common::HashValue* record = nullptr;
+    if (!val->GetAsHash(&record)) {
+      continue;
+    }
+
+    json_object* jrecord = json_object_new_object();
+    for (const auto& field : *record) {
+      const std::string key = field.first.as_string();
+      const common::Value* fval = field.second;
+      unsigned long long id;
+      double score;
+      common::StringPiece name;
+      common::span<const common::byte_t> payload;
+      if (fval->GetAsULongLongInteger(&id)) {
+        json_object_object_add(jrecord, key.c_str(), json_object_new_uint64(id));
+      } else if (fval->GetAsDouble(&score)) {
+        json_object_object_add(jrecord, key.c_str(), json_object_new_double(score));
+      } else if (fval->GetAsStringPiece(&name)) {
+        json_object_object_add(jrecord, key.c_str(), json_object_new_string_len(name.data(), name.size()));
+      } else if (fval->GetAsByteSpan(&payload)) {
+        common::char_buffer_t b64;
+        common::StringPiece raw(reinterpret_cast<const char*>(payload.data()), payload.size());
+        ignore_result(common::compress::EncodeBase64(raw, &b64));
+        json_object_object_add(jrecord, key.c_str(), json_object_new_string_len(b64.data(), b64.size()));
+      }
+    }
+    json_object_array_add(jrecords, jrecord);
+  }
+  return jrecords;
+}
+
+common::protocols::json_rpc::JsonRPCRequest MakeRpcRequest() {
+  common::protocols::json_rpc::JsonRPCRequest req;
+  req.id = common::protocols::json_rpc::MakeRequestID(12345);
+  req.method = "client_ping";
+  req.params = std::string("{\"timestamp\":1590000000000,\"name\":\"stream \\\"main\\\"\"}");
+  return req;
+}
+
+// request serialized via a json-c document, as before the in-tree writer/reader
+std::string MakeRpcRequestJsonc(const common::protocols::json_rpc::JsonRPCRequest& req) {
+  json_object* jreq = json_object_new_object();
+  json_object_object_add(jreq, "jsonrpc", json_object_new_string(JSONRPC_VERSION));
+  json_object_object_add(jreq, "method", json_object_new_string(req.method.c_str()));
+  json_object_object_add(jreq, "id", json_object_new_string(req.id->c_str()));
+  json_object_object_add(jreq, "params", json_tokener_parse(req.params->c_str()));
+  std::string result = json_object_get_string(jreq);
+  json_object_put(jreq);
+  return result;
+}
+
+class StreamStats : public common::serializer::JsonFieldsSerializer<StreamStats> {
+ public:
+  StreamStats() : id(), name(), bitrate(0), width(0), height(0), fps(0), enabled(false), created(0) {}
+
+  static constexpr auto json_fields() {
+    using namespace common::serializer;
+    return std::make_tuple(MakeJsonField("id", &StreamStats::id), MakeJsonField("name", &StreamStats::name),
+                           MakeJsonField("bitrate", &StreamStats::bitrate), MakeJsonField("width", &StreamStats::width),
+                           MakeJsonField("height", &StreamStats::height), MakeJsonField("fps", &StreamStats::fps),
+                           MakeJsonField("enabled", &StreamStats::enabled),
+                           MakeJsonField("created", &StreamStats::created));
+  }
+
+  std::string id;
+  std::string name;
+  uint64_t bitrate;
+  int width;
+  int height;
+  double fps;
+  bool enabled;
+  int64_t created;
+};
+
+std::string MakeStreamStatsJson() {
+  StreamStats stats;
+  stats.id = "5e9f1b7c0a1d";
+  stats.name = "main stream";
+  stats.bitrate = 4500000;
+  stats.width = 1920;
+  stats.height = 1080;
+  stats.fps = 29.97;
+  stats.enabled = true;
+  stats.created = 1590000000000;
+  std::string out;
+  ignore_result(stats.SerializeToString(&out));
+  return out;
+}
+}  // namespace
+
+static void BM_SerializeBinaryEncode(benchmark::State& state) {
+  std::unique_ptr<common::ArrayValue> records(MakeRecords());
+  common::serializer::ValueBinaryCodec codec;
+  size_t size = 0;
+  for (auto _ : state) {
+    common::buffer_t out;
+    ignore_result(codec.Encode(records.get(), &out));
+    size = out.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.counters["size"] = size;
+}
+BENCHMARK(BM_SerializeBinaryEncode);
+
+static void BM_SerializeJsonEncode(benchmark::State& state) {
+  std::unique_ptr<common::ArrayValue> records(MakeRecords());
+  size_t size = 0;
+  for (auto _ : state) {
+    json_object* jrecords = RecordsToJson(records.get());
+    std::string out = json_object_to_json_string_ext(jrecords, JSON_C_TO_STRING_PLAIN);
+    json_object_put(jrecords);
+    size = out.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.counters["size"] = size;
+}
+BENCHMARK(BM_SerializeJsonEncode);
+
+static void BM_SerializeBinaryDecode(benchmark::State& state) {
+  std::unique_ptr<common::ArrayValue> records(MakeRecords());
+  common::serializer::ValueBinaryCodec codec;
+  common::buffer_t encoded;
+  ignore_result(codec.Encode(records.get(), &encoded));
+  for (auto _ : state) {
+    common::Value* decoded = nullptr;
+    ignore_result(codec.Decode(encoded, &decoded));
+    delete decoded;
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_SerializeBinaryDecode);
+
+static void BM_SerializeJsonDecode(benchmark::State& state) {
+  std::unique_ptr<common::ArrayValue> records(MakeRecords());
+  json_object* jrecords = RecordsToJson(records.get());
+  const std::string encoded = json_object_to_json_string_ext(jrecords, JSON_C_TO_STRING_PLAIN);
+  json_object_put(jrecords);
+  for (auto _ : state) {
+    json_object* parsed = json_tokener_parse(encoded.c_str());
+    benchmark::DoNotOptimize(parsed);
+    json_object_put(parsed);
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_SerializeJsonDecode);
+
+static void BM_JsonRpcRequestMakeJsonc(benchmark::State& state) {
+  const common::protocols::json_rpc::JsonRPCRequest req = MakeRpcRequest();
+  for (auto _ : state) {
+    std::string out = MakeRpcRequestJsonc(req);
+    benchmark::DoNotOptimize(out.data());
+  }
+}
+BENCHMARK(BM_JsonRpcRequestMakeJsonc);
+
+static void BM_JsonRpcRequestMake(benchmark::State& state) {
+  const common::protocols::json_rpc::JsonRPCRequest req = MakeRpcRequest();
+  for (auto _ : state) {
+    std::string out;
+    ignore_result(common::protocols::json_rpc::MakeJsonRPCRequest(req, &out));
+    benchmark::DoNotOptimize(out.data());
+  }
+}
+BENCHMARK(BM_JsonRpcRequestMake);
+
+static void BM_JsonRpcRequestParseJsonc(benchmark::State& state) {
+  const std::string data = MakeRpcRequestJsonc(MakeRpcRequest());
+  for (auto _ : state) {
+    json_object* jdata = json_tokener_parse(data.c_str());
+    common::protocols::json_rpc::JsonRPCRequest req;
+    json_object* jfield = nullptr;
+    if (json_object_object_get_ex(jdata, "method", &jfield)) {
+      req.method = json_object_get_string(jfield);
+    }
+    if (json_object_object_get_ex(jdata, "id", &jfield)) {
+      req.id = std::string(json_object_get_string(jfield));
+    }
+    if (json_object_object_get_ex(jdata, "params", &jfield)) {
+      req.params = std::string(json_object_get_string(jfield));
+    }
+    json_object_put(jdata);
+    benchmark::DoNotOptimize(req);
+  }
+}
+BENCHMARK(BM_JsonRpcRequestParseJsonc);
+
+static void BM_JsonRpcRequestParse(benchmark::State& state) {
+  const std::string data = MakeRpcRequestJsonc(MakeRpcRequest());
+  for (auto _ : state) {
+    common::protocols::json_rpc::JsonRPCRequest req;
+    ignore_result(common::protocols::json_rpc::ParseJsonRPCRequest(data, &req));
+    benchmark::DoNotOptimize(req);
+  }
+}
+BENCHMARK(BM_JsonRpcRequestParse);
+
+static void BM_DaemonPingSerializeJsonc(benchmark::State& state) {
+  const common::daemon::commands::ServerPingInfo ping;
+  for (auto _ : state) {
+    json_object* jping = nullptr;
+    ignore_result(ping.Serialize(&jping));
+    std::string out = json_object_get_string(jping);
+    json_object_put(jping);
+    benchmark::DoNotOptimize(out.data());
+  }
+}
+BENCHMARK(BM_DaemonPingSerializeJsonc);
+
+static void BM_DaemonPingSerialize(benchmark::State& state) {
+  const common::daemon::commands::ServerPingInfo ping;
+  for (auto _ : state) {
+    std::string out;
+    ignore_result(ping.SerializeToString(&out));
+    benchmark::DoNotOptimize(out.data());
+  }
+}
+BENCHMARK(BM_DaemonPingSerialize);
+
+static void BM_DaemonPingDeSerializeJsonc(benchmark::State& state) {
+  std::string data;
+  ignore_result(common::daemon::commands::ServerPingInfo().SerializeToString(&data));
+  for (auto _ : state) {
+    common::daemon::commands::ServerPingInfo ping;
+    json_object* jping = json_tokener_parse(data.c_str());
+    ignore_result(ping.DeSerialize(jping));
+    json_object_put(jping);
+    benchmark::DoNotOptimize(ping);
+  }
+}
+BENCHMARK(BM_DaemonPingDeSerializeJsonc);
+
+static void BM_DaemonPingDeSerialize(benchmark::State& state) {
+  std::string data;
+  ignore_result(common::daemon::commands::ServerPingInfo().SerializeToString(&data));
+  for (auto _ : state) {
+    common::daemon::commands::ServerPingInfo ping;
+    ignore_result(ping.DeSerializeFromString(data));
+    benchmark::DoNotOptimize(ping);
+  }
+}
+BENCHMARK(BM_DaemonPingDeSerialize);
+
+// one json-c lookup per field, as the hand written DoDeSerialize implementations did
+static void BM_JsonFieldsJsonc(benchmark::State& state) {
+  using namespace common::serializer;
+  const std::string data = MakeStreamStatsJson();
+  for (auto _ : state) {
+    StreamStats stats;
+    json_object* jstats = json_tokener_parse(data.c_str());
+    ignore_result(json_get_string(jstats, "id", &stats.id));
+    ignore_result(json_get_string(jstats, "name", &stats.name));
+    ignore_result(json_get_uint64(jstats, "bitrate", &stats.bitrate));
+    ignore_result(json_get_int(jstats, "width", &stats.width));
+    ignore_result(json_get_int(jstats, "height", &stats.height));
+    ignore_result(json_get_double(jstats, "fps", &stats.fps));
+    ignore_result(json_get_bool(jstats, "enabled", &stats.enabled));
+    ignore_result(json_get_int64(jstats, "created", &stats.created));
+    json_object_put(jstats);
+    benchmark::DoNotOptimize(stats);
+  }
+}
+BENCHMARK(BM_JsonFieldsJsonc);
+
+// one in-tree lookup per field, every lookup rescans the object
+static void BM_JsonFieldsLookup(benchmark::State& state) {
+  using namespace common::serializer;
+  const std::string data = MakeStreamStatsJson();
+  for (auto _ : state) {
+    StreamStats stats;
+    JsonValue root;
+    ignore_result(ParseJson(data, &root));
+    ignore_result(root.GetStringField("id", &stats.id));
+    ignore_result(root.GetStringField("name", &stats.name));
+    ignore_result(root.GetUInt64Field("bitrate", &stats.bitrate));
+    ignore_result(root.GetIntField("width", &stats.width));
+    ignore_result(root.GetIntField("height", &stats.height));
+    ignore_result(root.GetDoubleField("fps", &stats.fps));
+    ignore_result(root.GetBoolField("enabled", &stats.enabled));
+    ignore_result(root.GetInt64Field("created", &stats.created));
+    benchmark::DoNotOptimize(stats);
+  }
+}
+BENCHMARK(BM_JsonFieldsLookup);
+
+static void BM_JsonFieldsReflected(benchmark::State& state) {
+  const std::string data = MakeStreamStatsJson();
+  for (auto _ : state) {
+    StreamStats stats;
+    ignore_result(stats.DeSerializeFromString(data));
+    benchmark::DoNotOptimize(stats);
+  }
+}
+BENCHMARK(BM_JsonFieldsReflected);
@@ -0,0 +1,115 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <ev.h>
+
+#include <random>
+#include <vector>
+
+#include <common/libev/timer_wheel.h>
+
+namespace {
+
+// Live timers, like one idle timeout per connection of a busy server.
+const size_t kTimers = 100000;
+// Timers reset per iteration, i.e. connections that saw traffic.
+const size_t kResets = 1000;
+// Deadlines spread over 30 seconds of 10 msec ticks.
+const uint64_t kMaxDelayTicks = 3000;
+
+}  // namespace
+
+// Every iteration resets kResets random timers and advances one tick, fired
+// timers are rescheduled so the population stays at kTimers.
+static void BM_TimerWheelChurn(benchmark::State& state) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<uint64_t> delay(1, kMaxDelayTicks);
+  std::uniform_int_distribution<size_t> pick(0, kTimers - 1);
+
+  common::libev::TimerWheel* wheel = nullptr;
+  common::libev::TimerWheel w([&](common::libev::TimerWheelNode* node) { wheel->Schedule(node, delay(rng)); });
+  wheel = &w;
+  std::vector<common::libev::TimerWheelNode> nodes(kTimers);
+  for (size_t i = 0; i < kTimers; ++i) {
+    w.Schedule(&nodes[i], delay(rng));
+  }
+
+  size_t fired = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kResets; ++i) {
+      w.Schedule(&nodes[pick(rng)], delay(rng));
+    }
+    fired += w.AdvanceTo(w.GetCurrentTick() + 1);
+  }
+  state.SetItemsProcessed(state.iterations() * kResets);
+  state.counters["fired"] = benchmark::Counter(static_cast<double>(fired), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_TimerWheelChurn);
+
+namespace {
+
+void RearmTimer(struct ev_loop* loop, ev_timer* timer, int revents) {
+  UNUSED(revents);
+  ev_timer_again(loop, timer);
+}
+
+}  // namespace
+
+// Same churn with one libev timer per connection, what IoLoop::CreateTimer
+// amounts to: every reset is an O(log n) heap update.
+static void BM_LibevTimerChurn(benchmark::State& state) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<uint64_t> delay(1, kMaxDelayTicks);
+  std::uniform_int_distribution<size_t> pick(0, kTimers - 1);
+
+  struct ev_loop* loop = ev_loop_new(0);
+  std::vector<ev_timer> timers(kTimers);
+  for (size_t i = 0; i < kTimers; ++i) {
+    ev_timer_init(&timers[i], RearmTimer, 0, delay(rng) * 0.01);
+    ev_timer_again(loop, &timers[i]);
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < kResets; ++i) {
+      ev_timer* timer = &timers[pick(rng)];
+      timer->repeat = delay(rng) * 0.01;
+      ev_timer_again(loop, timer);
+    }
+    ev_run(loop, EVRUN_NOWAIT);
+  }
+  state.SetItemsProcessed(state.iterations() * kResets);
+
+  for (size_t i = 0; i < kTimers; ++i) {
+    ev_timer_stop(loop, &timers[i]);
+  }
+  ev_loop_destroy(loop);
+}
+BENCHMARK(BM_LibevTimerChurn);
@@ -0,0 +1,160 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <common/net/datagram_batch.h>
+#include <common/net/net.h>
+
+namespace {
+
+// Datagrams in flight per iteration, small enough for the default buffers.
+const size_t kBurst = 50;
+
+// Two UDP sockets on 127.0.0.1, single threaded: every iteration sends a
+// burst and reads it back, so the numbers are syscall bound packets/sec.
+class LoopbackPair {
+ public:
+  LoopbackPair() : from_(socket(AF_INET, SOCK_DGRAM, 0)), to_(socket(AF_INET, SOCK_DGRAM, 0)), addr_() {
+    addr_.sin_family = AF_INET;
+    addr_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr_);
+    bind(to_, reinterpret_cast<struct sockaddr*>(&addr_), len);
+    getsockname(to_, reinterpret_cast<struct sockaddr*>(&addr_), &len);
+    const int size = 4 << 20;
+    setsockopt(to_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  }
+
+  ~LoopbackPair() {
+    close(from_);
+    close(to_);
+  }
+
+  int from() const { return from_; }
+  int to() const { return to_; }
+  struct sockaddr* addr() { return reinterpret_cast<struct sockaddr*>(&addr_); }
+  socklen_t addr_len() const { return sizeof(addr_); }
+
+ private:
+  int from_;
+  int to_;
+  struct sockaddr_in addr_;
+};
+
+}  // namespace
+
+static void BM_UdpSingle(benchmark::State& state) {
+  LoopbackPair pair;
+  const std::string payload(state.range(0), 'p');
+  char buffer[2048];
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBurst; ++i) {
+      ssize_t nwrite = 0;
+      if (common::net::sendto(pair.from(), payload.data(), payload.size(), pair.addr(), pair.addr_len(), &nwrite)) {
+        state.SkipWithError("sendto failed");
+        return;
+      }
+    }
+    for (size_t i = 0; i < kBurst; ++i) {
+      struct sockaddr_storage peer;
+      socklen_t peer_len = sizeof(peer);
+      ssize_t nread = 0;
+      if (common::net::recvfrom(pair.to(), buffer, sizeof(buffer), reinterpret_cast<struct sockaddr*>(&peer), &peer_len,
+                                &nread)) {
+        state.SkipWithError("recvfrom failed");
+        return;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_UdpSingle)->Arg(64)->Arg(1200);
+
+static void BM_UdpBatched(benchmark::State& state) {
+  LoopbackPair pair;
+  const std::string payload(state.range(0), 'p');
+  common::net::DatagramBatch out(kBurst, payload.size());
+  common::net::DatagramBatch in(kBurst, 2048);
+  for (auto _ : state) {
+    out.Clear();
+    for (size_t i = 0; i < kBurst; ++i) {
+      out.Push(payload.data(), payload.size(), pair.addr(), pair.addr_len());
+    }
+    size_t sent = 0;
+    if (common::net::sendmmsg(pair.from(), &out, &sent) || sent != kBurst) {
+      state.SkipWithError("sendmmsg failed");
+      return;
+    }
+    for (size_t received = 0; received < kBurst;) {
+      size_t count = 0;
+      if (common::net::recvmmsg(pair.to(), &in, &count)) {
+        state.SkipWithError("recvmmsg failed");
+        return;
+      }
+      received += count;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_UdpBatched)->Arg(64)->Arg(1200);
+
+// The whole burst as one GSO super-datagram, received one datagram per slot.
+static void BM_UdpSegmentOffload(benchmark::State& state) {
+  LoopbackPair pair;
+  const size_t segment = state.range(0);
+  const std::string payload(segment * kBurst, 'p');
+  common::net::DatagramBatch out(1, payload.size());
+  common::net::DatagramBatch in(kBurst, 2048);
+  for (auto _ : state) {
+    out.Clear();
+    out.Push(payload.data(), payload.size(), pair.addr(), pair.addr_len(), segment);
+    size_t sent = 0;
+    if (common::net::sendmmsg(pair.from(), &out, &sent)) {
+      state.SkipWithError("UDP GSO unsupported");
+      return;
+    }
+    for (size_t received = 0; received < kBurst;) {
+      size_t count = 0;
+      if (common::net::recvmmsg(pair.to(), &in, &count)) {
+        state.SkipWithError("recvmmsg failed");
+        return;
+      }
+      received += count;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_UdpSegmentOffload)->Arg(64)->Arg(1200);
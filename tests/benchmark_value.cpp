@@ -0,0 +1,121 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+        * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+        * Neither the name of FastoGT. nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <utility>
+
+#include <common/convert2string.h>
+#include <common/value.h>
+
+namespace {
+const size_t kPayloadSize = 1024 * 1024;
+const size_t kItemsCount = 64;
+
+common::Value::string_t MakePayloadString() {
+  common::Value::string_t result;
+  result.resize(kPayloadSize, 'a');
+  return result;
+}
+
+common::byte_array_t MakePayloadBytes() {
+  common::byte_array_t result;
+  result.resize(kPayloadSize, 0x7f);
+  return result;
+}
+}  // namespace
+
+static void BM_ValueBuildCopy(benchmark::State& state) {
+  for (auto _ : state) {
+    std::unique_ptr<common::HashValue> hash(common::Value::CreateHashValue());
+    for (size_t i = 0; i < kItemsCount; ++i) {
+      const common::Value::string_t key = common::ConvertToCharBytes(i);
+      const common::Value::string_t str = MakePayloadString();
+      const common::byte_array_t bytes = MakePayloadBytes();
+      common::ArrayValue* arr = common::Value::CreateArrayValue();
+      arr->Append(common::Value::CreateStringValue(str));
+      arr->Append(common::Value::CreateByteArrayValue(bytes));
+      hash->Insert(key, arr);
+    }
+    benchmark::DoNotOptimize(hash.get());
+  }
+  state.SetBytesProcessed(state.iterations() * kItemsCount * kPayloadSize * 2);
+}
+BENCHMARK(BM_ValueBuildCopy);
+
+static void BM_ValueBuildMove(benchmark::State& state) {
+  for (auto _ : state) {
+    std::unique_ptr<common::HashValue> hash(common::Value::CreateHashValue());
+    hash->Reserve(kItemsCount);
+    for (size_t i = 0; i < kItemsCount; ++i) {
+      common::Value::string_t key = common::ConvertToCharBytes(i);
+      common::Value::string_t str = MakePayloadString();
+      common::byte_array_t bytes = MakePayloadBytes();
+      common::ArrayValue* arr = common::Value::CreateArrayValue();
+      arr->Reserve(2);
+      arr->Append(common::Value::CreateStringValue(std::move(str)));
+      arr->Append(common::Value::CreateByteArrayValue(std::move(bytes)));
+      hash->Insert(std::move(key), arr);
+    }
+    benchmark::DoNotOptimize(hash.get());
+  }
+  state.SetBytesProcessed(state.iterations() * kItemsCount * kPayloadSize * 2);
+}
+BENCHMARK(BM_ValueBuildMove);
+
+static void BM_ValueReadCopy(benchmark::State& state) {
+  std::unique_ptr<common::StringValue> str(common::Value::CreateStringValue(MakePayloadString()));
+  std::unique_ptr<common::ByteArrayValue> bytes(common::Value::CreateByteArrayValue(MakePayloadBytes()));
+  for (auto _ : state) {
+    common::Value::string_t str_out;
+    common::byte_array_t bytes_out;
+    bool res = str->GetAsString(&str_out) && bytes->GetAsByteArray(&bytes_out);
+    benchmark::DoNotOptimize(res);
+    benchmark::DoNotOptimize(str_out.data());
+    benchmark::DoNotOptimize(bytes_out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kPayloadSize * 2);
+}
+BENCHMARK(BM_ValueReadCopy);
+
+static void BM_ValueReadView(benchmark::State& state) {
+  std::unique_ptr<common::StringValue> str(common::Value::CreateStringValue(MakePayloadString()));
+  std::unique_ptr<common::ByteArrayValue> bytes(common::Value::CreateByteArrayValue(MakePayloadBytes()));
+  for (auto _ : state) {
+    common::StringPiece str_out;
+    common::span<const common::byte_t> bytes_out;
+    bool res = str->GetAsStringPiece(&str_out) && bytes->GetAsByteSpan(&bytes_out);
+    benchmark::DoNotOptimize(res);
+    benchmark::DoNotOptimize(str_out.data());
+    benchmark::DoNotOptimize(bytes_out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kPayloadSize * 2);
+}
+BENCHMARK(BM_ValueReadView);
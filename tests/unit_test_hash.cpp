@@ -29,10 +29,22 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <bitset>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include <common/convert2string.h>
+#include <common/hash/crc.h>
+#include <common/hash/fast_hash.h>
 #include <common/hash/md5.h>
 #include <common/hash/sha1.h>
 #include <common/hash/sha256.h>
+#include <common/net/ip_address.h>
+#include <common/net/types.h>
+#include <common/uri/gurl.h>
+#include <common/utils.h>
 
 TEST(hash, md5) {
   common::hash::MD5_CTX ctx;
@@ -80,3 +92,289 @@ TEST(hash, sha256) {
   ASSERT_TRUE(is_ok);
   ASSERT_EQ(hexed, "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08");
 }
+
+namespace {
+std::string Sha1Hex(const unsigned char* data, size_t len, size_t step) {
+  common::hash::SHA1_CTX ctx;
+  common::hash::SHA1_Init(&ctx);
+  for (size_t pos = 0; pos < len; pos += step) {
+    common::hash::SHA1_Update(&ctx, data + pos, std::min(step, len - pos));
+  }
+  unsigned char result[SHA1_HASH_LENGTH];
+  common::hash::SHA1_Final(&ctx, result);
+  std::string hexed;
+  common::utils::hex::encode(MAKE_CHAR_BUFFER_SIZE(result, SHA1_HASH_LENGTH), true, &hexed);
+  return hexed;
+}
+
+std::string Sha256Hex(const unsigned char* data, size_t len, size_t step) {
+  common::hash::SHA256_CTX ctx;
+  common::hash::SHA256_Init(&ctx);
+  for (size_t pos = 0; pos < len; pos += step) {
+    common::hash::SHA256_Update(&ctx, data + pos, std::min(step, len - pos));
+  }
+  unsigned char result[SHA256_HASH_LENGHT];
+  common::hash::SHA256_Final(&ctx, result);
+  std::string hexed;
+  common::utils::hex::encode(MAKE_CHAR_BUFFER_SIZE(result, SHA256_HASH_LENGHT), true, &hexed);
+  return hexed;
+}
+}  // namespace
+
+TEST(hash, sha_vectors) {
+  const std::string abc = "abc";
+  const std::string two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  const std::string million(1000000, 'a');
+  const unsigned char* empty = reinterpret_cast<const unsigned char*>("");
+
+  ASSERT_EQ(Sha1Hex(empty, 0, 1), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+  ASSERT_EQ(Sha1Hex(reinterpret_cast<const unsigned char*>(abc.data()), abc.size(), 1),
+            "a9993e364706816aba3e25717850c26c9cd0d89d");
+  ASSERT_EQ(Sha1Hex(reinterpret_cast<const unsigned char*>(two_blocks.data()), two_blocks.size(), 5),
+            "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+  ASSERT_EQ(Sha1Hex(reinterpret_cast<const unsigned char*>(million.data()), million.size(), 4099),
+            "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+  ASSERT_EQ(Sha256Hex(empty, 0, 1), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  ASSERT_EQ(Sha256Hex(reinterpret_cast<const unsigned char*>(abc.data()), abc.size(), 1),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  ASSERT_EQ(Sha256Hex(reinterpret_cast<const unsigned char*>(two_blocks.data()), two_blocks.size(), 5),
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  ASSERT_EQ(Sha256Hex(reinterpret_cast<const unsigned char*>(million.data()), million.size(), 4099),
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(hash, sha_multi) {
+  std::vector<unsigned char> data(1500);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i * 7 + 3);
+  }
+
+  // lengths around the padding boundaries, more messages than lanes
+  std::vector<const unsigned char*> messages;
+  std::vector<size_t> lens;
+  for (size_t len : {0, 1, 24, 55, 56, 63, 64, 65, 119, 120, 128, 200, 1000, 1500, 3, 60, 64, 64, 64}) {
+    messages.push_back(data.data() + (len % 5));
+    lens.push_back(std::min(len, data.size() - len % 5));
+  }
+
+  std::vector<unsigned char> sha1(messages.size() * SHA1_HASH_LENGTH);
+  common::hash::SHA1_Multi(messages.data(), lens.data(), messages.size(), sha1.data());
+  std::vector<unsigned char> sha256(messages.size() * SHA256_HASH_LENGHT);
+  common::hash::SHA256_Multi(messages.data(), lens.data(), messages.size(), sha256.data());
+
+  for (size_t i = 0; i < messages.size(); ++i) {
+    std::string hexed;
+    common::utils::hex::encode(MAKE_CHAR_BUFFER_SIZE(&sha1[i * SHA1_HASH_LENGTH], SHA1_HASH_LENGTH), true, &hexed);
+    ASSERT_EQ(hexed, Sha1Hex(messages[i], lens[i], 64)) << i;
+    common::utils::hex::encode(MAKE_CHAR_BUFFER_SIZE(&sha256[i * SHA256_HASH_LENGHT], SHA256_HASH_LENGHT), true,
+                               &hexed);
+    ASSERT_EQ(hexed, Sha256Hex(messages[i], lens[i], 64)) << i;
+  }
+}
+
+namespace {
+uint64_t Crc64Bitwise(uint64_t crc, const unsigned char* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int j = 0; j < 8; ++j) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x95ac9329ac4bc9b5ULL : crc >> 1;
+    }
+  }
+  return crc;
+}
+
+uint32_t Crc32cBitwise(uint32_t crc, const unsigned char* data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int j = 0; j < 8; ++j) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+}  // namespace
+
+TEST(hash, crc) {
+  const common::buffer_t check = MAKE_BUFFER("123456789");
+  ASSERT_EQ(common::hash::crc64(0, check.data(), check.size()), 0xe9c6d914c4b8d9caULL);
+  ASSERT_EQ(common::utils::hash::crc64(0, check), 0xe9c6d914c4b8d9caULL);
+  ASSERT_EQ(common::hash::crc32c(0, check.data(), check.size()), 0xe3069283u);
+  ASSERT_EQ(common::hash::crc32c_portable(0, check.data(), check.size()), 0xe3069283u);
+  ASSERT_EQ(common::hash::crc64(0, nullptr, 0), 0u);
+
+  std::vector<unsigned char> data(5000);
+  uint32_t seed = 7;
+  for (size_t i = 0; i < data.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<unsigned char>(seed >> 16);
+  }
+
+  // unaligned starts, short inputs and every folding tail length
+  for (size_t offset = 0; offset < 9; ++offset) {
+    for (size_t len = 0; len + offset <= data.size(); len += (len < 300 ? 1 : 97)) {
+      const unsigned char* ptr = data.data() + offset;
+      const uint64_t crc64 = Crc64Bitwise(0x1234, ptr, len);
+      ASSERT_EQ(common::hash::crc64(0x1234, ptr, len), crc64) << offset << " " << len;
+      ASSERT_EQ(common::hash::crc64_portable(0x1234, ptr, len), crc64) << offset << " " << len;
+      const uint32_t crc32c = Crc32cBitwise(0x5678, ptr, len);
+      ASSERT_EQ(common::hash::crc32c(0x5678, ptr, len), crc32c) << offset << " " << len;
+      ASSERT_EQ(common::hash::crc32c_portable(0x5678, ptr, len), crc32c) << offset << " " << len;
+    }
+  }
+
+  const uint64_t whole64 = common::hash::crc64(0, data.data(), data.size());
+  const uint32_t whole32 = common::hash::crc32c(0, data.data(), data.size());
+  for (size_t split : {size_t(0), size_t(1), size_t(100), size_t(2048), data.size()}) {
+    const size_t len2 = data.size() - split;
+    const uint64_t a64 = common::hash::crc64(0, data.data(), split);
+    const uint64_t b64 = common::hash::crc64(0, data.data() + split, len2);
+    ASSERT_EQ(common::hash::crc64_combine(a64, b64, len2), whole64);
+    ASSERT_EQ(common::hash::crc64(a64, data.data() + split, len2), whole64);
+    const uint32_t a32 = common::hash::crc32c(0, data.data(), split);
+    const uint32_t b32 = common::hash::crc32c(0, data.data() + split, len2);
+    ASSERT_EQ(common::hash::crc32c_combine(a32, b32, len2), whole32);
+  }
+}
+
+TEST(hash, fast_hash_vectors) {
+  struct {
+    size_t len;
+    uint64_t seed;
+    uint64_t hash64;
+    uint64_t low;
+    uint64_t high;
+  } vectors[] = {
+      // XXH3_64bits_withSeed / XXH3_128bits_withSeed of data[i] = i * 31 + 7
+      {0, UINT64_C(0), UINT64_C(0x2d06800538d394c2), UINT64_C(0x6001c324468d497f), UINT64_C(0x99aa06d3014798d8)},
+      {3, UINT64_C(0), UINT64_C(0x15f7093b173d005c), UINT64_C(0x15f7093b173d005c), UINT64_C(0x46f66cb935381565)},
+      {8, UINT64_C(0), UINT64_C(0xdec6a9a43575982e), UINT64_C(0x56bb836ceb6d4baa), UINT64_C(0x803c675a846cc6c2)},
+      {16, UINT64_C(0), UINT64_C(0x7e484c18d74895d0), UINT64_C(0xf853dd94614dfa07), UINT64_C(0x650fe308c566747d)},
+      {100, UINT64_C(0), UINT64_C(0x8c97158042fbf926), UINT64_C(0xd61d8dbff22d515f), UINT64_C(0x7f5a1f03462e52b4)},
+      {200, UINT64_C(0), UINT64_C(0x12fdb864685f344d), UINT64_C(0x60ea018811f9a437), UINT64_C(0x8d8629a1aef9ef90)},
+      {1024, UINT64_C(0), UINT64_C(0x23bc880ebf0d29c6), UINT64_C(0x23bc880ebf0d29c6), UINT64_C(0x4c17271c906df792)},
+      {2048, UINT64_C(0), UINT64_C(0x19f6f9c987331373), UINT64_C(0x19f6f9c987331373), UINT64_C(0xb318976b177a38c7)},
+      {0, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x602b0e2cd6662c8b), UINT64_C(0x4ca5176998171787),
+       UINT64_C(0xd142977a2cca554b)},
+      {3, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x079dd5d54d89480a), UINT64_C(0x079dd5d54d89480a),
+       UINT64_C(0xbf6c84df5f76651d)},
+      {8, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x19ef7d3919108aff), UINT64_C(0x3edb070ecf3a9343),
+       UINT64_C(0xc3612dc11470e721)},
+      {16, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0xa106510078b0a252), UINT64_C(0x4e683254a04c377f),
+       UINT64_C(0xbe0f27bac4d1f58f)},
+      {100, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0xa0f79a4ca977f3f1), UINT64_C(0x48c946439d60cd25),
+       UINT64_C(0xc5ef64958e922287)},
+      {200, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x49dff623641b01b4), UINT64_C(0x2bd1eb5d960e73f4),
+       UINT64_C(0x8511e8a53f70bfbf)},
+      {1024, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x7e249adc60e1f9b4), UINT64_C(0x7e249adc60e1f9b4),
+       UINT64_C(0x927c8d2b50d33f53)},
+      {2048, UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x060600a6317839f9), UINT64_C(0x060600a6317839f9),
+       UINT64_C(0x51a684c4afa32172)},
+  };
+
+  std::vector<unsigned char> data(2048);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i * 31 + 7);
+  }
+
+  for (const auto& vec : vectors) {
+    ASSERT_EQ(common::hash::FastHash64(data.data(), vec.len, vec.seed), vec.hash64) << vec.len;
+    const common::hash::Hash128 h128 = common::hash::FastHash128(data.data(), vec.len, vec.seed);
+    ASSERT_EQ(h128.low, vec.low) << vec.len;
+    ASSERT_EQ(h128.high, vec.high) << vec.len;
+  }
+}
+
+TEST(hash, fast_hash_streaming) {
+  std::vector<unsigned char> data(3000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i * 7 + (i >> 8));
+  }
+
+  // every internal buffer state: empty, partial, exactly full and over a block boundary
+  for (size_t len : {size_t(0), size_t(1), size_t(17), size_t(240), size_t(241), size_t(256), size_t(257),
+                     size_t(1024), size_t(1025), size_t(2999)}) {
+    for (size_t step : {size_t(1), size_t(13), size_t(64), size_t(300), len + 1}) {
+      common::hash::FastHasher hasher(len);
+      for (size_t pos = 0; pos < len; pos += step) {
+        hasher.Update(data.data() + pos, std::min(step, len - pos));
+      }
+      ASSERT_EQ(hasher.Digest64(), common::hash::FastHash64(data.data(), len, len)) << len << " " << step;
+      ASSERT_EQ(hasher.Digest128(), common::hash::FastHash128(data.data(), len, len)) << len << " " << step;
+    }
+  }
+
+  common::hash::FastHasher hasher;
+  hasher.Update(data.data(), data.size());
+  hasher.Reset();
+  hasher.Update(data.data(), 10);
+  ASSERT_EQ(hasher.Digest64(), common::hash::FastHash64(data.data(), 10));
+}
+
+TEST(hash, fast_hash_quality) {
+  // avalanche: flipping any input bit flips about half of the output bits
+  for (size_t len : {size_t(4), size_t(12), size_t(64), size_t(200), size_t(1000)}) {
+    std::vector<unsigned char> key(len, 0x5a);
+    const uint64_t base = common::hash::FastHash64(key.data(), key.size());
+    size_t flips_total = 0;
+    for (size_t bit = 0; bit < len * 8; ++bit) {
+      key[bit / 8] ^= static_cast<unsigned char>(1 << (bit % 8));
+      const size_t flips = std::bitset<64>(base ^ common::hash::FastHash64(key.data(), key.size())).count();
+      key[bit / 8] ^= static_cast<unsigned char>(1 << (bit % 8));
+      ASSERT_GE(flips, 12u) << len << " " << bit;
+      ASSERT_LE(flips, 52u) << len << " " << bit;
+      flips_total += flips;
+    }
+    const double mean = static_cast<double>(flips_total) / (len * 8);
+    ASSERT_GT(mean, 30.0) << len;
+    ASSERT_LT(mean, 34.0) << len;
+  }
+
+  // sequential integer keys: no collisions and even spread over power of two buckets
+  const size_t keys_count = 1 << 17;
+  const size_t buckets_count = 1 << 10;
+  std::unordered_set<uint64_t> seen;
+  std::vector<size_t> buckets(buckets_count, 0);
+  for (uint64_t key = 0; key < keys_count; ++key) {
+    const uint64_t hash = common::hash::FastHash64(&key, sizeof(key));
+    ASSERT_TRUE(seen.insert(hash).second) << key;
+    buckets[hash & (buckets_count - 1)]++;
+  }
+  const size_t expected = keys_count / buckets_count;
+  for (size_t count : buckets) {
+    ASSERT_GT(count, expected / 2);
+    ASSERT_LT(count, expected * 3 / 2);
+  }
+}
+
+TEST(hash, std_hash_specializations) {
+  const common::char_buffer_t buff = MAKE_CHAR_BUFFER("payload");
+  ASSERT_EQ(std::hash<common::char_buffer_t>()(buff), common::hash::FastHash64(buff.data(), buff.size()));
+  const common::StringPiece piece("payload");
+  ASSERT_EQ(std::hash<common::StringPiece>()(piece), std::hash<common::char_buffer_t>()(buff));
+
+  std::unordered_set<common::StringPiece> pieces = {"alpha", "beta", "gamma"};
+  ASSERT_EQ(pieces.count("beta"), 1u);
+  ASSERT_EQ(pieces.count("delta"), 0u);
+
+  std::unordered_set<common::net::IPAddress> addresses;
+  addresses.insert(common::net::IPAddress(127, 0, 0, 1));
+  addresses.insert(common::net::IPAddress::IPv6Localhost());
+  ASSERT_EQ(addresses.count(common::net::IPAddress(127, 0, 0, 1)), 1u);
+  ASSERT_EQ(addresses.count(common::net::IPAddress(127, 0, 0, 2)), 0u);
+
+  std::unordered_set<common::net::HostAndPort> hosts;
+  hosts.insert(common::net::HostAndPort("localhost", 80));
+  hosts.insert(common::net::HostAndPort("localhost", 81));
+  ASSERT_EQ(hosts.size(), 2u);
+  ASSERT_EQ(hosts.count(common::net::HostAndPort("localhost", 80)), 1u);
+  ASSERT_NE(std::hash<common::net::HostAndPort>()(common::net::HostAndPort("localhost", 80)),
+            std::hash<common::net::HostAndPort>()(common::net::HostAndPort("localhost", 81)));
+
+  std::unordered_set<common::uri::GURL> urls;
+  urls.insert(common::uri::GURL("http://example.com/a"));
+  urls.insert(common::uri::GURL("http://example.com/b"));
+  ASSERT_EQ(urls.count(common::uri::GURL("http://example.com/a")), 1u);
+  ASSERT_EQ(urls.count(common::uri::GURL("http://example.com/c")), 0u);
+}
@@ -30,8 +30,20 @@
 #include <gtest/gtest.h>
 
 #include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
 
+#include <clocale>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <common/daemon/commands/license_info.h>
+#include <common/daemon/commands/ping_info.h>
+#include <common/daemon/commands/stop_info.h>
 #include <common/protocols/json_rpc/json_rpc.h>
+#include <common/serializer/json_fields.h>
+#include <common/serializer/json_reader.h>
+#include <common/serializer/json_writer.h>
 
 #define METHOD "test"
 
@@ -168,3 +180,242 @@ TEST(json_rpc_response, parse_error) {
   ASSERT_EQ(PARSE_ERROR_CODE, jerr->code);
   ASSERT_FALSE(result.message);
 }
+
+TEST(json_rpc, params_result_text) {
+  using namespace common::protocols::json_rpc;
+  const char* values[] = {"{\"a\":1, \"b\":[2,3]}", "[1, \"x\",{}]", "-1.5e3"};
+  for (const char* value : values) {
+    const std::string request_str = "{\"jsonrpc\": \"" JSONRPC_VERSION "\", \"method\": \"" METHOD
+                                    "\", \"params\": " +
+                                    std::string(value) + ", \"id\": " STRINGIZE(RPC_ID) "}";
+    JsonRPCRequest req;
+    common::Error err = ParseJsonRPCRequest(request_str, &req);
+    ASSERT_FALSE(err) << value;
+    ASSERT_EQ(req.params, value);
+
+    // a json-c DOM keeps giving json-c's text
+    json_object* jreq = json_tokener_parse(request_str.c_str());
+    ASSERT_TRUE(jreq);
+    json_object* jparams = nullptr;
+    ASSERT_TRUE(json_object_object_get_ex(jreq, "params", &jparams));
+    JsonRPCRequest dom_req;
+    err = ParseJsonRPCRequest(jreq, &dom_req);
+    ASSERT_FALSE(err) << value;
+    ASSERT_EQ(dom_req.params, std::string(json_object_get_string(jparams)));
+    json_object_put(jreq);
+
+    JsonRPCResponse resp;
+    err = ParseJsonRPCResponse(
+        "{\"jsonrpc\": \"" JSONRPC_VERSION "\", \"result\": " + std::string(value) + ", \"id\": " STRINGIZE(RPC_ID) "}",
+        &resp);
+    ASSERT_FALSE(err) << value;
+    ASSERT_TRUE(resp.IsMessage());
+    ASSERT_EQ(resp.message->result, value);
+  }
+}
+
+namespace {
+enum Quality { LOW_QUALITY = 0, HIGH_QUALITY = 1 };
+
+class StreamInfo : public common::serializer::JsonFieldsSerializer<StreamInfo> {
+ public:
+  StreamInfo() : id(), bitrate(0), quality(LOW_QUALITY), enabled(false), volume() {}
+
+  static constexpr auto json_fields() {
+    using namespace common::serializer;
+    return std::make_tuple(MakeJsonField("id", &StreamInfo::id, JSON_FIELD_REQUIRED),
+                           MakeJsonField("bitrate", &StreamInfo::bitrate, JSON_FIELD_REQUIRED),
+                           MakeJsonField("quality", &StreamInfo::quality), MakeJsonField("enabled", &StreamInfo::enabled),
+                           MakeJsonField("volume", &StreamInfo::volume));
+  }
+
+  std::string id;
+  uint64_t bitrate;
+  Quality quality;
+  bool enabled;
+  common::Optional<double> volume;
+};
+}  // namespace
+
+TEST(json, fields) {
+  StreamInfo info;
+  info.id = "main";
+  info.bitrate = 4000000;
+  info.quality = HIGH_QUALITY;
+  info.enabled = true;
+  std::string info_str;
+  ASSERT_FALSE(info.SerializeToString(&info_str));
+  ASSERT_EQ(info_str, "{\"id\":\"main\",\"bitrate\":4000000,\"quality\":1,\"enabled\":true,\"volume\":null}");
+
+  StreamInfo info2;
+  ASSERT_FALSE(info2.DeSerializeFromString("{\"unknown\":[1,{}],\"enabled\":true,\"i\\u0064\":\"main\",\"quality\":1,"
+                                           "\"bitrate\":4000000,\"volume\":0.5}"));
+  ASSERT_EQ(info2.id, info.id);
+  ASSERT_EQ(info2.bitrate, info.bitrate);
+  ASSERT_EQ(info2.quality, info.quality);
+  ASSERT_EQ(info2.enabled, info.enabled);
+  ASSERT_EQ(*info2.volume, 0.5);
+
+  json_object* jinfo = nullptr;
+  ASSERT_FALSE(info.Serialize(&jinfo));
+  StreamInfo info3;
+  ASSERT_FALSE(info3.DeSerialize(jinfo));
+  json_object_put(jinfo);
+  ASSERT_EQ(info3.id, info.id);
+  ASSERT_EQ(info3.bitrate, info.bitrate);
+  ASSERT_FALSE(info3.volume);
+
+  common::Error err = info2.DeSerializeFromString("{\"enabled\":1,\"volume\":\"loud\"}");
+  ASSERT_TRUE(err);
+  ASSERT_EQ(err->GetDescription(),
+            "Invalid type field: enabled, Invalid type field: volume, Not exists field: id, Not exists field: bitrate");
+  ASSERT_EQ(info2.id, info.id);
+
+  common::daemon::commands::LicenseInfo license;
+  ASSERT_TRUE(license.SerializeToString(&info_str));
+  ASSERT_TRUE(license.DeSerializeFromString("{}"));
+  ASSERT_TRUE(license.DeSerializeFromString("{\"license_key\":null}"));
+  ASSERT_TRUE(license.DeSerializeFromString("{\"license_key\":\"short\"}"));
+  const std::string key(common::license::expire_key_t::license_size, 'a');
+  ASSERT_FALSE(license.DeSerializeFromString("{\"license_key\":\"" + key + "\"}"));
+  ASSERT_TRUE(license.IsValid());
+  ASSERT_FALSE(license.SerializeToString(&info_str));
+  ASSERT_EQ(info_str, "{\"license_key\":\"" + key + "\"}");
+}
+
+TEST(json, writer_reader) {
+  using namespace common::serializer;
+  const std::string text("quote\" slash\\ tab\t ctrl\x01 utf8 \xD0\x9F");
+  std::string out;
+  JsonWriter writer(&out);
+  writer.StartObject();
+  writer.Key("text");
+  writer.String(text);
+  writer.Key("min");
+  writer.Int64(std::numeric_limits<int64_t>::min());
+  writer.Key("max");
+  writer.UInt64(std::numeric_limits<uint64_t>::max());
+  writer.Key("double");
+  writer.Double(1.5);
+  writer.Key("integral_double");
+  writer.Double(2);
+  writer.Key("list");
+  writer.StartArray();
+  writer.Bool(true);
+  writer.Null();
+  writer.StartObject();
+  writer.EndObject();
+  writer.EndArray();
+  writer.EndObject();
+  ASSERT_TRUE(writer.IsComplete());
+  ASSERT_EQ(out.find('\x01'), std::string::npos);
+
+  JsonValue root;
+  ASSERT_FALSE(ParseJson(out, &root));
+  ASSERT_EQ(root.GetType(), JSON_TYPE_OBJECT);
+  std::string str;
+  ASSERT_FALSE(root.GetStringField("text", &str));
+  ASSERT_EQ(str, text);
+  int64_t min;
+  ASSERT_FALSE(root.GetInt64Field("min", &min));
+  ASSERT_EQ(min, std::numeric_limits<int64_t>::min());
+  uint64_t max;
+  ASSERT_FALSE(root.GetUInt64Field("max", &max));
+  ASSERT_EQ(max, std::numeric_limits<uint64_t>::max());
+  ASSERT_TRUE(root.GetInt64Field("max", &min));
+  double dbl;
+  ASSERT_FALSE(root.GetDoubleField("double", &dbl));
+  ASSERT_EQ(dbl, 1.5);
+  JsonValue integral;
+  ASSERT_FALSE(root.GetField("integral_double", &integral));
+  ASSERT_EQ(integral.GetType(), JSON_TYPE_DOUBLE);
+  std::vector<JsonValue> list;
+  ASSERT_FALSE(root.GetArrayField("list", &list));
+  ASSERT_EQ(list.size(), 3u);
+  bool flag = false;
+  ASSERT_FALSE(list[0].GetBool(&flag));
+  ASSERT_TRUE(flag);
+  ASSERT_TRUE(list[1].IsNull());
+  ASSERT_EQ(list[2].GetRaw(), "{}");
+  ASSERT_TRUE(root.GetStringField("min", &str));
+  ASSERT_TRUE(root.GetStringField("not_exists", &str));
+
+  JsonValue escaped;
+  ASSERT_FALSE(ParseJson("{\"a\\u0062\" : \"\\ud83d\\ude00\\/\" }", &escaped));
+  ASSERT_FALSE(escaped.GetStringField("ab", &str));
+  ASSERT_EQ(str, "\xF0\x9F\x98\x80/");
+
+  const char* invalid[] = {"",        "{",         "{\"a\":}",    "[1,]",  "{\"a\" 1}", "01",
+                           "1.",      "-",         "\"\\x\"",     "tru",   "[1] 2",     "{\"a\":1,}",
+                           "\"\x01\"", "\"\\u12\"", "{1:2}",      "nul"};
+  for (const char* json : invalid) {
+    JsonValue value;
+    ASSERT_TRUE(ParseJson(json, &value)) << json;
+  }
+
+  std::string deep(max_json_depth + 1, '[');
+  deep += std::string(max_json_depth + 1, ']');
+  JsonValue value;
+  ASSERT_TRUE(ParseJson(deep, &value));
+  ASSERT_FALSE(ParseJson(deep.substr(1, deep.size() - 2), &value));
+}
+
+TEST(json, writer_double) {
+  using namespace common::serializer;
+  const double values[] = {1.5, 2, -0.25, 1e300, 0.1};
+  const char* expected = "[1.5,2.0,-0.25,1e+300,0.1]";
+  std::string out;
+  JsonWriter writer(&out);
+  writer.StartArray();
+  for (double value : values) {
+    writer.Double(value);
+  }
+  writer.EndArray();
+  ASSERT_EQ(out, expected);
+
+  // the C locale's '.' is used whatever LC_NUMERIC says
+  const std::string saved = setlocale(LC_NUMERIC, nullptr);
+  const char* comma_locales[] = {"de_DE.UTF-8", "ru_RU.UTF-8", "fr_FR.UTF-8"};
+  for (const char* name : comma_locales) {
+    if (!setlocale(LC_NUMERIC, name)) {
+      continue;
+    }
+    std::string localized;
+    JsonWriter localized_writer(&localized);
+    localized_writer.StartArray();
+    for (double value : values) {
+      localized_writer.Double(value);
+    }
+    localized_writer.EndArray();
+    ASSERT_EQ(localized, expected) << name;
+  }
+  setlocale(LC_NUMERIC, saved.c_str());
+}
+
+TEST(json, daemon_commands) {
+  using namespace common::daemon::commands;
+  StopInfo stop(1500);
+  std::string stop_str;
+  ASSERT_FALSE(stop.SerializeToString(&stop_str));
+  ASSERT_EQ(stop_str, "{\"delay\":1500}");
+  StopInfo stop2;
+  ASSERT_FALSE(stop2.DeSerializeFromString(" { \"delay\" : 1500 } "));
+  ASSERT_EQ(stop2.GetDelay(), stop.GetDelay());
+  ASSERT_TRUE(stop2.DeSerializeFromString("{\"delay\":"));
+
+  ServerPingInfo ping;
+  std::string ping_str;
+  ASSERT_FALSE(ping.SerializeToString(&ping_str));
+  ServerPingInfo ping2;
+  ping2.SetTimestamp(0);
+  ASSERT_FALSE(ping2.DeSerializeFromString(ping_str));
+  ASSERT_EQ(ping, ping2);
+
+  json_object* jping = nullptr;
+  ASSERT_FALSE(ping.Serialize(&jping));
+  ServerPingInfo ping3;
+  ping3.SetTimestamp(0);
+  ASSERT_FALSE(ping3.DeSerialize(jping));
+  json_object_put(jping);
+  ASSERT_EQ(ping, ping3);
+}
@@ -29,16 +29,49 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+
+#if defined(OS_POSIX)
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include <common/libev/event_loop.h>
 #include <common/libev/http/http_client.h>
 #include <common/uri/gurl.h>
 
+#include <common/libev/io_loop_balancer.h>
 #include <common/libev/io_loop_observer.h>
+#include <common/libev/tcp/file_transfer.h>
 #include <common/libev/tcp/tcp_client.h>
+#include <common/libev/tcp/tcp_connection_pool.h>
 #include <common/libev/tcp/tcp_server.h>
+#include <common/libev/timer_wheel.h>
+#if defined(OS_POSIX)
+#include <common/libev/udp/udp_client.h>
+#endif
+#include <common/protocols/json_rpc/json_rpc.h>
+#include <common/protocols/json_rpc/protocol_client.h>
+#include <common/text_decoders/compress_lz4_edcoder.h>
+#include <common/text_decoders/compress_snappy_edcoder.h>
+#include <common/text_decoders/compress_zlib_edcoder.h>
+#include <common/text_decoders/none_edcoder.h>
 
 #include <common/threads/thread_manager.h>
+#include <common/time.h>
 
 #include <common/net/net.h>
+#include <common/net/socket_tcp.h>
 
 namespace {
 const common::net::HostAndPort g_hs("localhost", 8010);
@@ -126,6 +159,1324 @@ TEST(Libev, IoServer) {
   delete serv;
 }
 
+class ResolveHandler : public ServerHandler {
+ public:
+  ResolveHandler() : resolved(false), in_loop_thread(false), err(), addresses() {}
+
+  void PreLooped(common::libev::IoLoop* server) override {
+    server->ResolveHost(g_hs, [this, server](common::ErrnoError lerr, const common::net::IPAddressList& laddresses) {
+      resolved = true;
+      in_loop_thread = server->IsLoopThread();
+      err = lerr;
+      addresses = laddresses;
+    });
+  }
+
+  bool resolved;
+  bool in_loop_thread;
+  common::ErrnoError err;
+  common::net::IPAddressList addresses;
+};
+
+TEST(Libev, ResolveHost) {
+  ResolveHandler hand;
+  common::libev::tcp::TcpServer* serv = new common::libev::tcp::TcpServer(g_hs, false, &hand);
+  common::ErrnoError err = serv->Bind(true);
+  ASSERT_FALSE(err);
+
+  err = serv->Listen(5);
+  ASSERT_FALSE(err);
+
+  auto tp = THREAD_MANAGER()->CreateThread(&ExitServer, serv);
+  bool res_start = tp->Start();
+  ASSERT_TRUE(res_start);
+
+  int res_exec = serv->Exec();
+  ASSERT_TRUE(res_exec == EXIT_SUCCESS);
+  tp->Join();
+  delete serv;
+
+  ASSERT_TRUE(hand.resolved);
+  ASSERT_TRUE(hand.in_loop_thread);
+  ASSERT_FALSE(hand.err);
+  ASSERT_FALSE(hand.addresses.empty());
+  ASSERT_TRUE(hand.addresses[0].IsLoopback());
+}
+
+class ClientLoop : public common::libev::IoLoop {
+ public:
+  explicit ClientLoop(common::libev::IoLoopObserver* observer) : IoLoop(new common::libev::LibEvLoop, observer) {}
+
+  bool IsCanBeRegistered(common::libev::IoClient* client) const override {
+    UNUSED(client);
+    return true;
+  }
+
+  const char* ClassName() const override { return "ClientLoop"; }
+
+ protected:
+  common::libev::IoChild* CreateChild() override { return nullptr; }
+};
+
+class ReadyHandler : public ServerHandler {
+ public:
+  void PreLooped(common::libev::IoLoop* server) override {
+    UNUSED(server);
+    ready.set_value();
+  }
+
+  std::promise<void> ready;
+};
+
+int ExecClientLoop(ClientLoop* loop) {
+  return loop->Exec();
+}
+
+struct ConnectResult {
+  common::ErrnoError err;
+  common::net::socket_info info;
+};
+
+TEST(Libev, ConnectTo) {
+  common::net::ServerSocketTcp serv(common::net::HostAndPort("127.0.0.1", RANDOM_PORT));
+  common::ErrnoError err = serv.Bind(true);
+  ASSERT_FALSE(err);
+  err = serv.Listen(5);
+  ASSERT_FALSE(err);
+  // "localhost" may resolve to ::1 first, the connector has to fall back
+  const common::net::HostAndPort host("localhost", serv.GetHost().GetPort());
+
+  common::net::ServerSocketTcp closed(common::net::HostAndPort("127.0.0.1", RANDOM_PORT));
+  err = closed.Bind(true);
+  ASSERT_FALSE(err);
+  const common::net::HostAndPort refused_host("127.0.0.1", closed.GetHost().GetPort());
+  err = closed.Close();
+  ASSERT_FALSE(err);
+
+  ReadyHandler hand;
+  ClientLoop loop(&hand);
+  auto tp = THREAD_MANAGER()->CreateThread(&ExecClientLoop, &loop);
+  ASSERT_TRUE(tp->Start());
+  hand.ready.get_future().wait();
+
+  std::promise<ConnectResult> connected, refused;
+  loop.ExecInLoopThread([&]() {
+    ignore_result(loop.ConnectTo(host, 5, [&](common::ErrnoError lerr, const common::net::socket_info& info) {
+      connected.set_value({lerr, info});
+    }));
+    ignore_result(loop.ConnectTo(refused_host, 5, [&](common::ErrnoError lerr, const common::net::socket_info& info) {
+      refused.set_value({lerr, info});
+    }));
+  });
+
+  ConnectResult res = connected.get_future().get();
+  ASSERT_FALSE(res.err);
+  ASSERT_NE(res.info.fd(), INVALID_SOCKET_VALUE);
+  ASSERT_EQ(res.info.port(), host.GetPort());
+  err = common::net::close(res.info.fd());
+  ASSERT_FALSE(err);
+
+  res = refused.get_future().get();
+  ASSERT_TRUE(res.err);
+
+  loop.Stop();
+  tp->Join();
+  err = serv.Close();
+  ASSERT_FALSE(err);
+}
+
+TEST(Libev, ConnectionPool) {
+  common::net::ServerSocketTcp serv(common::net::HostAndPort("127.0.0.1", RANDOM_PORT));
+  common::ErrnoError err = serv.Bind(true);
+  ASSERT_FALSE(err);
+  err = serv.Listen(5);
+  ASSERT_FALSE(err);
+  const common::net::HostAndPort host = serv.GetHost();
+
+  ReadyHandler hand;
+  ClientLoop loop(&hand);
+  auto tp = THREAD_MANAGER()->CreateThread(&ExecClientLoop, &loop);
+  ASSERT_TRUE(tp->Start());
+  hand.ready.get_future().wait();
+
+  common::libev::tcp::TcpConnectionPoolOptions options;
+  options.max_per_host = 1;
+  common::libev::tcp::TcpConnectionPool* pool = new common::libev::tcp::TcpConnectionPool(&loop, options);
+
+  std::promise<ConnectResult> first;
+  ConnectResult second;
+  bool second_done = false;
+  loop.ExecInLoopThread([&]() {
+    pool->Acquire(host, [&](common::ErrnoError lerr, const common::net::socket_info& info) {
+      first.set_value({lerr, info});
+    });
+    // over max_per_host, waits for the first connection
+    pool->Acquire(host, [&](common::ErrnoError lerr, const common::net::socket_info& info) {
+      second = {lerr, info};
+      second_done = true;
+    });
+  });
+  const ConnectResult res = first.get_future().get();
+  ASSERT_FALSE(res.err);
+
+  std::promise<void> checked;
+  loop.ExecInLoopThread([&]() {
+    EXPECT_FALSE(second_done);
+    EXPECT_EQ(pool->GetBusyCount(host), 1u);
+    pool->Release(host, res.info, true);
+    EXPECT_TRUE(second_done);
+    EXPECT_FALSE(second.err);
+    EXPECT_EQ(second.info.fd(), res.info.fd());
+
+    pool->Release(host, second.info, true);
+    EXPECT_EQ(pool->GetIdleCount(host), 1u);
+    EXPECT_EQ(pool->GetBusyCount(host), 0u);
+
+    bool reused = false;
+    pool->Acquire(host, [&](common::ErrnoError lerr, const common::net::socket_info& info) {
+      reused = !lerr && info.fd() == res.info.fd();
+      pool->Release(host, info, false);
+    });
+    EXPECT_TRUE(reused);
+    EXPECT_EQ(pool->GetIdleCount(host), 0u);
+    EXPECT_EQ(pool->GetBusyCount(host), 0u);
+    delete pool;
+    checked.set_value();
+  });
+  checked.get_future().wait();
+
+  loop.Stop();
+  tp->Join();
+  err = serv.Close();
+  ASSERT_FALSE(err);
+}
+
+#if defined(OS_POSIX)
+namespace {
+
+struct TransferResult {
+  common::ErrnoError err;
+  size_t sent = 0;
+  size_t total_seen = 0;
+  size_t other_sent_at_finish = 0;
+};
+
+int MakeZeroFile(const std::string& path, size_t size) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd != INVALID_DESCRIPTOR && ftruncate(fd, size) != 0) {
+    ::close(fd);
+    return INVALID_DESCRIPTOR;
+  }
+  return fd;
+}
+
+// Reads both peers in turns, so neither transfer gets an unfair reader.
+void DrainPeers(const std::vector<int>& socks, std::vector<size_t>* received) {
+  std::vector<bool> alive(socks.size(), true);
+  size_t opened = socks.size();
+  char buffer[64 * 1024];
+  while (opened) {
+    std::vector<struct pollfd> fds;
+    for (size_t i = 0; i < socks.size(); ++i) {
+      fds.push_back({alive[i] ? socks[i] : -1, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), 5000) <= 0) {
+      return;
+    }
+    for (size_t i = 0; i < socks.size(); ++i) {
+      if (!alive[i] || !fds[i].revents) {
+        continue;
+      }
+      ssize_t nread = read(socks[i], buffer, sizeof(buffer));
+      if (nread <= 0) {
+        alive[i] = false;
+        opened--;
+        continue;
+      }
+      (*received)[i] += nread;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(Libev, SendFileFairness) {
+  const std::string path = "/tmp/unit_test_libev_send_file.bin";
+  const size_t size = 16 * 1024 * 1024;
+  int fd = MakeZeroFile(path, size);
+  ASSERT_NE(fd, INVALID_DESCRIPTOR);
+
+  int first[2], second[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, first), 0);
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, second), 0);
+  // each transfer gives its socket back in the mode it was started with
+  ASSERT_NE(fcntl(second[0], F_SETFL, fcntl(second[0], F_GETFL) | O_NONBLOCK), -1);
+
+  ReadyHandler hand;
+  ClientLoop loop(&hand);
+  auto tp = THREAD_MANAGER()->CreateThread(&ExecClientLoop, &loop);
+  ASSERT_TRUE(tp->Start());
+  hand.ready.get_future().wait();
+
+  std::vector<size_t> received(2, 0);
+  std::thread reader(&DrainPeers, std::vector<int>{first[1], second[1]}, &received);
+
+  common::libev::tcp::FileTransferOptions options;
+  options.chunk_size = 64 * 1024;
+  std::promise<void> started;
+  std::promise<TransferResult> results[2];
+  common::libev::IoClient* clients[2] = {nullptr, nullptr};
+  size_t sent[2] = {0, 0};
+  bool busy = false;
+  loop.ExecInLoopThread([&]() {
+    const int socks[2] = {first[0], second[0]};
+    for (size_t i = 0; i < 2; ++i) {
+      clients[i] = new common::libev::tcp::TcpClient(&loop, common::net::socket_info(socks[i]));
+      EXPECT_TRUE(loop.RegisterClient(clients[i]));
+      common::ErrnoError err = loop.SendFile(
+          clients[i], fd, 0, size, options, [&sent, i, size](size_t done, size_t total) {
+            EXPECT_EQ(total, size);
+            sent[i] = done;
+          },
+          [&results, &sent, i, sock = socks[i]](common::ErrnoError lerr, size_t done) {
+            results[i].set_value({lerr, done, sent[i], sent[1 - i]});
+            ::shutdown(sock, SHUT_WR);
+          });
+      EXPECT_FALSE(err);
+    }
+    // one transfer per client
+    common::ErrnoError err = loop.SendFile(clients[0], fd, 0, size, options, nullptr, nullptr);
+    busy = err && err->GetErrorCode() == EBUSY;
+    started.set_value();
+  });
+  started.get_future().wait();
+  ASSERT_TRUE(busy);
+
+  TransferResult res[2] = {results[0].get_future().get(), results[1].get_future().get()};
+  reader.join();
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT_FALSE(res[i].err);
+    ASSERT_EQ(res[i].sent, size);
+    ASSERT_EQ(res[i].total_seen, size);
+    ASSERT_EQ(received[i], size);
+    // chunks interleave, the other transfer is well underway by the end
+    ASSERT_GE(res[i].other_sent_at_finish, size / 4);
+  }
+  ASSERT_FALSE(fcntl(first[0], F_GETFL) & O_NONBLOCK);
+  ASSERT_TRUE(fcntl(second[0], F_GETFL) & O_NONBLOCK);
+
+  loop.Stop();
+  tp->Join();
+  ::close(first[1]);
+  ::close(second[1]);
+  ::close(fd);
+  unlink(path.c_str());
+}
+
+TEST(Libev, SendFileRateLimit) {
+  const std::string path = "/tmp/unit_test_libev_send_file_rate.bin";
+  const size_t size = 1024 * 1024;
+  int fd = MakeZeroFile(path, size);
+  ASSERT_NE(fd, INVALID_DESCRIPTOR);
+
+  int socks[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+
+  ReadyHandler hand;
+  ClientLoop loop(&hand);
+  auto tp = THREAD_MANAGER()->CreateThread(&ExecClientLoop, &loop);
+  ASSERT_TRUE(tp->Start());
+  hand.ready.get_future().wait();
+
+  std::vector<size_t> received(1, 0);
+  std::thread reader(&DrainPeers, std::vector<int>{socks[1]}, &received);
+
+  common::libev::tcp::FileTransferOptions options;
+  options.chunk_size = 32 * 1024;
+  options.rate_limit = 2 * 1024 * 1024;
+  options.burst = 64 * 1024;
+  std::promise<TransferResult> result;
+  const common::time64_t start = common::time::current_monotonic_mstime();
+  loop.ExecInLoopThread([&]() {
+    common::libev::IoClient* client = new common::libev::tcp::TcpClient(&loop, common::net::socket_info(socks[0]));
+    EXPECT_TRUE(loop.RegisterClient(client));
+    common::ErrnoError err =
+        loop.SendFile(client, fd, 0, size, options, nullptr, [&](common::ErrnoError lerr, size_t done) {
+          result.set_value({lerr, done, 0, 0});
+          ::shutdown(socks[0], SHUT_WR);
+        });
+    EXPECT_FALSE(err);
+  });
+
+  const TransferResult res = result.get_future().get();
+  const common::time64_t elapsed = common::time::current_monotonic_mstime() - start;
+  reader.join();
+  ASSERT_FALSE(res.err);
+  ASSERT_EQ(res.sent, size);
+  ASSERT_EQ(received[0], size);
+  // everything past the initial burst goes at the limit: ~470 msec
+  ASSERT_GE(elapsed, 400);
+  ASSERT_LT(elapsed, 5000);
+
+  loop.Stop();
+  tp->Join();
+  ::close(socks[1]);
+  ::close(fd);
+  unlink(path.c_str());
+}
+
+class UdpDrainHandler : public ReadyHandler {
+ public:
+  explicit UdpDrainHandler(size_t expected) : expected(expected), events(0), datagrams(0) {}
+
+  void DataReceived(common::libev::IoClient* client) override {
+    common::libev::udp::UdpClient* udp = static_cast<common::libev::udp::UdpClient*>(client);
+    size_t count = 0;
+    common::ErrnoError err = udp->ReadDatagrams(&count);
+    ASSERT_FALSE(err);
+    events++;
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(udp->GetDatagrams().GetSize(i), 100u);
+    }
+    datagrams += count;
+    if (datagrams == expected) {
+      done.set_value();
+    }
+  }
+
+  const size_t expected;
+  size_t events;
+  size_t datagrams;
+  std::promise<void> done;
+};
+
+TEST(Libev, UdpClientBatches) {
+  const size_t count = 256;
+  UdpDrainHandler hand(count);
+  ClientLoop loop(&hand);
+  auto tp = THREAD_MANAGER()->CreateThread(&ExecClientLoop, &loop);
+  ASSERT_TRUE(tp->Start());
+  hand.ready.get_future().wait();
+
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(::bind(sock, reinterpret_cast<struct sockaddr*>(&addr), len), 0);
+  ASSERT_EQ(::getsockname(sock, reinterpret_cast<struct sockaddr*>(&addr), &len), 0);
+
+  // queue everything first, the loop then needs count / batch events
+  int out = socket(AF_INET, SOCK_DGRAM, 0);
+  common::net::DatagramBatch batch(count, 100);
+  const std::string payload(100, 'u');
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(batch.Push(payload.data(), payload.size(), reinterpret_cast<struct sockaddr*>(&addr), len));
+  }
+  size_t sent = 0;
+  common::ErrnoError err = common::net::sendmmsg(out, &batch, &sent);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(sent, count);
+
+  loop.ExecInLoopThread([&]() {
+    common::libev::IoClient* client = new common::libev::udp::UdpClient(&loop, common::net::socket_info(sock), 64, 1500);
+    EXPECT_TRUE(loop.RegisterClient(client));
+  });
+  hand.done.get_future().wait();
+  ASSERT_EQ(hand.datagrams, count);
+  ASSERT_EQ(hand.events, count / 64);
+
+  loop.Stop();
+  tp->Join();
+  ::close(out);
+}
+
+class AcceptHandler : public ServerHandler {
+ public:
+  explicit AcceptHandler(size_t expected) : expected(expected), accepted(0), nonblocking(0), no_delay(0) {}
+
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+
+  void Accepted(common::libev::IoClient* client) override {
+    common::libev::tcp::TcpClient* tcp = static_cast<common::libev::tcp::TcpClient*>(client);
+    const int fd = tcp->GetInfo().fd();
+    if (fcntl(fd, F_GETFL) & O_NONBLOCK) {
+      nonblocking++;
+    }
+    int value = 0;
+    socklen_t len = sizeof(value);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &value, &len) == 0 && value) {
+      no_delay++;
+    }
+    if (++accepted == expected) {
+      client->GetServer()->Stop();
+    }
+  }
+
+  const size_t expected;
+  size_t accepted;
+  size_t nonblocking;
+  size_t no_delay;
+};
+
+TEST(Libev, AcceptBatch) {
+  const size_t count = 20;
+  AcceptHandler hand(count);
+  common::libev::tcp::TcpServer* serv =
+      new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+  common::ErrnoError err = serv->Bind(true);
+  ASSERT_FALSE(err);
+  err = serv->Listen(64);
+  ASSERT_FALSE(err);
+
+  common::libev::tcp::TcpAcceptOptions options;
+  options.batch_size = 8;
+  options.nonblocking = true;
+  options.socket_options.no_delay = true;
+  serv->SetAcceptOptions(options);
+
+  // all of them wait in the backlog, taken 8 per readiness event
+  std::vector<common::net::socket_info> clients(count);
+  for (size_t i = 0; i < count; ++i) {
+    err = common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &clients[i]);
+    ASSERT_FALSE(err);
+  }
+
+  int res_exec = serv->Exec();
+  ASSERT_TRUE(res_exec == EXIT_SUCCESS);
+  delete serv;
+
+  ASSERT_EQ(hand.accepted, count);
+  ASSERT_EQ(hand.nonblocking, count);
+  ASSERT_EQ(hand.no_delay, count);
+  for (size_t i = 0; i < count; ++i) {
+    err = common::net::close(clients[i].fd());
+    ASSERT_FALSE(err);
+  }
+}
+
+class RegistryHandler : public ServerHandler {
+ public:
+  RegistryHandler() : closed(0), moved(0), updates(0), last() {}
+
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+  void Closed(common::libev::IoClient* client) override {
+    UNUSED(client);
+    closed++;
+  }
+  void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override {
+    UNUSED(server);
+    UNUSED(client);
+    moved++;
+  }
+  void StatisticsUpdated(common::libev::IoLoop* server, const common::libev::IoLoopStatistics& stats) override {
+    last = stats;
+    if (++updates == 2) {
+      server->Stop();
+    }
+  }
+
+  size_t closed;
+  size_t moved;
+  size_t updates;
+  common::libev::IoLoopStatistics last;
+};
+
+TEST(Libev, ClientRegistry) {
+  RegistryHandler hand;
+  common::libev::tcp::TcpServer* serv =
+      new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+  common::ErrnoError err = serv->Bind(true);
+  ASSERT_FALSE(err);
+  err = serv->Listen(5);
+  ASSERT_FALSE(err);
+
+  const size_t count = 5;
+  int peers[count];
+  common::libev::IoClient* moved = nullptr;
+  serv->SetStatisticsInterval(50);
+  serv->ExecInLoopThread([&]() {
+    std::vector<common::libev::IoClient*> clients;
+    for (size_t i = 0; i < count; ++i) {
+      int sv[2];
+      ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+      peers[i] = sv[1];
+      common::libev::IoClient* client = new common::libev::tcp::TcpClient(serv, common::net::socket_info(sv[0]));
+      ASSERT_TRUE(serv->RegisterClient(client));
+      clients.push_back(client);
+    }
+    ASSERT_EQ(serv->GetClientsCount(), count);
+    ASSERT_EQ(serv->GetClients(), clients);
+
+    // the visitor may drop the client it is given
+    std::vector<common::libev::IoClient*> visited;
+    serv->ForEachClient([&](common::libev::IoClient* client) {
+      visited.push_back(client);
+      if (client == clients[2]) {
+        ignore_result(client->Close());
+        delete client;
+      }
+    });
+    ASSERT_EQ(visited, clients);
+    serv->UnRegisterClient(clients[0]);
+    moved = clients[0];
+    serv->CloseClient(clients[4]);
+    serv->CloseClient(clients[4]);
+
+    const std::vector<common::libev::IoClient*> left = {clients[1], clients[3]};
+    ASSERT_EQ(serv->GetClients(), left);
+    const common::libev::IoLoopStatistics stats = serv->GetStatistics();
+    ASSERT_EQ(stats.clients, 2);
+    ASSERT_EQ(stats.accepted, count);
+    ASSERT_EQ(stats.closed, 2);
+    ignore_result(clients[4]->Close());
+    delete clients[4];
+  });
+
+  int res_exec = serv->Exec();
+  ASSERT_TRUE(res_exec == EXIT_SUCCESS);
+  delete serv;
+
+  ASSERT_EQ(hand.updates, 2);
+  ASSERT_EQ(hand.last.clients, 2);
+  ASSERT_EQ(hand.last.accepted, count);
+  ASSERT_EQ(hand.last.closed, 2);
+  ASSERT_EQ(hand.last.accepts_per_sec, 0);
+  ASSERT_EQ(hand.moved, 1);
+  ignore_result(moved->Close());
+  delete moved;
+  for (size_t i = 0; i < count; ++i) {
+    ::close(peers[i]);
+  }
+}
+
+class BalanceHandler : public ServerHandler {
+ public:
+  BalanceHandler() : received(0), moved(0) {}
+
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+  void Accepted(common::libev::IoClient* client) override { UNUSED(client); }
+  void Closed(common::libev::IoClient* client) override { UNUSED(client); }
+  void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override {
+    UNUSED(server);
+    UNUSED(client);
+    moved++;
+  }
+  void DataReceived(common::libev::IoClient* client) override {
+    char buf[4096];
+    size_t nread = 0;
+    common::ErrnoError err = client->SingleRead(buf, sizeof(buf), &nread);
+    if (!err) {
+      received += nread;
+    }
+  }
+  void PostLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+
+  std::atomic<size_t> received;
+  std::atomic<size_t> moved;
+};
+
+template <typename T>
+T RunInLoop(common::libev::IoLoop* loop, std::function<T()> func) {
+  std::promise<T> promise;
+  loop->ExecInLoopThread([&promise, func]() { promise.set_value(func()); });
+  return promise.get_future().get();
+}
+
+TEST(Libev, BalanceSkewedLoad) {
+  const size_t loops_count = 4;
+  const size_t clients_count = 16;
+  BalanceHandler hand;
+  std::vector<common::libev::IoLoop*> loops;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < loops_count; ++i) {
+    common::libev::tcp::TcpServer* serv =
+        new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+    ASSERT_FALSE(serv->Bind(true));
+    ASSERT_FALSE(serv->Listen(5));
+    loops.push_back(serv);
+    threads.push_back(std::thread([serv]() { ignore_result(serv->Exec()); }));
+  }
+
+  // every client starts on the first loop
+  std::vector<int> peers(clients_count);
+  common::libev::IoLoop* first = loops[0];
+  ASSERT_TRUE(RunInLoop<bool>(first, [&]() {
+    for (size_t i = 0; i < clients_count; ++i) {
+      int sv[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        return false;
+      }
+      peers[i] = sv[1];
+      if (!first->RegisterClient(new common::libev::tcp::TcpClient(first, common::net::socket_info(sv[0])))) {
+        return false;
+      }
+    }
+    common::ErrnoError err = first->MoveClient(first->GetClients()[0], first);
+    return err && err->GetErrorCode() == EINVAL;
+  }));
+
+  common::libev::IoLoopBalancer balancer(loops);
+  const std::string chunk(1024, 'b');
+  size_t expected = 0;
+  size_t moves = 0;
+  for (size_t round = 0; round < 4; ++round) {
+    for (size_t i = 0; i < clients_count; ++i) {
+      size_t nwrite = 0;
+      ASSERT_FALSE(common::net::write_to_socket(peers[i], chunk.data(), chunk.size(), &nwrite));
+      expected += chunk.size();
+    }
+    while (hand.received < expected) {
+      std::this_thread::yield();
+    }
+    moves += balancer.Rebalance();
+  }
+  ASSERT_EQ(moves, hand.moved);
+  ASSERT_GE(moves, clients_count / 2);
+
+  size_t total = 0;
+  for (size_t i = 0; i < loops_count; ++i) {
+    common::libev::IoLoop* loop = loops[i];
+    const size_t count = RunInLoop<size_t>(loop, [loop]() { return loop->GetClientsCount(); });
+    // an even spread is 4 per loop, the balancer stops within 25% of it
+    ASSERT_GE(count, 3);
+    ASSERT_LE(count, 5);
+    total += count;
+  }
+  ASSERT_EQ(total, clients_count);
+
+  // moved clients keep working on their new loop
+  for (size_t i = 0; i < clients_count; ++i) {
+    size_t nwrite = 0;
+    ASSERT_FALSE(common::net::write_to_socket(peers[i], chunk.data(), chunk.size(), &nwrite));
+    expected += chunk.size();
+  }
+  while (hand.received < expected) {
+    std::this_thread::yield();
+  }
+
+  for (size_t i = 0; i < loops_count; ++i) {
+    loops[i]->Stop();
+    threads[i].join();
+    delete loops[i];
+  }
+  for (size_t i = 0; i < clients_count; ++i) {
+    ::close(peers[i]);
+  }
+}
+
+class EchoHandler : public ServerHandler {
+ public:
+  EchoHandler() : echoed(0), closed(0) {}
+
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+  void Accepted(common::libev::IoClient* client) override { UNUSED(client); }
+  void Closed(common::libev::IoClient* client) override {
+    UNUSED(client);
+    closed++;
+  }
+  void DataReceived(common::libev::IoClient* client) override {
+    char buf[16 * 1024];
+    while (true) {
+      size_t nread = 0;
+      common::ErrnoError err = client->SingleRead(buf, sizeof(buf), &nread);
+      if (err && err->GetErrorCode() == EAGAIN) {
+        return;
+      }
+      if (err || nread == 0) {
+        ignore_result(client->Close());
+        delete client;
+        return;
+      }
+      size_t nwrite = 0;
+      err = client->Write(buf, nread, &nwrite);
+      ASSERT_FALSE(err);
+      echoed += nwrite;
+    }
+  }
+
+  std::atomic<size_t> echoed;
+  std::atomic<size_t> closed;
+};
+
+bool RecvAll(int fd, std::string* out, size_t size) {
+  out->resize(size);
+  size_t total = 0;
+  while (total < size) {
+    ssize_t res = ::recv(fd, &(*out)[total], size - total, 0);
+    if (res <= 0) {
+      return false;
+    }
+    total += res;
+  }
+  return true;
+}
+
+TEST(Libev, UringEcho) {
+  EchoHandler hand;
+  common::libev::tcp::TcpServer* serv =
+      new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+  ASSERT_FALSE(serv->Bind(true));
+  ASSERT_FALSE(serv->Listen(5));
+  common::ErrnoError err = serv->SetBackend(common::libev::IO_BACKEND_URING);
+  if (err) {
+    // not built in, or the kernel/sandbox refuses io_uring
+    std::cout << "io_uring is not available: " << err->GetDescription() << std::endl;
+    delete serv;
+    return;
+  }
+  ASSERT_EQ(serv->GetBackend(), common::libev::IO_BACKEND_URING);
+  common::libev::tcp::TcpAcceptOptions options;
+  options.nonblocking = true;
+  serv->SetAcceptOptions(options);
+
+  common::libev::tcp::TcpServer* target =
+      new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+  ASSERT_FALSE(target->Bind(true));
+  ASSERT_FALSE(target->Listen(5));
+  ASSERT_EQ(target->GetBackend(), common::libev::IO_BACKEND_LIBEV);
+  std::thread serv_thread([serv]() { ignore_result(serv->Exec()); });
+  std::thread target_thread([target]() { ignore_result(target->Exec()); });
+
+  // larger than a provided buffer and a send chunk
+  const size_t count = 3;
+  const size_t size = 512 * 1024;
+  std::vector<common::net::socket_info> clients(count);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_FALSE(common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &clients[i]));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    std::string payload(size, 0);
+    for (size_t j = 0; j < size; ++j) {
+      payload[j] = static_cast<char>('a' + (i + j) % 26);
+    }
+    std::thread writer([&clients, i, &payload]() {
+      size_t nwrite = 0;
+      ASSERT_FALSE(common::net::write_to_socket(clients[i].fd(), payload.data(), payload.size(), &nwrite));
+    });
+    std::string echo;
+    ASSERT_TRUE(RecvAll(clients[i].fd(), &echo, size));
+    writer.join();
+    ASSERT_EQ(echo, payload);
+  }
+  ASSERT_EQ(hand.echoed, count * size);
+
+  // the clients keep their connection on a libev loop; EBUSY until the
+  // loop has seen its last send complete
+  size_t moved = 0;
+  while (moved < count) {
+    moved += RunInLoop<size_t>(serv, [serv, target]() {
+      size_t moved = 0;
+      for (common::libev::IoClient* client : serv->GetClients()) {
+        common::ErrnoError err = serv->MoveClient(client, target);
+        if (!err) {
+          moved++;
+        } else if (err->GetErrorCode() != EBUSY) {
+          ADD_FAILURE() << err->GetDescription();
+        }
+      }
+      return moved;
+    });
+  }
+  ASSERT_EQ(moved, count);
+  while (RunInLoop<size_t>(target, [target]() { return target->GetClientsCount(); }) < count) {
+    std::this_thread::yield();
+  }
+  ASSERT_EQ(RunInLoop<size_t>(serv, [serv]() { return serv->GetClientsCount(); }), 0);
+  for (size_t i = 0; i < count; ++i) {
+    size_t nwrite = 0;
+    ASSERT_FALSE(common::net::write_to_socket(clients[i].fd(), "ping", 4, &nwrite));
+    std::string echo;
+    ASSERT_TRUE(RecvAll(clients[i].fd(), &echo, 4));
+    ASSERT_EQ(echo, "ping");
+  }
+
+  // a client closed right after writing still gets its data out
+  common::net::socket_info last;
+  ASSERT_FALSE(common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &last));
+  const std::string bye(size, 'z');
+  std::thread writer([&last, &bye]() {
+    size_t nwrite = 0;
+    ASSERT_FALSE(common::net::write_to_socket(last.fd(), bye.data(), bye.size(), &nwrite));
+    ::shutdown(last.fd(), SHUT_WR);
+  });
+  std::string echo;
+  ASSERT_TRUE(RecvAll(last.fd(), &echo, size));
+  writer.join();
+  ASSERT_EQ(echo, bye);
+  char tail;
+  ASSERT_EQ(::recv(last.fd(), &tail, 1, 0), 0);
+
+  serv->Stop();
+  target->Stop();
+  serv_thread.join();
+  target_thread.join();
+  delete serv;
+  delete target;
+  for (size_t i = 0; i < count; ++i) {
+    ignore_result(common::net::close(clients[i].fd()));
+  }
+  ignore_result(common::net::close(last.fd()));
+}
+
+typedef common::protocols::json_rpc::ProtocolClient<common::libev::tcp::TcpClient> RpcClient;
+
+class RpcServer : public common::libev::tcp::TcpServer {
+ public:
+  RpcServer(const common::net::HostAndPort& host, common::libev::IoLoopObserver* observer)
+      : TcpServer(host, false, observer) {}
+
+ private:
+  common::libev::IoClient* CreateClient(const common::net::socket_info& info) override {
+    return new RpcClient(std::make_shared<common::NoneEDcoder>(), this, info);
+  }
+};
+
+class RpcEchoHandler : public EchoHandler {
+ public:
+  void DataReceived(common::libev::IoClient* client) override {
+    using namespace common::protocols::json_rpc;
+    RpcClient* rpc = static_cast<RpcClient*>(client);
+    std::string command;
+    common::ErrnoError err = rpc->ReadCommand(&command);
+    if (err) {
+      ignore_result(client->Close());
+      delete client;
+      return;
+    }
+
+    JsonRPCRequest req;
+    ASSERT_FALSE(ParseJsonRPCRequest(command, &req));
+    ASSERT_TRUE(req.params);
+    ASSERT_FALSE(rpc->WriteResponse(JsonRPCResponse::MakeMessage(req.id, JsonRPCMessage::MakeSuccessMessage(*req.params))));
+    echoed += req.params->size();
+  }
+};
+
+TEST(Libev, UringJsonRpc) {
+  using namespace common::protocols::json_rpc;
+  RpcEchoHandler hand;
+  RpcServer* serv = new RpcServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), &hand);
+  ASSERT_FALSE(serv->Bind(true));
+  ASSERT_FALSE(serv->Listen(5));
+  common::ErrnoError err = serv->SetBackend(common::libev::IO_BACKEND_URING);
+  if (err) {
+    std::cout << "io_uring is not available: " << err->GetDescription() << std::endl;
+    delete serv;
+    return;
+  }
+  std::thread serv_thread([serv]() { ignore_result(serv->Exec()); });
+
+  common::net::socket_info client;
+  ASSERT_FALSE(common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &client));
+  // the message spans many receive buffers and arrives in two parts, the
+  // length prefix with the first of them
+  std::string payload(128 * 1024, 0);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<char>('a' + i % 26);
+  }
+  for (size_t round = 0; round < 2; ++round) {
+    JsonRPCRequest req;
+    req.id = MakeRequestID(round);
+    req.method = "echo";
+    req.params = payload;
+    std::string body;
+    ASSERT_FALSE(MakeJsonRPCRequest(req, &body));
+    const protocoled_size_t size = htonl(static_cast<protocoled_size_t>(body.size()));
+    std::string message(reinterpret_cast<const char*>(&size), sizeof(size));
+    message += body;
+
+    const size_t split = 1000;
+    size_t nwrite = 0;
+    ASSERT_FALSE(common::net::write_to_socket(client.fd(), message.data(), split, &nwrite));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::thread writer([&client, &message, split]() {
+      size_t nwrite = 0;
+      ASSERT_FALSE(common::net::write_to_socket(client.fd(), message.data() + split, message.size() - split, &nwrite));
+    });
+
+    std::string reply;
+    ASSERT_TRUE(RecvAll(client.fd(), &reply, sizeof(protocoled_size_t)));
+    protocoled_size_t reply_size = 0;
+    memcpy(&reply_size, reply.data(), sizeof(reply_size));
+    ASSERT_TRUE(RecvAll(client.fd(), &reply, ntohl(reply_size)));
+    writer.join();
+    JsonRPCResponse resp;
+    ASSERT_FALSE(ParseJsonRPCResponse(reply, &resp));
+    ASSERT_TRUE(resp.IsMessage());
+    ASSERT_EQ(resp.id, req.id);
+    ASSERT_EQ(resp.message->result, payload);
+  }
+  ASSERT_EQ(hand.echoed, 2 * payload.size());
+
+  ignore_result(common::net::close(client.fd()));
+  while (hand.closed == 0) {
+    std::this_thread::yield();
+  }
+  serv->Stop();
+  serv_thread.join();
+  delete serv;
+}
+
+// takes one 4 byte record per callback and echoes it, "BIG!" is answered
+// with more than the io_uring send queue holds
+class RecordHandler : public EchoHandler {
+ public:
+  enum : size_t { kBigReplySize = 6 * 1024 * 1024 };
+
+  RecordHandler() : records(0) {}
+
+  void DataReceived(common::libev::IoClient* client) override {
+    char record[4];
+    size_t nread = 0;
+    common::ErrnoError err = client->Read(record, sizeof(record), &nread);
+    if (err || nread == 0) {
+      ignore_result(client->Close());
+      delete client;
+      return;
+    }
+
+    records++;
+    size_t nwrite = 0;
+    if (memcmp(record, "BIG!", sizeof(record)) != 0) {
+      ASSERT_FALSE(client->Write(record, sizeof(record), &nwrite));
+      return;
+    }
+    const std::string part(1024 * 1024, 'z');
+    for (size_t i = 0; i < kBigReplySize / part.size(); ++i) {
+      ASSERT_FALSE(client->Write(part.data(), part.size(), &nwrite));
+    }
+  }
+
+  std::atomic<size_t> records;
+};
+
+TEST(Libev, UringPipelinedRecords) {
+  RecordHandler hand;
+  common::libev::tcp::TcpServer* serv =
+      new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+  ASSERT_FALSE(serv->Bind(true));
+  ASSERT_FALSE(serv->Listen(5));
+  common::ErrnoError err = serv->SetBackend(common::libev::IO_BACKEND_URING);
+  if (err) {
+    std::cout << "io_uring is not available: " << err->GetDescription() << std::endl;
+    delete serv;
+    return;
+  }
+  std::thread serv_thread([serv]() { ignore_result(serv->Exec()); });
+
+  common::net::socket_info client;
+  ASSERT_FALSE(common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &client));
+  // both records come in one receive, the second without new input
+  const std::string records = "AAAABBBB";
+  size_t nwrite = 0;
+  ASSERT_FALSE(common::net::write_to_socket(client.fd(), records.data(), records.size(), &nwrite));
+  std::string reply;
+  ASSERT_TRUE(RecvAll(client.fd(), &reply, records.size()));
+  ASSERT_EQ(reply, records);
+  ASSERT_EQ(hand.records, 2u);
+
+  // the writer waits for the queue to drain instead of failing with EAGAIN
+  ASSERT_FALSE(common::net::write_to_socket(client.fd(), "BIG!", 4, &nwrite));
+  ASSERT_TRUE(RecvAll(client.fd(), &reply, RecordHandler::kBigReplySize));
+  ASSERT_EQ(reply, std::string(RecordHandler::kBigReplySize, 'z'));
+  ASSERT_FALSE(common::net::write_to_socket(client.fd(), "CCCC", 4, &nwrite));
+  ASSERT_TRUE(RecvAll(client.fd(), &reply, 4));
+  ASSERT_EQ(reply, "CCCC");
+
+  ignore_result(common::net::close(client.fd()));
+  while (hand.closed == 0) {
+    std::this_thread::yield();
+  }
+  serv->Stop();
+  serv_thread.join();
+  delete serv;
+}
+
+TEST(Libev, RpcStreamCoding) {
+  using namespace common::protocols::json_rpc;
+  std::vector<std::shared_ptr<common::IEDcoder>> coders;
+#ifdef HAVE_ZLIB
+  coders.push_back(std::make_shared<common::CompressZlibEDcoder>());
+#endif
+#ifdef HAVE_LZ4
+  coders.push_back(std::make_shared<common::CompressLZ4EDcoder>());
+#endif
+#ifdef HAVE_SNAPPY
+  coders.push_back(std::make_shared<common::CompressSnappyEDcoder>());
+#endif
+
+  // larger than a decode chunk, so the body is decoded in several parts
+  std::string payload(300 * 1024, 0);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<char>('a' + (i * 7 + i / 13) % 26);
+  }
+  for (auto coder : coders) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    RpcClient writer(coder, nullptr, common::net::socket_info(fds[0]));
+    RpcClient reader(coder, nullptr, common::net::socket_info(fds[1]));
+    writer.SetStreamCoding(true);
+    reader.SetStreamCoding(true);
+    ASSERT_TRUE(reader.IsStreamCoding());
+
+    JsonRPCRequest req;
+    req.id = MakeRequestID(1);
+    req.method = "echo";
+    req.params = payload;
+    std::thread write_thread([&writer, &req]() { ASSERT_FALSE(writer.WriteRequest(req)); });
+    std::string command;
+    ASSERT_FALSE(reader.ReadCommand(&command));
+    write_thread.join();
+    JsonRPCRequest parsed;
+    ASSERT_FALSE(ParseJsonRPCRequest(command, &parsed));
+    ASSERT_EQ(*parsed.params, payload);
+
+    if (coder->GetType() != common::ED_ZLIB) {  // zlib streams and blocks share their format
+      // a body in the one-shot format is rejected by a stream coding peer
+      writer.SetStreamCoding(false);
+      write_thread = std::thread([&writer, &req]() { ASSERT_FALSE(writer.WriteRequest(req)); });
+      ASSERT_TRUE(reader.ReadCommand(&command));
+      write_thread.join();
+    }
+
+    ignore_result(writer.Close());
+    ignore_result(reader.Close());
+  }
+}
+#endif
+
+TEST(Libev, ExecInLoopThread) {
+  common::libev::LibEvLoop* loop = new common::libev::LibEvLoop;
+  const size_t producers = 4;
+  const size_t per_producer = 20000;
+  std::vector<size_t> next(producers, 0);
+  std::atomic<size_t> executed(0);
+  std::atomic<bool> out_of_order(false);
+  std::atomic<bool> off_thread(false);
+  std::promise<void> done;
+
+  // posted before the loop runs
+  bool early = false;
+  loop->ExecInLoopThread([&early]() { early = true; });
+
+  std::thread loop_thread([loop]() { ignore_result(loop->Exec()); });
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.push_back(std::thread([&, p]() {
+      for (size_t i = 0; i < per_producer; ++i) {
+        loop->ExecInLoopThread([&, p, i]() {
+          if (!loop->IsLoopThread()) {
+            off_thread = true;
+          }
+          if (next[p] != i) {
+            out_of_order = true;
+          }
+          next[p] = i + 1;
+          if (++executed == producers * per_producer) {
+            done.set_value();
+          }
+        });
+      }
+    }));
+  }
+  for (size_t p = 0; p < producers; ++p) {
+    threads[p].join();
+  }
+  done.get_future().wait();
+  ASSERT_TRUE(early);
+  ASSERT_FALSE(out_of_order);
+  ASSERT_FALSE(off_thread);
+
+  // a producer flooding the loop does not hold it, stop still gets in
+  std::atomic<bool> flooding(true);
+  std::thread flooder([loop, &flooding]() {
+    while (flooding) {
+      loop->ExecInLoopThread([]() {});
+    }
+  });
+  common::threads::PlatformThread::Sleep(50);
+  loop->Stop();
+  loop_thread.join();
+  flooding = false;
+  flooder.join();
+  delete loop;
+}
+
+TEST(TimerWheel, ExpiresOnTime) {
+  std::map<common::libev::TimerWheelNode*, uint64_t> fired;
+  common::libev::TimerWheel* wheel = nullptr;
+  common::libev::TimerWheel w([&](common::libev::TimerWheelNode* node) { fired[node] = wheel->GetCurrentTick(); },
+                              1000);
+  wheel = &w;
+
+  // one deadline per level, on and around the slot boundaries
+  const uint64_t deadlines[] = {1, 255, 256, 257, 300, 16383, 16384, 20000, (1 << 20) + 5, (1 << 26) - 1};
+  const size_t count = sizeof(deadlines) / sizeof(deadlines[0]);
+  common::libev::TimerWheelNode nodes[count];
+  for (size_t i = 0; i < count; ++i) {
+    w.Schedule(&nodes[i], deadlines[i]);
+    ASSERT_TRUE(nodes[i].IsScheduled());
+    ASSERT_EQ(nodes[i].GetExpires(), 1000 + deadlines[i]);
+  }
+  common::libev::TimerWheelNode clamped;
+  w.ScheduleAt(&clamped, UINT64_MAX);
+  ASSERT_EQ(clamped.GetExpires(), 1001 + common::libev::TimerWheel::kMaxTicks);
+  ASSERT_EQ(w.GetSize(), count + 1);
+
+  // uneven steps so that cascades happen in the middle of an advance
+  uint64_t tick = 1000;
+  while (!w.IsEmpty()) {
+    tick += 977;
+    w.AdvanceTo(tick);
+  }
+  ASSERT_EQ(fired.size(), count + 1);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_FALSE(nodes[i].IsScheduled());
+    ASSERT_EQ(fired[&nodes[i]], 1000 + deadlines[i]);
+  }
+  ASSERT_EQ(fired[&clamped], 1001 + common::libev::TimerWheel::kMaxTicks);
+
+  // an empty wheel jumps, a missed deadline fires on the next tick
+  w.AdvanceTo(UINT64_C(1) << 40);
+  ASSERT_EQ(w.GetCurrentTick(), UINT64_C(1) << 40);
+  w.ScheduleAt(&nodes[0], 5);
+  ASSERT_EQ(w.AdvanceTo(w.GetCurrentTick()), 0);
+  ASSERT_EQ(w.AdvanceTo(w.GetCurrentTick() + 1), 1);
+}
+
+TEST(TimerWheel, CancelAndReschedule) {
+  std::vector<common::libev::TimerWheelNode*> fired;
+  common::libev::TimerWheelNode first, second, periodic;
+  common::libev::TimerWheel* wheel = nullptr;
+  common::libev::TimerWheel w(
+      [&](common::libev::TimerWheelNode* node) {
+        fired.push_back(node);
+        if (node == &first) {
+          // expiring in the same tick, already moved out of the slot
+          wheel->Cancel(&second);
+        } else if (node == &periodic && fired.size() < 5) {
+          wheel->Schedule(node, 10);
+        }
+      });
+  wheel = &w;
+
+  w.Schedule(&first, 5);
+  w.Schedule(&second, 5);
+  w.Schedule(&periodic, 10);
+  ASSERT_EQ(w.GetSize(), 3);
+  ASSERT_EQ(w.AdvanceTo(5), 1);
+  ASSERT_EQ(fired.size(), 1);
+  ASSERT_FALSE(second.IsScheduled());
+  ASSERT_EQ(w.GetSize(), 1);
+
+  // rescheduling moves the deadline, cancel is idempotent
+  w.Schedule(&first, 1000);
+  w.Schedule(&first, 2);
+  w.Cancel(&second);
+  ASSERT_EQ(w.GetSize(), 2);
+  ASSERT_EQ(w.AdvanceTo(7), 1);
+  ASSERT_EQ(w.AdvanceTo(40), 3);
+  ASSERT_EQ(fired.size(), 5);
+  ASSERT_EQ(fired[4], &periodic);
+  ASSERT_TRUE(w.IsEmpty());
+
+  // a destroyed node leaves the wheel, a destroyed wheel releases its nodes
+  {
+    common::libev::TimerWheelNode temporary;
+    w.Schedule(&temporary, 300);
+    ASSERT_EQ(w.GetSize(), 1);
+  }
+  ASSERT_TRUE(w.IsEmpty());
+  common::libev::TimerWheelNode orphan;
+  {
+    common::libev::TimerWheel other(nullptr);
+    other.Schedule(&orphan, 20000);
+    ASSERT_TRUE(orphan.IsScheduled());
+  }
+  ASSERT_FALSE(orphan.IsScheduled());
+}
+
+class IdleHandler : public ServerHandler {
+ public:
+  explicit IdleHandler(common::time64_t timeout) : timeout(timeout), accepted(), idle() {}
+
+  void PreLooped(common::libev::IoLoop* server) override { UNUSED(server); }
+
+  void Accepted(common::libev::IoClient* client) override {
+    client->GetServer()->SetIdleTimeout(client, timeout);
+    accepted.push_back(client);
+  }
+
+  void DataReceived(common::libev::IoClient* client) override {
+    char buf[64];
+    size_t nread = 0;
+    common::ErrnoError err = client->SingleRead(buf, sizeof(buf), &nread);
+    if (err || nread == 0) {
+      ignore_result(client->Close());
+      delete client;
+    }
+  }
+
+  void IdleTimeout(common::libev::IoClient* client) override {
+    ASSERT_EQ(client->GetIdleTimeout(), timeout);
+    const size_t index = std::find(accepted.begin(), accepted.end(), client) - accepted.begin();
+    idle.push_back(std::make_pair(index, common::time::current_monotonic_mstime()));
+    common::libev::IoLoop* server = client->GetServer();
+    ignore_result(client->Close());
+    delete client;
+    if (idle.size() == accepted.size()) {
+      server->Stop();
+    }
+  }
+
+  const common::time64_t timeout;
+  std::vector<common::libev::IoClient*> accepted;
+  std::vector<std::pair<size_t, common::time64_t>> idle;
+};
+
+TEST(Libev, IdleTimeout) {
+  const common::time64_t timeout = 100;
+  IdleHandler hand(timeout);
+  common::libev::tcp::TcpServer* serv =
+      new common::libev::tcp::TcpServer(common::net::HostAndPort("127.0.0.1", RANDOM_PORT), false, &hand);
+  common::ErrnoError err = serv->Bind(true);
+  ASSERT_FALSE(err);
+  err = serv->Listen(5);
+  ASSERT_FALSE(err);
+
+  // the first client stays silent, the second one keeps talking for a while
+  common::net::socket_info silent, active;
+  err = common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &silent);
+  ASSERT_FALSE(err);
+  err = common::net::connect(serv->GetHost(), common::net::ST_SOCK_STREAM, nullptr, &active);
+  ASSERT_FALSE(err);
+  const common::time64_t start = common::time::current_monotonic_mstime();
+  std::thread talker([active]() {
+    for (int i = 0; i < 10; ++i) {
+      common::threads::PlatformThread::Sleep(30);
+      size_t nwrite = 0;
+      ignore_result(common::net::write_to_tcp_socket(active.fd(), "x", 1, &nwrite));
+    }
+  });
+
+  int res_exec = serv->Exec();
+  ASSERT_TRUE(res_exec == EXIT_SUCCESS);
+  talker.join();
+  delete serv;
+
+  ASSERT_EQ(hand.accepted.size(), 2);
+  ASSERT_EQ(hand.idle.size(), 2);
+  ASSERT_EQ(hand.idle[0].first, 0);
+  ASSERT_EQ(hand.idle[1].first, 1);
+  ASSERT_GE(hand.idle[0].second - start, timeout);
+  ASSERT_GE(hand.idle[1].second - start, 300 + timeout);
+  ASSERT_GE(hand.idle[1].second - hand.idle[0].second, 150);
+  ignore_result(common::net::close(silent.fd()));
+  ignore_result(common::net::close(active.fd()));
+}
+
 //
 
 #define BUF_SIZE 4096
@@ -1,6 +1,25 @@
 #include <gtest/gtest.h>
 
+#include <string.h>
+
+#if defined(OS_POSIX)
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+
+#if defined(OS_POSIX)
+#include <common/net/datagram_batch.h>
+#endif
+#include <common/net/dns_resolver.h>
+#include <common/net/file_sender.h>
 #include <common/net/net.h>
+#include <common/net/socket_options.h>
 #include <common/net/socket_tcp.h>
 #include <common/sprintf.h>
 #include <common/threads/thread_manager.h>
@@ -231,3 +250,540 @@ TEST(SocketTcpIpv6, bindRandomWorkflow) {
   err = serv.Close();
   ASSERT_FALSE(err);
 }
+
+namespace {
+
+class ResolveWaiter {
+ public:
+  ResolveWaiter() : mutex_(), cond_(), count_(0) {}
+
+  common::net::DnsResolver::resolve_callback_t Callback(common::ErrnoError* err, common::net::IPAddressList* out) {
+    return [this, err, out](common::ErrnoError lerr, const common::net::IPAddressList& addresses) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (err) {
+        *err = lerr;
+      }
+      if (out) {
+        *out = addresses;
+      }
+      count_++;
+      cond_.notify_all();
+    };
+  }
+
+  void Wait(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this, count]() { return count_ >= count; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  size_t count_;
+};
+
+common::net::DnsResolver::lookup_function_t MakeStubLookup(std::atomic<int>* calls) {
+  return [calls](const std::string& host, common::net::IPAddressList* out, common::time64_t* ttl_msec) {
+    UNUSED(ttl_msec);
+    (*calls)++;
+    if (host == "stub.test") {
+      *out = {common::net::IPAddress(10, 0, 0, 1), common::net::IPAddress::IPv6Localhost()};
+      return common::ErrnoError();
+    }
+    return common::make_error_perror("getaddrinfo", ENOENT);
+  };
+}
+
+}  // namespace
+
+TEST(DnsResolver, stub_lookup_and_cache) {
+  using namespace common::net;
+  std::atomic<int> calls(0);
+  DnsResolver resolver;
+  resolver.SetLookupFunction(MakeStubLookup(&calls));
+
+  ResolveWaiter waiter;
+  common::ErrnoError err;
+  IPAddressList addresses;
+  resolver.Resolve(HostAndPort("stub.test", 80), nullptr, waiter.Callback(&err, &addresses));
+  waiter.Wait(1);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(addresses.size(), 2u);
+  ASSERT_EQ(addresses[0], IPAddress(10, 0, 0, 1));
+  ASSERT_EQ(calls, 1);
+  ASSERT_EQ(resolver.GetCacheSize(), 1u);
+
+  // cache hits are case insensitive and answered synchronously
+  addresses.clear();
+  resolver.Resolve("STUB.test", nullptr, waiter.Callback(&err, &addresses));
+  waiter.Wait(2);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(addresses.size(), 2u);
+  err = resolver.ResolveSync("stub.test", &addresses);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(calls, 1);
+
+  // literals never reach the lookup function
+  err = resolver.ResolveSync("192.168.1.1", &addresses);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(addresses.size(), 1u);
+  ASSERT_EQ(addresses[0], IPAddress(192, 168, 1, 1));
+  ASSERT_EQ(calls, 1);
+
+  resolver.ClearCache();
+  err = resolver.ResolveSync("stub.test", &addresses);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(calls, 2);
+}
+
+TEST(DnsResolver, coalesce_concurrent_lookups) {
+  using namespace common::net;
+  std::atomic<int> calls(0);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  DnsResolver resolver;
+  resolver.SetLookupFunction(
+      [&calls, released](const std::string& host, IPAddressList* out, common::time64_t* ttl_msec) {
+        UNUSED(host);
+        UNUSED(ttl_msec);
+        calls++;
+        released.wait();
+        *out = {IPAddress(10, 0, 0, 2)};
+        return common::ErrnoError();
+      });
+
+  const size_t kRequests = 16;
+  ResolveWaiter waiter;
+  IPAddressList addresses[kRequests];
+  for (size_t i = 0; i < kRequests; ++i) {
+    resolver.Resolve("same.test", nullptr, waiter.Callback(nullptr, &addresses[i]));
+  }
+  release.set_value();
+  waiter.Wait(kRequests);
+  ASSERT_EQ(calls, 1);
+  for (size_t i = 0; i < kRequests; ++i) {
+    ASSERT_EQ(addresses[i].size(), 1u);
+    ASSERT_EQ(addresses[i][0], IPAddress(10, 0, 0, 2));
+  }
+}
+
+TEST(DnsResolver, negative_cache_and_ttl) {
+  using namespace common::net;
+  std::atomic<int> calls(0);
+  DnsResolverOptions options;
+  options.negative_ttl_msec = 50;
+  DnsResolver resolver(options);
+  resolver.SetLookupFunction(MakeStubLookup(&calls));
+
+  IPAddressList addresses;
+  common::ErrnoError err = resolver.ResolveSync("missing.test", &addresses);
+  ASSERT_TRUE(err);
+  err = resolver.ResolveSync("missing.test", &addresses);
+  ASSERT_TRUE(err);
+  ASSERT_EQ(calls, 1);
+
+  common::threads::PlatformThread::Sleep(60);
+  err = resolver.ResolveSync("missing.test", &addresses);
+  ASSERT_TRUE(err);
+  ASSERT_EQ(calls, 2);
+
+  // a ttl reported by the lookup wins over the defaults, zero disables caching
+  resolver.SetLookupFunction([&calls](const std::string& host, IPAddressList* out, common::time64_t* ttl_msec) {
+    UNUSED(host);
+    calls++;
+    *out = {IPAddress(10, 0, 0, 3)};
+    *ttl_msec = 0;
+    return common::ErrnoError();
+  });
+  resolver.ClearCache();
+  err = resolver.ResolveSync("nocache.test", &addresses);
+  ASSERT_FALSE(err);
+  err = resolver.ResolveSync("nocache.test", &addresses);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(calls, 4);
+  ASSERT_EQ(resolver.GetCacheSize(), 0u);
+}
+
+TEST(DnsResolver, executor_delivery) {
+  using namespace common::net;
+  std::atomic<int> calls(0);
+  DnsResolver resolver;
+  resolver.SetLookupFunction(MakeStubLookup(&calls));
+
+  std::mutex tasks_mutex;
+  std::vector<DnsResolver::task_t> tasks;
+  auto executor = [&tasks_mutex, &tasks](DnsResolver::task_t task) {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    tasks.push_back(task);
+  };
+
+  ResolveWaiter waiter;
+  common::ErrnoError err;
+  resolver.Resolve("missing.test", executor, waiter.Callback(&err, nullptr));
+  resolver.Resolve("stub.test", executor, waiter.Callback(nullptr, nullptr));
+  for (int i = 0; i < 100; ++i) {
+    {
+      std::lock_guard<std::mutex> lock(tasks_mutex);
+      if (tasks.size() == 2) {
+        break;
+      }
+    }
+    common::threads::PlatformThread::Sleep(10);
+  }
+
+  std::vector<DnsResolver::task_t> ready;
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    ready.swap(tasks);
+  }
+  ASSERT_EQ(ready.size(), 2u);
+  for (const auto& task : ready) {
+    task();
+  }
+  waiter.Wait(2);
+  ASSERT_EQ(calls, 2);
+}
+
+TEST(DnsResolver, interleave_address_families) {
+  using namespace common::net;
+  const IPAddress v4a(10, 0, 0, 1), v4b(10, 0, 0, 2), v4c(10, 0, 0, 3);
+  const IPAddress v6a = IPAddress::IPv6Localhost();
+  const IPAddress v6b = ConvertIPv4ToIPv4MappedIPv6(v4a);
+  ASSERT_TRUE(InterleaveAddressFamilies({}).empty());
+
+  IPAddressList res = InterleaveAddressFamilies({v6a, v6b, v4a, v4b, v4c});
+  ASSERT_EQ(res, IPAddressList({v6a, v4a, v6b, v4b, v4c}));
+  res = InterleaveAddressFamilies({v4a, v4b, v6a});
+  ASSERT_EQ(res, IPAddressList({v4a, v6a, v4b}));
+}
+
+TEST(DnsResolver, connect_uses_cache) {
+  using namespace common::net;
+  IPAddressList addresses;
+  common::ErrnoError err = DnsResolver::GetInstance()->ResolveSync("localhost", &addresses);
+  ASSERT_FALSE(err);
+  ASSERT_FALSE(addresses.empty());
+  ASSERT_TRUE(addresses[0].IsLoopback());
+
+  std::atomic<int> calls(0);
+  DnsResolver::GetInstance()->SetLookupFunction(MakeStubLookup(&calls));
+  socket_info info;
+  err = resolve(HostAndPort("stub.test", 80), ST_SOCK_STREAM, &info);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(info.port(), 80);
+  err = common::net::close(info.fd());
+  ASSERT_FALSE(err);
+  err = resolve(HostAndPort("stub.test", 81), ST_SOCK_STREAM, &info);
+  ASSERT_FALSE(err);
+  err = common::net::close(info.fd());
+  ASSERT_FALSE(err);
+  ASSERT_EQ(calls, 1);
+
+  DnsResolver::GetInstance()->SetLookupFunction(nullptr);
+  DnsResolver::GetInstance()->ClearCache();
+}
+
+#if defined(OS_POSIX)
+namespace {
+
+std::string MakePattern(size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>((i * 131 + i / 253) & 0xFF);
+  }
+  return data;
+}
+
+int WritePatternFile(const std::string& path, const std::string& data) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd == INVALID_DESCRIPTOR) {
+    return fd;
+  }
+  if (write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+    ::close(fd);
+    return INVALID_DESCRIPTOR;
+  }
+  return fd;
+}
+
+std::string ReadExactly(int sock, size_t size) {
+  std::string result;
+  char buffer[4096];
+  while (result.size() < size) {
+    ssize_t nread = read(sock, buffer, std::min(sizeof(buffer), size - result.size()));
+    if (nread <= 0) {
+      break;
+    }
+    result.append(buffer, nread);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(FileSender, send_file_to_fd_from_offset) {
+  const std::string path = "/tmp/unit_test_file_sender.bin";
+  const std::string data = MakePattern(8192);
+  int fd = WritePatternFile(path, data);
+  ASSERT_NE(fd, INVALID_DESCRIPTOR);
+
+  int socks[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+  // the file position is at the end, only |offset| may be used
+  common::ErrnoError err = common::net::send_file_to_fd(socks[0], fd, 1000, 5000);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(ReadExactly(socks[1], 5000), data.substr(1000, 5000));
+
+  ::close(socks[0]);
+  ::close(socks[1]);
+  ::close(fd);
+  unlink(path.c_str());
+}
+
+TEST(FileSender, resume_from_offset) {
+  const std::string path = "/tmp/unit_test_file_sender_resume.bin";
+  const std::string data = MakePattern(4096);
+  int fd = WritePatternFile(path, data);
+  ASSERT_NE(fd, INVALID_DESCRIPTOR);
+
+  int socks[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+  off_t resume_at = 0;
+  {
+    common::net::FileSender sender(fd, 100, 3000);
+    size_t sent = 0;
+    common::ErrnoError err = sender.SendTo(socks[0], 1000, &sent);
+    ASSERT_FALSE(err);
+    ASSERT_EQ(sent, 1000u);
+    ASSERT_EQ(sender.GetSent(), 1000u);
+    ASSERT_FALSE(sender.IsDone());
+    resume_at = sender.GetOffset();
+  }
+  ASSERT_EQ(resume_at, 1100);
+
+  common::net::FileSender sender(fd, resume_at, 2000);
+  while (!sender.IsDone()) {
+    size_t sent = 0;
+    common::ErrnoError err = sender.SendTo(socks[0], 512, &sent);
+    ASSERT_FALSE(err);
+    ASSERT_LE(sent, 512u);
+  }
+  ASSERT_EQ(sender.GetSent(), 2000u);
+  ASSERT_EQ(ReadExactly(socks[1], 3000), data.substr(100, 3000));
+
+  ::close(socks[0]);
+  ::close(socks[1]);
+  ::close(fd);
+  unlink(path.c_str());
+}
+
+#if defined(OS_LINUX)
+TEST(FileSender, splice_pipe_source) {
+  int source[2];
+  ASSERT_EQ(pipe2(source, O_NONBLOCK), 0);
+  int socks[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+
+  common::net::FileSender sender(source[0], 0, 1 << 20);
+  size_t sent = 0;
+  common::ErrnoError err = sender.SendTo(socks[0], 1 << 20, &sent);
+  ASSERT_TRUE(err);
+  ASSERT_EQ(err->GetErrorCode(), EAGAIN);
+  ASSERT_TRUE(sender.IsWaitingForSource());
+
+  const std::string data = MakePattern(10000);
+  ASSERT_EQ(write(source[1], data.data(), data.size()), static_cast<ssize_t>(data.size()));
+  ::close(source[1]);
+  while (!sender.IsDone()) {
+    err = sender.SendTo(socks[0], 4096, &sent);
+    ASSERT_FALSE(err);
+  }
+  // EOF before the requested size
+  ASSERT_EQ(sender.GetSent(), data.size());
+  ASSERT_EQ(ReadExactly(socks[1], data.size()), data);
+
+  ::close(socks[0]);
+  ::close(socks[1]);
+  ::close(source[0]);
+}
+#endif
+
+namespace {
+
+int MakeLoopbackUdpSocket(struct sockaddr_in* addr) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(*addr);
+  if (fd == INVALID_DESCRIPTOR || ::bind(fd, reinterpret_cast<struct sockaddr*>(addr), len) != 0 ||
+      ::getsockname(fd, reinterpret_cast<struct sockaddr*>(addr), &len) != 0) {
+    return INVALID_DESCRIPTOR;
+  }
+  return fd;
+}
+
+}  // namespace
+
+TEST(DatagramBatch, push_limits) {
+  common::net::DatagramBatch batch(2, 100);
+  const std::string data = MakePattern(101);
+  ASSERT_FALSE(batch.Push(data.data(), 101));
+  ASSERT_TRUE(batch.Push(data.data(), 100));
+  ASSERT_TRUE(batch.Push(data.data(), 0));
+  ASSERT_TRUE(batch.IsFull());
+  ASSERT_FALSE(batch.Push(data.data(), 1));
+  ASSERT_EQ(batch.GetCount(), 2u);
+  ASSERT_EQ(batch.GetSize(0), 100u);
+  ASSERT_EQ(batch.GetSize(1), 0u);
+  ASSERT_EQ(std::string(batch.GetData(0), 100), data.substr(0, 100));
+  batch.Clear();
+  ASSERT_EQ(batch.GetCount(), 0u);
+}
+
+TEST(DatagramBatch, sendmmsg_recvmmsg) {
+  struct sockaddr_in from_addr, to_addr;
+  int from = MakeLoopbackUdpSocket(&from_addr);
+  int to = MakeLoopbackUdpSocket(&to_addr);
+  ASSERT_NE(from, INVALID_DESCRIPTOR);
+  ASSERT_NE(to, INVALID_DESCRIPTOR);
+
+  const size_t count = 40;
+  const std::string data = MakePattern(count * 10);
+  common::net::DatagramBatch out(count, 1500);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(out.Push(data.data(), i * 10, reinterpret_cast<struct sockaddr*>(&to_addr), sizeof(to_addr)));
+  }
+  size_t sent = 0;
+  common::ErrnoError err = common::net::sendmmsg(from, &out, &sent);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(sent, count);
+  ASSERT_EQ(out.GetSent(), count);
+
+  // fewer slots than datagrams: the rest waits for the next call
+  common::net::DatagramBatch in(32, 1500);
+  size_t received = 0;
+  err = common::net::recvmmsg(to, &in, &received);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(received, 32u);
+  for (size_t i = 0; i < received; ++i) {
+    ASSERT_EQ(std::string(in.GetData(i), in.GetSize(i)), data.substr(0, i * 10));
+    ASSERT_EQ(in.GetAddressLength(i), sizeof(from_addr));
+    const struct sockaddr_in* peer = reinterpret_cast<const struct sockaddr_in*>(in.GetAddress(i));
+    ASSERT_EQ(peer->sin_port, from_addr.sin_port);
+    ASSERT_EQ(in.GetSegmentSize(i), 0);
+  }
+  err = common::net::recvmmsg(to, &in, &received);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(received, count - 32);
+  ASSERT_EQ(in.GetSize(0), 320u);
+
+  ::close(from);
+  ::close(to);
+}
+
+#if defined(OS_LINUX)
+TEST(DatagramBatch, segmentation_offload) {
+  struct sockaddr_in from_addr, to_addr;
+  int from = MakeLoopbackUdpSocket(&from_addr);
+  int to = MakeLoopbackUdpSocket(&to_addr);
+  ASSERT_NE(from, INVALID_DESCRIPTOR);
+  ASSERT_NE(to, INVALID_DESCRIPTOR);
+
+  // one 4000 byte buffer leaves as four datagrams of 1000
+  const std::string data = MakePattern(4000);
+  common::net::DatagramBatch out(1, common::net::DatagramBatch::kMaxDatagramSize);
+  ASSERT_TRUE(out.Push(data.data(), data.size(), reinterpret_cast<struct sockaddr*>(&to_addr), sizeof(to_addr), 1000));
+  size_t sent = 0;
+  common::ErrnoError err = common::net::sendmmsg(from, &out, &sent);
+  if (err) {  // kernel without UDP GSO
+    ::close(from);
+    ::close(to);
+    return;
+  }
+  ASSERT_EQ(sent, 1u);
+
+  common::net::DatagramBatch in(8, 1500);
+  size_t received = 0;
+  err = common::net::recvmmsg(to, &in, &received);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(received, 4u);
+  for (size_t i = 0; i < received; ++i) {
+    ASSERT_EQ(std::string(in.GetData(i), in.GetSize(i)), data.substr(i * 1000, 1000));
+  }
+
+  // with GRO they come back as one slot
+  if (!common::net::set_udp_gro(to, true)) {
+    out.Clear();
+    ASSERT_TRUE(
+        out.Push(data.data(), data.size(), reinterpret_cast<struct sockaddr*>(&to_addr), sizeof(to_addr), 1000));
+    err = common::net::sendmmsg(from, &out, &sent);
+    ASSERT_FALSE(err);
+    common::net::DatagramBatch coalesced(8, common::net::DatagramBatch::kMaxDatagramSize);
+    err = common::net::recvmmsg(to, &coalesced, &received);
+    ASSERT_FALSE(err);
+    ASSERT_EQ(received, 1u);
+    ASSERT_EQ(coalesced.GetSegmentSize(0), 1000);
+    ASSERT_EQ(std::string(coalesced.GetData(0), coalesced.GetSize(0)), data);
+  }
+
+  ::close(from);
+  ::close(to);
+}
+#endif
+
+TEST(SocketTcp, accept_flags_and_options) {
+  common::net::ServerSocketTcp serv(common::net::HostAndPort("127.0.0.1", RANDOM_PORT));
+  common::ErrnoError err = serv.Bind(true);
+  ASSERT_FALSE(err);
+  err = serv.Listen(5);
+  ASSERT_FALSE(err);
+
+  common::net::socket_info client;
+  err = common::net::connect(serv.GetHost(), common::net::ST_SOCK_STREAM, nullptr, &client);
+  ASSERT_FALSE(err);
+
+  common::net::socket_info accepted;
+  err = common::net::accept(serv.GetInfo(), true, &accepted);
+  ASSERT_FALSE(err);
+  ASSERT_TRUE(fcntl(accepted.fd(), F_GETFL) & O_NONBLOCK);
+  ASSERT_TRUE(fcntl(accepted.fd(), F_GETFD) & FD_CLOEXEC);
+  ASSERT_EQ(accepted.host(), std::string("127.0.0.1"));
+
+  common::net::TcpSocketOptions options;
+  options.no_delay = true;
+  options.keep_alive = true;
+  options.keep_alive_idle_sec = 30;
+  options.receive_buffer_size = 256 * 1024;
+  err = common::net::apply_tcp_socket_options(accepted.fd(), options);
+  ASSERT_FALSE(err);
+  int value = 0;
+  socklen_t len = sizeof(value);
+  ASSERT_EQ(getsockopt(accepted.fd(), IPPROTO_TCP, TCP_NODELAY, &value, &len), 0);
+  ASSERT_NE(value, 0);
+  ASSERT_EQ(getsockopt(accepted.fd(), SOL_SOCKET, SO_KEEPALIVE, &value, &len), 0);
+  ASSERT_NE(value, 0);
+#if defined(TCP_KEEPIDLE)
+  ASSERT_EQ(getsockopt(accepted.fd(), IPPROTO_TCP, TCP_KEEPIDLE, &value, &len), 0);
+  ASSERT_EQ(value, 30);
+#endif
+
+  err = common::net::close(accepted.fd());
+  ASSERT_FALSE(err);
+  err = common::net::close(client.fd());
+  ASSERT_FALSE(err);
+
+  // the legacy overload is close-on-exec as well
+  err = common::net::connect(serv.GetHost(), common::net::ST_SOCK_STREAM, nullptr, &client);
+  ASSERT_FALSE(err);
+  err = common::net::accept(serv.GetInfo(), &accepted);
+  ASSERT_FALSE(err);
+  ASSERT_TRUE(fcntl(accepted.fd(), F_GETFD) & FD_CLOEXEC);
+  err = common::net::close(accepted.fd());
+  ASSERT_FALSE(err);
+  err = common::net::close(client.fd());
+  ASSERT_FALSE(err);
+  err = serv.Close();
+  ASSERT_FALSE(err);
+}
+#endif
@@ -29,9 +29,15 @@
 
 #include <gtest/gtest.h>
 
+#include <math.h>
+#include <string.h>
+
+#include <random>
+
 #include <common/byte_writer.h>
 #include <common/convert2string.h>
 #include <common/sprintf.h>
+#include <common/string_number_conversions.h>
 #include <common/string_piece.h>
 #include <common/string_util.h>
 #include <common/utf_string_conversions.h>
@@ -741,6 +747,149 @@ TEST(ConvertFromString, double) {
   ASSERT_EQ(common::ConvertToCharBytes(val), MAKE_CHAR_BUFFER(MINUS_INF));
 }
 
+TEST(ConvertFromString, invalid_float) {
+  double val = 0;
+  ASSERT_FALSE(common::ConvertFromString("abc", &val));
+  ASSERT_FALSE(common::ConvertFromString("", &val));
+  ASSERT_FALSE(common::ConvertFromString("1.5x", &val));
+  ASSERT_FALSE(common::ConvertFromString("1e400", &val));
+  ASSERT_TRUE(common::ConvertFromString("1e-400", &val));
+  ASSERT_EQ(val, 0.0);
+  ASSERT_TRUE(common::ConvertFromBytes(MAKE_BUFFER("-2.5e3"), &val));
+  ASSERT_EQ(val, -2500.0);
+  ASSERT_FALSE(common::ConvertFromBytes(MAKE_BUFFER("2.5e"), &val));
+
+  float fval = 0;
+  ASSERT_FALSE(common::ConvertFromString("1e39", &fval));
+  ASSERT_TRUE(common::ConvertFromBytes(MAKE_CHAR_BUFFER("0.1"), &fval));
+  ASSERT_EQ(fval, 0.1f);
+}
+
+TEST(StringToNumber, swar_int_matches_generic) {
+  // The StringPiece16 overloads still parse one char at a time.
+  const std::vector<std::string> cases = {"",
+                                          "-",
+                                          "+",
+                                          "0",
+                                          "-0",
+                                          "+12",
+                                          " 12",
+                                          "12 ",
+                                          "1x2",
+                                          "0000000000000000000000012",
+                                          "12345678",
+                                          "123456789012345678",
+                                          "9223372036854775807",
+                                          "9223372036854775808",
+                                          "-9223372036854775808",
+                                          "-9223372036854775809",
+                                          "18446744073709551615",
+                                          "18446744073709551616",
+                                          "99999999999999999999",
+                                          "4294967295",
+                                          "4294967296",
+                                          "-2147483649",
+                                          "--1",
+                                          "+-1"};
+  std::vector<std::string> inputs = cases;
+  std::mt19937_64 gen(0x040);
+  const char kAlphabet[] = "0123456789-+ x";
+  for (int i = 0; i < 20000; ++i) {
+    std::string input(gen() % 25, '0');
+    for (size_t j = 0; j < input.size(); ++j) {
+      // Mostly digits, sometimes a sign, space or junk.
+      const size_t index = gen() % 64;
+      input[j] = index < 60 ? kAlphabet[index % 10] : kAlphabet[10 + index - 60];
+    }
+    inputs.push_back(input);
+  }
+
+  for (const std::string& input : inputs) {
+    const common::string16 input16 = common::UTF8ToUTF16(input);
+    int64_t v64 = 1, e64 = 2;
+    ASSERT_EQ(common::StringToInt64(input, &v64), common::StringToInt64(input16, &e64)) << input;
+    ASSERT_EQ(v64, e64) << input;
+    uint64_t u64 = 1, eu64 = 2;
+    ASSERT_EQ(common::StringToUint64(input, &u64), common::StringToUint64(input16, &eu64)) << input;
+    ASSERT_EQ(u64, eu64) << input;
+    int v32 = 1, e32 = 2;
+    ASSERT_EQ(common::StringToInt(input, &v32), common::StringToInt(input16, &e32)) << input;
+    ASSERT_EQ(v32, e32) << input;
+    unsigned u32 = 1, eu32 = 2;
+    ASSERT_EQ(common::StringToUint(input, &u32), common::StringToUint(input16, &eu32)) << input;
+    ASSERT_EQ(u32, eu32) << input;
+  }
+}
+
+TEST(StringToNumber, float_matches_strtod) {
+  std::vector<std::string> inputs = {"0",
+                                     "-0.0",
+                                     ".5",
+                                     "5.",
+                                     "1e23",
+                                     "9007199254740993",
+                                     "2.2250738585072011e-308",
+                                     "4.9406564584124654e-324",
+                                     "2.4703282292062327e-324",
+                                     "2.4703282292062328e-324",
+                                     "1.7976931348623158e308",
+                                     "7.038531e-26",
+                                     "3.4028235677973366e38",
+                                     "1.00000005960464477550",
+                                     "0.000000000000000000000000000000000000000000001",
+                                     "123456789012345678901234567890e-10",
+                                     "1.000000000000000000000000000000000000000000000001",
+                                     "9007199254740992.99999999999999999999999"};
+  std::mt19937_64 gen(0x1040);
+  char buffer[64];
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t bits = gen();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (!std::isfinite(value)) {
+      continue;
+    }
+    snprintf(buffer, sizeof(buffer), "%.*g", static_cast<int>(1 + gen() % 17), value);
+    inputs.push_back(buffer);
+    // Halfway between two doubles needs all the digits.
+    const double next = std::nextafter(value, std::numeric_limits<double>::infinity());
+    if (std::isfinite(next)) {
+      snprintf(buffer, sizeof(buffer), "%.25e", value / 2 + next / 2);
+      inputs.push_back(buffer);
+    }
+    // Random digits with a decimal point and exponent.
+    std::string digits(1 + gen() % 30, '0');
+    for (char& c : digits) {
+      c = static_cast<char>('0' + gen() % 10);
+    }
+    digits.insert(gen() % (digits.size() + 1), ".");
+    inputs.push_back(digits + "e" + std::to_string(static_cast<int>(gen() % 700) - 350));
+  }
+
+  for (const std::string& input : inputs) {
+    double value = 0;
+    const bool res = common::StringToDouble(input, &value);
+    const double expected = strtod(input.c_str(), nullptr);
+    ASSERT_EQ(res, !std::isinf(expected)) << input;
+    ASSERT_EQ(memcmp(&value, &expected, sizeof(value)), 0) << input;
+
+    float fvalue = 0;
+    const bool fres = common::StringToFloat(input, &fvalue);
+    const float fexpected = strtof(input.c_str(), nullptr);
+    ASSERT_EQ(fres, !std::isinf(fexpected)) << input;
+    ASSERT_EQ(memcmp(&fvalue, &fexpected, sizeof(fvalue)), 0) << input;
+  }
+
+  double value = 0;
+  ASSERT_FALSE(common::StringToDouble(" 1.5", &value));
+  ASSERT_EQ(value, 1.5);
+  ASSERT_FALSE(common::StringToDouble("1.5 ", &value));
+  ASSERT_FALSE(common::StringToDouble("", &value));
+  ASSERT_FALSE(common::StringToDouble("1e309", &value));
+  ASSERT_TRUE(common::StringToDouble(common::UTF8ToUTF16("-2.5"), &value));
+  ASSERT_EQ(value, -2.5);
+}
+
 TEST(ConvertToString, boolean) {
   std::string s = common::ConvertToString(true);
   ASSERT_EQ(s, "true");
@@ -820,6 +969,103 @@ TEST(ConvertToString, double) {
   ASSERT_EQ(s, "3.141593");
 }
 
+TEST(ConvertToString, integer_to_chars) {
+  for (int i = std::numeric_limits<int16_t>::min(); i <= std::numeric_limits<int16_t>::max(); ++i) {
+    ASSERT_EQ(common::ConvertToString(i), std::to_string(i));
+  }
+
+  uint64_t power = 1;
+  for (int i = 0; i < 20; ++i, power *= 10) {
+    for (uint64_t value : {power - 1, power, power + 1}) {
+      ASSERT_EQ(common::ConvertToString(value), std::to_string(value));
+      const int64_t signed_value = -static_cast<int64_t>(value);
+      ASSERT_EQ(common::ConvertToString(signed_value), std::to_string(signed_value));
+    }
+  }
+
+  char buffer[common::kMaxIntegerChars];
+  size_t size = common::NumberToChars(std::numeric_limits<int64_t>::min(), buffer);
+  ASSERT_EQ(std::string(buffer, size), "-9223372036854775808");
+  size = common::NumberToChars(std::numeric_limits<uint64_t>::max(), buffer);
+  ASSERT_EQ(std::string(buffer, size), "18446744073709551615");
+  ASSERT_EQ(common::NumberToChars(12345, common::span<char>(buffer, 4)), 0u);
+  ASSERT_EQ(common::NumberToChars(1234, common::span<char>(buffer, 4)), 4u);
+  ASSERT_EQ(common::ConvertToBytes(-42), common::ConvertToBytes(std::string("-42")));
+}
+
+TEST(ConvertToString, fixed_matches_printf) {
+  ASSERT_EQ(common::ConvertToString(2.5, 0), "2");
+  ASSERT_EQ(common::ConvertToString(3.5, 0), "4");
+  ASSERT_EQ(common::ConvertToString(0.125, 2), "0.12");
+  ASSERT_EQ(common::ConvertToString(0.375, 2), "0.38");
+  ASSERT_EQ(common::ConvertToString(-0.001, 2), "-0.00");
+  ASSERT_EQ(common::ConvertToString(9.9999999, 3), "10.000");
+  ASSERT_EQ(common::ConvertToString(1e10f, 6), "10000000000.000000");
+  ASSERT_EQ(common::ConvertToString(std::numeric_limits<double>::infinity()), "+inf");
+  ASSERT_EQ(common::ConvertToString(-std::numeric_limits<double>::infinity()), "-inf");
+  ASSERT_EQ(common::ConvertToString(-std::numeric_limits<float>::infinity()), "-inf");
+
+  std::mt19937_64 gen(0x039);
+  char expected[common::kMaxFixedChars];
+  for (int i = 0; i < 50000; ++i) {
+    uint64_t bits = gen();
+    if (i % 2) {
+      // Keep half of the samples around the fast path range.
+      bits = (bits & 0x800FFFFFFFFFFFFF) | ((1023 + gen() % 100 - 40) << 52);
+    }
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (std::isnan(value) || std::isinf(value)) {
+      continue;
+    }
+    for (int prec : {0, 1, 2, 3, 4, 6}) {
+      snprintf(expected, sizeof(expected), "%.*f", prec, value);
+      ASSERT_EQ(common::ConvertToString(value, prec), expected) << prec;
+    }
+  }
+}
+
+TEST(ConvertToString, shortest_round_trip) {
+  ASSERT_EQ(common::NumberToShortestString(0.1), "0.1");
+  ASSERT_EQ(common::NumberToShortestString(3.0), "3.0");
+  ASSERT_EQ(common::NumberToShortestString(-0.0), "-0.0");
+  ASSERT_EQ(common::NumberToShortestString(1e21), "1e+21");
+  ASSERT_EQ(common::NumberToShortestString(1.5e-7), "1.5e-07");
+  ASSERT_EQ(common::NumberToShortestString(0.00012), "0.00012");
+  ASSERT_EQ(common::NumberToShortestString(123456.789), "123456.789");
+  ASSERT_EQ(common::NumberToShortestString(0.1f), "0.1");
+  ASSERT_EQ(common::NumberToShortestString(std::numeric_limits<double>::max()), "1.7976931348623157e+308");
+  ASSERT_EQ(common::NumberToShortestString(std::numeric_limits<double>::denorm_min()), "5e-324");
+  ASSERT_EQ(common::NumberToShortestString(-std::numeric_limits<double>::infinity()), "-inf");
+
+  std::mt19937_64 gen(0x1039);
+  char buffer[common::kMaxShortestChars + 1];
+  for (int i = 0; i < 500000; ++i) {
+    const uint64_t bits = gen();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (std::isnan(value)) {
+      continue;
+    }
+    const size_t size = common::NumberToShortestChars(value, common::span<char>(buffer, common::kMaxShortestChars));
+    ASSERT_NE(size, 0u);
+    buffer[size] = 0;
+    if (std::isinf(value)) {
+      continue;
+    }
+    ASSERT_EQ(strtod(buffer, nullptr), value) << buffer;
+
+    const uint32_t float_bits = static_cast<uint32_t>(bits);
+    float float_value;
+    memcpy(&float_value, &float_bits, sizeof(float_value));
+    if (std::isnan(float_value) || std::isinf(float_value)) {
+      continue;
+    }
+    const std::string float_str = common::NumberToShortestString(float_value);
+    ASSERT_EQ(strtof(float_str.c_str(), nullptr), float_value) << float_str;
+  }
+}
+
 TEST(ConvertToString, hex) {
   std::string china("你好");
   std::string hexed;
@@ -29,7 +29,26 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+#if defined(OS_POSIX)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <common/compress/bzip2_compress.h>
+#include <common/compress/dictionary.h>
+#include <common/compress/hex.h>
+#include <common/compress/lz4_compress.h>
+#include <common/compress/unicode.h>
+#include <common/compress/xhex.h>
+#include <common/compress/zlib_compress.h>
+#include <common/file_system/file_system.h>
 #include <common/text_decoders/base64_edcoder.h>
+#include <common/text_decoders/compress_auto_edcoder.h>
 #include <common/text_decoders/compress_bzip2_edcoder.h>
 #include <common/text_decoders/compress_lz4_edcoder.h>
 #include <common/text_decoders/compress_snappy_edcoder.h>
@@ -38,8 +57,11 @@
 #include <common/text_decoders/html_edcoder.h>
 #include <common/text_decoders/iedcoder.h>
 #include <common/text_decoders/iedcoder_factory.h>
+#include <common/text_decoders/iedcoder_stream.h>
 #include <common/text_decoders/none_edcoder.h>
 #include <common/text_decoders/unicode_edcoder.h>
+#include <common/text_decoders/xhex_edcoder.h>
+#include <common/threads/thread_pool.h>
 
 TEST(html, enc_dec) {
   const common::char_buffer_t raw_data = MAKE_CHAR_BUFFER("alex aalex talex balex");
@@ -79,6 +101,70 @@ TEST(xhex, enc_dec) {
   ASSERT_TRUE(err);
 }
 
+TEST(hex, span_codecs) {
+  // sizes cover vector blocks and scalar tails
+  for (size_t size = 0; size < 160; size += 7) {
+    std::string raw;
+    std::string hex_lower, hex_upper, xhex_upper;
+    for (size_t i = 0; i < size; ++i) {
+      const unsigned char byte = static_cast<unsigned char>(i * 37 + 250);
+      raw.push_back(static_cast<char>(byte));
+      char buf[8];
+      snprintf(buf, sizeof(buf), "%02x", byte);
+      hex_lower += buf;
+      snprintf(buf, sizeof(buf), "%02X", byte);
+      hex_upper += buf;
+      xhex_upper += std::string("\\X") + buf;
+    }
+
+    std::string enc(common::compress::HexEncodedSize(size), 0);
+    ASSERT_FALSE(common::compress::EncodeHex(raw, true, common::span<char>(&enc[0], enc.size())));
+    ASSERT_EQ(hex_lower, enc);
+    ASSERT_FALSE(common::compress::EncodeHex(raw, false, common::span<char>(&enc[0], enc.size())));
+    ASSERT_EQ(hex_upper, enc);
+    std::string dec(size, 0);
+    ASSERT_FALSE(common::compress::DecodeHex(hex_lower, common::span<char>(&dec[0], dec.size())));
+    ASSERT_EQ(raw, dec);
+    ASSERT_FALSE(common::compress::DecodeHex(hex_upper, common::span<char>(&dec[0], dec.size())));
+    ASSERT_EQ(raw, dec);
+
+    std::string xenc(common::compress::XHexEncodedSize(size), 0);
+    ASSERT_FALSE(common::compress::EncodeXHex(raw, false, common::span<char>(&xenc[0], xenc.size())));
+    ASSERT_EQ(xhex_upper, xenc);
+    ASSERT_FALSE(common::compress::DecodeXHex(xhex_upper, common::span<char>(&dec[0], dec.size())));
+    ASSERT_EQ(raw, dec);
+
+    // a bad digit is found in any lane
+    for (size_t i = 0; i < hex_lower.size(); i += 5) {
+      std::string bad = hex_lower;
+      bad[i] = i % 2 ? 'g' : '\xC0';
+      ASSERT_TRUE(common::compress::DecodeHex(bad, common::span<char>(&dec[0], dec.size())));
+      bad = xhex_upper;
+      bad[i / 2 * 4 + 2 + i % 2] = i % 2 ? ':' : '\xE6';
+      ASSERT_TRUE(common::compress::DecodeXHex(bad, common::span<char>(&dec[0], dec.size())));
+    }
+  }
+
+  ASSERT_TRUE(common::compress::DecodeHex("abc", common::span<char>()));
+  char small[1];
+  ASSERT_TRUE(common::compress::EncodeHex("ab", true, common::span<char>(small, sizeof(small))));
+
+  common::string16 units;
+  for (uint32_t i = 0; i <= 0xFFFF; i += 3) {
+    units.push_back(static_cast<common::char16>(i));
+  }
+  std::string uenc(common::compress::UnicodeEncodedSize(units.size()), 0);
+  ASSERT_FALSE(common::compress::EncodeUnicode(units, false, common::span<char>(&uenc[0], uenc.size())));
+  char buf[8];
+  snprintf(buf, sizeof(buf), "%04X", static_cast<unsigned>(units[4321]));
+  ASSERT_EQ(std::string(buf), uenc.substr(4321 * 4, 4));
+  common::string16 udec(units.size(), 0);
+  ASSERT_FALSE(common::compress::DecodeUnicode(uenc, common::span<common::char16>(&udec[0], udec.size())));
+  ASSERT_EQ(units, udec);
+  uenc[77] = 'x';
+  ASSERT_TRUE(common::compress::DecodeUnicode(uenc, common::span<common::char16>(&udec[0], udec.size())));
+}
+
 TEST(unicode, enc_dec) {
   const common::char_buffer_t raw_data = MAKE_CHAR_BUFFER("alex aalex talex balex");
   common::UnicodeEDcoder zl;
@@ -166,6 +252,403 @@ TEST(snappy, enc_dec) {
 }
 #endif
 
+namespace {
+common::char_buffer_t MakeBlocksData(size_t size) {
+  common::char_buffer_t data;
+  uint32_t seed = 1;
+  while (data.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    const std::string word = "token" + std::to_string((seed >> 16) % 1000) + " ";
+    data.insert(data.end(), word.begin(), word.end());
+  }
+  data.resize(size);
+  return data;
+}
+
+// empty, single short block, block multiple and ragged tail
+const size_t kParallelSizes[] = {0, 1, 4 * 65536, 1000 * 1000 + 17};
+}  // namespace
+
+#ifdef HAVE_ZLIB
+TEST(zlib, parallel_enc_dec) {
+  common::threads::ThreadPool pool;
+  pool.Start(4);
+  const common::char_buffer_t raw_data = MakeBlocksData(1000 * 1000 + 17);
+  for (uint8_t def : {common::CompressZlibEDcoder::ZLIB_DEFLATE, common::CompressZlibEDcoder::GZIP_DEFLATE}) {
+    for (size_t size : kParallelSizes) {
+      const common::StringPiece piece(raw_data.data(), size);
+      common::char_buffer_t enc_data;
+      common::Error err = common::compress::EncodeZlibParallel(piece, false, def, &pool, &enc_data,
+                                                               Z_DEFAULT_COMPRESSION, 64 * 1024);
+      ASSERT_FALSE(err);
+      // output does not depend on threads
+      common::char_buffer_t enc_single;
+      err = common::compress::EncodeZlibParallel(piece, false, def, nullptr, &enc_single, Z_DEFAULT_COMPRESSION,
+                                                 64 * 1024);
+      ASSERT_FALSE(err);
+      ASSERT_EQ(enc_data, enc_single);
+
+      common::char_buffer_t dec_data;
+      err = common::compress::DecodeZlib(enc_data, false, &dec_data);
+      ASSERT_FALSE(err) << size;
+      ASSERT_EQ(common::char_buffer_t(raw_data.begin(), raw_data.begin() + size), dec_data);
+    }
+  }
+
+  common::char_buffer_t enc_data;
+  common::Error err = common::compress::EncodeZlibParallel(common::StringPiece(raw_data.data(), raw_data.size()),
+                                                           true, 0, &pool, &enc_data);
+  ASSERT_FALSE(err);
+  common::char_buffer_t dec_data;
+  err = common::compress::DecodeZlib(enc_data, true, &dec_data);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(raw_data, dec_data);
+  pool.Stop();
+}
+#endif
+
+#ifdef HAVE_BZIP2
+TEST(bzip2, parallel_enc_dec) {
+  common::threads::ThreadPool pool;
+  pool.Start(4);
+  const common::char_buffer_t raw_data = MakeBlocksData(1000 * 1000 + 17);
+  for (bool sized : {false, true}) {
+    for (size_t size : kParallelSizes) {
+      common::char_buffer_t enc_data;
+      common::Error err = common::compress::EncodeBZip2Parallel(common::StringPiece(raw_data.data(), size), sized,
+                                                                &pool, &enc_data, 300 * 1000);
+      ASSERT_FALSE(err);
+
+      common::char_buffer_t dec_data;
+      err = common::compress::DecodeBZip2(enc_data, sized, &dec_data);
+      ASSERT_FALSE(err) << size;
+      ASSERT_EQ(common::char_buffer_t(raw_data.begin(), raw_data.begin() + size), dec_data);
+    }
+  }
+  pool.Stop();
+}
+#endif
+
+#ifdef HAVE_LZ4
+TEST(lz4, parallel_enc_dec) {
+  common::threads::ThreadPool pool;
+  pool.Start(4);
+  common::char_buffer_t raw_data = MakeBlocksData(1000 * 1000 + 17);
+  // incompressible tail goes to stored blocks
+  uint32_t seed = 7;
+  for (size_t i = raw_data.size() - 70000; i < raw_data.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    raw_data[i] = static_cast<char>(seed >> 16);
+  }
+  for (size_t size : kParallelSizes) {
+    const common::StringPiece piece(raw_data.data(), size);
+    common::char_buffer_t enc_data;
+    common::Error err = common::compress::EncodeLZ4Parallel(piece, &pool, &enc_data, 64 * 1024);
+    ASSERT_FALSE(err);
+
+    common::char_buffer_t dec_data;
+    err = common::compress::DecodeLZ4Frame(enc_data, &dec_data);
+    ASSERT_FALSE(err) << size;
+    ASSERT_EQ(common::char_buffer_t(raw_data.begin(), raw_data.begin() + size), dec_data);
+  }
+
+  // frames from the streaming LZ4F encoder decode as well
+  common::CompressLZ4EDcoder lz4;
+  common::IEDcoderStream* stream = nullptr;
+  ASSERT_FALSE(lz4.CreateEncodeStream(&stream));
+  std::unique_ptr<common::IEDcoderStream> holder(stream);
+  common::char_buffer_t enc_data;
+  ASSERT_FALSE(stream->Update(common::StringPiece(raw_data.data(), raw_data.size()), &enc_data));
+  ASSERT_FALSE(stream->Finish(&enc_data));
+  common::char_buffer_t dec_data;
+  ASSERT_FALSE(common::compress::DecodeLZ4Frame(enc_data, &dec_data));
+  ASSERT_EQ(raw_data, dec_data);
+  pool.Stop();
+}
+#endif
+
+namespace {
+// message sizes shrinking and growing, so a reused context sees both
+const size_t kReuseSizes[] = {2000, 1, 200, 70000, 0, 1500, 3};
+}  // namespace
+
+#ifdef HAVE_ZLIB
+TEST(zlib, context_reuse) {
+  const common::char_buffer_t raw_data = MakeBlocksData(70000);
+  for (uint8_t def : {common::CompressZlibEDcoder::ZLIB_DEFLATE, common::CompressZlibEDcoder::GZIP_DEFLATE}) {
+    common::compress::ZlibCompressor compressor(def);
+    common::compress::ZlibDecompressor decompressor;
+    for (bool sized : {false, true}) {
+      for (size_t size : kReuseSizes) {
+        const common::StringPiece piece(raw_data.data(), size);
+        // contexts append to the output
+        common::char_buffer_t enc_data = MAKE_CHAR_BUFFER("#");
+        ASSERT_FALSE(compressor.Encode(piece, sized, &enc_data));
+        ASSERT_EQ('#', enc_data[0]);
+
+        common::char_buffer_t one_shot;
+        ASSERT_FALSE(common::compress::EncodeZlib(piece, sized, def, &one_shot));
+        ASSERT_EQ(one_shot, common::char_buffer_t(enc_data.begin() + 1, enc_data.end()));
+
+        common::char_buffer_t dec_data = MAKE_CHAR_BUFFER("#");
+        ASSERT_FALSE(decompressor.Decode(common::StringPiece(enc_data.data() + 1, enc_data.size() - 1), sized, &dec_data));
+        ASSERT_EQ('#', dec_data[0]);
+        ASSERT_EQ(common::char_buffer_t(raw_data.begin(), raw_data.begin() + size),
+                  common::char_buffer_t(dec_data.begin() + 1, dec_data.end()))
+            << size;
+      }
+    }
+
+    // corrupted input fails without touching what is already in the buffer
+    common::char_buffer_t dec_data = MAKE_CHAR_BUFFER("#");
+    ASSERT_TRUE(decompressor.Decode(MAKE_CHAR_BUFFER("not a zlib stream"), false, &dec_data));
+    ASSERT_EQ(MAKE_CHAR_BUFFER("#"), dec_data);
+  }
+}
+#endif
+
+#ifdef HAVE_LZ4
+TEST(lz4, context_reuse) {
+  const common::char_buffer_t raw_data = MakeBlocksData(70000);
+  common::compress::LZ4Compressor compressor;
+  for (bool sized : {false, true}) {
+    for (size_t size : kReuseSizes) {
+      const common::StringPiece piece(raw_data.data(), size);
+      common::char_buffer_t enc_data = MAKE_CHAR_BUFFER("#");
+      ASSERT_FALSE(compressor.Encode(piece, sized, &enc_data));
+      ASSERT_EQ('#', enc_data[0]);
+
+      common::char_buffer_t one_shot;
+      ASSERT_FALSE(common::compress::EncodeLZ4(piece, sized, &one_shot));
+      ASSERT_EQ(one_shot, common::char_buffer_t(enc_data.begin() + 1, enc_data.end()));
+
+      if (!sized) {
+        continue;  // unsized decode needs a size guess, covered by enc_dec
+      }
+      common::char_buffer_t dec_data;
+      ASSERT_FALSE(common::compress::DecodeLZ4(one_shot, sized, &dec_data));
+      ASSERT_EQ(common::char_buffer_t(raw_data.begin(), raw_data.begin() + size), dec_data) << size;
+    }
+  }
+}
+#endif
+
+namespace {
+// JSON-RPC like traffic: same keys and layout, different values
+std::vector<std::string> MakeRpcMessages(size_t count) {
+  std::vector<std::string> messages;
+  uint32_t seed = 3;
+  for (size_t i = 0; i < count; ++i) {
+    seed = seed * 1103515245 + 12345;
+    std::string message = "{\"jsonrpc\":\"2.0\",\"id\":\"" + std::to_string(i) + "\",\"result\":[";
+    for (size_t j = 0; j < 1 + (seed >> 16) % 8; ++j) {
+      message += "{\"id\":\"stream_" + std::to_string((seed >> 8) % 97 + j) + "\",\"status\":\"active\",\"cpu\":" +
+                 std::to_string((seed >> 4) % 100) + ",\"rss\":" + std::to_string(seed % 100000) + "},";
+    }
+    message += "{}]}";
+    messages.push_back(message);
+  }
+  return messages;
+}
+
+common::compress::CompressDictionarySPtr TrainRpcDictionary(const std::vector<std::string>& messages) {
+  std::vector<common::StringPiece> samples(messages.begin(), messages.end());
+  common::char_buffer_t content;
+  common::Error err = common::compress::TrainDictionary(samples, 4096, &content);
+  if (err) {
+    return common::compress::CompressDictionarySPtr();
+  }
+  return std::make_shared<common::compress::CompressDictionary>(content);
+}
+}  // namespace
+
+TEST(compress, dictionary_train) {
+  const std::vector<std::string> messages = MakeRpcMessages(200);
+  std::vector<common::StringPiece> samples(messages.begin(), messages.end());
+  common::char_buffer_t content;
+  ASSERT_FALSE(common::compress::TrainDictionary(samples, 1024, &content));
+  ASSERT_FALSE(content.empty());
+  ASSERT_LE(content.size(), 1024u);
+  const std::string text(content.begin(), content.end());
+  ASSERT_NE(text.find("\"status\":\"active\""), std::string::npos);
+
+  ASSERT_TRUE(common::compress::TrainDictionary(samples, 0, &content));
+  ASSERT_TRUE(common::compress::TrainDictionary(samples, common::compress::CompressDictionary::MAX_DICTIONARY_SIZE + 1,
+                                                &content));
+  ASSERT_FALSE(common::compress::TrainDictionary(std::vector<common::StringPiece>(), 1024, &content));
+  ASSERT_TRUE(content.empty());
+
+  // ids follow the content, oversized content keeps its tail
+  const common::compress::CompressDictionary first(common::StringPiece("abcdefgh"));
+  ASSERT_NE(0u, first.GetID());
+  ASSERT_EQ(first.GetID(), common::compress::CompressDictionary(MAKE_CHAR_BUFFER("abcdefgh")).GetID());
+  ASSERT_NE(first.GetID(), common::compress::CompressDictionary(common::StringPiece("abcdefgi")).GetID());
+  const std::string big(common::compress::CompressDictionary::MAX_DICTIONARY_SIZE + 10, 'x');
+  const common::compress::CompressDictionary tail(common::StringPiece(big + "end"));
+  ASSERT_EQ(static_cast<size_t>(common::compress::CompressDictionary::MAX_DICTIONARY_SIZE), tail.GetContent().size());
+  ASSERT_EQ('d', tail.GetContent().back());
+}
+
+#ifdef HAVE_ZLIB
+TEST(zlib, dictionary_enc_dec) {
+  const std::vector<std::string> messages = MakeRpcMessages(300);
+  const auto dictionary = TrainRpcDictionary(std::vector<std::string>(messages.begin(), messages.begin() + 200));
+  ASSERT_TRUE(dictionary);
+  size_t plain_size = 0;
+  size_t dictionary_size = 0;
+  for (bool sized : {false, true}) {
+    for (size_t i = 200; i < messages.size(); ++i) {
+      const common::StringPiece message(messages[i]);
+      common::char_buffer_t plain;
+      ASSERT_FALSE(common::compress::EncodeZlib(message, sized, 0, &plain));
+      common::char_buffer_t enc_data;
+      ASSERT_FALSE(common::compress::EncodeZlib(message, sized, dictionary, &enc_data));
+      plain_size += plain.size();
+      dictionary_size += enc_data.size();
+
+      common::char_buffer_t dec_data;
+      ASSERT_FALSE(common::compress::DecodeZlib(enc_data, sized, dictionary, &dec_data));
+      ASSERT_EQ(messages[i], std::string(dec_data.begin(), dec_data.end()));
+      // no dictionary, or a different one
+      ASSERT_TRUE(common::compress::DecodeZlib(enc_data, sized, &dec_data));
+      const auto other = std::make_shared<common::compress::CompressDictionary>(common::StringPiece("other"));
+      ASSERT_TRUE(common::compress::DecodeZlib(enc_data, sized, other, &dec_data));
+    }
+  }
+  ASSERT_LT(dictionary_size * 2, plain_size);
+
+  // gzip has no dictionary field
+  common::compress::ZlibCompressor gzip(common::CompressZlibEDcoder::GZIP_DEFLATE, Z_BEST_COMPRESSION, dictionary);
+  common::char_buffer_t enc_data;
+  ASSERT_TRUE(gzip.Encode(common::StringPiece(messages[0]), false, &enc_data));
+
+  // incremental coders share the format
+  common::CompressZlibEDcoder coder(false, dictionary);
+  common::IEDcoderStream* stream = nullptr;
+  ASSERT_FALSE(coder.CreateEncodeStream(&stream));
+  std::unique_ptr<common::IEDcoderStream> holder(stream);
+  ASSERT_FALSE(stream->Update(common::StringPiece(messages[1]), &enc_data));
+  ASSERT_FALSE(stream->Finish(&enc_data));
+  common::char_buffer_t dec_data;
+  ASSERT_FALSE(coder.Decode(enc_data, &dec_data));
+  ASSERT_EQ(messages[1], std::string(dec_data.begin(), dec_data.end()));
+  ASSERT_FALSE(coder.CreateDecodeStream(&stream));
+  holder.reset(stream);
+  dec_data.clear();
+  ASSERT_FALSE(stream->Update(common::StringPiece(enc_data.data(), enc_data.size()), &dec_data));
+  ASSERT_FALSE(stream->Finish(&dec_data));
+  ASSERT_EQ(messages[1], std::string(dec_data.begin(), dec_data.end()));
+}
+#endif
+
+#ifdef HAVE_LZ4
+TEST(lz4, dictionary_enc_dec) {
+  const std::vector<std::string> messages = MakeRpcMessages(300);
+  const auto dictionary = TrainRpcDictionary(std::vector<std::string>(messages.begin(), messages.begin() + 200));
+  ASSERT_TRUE(dictionary);
+  size_t plain_size = 0;
+  size_t dictionary_size = 0;
+  common::compress::LZ4Compressor compressor(dictionary);
+  for (size_t i = 200; i < messages.size(); ++i) {
+    const common::StringPiece message(messages[i]);
+    common::char_buffer_t plain;
+    ASSERT_FALSE(common::compress::EncodeLZ4(message, true, &plain));
+    common::char_buffer_t enc_data;
+    ASSERT_FALSE(common::compress::EncodeLZ4(message, true, dictionary, &enc_data));
+    common::char_buffer_t reused;
+    ASSERT_FALSE(compressor.Encode(message, true, &reused));
+    ASSERT_EQ(enc_data, reused);
+    plain_size += plain.size();
+    dictionary_size += enc_data.size();
+
+    common::char_buffer_t dec_data;
+    ASSERT_FALSE(common::compress::DecodeLZ4(enc_data, true, dictionary, &dec_data));
+    ASSERT_EQ(messages[i], std::string(dec_data.begin(), dec_data.end()));
+    // dictionary id in the header does not match
+    const auto other = std::make_shared<common::compress::CompressDictionary>(common::StringPiece("other"));
+    ASSERT_TRUE(common::compress::DecodeLZ4(enc_data, true, other, &dec_data));
+  }
+  ASSERT_LT(dictionary_size * 3, plain_size * 2);
+}
+#endif
+
+TEST(iedcoder, factory_dictionary) {
+  const std::vector<std::string> messages = MakeRpcMessages(50);
+  const auto dictionary = TrainRpcDictionary(messages);
+  ASSERT_TRUE(dictionary);
+  for (common::EDType type : {common::ED_ZLIB, common::ED_LZ4}) {
+    std::unique_ptr<common::IEDcoder> coder(common::CreateEDCoder(type, dictionary));
+    ASSERT_TRUE(coder);
+    ASSERT_EQ(type, coder->GetType());
+#if defined(HAVE_ZLIB) && defined(HAVE_LZ4)
+    common::char_buffer_t enc_data;
+    ASSERT_FALSE(coder->Encode(common::StringPiece(messages[0]), &enc_data));
+    common::char_buffer_t dec_data;
+    ASSERT_FALSE(coder->Decode(enc_data, &dec_data));
+    ASSERT_EQ(messages[0], std::string(dec_data.begin(), dec_data.end()));
+#endif
+  }
+}
+
+#if defined(HAVE_ZLIB) && defined(HAVE_LZ4)
+TEST(auto, enc_dec) {
+  common::char_buffer_t random_data;
+  random_data.resize(64 * 1024);
+  uint32_t seed = 5;
+  for (char& c : random_data) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 16);
+  }
+  const common::char_buffer_t small_text = MakeBlocksData(8 * 1024);
+  const common::char_buffer_t big_text = MakeBlocksData(100 * 1024);
+  const common::char_buffer_t tiny = MAKE_CHAR_BUFFER("ping");
+
+  typedef common::CompressAutoEDcoder auto_t;
+  const struct {
+    auto_t::CpuBudget budget;
+    const common::char_buffer_t* data;
+    common::EDType codec;
+  } cases[] = {{auto_t::CPU_BUDGET_NORMAL, &tiny, common::ED_NONE},
+               {auto_t::CPU_BUDGET_NORMAL, &random_data, common::ED_NONE},
+               {auto_t::CPU_BUDGET_NORMAL, &small_text, common::ED_ZLIB},
+               {auto_t::CPU_BUDGET_NORMAL, &big_text, common::ED_LZ4},
+               {auto_t::CPU_BUDGET_LOW, &small_text, common::ED_LZ4},
+               {auto_t::CPU_BUDGET_HIGH, &big_text, common::ED_ZLIB},
+               {auto_t::CPU_BUDGET_HIGH, &random_data, common::ED_NONE}};
+  common::CompressAutoEDcoder decoder(auto_t::CPU_BUDGET_LOW);
+  for (const auto& test : cases) {
+    common::CompressAutoEDcoder coder(test.budget);
+    common::char_buffer_t enc_data;
+    ASSERT_FALSE(coder.Encode(*test.data, &enc_data));
+    ASSERT_EQ(test.codec, static_cast<common::EDType>(enc_data[0]));
+    ASSERT_LE(enc_data.size(), test.data->size() + 1);
+
+    const auto stats = coder.GetEncodeStats(test.codec);
+    ASSERT_EQ(1u, stats.calls);
+    ASSERT_EQ(test.data->size(), stats.bytes_in);
+    ASSERT_EQ(enc_data.size(), stats.bytes_out);
+
+    // the tag, not the decoder budget, selects the codec
+    common::char_buffer_t dec_data;
+    ASSERT_FALSE(decoder.Decode(enc_data, &dec_data));
+    ASSERT_EQ(*test.data, dec_data);
+  }
+  ASSERT_EQ(3u, decoder.GetDecodeStats(common::ED_NONE).calls);
+  ASSERT_EQ(2u, decoder.GetDecodeStats(common::ED_ZLIB).calls);
+  ASSERT_EQ(2u, decoder.GetDecodeStats(common::ED_LZ4).calls);
+  ASSERT_EQ(0u, decoder.GetEncodeStats(common::ED_LZ4).calls);
+
+  common::char_buffer_t dec_data;
+  ASSERT_TRUE(decoder.Decode(MAKE_CHAR_BUFFER("\x01base64?"), &dec_data));
+  ASSERT_TRUE(decoder.Decode(MAKE_CHAR_BUFFER("\x02broken"), &dec_data));
+
+  ASSERT_LT(common::CompressAutoEDcoder::SampleEntropy(common::StringPiece(small_text.data(), small_text.size())), 6);
+  ASSERT_GT(common::CompressAutoEDcoder::SampleEntropy(common::StringPiece(random_data.data(), random_data.size())),
+            common::CompressAutoEDcoder::ENTROPY_LIMIT);
+  ASSERT_EQ(0, common::CompressAutoEDcoder::SampleEntropy(common::StringPiece("aaaa")));
+}
+#endif
+
 TEST(none, enc_dec) {
   const common::char_buffer_t raw_data = MAKE_CHAR_BUFFER("alex aalex talex balex");
   common::NoneEDcoder zl;
@@ -198,3 +681,242 @@ TEST(iedcoder, factory) {
     delete dec2;
   }
 }
+
+namespace {
+
+common::char_buffer_t MakeStreamData(size_t size) {
+  common::char_buffer_t data;
+  data.reserve(size);
+  uint32_t seed = 17;
+  while (data.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    const char* words[] = {"alex ", "aalex ", "talex ", "balex\n", "\x01\xff"};
+    const char* word = words[(seed >> 16) % 5];
+    data.insert(data.end(), word, word + strlen(word));
+  }
+  data.resize(size);
+  return data;
+}
+
+common::Error StreamChunked(common::IEDcoderStream* stream,
+                            const common::char_buffer_t& data,
+                            size_t seed,
+                            common::char_buffer_t* out) {
+  static const size_t chunks[] = {1, 7, 4096, 3, 65537, 100};
+  size_t pos = 0;
+  for (size_t i = seed; pos < data.size(); ++i) {
+    const size_t size = std::min(chunks[i % 6], data.size() - pos);
+    common::Error err = stream->Update(common::StringPiece(data.data() + pos, size), out);
+    if (err) {
+      return err;
+    }
+    pos += size;
+  }
+  return stream->Finish(out);
+}
+
+}  // namespace
+
+TEST(iedcoder, stream_enc_dec) {
+  const common::char_buffer_t raw_data = MakeStreamData(300 * 1024);
+  std::vector<std::shared_ptr<common::IEDcoder>> coders = {std::make_shared<common::Base64EDcoder>(),
+                                                           std::make_shared<common::HexEDcoder>(),
+                                                           std::make_shared<common::XHexEDcoder>(false)};
+#ifdef HAVE_ZLIB
+  coders.push_back(std::make_shared<common::CompressZlibEDcoder>());
+  coders.push_back(std::make_shared<common::CompressZlibEDcoder>(false, common::CompressZlibEDcoder::GZIP_DEFLATE));
+#endif
+#ifdef HAVE_BZIP2
+  coders.push_back(std::make_shared<common::CompressBZip2EDcoder>());
+#endif
+#ifdef HAVE_LZ4
+  coders.push_back(std::make_shared<common::CompressLZ4EDcoder>());
+#endif
+#ifdef HAVE_SNAPPY
+  coders.push_back(std::make_shared<common::CompressSnappyEDcoder>());
+#endif
+
+  for (auto coder : coders) {
+    common::IEDcoderStream* enc = nullptr;
+    common::Error err = coder->CreateEncodeStream(&enc);
+    ASSERT_FALSE(err) << common::ConvertToString(coder->GetType());
+    common::char_buffer_t enc_data;
+    err = StreamChunked(enc, raw_data, 0, &enc_data);
+    ASSERT_FALSE(err);
+    ASSERT_TRUE(enc->IsFinished());
+    ASSERT_TRUE(enc->Update(common::StringPiece("a"), &enc_data));
+    delete enc;
+
+    const common::EDType type = coder->GetType();
+    if (type != common::ED_LZ4 && type != common::ED_SNAPPY) {  // framed formats differ from one-shot blocks
+      common::char_buffer_t one_shot;
+      err = coder->Decode(enc_data, &one_shot);
+      ASSERT_FALSE(err);
+      ASSERT_EQ(raw_data, one_shot);
+    }
+
+    common::IEDcoderStream* dec = nullptr;
+    err = coder->CreateDecodeStream(&dec);
+    ASSERT_FALSE(err);
+    common::char_buffer_t dec_data;
+    err = StreamChunked(dec, enc_data, 3, &dec_data);
+    ASSERT_FALSE(err);
+    ASSERT_EQ(raw_data, dec_data);
+    delete dec;
+
+    if (type != common::ED_BASE64 && type != common::ED_HEX && type != common::ED_XHEX) {
+      // truncated input is detected by Finish
+      err = coder->CreateDecodeStream(&dec);
+      ASSERT_FALSE(err);
+      dec_data.clear();
+      ASSERT_FALSE(dec->Update(common::StringPiece(enc_data.data(), enc_data.size() / 2), &dec_data));
+      ASSERT_TRUE(dec->Finish(&dec_data));
+      delete dec;
+    }
+  }
+
+  common::NoneEDcoder none;
+  common::IEDcoderStream* stream = nullptr;
+  ASSERT_TRUE(none.CreateEncodeStream(&stream));
+  ASSERT_FALSE(stream);
+#ifdef HAVE_ZLIB
+  common::CompressZlibEDcoder sized(true);
+  ASSERT_TRUE(sized.CreateEncodeStream(&stream));
+#endif
+}
+
+#ifdef HAVE_SNAPPY
+TEST(iedcoder, snappy_framing) {
+  common::CompressSnappyEDcoder snappy;
+  const std::string identifier("\xff\x06\x00\x00sNaPpY", 10);
+  // uncompressed chunk of "hello" with its masked crc32c
+  const std::string hello_chunk("\x01\x09\x00\x00\xbb\x1f\x1c\x19hello", 13);
+
+  common::IEDcoderStream* stream = nullptr;
+  ASSERT_FALSE(snappy.CreateEncodeStream(&stream));
+  common::char_buffer_t out;
+  ASSERT_FALSE(stream->Finish(&out));
+  ASSERT_EQ(out.as_string(), identifier);
+  delete stream;
+
+  // padding (0xfe) and reserved skippable (0x80) chunks are ignored
+  const std::string framed = identifier + std::string("\xfe\x02\x00\x00\x00\x00", 6) + hello_chunk +
+                             std::string("\x80\x01\x00\x00x", 5) + identifier + hello_chunk;
+  ASSERT_FALSE(snappy.CreateDecodeStream(&stream));
+  out.clear();
+  ASSERT_FALSE(stream->Update(framed, &out));
+  ASSERT_FALSE(stream->Finish(&out));
+  ASSERT_EQ(out.as_string(), "hellohello");
+  delete stream;
+
+  std::string bad_crc = identifier + hello_chunk;
+  bad_crc[14] ^= 1;
+  const std::string invalid[] = {hello_chunk, bad_crc, identifier + std::string("\x02\x01\x00\x00x", 5),
+                                 std::string("\xff\x06\x00\x00snappy", 10)};
+  for (const std::string& data : invalid) {
+    ASSERT_FALSE(snappy.CreateDecodeStream(&stream));
+    out.clear();
+    ASSERT_TRUE(stream->Update(data, &out));
+    delete stream;
+  }
+
+  // compressible input goes into compressed (0x00) chunks of at most 64 KiB
+  common::char_buffer_t raw_data;
+  raw_data.resize(200 * 1024, 'a');
+  ASSERT_FALSE(snappy.CreateEncodeStream(&stream));
+  common::char_buffer_t enc_data;
+  ASSERT_FALSE(stream->Update(common::StringPiece(raw_data.data(), raw_data.size()), &enc_data));
+  ASSERT_FALSE(stream->Finish(&enc_data));
+  delete stream;
+  ASSERT_LT(enc_data.size(), raw_data.size() / 2);
+  ASSERT_EQ(enc_data[identifier.size()], '\x00');
+
+  ASSERT_FALSE(snappy.CreateDecodeStream(&stream));
+  common::char_buffer_t dec_data;
+  ASSERT_FALSE(stream->Update(common::StringPiece(enc_data.data(), enc_data.size()), &dec_data));
+  ASSERT_FALSE(stream->Finish(&dec_data));
+  ASSERT_EQ(raw_data, dec_data);
+  delete stream;
+}
+#endif
+
+#ifdef HAVE_LZ4
+TEST(iedcoder, stream_file) {
+  const std::string raw_path = "/tmp/unit_test_stream_raw.txt";
+  const std::string enc_path = "/tmp/unit_test_stream_enc.lz4";
+  const std::string dec_path = "/tmp/unit_test_stream_dec.txt";
+  const common::char_buffer_t raw_data = MakeStreamData(1024 * 1024 + 13);
+  const std::string raw_str = raw_data.as_string();
+  FILE* fl = fopen(raw_path.c_str(), "wb");
+  ASSERT_TRUE(fl);
+  ASSERT_EQ(fwrite(raw_str.data(), 1, raw_str.size(), fl), raw_str.size());
+  fclose(fl);
+
+  common::CompressLZ4EDcoder lz4;
+  common::Error err = common::EncodeFile(&lz4, raw_path, enc_path);
+  ASSERT_FALSE(err);
+  err = common::DecodeFile(&lz4, enc_path, dec_path);
+  ASSERT_FALSE(err);
+
+  std::string dec_str;
+  ASSERT_TRUE(common::file_system::read_file_to_string(dec_path, &dec_str));
+  ASSERT_EQ(raw_str, dec_str);
+
+  ASSERT_FALSE(common::file_system::remove_file(raw_path));
+  ASSERT_FALSE(common::file_system::remove_file(enc_path));
+  ASSERT_FALSE(common::file_system::remove_file(dec_path));
+}
+
+#if defined(OS_POSIX)
+TEST(iedcoder, stream_constant_memory) {
+  // encode -> decode pipeline over 256 MB, peak memory shouldn't depend on the volume
+  const size_t total = size_t(256) << 20;
+  const common::char_buffer_t pattern = MakeStreamData(common::DEFAULT_STREAM_CHUNK_SIZE);
+
+  struct rusage before;
+  ASSERT_EQ(getrusage(RUSAGE_SELF, &before), 0);
+
+  common::CompressLZ4EDcoder lz4;
+  common::IEDcoderStream* enc = nullptr;
+  ASSERT_FALSE(lz4.CreateEncodeStream(&enc));
+  common::IEDcoderStream* dec = nullptr;
+  ASSERT_FALSE(lz4.CreateDecodeStream(&dec));
+
+  size_t produced = 0;
+  auto reader = [&produced, &pattern, total](char* buf, size_t size, size_t* nread) {
+    *nread = std::min(std::min(size, pattern.size()), total - produced);
+    memcpy(buf, pattern.data(), *nread);
+    produced += *nread;
+    return common::Error();
+  };
+  size_t consumed = 0;
+  common::char_buffer_t dec_data;
+  auto writer = [&consumed, &dec_data, &pattern, dec](const common::char_buffer_t& data) {
+    dec_data.clear();
+    common::Error err = dec->Update(common::StringPiece(data.data(), data.size()), &dec_data);
+    if (err) {
+      return err;
+    }
+    for (size_t i = 0; i < dec_data.size(); ++i) {
+      if (dec_data[i] != pattern[(consumed + i) % pattern.size()]) {
+        return common::make_error("Stream data mismatch");
+      }
+    }
+    consumed += dec_data.size();
+    return common::Error();
+  };
+  common::Error err = common::TransformStream(enc, reader, writer);
+  ASSERT_FALSE(err);
+  dec_data.clear();
+  ASSERT_FALSE(dec->Finish(&dec_data));
+  ASSERT_TRUE(dec_data.empty());
+  ASSERT_EQ(total, consumed);
+  delete enc;
+  delete dec;
+
+  struct rusage after;
+  ASSERT_EQ(getrusage(RUSAGE_SELF, &after), 0);
+  ASSERT_LT(after.ru_maxrss - before.ru_maxrss, 32 * 1024);  // kilobytes
+}
+#endif
+#endif
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
+#include <common/threads/mpsc_queue.h>
 #include <common/threads/thread_manager.h>
 
 std::shared_ptr<common::threads::Thread<void> > some_thread;
@@ -28,3 +32,51 @@ TEST(THREAD_MANAGER, tests) {
   some_thread->Join();
   ASSERT_EQ(some_thread->GetHandle(), common::threads::invalid_thread_handle());
 }
+
+namespace {
+struct QueueItem : public common::threads::mpsc_queue_node {
+  QueueItem() : producer(0), seq(0) {}
+
+  size_t producer;
+  size_t seq;
+};
+}  // namespace
+
+TEST(mpsc_queue, producers_keep_order) {
+  const size_t producers = 4;
+  const size_t per_producer = 100000;
+  std::vector<QueueItem> items(producers * per_producer);
+  common::threads::mpsc_queue<QueueItem> queue;
+  ASSERT_TRUE(queue.IsEmpty());
+  ASSERT_EQ(queue.Pop(), nullptr);
+
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.push_back(std::thread([&items, &queue, p, per_producer]() {
+      for (size_t i = 0; i < per_producer; ++i) {
+        QueueItem* item = &items[p * per_producer + i];
+        item->producer = p;
+        item->seq = i;
+        queue.Push(item);
+      }
+    }));
+  }
+
+  std::vector<size_t> next(producers, 0);
+  size_t popped = 0;
+  while (popped < items.size()) {
+    QueueItem* item = queue.Pop();
+    if (!item) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(item->seq, next[item->producer]);
+    next[item->producer]++;
+    popped++;
+  }
+  for (size_t p = 0; p < producers; ++p) {
+    threads[p].join();
+  }
+  ASSERT_TRUE(queue.IsEmpty());
+  ASSERT_EQ(queue.Pop(), nullptr);
+}
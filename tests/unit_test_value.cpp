@@ -29,6 +29,7 @@
 
 #include <gtest/gtest.h>
 
+#include <common/serializer/binary_serializer.h>
 #include <common/value.h>
 
 template <typename T, typename U>
@@ -104,3 +105,96 @@ TEST(Value, create_and_get_complex_type) {
   ASSERT_TRUE(val_hash && val_hash->GetType() == common::Value::TYPE_HASH);
   delete val_hash;
 }
+
+TEST(Value, move_and_views) {
+  common::Value::string_t data;
+  data.resize(1024, 'a');
+  const char* data_ptr = data.data();
+  common::StringValue* val_string = common::Value::CreateStringValue(std::move(data));
+  common::StringPiece piece;
+  ASSERT_TRUE(val_string->GetAsStringPiece(&piece));
+  ASSERT_EQ(piece.data(), data_ptr);
+  ASSERT_EQ(piece.size(), 1024);
+  std::string basic;
+  ASSERT_TRUE(val_string->GetAsBasicString(&basic));
+  ASSERT_EQ(basic, std::string(1024, 'a'));
+
+  common::byte_array_t bt = {0, 1, 2};
+  const common::byte_t* bt_ptr = bt.data();
+  common::ByteArrayValue* val_barr = common::Value::CreateByteArrayValue(std::move(bt));
+  common::span<const common::byte_t> bytes;
+  ASSERT_TRUE(val_barr->GetAsByteSpan(&bytes));
+  ASSERT_EQ(bytes.data(), bt_ptr);
+  ASSERT_EQ(bytes.size(), 3);
+  ASSERT_FALSE(val_barr->GetAsStringPiece(&piece));
+  ASSERT_FALSE(val_string->GetAsByteSpan(&bytes));
+
+  common::HashValue* hash = common::Value::CreateHashValue();
+  ASSERT_TRUE(hash->Insert(MAKE_CHAR_BUFFER("string"), val_string));
+  ASSERT_TRUE(hash->Insert(MAKE_CHAR_BUFFER("bytes"), val_barr));
+  common::ArrayValue* arr = common::Value::CreateArrayValue();
+  arr->AppendString(MAKE_CHAR_BUFFER("item"));
+  arr->Append(std::unique_ptr<common::Value>(common::Value::CreateNullValue()));
+  ASSERT_EQ(arr->GetSize(), 2);
+  ASSERT_TRUE(hash->Insert(std::string("array"), arr));
+
+  common::HashValue* copy = hash->DeepCopy();
+  ASSERT_TRUE(copy->Equals(hash));
+  delete copy;
+  delete hash;
+}
+
+TEST(Value, binary_codec) {
+  common::HashValue* hash = common::Value::CreateHashValue();
+  ASSERT_TRUE(hash->Insert(std::string("null"), common::Value::CreateNullValue()));
+  ASSERT_TRUE(hash->Insert(std::string("bool"), common::Value::CreateBooleanValue(true)));
+  ASSERT_TRUE(hash->Insert(std::string("int"), common::Value::CreateIntegerValue(-11)));
+  ASSERT_TRUE(hash->Insert(std::string("uint"), common::Value::CreateUIntegerValue(321U)));
+  ASSERT_TRUE(hash->Insert(std::string("long"), common::Value::CreateLongIntegerValue(-1341L)));
+  ASSERT_TRUE(hash->Insert(std::string("ulong"), common::Value::CreateULongIntegerValue(3231UL)));
+  ASSERT_TRUE(hash->Insert(std::string("llong"), common::Value::CreateLongLongIntegerValue(INT64_MIN)));
+  ASSERT_TRUE(hash->Insert(std::string("ullong"), common::Value::CreateULongLongIntegerValue(UINT64_MAX)));
+  ASSERT_TRUE(hash->Insert(std::string("double"), common::Value::CreateDoubleValue(11.5)));
+  ASSERT_TRUE(hash->Insert(std::string("time"), common::Value::CreateTimeValue(1577836800)));
+  ASSERT_TRUE(hash->Insert(std::string("string"), common::Value::CreateStringValue(MAKE_CHAR_BUFFER("data"))));
+  ASSERT_TRUE(hash->Insert(std::string("bytes"), common::Value::CreateByteArrayValue(MAKE_BUFFER("\x00\x01\xff"))));
+  common::ArrayValue* arr = common::Value::CreateArrayValue();
+  arr->AppendInteger(1);
+  arr->AppendString(MAKE_CHAR_BUFFER("item"));
+  ASSERT_TRUE(hash->Insert(std::string("array"), arr));
+  common::SetValue* set = common::Value::CreateSetValue();
+  set->Insert(MAKE_CHAR_BUFFER("member"));
+  ASSERT_TRUE(hash->Insert(std::string("set"), set));
+  common::ZSetValue* zset = common::Value::CreateZSetValue();
+  zset->Insert(MAKE_CHAR_BUFFER("key"), MAKE_CHAR_BUFFER("value"));
+  ASSERT_TRUE(hash->Insert(std::string("zset"), zset));
+
+  common::serializer::ValueBinaryCodec codec;
+  common::buffer_t encoded;
+  ASSERT_FALSE(codec.Encode(hash, &encoded));
+  common::Value* decoded = nullptr;
+  ASSERT_FALSE(codec.Decode(encoded, &decoded));
+  ASSERT_TRUE(decoded && decoded->Equals(hash));
+  delete decoded;
+
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    common::Value* partial = nullptr;
+    ASSERT_TRUE(codec.Decode(encoded.data(), i, &partial));
+    ASSERT_FALSE(partial);
+  }
+
+  common::buffer_t trailing = encoded;
+  trailing.push_back(0);
+  ASSERT_TRUE(codec.Decode(trailing, &decoded));
+  delete hash;
+
+  // UINT64_MAX takes ten bytes, the last one holds a single bit
+  const common::byte_t max[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01};
+  common::serializer::ValueBinaryReader max_reader(max, sizeof(max));
+  uint64_t varint = 0;
+  ASSERT_TRUE(max_reader.ReadVarUInt(&varint));
+  ASSERT_EQ(varint, UINT64_MAX);
+  const common::byte_t overlong[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x03};
+  common::serializer::ValueBinaryReader overlong_reader(overlong, sizeof(overlong));
+  ASSERT_FALSE(overlong_reader.ReadVarUInt(&varint));
+}